@@ -0,0 +1,415 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * LZ4 decompressor tuned for x86_64
+ *
+ * Compressed swap, zram and squashfs images mostly hold 4K pages, which
+ * LZ4 turns into many short literal runs and matches. The generic decoder
+ * moves those 8 bytes at a time. This one copies 16 bytes per step, using
+ * unaligned 8 byte loads and stores, whenever there is room to overrun
+ * the end of the copy. That needs neither the FPU nor a particular CPU
+ * feature, so it can also be used from the atomic contexts zswap and zram
+ * decompress in. Compression is left to the generic LZ4 code.
+ *
+ * Loading the module with bench=1 checks the decoder against the generic
+ * one on a synthetic page and reports the time both take.
+ */
+
+#define pr_fmt(fmt) KBUILD_MODNAME ": " fmt
+
+#include <linux/crypto.h>
+#include <linux/init.h>
+#include <linux/ktime.h>
+#include <linux/lz4.h>
+#include <linux/module.h>
+#include <linux/random.h>
+#include <linux/sched.h>
+#include <linux/slab.h>
+#include <linux/vmalloc.h>
+#include <asm/unaligned.h>
+#include <crypto/internal/scompress.h>
+
+#define LZ4_X86_MINMATCH	4
+/* How far the fast paths may read or write past the end of a copy */
+#define LZ4_X86_OVERRUN		16
+
+static bool bench;
+module_param(bench, bool, 0444);
+MODULE_PARM_DESC(bench, "Compare with the generic decoder at load time");
+
+struct lz4_x86_ctx {
+	void *lz4_comp_mem;
+};
+
+static __always_inline void lz4_x86_copy8(u8 *dst, const u8 *src)
+{
+	put_unaligned(get_unaligned((const u64 *)src), (u64 *)dst);
+}
+
+static __always_inline void lz4_x86_copy16(u8 *dst, const u8 *src)
+{
+	lz4_x86_copy8(dst, src);
+	lz4_x86_copy8(dst + 8, src + 8);
+}
+
+/* Reads the 255 terminated extension of a literal or match length */
+static __always_inline int lz4_x86_read_length(const u8 **ip, const u8 *iend,
+					       size_t *length)
+{
+	unsigned int s;
+
+	do {
+		if (unlikely(*ip >= iend))
+			return -EINVAL;
+		s = *(*ip)++;
+		*length += s;
+	} while (s == 255);
+
+	return 0;
+}
+
+/*
+ * Copies a match of @length bytes starting @offset bytes back from @op.
+ * The caller guarantees that LZ4_X86_OVERRUN bytes may be written past
+ * the end of the match.
+ */
+static __always_inline void lz4_x86_copy_match(u8 *op, size_t offset,
+					       size_t length)
+{
+	/* Steps that turn a short offset into a multiple of it >= 8 */
+	static const unsigned int inc32[8] = { 0, 1, 2, 1, 0, 4, 4, 4 };
+	static const int dec64[8] = { 0, 0, 0, -1, -4, 1, 2, 3 };
+	const u8 *match = op - offset;
+	u8 *cpy = op + length;
+
+	if (offset >= 16) {
+		do {
+			lz4_x86_copy16(op, match);
+			op += 16;
+			match += 16;
+		} while (op < cpy);
+		return;
+	}
+
+	if (offset < 8) {
+		op[0] = match[0];
+		op[1] = match[1];
+		op[2] = match[2];
+		op[3] = match[3];
+		match += inc32[offset];
+		memcpy(op + 4, match, 4);
+		match -= dec64[offset];
+		op += 8;
+	}
+
+	while (op < cpy) {
+		lz4_x86_copy8(op, match);
+		op += 8;
+		match += 8;
+	}
+}
+
+/*
+ * Same contract as LZ4_decompress_safe(): returns the number of bytes
+ * written to @dst, or a negative value if @src is malformed or does not
+ * fit in @dst_cap bytes. Never reads or writes outside either buffer.
+ */
+static int lz4_x86_decompress_safe(const u8 *src, u8 *dst,
+				   unsigned int src_len, unsigned int dst_cap)
+{
+	const u8 *ip = src;
+	const u8 *const iend = src + src_len;
+	u8 *op = dst;
+	u8 *const oend = dst + dst_cap;
+
+	for (;;) {
+		unsigned int token;
+		size_t length, offset;
+
+		/* A block always ends with a literal run */
+		if (unlikely(ip >= iend))
+			return -EINVAL;
+
+		token = *ip++;
+
+		length = token >> 4;
+		if (length == 15 && lz4_x86_read_length(&ip, iend, &length))
+			return -EINVAL;
+
+		if (likely(iend - ip >= length + LZ4_X86_OVERRUN &&
+			   oend - op >= length + LZ4_X86_OVERRUN)) {
+			u8 *cpy = op + length;
+			u8 *d = op;
+			const u8 *s = ip;
+
+			while (d < cpy) {
+				lz4_x86_copy16(d, s);
+				d += 16;
+				s += 16;
+			}
+		} else {
+			if (length > iend - ip || length > oend - op)
+				return -EINVAL;
+			memcpy(op, ip, length);
+		}
+		ip += length;
+		op += length;
+
+		if (ip == iend)
+			break;
+
+		if (unlikely(iend - ip < 2))
+			return -EINVAL;
+		offset = get_unaligned_le16(ip);
+		ip += 2;
+		if (unlikely(!offset || offset > op - dst))
+			return -EINVAL;
+
+		length = token & 15;
+		if (length == 15 && lz4_x86_read_length(&ip, iend, &length))
+			return -EINVAL;
+		length += LZ4_X86_MINMATCH;
+
+		if (likely(oend - op >= length + LZ4_X86_OVERRUN)) {
+			lz4_x86_copy_match(op, offset, length);
+		} else {
+			const u8 *match = op - offset;
+			size_t i;
+
+			if (length > oend - op)
+				return -EINVAL;
+			/* Byte by byte, the match may overlap the output */
+			for (i = 0; i < length; i++)
+				op[i] = match[i];
+		}
+		op += length;
+	}
+
+	return op - dst;
+}
+
+static void *lz4_x86_alloc_ctx(struct crypto_scomp *tfm)
+{
+	void *ctx;
+
+	ctx = vmalloc(LZ4_MEM_COMPRESS);
+	if (!ctx)
+		return ERR_PTR(-ENOMEM);
+
+	return ctx;
+}
+
+static int lz4_x86_init(struct crypto_tfm *tfm)
+{
+	struct lz4_x86_ctx *ctx = crypto_tfm_ctx(tfm);
+
+	ctx->lz4_comp_mem = lz4_x86_alloc_ctx(NULL);
+	if (IS_ERR(ctx->lz4_comp_mem))
+		return -ENOMEM;
+
+	return 0;
+}
+
+static void lz4_x86_free_ctx(struct crypto_scomp *tfm, void *ctx)
+{
+	vfree(ctx);
+}
+
+static void lz4_x86_exit(struct crypto_tfm *tfm)
+{
+	struct lz4_x86_ctx *ctx = crypto_tfm_ctx(tfm);
+
+	lz4_x86_free_ctx(NULL, ctx->lz4_comp_mem);
+}
+
+static int __lz4_x86_compress(const u8 *src, unsigned int slen,
+			      u8 *dst, unsigned int *dlen, void *ctx)
+{
+	int out_len = LZ4_compress_default(src, dst, slen, *dlen, ctx);
+
+	if (!out_len)
+		return -EINVAL;
+
+	*dlen = out_len;
+	return 0;
+}
+
+static int __lz4_x86_decompress(const u8 *src, unsigned int slen,
+				u8 *dst, unsigned int *dlen)
+{
+	int out_len = lz4_x86_decompress_safe(src, dst, slen, *dlen);
+
+	if (out_len < 0)
+		return -EINVAL;
+
+	*dlen = out_len;
+	return 0;
+}
+
+static int lz4_x86_scompress(struct crypto_scomp *tfm, const u8 *src,
+			     unsigned int slen, u8 *dst, unsigned int *dlen,
+			     void *ctx)
+{
+	return __lz4_x86_compress(src, slen, dst, dlen, ctx);
+}
+
+static int lz4_x86_sdecompress(struct crypto_scomp *tfm, const u8 *src,
+			       unsigned int slen, u8 *dst, unsigned int *dlen,
+			       void *ctx)
+{
+	return __lz4_x86_decompress(src, slen, dst, dlen);
+}
+
+static int lz4_x86_compress_crypto(struct crypto_tfm *tfm, const u8 *src,
+				   unsigned int slen, u8 *dst,
+				   unsigned int *dlen)
+{
+	struct lz4_x86_ctx *ctx = crypto_tfm_ctx(tfm);
+
+	return __lz4_x86_compress(src, slen, dst, dlen, ctx->lz4_comp_mem);
+}
+
+static int lz4_x86_decompress_crypto(struct crypto_tfm *tfm, const u8 *src,
+				     unsigned int slen, u8 *dst,
+				     unsigned int *dlen)
+{
+	return __lz4_x86_decompress(src, slen, dst, dlen);
+}
+
+static struct crypto_alg alg_lz4_x86 = {
+	.cra_name		= "lz4",
+	.cra_driver_name	= "lz4-x86_64",
+	.cra_priority		= 200,
+	.cra_flags		= CRYPTO_ALG_TYPE_COMPRESS,
+	.cra_ctxsize		= sizeof(struct lz4_x86_ctx),
+	.cra_module		= THIS_MODULE,
+	.cra_list		= LIST_HEAD_INIT(alg_lz4_x86.cra_list),
+	.cra_init		= lz4_x86_init,
+	.cra_exit		= lz4_x86_exit,
+	.cra_u			= { .compress = {
+	.coa_compress		= lz4_x86_compress_crypto,
+	.coa_decompress		= lz4_x86_decompress_crypto } }
+};
+
+static struct scomp_alg scomp_lz4_x86 = {
+	.alloc_ctx		= lz4_x86_alloc_ctx,
+	.free_ctx		= lz4_x86_free_ctx,
+	.compress		= lz4_x86_scompress,
+	.decompress		= lz4_x86_sdecompress,
+	.base			= {
+		.cra_name	= "lz4",
+		.cra_driver_name = "lz4-x86_64-scomp",
+		.cra_priority	 = 200,
+		.cra_module	 = THIS_MODULE,
+	}
+};
+
+#define LZ4_X86_BENCH_LOOPS	10000
+
+/* Page of text-like data: short words from a small alphabet */
+static void __init lz4_x86_bench_fill(u8 *buf, size_t len)
+{
+	struct rnd_state rnd;
+	size_t i;
+
+	prandom_seed_state(&rnd, 0x6c7a34);
+	for (i = 0; i < len; i++) {
+		u32 r = prandom_u32_state(&rnd);
+
+		buf[i] = (r & 7) ? 'a' + (r >> 8) % 16 : ' ';
+	}
+}
+
+static u64 __init lz4_x86_bench_run(bool generic, const u8 *src,
+				    unsigned int slen, u8 *dst)
+{
+	u64 start = ktime_get_ns();
+	int i;
+
+	for (i = 0; i < LZ4_X86_BENCH_LOOPS; i++) {
+		if (generic)
+			LZ4_decompress_safe(src, dst, slen, PAGE_SIZE);
+		else
+			lz4_x86_decompress_safe(src, dst, slen, PAGE_SIZE);
+		cond_resched();
+	}
+
+	return ktime_get_ns() - start;
+}
+
+static int __init lz4_x86_bench(void)
+{
+	unsigned int clen = LZ4_compressBound(PAGE_SIZE);
+	u8 *page, *comp, *out;
+	void *wrkmem;
+	u64 t_gen, t_x86;
+	int ret = -ENOMEM;
+	int len;
+
+	page = kmalloc(PAGE_SIZE, GFP_KERNEL);
+	out = kmalloc(PAGE_SIZE, GFP_KERNEL);
+	comp = kmalloc(clen, GFP_KERNEL);
+	wrkmem = vmalloc(LZ4_MEM_COMPRESS);
+	if (!page || !out || !comp || !wrkmem)
+		goto out;
+
+	lz4_x86_bench_fill(page, PAGE_SIZE);
+	clen = LZ4_compress_default(page, comp, PAGE_SIZE, clen, wrkmem);
+
+	ret = -EINVAL;
+	len = lz4_x86_decompress_safe(comp, out, clen, PAGE_SIZE);
+	if (len != PAGE_SIZE || memcmp(page, out, PAGE_SIZE)) {
+		pr_err("benchmark page does not decompress back\n");
+		goto out;
+	}
+
+	t_gen = lz4_x86_bench_run(true, comp, clen, out);
+	t_x86 = lz4_x86_bench_run(false, comp, clen, out);
+	pr_info("%lu byte page from %u bytes: generic %llu ns, x86_64 %llu ns\n",
+		PAGE_SIZE, clen, div_u64(t_gen, LZ4_X86_BENCH_LOOPS),
+		div_u64(t_x86, LZ4_X86_BENCH_LOOPS));
+	ret = 0;
+
+out:
+	vfree(wrkmem);
+	kfree(comp);
+	kfree(out);
+	kfree(page);
+	return ret;
+}
+
+static int __init lz4_x86_mod_init(void)
+{
+	int ret;
+
+	if (bench) {
+		ret = lz4_x86_bench();
+		if (ret)
+			return ret;
+	}
+
+	ret = crypto_register_alg(&alg_lz4_x86);
+	if (ret)
+		return ret;
+
+	ret = crypto_register_scomp(&scomp_lz4_x86);
+	if (ret) {
+		crypto_unregister_alg(&alg_lz4_x86);
+		return ret;
+	}
+
+	return ret;
+}
+
+static void __exit lz4_x86_mod_fini(void)
+{
+	crypto_unregister_alg(&alg_lz4_x86);
+	crypto_unregister_scomp(&scomp_lz4_x86);
+}
+
+module_init(lz4_x86_mod_init);
+module_exit(lz4_x86_mod_fini);
+
+MODULE_LICENSE("GPL");
+MODULE_DESCRIPTION("LZ4 Compression Algorithm, x86_64 optimized decompressor");
+MODULE_ALIAS_CRYPTO("lz4");
+MODULE_ALIAS_CRYPTO("lz4-x86_64");
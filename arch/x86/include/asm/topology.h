@@ -155,6 +155,13 @@ extern unsigned int __read_mostly sysctl_sched_itmt_enabled;
 /* Interface to set priority of a cpu */
 void sched_set_itmt_core_prio(int prio, int core_cpu);
 
+/* Interface to set capacity of a cpu from its highest performance level */
+void sched_set_itmt_core_capacity(unsigned int highest_perf, int core_cpu);
+
+struct sched_domain;
+unsigned long arch_scale_cpu_capacity(struct sched_domain *sd, int cpu);
+#define arch_scale_cpu_capacity arch_scale_cpu_capacity
+
 /* Interface to notify scheduler that system supports ITMT */
 int sched_set_itmt_support(void);
 
@@ -167,6 +174,10 @@ void sched_clear_itmt_support(void);
 static inline void sched_set_itmt_core_prio(int prio, int core_cpu)
 {
 }
+static inline void sched_set_itmt_core_capacity(unsigned int highest_perf,
+						int core_cpu)
+{
+}
 static inline int sched_set_itmt_support(void)
 {
 	return 0;
@@ -21,15 +21,30 @@
  */
 
 #include <linux/sched.h>
+#include <linux/sched/topology.h>
 #include <linux/cpumask.h>
 #include <linux/cpuset.h>
 #include <linux/mutex.h>
 #include <linux/sysctl.h>
 #include <linux/nodemask.h>
+#include <linux/spinlock.h>
+#include <linux/workqueue.h>
 
 static DEFINE_MUTEX(itmt_update_mutex);
 DEFINE_PER_CPU_READ_MOSTLY(int, sched_core_priority);
 
+/*
+ * Capacity of each cpu relative to the fastest core in the system, derived
+ * from the highest performance level its pstate driver reports. Cores of
+ * different micro-architectures (e.g. Atom and Core) end up with different
+ * capacities, which lets the scheduler detect an asymmetric topology.
+ */
+static DEFINE_PER_CPU_READ_MOSTLY(unsigned long, sched_core_capacity) =
+	SCHED_CAPACITY_SCALE;
+static DEFINE_PER_CPU(unsigned int, sched_core_highest_perf);
+static unsigned int sched_max_highest_perf;
+static DEFINE_SPINLOCK(itmt_capacity_lock);
+
 /* Boolean to track if system has ITMT capabilities */
 static bool __read_mostly sched_itmt_capable;
 
@@ -210,3 +225,74 @@ void sched_set_itmt_core_prio(int prio, int core_cpu)
 		i++;
 	}
 }
+
+unsigned long arch_scale_cpu_capacity(struct sched_domain *sd, int cpu)
+{
+	unsigned long capacity = per_cpu(sched_core_capacity, cpu);
+
+	if (sd && (sd->flags & SD_SHARE_CPUCAPACITY) && (sd->span_weight > 1))
+		return (sd->smt_gain / sd->span_weight) * capacity >>
+			SCHED_CAPACITY_SHIFT;
+
+	return capacity;
+}
+
+static void sched_itmt_capacity_workfn(struct work_struct *work)
+{
+	mutex_lock(&itmt_update_mutex);
+	x86_topology_update = true;
+	rebuild_sched_domains();
+	mutex_unlock(&itmt_update_mutex);
+}
+
+static DECLARE_WORK(sched_itmt_capacity_work, sched_itmt_capacity_workfn);
+
+/**
+ * sched_set_itmt_core_capacity() - Set CPU capacity based on its highest perf
+ * @highest_perf:	Highest performance level of the cpu core
+ * @core_cpu:		The cpu number associated with the core
+ *
+ * The pstate driver calls this with the highest performance level it
+ * reads for each core. Capacities are scaled so that the fastest core
+ * seen so far gets SCHED_CAPACITY_SCALE, and SMT siblings share the
+ * capacity of their core.
+ *
+ * Unlike the priorities, capacities feed into the sched domain
+ * flags (SD_ASYM_CPUCAPACITY), so a rebuild is queued whenever one of
+ * them changes. This may be called under the cpu hotplug locks.
+ */
+void sched_set_itmt_core_capacity(unsigned int highest_perf, int core_cpu)
+{
+	unsigned long flags, capacity;
+	bool changed = false;
+	unsigned int perf;
+	int cpu;
+
+	if (!highest_perf)
+		return;
+
+	spin_lock_irqsave(&itmt_capacity_lock, flags);
+
+	for_each_cpu(cpu, topology_sibling_cpumask(core_cpu))
+		per_cpu(sched_core_highest_perf, cpu) = highest_perf;
+
+	if (highest_perf > sched_max_highest_perf)
+		sched_max_highest_perf = highest_perf;
+
+	for_each_possible_cpu(cpu) {
+		perf = per_cpu(sched_core_highest_perf, cpu);
+		if (!perf)
+			continue;
+
+		capacity = perf * SCHED_CAPACITY_SCALE / sched_max_highest_perf;
+		if (capacity != per_cpu(sched_core_capacity, cpu)) {
+			WRITE_ONCE(per_cpu(sched_core_capacity, cpu), capacity);
+			changed = true;
+		}
+	}
+
+	spin_unlock_irqrestore(&itmt_capacity_lock, flags);
+
+	if (changed)
+		schedule_work(&sched_itmt_capacity_work);
+}
@@ -427,6 +427,8 @@ static void bfq_cpd_init(struct blkcg_policy_data *cpd)
 
 	d->weight = cgroup_subsys_on_dfl(io_cgrp_subsys) ?
 		CGROUP_WEIGHT_DFL : BFQ_WEIGHT_LEGACY_DFL;
+	d->launch_hint = false;
+	d->depth_limit = 100;
 }
 
 static void bfq_cpd_free(struct blkcg_policy_data *cpd)
@@ -917,6 +919,89 @@ static ssize_t bfq_io_set_weight(struct kernfs_open_file *of,
 	return ret ?: nbytes;
 }
 
+/*
+ * Whether bfqq belongs to a group that userspace marked as hosting
+ * launching applications. Called with the scheduler lock held.
+ */
+bool bfq_bfqq_launch_hint(struct bfq_queue *bfqq)
+{
+	struct blkcg_gq *blkg = bfqg_to_blkg(bfqq_group(bfqq));
+	struct bfq_group_data *bfqgd;
+
+	if (!blkg)
+		return false;
+
+	bfqgd = blkcg_to_bfqgd(blkg->blkcg);
+	return bfqgd && READ_ONCE(bfqgd->launch_hint);
+}
+
+/*
+ * Per-word tag depth allowed to the blkio cgroup of the current task, or
+ * UINT_MAX if it is not limited. The limit never goes below the smallest
+ * depth computed in bfq_update_depths(), which the wake batch of the
+ * scheduler tags is sized for.
+ */
+unsigned int bfq_cgroup_depth_limit(struct bfq_data *bfqd)
+{
+	struct bfq_group_data *bfqgd;
+	unsigned int limit = 100;
+
+	rcu_read_lock();
+	bfqgd = blkcg_to_bfqgd(css_to_blkcg(task_css(current, io_cgrp_id)));
+	if (bfqgd)
+		limit = READ_ONCE(bfqgd->depth_limit);
+	rcu_read_unlock();
+
+	if (limit >= 100)
+		return UINT_MAX;
+
+	return max(bfqd->word_depth * limit / 100, bfqd->word_depths[1][0]);
+}
+
+static u64 bfq_io_read_launch_hint(struct cgroup_subsys_state *css,
+				   struct cftype *cft)
+{
+	struct bfq_group_data *bfqgd = blkcg_to_bfqgd(css_to_blkcg(css));
+
+	return bfqgd ? bfqgd->launch_hint : 0;
+}
+
+static int bfq_io_write_launch_hint(struct cgroup_subsys_state *css,
+				    struct cftype *cft, u64 val)
+{
+	struct bfq_group_data *bfqgd = blkcg_to_bfqgd(css_to_blkcg(css));
+
+	if (!bfqgd)
+		return -ENODEV;
+	if (val > 1)
+		return -ERANGE;
+
+	WRITE_ONCE(bfqgd->launch_hint, val);
+	return 0;
+}
+
+static u64 bfq_io_read_depth_limit(struct cgroup_subsys_state *css,
+				   struct cftype *cft)
+{
+	struct bfq_group_data *bfqgd = blkcg_to_bfqgd(css_to_blkcg(css));
+
+	return bfqgd ? bfqgd->depth_limit : 100;
+}
+
+static int bfq_io_write_depth_limit(struct cgroup_subsys_state *css,
+				    struct cftype *cft, u64 val)
+{
+	struct bfq_group_data *bfqgd = blkcg_to_bfqgd(css_to_blkcg(css));
+
+	if (!bfqgd)
+		return -ENODEV;
+	if (val < 1 || val > 100)
+		return -ERANGE;
+
+	WRITE_ONCE(bfqgd->depth_limit, val);
+	return 0;
+}
+
 #ifdef CONFIG_DEBUG_BLK_CGROUP
 static int bfqg_print_stat(struct seq_file *sf, void *v)
 {
@@ -1058,6 +1143,18 @@ struct cftype bfq_blkcg_legacy_files[] = {
 		.seq_show = bfq_io_show_weight,
 		.write_u64 = bfq_io_set_weight_legacy,
 	},
+	{
+		.name = "bfq.launch_hint",
+		.flags = CFTYPE_NOT_ON_ROOT,
+		.read_u64 = bfq_io_read_launch_hint,
+		.write_u64 = bfq_io_write_launch_hint,
+	},
+	{
+		.name = "bfq.depth_limit",
+		.flags = CFTYPE_NOT_ON_ROOT,
+		.read_u64 = bfq_io_read_depth_limit,
+		.write_u64 = bfq_io_write_depth_limit,
+	},
 
 	/* statistics, covers only the tasks in the bfqg */
 	{
@@ -1178,6 +1275,18 @@ struct cftype bfq_blkg_files[] = {
 		.seq_show = bfq_io_show_weight,
 		.write = bfq_io_set_weight,
 	},
+	{
+		.name = "bfq.launch_hint",
+		.flags = CFTYPE_NOT_ON_ROOT,
+		.read_u64 = bfq_io_read_launch_hint,
+		.write_u64 = bfq_io_write_launch_hint,
+	},
+	{
+		.name = "bfq.depth_limit",
+		.flags = CFTYPE_NOT_ON_ROOT,
+		.read_u64 = bfq_io_read_depth_limit,
+		.write_u64 = bfq_io_write_depth_limit,
+	},
 	{} /* terminate */
 };
 
@@ -1216,6 +1325,16 @@ struct bfq_group *bfqq_group(struct bfq_queue *bfqq)
 	return bfqq->bfqd->root_group;
 }
 
+bool bfq_bfqq_launch_hint(struct bfq_queue *bfqq)
+{
+	return false;
+}
+
+unsigned int bfq_cgroup_depth_limit(struct bfq_data *bfqd)
+{
+	return UINT_MAX;
+}
+
 struct bfq_group *bfq_create_group_hierarchy(struct bfq_data *bfqd, int node)
 {
 	struct bfq_group *bfqg;
@@ -530,12 +530,18 @@ static struct request *bfq_choose_req(struct bfq_data *bfqd,
 static void bfq_limit_depth(unsigned int op, struct blk_mq_alloc_data *data)
 {
 	struct bfq_data *bfqd = data->q->elevator->elevator_data;
+	unsigned int limit = bfq_cgroup_depth_limit(bfqd);
 
-	if (op_is_sync(op) && !op_is_write(op))
+	if (op_is_sync(op) && !op_is_write(op)) {
+		/* only background groups may be limited for sync reads */
+		if (limit != UINT_MAX)
+			data->shallow_depth = limit;
 		return;
+	}
 
 	data->shallow_depth =
-		bfqd->word_depths[!!bfqd->wr_busy_queues][op_is_sync(op)];
+		min(limit,
+		    bfqd->word_depths[!!bfqd->wr_busy_queues][op_is_sync(op)]);
 
 	bfq_log(bfqd, "[%s] wr_busy %d sync %d depth %u",
 			__func__, bfqd->wr_busy_queues, op_is_sync(op),
@@ -1539,7 +1545,7 @@ static void bfq_bfqq_handle_idle_busy_switch(struct bfq_data *bfqd,
 					     bool *interactive)
 {
 	bool soft_rt, in_burst,	wr_or_deserves_wr,
-		bfqq_wants_to_preempt,
+		bfqq_wants_to_preempt, launch_hint,
 		idle_for_long_time = bfq_bfqq_idle_for_long_time(bfqd, bfqq),
 		/*
 		 * See the comments on
@@ -1557,13 +1563,18 @@ static void bfq_bfqq_handle_idle_busy_switch(struct bfq_data *bfqd,
 	 * - it does not belong to a large burst,
 	 * - it has been idle for enough time or is soft real-time,
 	 * - is linked to a bfq_io_cq (it is not shared in any sense).
+	 * Queues of a group hinted by userspace as launching applications
+	 * are deemed interactive without waiting for the heuristics: an
+	 * application start-up is precisely the kind of large burst that
+	 * the heuristics refrain from weight-raising.
 	 */
 	in_burst = bfq_bfqq_in_large_burst(bfqq);
+	launch_hint = bfq_bfqq_launch_hint(bfqq);
 	soft_rt = bfqd->bfq_wr_max_softrt_rate > 0 &&
 		!in_burst &&
 		time_is_before_jiffies(bfqq->soft_rt_next_start) &&
 		bfqq->dispatched == 0;
-	*interactive = !in_burst && idle_for_long_time;
+	*interactive = launch_hint || (!in_burst && idle_for_long_time);
 	wr_or_deserves_wr = bfqd->low_latency &&
 		(bfqq->wr_coeff > 1 ||
 		 (bfq_bfqq_sync(bfqq) &&
@@ -1687,10 +1698,12 @@ static void bfq_add_request(struct request *rq)
 		bfq_bfqq_handle_idle_busy_switch(bfqd, bfqq, old_wr_coeff,
 						 rq, &interactive);
 	else {
-		if (bfqd->low_latency && old_wr_coeff == 1 && !rq_is_sync(rq) &&
-		    time_is_before_jiffies(
+		if (bfqd->low_latency && old_wr_coeff == 1 &&
+		    ((!rq_is_sync(rq) &&
+		      time_is_before_jiffies(
 				bfqq->last_wr_start_finish +
-				bfqd->bfq_wr_min_inter_arr_async)) {
+				bfqd->bfq_wr_min_inter_arr_async)) ||
+		     bfq_bfqq_launch_hint(bfqq))) {
 			bfqq->wr_coeff = bfqd->bfq_wr_coeff;
 			bfqq->wr_cur_max_time = bfq_wr_duration(bfqd);
 
@@ -5185,6 +5198,8 @@ static unsigned int bfq_update_depths(struct bfq_data *bfqd,
 {
 	unsigned int i, j, min_shallow = UINT_MAX;
 
+	bfqd->word_depth = 1U << bt->sb.shift;
+
 	/*
 	 * In-word depths if no bfq_queue is being weight-raised:
 	 * leaving 25% of tags only for sync reads.
@@ -634,6 +634,8 @@ struct bfq_data {
 	 * function)
 	 */
 	unsigned int word_depths[2][2];
+	/* number of tags in an sbitmap word of the scheduler tags */
+	unsigned int word_depth;
 };
 
 enum bfqq_state_flags {
@@ -734,12 +736,20 @@ struct bfqg_stats {
  *
  * @ps: @blkcg_policy_storage that this structure inherits
  * @weight: weight of the bfq_group
+ * @launch_hint: userspace hint that the group hosts launching
+ *               applications, whose queues are weight-raised as
+ *               interactive as soon as they get busy
+ * @depth_limit: percentage of the scheduler tags that the tasks of the
+ *               group may allocate (from each sbitmap word), 100 for no
+ *               limit beyond the ones set in bfq_limit_depth()
  */
 struct bfq_group_data {
 	/* must be the first member */
 	struct blkcg_policy_data pd;
 
 	unsigned int weight;
+	bool launch_hint;
+	unsigned int depth_limit;
 };
 
 /**
@@ -866,6 +876,8 @@ struct blkcg_gq *bfqg_to_blkg(struct bfq_group *bfqg);
 struct bfq_group *bfqq_group(struct bfq_queue *bfqq);
 struct bfq_group *bfq_create_group_hierarchy(struct bfq_data *bfqd, int node);
 void bfqg_and_blkg_put(struct bfq_group *bfqg);
+bool bfq_bfqq_launch_hint(struct bfq_queue *bfqq);
+unsigned int bfq_cgroup_depth_limit(struct bfq_data *bfqd);
 
 #ifdef CONFIG_BFQ_GROUP_IOSCHED
 extern struct cftype bfq_blkcg_legacy_files[];
@@ -83,6 +83,9 @@ static char *check[] = {
 static u32 block_sizes[] = { 16, 64, 256, 1024, 8192, 0 };
 static u32 aead_sizes[] = { 16, 64, 256, 512, 1024, 2048, 4096, 8192, 0 };
 
+/* Sizes of the requests issued by dm-crypt and fscrypt, one per sector */
+static u32 sector_sizes[] = { 512, 4096, 0 };
+
 #define XBUFSIZE 8
 #define MAX_IVLEN 32
 
@@ -1489,7 +1492,8 @@ static int test_acipher_cycles(struct skcipher_request *req, int enc,
 
 static void test_skcipher_speed(const char *algo, int enc, unsigned int secs,
 				struct cipher_speed_template *template,
-				unsigned int tcount, u8 *keysize, bool async)
+				unsigned int tcount, u8 *keysize, u32 *bsizes,
+				bool async)
 {
 	unsigned int ret, i, j, k, iv_len;
 	struct crypto_wait wait;
@@ -1530,7 +1534,7 @@ static void test_skcipher_speed(const char *algo, int enc, unsigned int secs,
 
 	i = 0;
 	do {
-		b_size = block_sizes;
+		b_size = bsizes;
 
 		do {
 			struct scatterlist sg[TVMEMSIZE];
@@ -1622,7 +1626,7 @@ static void test_acipher_speed(const char *algo, int enc, unsigned int secs,
 			       unsigned int tcount, u8 *keysize)
 {
 	return test_skcipher_speed(algo, enc, secs, template, tcount, keysize,
-				   true);
+				   block_sizes, true);
 }
 
 static void test_cipher_speed(const char *algo, int enc, unsigned int secs,
@@ -1630,7 +1634,21 @@ static void test_cipher_speed(const char *algo, int enc, unsigned int secs,
 			      unsigned int tcount, u8 *keysize)
 {
 	return test_skcipher_speed(algo, enc, secs, template, tcount, keysize,
-				   false);
+				   block_sizes, false);
+}
+
+/*
+ * Mode 218 allocates without CRYPTO_ALG_ASYNC, so it measures what a
+ * synchronous user gets: the generic xts template over a synchronous
+ * ecb(aes), e.g. xts(ecb-aes-aesni) on x86. Mode 510 gets the same
+ * asynchronous driver dm-crypt and fscrypt end up with, e.g. xts-aes-aesni.
+ */
+static void test_sector_speed(const char *algo, int enc, unsigned int secs,
+			      struct cipher_speed_template *template,
+			      unsigned int tcount, u8 *keysize, bool async)
+{
+	return test_skcipher_speed(algo, enc, secs, template, tcount, keysize,
+				   sector_sizes, async);
 }
 
 static void test_available(void)
@@ -2282,6 +2300,13 @@ static int do_test(const char *alg, u32 type, u32 mask, int m, u32 num_mb)
 				   num_mb);
 		break;
 
+	case 218:
+		test_sector_speed("xts(aes)", ENCRYPT, sec, NULL, 0,
+				  speed_template_32_64, false);
+		test_sector_speed("xts(aes)", DECRYPT, sec, NULL, 0,
+				  speed_template_32_64, false);
+		break;
+
 	case 300:
 		if (alg) {
 			test_hash_speed(alg, sec, generic_hash_speed_template);
@@ -2720,6 +2745,13 @@ static int do_test(const char *alg, u32 type, u32 mask, int m, u32 num_mb)
 				   speed_template_8_32);
 		break;
 
+	case 510:
+		test_sector_speed("xts(aes)", ENCRYPT, sec, NULL, 0,
+				  speed_template_32_64, true);
+		test_sector_speed("xts(aes)", DECRYPT, sec, NULL, 0,
+				  speed_template_32_64, true);
+		break;
+
 	case 600:
 		test_mb_skcipher_speed("ecb(aes)", ENCRYPT, sec, NULL, 0,
 				       speed_template_16_24_32, num_mb);
@@ -61,6 +61,9 @@
 #include <linux/module.h>
 #include <linux/major.h>
 #include <linux/miscdevice.h>
+#include <linux/mm.h>
+#include <linux/splice.h>
+#include <linux/uio.h>
 
 #include "sbuf.h"
 
@@ -171,14 +174,15 @@ static int acrn_hvlog_release(struct inode *inode, struct file *filp)
 	return 0;
 }
 
-static ssize_t acrn_hvlog_read(struct file *filp, char __user *buf,
-				size_t count, loff_t *offset)
+static ssize_t acrn_hvlog_read_iter(struct kiocb *iocb, struct iov_iter *to)
 {
-	char data[LOG_ENTRY_SIZE];
 	struct acrn_hvlog *acrn_hvlog;
-	int ret;
+	shared_buf_t *sbuf;
+	const void *data;
+	size_t count, copied = 0;
+	uint32_t len;
 
-	acrn_hvlog = (struct acrn_hvlog *)filp->private_data;
+	acrn_hvlog = (struct acrn_hvlog *)iocb->ki_filp->private_data;
 
 	pr_debug("%s, %s\n", __func__, acrn_hvlog->miscdev.name);
 
@@ -188,14 +192,55 @@ static ssize_t acrn_hvlog_read(struct file *filp, char __user *buf,
 		return -EIO;
 	}
 
-	if (acrn_hvlog->sbuf != NULL) {
-		ret = sbuf_get(acrn_hvlog->sbuf, (uint8_t *)&data);
-		if (ret > 0) {
-			if (copy_to_user(buf, &data, ret))
-				return -EFAULT;
-		}
+	sbuf = acrn_hvlog->sbuf;
+	if (sbuf == NULL)
+		return 0;
+
+	/* Only whole entries are returned */
+	count = rounddown(iov_iter_count(to), sbuf->ele_size);
+	if (!count)
+		return -EINVAL;
+
+	/* Copy whole spans of entries straight out of the shared buffer */
+	while (copied < count) {
+		len = min_t(size_t, sbuf_peek(sbuf, &data), count - copied);
+		if (!len)
+			break;
+
+		if (copy_to_iter(data, len, to) != len)
+			return copied ? copied : -EFAULT;
 
-		return ret;
+		sbuf_commit(sbuf, len);
+		copied += len;
+	}
+
+	return copied;
+}
+
+/*
+ * Map the whole sbuf, header included. The consumer follows the same
+ * protocol as sbuf_get(): read entries between head and tail, then store
+ * the new head in the header.
+ */
+static int acrn_hvlog_mmap(struct file *filp, struct vm_area_struct *vma)
+{
+	struct acrn_hvlog *acrn_hvlog = filp->private_data;
+	unsigned long len = vma->vm_end - vma->vm_start;
+	shared_buf_t *sbuf = acrn_hvlog->sbuf;
+	phys_addr_t paddr;
+
+	if (sbuf == NULL)
+		return -ENXIO;
+
+	paddr = virt_to_phys(sbuf);
+	if (!PAGE_ALIGNED(paddr) || vma->vm_pgoff ||
+	    len > PAGE_ALIGN(SBUF_HEAD_SIZE + sbuf->size))
+		return -EINVAL;
+
+	if (remap_pfn_range(vma, vma->vm_start, paddr >> PAGE_SHIFT, len,
+			    vma->vm_page_prot)) {
+		pr_err("Failed to mmap %s\n", acrn_hvlog->miscdev.name);
+		return -EAGAIN;
 	}
 
 	return 0;
@@ -205,7 +250,9 @@ static const struct file_operations acrn_hvlog_fops = {
 	.owner  = THIS_MODULE,
 	.open   = acrn_hvlog_open,
 	.release = acrn_hvlog_release,
-	.read = acrn_hvlog_read,
+	.read_iter = acrn_hvlog_read_iter,
+	.splice_read = generic_file_splice_read,
+	.mmap = acrn_hvlog_mmap,
 };
 
 static struct acrn_hvlog acrn_hvlog_devs[ACRN_HVLOG_TYPE][PCPU_NRS] = {
@@ -56,12 +56,21 @@
 
 #define pr_fmt(fmt) "ACRNTrace: " fmt
 
+#include <linux/debugfs.h>
 #include <linux/kernel.h>
 #include <linux/module.h>
 #include <linux/major.h>
 #include <linux/miscdevice.h>
 #include <linux/fs.h>
+#include <linux/log2.h>
+#include <linux/math64.h>
 #include <linux/mm.h>
+#include <linux/mutex.h>
+#include <linux/poll.h>
+#include <linux/seq_file.h>
+#include <linux/slab.h>
+#include <linux/wait.h>
+#include <linux/workqueue.h>
 
 #include <asm/hypervisor.h>
 
@@ -70,7 +79,7 @@
 
 #define TRACE_SBUF_SIZE		(4 * 1024 * 1024)
 #define TRACE_ELEMENT_SIZE	32 /* byte */
-#define TRACE_ELEMENT_NUM	((TRACE_SBUF_SIZE - SBUF_HEAD_SIZE) /	\
+#define TRACE_ELEMENT_NUM(size)	(((size) - SBUF_HEAD_SIZE) /		\
 				TRACE_ELEMENT_SIZE)
 
 #define foreach_cpu(cpu, cpu_num)					\
@@ -83,8 +92,326 @@ static int pcpu_num;
 static int nr_cpus = MAX_NR_CPUS;
 module_param(nr_cpus, int, S_IRUSR | S_IWUSR);
 
+/*
+ * The hypervisor doesn't notify us when it adds trace entries, so poll()
+ * is driven by a periodic worker that wakes readers once their buffer is
+ * filled past the watermark. The same worker keeps the overflow
+ * statistics and grows buffers that keep overflowing.
+ */
+static unsigned int poll_watermark = 25;
+module_param(poll_watermark, uint, 0644);
+MODULE_PARM_DESC(poll_watermark,
+		 "Buffer fill level in percent that makes a trace device readable");
+
+static unsigned int poll_interval_ms = 100;
+module_param(poll_interval_ms, uint, 0644);
+MODULE_PARM_DESC(poll_interval_ms,
+		 "Interval in ms at which buffer fill levels are checked");
+
+static unsigned int buf_size = TRACE_SBUF_SIZE;
+module_param(buf_size, uint, 0444);
+MODULE_PARM_DESC(buf_size, "Initial size in bytes of each per-cpu buffer");
+
+static unsigned int grow_threshold;
+module_param(grow_threshold, uint, 0644);
+MODULE_PARM_DESC(grow_threshold,
+		 "Dropped entries after which a closed buffer is doubled, 0 to disable");
+
+/*
+ * With aggregate set, the worker decodes the entries of every buffer whose
+ * device isn't open and keeps VM-exit counts and latency histograms, so
+ * exit overhead can be watched without exporting the raw trace. Opening a
+ * device hands its buffer back to the reader.
+ */
+static bool aggregate;
+module_param(aggregate, bool, 0444);
+MODULE_PARM_DESC(aggregate,
+		 "Aggregate VM-exit statistics in debugfs while devices are closed");
+
+/* Entry layout and event ids as written by the hypervisor */
+#define TRACE_ID_MASK		((1ULL << 48) - 1)
+#define TRACE_VM_EXIT		0x10
+#define TRACE_VM_ENTER		0x11
+
+struct acrn_trace_entry {
+	u64 tsc;
+	u64 id;
+	u64 data[2];
+};
+
+/* Basic VMX exit reasons, EXIT_REASON_XRSTORS is the last one */
+#define TRACE_NR_EXIT_REASONS	65
+/* Exit latency in TSC cycles, log2 buckets from 256 cycles up */
+#define TRACE_HIST_SHIFT	8
+#define TRACE_HIST_BUCKETS	16
+
+struct acrn_exit_stats {
+	u64 count;
+	u64 cycles;
+	u64 hist[TRACE_HIST_BUCKETS];
+};
+
+struct acrn_exit_agg {
+	struct acrn_exit_stats reason[TRACE_NR_EXIT_REASONS];
+	u64 unknown;
+	u64 exit_tsc;
+	u32 exit_reason;
+	bool in_exit;
+};
+
+/* Counters are in entries, high_water in bytes */
+struct acrn_trace_stats {
+	u64 consumed;
+	u64 dropped;
+	u64 dropped_at_grow;
+	u32 high_water;
+	u32 last_head;
+	u32 last_overrun;
+};
+
 static atomic_t open_cnt[MAX_NR_CPUS];
 static shared_buf_t *sbuf_per_cpu[MAX_NR_CPUS];
+static wait_queue_head_t trace_wq[MAX_NR_CPUS];
+static struct acrn_trace_stats trace_stats[MAX_NR_CPUS];
+static struct acrn_exit_agg *exit_agg;
+static struct dentry *trace_debugfs_dir;
+
+/*
+ * Serializes open() against the worker replacing or aggregating a buffer,
+ * and protects exit_agg
+ */
+static DEFINE_MUTEX(trace_lock);
+
+static void acrn_trace_work_fn(struct work_struct *work);
+static DECLARE_DELAYED_WORK(trace_work, acrn_trace_work_fn);
+
+/* Open trace devices, serializes arming and cancelling trace_work */
+static int nr_readers;
+static DEFINE_MUTEX(trace_work_lock);
+
+/*
+ * The worker only runs while a reader may be waiting in poll(), or while
+ * closed buffers are aggregated or grown.
+ */
+static bool acrn_trace_work_needed(void)
+{
+	return READ_ONCE(nr_readers) || exit_agg || READ_ONCE(grow_threshold);
+}
+
+static bool acrn_trace_ready(int cpuid)
+{
+	shared_buf_t *sbuf = sbuf_per_cpu[cpuid];
+	uint64_t mark = (uint64_t)sbuf->size *
+			min(READ_ONCE(poll_watermark), 100U) / 100;
+
+	return sbuf_used(sbuf) >= max_t(uint64_t, mark, sbuf->ele_size);
+}
+
+static shared_buf_t *acrn_trace_sbuf_alloc(uint32_t size)
+{
+	shared_buf_t *sbuf;
+
+	sbuf = sbuf_allocate(TRACE_ELEMENT_NUM(size), TRACE_ELEMENT_SIZE);
+	if (sbuf)
+		sbuf_add_flags(sbuf, OVERRUN_CNT_EN);
+
+	return sbuf;
+}
+
+static void acrn_trace_sample(int cpu)
+{
+	struct acrn_trace_stats *st = &trace_stats[cpu];
+	shared_buf_t *sbuf = sbuf_per_cpu[cpu];
+	uint32_t head = READ_ONCE(sbuf->head);
+	uint32_t overrun = READ_ONCE(sbuf->overrun_cnt);
+	uint32_t used = sbuf_used(sbuf);
+
+	/* This misses whole laps of the consumer between two samples */
+	st->consumed += ((head + sbuf->size - st->last_head) % sbuf->size) /
+			sbuf->ele_size;
+	st->last_head = head;
+	st->dropped += overrun - st->last_overrun;
+	st->last_overrun = overrun;
+	st->high_water = max(st->high_water, used);
+}
+
+/*
+ * Replace the buffer of a cpu by one twice the size. Only done while the
+ * device is closed, as the old buffer may be mapped by the reader, and
+ * entries still in the old buffer are counted as dropped.
+ */
+static void acrn_trace_grow(int cpu)
+{
+	struct acrn_trace_stats *st = &trace_stats[cpu];
+	shared_buf_t *old = sbuf_per_cpu[cpu], *new;
+	uint32_t size = SBUF_HEAD_SIZE + old->size;
+
+	if (size * 2 > TRACE_SBUF_SIZE)
+		return;
+
+	mutex_lock(&trace_lock);
+	if (atomic_read(&open_cnt[cpu]))
+		goto out;
+
+	new = acrn_trace_sbuf_alloc(size * 2);
+	if (!new)
+		goto out;
+	if (sbuf_share_setup(cpu, ACRN_TRACE, new) < 0) {
+		sbuf_free(new);
+		goto out;
+	}
+
+	acrn_trace_sample(cpu);
+	st->dropped += sbuf_used(old) / old->ele_size;
+	st->dropped_at_grow = st->dropped;
+	st->last_head = 0;
+	st->last_overrun = 0;
+	if (exit_agg)
+		exit_agg[cpu].in_exit = false;
+	sbuf_per_cpu[cpu] = new;
+	sbuf_free(old);
+	pr_info("grew SBuf of cpu%d to %u bytes\n", cpu, size * 2);
+out:
+	mutex_unlock(&trace_lock);
+}
+
+static void acrn_trace_decode(struct acrn_exit_agg *agg,
+			      const struct acrn_trace_entry *e)
+{
+	struct acrn_exit_stats *rs;
+	u64 delta;
+	int bucket;
+
+	switch (e->id & TRACE_ID_MASK) {
+	case TRACE_VM_EXIT:
+		agg->exit_reason = (u32)e->data[0];
+		agg->exit_tsc = e->tsc;
+		agg->in_exit = true;
+		break;
+	case TRACE_VM_ENTER:
+		/* An exit lost to an overrun leaves nothing to match */
+		if (!agg->in_exit)
+			break;
+		agg->in_exit = false;
+		if (agg->exit_reason >= TRACE_NR_EXIT_REASONS) {
+			agg->unknown++;
+			break;
+		}
+		rs = &agg->reason[agg->exit_reason];
+		delta = e->tsc - agg->exit_tsc;
+		rs->count++;
+		rs->cycles += delta;
+		bucket = delta ? ilog2(delta) - TRACE_HIST_SHIFT : 0;
+		rs->hist[clamp(bucket, 0, TRACE_HIST_BUCKETS - 1)]++;
+		break;
+	}
+}
+
+static void acrn_trace_aggregate(int cpu)
+{
+	const struct acrn_trace_entry *e;
+	shared_buf_t *sbuf;
+	const void *data;
+	uint32_t len, off;
+
+	mutex_lock(&trace_lock);
+	if (atomic_read(&open_cnt[cpu])) {
+		/* The reader sees entries we never did */
+		exit_agg[cpu].in_exit = false;
+		goto out;
+	}
+
+	sbuf = sbuf_per_cpu[cpu];
+	while ((len = sbuf_peek(sbuf, &data)) >= sizeof(*e)) {
+		len = rounddown(len, sbuf->ele_size);
+		for (off = 0; off < len; off += sbuf->ele_size) {
+			e = data + off;
+			acrn_trace_decode(&exit_agg[cpu], e);
+		}
+		sbuf_commit(sbuf, len);
+	}
+out:
+	mutex_unlock(&trace_lock);
+}
+
+static void acrn_trace_work_fn(struct work_struct *work)
+{
+	unsigned int threshold = READ_ONCE(grow_threshold);
+	int cpu;
+
+	foreach_cpu(cpu, pcpu_num) {
+		if (exit_agg)
+			acrn_trace_aggregate(cpu);
+
+		acrn_trace_sample(cpu);
+
+		if (atomic_read(&open_cnt[cpu]) &&
+		    wq_has_sleeper(&trace_wq[cpu]) && acrn_trace_ready(cpu))
+			wake_up_interruptible(&trace_wq[cpu]);
+
+		if (threshold && trace_stats[cpu].dropped -
+				 trace_stats[cpu].dropped_at_grow >= threshold)
+			acrn_trace_grow(cpu);
+	}
+
+	if (acrn_trace_work_needed())
+		schedule_delayed_work(&trace_work,
+			msecs_to_jiffies(max(READ_ONCE(poll_interval_ms), 1U)));
+}
+
+static int acrn_trace_stats_show(struct seq_file *m, void *unused)
+{
+	struct acrn_trace_stats *st;
+	shared_buf_t *sbuf;
+	uint32_t used;
+	int cpu;
+
+	mutex_lock(&trace_lock);
+	foreach_cpu(cpu, pcpu_num) {
+		st = &trace_stats[cpu];
+		sbuf = sbuf_per_cpu[cpu];
+		used = sbuf_used(sbuf);
+		seq_printf(m,
+			   "cpu%d: size %u used %u high_water %u produced %llu consumed %llu dropped %llu\n",
+			   cpu, sbuf->size, used, st->high_water,
+			   st->consumed + st->dropped + used / sbuf->ele_size,
+			   st->consumed, st->dropped);
+	}
+	mutex_unlock(&trace_lock);
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(acrn_trace_stats);
+
+static int acrn_trace_exits_show(struct seq_file *m, void *unused)
+{
+	struct acrn_exit_stats *rs;
+	int cpu, reason, i;
+
+	seq_printf(m, "# cpu reason count avg_cycles hist(%u << n cycles)\n",
+		   1U << TRACE_HIST_SHIFT);
+
+	mutex_lock(&trace_lock);
+	foreach_cpu(cpu, pcpu_num) {
+		for (reason = 0; reason < TRACE_NR_EXIT_REASONS; reason++) {
+			rs = &exit_agg[cpu].reason[reason];
+			if (!rs->count)
+				continue;
+			seq_printf(m, "cpu%d %2d %llu %llu", cpu, reason,
+				   rs->count, div64_u64(rs->cycles, rs->count));
+			for (i = 0; i < TRACE_HIST_BUCKETS; i++)
+				seq_printf(m, " %llu", rs->hist[i]);
+			seq_putc(m, '\n');
+		}
+		if (exit_agg[cpu].unknown)
+			seq_printf(m, "cpu%d unknown %llu\n", cpu,
+				   exit_agg[cpu].unknown);
+	}
+	mutex_unlock(&trace_lock);
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(acrn_trace_exits);
 
 static inline int get_id_from_devname(struct file *filep)
 {
@@ -123,10 +450,19 @@ static int acrn_trace_open(struct inode *inode, struct file *filep)
 		return -ENXIO;
 
 	/* More than one reader at the same time could get data messed up */
-	if (atomic_read(&open_cnt[cpuid]))
+	mutex_lock(&trace_lock);
+	if (atomic_read(&open_cnt[cpuid])) {
+		mutex_unlock(&trace_lock);
 		return -EBUSY;
+	}
 
 	atomic_inc(&open_cnt[cpuid]);
+	mutex_unlock(&trace_lock);
+
+	mutex_lock(&trace_work_lock);
+	WRITE_ONCE(nr_readers, nr_readers + 1);
+	schedule_delayed_work(&trace_work, 0);
+	mutex_unlock(&trace_work_lock);
 
 	return 0;
 }
@@ -141,9 +477,27 @@ static int acrn_trace_release(struct inode *inode, struct file *filep)
 
 	atomic_dec(&open_cnt[cpuid]);
 
+	mutex_lock(&trace_work_lock);
+	WRITE_ONCE(nr_readers, nr_readers - 1);
+	if (!acrn_trace_work_needed())
+		cancel_delayed_work_sync(&trace_work);
+	mutex_unlock(&trace_work_lock);
+
 	return 0;
 }
 
+static __poll_t acrn_trace_poll(struct file *filep, poll_table *wait)
+{
+	int cpuid = get_id_from_devname(filep);
+
+	if (cpuid < 0)
+		return EPOLLERR;
+
+	poll_wait(filep, &trace_wq[cpuid], wait);
+
+	return acrn_trace_ready(cpuid) ? (EPOLLIN | EPOLLRDNORM) : 0;
+}
+
 static int acrn_trace_mmap(struct file *filep, struct vm_area_struct *vma)
 {
 	int cpuid = get_id_from_devname(filep);
@@ -172,6 +526,7 @@ static const struct file_operations acrn_trace_fops = {
 	.open   = acrn_trace_open,
 	.release = acrn_trace_release,
 	.mmap   = acrn_trace_mmap,
+	.poll   = acrn_trace_poll,
 };
 
 static struct miscdevice acrn_trace_dev0 = {
@@ -226,11 +581,19 @@ static int __init acrn_trace_init(void)
 		return -EINVAL;
 	}
 	pcpu_num = nr_cpus;
+	buf_size = clamp_t(uint32_t, buf_size, PAGE_SIZE, TRACE_SBUF_SIZE);
+
+	if (aggregate) {
+		exit_agg = kcalloc(pcpu_num, sizeof(*exit_agg), GFP_KERNEL);
+		if (!exit_agg)
+			return -ENOMEM;
+	}
 
 	foreach_cpu(cpu, pcpu_num) {
+		init_waitqueue_head(&trace_wq[cpu]);
+
 		/* allocate shared_buf */
-		sbuf_per_cpu[cpu] = sbuf_allocate(TRACE_ELEMENT_NUM,
-							TRACE_ELEMENT_SIZE);
+		sbuf_per_cpu[cpu] = acrn_trace_sbuf_alloc(buf_size);
 		if (!sbuf_per_cpu[cpu]) {
 			pr_err("Failed alloc SBuf, cpuid %d\n", cpu);
 			ret = -ENOMEM;
@@ -255,6 +618,15 @@ static int __init acrn_trace_init(void)
 		}
 	}
 
+	trace_debugfs_dir = debugfs_create_dir("acrn_trace", NULL);
+	debugfs_create_file("stats", 0444, trace_debugfs_dir, NULL,
+			    &acrn_trace_stats_fops);
+	if (exit_agg)
+		debugfs_create_file("exits", 0444, trace_debugfs_dir, NULL,
+				    &acrn_trace_exits_fops);
+	if (acrn_trace_work_needed())
+		schedule_delayed_work(&trace_work, 0);
+
 	return ret;
 
 out_dereg:
@@ -270,6 +642,7 @@ static int __init acrn_trace_init(void)
 out_free:
 	for (i = --cpu; i >= 0; i--)
 		sbuf_free(sbuf_per_cpu[i]);
+	kfree(exit_agg);
 
 	return ret;
 }
@@ -286,13 +659,18 @@ static void __exit acrn_trace_exit(void)
 	foreach_cpu(cpu, pcpu_num) {
 		/* deregister devices */
 		misc_deregister(acrn_trace_devs[cpu]);
+	}
+	cancel_delayed_work_sync(&trace_work);
+	debugfs_remove_recursive(trace_debugfs_dir);
 
+	foreach_cpu(cpu, pcpu_num) {
 		/* set sbuf pointer to NULL in HV */
 		sbuf_share_setup(cpu, ACRN_TRACE, NULL);
 
 		/* free sbuf, sbuf_per_cpu[cpu] should be set NULL */
 		sbuf_free(sbuf_per_cpu[cpu]);
 	}
+	kfree(exit_agg);
 }
 
 module_init(acrn_trace_init);
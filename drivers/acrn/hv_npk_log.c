@@ -98,6 +98,15 @@
 	"echo \"D[isable]\"             to disable   the ACRN HV NPK Log\n" \
 	"echo \"C[onfig] [#M #C] [#L]\" to configure the ACRN HV NPK Log\n"
 
+/*
+ * Routing is decided by the hypervisor. struct hv_npk_log_param carries a
+ * single MMIO address and a single log level: messages at or below #L are
+ * written to the given Master/Channel, independently of the level used for
+ * the hvlog memory buffers. Streaming verbose levels to NPK while errors
+ * still go to hvlog is therefore done by raising #L here and keeping the
+ * hvlog level low. Per-level or per-pCPU channel maps would need a new
+ * hypercall and can't be configured from this driver.
+ */
 static struct hv_npk_log_conf *hnl_conf;
 
 /* Try to get the master/channel based on the given address */
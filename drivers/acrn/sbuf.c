@@ -145,25 +145,80 @@ void sbuf_free(shared_buf_t *sbuf)
 }
 EXPORT_SYMBOL(sbuf_free);
 
-int sbuf_get(shared_buf_t *sbuf, uint8_t *data)
+/*
+ * The hypervisor produces into the buffer concurrently. Read tail once and
+ * order the element reads after it, and make sure the element reads are
+ * done before the new head lets the producer overwrite them.
+ */
+static inline uint32_t sbuf_used_contig(shared_buf_t *sbuf, uint32_t head)
+{
+	uint32_t tail = READ_ONCE(sbuf->tail);
+
+	/* Pairs with the producer's barrier before it publishes tail */
+	smp_rmb();
+	return (tail >= head) ? (tail - head) : (sbuf->size - head);
+}
+
+uint32_t sbuf_peek(shared_buf_t *sbuf, const void **data)
 {
-	const void *from;
+	uint32_t head;
+
+	if ((sbuf == NULL) || (data == NULL))
+		return 0;
+
+	head = sbuf->head;
+	*data = (void *)sbuf + SBUF_HEAD_SIZE + head;
+
+	return sbuf_used_contig(sbuf, head);
+}
+EXPORT_SYMBOL(sbuf_peek);
+
+void sbuf_commit(shared_buf_t *sbuf, uint32_t len)
+{
+	if (sbuf == NULL)
+		return;
+
+	/* Finish reading the elements before handing them back */
+	smp_mb();
+	WRITE_ONCE(sbuf->head, sbuf_next_ptr(sbuf->head, len, sbuf->size));
+}
+EXPORT_SYMBOL(sbuf_commit);
+
+int sbuf_get_batch(shared_buf_t *sbuf, uint8_t *data, uint32_t max_ele)
+{
+	uint32_t head, span, want, copied = 0;
 
 	if ((sbuf == NULL) || (data == NULL))
 		return -EINVAL;
 
-	if (sbuf_is_empty(sbuf)) {
-		/* no data available */
-		return 0;
-	}
+	want = max_ele * sbuf->ele_size;
+	head = sbuf->head;
 
-	from = (void *)sbuf + SBUF_HEAD_SIZE + sbuf->head;
+	/* At most two spans, up to the end of the buffer and from its start */
+	while (copied < want) {
+		span = min(sbuf_used_contig(sbuf, head), want - copied);
+		if (!span)
+			break;
 
-	memcpy(data, from, sbuf->ele_size);
+		memcpy(data + copied, (void *)sbuf + SBUF_HEAD_SIZE + head,
+		       span);
+		copied += span;
+		head = sbuf_next_ptr(head, span, sbuf->size);
+	}
 
-	sbuf->head = sbuf_next_ptr(sbuf->head, sbuf->ele_size, sbuf->size);
+	if (copied) {
+		/* Finish reading the elements before handing them back */
+		smp_mb();
+		WRITE_ONCE(sbuf->head, head);
+	}
 
-	return sbuf->ele_size;
+	return copied;
+}
+EXPORT_SYMBOL(sbuf_get_batch);
+
+int sbuf_get(shared_buf_t *sbuf, uint8_t *data)
+{
+	return sbuf_get_batch(sbuf, data, 1);
 }
 EXPORT_SYMBOL(sbuf_get);
 
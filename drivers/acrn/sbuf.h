@@ -56,6 +56,7 @@
 #ifndef SHARED_BUF_H
 #define SHARED_BUF_H
 
+#include <linux/compiler.h>
 #include <linux/types.h>
 
 
@@ -116,9 +117,26 @@ static inline void sbuf_add_flags(shared_buf_t *sbuf, uint64_t flags)
 	sbuf->flags |= flags;
 }
 
+/* Number of bytes the consumer hasn't read yet, for wakeup heuristics */
+static inline uint32_t sbuf_used(shared_buf_t *sbuf)
+{
+	uint32_t head = READ_ONCE(sbuf->head);
+	uint32_t tail = READ_ONCE(sbuf->tail);
+
+	return (tail >= head) ? (tail - head) : (sbuf->size - head + tail);
+}
+
 shared_buf_t *sbuf_allocate(uint32_t ele_num, uint32_t ele_size);
 void sbuf_free(shared_buf_t *sbuf);
 int sbuf_get(shared_buf_t *sbuf, uint8_t *data);
+int sbuf_get_batch(shared_buf_t *sbuf, uint8_t *data, uint32_t max_ele);
+/*
+ * Zero-copy consumer interface: sbuf_peek() returns the number of bytes
+ * available contiguously at head and points *data at them, sbuf_commit()
+ * consumes the first len of those bytes.
+ */
+uint32_t sbuf_peek(shared_buf_t *sbuf, const void **data);
+void sbuf_commit(shared_buf_t *sbuf, uint32_t len);
 int sbuf_share_setup(uint32_t pcpu_id, uint32_t sbuf_id, shared_buf_t *sbuf);
 shared_buf_t *sbuf_check_valid(uint32_t ele_num, uint32_t ele_size,
 				uint64_t gpa);
@@ -65,6 +65,7 @@
 #include <linux/rbtree.h>
 #include <linux/sched/signal.h>
 #include <linux/sched/mm.h>
+#include <linux/sched/topology.h>
 #include <linux/seq_file.h>
 #include <linux/uaccess.h>
 #include <linux/pid_namespace.h>
@@ -207,6 +208,36 @@ struct binder_stats {
 
 static struct binder_stats binder_stats;
 
+#ifdef CONFIG_ANDROID_BINDER_IPC_LATENCY_STATS
+#define BINDER_LAT_BUCKETS 24
+
+enum binder_lat_types {
+	BINDER_LAT_QUEUE,
+	BINDER_LAT_REPLY,
+	BINDER_LAT_ALLOC,
+	BINDER_LAT_COUNT
+};
+
+/*
+ * Bucket 0 counts events below 1us, bucket n counts events
+ * between 2^(n-1) and 2^n us. The last bucket is open ended.
+ */
+struct binder_lat_stats {
+	atomic_t hist[BINDER_LAT_COUNT][BINDER_LAT_BUCKETS];
+};
+
+static void binder_lat_add(struct binder_lat_stats *lat,
+			   enum binder_lat_types type, s64 delta_us)
+{
+	unsigned int bucket;
+
+	bucket = delta_us > 0 ? fls64(delta_us) : 0;
+	if (bucket >= BINDER_LAT_BUCKETS)
+		bucket = BINDER_LAT_BUCKETS - 1;
+	atomic_inc(&lat->hist[type][bucket]);
+}
+#endif
+
 static inline void binder_stats_deleted(enum binder_stat_types type)
 {
 	atomic_inc(&binder_stats.obj_deleted[type]);
@@ -361,6 +392,8 @@ struct binder_error {
  *                        (invariant after initialized)
  * @async_todo:           list of async work items
  *                        (protected by @proc->inner_lock)
+ * @lat:                  latency histograms of transactions to this node
+ *                        (atomics, no lock needed)
  *
  * Bookkeeping structure for binder nodes.
  */
@@ -401,6 +434,9 @@ struct binder_node {
 	};
 	bool has_async_transaction;
 	struct list_head async_todo;
+#ifdef CONFIG_ANDROID_BINDER_IPC_LATENCY_STATS
+	struct binder_lat_stats lat;
+#endif
 };
 
 struct binder_ref_death {
@@ -517,6 +553,8 @@ struct binder_priority {
  *                        (protected by @inner_lock)
  * @stats:                per-process binder statistics
  *                        (atomics, no lock needed)
+ * @lat:                  per-process latency histograms
+ *                        (atomics, no lock needed)
  * @delivered_death:      list of delivered death notification
  *                        (protected by @inner_lock)
  * @max_threads:          cap on number of binder threads
@@ -558,6 +596,9 @@ struct binder_proc {
 
 	struct list_head todo;
 	struct binder_stats stats;
+#ifdef CONFIG_ANDROID_BINDER_IPC_LATENCY_STATS
+	struct binder_lat_stats lat;
+#endif
 	struct list_head delivered_death;
 	int max_threads;
 	int requested_threads;
@@ -654,6 +695,17 @@ struct binder_transaction {
 	struct binder_priority	saved_priority;
 	bool    set_priority_called;
 	kuid_t	sender_euid;
+#ifdef CONFIG_ANDROID_BINDER_IPC_LATENCY_STATS
+	/**
+	 * @queue_time:  when the transaction was queued to the target
+	 * @wakeup_time: when a target thread picked up the transaction
+	 * @lat_node:    node charged for wakeup-to-reply latency, holds
+	 *               a tmpref until the transaction is freed
+	 */
+	ktime_t queue_time;
+	ktime_t wakeup_time;
+	struct binder_node *lat_node;
+#endif
 	/**
 	 * @lock:  protects @from, @to_proc, and @to_thread
 	 *
@@ -1052,6 +1104,8 @@ static void binder_wakeup_poll_threads_ilocked(struct binder_proc *proc,
 	}
 }
 
+#define BINDER_SELECT_THREAD_SCAN 4
+
 /**
  * binder_select_thread_ilocked() - selects a thread for doing proc work.
  * @proc:	process to select a thread from
@@ -1061,21 +1115,38 @@ static void binder_wakeup_poll_threads_ilocked(struct binder_proc *proc,
  * signal. Therefore, callers *should* always wake up the thread this function
  * returns.
  *
+ * The most recently idle threads are at the head of waiting_threads. Among
+ * the first BINDER_SELECT_THREAD_SCAN of them, prefer one that last ran on
+ * a CPU sharing a last-level cache with the caller, so the woken thread
+ * finds the data the caller just wrote still cache hot.
+ *
  * Return:	If there's a thread currently waiting for process work,
  *		returns that thread. Otherwise returns NULL.
  */
 static struct binder_thread *
 binder_select_thread_ilocked(struct binder_proc *proc)
 {
-	struct binder_thread *thread;
+	struct binder_thread *thread, *iter;
+	int this_cpu = raw_smp_processor_id();
+	int scanned = 0;
 
 	assert_spin_locked(&proc->inner_lock);
 	thread = list_first_entry_or_null(&proc->waiting_threads,
 					  struct binder_thread,
 					  waiting_thread_node);
+	if (!thread)
+		return NULL;
 
-	if (thread)
-		list_del_init(&thread->waiting_thread_node);
+	list_for_each_entry(iter, &proc->waiting_threads, waiting_thread_node) {
+		if (scanned++ == BINDER_SELECT_THREAD_SCAN)
+			break;
+		if (cpus_share_cache(this_cpu, task_cpu(iter->task))) {
+			thread = iter;
+			break;
+		}
+	}
+
+	list_del_init(&thread->waiting_thread_node);
 
 	return thread;
 }
@@ -1126,6 +1197,30 @@ static void binder_wakeup_thread_ilocked(struct binder_proc *proc,
 	binder_wakeup_poll_threads_ilocked(proc, sync);
 }
 
+/**
+ * binder_can_batch_async_ilocked() - check if @thread can take async work
+ * @thread:	looper thread releasing an async buffer
+ *
+ * Queued oneway work for a node can go straight to the thread that just
+ * finished the previous one, when that thread is a looper that will read
+ * again, is not in the middle of a synchronous transaction and no other
+ * proc work is pending that the oneway work would overtake.
+ *
+ * Return:	true if the work can be queued to @thread without a wakeup
+ */
+static bool binder_can_batch_async_ilocked(struct binder_thread *thread)
+{
+	struct binder_proc *proc = thread->proc;
+
+	assert_spin_locked(&proc->inner_lock);
+	return (thread->looper & (BINDER_LOOPER_STATE_REGISTERED |
+				  BINDER_LOOPER_STATE_ENTERED)) &&
+		!(thread->looper & BINDER_LOOPER_STATE_EXITED) &&
+		!thread->transaction_stack &&
+		!thread->is_dead &&
+		binder_worklist_empty_ilocked(&proc->todo);
+}
+
 static void binder_wakeup_proc_ilocked(struct binder_proc *proc)
 {
 	struct binder_thread *thread = binder_select_thread_ilocked(proc);
@@ -1606,6 +1701,75 @@ static void binder_dec_node_tmpref(struct binder_node *node)
 		binder_free_node(node);
 }
 
+#ifdef CONFIG_ANDROID_BINDER_IPC_LATENCY_STATS
+static inline void binder_lat_queued(struct binder_transaction *t)
+{
+	t->queue_time = ktime_get();
+}
+
+static void binder_lat_wakeup(struct binder_proc *proc,
+			      struct binder_transaction *t)
+{
+	struct binder_node *node = t->buffer->target_node;
+	s64 delta;
+
+	t->wakeup_time = ktime_get();
+	delta = ktime_us_delta(t->wakeup_time, t->queue_time);
+	binder_lat_add(&proc->lat, BINDER_LAT_QUEUE, delta);
+	if (!node)
+		return;
+	binder_lat_add(&node->lat, BINDER_LAT_QUEUE, delta);
+	if (!(t->flags & TF_ONE_WAY) && !t->lat_node) {
+		binder_inc_node_tmpref(node);
+		t->lat_node = node;
+	}
+}
+
+static void binder_lat_reply(struct binder_proc *proc,
+			     struct binder_transaction *in_reply_to)
+{
+	s64 delta = ktime_us_delta(ktime_get(), in_reply_to->wakeup_time);
+
+	binder_lat_add(&proc->lat, BINDER_LAT_REPLY, delta);
+	if (in_reply_to->lat_node)
+		binder_lat_add(&in_reply_to->lat_node->lat,
+			       BINDER_LAT_REPLY, delta);
+}
+
+static void binder_lat_release(struct binder_transaction *t)
+{
+	if (t->lat_node) {
+		binder_dec_node_tmpref(t->lat_node);
+		t->lat_node = NULL;
+	}
+}
+
+static inline ktime_t binder_lat_alloc_start(void)
+{
+	return ktime_get();
+}
+
+static inline void binder_lat_alloc_end(struct binder_proc *proc,
+					ktime_t start)
+{
+	binder_lat_add(&proc->lat, BINDER_LAT_ALLOC,
+		       ktime_us_delta(ktime_get(), start));
+}
+#else
+static inline void binder_lat_queued(struct binder_transaction *t) {}
+static inline void binder_lat_wakeup(struct binder_proc *proc,
+				     struct binder_transaction *t) {}
+static inline void binder_lat_reply(struct binder_proc *proc,
+				    struct binder_transaction *in_reply_to) {}
+static inline void binder_lat_release(struct binder_transaction *t) {}
+static inline ktime_t binder_lat_alloc_start(void)
+{
+	return 0;
+}
+static inline void binder_lat_alloc_end(struct binder_proc *proc,
+					ktime_t start) {}
+#endif
+
 static void binder_put_node(struct binder_node *node)
 {
 	binder_dec_node_tmpref(node);
@@ -2116,6 +2280,7 @@ static void binder_free_transaction(struct binder_transaction *t)
 {
 	if (t->buffer)
 		t->buffer->transaction = NULL;
+	binder_lat_release(t);
 	kfree(t);
 	binder_stats_deleted(BINDER_STAT_TRANSACTION);
 }
@@ -2900,6 +3065,7 @@ static void binder_transaction(struct binder_proc *proc,
 	binder_size_t last_fixup_min_off = 0;
 	struct binder_context *context = proc->context;
 	int t_debug_id = atomic_inc_return(&binder_last_id);
+	ktime_t alloc_start;
 
 	e = binder_transaction_log_add(&binder_transaction_log);
 	e->debug_id = t_debug_id;
@@ -3125,9 +3291,11 @@ static void binder_transaction(struct binder_proc *proc,
 
 	trace_binder_transaction(reply, t, target_node);
 
+	alloc_start = binder_lat_alloc_start();
 	t->buffer = binder_alloc_new_buf(&target_proc->alloc, tr->data_size,
 		tr->offsets_size, extra_buffers_size,
 		!reply && (t->flags & TF_ONE_WAY));
+	binder_lat_alloc_end(target_proc, alloc_start);
 	if (IS_ERR(t->buffer)) {
 		/*
 		 * -ESRCH indicates VMA cleared. The target is dying.
@@ -3297,6 +3465,14 @@ static void binder_transaction(struct binder_proc *proc,
 				return_error_line = __LINE__;
 				goto err_bad_offset;
 			}
+			/*
+			 * Always copy, even for large buffers. Mapping the
+			 * sender's pages into the target would let the sender
+			 * change the data after the target validated it, and
+			 * the parent fixups below write into this memory.
+			 * Large payloads that must not be copied should be
+			 * passed as ashmem or dma-buf fds instead.
+			 */
 			if (copy_from_user(sg_bufp,
 					   (const void __user *)(uintptr_t)
 					   bp->buffer, bp->length)) {
@@ -3337,6 +3513,7 @@ static void binder_transaction(struct binder_proc *proc,
 	}
 	tcomplete->type = BINDER_WORK_TRANSACTION_COMPLETE;
 	t->work.type = BINDER_WORK_TRANSACTION;
+	binder_lat_queued(t);
 
 	if (reply) {
 		binder_enqueue_thread_work(thread, tcomplete);
@@ -3351,6 +3528,7 @@ static void binder_transaction(struct binder_proc *proc,
 		binder_inner_proc_unlock(target_proc);
 		wake_up_interruptible_sync(&target_thread->wait);
 		binder_restore_priority(current, in_reply_to->saved_priority);
+		binder_lat_reply(proc, in_reply_to);
 		binder_free_transaction(in_reply_to);
 	} else if (!(t->flags & TF_ONE_WAY)) {
 		BUG_ON(t->buffer->async_transaction != 0);
@@ -3667,6 +3845,15 @@ static int binder_thread_write(struct binder_proc *proc,
 						&buf_node->async_todo);
 				if (!w) {
 					buf_node->has_async_transaction = false;
+				} else if (binder_can_batch_async_ilocked(thread)) {
+					/*
+					 * This looper goes back to read as soon
+					 * as it is done here, so let it run the
+					 * next oneway transaction for the node
+					 * instead of waking up another thread.
+					 */
+					binder_enqueue_thread_work_ilocked(
+							thread, w);
 				} else {
 					binder_enqueue_work_ilocked(
 							w, &proc->todo);
@@ -4248,6 +4435,7 @@ static int binder_thread_read(struct binder_proc *proc,
 			continue;
 
 		BUG_ON(t->buffer == NULL);
+		binder_lat_wakeup(proc, t);
 		if (t->buffer->target_node) {
 			struct binder_node *target_node = t->buffer->target_node;
 			struct binder_priority node_prio;
@@ -5610,6 +5798,57 @@ static void print_binder_stats(struct seq_file *m, const char *prefix,
 	}
 }
 
+#ifdef CONFIG_ANDROID_BINDER_IPC_LATENCY_STATS
+static const char * const binder_lat_strings[] = {
+	"queue-to-wakeup",
+	"wakeup-to-reply",
+	"alloc"
+};
+
+static void print_binder_lat_stats(struct seq_file *m, const char *prefix,
+				   struct binder_lat_stats *lat)
+{
+	int type, i, last;
+
+	BUILD_BUG_ON(ARRAY_SIZE(lat->hist) !=
+		     ARRAY_SIZE(binder_lat_strings));
+	for (type = 0; type < ARRAY_SIZE(lat->hist); type++) {
+		last = -1;
+		for (i = 0; i < BINDER_LAT_BUCKETS; i++)
+			if (atomic_read(&lat->hist[type][i]))
+				last = i;
+		if (last < 0)
+			continue;
+		seq_printf(m, "%slatency %s us:", prefix,
+			   binder_lat_strings[type]);
+		for (i = 0; i <= last; i++)
+			seq_printf(m, " %d", atomic_read(&lat->hist[type][i]));
+		seq_puts(m, "\n");
+	}
+}
+
+static void print_binder_proc_lat_stats(struct seq_file *m,
+					struct binder_proc *proc)
+{
+	struct binder_node *node;
+	struct rb_node *n;
+	char prefix[32];
+
+	print_binder_lat_stats(m, "  ", &proc->lat);
+
+	binder_inner_proc_lock(proc);
+	for (n = rb_first(&proc->nodes); n != NULL; n = rb_next(n)) {
+		node = rb_entry(n, struct binder_node, rb_node);
+		snprintf(prefix, sizeof(prefix), "  node %d ", node->debug_id);
+		print_binder_lat_stats(m, prefix, &node->lat);
+	}
+	binder_inner_proc_unlock(proc);
+}
+#else
+static inline void print_binder_proc_lat_stats(struct seq_file *m,
+					       struct binder_proc *proc) {}
+#endif
+
 static void print_binder_proc_stats(struct seq_file *m,
 				    struct binder_proc *proc)
 {
@@ -5672,6 +5911,7 @@ static void print_binder_proc_stats(struct seq_file *m,
 	seq_printf(m, "  pending transactions: %d\n", count);
 
 	print_binder_stats(m, "  ", &proc->stats);
+	print_binder_proc_lat_stats(m, proc);
 }
 
 
@@ -28,6 +28,7 @@
 #include <linux/sched.h>
 #include <linux/list_lru.h>
 #include <linux/ratelimit.h>
+#include <linux/percpu.h>
 #include <asm/cacheflush.h>
 #include "binder_alloc.h"
 #include "binder_trace.h"
@@ -47,6 +48,16 @@ static uint32_t binder_alloc_debug_mask = BINDER_DEBUG_USER_ERROR;
 module_param_named(debug_mask, binder_alloc_debug_mask,
 		   uint, 0644);
 
+/*
+ * Number of pages at the start of each mmap'd area that are kept
+ * populated once faulted in instead of being handed to the shrinker.
+ * Sampled at mmap time.
+ */
+static uint binder_alloc_pinned_pages;
+
+module_param_named(pinned_pages, binder_alloc_pinned_pages,
+		   uint, 0644);
+
 #define binder_alloc_debug(mask, x...) \
 	do { \
 		if (binder_alloc_debug_mask & mask) \
@@ -189,11 +200,150 @@ struct binder_buffer *binder_alloc_prepare_to_free(struct binder_alloc *alloc,
 	return buffer;
 }
 
+static bool binder_alloc_page_pinned(struct binder_alloc *alloc, size_t index)
+{
+	return index < alloc->pinned_pages;
+}
+
+static void binder_alloc_release_page(struct binder_alloc *alloc,
+				      size_t index)
+{
+	bool ret;
+
+	if (binder_alloc_page_pinned(alloc, index))
+		return;
+
+	trace_binder_free_lru_start(alloc, index);
+
+	ret = list_lru_add(&binder_alloc_lru, &alloc->pages[index].lru);
+	WARN_ON(!ret);
+
+	trace_binder_free_lru_end(alloc, index);
+}
+
+static void binder_alloc_put_page(struct binder_alloc *alloc,
+				  struct page *page)
+{
+	mem_cgroup_uncharge_pages(alloc->memcg, 1);
+	__free_page(page);
+}
+
+/*
+ * Allocate @nr zeroed pages into @pages, preferring physically
+ * contiguous higher-order blocks split into order-0 pages, and charge
+ * them to the memcg of the process owning @alloc rather than to the
+ * sender allocating them.  The charge isn't tied to the struct pages, so
+ * every page freed has to go through binder_alloc_put_page().
+ */
+static int binder_alloc_pages_batch(struct binder_alloc *alloc,
+				    struct page **pages, int nr)
+{
+	gfp_t gfp = GFP_KERNEL | __GFP_HIGHMEM | __GFP_ZERO;
+	unsigned int order;
+	struct page *page;
+	int i, done = 0;
+
+	while (done < nr) {
+		order = min_t(unsigned int, ilog2(nr - done),
+			      BINDER_ALLOC_BATCH_ORDER);
+		for (;;) {
+			if (!order) {
+				page = alloc_page(gfp);
+				break;
+			}
+			page = alloc_pages(gfp | __GFP_NORETRY | __GFP_NOWARN,
+					   order);
+			if (page) {
+				split_page(page, order);
+				break;
+			}
+			order--;
+		}
+		if (!page)
+			goto err_alloc_page_failed;
+		for (i = 0; i < (1 << order); i++)
+			pages[done++] = page + i;
+	}
+
+	if (mem_cgroup_charge_pages(alloc->memcg, GFP_KERNEL, nr))
+		goto err_alloc_page_failed;
+	return 0;
+
+err_alloc_page_failed:
+	while (done--)
+		__free_page(pages[done]);
+	return -ENOMEM;
+}
+
+/*
+ * Populate @nr consecutive unpopulated pages starting at @page_addr:
+ * allocate them in one go, map them into the kernel with a single
+ * page table pass and then insert them into the user vma.
+ */
+static int binder_alloc_map_batch(struct binder_alloc *alloc,
+				  struct vm_area_struct *vma,
+				  void *page_addr, int nr)
+{
+	struct page *pages[BINDER_ALLOC_BATCH];
+	unsigned long user_page_addr;
+	size_t index;
+	int i, ret;
+
+	index = (page_addr - alloc->buffer) / PAGE_SIZE;
+
+	trace_binder_alloc_page_start(alloc, index);
+	if (binder_alloc_pages_batch(alloc, pages, nr)) {
+		pr_err("%d: binder_alloc_buf failed for page at %pK\n",
+			alloc->pid, page_addr);
+		return -ENOMEM;
+	}
+
+	ret = map_kernel_range_noflush((unsigned long)page_addr,
+				       nr * PAGE_SIZE, PAGE_KERNEL, pages);
+	flush_cache_vmap((unsigned long)page_addr,
+			(unsigned long)page_addr + nr * PAGE_SIZE);
+	if (ret != nr) {
+		pr_err("%d: binder_alloc_buf failed to map page at %pK in kernel\n",
+		       alloc->pid, page_addr);
+		i = 0;
+		goto err_map_kernel_failed;
+	}
+
+	user_page_addr = (uintptr_t)page_addr + alloc->user_buffer_offset;
+	for (i = 0; i < nr; i++) {
+		ret = vm_insert_page(vma, user_page_addr + i * PAGE_SIZE,
+				     pages[i]);
+		if (ret) {
+			pr_err("%d: binder_alloc_buf failed to map page at %lx in userspace\n",
+			       alloc->pid, user_page_addr + i * PAGE_SIZE);
+			goto err_vm_insert_page_failed;
+		}
+		/* vm_insert_page does not seem to increment the refcount */
+		alloc->pages[index + i].page_ptr = pages[i];
+		alloc->pages[index + i].alloc = alloc;
+		INIT_LIST_HEAD(&alloc->pages[index + i].lru);
+	}
+
+	if (index + nr > alloc->pages_high)
+		alloc->pages_high = index + nr;
+
+	trace_binder_alloc_page_end(alloc, index);
+	return nr;
+
+err_vm_insert_page_failed:
+err_map_kernel_failed:
+	unmap_kernel_range((unsigned long)page_addr + i * PAGE_SIZE,
+			   (nr - i) * PAGE_SIZE);
+	while (nr-- > i)
+		binder_alloc_put_page(alloc, pages[nr]);
+	/* Pages before @i are fully set up and unwound by the caller */
+	return i ? i : -ENOMEM;
+}
+
 static int binder_update_page_range(struct binder_alloc *alloc, int allocate,
 				    void *start, void *end)
 {
 	void *page_addr;
-	unsigned long user_page_addr;
 	struct binder_lru_page *page;
 	struct vm_area_struct *vma = NULL;
 	struct mm_struct *mm = NULL;
@@ -234,8 +384,9 @@ static int binder_update_page_range(struct binder_alloc *alloc, int allocate,
 		goto err_no_vma;
 	}
 
-	for (page_addr = start; page_addr < end; page_addr += PAGE_SIZE) {
-		int ret;
+	page_addr = start;
+	while (page_addr < end) {
+		int ret, nr;
 		bool on_lru;
 		size_t index;
 
@@ -243,6 +394,10 @@ static int binder_update_page_range(struct binder_alloc *alloc, int allocate,
 		page = &alloc->pages[index];
 
 		if (page->page_ptr) {
+			page_addr += PAGE_SIZE;
+			if (binder_alloc_page_pinned(alloc, index))
+				continue;
+
 			trace_binder_alloc_lru_start(alloc, index);
 
 			on_lru = list_lru_del(&binder_alloc_lru, &page->lru);
@@ -255,42 +410,17 @@ static int binder_update_page_range(struct binder_alloc *alloc, int allocate,
 		if (WARN_ON(!vma))
 			goto err_page_ptr_cleared;
 
-		trace_binder_alloc_page_start(alloc, index);
-		page->page_ptr = alloc_page(GFP_KERNEL |
-					    __GFP_HIGHMEM |
-					    __GFP_ZERO);
-		if (!page->page_ptr) {
-			pr_err("%d: binder_alloc_buf failed for page at %pK\n",
-				alloc->pid, page_addr);
-			goto err_alloc_page_failed;
-		}
-		page->alloc = alloc;
-		INIT_LIST_HEAD(&page->lru);
-
-		ret = map_kernel_range_noflush((unsigned long)page_addr,
-					       PAGE_SIZE, PAGE_KERNEL,
-					       &page->page_ptr);
-		flush_cache_vmap((unsigned long)page_addr,
-				(unsigned long)page_addr + PAGE_SIZE);
-		if (ret != 1) {
-			pr_err("%d: binder_alloc_buf failed to map page at %pK in kernel\n",
-			       alloc->pid, page_addr);
-			goto err_map_kernel_failed;
-		}
-		user_page_addr =
-			(uintptr_t)page_addr + alloc->user_buffer_offset;
-		ret = vm_insert_page(vma, user_page_addr, page[0].page_ptr);
-		if (ret) {
-			pr_err("%d: binder_alloc_buf failed to map page at %lx in userspace\n",
-			       alloc->pid, user_page_addr);
-			goto err_vm_insert_page_failed;
+		for (nr = 1; nr < BINDER_ALLOC_BATCH; nr++) {
+			if (page_addr + nr * PAGE_SIZE >= end ||
+			    page[nr].page_ptr)
+				break;
 		}
 
-		if (index + 1 > alloc->pages_high)
-			alloc->pages_high = index + 1;
-
-		trace_binder_alloc_page_end(alloc, index);
-		/* vm_insert_page does not seem to increment the refcount */
+		ret = binder_alloc_map_batch(alloc, vma, page_addr, nr);
+		if (ret > 0)
+			page_addr += ret * PAGE_SIZE;
+		if (ret != nr)
+			goto err_page_ptr_cleared;
 	}
 	if (mm) {
 		up_read(&mm->mmap_sem);
@@ -300,30 +430,17 @@ static int binder_update_page_range(struct binder_alloc *alloc, int allocate,
 
 free_range:
 	for (page_addr = end - PAGE_SIZE; page_addr >= start;
-	     page_addr -= PAGE_SIZE) {
-		bool ret;
-		size_t index;
-
-		index = (page_addr - alloc->buffer) / PAGE_SIZE;
-		page = &alloc->pages[index];
-
-		trace_binder_free_lru_start(alloc, index);
-
-		ret = list_lru_add(&binder_alloc_lru, &page->lru);
-		WARN_ON(!ret);
-
-		trace_binder_free_lru_end(alloc, index);
-		continue;
+	     page_addr -= PAGE_SIZE)
+		binder_alloc_release_page(alloc,
+				(page_addr - alloc->buffer) / PAGE_SIZE);
+	return 0;
 
-err_vm_insert_page_failed:
-		unmap_kernel_range((unsigned long)page_addr, PAGE_SIZE);
-err_map_kernel_failed:
-		__free_page(page->page_ptr);
-		page->page_ptr = NULL;
-err_alloc_page_failed:
 err_page_ptr_cleared:
-		;
-	}
+	/* Put back the pages already populated for this range */
+	for (page_addr -= PAGE_SIZE; page_addr >= start;
+	     page_addr -= PAGE_SIZE)
+		binder_alloc_release_page(alloc,
+				(page_addr - alloc->buffer) / PAGE_SIZE);
 err_no_vma:
 	if (mm) {
 		up_read(&mm->mmap_sem);
@@ -332,7 +449,6 @@ static int binder_update_page_range(struct binder_alloc *alloc, int allocate,
 	return vma ? -ENOMEM : -ESRCH;
 }
 
-
 static inline void binder_alloc_set_vma(struct binder_alloc *alloc,
 		struct vm_area_struct *vma)
 {
@@ -361,6 +477,176 @@ static inline struct vm_area_struct *binder_alloc_get_vma(
 	return vma;
 }
 
+static bool binder_alloc_charge_async_space(struct binder_alloc *alloc,
+					    size_t size)
+{
+	bool charged = false;
+
+	spin_lock(&alloc->async_lock);
+	if (alloc->free_async_space >= size) {
+		alloc->free_async_space -= size;
+		charged = true;
+	}
+	spin_unlock(&alloc->async_lock);
+	return charged;
+}
+
+static void binder_alloc_refund_async_space(struct binder_alloc *alloc,
+					    size_t size)
+{
+	spin_lock(&alloc->async_lock);
+	alloc->free_async_space += size;
+	spin_unlock(&alloc->async_lock);
+}
+
+static int binder_alloc_get_size(struct binder_alloc *alloc,
+				 size_t data_size,
+				 size_t offsets_size,
+				 size_t extra_buffers_size,
+				 size_t *sizep)
+{
+	size_t size, data_offsets_size;
+
+	data_offsets_size = ALIGN(data_size, sizeof(void *)) +
+		ALIGN(offsets_size, sizeof(void *));
+
+	if (data_offsets_size < data_size || data_offsets_size < offsets_size) {
+		binder_alloc_debug(BINDER_DEBUG_BUFFER_ALLOC,
+				"%d: got transaction with invalid size %zd-%zd\n",
+				alloc->pid, data_size, offsets_size);
+		return -EINVAL;
+	}
+	size = data_offsets_size + ALIGN(extra_buffers_size, sizeof(void *));
+	if (size < data_offsets_size || size < extra_buffers_size) {
+		binder_alloc_debug(BINDER_DEBUG_BUFFER_ALLOC,
+				"%d: got transaction with invalid extra_buffers_size %zd\n",
+				alloc->pid, extra_buffers_size);
+		return -EINVAL;
+	}
+	*sizep = size;
+	return 0;
+}
+
+static struct binder_buffer *binder_alloc_cache_get(struct binder_alloc *alloc,
+						    size_t data_size,
+						    size_t offsets_size,
+						    size_t extra_buffers_size,
+						    int is_async)
+{
+	struct binder_alloc_cache *cache;
+	struct binder_buffer *buffer = NULL;
+	size_t size, padded_size;
+	int i, best = -1;
+
+	if (!alloc->cache || !binder_alloc_get_vma(alloc))
+		return NULL;
+	if (binder_alloc_get_size(alloc, data_size, offsets_size,
+				  extra_buffers_size, &size))
+		return NULL;
+	padded_size = max(size, sizeof(void *));
+	if (padded_size > BINDER_ALLOC_CACHE_MAX_SIZE)
+		return NULL;
+
+	cache = get_cpu_ptr(alloc->cache);
+	spin_lock(&cache->lock);
+	for (i = 0; i < cache->count; i++) {
+		if (cache->slots[i].size < padded_size)
+			continue;
+		if (best < 0 || cache->slots[i].size < cache->slots[best].size)
+			best = i;
+	}
+	if (best < 0)
+		goto out_unlock;
+	if (is_async &&
+	    !binder_alloc_charge_async_space(alloc,
+				size + sizeof(struct binder_buffer)))
+		goto out_unlock;
+
+	buffer = cache->slots[best].buffer;
+	cache->slots[best] = cache->slots[--cache->count];
+out_unlock:
+	spin_unlock(&cache->lock);
+	put_cpu_ptr(alloc->cache);
+	if (!buffer)
+		return NULL;
+
+	buffer->cached = 0;
+	buffer->free_in_progress = 0;
+	buffer->data_size = data_size;
+	buffer->offsets_size = offsets_size;
+	buffer->async_transaction = is_async;
+	buffer->extra_buffers_size = extra_buffers_size;
+	binder_alloc_debug(BINDER_DEBUG_BUFFER_ALLOC,
+		     "%d: binder_alloc_buf size %zd got cached %pK\n",
+		      alloc->pid, size, buffer);
+	return buffer;
+}
+
+static bool binder_alloc_cache_put(struct binder_alloc *alloc,
+				   struct binder_buffer *buffer)
+{
+	struct binder_alloc_cache *cache;
+	size_t size, buffer_size;
+	bool cached = false;
+	bool is_async;
+
+	if (!alloc->cache || !binder_alloc_get_vma(alloc))
+		return false;
+
+	/*
+	 * The size of an allocated buffer cannot change under us: its
+	 * neighbours are only merged or split while they are free.
+	 */
+	buffer_size = binder_alloc_buffer_size(alloc, buffer);
+	if (buffer_size > BINDER_ALLOC_CACHE_MAX_SIZE)
+		return false;
+
+	size = ALIGN(buffer->data_size, sizeof(void *)) +
+		ALIGN(buffer->offsets_size, sizeof(void *)) +
+		ALIGN(buffer->extra_buffers_size, sizeof(void *));
+
+	BUG_ON(buffer->free);
+	BUG_ON(size > buffer_size);
+	BUG_ON(buffer->transaction != NULL);
+
+	/*
+	 * Mark the buffer before it becomes visible to other users of the
+	 * cache. User frees of the stale address are refused until the
+	 * buffer is handed out again.
+	 */
+	is_async = buffer->async_transaction;
+	buffer->async_transaction = 0;
+	buffer->allow_user_free = 0;
+	buffer->free_in_progress = 1;
+	buffer->cached = 1;
+
+	cache = get_cpu_ptr(alloc->cache);
+	spin_lock(&cache->lock);
+	if (cache->count < BINDER_ALLOC_CACHE_SLOTS) {
+		cache->slots[cache->count].buffer = buffer;
+		cache->slots[cache->count].size = buffer_size;
+		cache->count++;
+		cached = true;
+	}
+	spin_unlock(&cache->lock);
+	put_cpu_ptr(alloc->cache);
+	if (!cached) {
+		buffer->cached = 0;
+		buffer->async_transaction = is_async;
+		return false;
+	}
+
+	if (is_async)
+		binder_alloc_refund_async_space(alloc,
+				size + sizeof(struct binder_buffer));
+	binder_alloc_debug(BINDER_DEBUG_BUFFER_ALLOC,
+		     "%d: binder_free_buf %pK size %zd cached\n",
+		      alloc->pid, buffer, size);
+	return true;
+}
+
+static int binder_alloc_drain_cache_locked(struct binder_alloc *alloc);
+
 static struct binder_buffer *binder_alloc_new_buf_locked(
 				struct binder_alloc *alloc,
 				size_t data_size,
@@ -368,13 +654,13 @@ static struct binder_buffer *binder_alloc_new_buf_locked(
 				size_t extra_buffers_size,
 				int is_async)
 {
-	struct rb_node *n = alloc->free_buffers.rb_node;
+	struct rb_node *n;
 	struct binder_buffer *buffer;
 	size_t buffer_size;
-	struct rb_node *best_fit = NULL;
+	struct rb_node *best_fit;
 	void *has_page_addr;
 	void *end_page_addr;
-	size_t size, data_offsets_size;
+	size_t size, async_size = 0;
 	int ret;
 
 	if (!binder_alloc_get_vma(alloc)) {
@@ -384,33 +670,26 @@ static struct binder_buffer *binder_alloc_new_buf_locked(
 		return ERR_PTR(-ESRCH);
 	}
 
-	data_offsets_size = ALIGN(data_size, sizeof(void *)) +
-		ALIGN(offsets_size, sizeof(void *));
-
-	if (data_offsets_size < data_size || data_offsets_size < offsets_size) {
-		binder_alloc_debug(BINDER_DEBUG_BUFFER_ALLOC,
-				"%d: got transaction with invalid size %zd-%zd\n",
-				alloc->pid, data_size, offsets_size);
-		return ERR_PTR(-EINVAL);
-	}
-	size = data_offsets_size + ALIGN(extra_buffers_size, sizeof(void *));
-	if (size < data_offsets_size || size < extra_buffers_size) {
-		binder_alloc_debug(BINDER_DEBUG_BUFFER_ALLOC,
-				"%d: got transaction with invalid extra_buffers_size %zd\n",
-				alloc->pid, extra_buffers_size);
-		return ERR_PTR(-EINVAL);
-	}
-	if (is_async &&
-	    alloc->free_async_space < size + sizeof(struct binder_buffer)) {
-		binder_alloc_debug(BINDER_DEBUG_BUFFER_ALLOC,
-			     "%d: binder_alloc_buf size %zd failed, no async space left\n",
-			      alloc->pid, size);
-		return ERR_PTR(-ENOSPC);
+	ret = binder_alloc_get_size(alloc, data_size, offsets_size,
+				    extra_buffers_size, &size);
+	if (ret)
+		return ERR_PTR(ret);
+	if (is_async) {
+		async_size = size + sizeof(struct binder_buffer);
+		if (!binder_alloc_charge_async_space(alloc, async_size)) {
+			binder_alloc_debug(BINDER_DEBUG_BUFFER_ALLOC,
+				     "%d: binder_alloc_buf size %zd failed, no async space left\n",
+				      alloc->pid, size);
+			return ERR_PTR(-ENOSPC);
+		}
 	}
 
 	/* Pad 0-size buffers so they get assigned unique addresses */
 	size = max(size, sizeof(void *));
 
+retry:
+	n = alloc->free_buffers.rb_node;
+	best_fit = NULL;
 	while (n) {
 		buffer = rb_entry(n, struct binder_buffer, rb_node);
 		BUG_ON(!buffer->free);
@@ -434,6 +713,10 @@ static struct binder_buffer *binder_alloc_new_buf_locked(
 		size_t largest_free_size = 0;
 		size_t total_free_size = 0;
 
+		/* Cached buffers may be fragmenting the address space */
+		if (binder_alloc_drain_cache_locked(alloc))
+			goto retry;
+
 		for (n = rb_first(&alloc->allocated_buffers); n != NULL;
 		     n = rb_next(n)) {
 			buffer = rb_entry(n, struct binder_buffer, rb_node);
@@ -460,7 +743,8 @@ static struct binder_buffer *binder_alloc_new_buf_locked(
 				   total_alloc_size, allocated_buffers,
 				   largest_alloc_size, total_free_size,
 				   free_buffers, largest_free_size);
-		return ERR_PTR(-ENOSPC);
+		ret = -ENOSPC;
+		goto err_no_space;
 	}
 	if (n == NULL) {
 		buffer = rb_entry(best_fit, struct binder_buffer, rb_node);
@@ -481,7 +765,7 @@ static struct binder_buffer *binder_alloc_new_buf_locked(
 	ret = binder_update_page_range(alloc, 1,
 	    (void *)PAGE_ALIGN((uintptr_t)buffer->data), end_page_addr);
 	if (ret)
-		return ERR_PTR(ret);
+		goto err_no_space;
 
 	if (buffer_size != size) {
 		struct binder_buffer *new_buffer;
@@ -509,19 +793,21 @@ static struct binder_buffer *binder_alloc_new_buf_locked(
 	buffer->offsets_size = offsets_size;
 	buffer->async_transaction = is_async;
 	buffer->extra_buffers_size = extra_buffers_size;
-	if (is_async) {
-		alloc->free_async_space -= size + sizeof(struct binder_buffer);
+	if (is_async)
 		binder_alloc_debug(BINDER_DEBUG_BUFFER_ALLOC_ASYNC,
 			     "%d: binder_alloc_buf size %zd async free %zd\n",
 			      alloc->pid, size, alloc->free_async_space);
-	}
 	return buffer;
 
 err_alloc_buf_struct_failed:
 	binder_update_page_range(alloc, 0,
 				 (void *)PAGE_ALIGN((uintptr_t)buffer->data),
 				 end_page_addr);
-	return ERR_PTR(-ENOMEM);
+	ret = -ENOMEM;
+err_no_space:
+	if (async_size)
+		binder_alloc_refund_async_space(alloc, async_size);
+	return ERR_PTR(ret);
 }
 
 /**
@@ -537,6 +823,9 @@ static struct binder_buffer *binder_alloc_new_buf_locked(
  * is the sum of the three given sizes (each rounded up to
  * pointer-sized boundary)
  *
+ * Small requests are served from the per-CPU buffer cache first,
+ * without taking alloc->mutex.
+ *
  * Return:	The allocated buffer or %NULL if error
  */
 struct binder_buffer *binder_alloc_new_buf(struct binder_alloc *alloc,
@@ -547,6 +836,11 @@ struct binder_buffer *binder_alloc_new_buf(struct binder_alloc *alloc,
 {
 	struct binder_buffer *buffer;
 
+	buffer = binder_alloc_cache_get(alloc, data_size, offsets_size,
+					extra_buffers_size, is_async);
+	if (buffer)
+		return buffer;
+
 	mutex_lock(&alloc->mutex);
 	buffer = binder_alloc_new_buf_locked(alloc, data_size, offsets_size,
 					     extra_buffers_size, is_async);
@@ -632,7 +926,8 @@ static void binder_free_buf_locked(struct binder_alloc *alloc,
 	BUG_ON(buffer->data > alloc->buffer + alloc->buffer_size);
 
 	if (buffer->async_transaction) {
-		alloc->free_async_space += size + sizeof(struct binder_buffer);
+		binder_alloc_refund_async_space(alloc,
+				size + sizeof(struct binder_buffer));
 
 		binder_alloc_debug(BINDER_DEBUG_BUFFER_ALLOC_ASYNC,
 			     "%d: binder_free_buf size %zd async free %zd\n",
@@ -665,16 +960,62 @@ static void binder_free_buf_locked(struct binder_alloc *alloc,
 	binder_insert_free_buffer(alloc, buffer);
 }
 
+static int binder_alloc_drain_cache_locked(struct binder_alloc *alloc)
+{
+	struct binder_buffer *buffers[BINDER_ALLOC_CACHE_SLOTS];
+	struct binder_alloc_cache *cache;
+	int cpu, i, count, drained = 0;
+
+	if (!alloc->cache)
+		return 0;
+
+	for_each_possible_cpu(cpu) {
+		cache = per_cpu_ptr(alloc->cache, cpu);
+		spin_lock(&cache->lock);
+		count = cache->count;
+		for (i = 0; i < count; i++)
+			buffers[i] = cache->slots[i].buffer;
+		cache->count = 0;
+		spin_unlock(&cache->lock);
+
+		for (i = 0; i < count; i++) {
+			buffers[i]->cached = 0;
+			binder_free_buf_locked(alloc, buffers[i]);
+		}
+		drained += count;
+	}
+	return drained;
+}
+
+/**
+ * binder_alloc_drain_cache() - return cached buffers to the free tree
+ * @alloc:	binder_alloc for this proc
+ *
+ * Release every buffer parked in the per-CPU caches of @alloc so
+ * their pages go back on the binder lru.
+ */
+void binder_alloc_drain_cache(struct binder_alloc *alloc)
+{
+	mutex_lock(&alloc->mutex);
+	binder_alloc_drain_cache_locked(alloc);
+	mutex_unlock(&alloc->mutex);
+}
+
 /**
  * binder_alloc_free_buf() - free a binder buffer
  * @alloc:	binder_alloc for this proc
  * @buffer:	kernel pointer to buffer
  *
- * Free the buffer allocated via binder_alloc_new_buffer()
+ * Free the buffer allocated via binder_alloc_new_buffer(). Small
+ * buffers are parked in the per-CPU buffer cache instead of being
+ * returned to the free tree.
  */
 void binder_alloc_free_buf(struct binder_alloc *alloc,
 			    struct binder_buffer *buffer)
 {
+	if (binder_alloc_cache_put(alloc, buffer))
+		return;
+
 	mutex_lock(&alloc->mutex);
 	binder_free_buf_locked(alloc, buffer);
 	mutex_unlock(&alloc->mutex);
@@ -730,15 +1071,22 @@ int binder_alloc_mmap_handler(struct binder_alloc *alloc,
 		}
 	}
 #endif
+	/*
+	 * Accounted like the pages themselves: binder_alloc_lru puts the
+	 * lru entries of the pages on the list of the memcg this array is
+	 * charged to, so that memcg reclaim shrinks its own binder pages.
+	 */
 	alloc->pages = kcalloc((vma->vm_end - vma->vm_start) / PAGE_SIZE,
 			       sizeof(alloc->pages[0]),
-			       GFP_KERNEL);
+			       GFP_KERNEL_ACCOUNT);
 	if (alloc->pages == NULL) {
 		ret = -ENOMEM;
 		failure_string = "alloc page array";
 		goto err_alloc_pages_failed;
 	}
 	alloc->buffer_size = vma->vm_end - vma->vm_start;
+	alloc->pinned_pages = min_t(size_t, READ_ONCE(binder_alloc_pinned_pages),
+				    alloc->buffer_size / PAGE_SIZE);
 
 	buffer = kzalloc(sizeof(*buffer), GFP_KERNEL);
 	if (!buffer) {
@@ -752,6 +1100,16 @@ int binder_alloc_mmap_handler(struct binder_alloc *alloc,
 	buffer->free = 1;
 	binder_insert_free_buffer(alloc, buffer);
 	alloc->free_async_space = alloc->buffer_size / 2;
+
+	/* The buffer cache is an optimization, carry on without it */
+	alloc->cache = alloc_percpu(struct binder_alloc_cache);
+	if (alloc->cache) {
+		int cpu;
+
+		for_each_possible_cpu(cpu)
+			spin_lock_init(&per_cpu_ptr(alloc->cache, cpu)->lock);
+	}
+	alloc->memcg = get_mem_cgroup_from_mm(current->mm);
 	binder_alloc_set_vma(alloc, vma);
 	mmgrab(alloc->vma_vm_mm);
 
@@ -785,6 +1143,10 @@ void binder_alloc_deferred_release(struct binder_alloc *alloc)
 	mutex_lock(&alloc->mutex);
 	BUG_ON(alloc->vma);
 
+	binder_alloc_drain_cache_locked(alloc);
+	free_percpu(alloc->cache);
+	alloc->cache = NULL;
+
 	while ((n = rb_first(&alloc->allocated_buffers))) {
 		buffer = rb_entry(n, struct binder_buffer, rb_node);
 
@@ -824,13 +1186,14 @@ void binder_alloc_deferred_release(struct binder_alloc *alloc)
 				     __func__, alloc->pid, i, page_addr,
 				     on_lru ? "on lru" : "active");
 			unmap_kernel_range((unsigned long)page_addr, PAGE_SIZE);
-			__free_page(alloc->pages[i].page_ptr);
+			binder_alloc_put_page(alloc, alloc->pages[i].page_ptr);
 			page_count++;
 		}
 		kfree(alloc->pages);
 		vfree(alloc->buffer);
 	}
 	mutex_unlock(&alloc->mutex);
+	mem_cgroup_put(alloc->memcg);
 	if (alloc->vma_vm_mm)
 		mmdrop(alloc->vma_vm_mm);
 
@@ -861,11 +1224,15 @@ void binder_alloc_print_allocated(struct seq_file *m,
 				  struct binder_alloc *alloc)
 {
 	struct rb_node *n;
+	struct binder_buffer *buffer;
 
 	mutex_lock(&alloc->mutex);
-	for (n = rb_first(&alloc->allocated_buffers); n != NULL; n = rb_next(n))
-		print_binder_buffer(m, "  buffer",
-				    rb_entry(n, struct binder_buffer, rb_node));
+	for (n = rb_first(&alloc->allocated_buffers); n != NULL;
+	     n = rb_next(n)) {
+		buffer = rb_entry(n, struct binder_buffer, rb_node);
+		if (!buffer->cached)
+			print_binder_buffer(m, "  buffer", buffer);
+	}
 	mutex_unlock(&alloc->mutex);
 }
 
@@ -898,6 +1265,34 @@ void binder_alloc_print_pages(struct seq_file *m,
 	seq_printf(m, "  pages high watermark: %zu\n", alloc->pages_high);
 }
 
+/**
+ * binder_alloc_get_free_stats() - report free address space
+ * @alloc:   binder_alloc for this proc
+ * @total:   returns the number of free bytes
+ * @largest: returns the size of the largest free buffer
+ * @count:   returns the number of free buffers
+ */
+void binder_alloc_get_free_stats(struct binder_alloc *alloc, size_t *total,
+				 size_t *largest, int *count)
+{
+	struct rb_node *n;
+	size_t buffer_size;
+
+	*total = 0;
+	*largest = 0;
+	*count = 0;
+	mutex_lock(&alloc->mutex);
+	for (n = rb_first(&alloc->free_buffers); n != NULL; n = rb_next(n)) {
+		buffer_size = binder_alloc_buffer_size(alloc,
+				rb_entry(n, struct binder_buffer, rb_node));
+		*total += buffer_size;
+		if (buffer_size > *largest)
+			*largest = buffer_size;
+		(*count)++;
+	}
+	mutex_unlock(&alloc->mutex);
+}
+
 /**
  * binder_alloc_get_allocated_count() - return count of buffers
  * @alloc: binder_alloc for this proc
@@ -911,7 +1306,8 @@ int binder_alloc_get_allocated_count(struct binder_alloc *alloc)
 
 	mutex_lock(&alloc->mutex);
 	for (n = rb_first(&alloc->allocated_buffers); n != NULL; n = rb_next(n))
-		count++;
+		if (!rb_entry(n, struct binder_buffer, rb_node)->cached)
+			count++;
 	mutex_unlock(&alloc->mutex);
 	return count;
 }
@@ -990,7 +1386,7 @@ enum lru_status binder_alloc_free_page(struct list_head *item,
 	trace_binder_unmap_kernel_start(alloc, index);
 
 	unmap_kernel_range(page_addr, PAGE_SIZE);
-	__free_page(page->page_ptr);
+	binder_alloc_put_page(alloc, page->page_ptr);
 	page->page_ptr = NULL;
 
 	trace_binder_unmap_kernel_end(alloc, index);
@@ -1011,7 +1407,7 @@ enum lru_status binder_alloc_free_page(struct list_head *item,
 static unsigned long
 binder_shrink_count(struct shrinker *shrink, struct shrink_control *sc)
 {
-	unsigned long ret = list_lru_count(&binder_alloc_lru);
+	unsigned long ret = list_lru_shrink_count(&binder_alloc_lru, sc);
 	return ret;
 }
 
@@ -1020,15 +1416,20 @@ binder_shrink_scan(struct shrinker *shrink, struct shrink_control *sc)
 {
 	unsigned long ret;
 
-	ret = list_lru_walk(&binder_alloc_lru, binder_alloc_free_page,
-			    NULL, sc->nr_to_scan);
+	ret = list_lru_shrink_walk(&binder_alloc_lru, sc,
+				   binder_alloc_free_page, NULL);
 	return ret;
 }
 
+/*
+ * Unused pages sit on the list of the memcg they are charged to, so
+ * memcg reclaim only takes binder pages from the processes under pressure.
+ */
 static struct shrinker binder_shrinker = {
 	.count_objects = binder_shrink_count,
 	.scan_objects = binder_shrink_scan,
 	.seeks = DEFAULT_SEEKS,
+	.flags = SHRINKER_NUMA_AWARE | SHRINKER_MEMCG_AWARE,
 };
 
 /**
@@ -1042,17 +1443,23 @@ void binder_alloc_init(struct binder_alloc *alloc)
 {
 	alloc->pid = current->group_leader->pid;
 	mutex_init(&alloc->mutex);
+	spin_lock_init(&alloc->async_lock);
 	INIT_LIST_HEAD(&alloc->buffers);
 }
 
 int binder_alloc_shrinker_init(void)
 {
-	int ret = list_lru_init(&binder_alloc_lru);
+	int ret = prealloc_shrinker(&binder_shrinker);
+
+	if (ret)
+		return ret;
 
-	if (ret == 0) {
-		ret = register_shrinker(&binder_shrinker);
-		if (ret)
-			list_lru_destroy(&binder_alloc_lru);
+	ret = list_lru_init_memcg(&binder_alloc_lru, &binder_shrinker);
+	if (ret) {
+		free_prealloced_shrinker(&binder_shrinker);
+		return ret;
 	}
-	return ret;
+
+	register_shrinker_prepared(&binder_shrinker);
+	return 0;
 }
@@ -22,6 +22,9 @@
 #include <linux/vmalloc.h>
 #include <linux/slab.h>
 #include <linux/list_lru.h>
+#include <linux/memcontrol.h>
+#include <linux/percpu.h>
+#include <linux/spinlock.h>
 
 extern struct list_lru binder_alloc_lru;
 struct binder_transaction;
@@ -40,6 +43,7 @@ struct binder_transaction;
  * @offsets_size:       describe the second member of struct blah,
  * @extra_buffers_size: describe the second member of struct blah,
  * @data:i              describe the second member of struct blah,
+ * @cached:             buffer is parked in a per-CPU cache of @alloc
  *
  * Bookkeeping structure for binder transaction buffers
  */
@@ -52,6 +56,7 @@ struct binder_buffer {
 	unsigned async_transaction:1;
 	unsigned free_in_progress:1;
 	unsigned debug_id:28;
+	unsigned cached:1;
 
 	struct binder_transaction *transaction;
 
@@ -74,6 +79,30 @@ struct binder_lru_page {
 	struct binder_alloc *alloc;
 };
 
+#define BINDER_ALLOC_BATCH_ORDER	4
+#define BINDER_ALLOC_BATCH		(1 << BINDER_ALLOC_BATCH_ORDER)
+
+#define BINDER_ALLOC_CACHE_SLOTS	4
+#define BINDER_ALLOC_CACHE_MAX_SIZE	(PAGE_SIZE / 4)
+
+/**
+ * struct binder_alloc_cache - per-CPU cache of recently freed small buffers
+ * @lock:    protects @count and @slots, normally only taken by the local CPU
+ * @count:   number of valid entries in @slots
+ * @slots:   cached buffers and the size each of them can hold
+ *
+ * Cached buffers stay in allocated_buffers with their pages mapped and off
+ * the lru, so they can be handed out again without taking alloc->mutex.
+ */
+struct binder_alloc_cache {
+	spinlock_t lock;
+	unsigned int count;
+	struct {
+		struct binder_buffer *buffer;
+		size_t size;
+	} slots[BINDER_ALLOC_CACHE_SLOTS];
+};
+
 /**
  * struct binder_alloc - per-binder proc state for binder allocator
  * @vma:                vm_area_struct passed to mmap_handler
@@ -89,10 +118,15 @@ struct binder_lru_page {
  * @allocated_buffers:  rb tree of allocated buffers sorted by address
  * @free_async_space:   VA space available for async buffers. This is
  *                      initialized at mmap time to 1/2 the full VA space
+ * @async_lock:         protects @free_async_space
+ * @cache:              per-CPU caches of small free buffers, or %NULL
  * @pages:              array of binder_lru_page
  * @buffer_size:        size of address space specified via mmap
  * @pid:                pid for associated binder_proc (invariant after init)
  * @pages_high:         high watermark of offset in @pages
+ * @pinned_pages:       number of leading pages never put on the lru
+ * @memcg:              memcg of the process which mapped the buffer, the
+ *                      pages are charged to it (invariant after mmap)
  *
  * Bookkeeping structure for per-proc address space management for binder
  * buffers. It is normally initialized during binder_init() and binder_mmap()
@@ -109,11 +143,15 @@ struct binder_alloc {
 	struct rb_root free_buffers;
 	struct rb_root allocated_buffers;
 	size_t free_async_space;
+	spinlock_t async_lock;
+	struct binder_alloc_cache __percpu *cache;
 	struct binder_lru_page *pages;
 	size_t buffer_size;
 	uint32_t buffer_free;
 	int pid;
 	size_t pages_high;
+	size_t pinned_pages;
+	struct mem_cgroup *memcg;
 };
 
 #ifdef CONFIG_ANDROID_BINDER_IPC_SELFTEST
@@ -140,7 +178,11 @@ extern void binder_alloc_free_buf(struct binder_alloc *alloc,
 extern int binder_alloc_mmap_handler(struct binder_alloc *alloc,
 				     struct vm_area_struct *vma);
 extern void binder_alloc_deferred_release(struct binder_alloc *alloc);
+extern void binder_alloc_drain_cache(struct binder_alloc *alloc);
 extern int binder_alloc_get_allocated_count(struct binder_alloc *alloc);
+extern void binder_alloc_get_free_stats(struct binder_alloc *alloc,
+					size_t *total, size_t *largest,
+					int *count);
 extern void binder_alloc_print_allocated(struct seq_file *m,
 					 struct binder_alloc *alloc);
 void binder_alloc_print_pages(struct seq_file *m,
@@ -157,9 +199,9 @@ binder_alloc_get_free_async_space(struct binder_alloc *alloc)
 {
 	size_t free_async_space;
 
-	mutex_lock(&alloc->mutex);
+	spin_lock(&alloc->async_lock);
 	free_async_space = alloc->free_async_space;
-	mutex_unlock(&alloc->mutex);
+	spin_unlock(&alloc->async_lock);
 	return free_async_space;
 }
 
@@ -19,15 +19,33 @@
 
 #include <linux/mm_types.h>
 #include <linux/err.h>
+#include <linux/ktime.h>
+#include <linux/moduleparam.h>
+#include <linux/random.h>
+#include <linux/sched.h>
 #include "binder_alloc.h"
 
 #define BUFFER_NUM 5
 #define BUFFER_MIN_SIZE (PAGE_SIZE / 8)
 
+#define BENCH_ITERATIONS 10000
+#define BENCH_LIVE_BUFFERS 64
+#define BENCH_REPORTS 10
+#define BENCH_COLD_BUFFERS 32
+#define BENCH_BUCKETS 16
+
 static bool binder_selftest_run = true;
 static int binder_selftest_failures;
 static DEFINE_MUTEX(binder_selftest_lock);
 
+/*
+ * Run the allocator benchmark once, on the next binder proc that
+ * issues an ioctl after mmap. Cleared again when the run is done.
+ * The shrinker phase reclaims all unused binder pages system-wide.
+ */
+static bool binder_selftest_benchmark;
+module_param_named(benchmark, binder_selftest_benchmark, bool, 0644);
+
 /**
  * enum buf_end_align_type - Page alignment of a buffer
  * end with regard to the end of the previous buffer.
@@ -145,6 +163,8 @@ static void binder_selftest_free_buf(struct binder_alloc *alloc,
 
 	for (i = 0; i < BUFFER_NUM; i++)
 		binder_alloc_free_buf(alloc, buffers[seq[i]]);
+	/* Small buffers may be parked in the per-CPU cache */
+	binder_alloc_drain_cache(alloc);
 
 	for (i = 0; i < end / PAGE_SIZE; i++) {
 		/**
@@ -279,6 +299,242 @@ static void binder_selftest_alloc_offset(struct binder_alloc *alloc,
 	}
 }
 
+/*
+ * Size mix modelled on small HAL calls with an occasional large
+ * parcel. Weights add up to 100.
+ */
+static const struct {
+	size_t size;
+	unsigned int weight;
+} binder_bench_sizes[] = {
+	{ 64, 40 },
+	{ 256, 25 },
+	{ 1024, 20 },
+	{ 4096, 10 },
+	{ 32768, 4 },
+	{ 131072, 1 },
+};
+
+struct binder_bench_stats {
+	const char *name;
+	u64 count;
+	u64 total_ns;
+	u64 min_ns;
+	u64 max_ns;
+	u32 hist[BENCH_BUCKETS];	/* log2 of us */
+};
+
+static void binder_bench_init(struct binder_bench_stats *stats,
+			      const char *name)
+{
+	memset(stats, 0, sizeof(*stats));
+	stats->name = name;
+	stats->min_ns = U64_MAX;
+}
+
+static void binder_bench_add(struct binder_bench_stats *stats, u64 ns)
+{
+	unsigned int bucket = min_t(unsigned int, fls64(ns / NSEC_PER_USEC),
+				    BENCH_BUCKETS - 1);
+
+	stats->count++;
+	stats->total_ns += ns;
+	stats->min_ns = min(stats->min_ns, ns);
+	stats->max_ns = max(stats->max_ns, ns);
+	stats->hist[bucket]++;
+}
+
+static void binder_bench_report(struct binder_bench_stats *stats)
+{
+	int i, last = 0;
+
+	if (!stats->count) {
+		pr_info("bench %s: no samples\n", stats->name);
+		return;
+	}
+	pr_info("bench %s: %llu ops, min %llu avg %llu max %llu ns\n",
+		stats->name, stats->count, stats->min_ns,
+		div64_u64(stats->total_ns, stats->count), stats->max_ns);
+	for (i = 0; i < BENCH_BUCKETS; i++)
+		if (stats->hist[i])
+			last = i;
+	pr_info("bench %s: log2(us) histogram:", stats->name);
+	for (i = 0; i <= last; i++)
+		pr_cont(" %u", stats->hist[i]);
+	pr_cont("\n");
+}
+
+static size_t binder_bench_pick_size(struct rnd_state *rnd, size_t limit)
+{
+	unsigned int r = prandom_u32_state(rnd) % 100;
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(binder_bench_sizes) - 1; i++) {
+		if (r < binder_bench_sizes[i].weight)
+			break;
+		r -= binder_bench_sizes[i].weight;
+	}
+	return min(binder_bench_sizes[i].size, limit);
+}
+
+static struct binder_buffer *binder_bench_alloc(struct binder_alloc *alloc,
+						size_t size,
+						struct binder_bench_stats *stats)
+{
+	struct binder_buffer *buffer;
+	u64 start = ktime_get_ns();
+
+	buffer = binder_alloc_new_buf(alloc, size, 0, 0, 0);
+	if (!IS_ERR(buffer))
+		binder_bench_add(stats, ktime_get_ns() - start);
+	return buffer;
+}
+
+static void binder_bench_free(struct binder_alloc *alloc,
+			      struct binder_buffer *buffer,
+			      struct binder_bench_stats *stats)
+{
+	u64 start = ktime_get_ns();
+
+	binder_alloc_free_buf(alloc, buffer);
+	binder_bench_add(stats, ktime_get_ns() - start);
+}
+
+/* Back-to-back alloc and free, the common case for sync calls. */
+static void binder_bench_alloc_free(struct binder_alloc *alloc,
+				    struct rnd_state *rnd, size_t limit)
+{
+	struct binder_bench_stats alloc_stats, free_stats;
+	struct binder_buffer *buffer;
+	int i, failures = 0;
+	u64 start, elapsed;
+
+	binder_bench_init(&alloc_stats, "alloc");
+	binder_bench_init(&free_stats, "free");
+	start = ktime_get_ns();
+	for (i = 0; i < BENCH_ITERATIONS; i++) {
+		buffer = binder_bench_alloc(alloc,
+					    binder_bench_pick_size(rnd, limit),
+					    &alloc_stats);
+		if (IS_ERR(buffer))
+			failures++;
+		else
+			binder_bench_free(alloc, buffer, &free_stats);
+		cond_resched();
+	}
+	elapsed = ktime_get_ns() - start;
+	binder_bench_report(&alloc_stats);
+	binder_bench_report(&free_stats);
+	pr_info("bench alloc/free: %llu pairs/s, %d failures\n",
+		div64_u64((u64)BENCH_ITERATIONS * NSEC_PER_SEC, elapsed ?: 1),
+		failures);
+}
+
+static void binder_bench_report_free_space(struct binder_alloc *alloc, int i)
+{
+	size_t total, largest;
+	int count;
+
+	binder_alloc_get_free_stats(alloc, &total, &largest, &count);
+	pr_info("bench fragmentation: after %d ops free %zu in %d chunks, largest %zu (%zu%% fragmented)\n",
+		i, total, count, largest,
+		total ? 100 - largest * 100 / total : 0);
+}
+
+/*
+ * Keep a window of live buffers that are replaced at random, the
+ * pattern of oneway calls and long-held buffers, and watch how the
+ * free space breaks up over time.
+ */
+static void binder_bench_fragmentation(struct binder_alloc *alloc,
+				       struct rnd_state *rnd, size_t limit)
+{
+	struct binder_buffer *live[BENCH_LIVE_BUFFERS] = { NULL };
+	struct binder_bench_stats alloc_stats, free_stats;
+	int i, slot, failures = 0;
+
+	binder_bench_init(&alloc_stats, "fragmented alloc");
+	binder_bench_init(&free_stats, "fragmented free");
+	for (i = 0; i < BENCH_ITERATIONS; i++) {
+		slot = prandom_u32_state(rnd) % BENCH_LIVE_BUFFERS;
+		if (live[slot])
+			binder_bench_free(alloc, live[slot], &free_stats);
+		live[slot] = binder_bench_alloc(alloc,
+					binder_bench_pick_size(rnd, limit),
+					&alloc_stats);
+		if (IS_ERR(live[slot])) {
+			live[slot] = NULL;
+			failures++;
+		}
+		if ((i + 1) % (BENCH_ITERATIONS / BENCH_REPORTS) == 0)
+			binder_bench_report_free_space(alloc, i + 1);
+		cond_resched();
+	}
+	for (slot = 0; slot < BENCH_LIVE_BUFFERS; slot++)
+		if (live[slot])
+			binder_alloc_free_buf(alloc, live[slot]);
+	binder_bench_report(&alloc_stats);
+	binder_bench_report(&free_stats);
+	pr_info("bench fragmentation: %d failures\n", failures);
+}
+
+/*
+ * Compare allocations whose pages are still on the binder lru with
+ * allocations that have to fault pages back in after the shrinker
+ * reclaimed them.
+ */
+static void binder_bench_shrinker(struct binder_alloc *alloc)
+{
+	struct binder_buffer *buffers[BENCH_COLD_BUFFERS];
+	struct binder_bench_stats warm, cold;
+	size_t size = PAGE_SIZE * 2;
+	unsigned long count;
+	int i, round;
+
+	if (size * BENCH_COLD_BUFFERS > alloc->buffer_size / 2)
+		return;
+
+	binder_bench_init(&warm, "lru alloc");
+	binder_bench_init(&cold, "reclaimed alloc");
+	for (round = 0; round < BENCH_ITERATIONS / BENCH_COLD_BUFFERS;
+	     round++) {
+		bool reclaim = round & 1;
+
+		if (reclaim) {
+			binder_alloc_drain_cache(alloc);
+			while ((count = list_lru_count(&binder_alloc_lru)))
+				list_lru_walk(&binder_alloc_lru,
+					      binder_alloc_free_page,
+					      NULL, count);
+		}
+		for (i = 0; i < BENCH_COLD_BUFFERS; i++)
+			buffers[i] = binder_bench_alloc(alloc, size,
+						reclaim ? &cold : &warm);
+		for (i = 0; i < BENCH_COLD_BUFFERS; i++)
+			if (!IS_ERR(buffers[i]))
+				binder_alloc_free_buf(alloc, buffers[i]);
+		cond_resched();
+	}
+	binder_bench_report(&warm);
+	binder_bench_report(&cold);
+}
+
+static void binder_selftest_bench(struct binder_alloc *alloc)
+{
+	struct rnd_state rnd;
+	size_t limit = alloc->buffer_size / (BENCH_LIVE_BUFFERS * 2);
+
+	pr_info("benchmark STARTED\n");
+	prandom_seed_state(&rnd, 0x62696e646572ULL);
+	binder_bench_alloc_free(alloc, &rnd, limit);
+	binder_alloc_drain_cache(alloc);
+	binder_bench_fragmentation(alloc, &rnd, limit);
+	binder_alloc_drain_cache(alloc);
+	binder_bench_shrinker(alloc);
+	binder_alloc_drain_cache(alloc);
+	pr_info("benchmark DONE\n");
+}
+
 /**
  * binder_selftest_alloc() - Test alloc and free of buffer pages.
  * @alloc: Pointer to alloc struct.
@@ -287,23 +543,33 @@ static void binder_selftest_alloc_offset(struct binder_alloc *alloc,
  * then free them in all orders possible. Check that pages are
  * correctly allocated, put onto lru when buffers are freed, and
  * are freed when binder_alloc_free_page is called.
+ *
+ * If the benchmark module parameter is set, also measure alloc and
+ * free latency for a realistic size mix, fragmentation over time and
+ * the cost of refaulting pages reclaimed by the shrinker.
  */
 void binder_selftest_alloc(struct binder_alloc *alloc)
 {
 	size_t end_offset[BUFFER_NUM];
 
-	if (!binder_selftest_run)
+	if (!binder_selftest_run && !READ_ONCE(binder_selftest_benchmark))
 		return;
 	mutex_lock(&binder_selftest_lock);
-	if (!binder_selftest_run || !alloc->vma)
+	if (!alloc->vma)
 		goto done;
-	pr_info("STARTED\n");
-	binder_selftest_alloc_offset(alloc, end_offset, 0);
-	binder_selftest_run = false;
-	if (binder_selftest_failures > 0)
-		pr_info("%d tests FAILED\n", binder_selftest_failures);
-	else
-		pr_info("PASSED\n");
+	if (binder_selftest_run) {
+		pr_info("STARTED\n");
+		binder_selftest_alloc_offset(alloc, end_offset, 0);
+		binder_selftest_run = false;
+		if (binder_selftest_failures > 0)
+			pr_info("%d tests FAILED\n", binder_selftest_failures);
+		else
+			pr_info("PASSED\n");
+	}
+	if (binder_selftest_benchmark) {
+		binder_selftest_bench(alloc);
+		binder_selftest_benchmark = false;
+	}
 
 done:
 	mutex_unlock(&binder_selftest_lock);
@@ -64,6 +64,18 @@ static bool initcalls_done;
  */
 static bool defer_all_probes;
 
+/*
+ * driver_async_probe=<name>[,<name>...] lets built-in drivers that do not
+ * ask for it probe asynchronously, so that independent devices come up in
+ * parallel at boot. "*" selects all drivers; a name listed after "*" then
+ * keeps that driver synchronous. Ordering between the devices is left to
+ * device links and deferred probing, as it is for modules loaded with
+ * async_probe. Drivers with PROBE_FORCE_SYNCHRONOUS are never affected.
+ */
+#define ASYNC_DRV_NAMES_MAX_LEN	256
+static char async_probe_drv_names[ASYNC_DRV_NAMES_MAX_LEN];
+static bool async_probe_default;
+
 /*
  * deferred_probe_work_func() - Retry probing devices in the active list.
  */
@@ -228,6 +240,18 @@ static int __init deferred_probe_timeout_setup(char *str)
 }
 __setup("deferred_probe_timeout=", deferred_probe_timeout_setup);
 
+static int __init save_async_options(char *buf)
+{
+	if (strlen(buf) >= ASYNC_DRV_NAMES_MAX_LEN)
+		pr_warn("Too long list of driver names for 'driver_async_probe'!\n");
+
+	strlcpy(async_probe_drv_names, buf, ASYNC_DRV_NAMES_MAX_LEN);
+	async_probe_default = parse_option_str(async_probe_drv_names, "*");
+
+	return 1;
+}
+__setup("driver_async_probe=", save_async_options);
+
 /**
  * driver_deferred_probe_check_state() - Check deferred probe state
  * @dev: device to check
@@ -582,7 +606,8 @@ static int really_probe(struct device *dev, struct device_driver *drv)
 }
 
 /*
- * For initcall_debug, show the driver probe time.
+ * For initcall_debug, show the driver probe time. Asynchronous probes are
+ * tagged, their times overlap with the ones of other probes.
  */
 static int really_probe_debug(struct device *dev, struct device_driver *drv)
 {
@@ -593,8 +618,9 @@ static int really_probe_debug(struct device *dev, struct device_driver *drv)
 	ret = really_probe(dev, drv);
 	rettime = ktime_get();
 	delta = ktime_sub(rettime, calltime);
-	printk(KERN_DEBUG "probe of %s returned %d after %lld usecs\n",
-	       dev_name(dev), ret, (s64) ktime_to_us(delta));
+	printk(KERN_DEBUG "probe of %s with driver %s returned %d after %lld usecs%s\n",
+	       dev_name(dev), drv->name, ret, (s64) ktime_to_us(delta),
+	       current_is_async() ? " (async)" : "");
 	return ret;
 }
 
@@ -669,6 +695,12 @@ int driver_probe_device(struct device_driver *drv, struct device *dev)
 	return ret;
 }
 
+static bool cmdline_requested_async_probing(const char *drv_name)
+{
+	return parse_option_str(async_probe_drv_names, drv_name) !=
+		async_probe_default;
+}
+
 bool driver_allows_async_probing(struct device_driver *drv)
 {
 	switch (drv->probe_type) {
@@ -679,6 +711,9 @@ bool driver_allows_async_probing(struct device_driver *drv)
 		return false;
 
 	default:
+		if (cmdline_requested_async_probing(drv->name))
+			return true;
+
 		if (module_requested_async_probing(drv->owner))
 			return true;
 
@@ -186,34 +186,73 @@ static inline void virtblk_request_done(struct request *req)
 	blk_mq_end_request(req, virtblk_result(vbr));
 }
 
-static void virtblk_done(struct virtqueue *vq)
+/*
+ * Complete the finished requests of a virtqueue, with the queue lock held.
+ * Returns the number of completions, *found is set if one of them had the
+ * driver tag @tag when @found is not NULL.
+ */
+static int virtblk_complete_vq(struct virtio_blk *vblk, int qid,
+			       unsigned int tag, bool *found)
 {
-	struct virtio_blk *vblk = vq->vdev->priv;
-	bool req_done = false;
-	int qid = vq->index;
+	struct virtqueue *vq = vblk->vqs[qid].vq;
 	struct virtblk_req *vbr;
-	unsigned long flags;
 	unsigned int len;
+	int done = 0;
 
-	spin_lock_irqsave(&vblk->vqs[qid].lock, flags);
 	do {
 		virtqueue_disable_cb(vq);
-		while ((vbr = virtqueue_get_buf(vblk->vqs[qid].vq, &len)) != NULL) {
+		while ((vbr = virtqueue_get_buf(vq, &len)) != NULL) {
 			struct request *req = blk_mq_rq_from_pdu(vbr);
 
+			if (found && req->tag == tag)
+				*found = true;
 			blk_mq_complete_request(req);
-			req_done = true;
+			done++;
 		}
 		if (unlikely(virtqueue_is_broken(vq)))
 			break;
 	} while (!virtqueue_enable_cb(vq));
 
 	/* In case queue is stopped waiting for more buffers. */
-	if (req_done)
+	if (done)
 		blk_mq_start_stopped_hw_queues(vblk->disk->queue, true);
+
+	return done;
+}
+
+static void virtblk_done(struct virtqueue *vq)
+{
+	struct virtio_blk *vblk = vq->vdev->priv;
+	int qid = vq->index;
+	unsigned long flags;
+
+	spin_lock_irqsave(&vblk->vqs[qid].lock, flags);
+	virtblk_complete_vq(vblk, qid, 0, NULL);
 	spin_unlock_irqrestore(&vblk->vqs[qid].lock, flags);
 }
 
+/*
+ * Reap the completions of a hardware queue from the task waiting on a
+ * polled request, instead of waiting for the host to inject the virtqueue
+ * interrupt and for the interrupt handler to wake the task up.
+ */
+static int virtblk_poll(struct blk_mq_hw_ctx *hctx, unsigned int tag)
+{
+	struct virtio_blk *vblk = hctx->queue->queuedata;
+	int qid = hctx->queue_num;
+	unsigned long flags;
+	bool found = false;
+
+	/* The interrupt handler is already at it */
+	if (!spin_trylock_irqsave(&vblk->vqs[qid].lock, flags))
+		return 0;
+
+	virtblk_complete_vq(vblk, qid, tag, &found);
+	spin_unlock_irqrestore(&vblk->vqs[qid].lock, flags);
+
+	return found;
+}
+
 static blk_status_t virtio_queue_rq(struct blk_mq_hw_ctx *hctx,
 			   const struct blk_mq_queue_data *bd)
 {
@@ -619,6 +658,7 @@ static const struct blk_mq_ops virtio_mq_ops = {
 	.initialize_rq_fn = virtblk_initialize_rq,
 #endif
 	.map_queues	= virtblk_map_queues,
+	.poll		= virtblk_poll,
 };
 
 static unsigned int virtblk_queue_depth;
@@ -23,6 +23,7 @@
 #include <linux/list.h>
 #include <linux/cpu.h>
 #include <linux/cpufreq.h>
+#include <linux/energy_model.h>
 #include <linux/sysfs.h>
 #include <linux/types.h>
 #include <linux/fs.h>
@@ -226,6 +227,7 @@ struct global_params {
  * @last_io_update:	Last time when IO wake flag was set
  * @sched_flags:	Store scheduler flags for possible cross CPU update
  * @hwp_boost_min:	Last HWP boosted min performance
+ * @epp_boost_state:	Last EPP boost applied from the schedtune boost
  *
  * This structure stores per CPU instance data for all CPUs.
  */
@@ -263,6 +265,7 @@ struct cpudata {
 	u64 last_io_update;
 	unsigned int sched_flags;
 	u32 hwp_boost_min;
+	s8 epp_boost_state;
 };
 
 static struct cpudata **all_cpu_data;
@@ -297,6 +300,7 @@ static int hwp_active __read_mostly;
 static int hwp_mode_bdw __read_mostly;
 static bool per_cpu_limits __read_mostly;
 static bool hwp_boost __read_mostly;
+static bool hwp_epp_boost __read_mostly;
 
 static struct cpufreq_driver *intel_pstate_driver __read_mostly;
 
@@ -638,6 +642,13 @@ static int intel_pstate_set_energy_pref_index(struct cpudata *cpu_data,
 
 		value |= (u64)epp << 24;
 		ret = wrmsrl_on_cpu(cpu_data->cpu, MSR_HWP_REQUEST, value);
+
+		/* the EPP boost works on top of the new preference */
+		value = READ_ONCE(cpu_data->hwp_req_cached);
+		value &= ~GENMASK_ULL(31, 24);
+		value |= (u64)epp << 24;
+		WRITE_ONCE(cpu_data->hwp_req_cached, value);
+		WRITE_ONCE(cpu_data->epp_boost_state, 0);
 	} else {
 		if (epp == -EINVAL)
 			epp = (pref_index - 1) << 2;
@@ -735,6 +746,13 @@ static void intel_pstate_hwp_set(unsigned int cpu)
 
 	rdmsrl_on_cpu(cpu, MSR_HWP_REQUEST, &value);
 
+	/* don't take a boosted EPP for the configured one */
+	if (READ_ONCE(cpu_data->epp_boost_state)) {
+		value &= ~GENMASK_ULL(31, 24);
+		value |= READ_ONCE(cpu_data->hwp_req_cached) &
+			 GENMASK_ULL(31, 24);
+	}
+
 	value &= ~HWP_MIN_PERF(~0L);
 	value |= HWP_MIN_PERF(min);
 
@@ -788,6 +806,7 @@ static void intel_pstate_hwp_set(unsigned int cpu)
 skip_epp:
 	WRITE_ONCE(cpu_data->hwp_req_cached, value);
 	wrmsrl_on_cpu(cpu, MSR_HWP_REQUEST, value);
+	WRITE_ONCE(cpu_data->epp_boost_state, 0);
 }
 
 static int intel_pstate_hwp_save_state(struct cpufreq_policy *policy)
@@ -1068,6 +1087,33 @@ static ssize_t store_hwp_dynamic_boost(struct kobject *a, struct attribute *b,
 	return count;
 }
 
+static ssize_t show_hwp_epp_boost(struct kobject *kobj,
+				  struct attribute *attr, char *buf)
+{
+	return sprintf(buf, "%u\n", hwp_epp_boost);
+}
+
+static ssize_t store_hwp_epp_boost(struct kobject *a, struct attribute *b,
+				   const char *buf, size_t count)
+{
+	unsigned int input;
+	int ret;
+
+	ret = kstrtouint(buf, 10, &input);
+	if (ret)
+		return ret;
+
+	if (!IS_ENABLED(CONFIG_SCHED_TUNE))
+		return -EOPNOTSUPP;
+
+	mutex_lock(&intel_pstate_driver_lock);
+	hwp_epp_boost = !!input;
+	intel_pstate_update_policies();
+	mutex_unlock(&intel_pstate_driver_lock);
+
+	return count;
+}
+
 show_one(max_perf_pct, max_perf_pct);
 show_one(min_perf_pct, min_perf_pct);
 
@@ -1078,6 +1124,7 @@ define_one_global_rw(min_perf_pct);
 define_one_global_ro(turbo_pct);
 define_one_global_ro(num_pstates);
 define_one_global_rw(hwp_dynamic_boost);
+define_one_global_rw(hwp_epp_boost);
 
 static struct attribute *intel_pstate_attributes[] = {
 	&status.attr,
@@ -1122,6 +1169,10 @@ static void __init intel_pstate_sysfs_expose_params(void)
 		rc = sysfs_create_file(intel_pstate_kobject,
 				       &hwp_dynamic_boost.attr);
 		WARN_ON(rc);
+
+		rc = sysfs_create_file(intel_pstate_kobject,
+				       &hwp_epp_boost.attr);
+		WARN_ON(rc);
 	}
 }
 /************************** sysfs end ************************/
@@ -1542,6 +1593,47 @@ static inline void intel_pstate_update_util_hwp_local(struct cpudata *cpu,
 	}
 }
 
+/*
+ * EPP boost: follow the schedtune boost of what is RUNNABLE on the CPU.
+ * Boosted groups (e.g. top-app) get the performance EPP and at least the
+ * guaranteed performance as HWP min, everything else runs with no more
+ * than balance_power. The request MSR is only written when this changes.
+ */
+#ifdef CONFIG_SCHED_TUNE
+static inline void intel_pstate_hwp_epp_boost(struct cpudata *cpu)
+{
+	u64 hwp_req = READ_ONCE(cpu->hwp_req_cached);
+	s8 state = schedtune_cpu_boost(cpu->cpu) > 0 ? 1 : -1;
+	u32 max_limit, min_limit, guaranteed;
+	u64 epp;
+
+	if (state == cpu->epp_boost_state)
+		return;
+
+	epp = (hwp_req >> 24) & 0xff;
+	if (state > 0) {
+		max_limit = (hwp_req & 0xff00) >> 8;
+		min_limit = hwp_req & 0xff;
+		guaranteed = HWP_GUARANTEED_PERF(cpu->hwp_cap_cached);
+
+		if (min_limit < guaranteed)
+			min_limit = min(guaranteed, max_limit);
+		hwp_req = (hwp_req & ~GENMASK_ULL(7, 0)) | min_limit;
+		epp = HWP_EPP_PERFORMANCE;
+	} else if (epp < HWP_EPP_BALANCE_POWERSAVE) {
+		epp = HWP_EPP_BALANCE_POWERSAVE;
+	}
+
+	if (static_cpu_has(X86_FEATURE_HWP_EPP))
+		hwp_req = (hwp_req & ~GENMASK_ULL(31, 24)) | epp << 24;
+
+	wrmsrl(MSR_HWP_REQUEST, hwp_req);
+	cpu->epp_boost_state = state;
+}
+#else
+static inline void intel_pstate_hwp_epp_boost(struct cpudata *cpu) { }
+#endif
+
 static inline void intel_pstate_update_util_hwp(struct update_util_data *data,
 						u64 time, unsigned int flags)
 {
@@ -1549,7 +1641,13 @@ static inline void intel_pstate_update_util_hwp(struct update_util_data *data,
 
 	cpu->sched_flags |= flags;
 
-	if (smp_processor_id() == cpu->cpu)
+	if (smp_processor_id() != cpu->cpu)
+		return;
+
+	/* Both drive the HWP min, the EPP boost takes precedence */
+	if (hwp_epp_boost)
+		intel_pstate_hwp_epp_boost(cpu);
+	else
 		intel_pstate_update_util_hwp_local(cpu, time);
 }
 
@@ -1866,7 +1964,7 @@ static void intel_pstate_set_update_util_hook(unsigned int cpu_num)
 {
 	struct cpudata *cpu = all_cpu_data[cpu_num];
 
-	if (hwp_active && !hwp_boost)
+	if (hwp_active && !hwp_boost && !hwp_epp_boost)
 		return;
 
 	if (cpu->update_util_set)
@@ -1995,7 +2093,7 @@ static int intel_pstate_set_policy(struct cpufreq_policy *policy)
 		 * was turned off, in that case we need to clear the
 		 * update util hook.
 		 */
-		if (!hwp_boost)
+		if (!hwp_boost && !hwp_epp_boost)
 			intel_pstate_clear_update_util_hook(policy->cpu);
 		intel_pstate_hwp_set(policy->cpu);
 	}
@@ -2059,6 +2157,93 @@ static int intel_pstate_cpu_exit(struct cpufreq_policy *policy)
 	return 0;
 }
 
+#ifdef CONFIG_X86_INTEL_PSTATE_EM
+/*
+ * HWP does not expose power numbers, so the energy model registered for EAS
+ * is synthesized from the performance levels. Dynamic power goes roughly as
+ * C * f * V^2 and V grows about linearly with f in the turbo range, so the
+ * power of a state is taken as perf^3. The switched capacitance C is taken
+ * proportional to the highest performance level of the core, which makes a
+ * small (Atom) core cheaper than a big (Core) one at the same perf level.
+ * Only the ratios between states and cores matter to the scheduler.
+ */
+#define INTEL_PSTATE_EM_MAX_STATES	6
+#define INTEL_PSTATE_EM_POWER_SHIFT	10
+
+static int intel_pstate_em_nr_states(struct cpudata *cpu)
+{
+	int lowest = cpu->pstate.min_pstate;
+	int highest = HWP_HIGHEST_PERF(READ_ONCE(cpu->hwp_cap_cached));
+
+	if (highest <= lowest)
+		return 1;
+
+	return min(highest - lowest + 1, INTEL_PSTATE_EM_MAX_STATES);
+}
+
+static int intel_pstate_em_state_perf(struct cpudata *cpu, int state,
+				      int nr_states)
+{
+	int lowest = cpu->pstate.min_pstate;
+	int highest = HWP_HIGHEST_PERF(READ_ONCE(cpu->hwp_cap_cached));
+
+	if (nr_states == 1)
+		return highest;
+
+	return lowest + (highest - lowest) * state / (nr_states - 1);
+}
+
+static int intel_pstate_em_active_power(unsigned long *power,
+					unsigned long *freq, int cpu_num)
+{
+	struct cpudata *cpu = all_cpu_data[cpu_num];
+	int nr_states = intel_pstate_em_nr_states(cpu);
+	int state, perf, highest;
+	u64 mw;
+
+	for (state = 0; state < nr_states; state++) {
+		perf = intel_pstate_em_state_perf(cpu, state, nr_states);
+		if (perf * cpu->pstate.scaling >= *freq)
+			break;
+	}
+	if (state == nr_states)
+		return -EINVAL;
+
+	highest = HWP_HIGHEST_PERF(READ_ONCE(cpu->hwp_cap_cached));
+	mw = (u64)perf * perf * perf * highest;
+	mw >>= INTEL_PSTATE_EM_POWER_SHIFT;
+
+	*power = clamp_t(u64, mw, 1, EM_CPU_MAX_POWER);
+	*freq = perf * cpu->pstate.scaling;
+
+	return 0;
+}
+
+static void intel_pstate_register_em(struct cpufreq_policy *policy)
+{
+	struct em_data_callback em_cb =
+		EM_DATA_CB(intel_pstate_em_active_power);
+	struct cpudata *cpu = all_cpu_data[policy->cpu];
+
+	if (!hwp_active || hwp_mode_bdw)
+		return;
+
+	/*
+	 * Capacities must be known before the model is registered, as the
+	 * energy model checks them across the domain. Re-registration on
+	 * cpu online fails with -EEXIST and keeps the existing table.
+	 */
+	sched_set_itmt_core_capacity(HWP_HIGHEST_PERF(cpu->hwp_cap_cached),
+				     policy->cpu);
+	em_register_perf_domain(policy->cpus, intel_pstate_em_nr_states(cpu),
+				&em_cb);
+}
+#else
+static inline void intel_pstate_register_em(struct cpufreq_policy *policy)
+{
+}
+#endif
+
 static int __intel_pstate_cpu_init(struct cpufreq_policy *policy)
 {
 	struct cpudata *cpu;
@@ -2093,6 +2278,7 @@ static int __intel_pstate_cpu_init(struct cpufreq_policy *policy)
 	}
 
 	intel_pstate_init_acpi_perf_limits(policy);
+	intel_pstate_register_em(policy);
 
 	policy->fast_switch_possible = true;
 
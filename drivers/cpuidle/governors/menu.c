@@ -20,6 +20,7 @@
 #include <linux/sched/loadavg.h>
 #include <linux/sched/stat.h>
 #include <linux/math64.h>
+#include <linux/moduleparam.h>
 
 /*
  * Please note when changing the tuning values:
@@ -37,6 +38,14 @@
 #define DECAY 8
 #define MAX_INTERESTING 50000
 
+/*
+ * Fast mode tuning: samples are capped for the running sums of squares
+ * not to overflow, and a state is considered mispredicted when the CPU
+ * left it before its target residency MISS_LIMIT times in a row.
+ */
+#define FAST_SAMPLE_MAX (1U << 20)
+#define FAST_SLOTS 33
+#define MISS_LIMIT 2
 
 /*
  * Concepts and ideas behind the menu governor
@@ -116,6 +125,16 @@
  * The iowait factor may look low, but realize that this is also already
  * represented in the system load average.
  *
+ * Fast mode
+ * ---------
+ * With frequent short idle periods (interrupt heavy virtualization traffic
+ * for example) the cost of the selection itself matters. When the "fast"
+ * parameter is set, the typical interval is kept up to date with running
+ * sums at update time instead of being recomputed at each selection, the
+ * idle states are looked up in a table indexed by the log2 of the predicted
+ * duration instead of being walked, and a state the CPU repeatedly leaves
+ * before its target residency is replaced by the next shallower one until
+ * the prediction proves right again.
  */
 
 struct menu_device {
@@ -129,8 +148,19 @@ struct menu_device {
 	unsigned int	correction_factor[BUCKETS];
 	unsigned int	intervals[INTERVALS];
 	int		interval_ptr;
+
+	/* fast mode data */
+	u64		fast_sum;
+	u64		fast_sum_sq;
+	unsigned int	fast_samples[INTERVALS];
+	unsigned int	typical_us;
+	unsigned int	misses;
+	u8		state_table[FAST_SLOTS];
 };
 
+static bool menu_fast __read_mostly;
+module_param_named(fast, menu_fast, bool, 0644);
+
 
 #define LOAD_INT(x) ((x) >> FSHIFT)
 #define LOAD_FRAC(x) LOAD_INT(((x) & (FIXED_1-1)) * 100)
@@ -279,6 +309,134 @@ static unsigned int get_typical_interval(struct menu_device *data)
 	goto again;
 }
 
+static inline bool menu_state_disabled(struct cpuidle_driver *drv,
+				       struct cpuidle_device *dev, int i)
+{
+	return drv->states[i].disabled || dev->states_usage[i].disable;
+}
+
+/*
+ * Fast mode counterpart of get_typical_interval(), using the running sums
+ * maintained by menu_update() and without the outliers rejection rounds.
+ */
+static unsigned int menu_fast_typical_interval(struct menu_device *data)
+{
+	u64 avg = data->fast_sum >> INTERVAL_SHIFT;
+	u64 mean_sq = data->fast_sum_sq >> INTERVAL_SHIFT;
+	u64 variance = mean_sq > avg * avg ? mean_sq - avg * avg : 0;
+
+	if (avg * avg > variance * 36 || variance <= 400)
+		return avg;
+
+	return UINT_MAX;
+}
+
+/*
+ * Build the table giving, for each power of two of the predicted idle
+ * duration, the deepest state whose target residency fits in it. States
+ * are listed by increasing depth, so this only depends on the driver.
+ */
+static void menu_fast_build_table(struct cpuidle_driver *drv,
+				  struct menu_device *data)
+{
+	int slot, i, idx = 0;
+
+	for (slot = 0; slot < FAST_SLOTS; slot++) {
+		u64 lower = slot ? 1ULL << (slot - 1) : 0;
+
+		for (i = idx + 1; i < drv->state_count; i++) {
+			if (drv->states[i].target_residency > lower)
+				break;
+			idx = i;
+		}
+		data->state_table[slot] = idx;
+	}
+}
+
+static int menu_fast_select(struct cpuidle_driver *drv,
+			    struct cpuidle_device *dev, bool *stop_tick,
+			    int latency_req)
+{
+	struct menu_device *data = this_cpu_ptr(&menu_devices);
+	unsigned long nr_iowaiters, cpu_load;
+	unsigned int predicted_us;
+	ktime_t delta_next, sleep_length;
+	unsigned int divisor;
+	int first_idx = 0;
+	int idx;
+
+	sleep_length = tick_nohz_get_sleep_length(&delta_next);
+	data->next_timer_us = ktime_to_us(sleep_length);
+
+	get_iowait_load(&nr_iowaiters, &cpu_load);
+	data->bucket = which_bucket(data->next_timer_us, nr_iowaiters);
+
+	/* RESOLUTION * DECAY is a power of two */
+	predicted_us = ((u64)data->next_timer_us *
+			data->correction_factor[data->bucket]) >>
+		       ilog2(RESOLUTION * DECAY);
+	predicted_us = min3(predicted_us, data->typical_us,
+			    data->next_timer_us);
+
+	if (tick_nohz_tick_stopped()) {
+		/* See menu_select() */
+		if (predicted_us < TICK_USEC)
+			predicted_us = ktime_to_us(delta_next);
+	} else if (nr_iowaiters) {
+		/* Only pay for the division when the multiplier is not 1 */
+		divisor = performance_multiplier(nr_iowaiters, cpu_load);
+		latency_req = min_t(unsigned int, latency_req,
+				    predicted_us / divisor);
+	}
+	data->predicted_us = predicted_us;
+
+	if (drv->states[0].flags & CPUIDLE_FLAG_POLLING &&
+	    drv->state_count > 1) {
+		struct cpuidle_state *s = &drv->states[1];
+
+		/* Same polling avoidance as menu_select() */
+		if (data->next_timer_us > max_t(unsigned int, 20,
+						s->target_residency) &&
+		    latency_req > s->exit_latency &&
+		    !menu_state_disabled(drv, dev, 1))
+			first_idx = 1;
+	}
+
+	idx = data->state_table[min(fls(predicted_us), FAST_SLOTS - 1)];
+
+	/* Step away from a state we keep waking up from too early */
+	if (data->misses >= MISS_LIMIT && idx > first_idx)
+		idx--;
+
+	/* Walk down to a usable state, the table ignores the constraints */
+	while (idx > first_idx &&
+	       (menu_state_disabled(drv, dev, idx) ||
+		drv->states[idx].exit_latency > latency_req))
+		idx--;
+	if (idx < first_idx || menu_state_disabled(drv, dev, idx))
+		idx = menu_state_disabled(drv, dev, first_idx) ? 0 : first_idx;
+
+	/*
+	 * Don't stop the tick if the selected state is a polling one or if
+	 * its target residency is shorter than the tick period length.
+	 */
+	if (((drv->states[idx].flags & CPUIDLE_FLAG_POLLING) ||
+	     drv->states[idx].target_residency < TICK_USEC) &&
+	    !tick_nohz_tick_stopped()) {
+		unsigned int delta_next_us = ktime_to_us(delta_next);
+
+		*stop_tick = false;
+
+		while (idx > 0 &&
+		       drv->states[idx].target_residency > delta_next_us)
+			idx--;
+	}
+
+	data->last_state_idx = idx;
+
+	return idx;
+}
+
 /**
  * menu_select - selects the next idle state to enter
  * @drv: cpuidle driver containing state data
@@ -309,6 +467,9 @@ static int menu_select(struct cpuidle_driver *drv, struct cpuidle_device *dev,
 		return 0;
 	}
 
+	if (menu_fast)
+		return menu_fast_select(drv, dev, stop_tick, latency_req);
+
 	/* determine the expected residency time, round up */
 	data->next_timer_us = ktime_to_us(tick_nohz_get_sleep_length(&delta_next));
 
@@ -490,6 +651,7 @@ static void menu_update(struct cpuidle_driver *drv, struct cpuidle_device *dev)
 	struct cpuidle_state *target = &drv->states[last_idx];
 	unsigned int measured_us;
 	unsigned int new_factor;
+	unsigned int old_sample;
 
 	/*
 	 * Try to figure out how much time passed between entry to low
@@ -556,10 +718,26 @@ static void menu_update(struct cpuidle_driver *drv, struct cpuidle_device *dev)
 
 	data->correction_factor[data->bucket] = new_factor;
 
+	/* update the fast mode data */
+	if (last_idx > 0 && measured_us < target->target_residency)
+		data->misses = min(data->misses + 1, (unsigned int)MISS_LIMIT);
+	else
+		data->misses = 0;
+
+	new_factor = min(measured_us, FAST_SAMPLE_MAX);
+	old_sample = data->fast_samples[data->interval_ptr];
+	data->fast_sum += new_factor;
+	data->fast_sum -= old_sample;
+	data->fast_sum_sq += (u64)new_factor * new_factor;
+	data->fast_sum_sq -= (u64)old_sample * old_sample;
+	data->fast_samples[data->interval_ptr] = new_factor;
+
 	/* update the repeating-pattern data */
 	data->intervals[data->interval_ptr++] = measured_us;
 	if (data->interval_ptr >= INTERVALS)
 		data->interval_ptr = 0;
+
+	data->typical_us = menu_fast_typical_interval(data);
 }
 
 /**
@@ -582,6 +760,9 @@ static int menu_enable_device(struct cpuidle_driver *drv,
 	for(i = 0; i < BUCKETS; i++)
 		data->correction_factor[i] = RESOLUTION * DECAY;
 
+	data->typical_us = UINT_MAX;
+	menu_fast_build_table(drv, data);
+
 	return 0;
 }
 
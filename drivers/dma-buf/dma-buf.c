@@ -276,11 +276,35 @@ static __poll_t dma_buf_poll(struct file *file, poll_table *poll)
 	return events;
 }
 
+static int dma_buf_sync_direction(u64 flags,
+				  enum dma_data_direction *direction)
+{
+	if (flags & ~DMA_BUF_SYNC_VALID_FLAGS_MASK)
+		return -EINVAL;
+
+	switch (flags & DMA_BUF_SYNC_RW) {
+	case DMA_BUF_SYNC_READ:
+		*direction = DMA_FROM_DEVICE;
+		break;
+	case DMA_BUF_SYNC_WRITE:
+		*direction = DMA_TO_DEVICE;
+		break;
+	case DMA_BUF_SYNC_RW:
+		*direction = DMA_BIDIRECTIONAL;
+		break;
+	default:
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
 static long dma_buf_ioctl(struct file *file,
 			  unsigned int cmd, unsigned long arg)
 {
 	struct dma_buf *dmabuf;
 	struct dma_buf_sync sync;
+	struct dma_buf_sync_partial sync_partial;
 	enum dma_data_direction direction;
 	int ret;
 
@@ -291,28 +315,34 @@ static long dma_buf_ioctl(struct file *file,
 		if (copy_from_user(&sync, (void __user *) arg, sizeof(sync)))
 			return -EFAULT;
 
-		if (sync.flags & ~DMA_BUF_SYNC_VALID_FLAGS_MASK)
-			return -EINVAL;
-
-		switch (sync.flags & DMA_BUF_SYNC_RW) {
-		case DMA_BUF_SYNC_READ:
-			direction = DMA_FROM_DEVICE;
-			break;
-		case DMA_BUF_SYNC_WRITE:
-			direction = DMA_TO_DEVICE;
-			break;
-		case DMA_BUF_SYNC_RW:
-			direction = DMA_BIDIRECTIONAL;
-			break;
-		default:
-			return -EINVAL;
-		}
+		ret = dma_buf_sync_direction(sync.flags, &direction);
+		if (ret)
+			return ret;
 
 		if (sync.flags & DMA_BUF_SYNC_END)
 			ret = dma_buf_end_cpu_access(dmabuf, direction);
 		else
 			ret = dma_buf_begin_cpu_access(dmabuf, direction);
 
+		return ret;
+	case DMA_BUF_IOCTL_SYNC_PARTIAL:
+		if (copy_from_user(&sync_partial, (void __user *) arg,
+				   sizeof(sync_partial)))
+			return -EFAULT;
+
+		ret = dma_buf_sync_direction(sync_partial.flags, &direction);
+		if (ret)
+			return ret;
+
+		if (sync_partial.flags & DMA_BUF_SYNC_END)
+			ret = dma_buf_end_cpu_access_partial(dmabuf,
+					direction, sync_partial.offset,
+					sync_partial.len);
+		else
+			ret = dma_buf_begin_cpu_access_partial(dmabuf,
+					direction, sync_partial.offset,
+					sync_partial.len);
+
 		return ret;
 	default:
 		return -ENOTTY;
@@ -689,6 +719,12 @@ EXPORT_SYMBOL_GPL(dma_buf_unmap_attachment);
  *   Implementing the functions is optional for exporters and for importers all
  *   the restrictions of using kmap apply.
  *
+ *   When only a small part of a large buffer is touched, for example a few
+ *   lines of metadata, dma_buf_begin_cpu_access_partial() and
+ *   dma_buf_end_cpu_access_partial() limit the cache maintenance to the
+ *   given byte range. Userspace gets the same through
+ *   DMA_BUF_IOCTL_SYNC_PARTIAL.
+ *
  *   dma_buf kmap calls outside of the range specified in begin_cpu_access are
  *   undefined. If the range is not PAGE_SIZE aligned, kmap needs to succeed on
  *   the partial chunks at the beginning and end but may return stale or bogus
@@ -846,6 +882,84 @@ int dma_buf_end_cpu_access(struct dma_buf *dmabuf,
 }
 EXPORT_SYMBOL_GPL(dma_buf_end_cpu_access);
 
+static bool dma_buf_range_valid(struct dma_buf *dmabuf,
+				unsigned int offset, unsigned int len)
+{
+	return len && offset < dmabuf->size && len <= dmabuf->size - offset;
+}
+
+/**
+ * dma_buf_begin_cpu_access_partial - Like dma_buf_begin_cpu_access(), but
+ * only the given range of the buffer is made coherent for the cpu.
+ * @dmabuf:	[in]	buffer to prepare cpu access for.
+ * @direction:	[in]	direction of the cpu access.
+ * @offset:	[in]	offset in bytes of the range for cpu access.
+ * @len:	[in]	length of the range for cpu access.
+ *
+ * Exporters without a begin_cpu_access_partial callback get the whole buffer
+ * prepared. Access outside of the range must be bracketed by its own calls.
+ *
+ * Can return negative error values, returns 0 on success.
+ */
+int dma_buf_begin_cpu_access_partial(struct dma_buf *dmabuf,
+				     enum dma_data_direction direction,
+				     unsigned int offset, unsigned int len)
+{
+	int ret = 0;
+
+	if (WARN_ON(!dmabuf))
+		return -EINVAL;
+
+	if (!dma_buf_range_valid(dmabuf, offset, len))
+		return -EINVAL;
+
+	if (dmabuf->ops->begin_cpu_access_partial)
+		ret = dmabuf->ops->begin_cpu_access_partial(dmabuf, direction,
+							    offset, len);
+	else if (dmabuf->ops->begin_cpu_access)
+		ret = dmabuf->ops->begin_cpu_access(dmabuf, direction);
+
+	if (ret == 0)
+		ret = __dma_buf_begin_cpu_access(dmabuf, direction);
+
+	return ret;
+}
+EXPORT_SYMBOL_GPL(dma_buf_begin_cpu_access_partial);
+
+/**
+ * dma_buf_end_cpu_access_partial - Like dma_buf_end_cpu_access(), but only
+ * for the given range of the buffer.
+ * @dmabuf:	[in]	buffer to complete cpu access for.
+ * @direction:	[in]	direction of the cpu access.
+ * @offset:	[in]	offset in bytes of the range for cpu access.
+ * @len:	[in]	length of the range for cpu access.
+ *
+ * This terminates CPU access started with dma_buf_begin_cpu_access_partial().
+ *
+ * Can return negative error values, returns 0 on success.
+ */
+int dma_buf_end_cpu_access_partial(struct dma_buf *dmabuf,
+				   enum dma_data_direction direction,
+				   unsigned int offset, unsigned int len)
+{
+	int ret = 0;
+
+	if (WARN_ON(!dmabuf))
+		return -EINVAL;
+
+	if (!dma_buf_range_valid(dmabuf, offset, len))
+		return -EINVAL;
+
+	if (dmabuf->ops->end_cpu_access_partial)
+		ret = dmabuf->ops->end_cpu_access_partial(dmabuf, direction,
+							  offset, len);
+	else if (dmabuf->ops->end_cpu_access)
+		ret = dmabuf->ops->end_cpu_access(dmabuf, direction);
+
+	return ret;
+}
+EXPORT_SYMBOL_GPL(dma_buf_end_cpu_access_partial);
+
 /**
  * dma_buf_kmap - Map a page of the buffer object into kernel address space. The
  * same restrictions as for kmap and friends apply.
@@ -24,6 +24,8 @@
 #include <linux/dma-fence.h>
 #include <linux/sched/signal.h>
 
+#include "sync_debug.h"
+
 #define CREATE_TRACE_POINTS
 #include <trace/events/dma_fence.h>
 
@@ -120,6 +122,7 @@ int dma_fence_signal_locked(struct dma_fence *fence)
 		fence->timestamp = ktime_get();
 		set_bit(DMA_FENCE_FLAG_TIMESTAMP_BIT, &fence->flags);
 		trace_dma_fence_signaled(fence);
+		sync_profile_fence(fence, SYNC_PROFILE_SIGNAL);
 	}
 
 	list_for_each_entry_safe(cur, tmp, &fence->cb_list, node) {
@@ -156,6 +159,7 @@ int dma_fence_signal(struct dma_fence *fence)
 	fence->timestamp = ktime_get();
 	set_bit(DMA_FENCE_FLAG_TIMESTAMP_BIT, &fence->flags);
 	trace_dma_fence_signaled(fence);
+	sync_profile_fence(fence, SYNC_PROFILE_SIGNAL);
 
 	if (test_bit(DMA_FENCE_FLAG_ENABLE_SIGNAL_BIT, &fence->flags)) {
 		struct dma_fence_cb *cur, *tmp;
@@ -171,6 +175,76 @@ int dma_fence_signal(struct dma_fence *fence)
 }
 EXPORT_SYMBOL(dma_fence_signal);
 
+/**
+ * dma_fence_signal_batch - signal completion of several fences at once
+ * @fences: the fences to signal
+ * @count: number of entries in @fences
+ *
+ * Like calling dma_fence_signal() on each of @fences, except that all of
+ * them are marked as signaled, with the same timestamp, before the first
+ * callback runs. Waiters polling any of the fences therefore don't have to
+ * wait for the callbacks of the ones before it. Callbacks still run with
+ * the fence->lock held, which is only dropped and retaken between fences
+ * that don't share it.
+ *
+ * Returns the number of fences that weren't signaled before this call.
+ */
+unsigned int dma_fence_signal_batch(struct dma_fence **fences,
+				    unsigned int count)
+{
+	struct dma_fence_cb *cur, *tmp;
+	struct dma_fence *fence;
+	spinlock_t *lock = NULL;
+	unsigned int i, signaled = 0;
+	unsigned long flags;
+	ktime_t timestamp;
+
+	if (!count)
+		return 0;
+
+	timestamp = ktime_get();
+	for (i = 0; i < count; i++) {
+		fence = fences[i];
+		if (test_and_set_bit(DMA_FENCE_FLAG_SIGNALED_BIT,
+				     &fence->flags))
+			continue;
+
+		fence->timestamp = timestamp;
+		set_bit(DMA_FENCE_FLAG_TIMESTAMP_BIT, &fence->flags);
+		trace_dma_fence_signaled(fence);
+		sync_profile_fence(fence, SYNC_PROFILE_SIGNAL);
+		signaled++;
+	}
+
+	/*
+	 * A fence another thread signaled meanwhile may still have its
+	 * callbacks pending, run through them as dma_fence_signal_locked()
+	 * does.
+	 */
+	for (i = 0; i < count; i++) {
+		fence = fences[i];
+		if (!test_bit(DMA_FENCE_FLAG_ENABLE_SIGNAL_BIT, &fence->flags))
+			continue;
+
+		if (fence->lock != lock) {
+			if (lock)
+				spin_unlock_irqrestore(lock, flags);
+			lock = fence->lock;
+			spin_lock_irqsave(lock, flags);
+		}
+
+		list_for_each_entry_safe(cur, tmp, &fence->cb_list, node) {
+			list_del_init(&cur->node);
+			cur->func(fence, cur);
+		}
+	}
+	if (lock)
+		spin_unlock_irqrestore(lock, flags);
+
+	return signaled;
+}
+EXPORT_SYMBOL(dma_fence_signal_batch);
+
 /**
  * dma_fence_wait_timeout - sleep until the fence gets signaled
  * or until timeout elapses
@@ -261,6 +335,7 @@ void dma_fence_enable_sw_signaling(struct dma_fence *fence)
 	    !test_bit(DMA_FENCE_FLAG_SIGNALED_BIT, &fence->flags) &&
 	    fence->ops->enable_signaling) {
 		trace_dma_fence_enable_signal(fence);
+		sync_profile_fence(fence, SYNC_PROFILE_ENABLE);
 
 		spin_lock_irqsave(fence->lock, flags);
 
@@ -321,6 +396,7 @@ int dma_fence_add_callback(struct dma_fence *fence, struct dma_fence_cb *cb,
 		ret = -ENOENT;
 	else if (!was_set && fence->ops->enable_signaling) {
 		trace_dma_fence_enable_signal(fence);
+		sync_profile_fence(fence, SYNC_PROFILE_ENABLE);
 
 		if (!fence->ops->enable_signaling(fence)) {
 			dma_fence_signal_locked(fence);
@@ -452,6 +528,7 @@ dma_fence_default_wait(struct dma_fence *fence, bool intr, signed long timeout)
 
 	if (!was_set && fence->ops->enable_signaling) {
 		trace_dma_fence_enable_signal(fence);
+		sync_profile_fence(fence, SYNC_PROFILE_ENABLE);
 
 		if (!fence->ops->enable_signaling(fence)) {
 			dma_fence_signal_locked(fence);
@@ -630,5 +707,6 @@ dma_fence_init(struct dma_fence *fence, const struct dma_fence_ops *ops,
 	fence->error = 0;
 
 	trace_dma_fence_init(fence);
+	sync_profile_fence(fence, SYNC_PROFILE_INIT);
 }
 EXPORT_SYMBOL(dma_fence_init);
@@ -0,0 +1,168 @@
+/*
+ * Copyright © 2017 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ *
+ */
+
+#include <linux/kernel.h>
+#include <linux/errno.h>
+#include <linux/slab.h>
+#include <linux/mutex.h>
+#include <linux/workqueue.h>
+#include <linux/dma-buf.h>
+#include "hyper_dmabuf_drv.h"
+#include "hyper_dmabuf_struct.h"
+#include "hyper_dmabuf_cache.h"
+
+/* Compositors export the same few buffers over and over again, unexporting
+ * each of them once the importer is done with it. Instead of tearing down
+ * the attachment and the shared page tables of a fully released buffer
+ * right away, keep them around for a while so that the next export of the
+ * same dma_buf to the same domain only has to send the EXPORT message.
+ */
+static LIST_HEAD(export_cache);
+static DEFINE_MUTEX(export_cache_lock);
+static int export_cache_cnt;
+
+static void export_cache_expire(struct work_struct *work);
+static DECLARE_DELAYED_WORK(export_cache_work, export_cache_expire);
+
+static void cache_release(struct cached_export_info *cached)
+{
+	struct hyper_dmabuf_bknd_ops *bknd_ops = hy_drv_priv->bknd_ops;
+
+	bknd_ops->unshare_pages(&cached->refs_info, cached->nents);
+	dma_buf_unmap_attachment(cached->attach, cached->sgt,
+				 DMA_BIDIRECTIONAL);
+	dma_buf_detach(cached->dma_buf, cached->attach);
+	dma_buf_put(cached->dma_buf);
+	kfree(cached);
+}
+
+/* must be called with export_cache_lock held */
+static void cache_evict_oldest(void)
+{
+	struct cached_export_info *cached;
+
+	cached = list_first_entry(&export_cache, struct cached_export_info,
+				  list);
+	list_del(&cached->list);
+	export_cache_cnt--;
+	cache_release(cached);
+}
+
+static void export_cache_expire(struct work_struct *work)
+{
+	struct cached_export_info *cached;
+
+	mutex_lock(&export_cache_lock);
+
+	while (!list_empty(&export_cache)) {
+		cached = list_first_entry(&export_cache,
+					  struct cached_export_info, list);
+
+		if (time_before(jiffies, cached->expires)) {
+			schedule_delayed_work(&export_cache_work,
+					      cached->expires - jiffies);
+			break;
+		}
+
+		cache_evict_oldest();
+	}
+
+	mutex_unlock(&export_cache_lock);
+}
+
+/* take over dma_buf, base attachment and shared pages of an exported
+ * buffer that is being released. Returns 0 if they were cached, in which
+ * case the caller must not release them.
+ */
+int hyper_dmabuf_cache_add(struct exported_sgt_info *exported)
+{
+	struct cached_export_info *cached;
+
+	cached = kcalloc(1, sizeof(*cached), GFP_KERNEL);
+	if (!cached)
+		return -ENOMEM;
+
+	cached->dma_buf = exported->dma_buf;
+	cached->rdomid = exported->rdomid;
+	cached->attach = exported->active_attached->attach;
+	cached->sgt = exported->active_sgts->sgt;
+	cached->refs_info = exported->refs_info;
+	cached->ref_handle = exported->ref_handle;
+	cached->nents = exported->nents;
+	cached->frst_ofst = exported->frst_ofst;
+	cached->last_len = exported->last_len;
+	cached->expires = jiffies + msecs_to_jiffies(EXPORT_CACHE_TIMEOUT_MS);
+
+	mutex_lock(&export_cache_lock);
+
+	if (export_cache_cnt == MAX_ENTRY_EXPORT_CACHE)
+		cache_evict_oldest();
+
+	list_add_tail(&cached->list, &export_cache);
+	export_cache_cnt++;
+
+	if (export_cache_cnt == 1)
+		schedule_delayed_work(&export_cache_work,
+				      cached->expires - jiffies);
+
+	mutex_unlock(&export_cache_lock);
+
+	return 0;
+}
+
+/* remove and return the cache entry of dma_buf shared to rdomid, if any.
+ * The caller takes over the reference to dma_buf held by the entry.
+ */
+struct cached_export_info *hyper_dmabuf_cache_get(struct dma_buf *dma_buf,
+						  int rdomid)
+{
+	struct cached_export_info *cached;
+
+	mutex_lock(&export_cache_lock);
+
+	list_for_each_entry(cached, &export_cache, list) {
+		if (cached->dma_buf == dma_buf && cached->rdomid == rdomid) {
+			list_del(&cached->list);
+			export_cache_cnt--;
+			mutex_unlock(&export_cache_lock);
+			return cached;
+		}
+	}
+
+	mutex_unlock(&export_cache_lock);
+
+	return NULL;
+}
+
+void hyper_dmabuf_cache_destroy(void)
+{
+	cancel_delayed_work_sync(&export_cache_work);
+
+	mutex_lock(&export_cache_lock);
+
+	while (!list_empty(&export_cache))
+		cache_evict_oldest();
+
+	mutex_unlock(&export_cache_lock);
+}
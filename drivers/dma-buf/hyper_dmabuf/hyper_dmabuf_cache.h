@@ -0,0 +1,59 @@
+/*
+ * Copyright © 2017 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ *
+ */
+
+#ifndef __HYPER_DMABUF_CACHE_H__
+#define __HYPER_DMABUF_CACHE_H__
+
+#include "hyper_dmabuf_struct.h"
+
+/* max number of unexported buffers kept shared for re-export */
+#define MAX_ENTRY_EXPORT_CACHE 16
+/* time an unexported buffer is kept shared before it is released */
+#define EXPORT_CACHE_TIMEOUT_MS 1000
+
+#ifdef CONFIG_HYPER_DMABUF_EXPORT_CACHE
+int hyper_dmabuf_cache_add(struct exported_sgt_info *exported);
+
+struct cached_export_info *hyper_dmabuf_cache_get(struct dma_buf *dma_buf,
+						  int rdomid);
+
+void hyper_dmabuf_cache_destroy(void);
+#else
+static inline int hyper_dmabuf_cache_add(struct exported_sgt_info *exported)
+{
+	return -ENOENT;
+}
+
+static inline struct cached_export_info *
+hyper_dmabuf_cache_get(struct dma_buf *dma_buf, int rdomid)
+{
+	return NULL;
+}
+
+static inline void hyper_dmabuf_cache_destroy(void)
+{
+}
+#endif
+
+#endif /* __HYPER_DMABUF_CACHE_H__ */
@@ -38,8 +38,13 @@
 #include "hyper_dmabuf_drv.h"
 #include "hyper_dmabuf_ioctl.h"
 #include "hyper_dmabuf_list.h"
+#include "hyper_dmabuf_msg.h"
 #include "hyper_dmabuf_id.h"
 #include "hyper_dmabuf_event.h"
+#include "hyper_dmabuf_cache.h"
+#include "hyper_dmabuf_map_cache.h"
+#include "hyper_dmabuf_fence.h"
+#include "hyper_dmabuf_stats.h"
 
 #ifdef CONFIG_HYPER_DMABUF_XEN
 #include "xen/hyper_dmabuf_xen_drv.h"
@@ -300,15 +305,28 @@ static int __init hyper_dmabuf_drv_init(void)
 	dev_info(hy_drv_priv->dev,
 		 "initializing database for imported/exported dmabufs\n");
 
-	hy_drv_priv->work_queue = create_workqueue("hyper_dmabuf_wqueue");
+	/* ordered, fence signals must not overtake their EXPORT message */
+	hy_drv_priv->work_queue = alloc_ordered_workqueue("hyper_dmabuf_wqueue",
+							  0);
+	if (!hy_drv_priv->work_queue) {
+		dev_err(hy_drv_priv->dev,
+			"fail to create workqueue\n");
+		ret = -ENOMEM;
+		goto err_wq;
+	}
+
+	ret = hyper_dmabuf_msg_init();
+	if (ret < 0) {
+		dev_err(hy_drv_priv->dev,
+			"fail to allocate message pool\n");
+		goto err_msg;
+	}
 
 	ret = hyper_dmabuf_table_init();
 	if (ret < 0) {
 		dev_err(hy_drv_priv->dev,
 			"fail to init table for exported/imported entries\n");
-		mutex_unlock(&hy_drv_priv->lock);
-		kfree(hy_drv_priv);
-		return ret;
+		goto err_table;
 	}
 
 #ifdef CONFIG_HYPER_DMABUF_SYSFS
@@ -316,12 +334,12 @@ static int __init hyper_dmabuf_drv_init(void)
 	if (ret < 0) {
 		dev_err(hy_drv_priv->dev,
 			"failed to initialize sysfs\n");
-		mutex_unlock(&hy_drv_priv->lock);
-		kfree(hy_drv_priv);
-		return ret;
+		goto err_sysfs;
 	}
 #endif
 
+	hyper_dmabuf_stats_init();
+
 #ifdef CONFIG_HYPER_DMABUF_EVENT_GEN
 	mutex_init(&hy_drv_priv->event_read_lock);
 	spin_lock_init(&hy_drv_priv->event_lock);
@@ -340,7 +358,7 @@ static int __init hyper_dmabuf_drv_init(void)
 		if (ret < 0) {
 			dev_dbg(hy_drv_priv->dev,
 				"failed to initialize backend.\n");
-			return ret;
+			goto err_bknd_init;
 		}
 	}
 
@@ -363,6 +381,23 @@ static int __init hyper_dmabuf_drv_init(void)
 
 	/* interrupt for comm should be registered here: */
 	return ret;
+
+err_bknd_init:
+	hyper_dmabuf_stats_destroy();
+#ifdef CONFIG_HYPER_DMABUF_SYSFS
+	hyper_dmabuf_unregister_sysfs(hy_drv_priv->dev);
+err_sysfs:
+#endif
+	hyper_dmabuf_table_destroy();
+err_table:
+	hyper_dmabuf_msg_destroy();
+err_msg:
+	destroy_workqueue(hy_drv_priv->work_queue);
+err_wq:
+	mutex_unlock(&hy_drv_priv->lock);
+	unregister_device();
+	kfree(hy_drv_priv);
+	return ret;
 }
 
 static void hyper_dmabuf_drv_exit(void)
@@ -373,20 +408,34 @@ static void hyper_dmabuf_drv_exit(void)
 
 	mutex_lock(&hy_drv_priv->lock);
 
-	/* hash tables for export/import entries and ring_infos */
-	hyper_dmabuf_table_destroy();
+	/* stop waiting for fences of exported buffers */
+	hyper_dmabuf_fence_destroy();
 
-	if (hy_drv_priv->bknd_ops->destroy_comm) {
+	/* stop the rx path, which queues works */
+	if (hy_drv_priv->bknd_ops->destroy_comm)
 		hy_drv_priv->bknd_ops->destroy_comm();
-	}
+
+	/*
+	 * Requests and fence works still queued may look up or release
+	 * cached exports, so drain them before tearing the caches down.
+	 */
+	if (hy_drv_priv->work_queue)
+		destroy_workqueue(hy_drv_priv->work_queue);
+
+	/* release buffers kept for re-export */
+	hyper_dmabuf_cache_destroy();
+	hyper_dmabuf_map_cache_destroy();
+
+	/* hash tables for export/import entries and ring_infos */
+	hyper_dmabuf_table_destroy();
 
 	if (hy_drv_priv->bknd_ops->cleanup) {
 		hy_drv_priv->bknd_ops->cleanup();
 	};
 
-	/* destroy workqueue */
-	if (hy_drv_priv->work_queue)
-		destroy_workqueue(hy_drv_priv->work_queue);
+	hyper_dmabuf_msg_destroy();
+
+	hyper_dmabuf_stats_destroy();
 
 	/* destroy id_queue */
 	if (hy_drv_priv->id_queue)
@@ -0,0 +1,363 @@
+/*
+ * Copyright © 2017 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ *
+ */
+
+#include <linux/kernel.h>
+#include <linux/errno.h>
+#include <linux/slab.h>
+#include <linux/file.h>
+#include <linux/fcntl.h>
+#include <linux/dma-buf.h>
+#include <linux/dma-fence.h>
+#include <linux/reservation.h>
+#include <linux/sync_file.h>
+#include <linux/workqueue.h>
+#include "hyper_dmabuf_drv.h"
+#include "hyper_dmabuf_struct.h"
+#include "hyper_dmabuf_msg.h"
+#include "hyper_dmabuf_fence.h"
+
+/* Instead of forwarding dma_buf ops, the exporter tells the importer in
+ * the EXPORT message that the buffer still has an unsignaled exclusive
+ * fence, and sends a HYPER_DMABUF_FENCE_SIGNAL message once the fence
+ * signals. The importer stands in a local fence for it, which is attached
+ * to the imported dma_buf and can be retrieved as sync_file.
+ *
+ * Fences are identified by a per-export sequence number, a signal message
+ * signals all fences of the buffer up to its sequence number.
+ */
+
+/* exporter side */
+
+struct hyper_dmabuf_fence_cb {
+	struct dma_fence_cb cb;
+	struct work_struct work;
+	struct list_head list;
+	struct dma_fence *fence;
+	hyper_dmabuf_id_t hid;
+	int rdomid;
+	u32 seqno;
+};
+
+/* armed callbacks, so they can be removed on exit */
+static LIST_HEAD(fence_cbs);
+static DEFINE_SPINLOCK(fence_cbs_lock);
+
+static void fence_signal_work(struct work_struct *work)
+{
+	struct hyper_dmabuf_fence_cb *fcb =
+		container_of(work, struct hyper_dmabuf_fence_cb, work);
+	struct hyper_dmabuf_bknd_ops *bknd_ops = hy_drv_priv->bknd_ops;
+	struct hyper_dmabuf_req *req;
+	int op[5];
+	int i;
+
+	spin_lock(&fence_cbs_lock);
+	list_del(&fcb->list);
+	spin_unlock(&fence_cbs_lock);
+
+	op[0] = fcb->hid.id;
+
+	for (i = 0; i < 3; i++)
+		op[i+1] = fcb->hid.rng_key[i];
+
+	op[4] = fcb->seqno;
+
+	req = hyper_dmabuf_req_alloc();
+
+	if (req) {
+		hyper_dmabuf_create_req(req, HYPER_DMABUF_FENCE_SIGNAL, &op[0]);
+
+		if (bknd_ops->send_req(fcb->rdomid, req, false) < 0)
+			dev_err(hy_drv_priv->dev,
+				"fence signal for buffer {id:%d key:%d %d %d} failed\n",
+				fcb->hid.id, fcb->hid.rng_key[0],
+				fcb->hid.rng_key[1], fcb->hid.rng_key[2]);
+
+		hyper_dmabuf_req_free(req);
+	}
+
+	dma_fence_put(fcb->fence);
+	kfree(fcb);
+}
+
+static void fence_signaled(struct dma_fence *fence, struct dma_fence_cb *cb)
+{
+	struct hyper_dmabuf_fence_cb *fcb =
+		container_of(cb, struct hyper_dmabuf_fence_cb, cb);
+
+	queue_work(hy_drv_priv->work_queue, &fcb->work);
+}
+
+/* get ready to pass the exclusive fence of the buffer about to be sent in
+ * an EXPORT message. Returns the sequence number to be sent along, or 0
+ * if there is nothing to wait for.
+ */
+u32 hyper_dmabuf_fence_prepare(struct exported_sgt_info *exported)
+{
+	struct hyper_dmabuf_fence_cb *fcb;
+	struct dma_fence *fence;
+
+	fence = reservation_object_get_excl_rcu(exported->dma_buf->resv);
+	if (!fence)
+		return 0;
+
+	if (dma_fence_is_signaled(fence)) {
+		dma_fence_put(fence);
+		return 0;
+	}
+
+	fcb = kcalloc(1, sizeof(*fcb), GFP_KERNEL);
+	if (!fcb) {
+		/* importer won't wait, same as without fence passing */
+		dma_fence_put(fence);
+		return 0;
+	}
+
+	/* 0 means no fence */
+	if (!++exported->fence_seqno)
+		exported->fence_seqno++;
+
+	INIT_WORK(&fcb->work, fence_signal_work);
+	fcb->fence = fence;
+	fcb->hid = exported->hid;
+	fcb->rdomid = exported->rdomid;
+	fcb->seqno = exported->fence_seqno;
+	exported->fence_cb = fcb;
+
+	return fcb->seqno;
+}
+
+/* start watching the fence prepared for the EXPORT message, once the
+ * message is sent so that the signal message can't overtake it
+ */
+void hyper_dmabuf_fence_arm(struct exported_sgt_info *exported, bool sent)
+{
+	struct hyper_dmabuf_fence_cb *fcb = exported->fence_cb;
+	int ret;
+
+	if (!fcb)
+		return;
+
+	exported->fence_cb = NULL;
+
+	if (!sent) {
+		dma_fence_put(fcb->fence);
+		kfree(fcb);
+		return;
+	}
+
+	spin_lock(&fence_cbs_lock);
+	list_add_tail(&fcb->list, &fence_cbs);
+	spin_unlock(&fence_cbs_lock);
+
+	ret = dma_fence_add_callback(fcb->fence, &fcb->cb, fence_signaled);
+
+	/* signaled in the meantime */
+	if (ret)
+		queue_work(hy_drv_priv->work_queue, &fcb->work);
+}
+
+void hyper_dmabuf_fence_destroy(void)
+{
+	struct hyper_dmabuf_fence_cb *fcb, *tmp;
+
+	spin_lock(&fence_cbs_lock);
+	list_for_each_entry_safe(fcb, tmp, &fence_cbs, list) {
+		if (dma_fence_remove_callback(fcb->fence, &fcb->cb)) {
+			list_del(&fcb->list);
+			dma_fence_put(fcb->fence);
+			kfree(fcb);
+		}
+	}
+	spin_unlock(&fence_cbs_lock);
+
+	/* callbacks that already fired are queued */
+	flush_workqueue(hy_drv_priv->work_queue);
+}
+
+/* importer side */
+
+struct hyper_dmabuf_fence {
+	struct dma_fence base;
+	struct list_head list;
+};
+
+/* protects fence lists of imported buffers, also used as fence lock */
+static DEFINE_SPINLOCK(fence_lock);
+
+static const char *hyper_dmabuf_fence_get_driver_name(struct dma_fence *f)
+{
+	return "hyper_dmabuf";
+}
+
+static const char *hyper_dmabuf_fence_get_timeline_name(struct dma_fence *f)
+{
+	return "remote";
+}
+
+static const struct dma_fence_ops hyper_dmabuf_fence_ops = {
+	.get_driver_name = hyper_dmabuf_fence_get_driver_name,
+	.get_timeline_name = hyper_dmabuf_fence_get_timeline_name,
+};
+
+/* must be called with fence_lock held */
+static struct hyper_dmabuf_fence *
+last_fence(struct imported_sgt_info *imported)
+{
+	if (list_empty(&imported->fences))
+		return NULL;
+
+	return list_last_entry(&imported->fences, struct hyper_dmabuf_fence,
+			       list);
+}
+
+/* add fence of seqno to imported buffer, as told by EXPORT message */
+void hyper_dmabuf_fence_import(struct imported_sgt_info *imported,
+			       u32 seqno)
+{
+	struct hyper_dmabuf_fence *f;
+	unsigned long flags;
+
+	f = kcalloc(1, sizeof(*f), GFP_KERNEL);
+	if (!f)
+		return;
+
+	if (!imported->fence_context)
+		imported->fence_context = dma_fence_context_alloc(1);
+
+	dma_fence_init(&f->base, &hyper_dmabuf_fence_ops, &fence_lock,
+		       imported->fence_context, seqno);
+
+	spin_lock_irqsave(&fence_lock, flags);
+	list_add_tail(&f->list, &imported->fences);
+	spin_unlock_irqrestore(&fence_lock, flags);
+
+	hyper_dmabuf_fence_attach(imported);
+}
+
+/* make local dma_buf of imported buffer wait for its last fence */
+void hyper_dmabuf_fence_attach(struct imported_sgt_info *imported)
+{
+	struct reservation_object *resv;
+	struct hyper_dmabuf_fence *f;
+	struct dma_fence *fence = NULL;
+	unsigned long flags;
+
+	if (IS_ERR_OR_NULL(imported->dma_buf))
+		return;
+
+	spin_lock_irqsave(&fence_lock, flags);
+	f = last_fence(imported);
+	if (f)
+		fence = dma_fence_get(&f->base);
+	spin_unlock_irqrestore(&fence_lock, flags);
+
+	if (!fence)
+		return;
+
+	resv = imported->dma_buf->resv;
+	reservation_object_lock(resv, NULL);
+	reservation_object_add_excl_fence(resv, fence);
+	reservation_object_unlock(resv);
+
+	dma_fence_put(fence);
+}
+
+/* signal fences of imported buffer up to seqno */
+void hyper_dmabuf_fence_signal(struct imported_sgt_info *imported,
+			       u32 seqno)
+{
+	struct hyper_dmabuf_fence *f, *tmp;
+	LIST_HEAD(signaled);
+	unsigned long flags;
+
+	spin_lock_irqsave(&fence_lock, flags);
+	list_for_each_entry_safe(f, tmp, &imported->fences, list) {
+		if ((s32)(f->base.seqno - seqno) > 0)
+			break;
+
+		dma_fence_signal_locked(&f->base);
+		list_move_tail(&f->list, &signaled);
+	}
+	spin_unlock_irqrestore(&fence_lock, flags);
+
+	list_for_each_entry_safe(f, tmp, &signaled, list)
+		dma_fence_put(&f->base);
+}
+
+/* signal all fences of imported buffer that is going away */
+void hyper_dmabuf_fence_release(struct imported_sgt_info *imported)
+{
+	struct hyper_dmabuf_fence *f, *tmp;
+	LIST_HEAD(signaled);
+	unsigned long flags;
+
+	spin_lock_irqsave(&fence_lock, flags);
+	list_for_each_entry_safe(f, tmp, &imported->fences, list) {
+		dma_fence_set_error(&f->base, -ENODEV);
+		dma_fence_signal_locked(&f->base);
+		list_move_tail(&f->list, &signaled);
+	}
+	spin_unlock_irqrestore(&fence_lock, flags);
+
+	list_for_each_entry_safe(f, tmp, &signaled, list)
+		dma_fence_put(&f->base);
+}
+
+/* create sync_file fd for last fence of imported buffer */
+int hyper_dmabuf_fence_get_fd(struct imported_sgt_info *imported)
+{
+	struct hyper_dmabuf_fence *f;
+	struct dma_fence *fence = NULL;
+	struct sync_file *sync_file;
+	unsigned long flags;
+	int fd;
+
+	spin_lock_irqsave(&fence_lock, flags);
+	f = last_fence(imported);
+	if (f)
+		fence = dma_fence_get(&f->base);
+	spin_unlock_irqrestore(&fence_lock, flags);
+
+	if (!fence)
+		return -ENOENT;
+
+	fd = get_unused_fd_flags(O_CLOEXEC);
+	if (fd < 0) {
+		dma_fence_put(fence);
+		return fd;
+	}
+
+	sync_file = sync_file_create(fence);
+	dma_fence_put(fence);
+
+	if (!sync_file) {
+		put_unused_fd(fd);
+		return -ENOMEM;
+	}
+
+	fd_install(fd, sync_file->file);
+
+	return fd;
+}
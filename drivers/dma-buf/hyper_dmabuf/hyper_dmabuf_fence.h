@@ -0,0 +1,90 @@
+/*
+ * Copyright © 2017 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ *
+ */
+
+#ifndef __HYPER_DMABUF_FENCE_H__
+#define __HYPER_DMABUF_FENCE_H__
+
+#include "hyper_dmabuf_struct.h"
+
+#ifdef CONFIG_HYPER_DMABUF_FENCE
+/* exporter side */
+u32 hyper_dmabuf_fence_prepare(struct exported_sgt_info *exported);
+
+void hyper_dmabuf_fence_arm(struct exported_sgt_info *exported, bool sent);
+
+void hyper_dmabuf_fence_destroy(void);
+
+/* importer side */
+void hyper_dmabuf_fence_import(struct imported_sgt_info *imported,
+			       u32 seqno);
+
+void hyper_dmabuf_fence_attach(struct imported_sgt_info *imported);
+
+void hyper_dmabuf_fence_signal(struct imported_sgt_info *imported,
+			       u32 seqno);
+
+void hyper_dmabuf_fence_release(struct imported_sgt_info *imported);
+
+int hyper_dmabuf_fence_get_fd(struct imported_sgt_info *imported);
+#else
+static inline u32 hyper_dmabuf_fence_prepare(struct exported_sgt_info *exported)
+{
+	return 0;
+}
+
+static inline void hyper_dmabuf_fence_arm(struct exported_sgt_info *exported,
+					  bool sent)
+{
+}
+
+static inline void hyper_dmabuf_fence_destroy(void)
+{
+}
+
+static inline void hyper_dmabuf_fence_import(struct imported_sgt_info *imported,
+					     u32 seqno)
+{
+}
+
+static inline void hyper_dmabuf_fence_attach(struct imported_sgt_info *imported)
+{
+}
+
+static inline void hyper_dmabuf_fence_signal(struct imported_sgt_info *imported,
+					     u32 seqno)
+{
+}
+
+static inline void
+hyper_dmabuf_fence_release(struct imported_sgt_info *imported)
+{
+}
+
+static inline int hyper_dmabuf_fence_get_fd(struct imported_sgt_info *imported)
+{
+	return -EINVAL;
+}
+#endif
+
+#endif /* __HYPER_DMABUF_FENCE_H__ */
@@ -40,6 +40,10 @@
 #include "hyper_dmabuf_sgl_proc.h"
 #include "hyper_dmabuf_ops.h"
 #include "hyper_dmabuf_query.h"
+#include "hyper_dmabuf_cache.h"
+#include "hyper_dmabuf_map_cache.h"
+#include "hyper_dmabuf_fence.h"
+#include "hyper_dmabuf_stats.h"
 
 static int hyper_dmabuf_tx_ch_setup_ioctl(struct file *filp, void *data)
 {
@@ -79,14 +83,38 @@ static int hyper_dmabuf_rx_ch_setup_ioctl(struct file *filp, void *data)
 	return ret;
 }
 
+/* share pages behind pg_info with the importer */
+static int share_export_pgs(struct exported_sgt_info *exported,
+			    struct pages_info *pg_info)
+{
+	struct hyper_dmabuf_bknd_ops *bknd_ops = hy_drv_priv->bknd_ops;
+	long tmp;
+
+	tmp = bknd_ops->share_pages(pg_info->pgs, exported->rdomid,
+				    pg_info->nents, &exported->refs_info);
+	if (tmp < 0) {
+		dev_err(hy_drv_priv->dev, "pages sharing failed\n");
+		return tmp;
+	}
+
+	exported->ref_handle = tmp;
+	exported->nents = pg_info->nents;
+	exported->frst_ofst = pg_info->frst_ofst;
+	exported->last_len = pg_info->last_len;
+
+	return 0;
+}
+
+/* send export msg to importer, with shared pages info if with_pgs is
+ * set or only for updating private data otherwise
+ */
 static int send_export_msg(struct exported_sgt_info *exported,
-			   struct pages_info *pg_info)
+			   bool with_pgs)
 {
 	struct hyper_dmabuf_bknd_ops *bknd_ops = hy_drv_priv->bknd_ops;
 	struct hyper_dmabuf_req *req;
 	int op[MAX_NUMBER_OF_OPERANDS] = {0};
 	int ret, i;
-	long tmp;
 
 	/* now create request for importer via ring */
 	op[0] = exported->hid.id;
@@ -94,18 +122,12 @@ static int send_export_msg(struct exported_sgt_info *exported,
 	for (i = 0; i < 3; i++)
 		op[i+1] = exported->hid.rng_key[i];
 
-	if (pg_info) {
-		op[4] = pg_info->nents;
-		op[5] = pg_info->frst_ofst;
-		op[6] = pg_info->last_len;
-		tmp = bknd_ops->share_pages(pg_info->pgs, exported->rdomid,
-					 pg_info->nents, &exported->refs_info);
-		if (tmp < 0) {
-			dev_err(hy_drv_priv->dev, "pages sharing failed\n");
-			return tmp;
-		}
-		op[7] = tmp & 0xffffffff;
-		op[8] = (tmp >> 32) & 0xffffffff;
+	if (with_pgs) {
+		op[4] = exported->nents;
+		op[5] = exported->frst_ofst;
+		op[6] = exported->last_len;
+		op[7] = exported->ref_handle & 0xffffffff;
+		op[8] = (exported->ref_handle >> 32) & 0xffffffff;
 	}
 
 	op[9] = exported->sz_priv;
@@ -113,17 +135,22 @@ static int send_export_msg(struct exported_sgt_info *exported,
 	/* driver/application specific private info */
 	memcpy(&op[10], exported->priv, op[9]);
 
-	req = kcalloc(1, sizeof(*req), GFP_KERNEL);
+	req = hyper_dmabuf_req_alloc();
 
 	if (!req)
 		return -ENOMEM;
 
+	/* let importer wait for pending rendering instead of the buffer */
+	op[HYPER_DMABUF_EXPORT_FENCE_OP] = hyper_dmabuf_fence_prepare(exported);
+
 	/* composing a message to the importer */
 	hyper_dmabuf_create_req(req, HYPER_DMABUF_EXPORT, &op[0]);
 
 	ret = bknd_ops->send_req(exported->rdomid, req, true);
 
-	kfree(req);
+	hyper_dmabuf_fence_arm(exported, ret >= 0);
+
+	hyper_dmabuf_req_free(req);
 
 	return ret;
 }
@@ -192,7 +219,7 @@ static int fastpath_export(hyper_dmabuf_id_t hid, int sz_priv, char *priv)
 		ret = -EINVAL;
 	} else {
 		/* send an export msg for updating priv in importer */
-		ret = send_export_msg(exported, NULL);
+		ret = send_export_msg(exported, false);
 
 		if (ret < 0) {
 			dev_err(hy_drv_priv->dev,
@@ -208,12 +235,15 @@ static int hyper_dmabuf_export_remote_ioctl(struct file *filp, void *data)
 {
 	struct ioctl_hyper_dmabuf_export_remote *export_remote_attr =
 			(struct ioctl_hyper_dmabuf_export_remote *)data;
+	struct hyper_dmabuf_bknd_ops *bknd_ops = hy_drv_priv->bknd_ops;
 	struct dma_buf *dma_buf;
 	struct dma_buf_attachment *attachment;
 	struct sg_table *sgt;
 	struct pages_info *pg_info;
 	struct exported_sgt_info *exported;
+	struct cached_export_info *cached;
 	hyper_dmabuf_id_t hid;
+	ktime_t start = ktime_get();
 	int ret = 0;
 
 	if (hy_drv_priv->domid == export_remote_attr->remote_domain) {
@@ -246,23 +276,41 @@ static int hyper_dmabuf_export_remote_ioctl(struct file *filp, void *data)
 		if (ret <= 0) {
 			dma_buf_put(dma_buf);
 			export_remote_attr->hid = hid;
+
+			if (!ret)
+				hyper_dmabuf_stats_latency(
+					export_remote_attr->remote_domain,
+					HYPER_DMABUF_LAT_EXPORT, start);
 			return ret;
 		}
 	}
 
-	attachment = dma_buf_attach(dma_buf, hy_drv_priv->dev);
-	if (IS_ERR(attachment)) {
-		dev_err(hy_drv_priv->dev, "cannot get attachment\n");
-		ret = PTR_ERR(attachment);
-		goto fail_attach;
-	}
+	/* reuse attachment and shared pages if this buffer was recently
+	 * released by the same importer
+	 */
+	cached = hyper_dmabuf_cache_get(dma_buf,
+					export_remote_attr->remote_domain);
+
+	if (cached) {
+		/* cached entry already holds a reference to dma_buf */
+		dma_buf_put(dma_buf);
+		attachment = cached->attach;
+		sgt = cached->sgt;
+	} else {
+		attachment = dma_buf_attach(dma_buf, hy_drv_priv->dev);
+		if (IS_ERR(attachment)) {
+			dev_err(hy_drv_priv->dev, "cannot get attachment\n");
+			ret = PTR_ERR(attachment);
+			goto fail_attach;
+		}
 
-	sgt = dma_buf_map_attachment(attachment, DMA_BIDIRECTIONAL);
+		sgt = dma_buf_map_attachment(attachment, DMA_BIDIRECTIONAL);
 
-	if (IS_ERR(sgt)) {
-		dev_err(hy_drv_priv->dev, "cannot map attachment\n");
-		ret = PTR_ERR(sgt);
-		goto fail_map_attachment;
+		if (IS_ERR(sgt)) {
+			dev_err(hy_drv_priv->dev, "cannot map attachment\n");
+			ret = PTR_ERR(sgt);
+			goto fail_map_attachment;
+		}
 	}
 
 	exported = kcalloc(1, sizeof(*exported), GFP_KERNEL);
@@ -355,22 +403,39 @@ static int hyper_dmabuf_export_remote_ioctl(struct file *filp, void *data)
 		goto fail_export;
 	}
 
-	pg_info = hyper_dmabuf_ext_pgs(sgt);
-	if (!pg_info) {
-		dev_err(hy_drv_priv->dev,
-			"failed to construct pg_info\n");
-		ret = -ENOMEM;
-		goto fail_export;
-	}
+	if (cached) {
+		exported->refs_info = cached->refs_info;
+		exported->ref_handle = cached->ref_handle;
+		exported->nents = cached->nents;
+		exported->frst_ofst = cached->frst_ofst;
+		exported->last_len = cached->last_len;
+		kfree(cached);
+		cached = NULL;
+	} else {
+		pg_info = hyper_dmabuf_ext_pgs(sgt);
+		if (!pg_info) {
+			dev_err(hy_drv_priv->dev,
+				"failed to construct pg_info\n");
+			ret = -ENOMEM;
+			goto fail_export;
+		}
 
-	exported->nents = pg_info->nents;
+		ret = share_export_pgs(exported, pg_info);
+
+		/* free pg_info */
+		kfree(pg_info->pgs);
+		kfree(pg_info);
+
+		if (ret < 0)
+			goto fail_export;
+	}
 
 	/* now register it to export list */
 	hyper_dmabuf_register_exported(exported);
 
 	export_remote_attr->hid = exported->hid;
 
-	ret = send_export_msg(exported, pg_info);
+	ret = send_export_msg(exported, true);
 
 	if (ret < 0) {
 		dev_err(hy_drv_priv->dev,
@@ -378,22 +443,18 @@ static int hyper_dmabuf_export_remote_ioctl(struct file *filp, void *data)
 		goto fail_send_request;
 	}
 
-	/* free pg_info */
-	kfree(pg_info->pgs);
-	kfree(pg_info);
-
 	exported->filp = filp;
 
+	hyper_dmabuf_stats_latency(exported->rdomid, HYPER_DMABUF_LAT_EXPORT,
+				   start);
+
 	return ret;
 
 /* Clean-up if error occurs */
 
 fail_send_request:
 	hyper_dmabuf_remove_exported(exported->hid);
-
-	/* free pg_info */
-	kfree(pg_info->pgs);
-	kfree(pg_info);
+	bknd_ops->unshare_pages(&exported->refs_info, exported->nents);
 
 fail_export:
 	kfree(exported->va_vmapped);
@@ -413,6 +474,11 @@ static int hyper_dmabuf_export_remote_ioctl(struct file *filp, void *data)
 
 fail_map_active_sgts:
 fail_sgt_info_creation:
+	if (cached) {
+		bknd_ops->unshare_pages(&cached->refs_info, cached->nents);
+		kfree(cached);
+	}
+
 	dma_buf_unmap_attachment(attachment, sgt,
 				 DMA_BIDIRECTIONAL);
 
@@ -462,7 +528,7 @@ static int hyper_dmabuf_export_fd_ioctl(struct file *filp, void *data)
 		imported->hid.id, imported->hid.rng_key[0],
 		imported->hid.rng_key[1], imported->hid.rng_key[2]);
 
-	req = kcalloc(1, sizeof(*req), GFP_KERNEL);
+	req = hyper_dmabuf_req_alloc();
 
 	if (!req) {
 		mutex_unlock(&hy_drv_priv->lock);
@@ -480,7 +546,7 @@ static int hyper_dmabuf_export_fd_ioctl(struct file *filp, void *data)
 		hyper_dmabuf_create_req(req, HYPER_DMABUF_EXPORT_FD_FAILED,
 					&op[0]);
 		bknd_ops->send_req(HYPER_DMABUF_DOM_ID(imported->hid), req, false);
-		kfree(req);
+		hyper_dmabuf_req_free(req);
 		dev_err(hy_drv_priv->dev,
 			"Failed to create sgt or notify exporter\n");
 		imported->importers--;
@@ -488,7 +554,7 @@ static int hyper_dmabuf_export_fd_ioctl(struct file *filp, void *data)
 		return ret;
 	}
 
-	kfree(req);
+	hyper_dmabuf_req_free(req);
 
 	if (ret == HYPER_DMABUF_REQ_ERROR) {
 		dev_err(hy_drv_priv->dev,
@@ -503,6 +569,9 @@ static int hyper_dmabuf_export_fd_ioctl(struct file *filp, void *data)
 
 	ret = 0;
 
+	/* reuse pages still mapped from previous export, if any */
+	hyper_dmabuf_map_cache_get(imported);
+
 	dev_dbg(hy_drv_priv->dev,
 		"Found buffer gref 0x%lx off %d\n",
 		imported->ref_handle, imported->frst_ofst);
@@ -532,7 +601,7 @@ static int hyper_dmabuf_export_fd_ioctl(struct file *filp, void *data)
 
 			imported->importers--;
 
-			req = kcalloc(1, sizeof(*req), GFP_KERNEL);
+			req = hyper_dmabuf_req_alloc();
 
 			if (!req) {
 				mutex_unlock(&hy_drv_priv->lock);
@@ -544,7 +613,7 @@ static int hyper_dmabuf_export_fd_ioctl(struct file *filp, void *data)
 						&op[0]);
 			bknd_ops->send_req(HYPER_DMABUF_DOM_ID(imported->hid), req,
 							  false);
-			kfree(req);
+			hyper_dmabuf_req_free(req);
 			mutex_unlock(&hy_drv_priv->lock);
 			return -EINVAL;
 		}
@@ -562,6 +631,12 @@ static int hyper_dmabuf_export_fd_ioctl(struct file *filp, void *data)
 	if (export_fd_attr->fd < 0) {
 		/* fail to get fd */
 		ret = export_fd_attr->fd;
+	} else if (imported->import_time) {
+		/* first fd exported since buffer was (re-)exported */
+		hyper_dmabuf_stats_latency(HYPER_DMABUF_DOM_ID(imported->hid),
+					   HYPER_DMABUF_LAT_MAP,
+					   imported->import_time);
+		imported->import_time = 0;
 	}
 
 	mutex_unlock(&hy_drv_priv->lock);
@@ -594,7 +669,7 @@ static void delayed_unexport(struct work_struct *work)
 	/* no longer valid */
 	exported->valid = false;
 
-	req = kcalloc(1, sizeof(*req), GFP_KERNEL);
+	req = hyper_dmabuf_req_alloc();
 
 	if (!req)
 		return;
@@ -617,7 +692,7 @@ static void delayed_unexport(struct work_struct *work)
 			exported->hid.rng_key[1], exported->hid.rng_key[2]);
 	}
 
-	kfree(req);
+	hyper_dmabuf_req_free(req);
 	exported->unexport_sched = false;
 
 	/* Immediately clean-up if it has never been exported by importer
@@ -31,12 +31,22 @@
 #include <linux/slab.h>
 #include <linux/cdev.h>
 #include <linux/hashtable.h>
+#include <linux/rculist.h>
+#include <linux/spinlock.h>
 #include "hyper_dmabuf_drv.h"
 #include "hyper_dmabuf_list.h"
 #include "hyper_dmabuf_id.h"
 
 DECLARE_HASHTABLE(hyper_dmabuf_hash_imported, MAX_ENTRY_IMPORTED);
 DECLARE_HASHTABLE(hyper_dmabuf_hash_exported, MAX_ENTRY_EXPORTED);
+/* exported entries hashed by dma_buf, for finding re-exports */
+DECLARE_HASHTABLE(hyper_dmabuf_hash_exported_dmabuf, MAX_ENTRY_EXPORTED);
+
+/* Entries are looked up under RCU, so ioctls and message handlers
+ * finding buffers don't block each other. Only adding and removing
+ * entries is serialized by this lock.
+ */
+static DEFINE_SPINLOCK(hyper_dmabuf_hash_lock);
 
 #ifdef CONFIG_HYPER_DMABUF_SYSFS
 static ssize_t hyper_dmabuf_imported_show(struct device *drv,
@@ -48,7 +58,8 @@ static ssize_t hyper_dmabuf_imported_show(struct device *drv,
 	ssize_t count = 0;
 	size_t total = 0;
 
-	hash_for_each(hyper_dmabuf_hash_imported, bkt, info_entry, node) {
+	rcu_read_lock();
+	hash_for_each_rcu(hyper_dmabuf_hash_imported, bkt, info_entry, node) {
 		hyper_dmabuf_id_t hid = info_entry->imported->hid;
 		int nents = info_entry->imported->nents;
 		bool valid = info_entry->imported->valid;
@@ -61,6 +72,7 @@ static ssize_t hyper_dmabuf_imported_show(struct device *drv,
 				hid.rng_key[2], nents, (valid ? 't' : 'f'),
 				num_importers);
 	}
+	rcu_read_unlock();
 	count += scnprintf(buf + count, PAGE_SIZE - count,
 			   "total nents: %lu\n", total);
 
@@ -76,7 +88,8 @@ static ssize_t hyper_dmabuf_exported_show(struct device *drv,
 	ssize_t count = 0;
 	size_t total = 0;
 
-	hash_for_each(hyper_dmabuf_hash_exported, bkt, info_entry, node) {
+	rcu_read_lock();
+	hash_for_each_rcu(hyper_dmabuf_hash_exported, bkt, info_entry, node) {
 		hyper_dmabuf_id_t hid = info_entry->exported->hid;
 		int nents = info_entry->exported->nents;
 		bool valid = info_entry->exported->valid;
@@ -89,6 +102,7 @@ static ssize_t hyper_dmabuf_exported_show(struct device *drv,
 				   hid.rng_key[2], nents, (valid ? 't' : 'f'),
 				   importer_exported);
 	}
+	rcu_read_unlock();
 	count += scnprintf(buf + count, PAGE_SIZE - count,
 			   "total nents: %lu\n", total);
 
@@ -129,6 +143,7 @@ int hyper_dmabuf_table_init(void)
 {
 	hash_init(hyper_dmabuf_hash_imported);
 	hash_init(hyper_dmabuf_hash_exported);
+	hash_init(hyper_dmabuf_hash_exported_dmabuf);
 	return 0;
 }
 
@@ -143,6 +158,7 @@ int hyper_dmabuf_table_destroy(void)
 int hyper_dmabuf_register_exported(struct exported_sgt_info *exported)
 {
 	struct list_entry_exported *info_entry;
+	unsigned long flags;
 
 	info_entry = kmalloc(sizeof(*info_entry), GFP_KERNEL);
 
@@ -151,8 +167,13 @@ int hyper_dmabuf_register_exported(struct exported_sgt_info *exported)
 
 	info_entry->exported = exported;
 
-	hash_add(hyper_dmabuf_hash_exported, &info_entry->node,
-		 info_entry->exported->hid.id);
+	spin_lock_irqsave(&hyper_dmabuf_hash_lock, flags);
+	hash_add_rcu(hyper_dmabuf_hash_exported, &info_entry->node,
+		     info_entry->exported->hid.id);
+	hash_add_rcu(hyper_dmabuf_hash_exported_dmabuf,
+		     &info_entry->node_dmabuf,
+		     (unsigned long)info_entry->exported->dma_buf);
+	spin_unlock_irqrestore(&hyper_dmabuf_hash_lock, flags);
 
 	return 0;
 }
@@ -160,6 +181,7 @@ int hyper_dmabuf_register_exported(struct exported_sgt_info *exported)
 int hyper_dmabuf_register_imported(struct imported_sgt_info *imported)
 {
 	struct list_entry_imported *info_entry;
+	unsigned long flags;
 
 	info_entry = kmalloc(sizeof(*info_entry), GFP_KERNEL);
 
@@ -168,24 +190,27 @@ int hyper_dmabuf_register_imported(struct imported_sgt_info *imported)
 
 	info_entry->imported = imported;
 
-	hash_add(hyper_dmabuf_hash_imported, &info_entry->node,
-		 info_entry->imported->hid.id);
+	spin_lock_irqsave(&hyper_dmabuf_hash_lock, flags);
+	hash_add_rcu(hyper_dmabuf_hash_imported, &info_entry->node,
+		     info_entry->imported->hid.id);
+	spin_unlock_irqrestore(&hyper_dmabuf_hash_lock, flags);
 
 	return 0;
 }
 
-struct exported_sgt_info *hyper_dmabuf_find_exported(hyper_dmabuf_id_t hid)
+/* must be called with rcu_read_lock or hyper_dmabuf_hash_lock held */
+static struct list_entry_exported *find_entry_exported(hyper_dmabuf_id_t hid)
 {
 	struct list_entry_exported *info_entry;
-	int bkt;
 
-	hash_for_each(hyper_dmabuf_hash_exported, bkt, info_entry, node)
+	hash_for_each_possible_rcu(hyper_dmabuf_hash_exported, info_entry,
+				   node, hid.id)
 		/* checking hid.id first */
 		if (info_entry->exported->hid.id == hid.id) {
 			/* then key is compared */
 			if (hyper_dmabuf_hid_keycomp(info_entry->exported->hid,
 						    hid))
-				return info_entry->exported;
+				return info_entry;
 
 			/* if key is unmatched, given HID is invalid,
 			 * so returning NULL
@@ -196,18 +221,60 @@ struct exported_sgt_info *hyper_dmabuf_find_exported(hyper_dmabuf_id_t hid)
 	return NULL;
 }
 
+/* must be called with rcu_read_lock or hyper_dmabuf_hash_lock held */
+static struct list_entry_imported *find_entry_imported(hyper_dmabuf_id_t hid)
+{
+	struct list_entry_imported *info_entry;
+
+	hash_for_each_possible_rcu(hyper_dmabuf_hash_imported, info_entry,
+				   node, hid.id)
+		/* checking hid.id first */
+		if (info_entry->imported->hid.id == hid.id) {
+			/* then key is compared */
+			if (hyper_dmabuf_hid_keycomp(info_entry->imported->hid,
+						    hid))
+				return info_entry;
+
+			/* if key is unmatched, given HID is invalid,
+			 * so returning NULL
+			 */
+			break;
+		}
+
+	return NULL;
+}
+
+struct exported_sgt_info *hyper_dmabuf_find_exported(hyper_dmabuf_id_t hid)
+{
+	struct list_entry_exported *info_entry;
+	struct exported_sgt_info *exported = NULL;
+
+	rcu_read_lock();
+	info_entry = find_entry_exported(hid);
+	if (info_entry)
+		exported = info_entry->exported;
+	rcu_read_unlock();
+
+	return exported;
+}
+
 /* search for pre-exported sgt and return id of it if it exist */
 hyper_dmabuf_id_t hyper_dmabuf_find_hid_exported(struct dma_buf *dmabuf,
 						 int domid)
 {
 	struct list_entry_exported *info_entry;
 	hyper_dmabuf_id_t hid = {-1, {0, 0, 0} };
-	int bkt;
 
-	hash_for_each(hyper_dmabuf_hash_exported, bkt, info_entry, node)
+	rcu_read_lock();
+	hash_for_each_possible_rcu(hyper_dmabuf_hash_exported_dmabuf,
+				   info_entry, node_dmabuf,
+				   (unsigned long)dmabuf)
 		if (info_entry->exported->dma_buf == dmabuf &&
-		    info_entry->exported->rdomid == domid)
-			return info_entry->exported->hid;
+		    info_entry->exported->rdomid == domid) {
+			hid = info_entry->exported->hid;
+			break;
+		}
+	rcu_read_unlock();
 
 	return hid;
 }
@@ -215,78 +282,69 @@ hyper_dmabuf_id_t hyper_dmabuf_find_hid_exported(struct dma_buf *dmabuf,
 struct imported_sgt_info *hyper_dmabuf_find_imported(hyper_dmabuf_id_t hid)
 {
 	struct list_entry_imported *info_entry;
-	int bkt;
+	struct imported_sgt_info *imported = NULL;
 
-	hash_for_each(hyper_dmabuf_hash_imported, bkt, info_entry, node)
-		/* checking hid.id first */
-		if (info_entry->imported->hid.id == hid.id) {
-			/* then key is compared */
-			if (hyper_dmabuf_hid_keycomp(info_entry->imported->hid,
-						    hid))
-				return info_entry->imported;
-			/* if key is unmatched, given HID is invalid,
-			 * so returning NULL
-			 */
-			break;
-		}
+	rcu_read_lock();
+	info_entry = find_entry_imported(hid);
+	if (info_entry)
+		imported = info_entry->imported;
+	rcu_read_unlock();
 
-	return NULL;
+	return imported;
 }
 
 int hyper_dmabuf_remove_exported(hyper_dmabuf_id_t hid)
 {
 	struct list_entry_exported *info_entry;
-	int bkt;
+	unsigned long flags;
 
-	hash_for_each(hyper_dmabuf_hash_exported, bkt, info_entry, node)
-		/* checking hid.id first */
-		if (info_entry->exported->hid.id == hid.id) {
-			/* then key is compared */
-			if (hyper_dmabuf_hid_keycomp(info_entry->exported->hid,
-						    hid)) {
-				hash_del(&info_entry->node);
-				kfree(info_entry);
-				return 0;
-			}
+	spin_lock_irqsave(&hyper_dmabuf_hash_lock, flags);
+	info_entry = find_entry_exported(hid);
+	if (info_entry) {
+		hash_del_rcu(&info_entry->node);
+		hash_del_rcu(&info_entry->node_dmabuf);
+	}
+	spin_unlock_irqrestore(&hyper_dmabuf_hash_lock, flags);
 
-			break;
-		}
+	if (!info_entry)
+		return -ENOENT;
 
-	return -ENOENT;
+	kfree_rcu(info_entry, rcu);
+
+	return 0;
 }
 
 int hyper_dmabuf_remove_imported(hyper_dmabuf_id_t hid)
 {
 	struct list_entry_imported *info_entry;
-	int bkt;
+	unsigned long flags;
 
-	hash_for_each(hyper_dmabuf_hash_imported, bkt, info_entry, node)
-		/* checking hid.id first */
-		if (info_entry->imported->hid.id == hid.id) {
-			/* then key is compared */
-			if (hyper_dmabuf_hid_keycomp(info_entry->imported->hid,
-						    hid)) {
-				hash_del(&info_entry->node);
-				kfree(info_entry);
-				return 0;
-			}
+	spin_lock_irqsave(&hyper_dmabuf_hash_lock, flags);
+	info_entry = find_entry_imported(hid);
+	if (info_entry)
+		hash_del_rcu(&info_entry->node);
+	spin_unlock_irqrestore(&hyper_dmabuf_hash_lock, flags);
 
-			break;
-		}
+	if (!info_entry)
+		return -ENOENT;
 
-	return -ENOENT;
+	kfree_rcu(info_entry, rcu);
+
+	return 0;
 }
 
+/* func is called under rcu_read_lock, so it must not sleep */
 void hyper_dmabuf_foreach_exported(
 	void (*func)(struct exported_sgt_info *, void *attr),
 	void *attr)
 {
 	struct list_entry_exported *info_entry;
-	struct hlist_node *tmp;
 	int bkt;
 
-	hash_for_each_safe(hyper_dmabuf_hash_exported, bkt, tmp,
-			info_entry, node) {
+	rcu_read_lock();
+	hash_for_each_rcu(hyper_dmabuf_hash_exported, bkt,
+			  info_entry, node) {
 		func(info_entry->exported, attr);
 	}
+	rcu_read_unlock();
 }
@@ -35,11 +35,14 @@
 struct list_entry_exported {
 	struct exported_sgt_info *exported;
 	struct hlist_node node;
+	struct hlist_node node_dmabuf;
+	struct rcu_head rcu;
 };
 
 struct list_entry_imported {
 	struct imported_sgt_info *imported;
 	struct hlist_node node;
+	struct rcu_head rcu;
 };
 
 int hyper_dmabuf_table_init(void);
@@ -0,0 +1,115 @@
+/*
+ * Copyright © 2017 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ *
+ */
+
+#include <linux/kernel.h>
+#include <linux/errno.h>
+#include <linux/list.h>
+#include <linux/mutex.h>
+#include "hyper_dmabuf_drv.h"
+#include "hyper_dmabuf_struct.h"
+#include "hyper_dmabuf_sgl_proc.h"
+#include "hyper_dmabuf_map_cache.h"
+
+/* Importers keep exporting fds of the same few buffers, releasing each of
+ * them again once a frame is done. Rather than unmapping the shared pages
+ * of a buffer that is still valid when its last fd is released, keep them
+ * mapped in LRU order within a budget of MAX_PAGES_MAP_CACHE pages, until
+ * the buffer is exported again or unexported by the exporter.
+ */
+static LIST_HEAD(map_cache);
+static DEFINE_MUTEX(map_cache_lock);
+static unsigned long map_cache_pgs;
+
+/* must be called with map_cache_lock held */
+static void map_cache_evict(struct imported_sgt_info *imported)
+{
+	list_del_init(&imported->lru);
+	map_cache_pgs -= imported->nents;
+	hyper_dmabuf_unmap_imported(imported);
+}
+
+/* keep pages of released imported buffer mapped. Returns 0 if the
+ * buffer was cached, in which case the caller must not unmap it.
+ */
+int hyper_dmabuf_map_cache_add(struct imported_sgt_info *imported)
+{
+	struct imported_sgt_info *oldest;
+
+	if (!imported->sgt)
+		return -ENOENT;
+
+	mutex_lock(&map_cache_lock);
+
+	list_add_tail(&imported->lru, &map_cache);
+	map_cache_pgs += imported->nents;
+
+	while (map_cache_pgs > MAX_PAGES_MAP_CACHE) {
+		oldest = list_first_entry(&map_cache,
+					  struct imported_sgt_info, lru);
+		map_cache_evict(oldest);
+	}
+
+	mutex_unlock(&map_cache_lock);
+
+	return 0;
+}
+
+/* take imported buffer out of the cache before it is used again, so that
+ * its mapping can't be evicted while in use. The mapping is gone if the
+ * buffer was evicted before.
+ */
+void hyper_dmabuf_map_cache_get(struct imported_sgt_info *imported)
+{
+	mutex_lock(&map_cache_lock);
+
+	if (!list_empty(&imported->lru)) {
+		list_del_init(&imported->lru);
+		map_cache_pgs -= imported->nents;
+	}
+
+	mutex_unlock(&map_cache_lock);
+}
+
+/* unmap imported buffer if it is cached, e.g. when it is unexported */
+void hyper_dmabuf_map_cache_drop(struct imported_sgt_info *imported)
+{
+	mutex_lock(&map_cache_lock);
+
+	if (!list_empty(&imported->lru))
+		map_cache_evict(imported);
+
+	mutex_unlock(&map_cache_lock);
+}
+
+void hyper_dmabuf_map_cache_destroy(void)
+{
+	mutex_lock(&map_cache_lock);
+
+	while (!list_empty(&map_cache))
+		map_cache_evict(list_first_entry(&map_cache,
+						 struct imported_sgt_info,
+						 lru));
+
+	mutex_unlock(&map_cache_lock);
+}
@@ -0,0 +1,63 @@
+/*
+ * Copyright © 2017 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ *
+ */
+
+#ifndef __HYPER_DMABUF_MAP_CACHE_H__
+#define __HYPER_DMABUF_MAP_CACHE_H__
+
+#include <linux/mm.h>
+#include "hyper_dmabuf_struct.h"
+
+/* max number of pages kept mapped for released imported buffers */
+#define MAX_PAGES_MAP_CACHE ((64 << 20) >> PAGE_SHIFT)
+
+#ifdef CONFIG_HYPER_DMABUF_MAP_CACHE
+int hyper_dmabuf_map_cache_add(struct imported_sgt_info *imported);
+
+void hyper_dmabuf_map_cache_get(struct imported_sgt_info *imported);
+
+void hyper_dmabuf_map_cache_drop(struct imported_sgt_info *imported);
+
+void hyper_dmabuf_map_cache_destroy(void);
+#else
+static inline int hyper_dmabuf_map_cache_add(struct imported_sgt_info *imported)
+{
+	return -ENOENT;
+}
+
+static inline void
+hyper_dmabuf_map_cache_get(struct imported_sgt_info *imported)
+{
+}
+
+static inline void
+hyper_dmabuf_map_cache_drop(struct imported_sgt_info *imported)
+{
+}
+
+static inline void hyper_dmabuf_map_cache_destroy(void)
+{
+}
+#endif
+
+#endif /* __HYPER_DMABUF_MAP_CACHE_H__ */
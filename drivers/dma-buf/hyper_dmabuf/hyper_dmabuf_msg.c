@@ -35,13 +35,121 @@
 #include "hyper_dmabuf_remote_sync.h"
 #include "hyper_dmabuf_event.h"
 #include "hyper_dmabuf_list.h"
+#include "hyper_dmabuf_map_cache.h"
+#include "hyper_dmabuf_fence.h"
+#include "hyper_dmabuf_stats.h"
+
+#define CREATE_TRACE_POINTS
+#include "hyper_dmabuf_trace.h"
+
+/* number of preallocated messages, shared by received messages waiting
+ * for the workqueue and requests being sent. Messages are only allocated
+ * once all of them are in use.
+ */
+#define HYPER_DMABUF_MSG_POOL_SIZE 64
 
 struct cmd_process {
 	struct work_struct work;
-	struct hyper_dmabuf_req *rq;
+	struct hyper_dmabuf_req rq;
 	int domid;
+
+	/* when message was received */
+	ktime_t rx_time;
+
+	/* unexported buffer to be freed by unexport_work */
+	struct imported_sgt_info *imported;
+
+	/* entry of msg_pool, otherwise allocated */
+	bool pooled;
+	struct list_head list;
 };
 
+static struct cmd_process *msg_pool;
+static LIST_HEAD(msg_free_list);
+
+/* messages are taken from rx path, which may be irq context */
+static DEFINE_SPINLOCK(msg_pool_lock);
+
+static struct cmd_process *msg_get(gfp_t gfp)
+{
+	struct cmd_process *proc = NULL;
+	unsigned long flags;
+
+	spin_lock_irqsave(&msg_pool_lock, flags);
+	if (!list_empty(&msg_free_list)) {
+		proc = list_first_entry(&msg_free_list, struct cmd_process,
+					list);
+		list_del(&proc->list);
+	}
+	spin_unlock_irqrestore(&msg_pool_lock, flags);
+
+	if (proc)
+		return proc;
+
+	proc = kmalloc(sizeof(*proc), gfp);
+	if (proc)
+		proc->pooled = false;
+
+	return proc;
+}
+
+static void msg_put(struct cmd_process *proc)
+{
+	unsigned long flags;
+
+	if (!proc->pooled) {
+		kfree(proc);
+		return;
+	}
+
+	spin_lock_irqsave(&msg_pool_lock, flags);
+	list_add(&proc->list, &msg_free_list);
+	spin_unlock_irqrestore(&msg_pool_lock, flags);
+}
+
+struct hyper_dmabuf_req *hyper_dmabuf_req_alloc(void)
+{
+	struct cmd_process *proc = msg_get(GFP_KERNEL);
+
+	if (!proc)
+		return NULL;
+
+	memset(&proc->rq, 0, sizeof(proc->rq));
+
+	return &proc->rq;
+}
+
+void hyper_dmabuf_req_free(struct hyper_dmabuf_req *req)
+{
+	if (req)
+		msg_put(container_of(req, struct cmd_process, rq));
+}
+
+int hyper_dmabuf_msg_init(void)
+{
+	int i;
+
+	msg_pool = kcalloc(HYPER_DMABUF_MSG_POOL_SIZE, sizeof(*msg_pool),
+			   GFP_KERNEL);
+	if (!msg_pool)
+		return -ENOMEM;
+
+	for (i = 0; i < HYPER_DMABUF_MSG_POOL_SIZE; i++) {
+		msg_pool[i].pooled = true;
+		list_add_tail(&msg_pool[i].list, &msg_free_list);
+	}
+
+	return 0;
+}
+
+/* must be called once no message is in flight anymore */
+void hyper_dmabuf_msg_destroy(void)
+{
+	INIT_LIST_HEAD(&msg_free_list);
+	kfree(msg_pool);
+	msg_pool = NULL;
+}
+
 void hyper_dmabuf_create_req(struct hyper_dmabuf_req *req,
 			     enum hyper_dmabuf_command cmd, int *op)
 {
@@ -64,9 +172,12 @@ void hyper_dmabuf_create_req(struct hyper_dmabuf_req *req,
 		 * op9 : size of private data (from op9)
 		 * op10 ~ : Driver-specific private data
 		 *	   (e.g. graphic buffer's meta info)
+		 * op63 : seqno of fence to wait for, 0 if none
 		 */
 
 		memcpy(&req->op[0], &op[0], 10 * sizeof(int) + op[9]);
+		req->op[HYPER_DMABUF_EXPORT_FENCE_OP] =
+			op[HYPER_DMABUF_EXPORT_FENCE_OP];
 		break;
 
 	case HYPER_DMABUF_NOTIFY_UNEXPORT:
@@ -112,6 +223,17 @@ void hyper_dmabuf_create_req(struct hyper_dmabuf_req *req,
 			req->op[i] = op[i];
 		break;
 
+	case HYPER_DMABUF_FENCE_SIGNAL:
+		/* fence of exported buffer has signaled
+		 *
+		 * command : HYPER_DMABUF_FENCE_SIGNAL,
+		 * op0~3 : hyper_dmabuf_id
+		 * op4 : seqno of the fence
+		 */
+		for (i = 0; i < 5; i++)
+			req->op[i] = op[i];
+		break;
+
 	default:
 		/* no command found */
 		return;
@@ -127,7 +249,11 @@ static void cmd_process_work(struct work_struct *work)
 	hyper_dmabuf_id_t hid;
 	int i;
 
-	req = proc->rq;
+	req = &proc->rq;
+
+	trace_hyper_dmabuf_cmd_process(proc->domid, req,
+				       ktime_us_delta(ktime_get(),
+						      proc->rx_time));
 
 	switch (req->cmd) {
 	case HYPER_DMABUF_EXPORT:
@@ -142,6 +268,7 @@ static void cmd_process_work(struct work_struct *work)
 		 * op9 : size of private data (from op9)
 		 * op10 ~ : Driver-specific private data
 		 *         (e.g. graphic buffer's meta info)
+		 * op63 : seqno of fence to wait for, 0 if none
 		 */
 
 		/* if nents == 0, it means it is a message only for
@@ -179,11 +306,20 @@ static void cmd_process_work(struct work_struct *work)
 			/* updating priv data */
 			memcpy(imported->priv, &req->op[10], req->op[9]);
 
+			if (req->op[HYPER_DMABUF_EXPORT_FENCE_OP])
+				hyper_dmabuf_fence_import(imported,
+					req->op[HYPER_DMABUF_EXPORT_FENCE_OP]);
+
 #ifdef CONFIG_HYPER_DMABUF_EVENT_GEN
 			/* generating import event */
 			hyper_dmabuf_import_event(imported->hid);
 #endif
 
+			hyper_dmabuf_stats_latency(proc->domid,
+						   HYPER_DMABUF_LAT_IMPORT,
+						   proc->rx_time);
+			imported->import_time = ktime_get();
+
 			break;
 		}
 
@@ -192,6 +328,9 @@ static void cmd_process_work(struct work_struct *work)
 		if (!imported)
 			break;
 
+		INIT_LIST_HEAD(&imported->lru);
+		INIT_LIST_HEAD(&imported->fences);
+
 		imported->sz_priv = req->op[9];
 		imported->priv = kcalloc(1, req->op[9], GFP_KERNEL);
 
@@ -222,7 +361,12 @@ static void cmd_process_work(struct work_struct *work)
 
 		memcpy(imported->priv, &req->op[10], req->op[9]);
 
+		if (req->op[HYPER_DMABUF_EXPORT_FENCE_OP])
+			hyper_dmabuf_fence_import(imported,
+				req->op[HYPER_DMABUF_EXPORT_FENCE_OP]);
+
 		imported->valid = true;
+		imported->import_time = ktime_get();
 		hyper_dmabuf_register_imported(imported);
 
 #ifdef CONFIG_HYPER_DMABUF_EVENT_GEN
@@ -230,6 +374,10 @@ static void cmd_process_work(struct work_struct *work)
 		hyper_dmabuf_import_event(imported->hid);
 #endif
 
+		hyper_dmabuf_stats_latency(proc->domid,
+					   HYPER_DMABUF_LAT_IMPORT,
+					   proc->rx_time);
+
 		break;
 
 	case HYPER_DMABUF_OPS_TO_SOURCE:
@@ -253,11 +401,24 @@ static void cmd_process_work(struct work_struct *work)
 
 		break;
 
-
-	case HYPER_DMABUF_OPS_TO_REMOTE:
-		/* notifying dmabuf map/unmap to importer
-		 * (probably not needed) for dmabuf synchronization
+	case HYPER_DMABUF_FENCE_SIGNAL:
+		/* fence of exported buffer has signaled
+		 *
+		 * command : HYPER_DMABUF_FENCE_SIGNAL,
+		 * op0~3 : hyper_dmabuf_id
+		 * op4 : seqno of the fence
 		 */
+		hid.id = req->op[0];
+		hid.rng_key[0] = req->op[1];
+		hid.rng_key[1] = req->op[2];
+		hid.rng_key[2] = req->op[3];
+
+		imported = hyper_dmabuf_find_imported(hid);
+
+		/* buffer might be gone already */
+		if (imported)
+			hyper_dmabuf_fence_signal(imported, req->op[4]);
+
 		break;
 
 	default:
@@ -265,14 +426,30 @@ static void cmd_process_work(struct work_struct *work)
 		break;
 	}
 
-	kfree(req);
-	kfree(proc);
+	msg_put(proc);
+}
+
+/* unmapping and freeing an unexported buffer may sleep, so it is done
+ * here rather than in the rx path
+ */
+static void unexport_work(struct work_struct *work)
+{
+	struct cmd_process *proc = container_of(work, struct cmd_process,
+						work);
+	struct imported_sgt_info *imported = proc->imported;
+
+	/* unmap it if it was kept mapped */
+	hyper_dmabuf_map_cache_drop(imported);
+	hyper_dmabuf_fence_release(imported);
+	kfree(imported->priv);
+	kfree(imported);
+
+	msg_put(proc);
 }
 
 int hyper_dmabuf_msg_parse(int domid, struct hyper_dmabuf_req *req)
 {
 	struct cmd_process *proc;
-	struct hyper_dmabuf_req *temp_req;
 	struct imported_sgt_info *imported;
 	struct exported_sgt_info *exported;
 	hyper_dmabuf_id_t hid;
@@ -282,17 +459,21 @@ int hyper_dmabuf_msg_parse(int domid, struct hyper_dmabuf_req *req)
 		return -EINVAL;
 	}
 
+	trace_hyper_dmabuf_msg_parse(domid, req);
+
 	hid.id = req->op[0];
 	hid.rng_key[0] = req->op[1];
 	hid.rng_key[1] = req->op[2];
 	hid.rng_key[2] = req->op[3];
 
 	if ((req->cmd < HYPER_DMABUF_EXPORT) ||
-		(req->cmd > HYPER_DMABUF_OPS_TO_SOURCE)) {
+		(req->cmd > HYPER_DMABUF_FENCE_SIGNAL)) {
 		dev_err(hy_drv_priv->dev, "invalid command\n");
 		return -EINVAL;
 	}
 
+	hyper_dmabuf_stats_msg(domid, req, true);
+
 	req->stat = HYPER_DMABUF_REQ_PROCESSED;
 
 	/* HYPER_DMABUF_DESTROY requires immediate
@@ -318,11 +499,21 @@ int hyper_dmabuf_msg_parse(int domid, struct hyper_dmabuf_req *req)
 				imported->valid = false;
 			} else {
 				/* No one is using buffer, remove it from
-				 * imported list
+				 * imported list and let the workqueue
+				 * free it
 				 */
+				proc = msg_get(GFP_ATOMIC);
+				if (!proc) {
+					req->stat = HYPER_DMABUF_REQ_ERROR;
+					return -ENOMEM;
+				}
+
 				hyper_dmabuf_remove_imported(hid);
-				kfree(imported->priv);
-				kfree(imported);
+
+				proc->imported = imported;
+				INIT_WORK(&proc->work, unexport_work);
+				queue_work(hy_drv_priv->work_queue,
+					   &proc->work);
 			}
 		} else {
 			req->stat = HYPER_DMABUF_REQ_ERROR;
@@ -387,24 +578,22 @@ int hyper_dmabuf_msg_parse(int domid, struct hyper_dmabuf_req *req)
 		return req->cmd;
 	}
 
+	/* notifying dmabuf map/unmap to importer (probably not needed)
+	 * for dmabuf synchronization, nothing to do
+	 */
+	if (req->cmd == HYPER_DMABUF_OPS_TO_REMOTE)
+		return req->cmd;
+
 	dev_dbg(hy_drv_priv->dev,
 		"%s: putting request to workqueue\n", __func__);
-	temp_req = kmalloc(sizeof(*temp_req), GFP_ATOMIC);
+	proc = msg_get(GFP_ATOMIC);
 
-	if (!temp_req)
+	if (!proc)
 		return -ENOMEM;
 
-	memcpy(temp_req, req, sizeof(*temp_req));
-
-	proc = kcalloc(1, sizeof(struct cmd_process), GFP_ATOMIC);
-
-	if (!proc) {
-		kfree(temp_req);
-		return -ENOMEM;
-	}
-
-	proc->rq = temp_req;
+	memcpy(&proc->rq, req, sizeof(proc->rq));
 	proc->domid = domid;
+	proc->rx_time = ktime_get();
 
 	INIT_WORK(&(proc->work), cmd_process_work);
 
@@ -27,6 +27,9 @@
 
 #define MAX_NUMBER_OF_OPERANDS 64
 
+/* operand of EXPORT carrying seqno of fence to wait for (0 if none) */
+#define HYPER_DMABUF_EXPORT_FENCE_OP (MAX_NUMBER_OF_OPERANDS - 1)
+
 struct hyper_dmabuf_req {
 	unsigned int req_id;
 	unsigned int stat;
@@ -48,6 +51,7 @@ enum hyper_dmabuf_command {
 	HYPER_DMABUF_NOTIFY_UNEXPORT,
 	HYPER_DMABUF_OPS_TO_REMOTE,
 	HYPER_DMABUF_OPS_TO_SOURCE,
+	HYPER_DMABUF_FENCE_SIGNAL,
 };
 
 enum hyper_dmabuf_ops {
@@ -74,6 +78,17 @@ enum hyper_dmabuf_req_feedback {
 	HYPER_DMABUF_REQ_NOT_RESPONDED
 };
 
+/* get a zeroed request packet for sending, from the message pool if
+ * possible
+ */
+struct hyper_dmabuf_req *hyper_dmabuf_req_alloc(void);
+
+void hyper_dmabuf_req_free(struct hyper_dmabuf_req *req);
+
+int hyper_dmabuf_msg_init(void);
+
+void hyper_dmabuf_msg_destroy(void);
+
 /* create a request packet with given command and operands */
 void hyper_dmabuf_create_req(struct hyper_dmabuf_req *req,
 				 enum hyper_dmabuf_command command,
@@ -38,6 +38,8 @@
 #include "hyper_dmabuf_id.h"
 #include "hyper_dmabuf_msg.h"
 #include "hyper_dmabuf_list.h"
+#include "hyper_dmabuf_map_cache.h"
+#include "hyper_dmabuf_fence.h"
 
 #define WAIT_AFTER_SYNC_REQ 0
 #define REFS_PER_PAGE (PAGE_SIZE/sizeof(grant_ref_t))
@@ -65,7 +67,7 @@ static int sync_request(hyper_dmabuf_id_t hid, int dmabuf_ops)
 
 	op[4] = dmabuf_ops;
 
-	req = kcalloc(1, sizeof(*req), GFP_KERNEL);
+	req = hyper_dmabuf_req_alloc();
 
 	if (!req)
 		return -ENOMEM;
@@ -81,7 +83,7 @@ static int sync_request(hyper_dmabuf_id_t hid, int dmabuf_ops)
 			"dmabuf sync request failed:%d\n", req->op[4]);
 	}
 
-	kfree(req);
+	hyper_dmabuf_req_free(req);
 
 	return ret;
 }
@@ -124,7 +126,6 @@ static struct sg_table *hyper_dmabuf_ops_map(
 {
 	struct sg_table *st;
 	struct imported_sgt_info *imported;
-	struct pages_info *pg_info;
 	int ret;
 
 	if (!attachment->dmabuf->priv)
@@ -132,36 +133,21 @@ static struct sg_table *hyper_dmabuf_ops_map(
 
 	imported = (struct imported_sgt_info *)attachment->dmabuf->priv;
 
-	/* extract pages from sgt */
-	pg_info = hyper_dmabuf_ext_pgs(imported->sgt);
-
-	if (!pg_info)
-		return NULL;
-
-	/* create a new sg_table with extracted pages */
-	st = hyper_dmabuf_create_sgt(pg_info->pgs, pg_info->frst_ofst,
-				     pg_info->last_len, pg_info->nents);
+	/* create a new sg_table with the same, merged entries */
+	st = hyper_dmabuf_dup_sgt(imported->sgt);
 	if (!st)
-		goto err_free_sg;
+		return NULL;
 
 	if (!dma_map_sg(attachment->dev, st->sgl, st->nents, dir))
 		goto err_free_sg;
 
 	ret = sync_request(imported->hid, HYPER_DMABUF_OPS_MAP);
 
-	kfree(pg_info->pgs);
-	kfree(pg_info);
-
 	return st;
 
 err_free_sg:
-	if (st) {
-		sg_free_table(st);
-		kfree(st);
-	}
-
-	kfree(pg_info->pgs);
-	kfree(pg_info);
+	sg_free_table(st);
+	kfree(st);
 
 	return NULL;
 }
@@ -188,7 +174,6 @@ static void hyper_dmabuf_ops_unmap(struct dma_buf_attachment *attachment,
 static void hyper_dmabuf_ops_release(struct dma_buf *dma_buf)
 {
 	struct imported_sgt_info *imported;
-	struct hyper_dmabuf_bknd_ops *bknd_ops = hy_drv_priv->bknd_ops;
 	int finish;
 
 	if (!dma_buf->priv)
@@ -201,16 +186,10 @@ static void hyper_dmabuf_ops_release(struct dma_buf *dma_buf)
 
 	imported->importers--;
 
-	if (imported->importers == 0) {
-		bknd_ops->unmap_shared_pages(&imported->refs_info,
-					     imported->nents);
-
-		if (imported->sgt) {
-			sg_free_table(imported->sgt);
-			kfree(imported->sgt);
-			imported->sgt = NULL;
-		}
-	}
+	/* keep pages mapped for next export of a still valid buffer */
+	if (imported->importers == 0 &&
+	    (!imported->valid || hyper_dmabuf_map_cache_add(imported) < 0))
+		hyper_dmabuf_unmap_imported(imported);
 
 	finish = imported && !imported->valid &&
 		 !imported->importers;
@@ -224,6 +203,7 @@ static void hyper_dmabuf_ops_release(struct dma_buf *dma_buf)
 	 */
 	if (finish) {
 		hyper_dmabuf_remove_imported(imported->hid);
+		hyper_dmabuf_fence_release(imported);
 		kfree(imported->priv);
 		kfree(imported);
 	}
@@ -401,9 +381,12 @@ void hyper_dmabuf_export_dma_buf(struct imported_sgt_info *imported)
 	exp_info.ops = &hyper_dmabuf_ops;
 
 	/* multiple of PAGE_SIZE, not considering offset */
-	exp_info.size = imported->sgt->nents * PAGE_SIZE;
+	exp_info.size = imported->nents * PAGE_SIZE;
 	exp_info.flags = /* not sure about flag */ 0;
 	exp_info.priv = imported;
 
 	imported->dma_buf = dma_buf_export(&exp_info);
+
+	/* new dma_buf has to wait for pending fences, too */
+	hyper_dmabuf_fence_attach(imported);
 }
@@ -31,6 +31,7 @@
 #include "hyper_dmabuf_drv.h"
 #include "hyper_dmabuf_struct.h"
 #include "hyper_dmabuf_id.h"
+#include "hyper_dmabuf_fence.h"
 
 #define HYPER_DMABUF_SIZE(nents, first_offset, last_len) \
 	((nents)*PAGE_SIZE - (first_offset) - PAGE_SIZE + (last_len))
@@ -164,6 +165,17 @@ int hyper_dmabuf_query_imported(struct imported_sgt_info *imported,
 		}
 		break;
 
+	/* new sync_file fd, waiting for the exporter's rendering */
+	case HYPER_DMABUF_QUERY_FENCE_FD: {
+		int fd = hyper_dmabuf_fence_get_fd(imported);
+
+		if (fd < 0)
+			return fd;
+
+		*info = fd;
+		break;
+	}
+
 	default:
 		return -EINVAL;
 	}
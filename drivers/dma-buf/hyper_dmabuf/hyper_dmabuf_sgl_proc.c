@@ -33,6 +33,7 @@
 #include "hyper_dmabuf_drv.h"
 #include "hyper_dmabuf_struct.h"
 #include "hyper_dmabuf_sgl_proc.h"
+#include "hyper_dmabuf_cache.h"
 
 #define REFS_PER_PAGE (PAGE_SIZE/sizeof(grant_ref_t))
 
@@ -123,44 +124,74 @@ struct pages_info *hyper_dmabuf_ext_pgs(struct sg_table *sgt)
 	return pg_info;
 }
 
-/* create sg_table with given pages and other parameters */
+/* create sg_table with given pages and other parameters, physically
+ * contiguous pages are merged into a single entry
+ */
 struct sg_table *hyper_dmabuf_create_sgt(struct page **pgs,
 					 int frst_ofst, int last_len,
 					 int nents)
 {
 	struct sg_table *sgt;
-	struct scatterlist *sgl;
-	int i, ret;
+	unsigned long size;
+	int ret;
 
 	sgt = kmalloc(sizeof(struct sg_table), GFP_KERNEL);
 	if (!sgt)
 		return NULL;
 
-	ret = sg_alloc_table(sgt, nents, GFP_KERNEL);
-	if (ret) {
-		if (sgt) {
-			sg_free_table(sgt);
-			kfree(sgt);
-		}
+	size = (unsigned long)nents * PAGE_SIZE - frst_ofst -
+	       PAGE_SIZE + last_len;
 
+	ret = sg_alloc_table_from_pages(sgt, pgs, nents, frst_ofst, size,
+					GFP_KERNEL);
+	if (ret) {
+		kfree(sgt);
 		return NULL;
 	}
 
-	sgl = sgt->sgl;
+	return sgt;
+}
 
-	sg_set_page(sgl, pgs[0], PAGE_SIZE-frst_ofst, frst_ofst);
+/* create a copy of sg_table, keeping its entries as they are */
+struct sg_table *hyper_dmabuf_dup_sgt(struct sg_table *sgt)
+{
+	struct sg_table *st;
+	struct scatterlist *src, *dst;
+	int i, ret;
 
-	for (i = 1; i < nents-1; i++) {
-		sgl = sg_next(sgl);
-		sg_set_page(sgl, pgs[i], PAGE_SIZE, 0);
+	st = kmalloc(sizeof(struct sg_table), GFP_KERNEL);
+	if (!st)
+		return NULL;
+
+	ret = sg_alloc_table(st, sgt->orig_nents, GFP_KERNEL);
+	if (ret) {
+		kfree(st);
+		return NULL;
 	}
 
-	if (nents > 1) /* more than one page */ {
-		sgl = sg_next(sgl);
-		sg_set_page(sgl, pgs[i], last_len, 0);
+	dst = st->sgl;
+	for_each_sg(sgt->sgl, src, sgt->orig_nents, i) {
+		sg_set_page(dst, sg_page(src), src->length, src->offset);
+		dst = sg_next(dst);
 	}
 
-	return sgt;
+	return st;
+}
+
+/* unmap shared pages of imported buffer and free its sgt */
+void hyper_dmabuf_unmap_imported(struct imported_sgt_info *imported)
+{
+	struct hyper_dmabuf_bknd_ops *bknd_ops = hy_drv_priv->bknd_ops;
+
+	if (!imported->sgt)
+		return;
+
+	bknd_ops->unmap_shared_pages(&imported->refs_info, imported->nents);
+	imported->refs_info = NULL;
+
+	sg_free_table(imported->sgt);
+	kfree(imported->sgt);
+	imported->sgt = NULL;
 }
 
 int hyper_dmabuf_cleanup_sgt_info(struct exported_sgt_info *exported,
@@ -230,19 +261,24 @@ int hyper_dmabuf_cleanup_sgt_info(struct exported_sgt_info *exported,
 		kfree(attachl);
 	}
 
-	/* Start cleanup of buffer in reverse order to exporting */
-	bknd_ops->unshare_pages(&exported->refs_info, exported->nents);
+	/* keep buffer shared if it can be cached for re-export */
+	if (hyper_dmabuf_cache_add(exported) < 0) {
+		/* Start cleanup of buffer in reverse order to exporting */
+		bknd_ops->unshare_pages(&exported->refs_info, exported->nents);
 
-	/* unmap dma-buf */
-	dma_buf_unmap_attachment(exported->active_attached->attach,
-				 exported->active_sgts->sgt,
-				 DMA_BIDIRECTIONAL);
+		/* unmap dma-buf */
+		dma_buf_unmap_attachment(exported->active_attached->attach,
+					 exported->active_sgts->sgt,
+					 DMA_BIDIRECTIONAL);
+
+		/* detatch dma-buf */
+		dma_buf_detach(exported->dma_buf,
+			       exported->active_attached->attach);
 
-	/* detatch dma-buf */
-	dma_buf_detach(exported->dma_buf, exported->active_attached->attach);
+		/* close connection to dma-buf completely */
+		dma_buf_put(exported->dma_buf);
+	}
 
-	/* close connection to dma-buf completely */
-	dma_buf_put(exported->dma_buf);
 	exported->dma_buf = NULL;
 
 	kfree(exported->active_sgts);
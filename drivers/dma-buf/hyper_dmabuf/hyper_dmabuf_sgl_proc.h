@@ -33,9 +33,14 @@ struct sg_table *hyper_dmabuf_create_sgt(struct page **pgs,
 					 int frst_ofst, int last_len,
 					 int nents);
 
+/* create a copy of sg_table, keeping its entries as they are */
+struct sg_table *hyper_dmabuf_dup_sgt(struct sg_table *sgt);
+
 int hyper_dmabuf_cleanup_sgt_info(struct exported_sgt_info *exported,
 				  int force);
 
 void hyper_dmabuf_free_sgt(struct sg_table *sgt);
 
+void hyper_dmabuf_unmap_imported(struct imported_sgt_info *imported);
+
 #endif /* __HYPER_DMABUF_IMP_H__ */
@@ -0,0 +1,267 @@
+/*
+ * Copyright © 2017 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ *
+ */
+
+#include <linux/kernel.h>
+#include <linux/slab.h>
+#include <linux/log2.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#include <linux/rculist.h>
+#include "hyper_dmabuf_drv.h"
+#include "hyper_dmabuf_msg.h"
+#include "hyper_dmabuf_stats.h"
+
+/* log2 histogram of latencies in us, last bucket takes everything
+ * from 2^(HYPER_DMABUF_STATS_BUCKETS - 1) us on
+ */
+#define HYPER_DMABUF_STATS_BUCKETS 16
+
+#define HYPER_DMABUF_NR_CMDS \
+	(HYPER_DMABUF_FENCE_SIGNAL - HYPER_DMABUF_EXPORT + 1)
+
+struct lat_stats {
+	u64 count;
+	u64 sum_us;
+	u64 max_us;
+	u64 hist[HYPER_DMABUF_STATS_BUCKETS];
+};
+
+struct dom_stats {
+	int domid;
+
+	struct lat_stats lat[HYPER_DMABUF_LAT_NUM];
+
+	/* messages received from and sent to the domain */
+	u64 rx_msgs[HYPER_DMABUF_NR_CMDS];
+	u64 tx_msgs[HYPER_DMABUF_NR_CMDS];
+	u64 rx_bytes;
+	u64 tx_bytes;
+
+	struct list_head list;
+};
+
+static const char * const lat_names[HYPER_DMABUF_LAT_NUM] = {
+	[HYPER_DMABUF_LAT_EXPORT] = "export",
+	[HYPER_DMABUF_LAT_IMPORT] = "import",
+	[HYPER_DMABUF_LAT_MAP] = "map",
+};
+
+static const char * const cmd_names[HYPER_DMABUF_NR_CMDS] = {
+	"EXPORT",
+	"EXPORT_FD",
+	"EXPORT_FD_FAILED",
+	"NOTIFY_UNEXPORT",
+	"OPS_TO_REMOTE",
+	"OPS_TO_SOURCE",
+	"FENCE_SIGNAL",
+};
+
+static LIST_HEAD(dom_stats_list);
+
+/* stats are updated from message rx path, which may be irq context */
+static DEFINE_SPINLOCK(stats_lock);
+
+static struct dentry *stats_dir;
+
+/* must be called with stats_lock held */
+static struct dom_stats *get_dom_stats(int domid)
+{
+	struct dom_stats *stats;
+
+	list_for_each_entry(stats, &dom_stats_list, list)
+		if (stats->domid == domid)
+			return stats;
+
+	stats = kzalloc(sizeof(*stats), GFP_ATOMIC);
+	if (!stats)
+		return NULL;
+
+	stats->domid = domid;
+	list_add_tail_rcu(&stats->list, &dom_stats_list);
+
+	return stats;
+}
+
+void hyper_dmabuf_stats_latency(int domid, enum hyper_dmabuf_lat lat,
+				ktime_t start)
+{
+	struct dom_stats *stats;
+	struct lat_stats *l;
+	unsigned long flags;
+	s64 us;
+	int bucket;
+
+	us = ktime_us_delta(ktime_get(), start);
+	if (us < 0)
+		us = 0;
+
+	bucket = us ? ilog2(us) + 1 : 0;
+	if (bucket >= HYPER_DMABUF_STATS_BUCKETS)
+		bucket = HYPER_DMABUF_STATS_BUCKETS - 1;
+
+	spin_lock_irqsave(&stats_lock, flags);
+
+	stats = get_dom_stats(domid);
+	if (stats) {
+		l = &stats->lat[lat];
+		l->count++;
+		l->sum_us += us;
+		l->max_us = max_t(u64, l->max_us, us);
+		l->hist[bucket]++;
+	}
+
+	spin_unlock_irqrestore(&stats_lock, flags);
+}
+
+/* bytes of operands used by the message */
+static size_t msg_size(struct hyper_dmabuf_req *req)
+{
+	switch (req->cmd) {
+	case HYPER_DMABUF_EXPORT:
+		return 10 * sizeof(int) + min_t(unsigned int, req->op[9],
+						MAX_SIZE_PRIV_DATA);
+
+	case HYPER_DMABUF_OPS_TO_SOURCE:
+	case HYPER_DMABUF_FENCE_SIGNAL:
+		return 5 * sizeof(int);
+
+	default:
+		return 4 * sizeof(int);
+	}
+}
+
+void hyper_dmabuf_stats_msg(int domid, struct hyper_dmabuf_req *req,
+			    bool rx)
+{
+	struct dom_stats *stats;
+	unsigned long flags;
+	int cmd = req->cmd - HYPER_DMABUF_EXPORT;
+
+	if (cmd < 0 || cmd >= HYPER_DMABUF_NR_CMDS)
+		return;
+
+	spin_lock_irqsave(&stats_lock, flags);
+
+	stats = get_dom_stats(domid);
+	if (stats) {
+		if (rx) {
+			stats->rx_msgs[cmd]++;
+			stats->rx_bytes += msg_size(req);
+		} else {
+			stats->tx_msgs[cmd]++;
+			stats->tx_bytes += msg_size(req);
+		}
+	}
+
+	spin_unlock_irqrestore(&stats_lock, flags);
+}
+
+static void show_lat(struct seq_file *s, const char *name,
+		     struct lat_stats *l)
+{
+	int i;
+
+	if (!l->count)
+		return;
+
+	seq_printf(s, "  %s latency: count %llu avg %llu us max %llu us\n",
+		   name, l->count, div64_u64(l->sum_us, l->count), l->max_us);
+
+	for (i = 0; i < HYPER_DMABUF_STATS_BUCKETS; i++) {
+		if (!l->hist[i])
+			continue;
+
+		if (i == HYPER_DMABUF_STATS_BUCKETS - 1)
+			seq_printf(s, "    >= %lu us: %llu\n",
+				   1UL << (i - 1), l->hist[i]);
+		else
+			seq_printf(s, "    < %lu us: %llu\n",
+				   1UL << i, l->hist[i]);
+	}
+}
+
+static int hyper_dmabuf_stats_show(struct seq_file *s, void *unused)
+{
+	struct dom_stats *stats, *copy;
+	unsigned long flags;
+	int i;
+
+	copy = kmalloc(sizeof(*copy), GFP_KERNEL);
+	if (!copy)
+		return -ENOMEM;
+
+	/* domains are only removed on exit, take the lock just for
+	 * getting a consistent copy of each entry
+	 */
+	rcu_read_lock();
+	list_for_each_entry_rcu(stats, &dom_stats_list, list) {
+		spin_lock_irqsave(&stats_lock, flags);
+		*copy = *stats;
+		spin_unlock_irqrestore(&stats_lock, flags);
+
+		seq_printf(s, "domain %d\n", copy->domid);
+
+		for (i = 0; i < HYPER_DMABUF_LAT_NUM; i++)
+			show_lat(s, lat_names[i], &copy->lat[i]);
+
+		seq_printf(s, "  rx %llu bytes, tx %llu bytes\n",
+			   copy->rx_bytes, copy->tx_bytes);
+
+		for (i = 0; i < HYPER_DMABUF_NR_CMDS; i++) {
+			if (!copy->rx_msgs[i] && !copy->tx_msgs[i])
+				continue;
+
+			seq_printf(s, "  %-16s rx %llu tx %llu\n",
+				   cmd_names[i], copy->rx_msgs[i],
+				   copy->tx_msgs[i]);
+		}
+	}
+	rcu_read_unlock();
+
+	kfree(copy);
+
+	return 0;
+}
+
+DEFINE_SHOW_ATTRIBUTE(hyper_dmabuf_stats);
+
+void hyper_dmabuf_stats_init(void)
+{
+	stats_dir = debugfs_create_dir("hyper_dmabuf", NULL);
+
+	debugfs_create_file("stats", 0444, stats_dir, NULL,
+			    &hyper_dmabuf_stats_fops);
+}
+
+void hyper_dmabuf_stats_destroy(void)
+{
+	struct dom_stats *stats, *tmp;
+
+	debugfs_remove_recursive(stats_dir);
+
+	list_for_each_entry_safe(stats, tmp, &dom_stats_list, list) {
+		list_del(&stats->list);
+		kfree(stats);
+	}
+}
@@ -0,0 +1,74 @@
+/*
+ * Copyright © 2017 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ *
+ */
+
+#ifndef __HYPER_DMABUF_STATS_H__
+#define __HYPER_DMABUF_STATS_H__
+
+#include <linux/ktime.h>
+#include "hyper_dmabuf_msg.h"
+
+/* latencies measured along the path of a shared buffer */
+enum hyper_dmabuf_lat {
+	/* exporter: export ioctl until EXPORT message is acked */
+	HYPER_DMABUF_LAT_EXPORT,
+	/* importer: EXPORT message received until import event */
+	HYPER_DMABUF_LAT_IMPORT,
+	/* importer: import event until fd is exported for the buffer */
+	HYPER_DMABUF_LAT_MAP,
+	HYPER_DMABUF_LAT_NUM,
+};
+
+#ifdef CONFIG_HYPER_DMABUF_STATS
+void hyper_dmabuf_stats_latency(int domid, enum hyper_dmabuf_lat lat,
+				ktime_t start);
+
+void hyper_dmabuf_stats_msg(int domid, struct hyper_dmabuf_req *req,
+			    bool rx);
+
+void hyper_dmabuf_stats_init(void);
+
+void hyper_dmabuf_stats_destroy(void);
+#else
+static inline void hyper_dmabuf_stats_latency(int domid,
+					      enum hyper_dmabuf_lat lat,
+					      ktime_t start)
+{
+}
+
+static inline void hyper_dmabuf_stats_msg(int domid,
+					  struct hyper_dmabuf_req *req,
+					  bool rx)
+{
+}
+
+static inline void hyper_dmabuf_stats_init(void)
+{
+}
+
+static inline void hyper_dmabuf_stats_destroy(void)
+{
+}
+#endif
+
+#endif /* __HYPER_DMABUF_STATS_H__ */
@@ -62,6 +62,8 @@ struct pages_info {
  * Exporter keeps these references for synchronization
  * and tracking purposes
  */
+struct hyper_dmabuf_fence_cb;
+
 struct exported_sgt_info {
 	hyper_dmabuf_id_t hid;
 
@@ -71,6 +73,10 @@ struct exported_sgt_info {
 	struct dma_buf *dma_buf;
 	int nents;
 
+	/* offset and size info of DMA_BUF */
+	int frst_ofst;
+	int last_len;
+
 	/* list for tracking activities on dma_buf */
 	struct sgt_list *active_sgts;
 	struct attachment_list *active_attached;
@@ -90,9 +96,18 @@ struct exported_sgt_info {
 	/* hypervisor specific reference data for shared pages */
 	void *refs_info;
 
+	/* top-level reference to shared pages sent to importer */
+	long ref_handle;
+
 	struct delayed_work unexport;
 	bool unexport_sched;
 
+	/* seqno of last fence passed to importer and the callback
+	 * prepared for the one about to be passed
+	 */
+	u32 fence_seqno;
+	struct hyper_dmabuf_fence_cb *fence_cb;
+
 	/* list for file pointers associated with all user space
 	 * application that have exported this same buffer to
 	 * another VM. This needs to be tracked to know whether
@@ -107,6 +122,26 @@ struct exported_sgt_info {
 	char *priv;
 };
 
+/* Exporter keeps dma_buf, attachment and shared pages of released
+ * buffers for a while in case the same buffer gets exported again
+ */
+struct cached_export_info {
+	struct dma_buf *dma_buf;
+	int rdomid;
+
+	struct dma_buf_attachment *attach;
+	struct sg_table *sgt;
+
+	void *refs_info;
+	long ref_handle;
+	int nents;
+	int frst_ofst;
+	int last_len;
+
+	unsigned long expires;
+	struct list_head list;
+};
+
 /* imported_sgt_info contains information about imported DMA_BUF
  * this info is kept in IMPORT list and asynchorously retrieved and
  * used to map DMA_BUF on importer VM's side upon export fd ioctl
@@ -131,6 +166,18 @@ struct imported_sgt_info {
 	bool valid;
 	int importers;
 
+	/* entry in LRU of released buffers kept mapped */
+	struct list_head lru;
+
+	/* when latest EXPORT message was processed, reset once an fd
+	 * was exported for it
+	 */
+	ktime_t import_time;
+
+	/* fences passed by exporter, not signaled yet */
+	struct list_head fences;
+	u64 fence_context;
+
 	/* size of private */
 	size_t sz_priv;
 
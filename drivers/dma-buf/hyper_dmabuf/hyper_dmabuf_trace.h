@@ -0,0 +1,88 @@
+/*
+ * Copyright © 2017 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ *
+ */
+
+#if !defined(__HYPER_DMABUF_TRACE_H__) || defined(TRACE_HEADER_MULTI_READ)
+#define __HYPER_DMABUF_TRACE_H__
+
+#include <linux/types.h>
+#include <linux/tracepoint.h>
+#include "hyper_dmabuf_msg.h"
+
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM hyper_dmabuf
+#define TRACE_INCLUDE_FILE hyper_dmabuf_trace
+
+/* message received from another domain */
+TRACE_EVENT(hyper_dmabuf_msg_parse,
+	TP_PROTO(int domid, struct hyper_dmabuf_req *req),
+	TP_ARGS(domid, req),
+
+	TP_STRUCT__entry(
+		__field(int, domid)
+		__field(unsigned int, cmd)
+		__field(int, id)
+		__field(unsigned int, op4)
+	),
+
+	TP_fast_assign(
+		__entry->domid = domid;
+		__entry->cmd = req->cmd;
+		__entry->id = req->op[0];
+		__entry->op4 = req->op[4];
+	),
+
+	TP_printk("domid=%d cmd=0x%x id=%d op4=%u",
+		  __entry->domid, __entry->cmd, __entry->id, __entry->op4)
+);
+
+/* deferred message processed by workqueue, delay since it was received */
+TRACE_EVENT(hyper_dmabuf_cmd_process,
+	TP_PROTO(int domid, struct hyper_dmabuf_req *req, s64 delay_us),
+	TP_ARGS(domid, req, delay_us),
+
+	TP_STRUCT__entry(
+		__field(int, domid)
+		__field(unsigned int, cmd)
+		__field(int, id)
+		__field(s64, delay_us)
+	),
+
+	TP_fast_assign(
+		__entry->domid = domid;
+		__entry->cmd = req->cmd;
+		__entry->id = req->op[0];
+		__entry->delay_us = delay_us;
+	),
+
+	TP_printk("domid=%d cmd=0x%x id=%d delay=%lldus",
+		  __entry->domid, __entry->cmd, __entry->id,
+		  __entry->delay_us)
+);
+
+#endif /* __HYPER_DMABUF_TRACE_H__ */
+
+/* This part must be outside protection */
+#undef TRACE_INCLUDE_PATH
+#define TRACE_INCLUDE_PATH ../../drivers/dma-buf/hyper_dmabuf
+#include <trace/define_trace.h>
@@ -40,6 +40,7 @@
 #include <linux/vhm/acrn_vhm_mm.h>
 #include "../hyper_dmabuf_msg.h"
 #include "../hyper_dmabuf_drv.h"
+#include "../hyper_dmabuf_stats.h"
 #include "hyper_dmabuf_virtio_common.h"
 #include "hyper_dmabuf_virtio_fe_list.h"
 #include "hyper_dmabuf_virtio_shm.h"
@@ -459,6 +460,8 @@ static int virtio_be_send_req(int vmid, struct hyper_dmabuf_req *req,
 		return -ENOENT;
 	}
 
+	hyper_dmabuf_stats_msg(vmid, req, false);
+
 	priv = fe_info->priv;
 
 	mutex_lock(&priv->lock);
@@ -32,9 +32,11 @@
 #include <linux/virtio.h>
 #include <linux/virtio_ids.h>
 #include <linux/virtio_config.h>
+#include <linux/wait.h>
 #include <linux/workqueue.h>
 #include "../hyper_dmabuf_msg.h"
 #include "../hyper_dmabuf_drv.h"
+#include "../hyper_dmabuf_stats.h"
 #include "hyper_dmabuf_virtio_common.h"
 #include "hyper_dmabuf_virtio_shm.h"
 #include "hyper_dmabuf_virtio_comm_ring.h"
@@ -42,6 +44,11 @@
 /*
  * Identifies which queue is used for TX and RX
  * Note: it is opposite regarding to backend definition
+ *
+ * The device model sets up exactly this one pair of queues and the
+ * device has no feature bits or config space to negotiate more, so all
+ * senders share the tx queue and priv->lock. Queues per vCPU would need
+ * support for it in the device model and in the backend first.
  */
 enum virio_queue_type {
 	HDMA_VIRTIO_TX_QUEUE = 0,
@@ -49,6 +56,16 @@ enum virio_queue_type {
 	HDMA_VIRTIO_QUEUE_MAX
 };
 
+/*
+ * Requests that don't wait for a response are queued without notifying
+ * the backend, which is kicked once for the whole batch either by the
+ * next request waiting for a response, by tx_kick_work or when
+ * HDMA_TX_BATCH requests are pending.
+ */
+#define HDMA_TX_BATCH		16
+/* Time to wait for a free request buffer or for a response */
+#define HDMA_TX_TIMEOUT_MS	100
+
 struct virtio_hdma_fe_priv {
 	struct virtqueue *vqs[HDMA_VIRTIO_QUEUE_MAX];
 	struct virtio_comm_ring tx_ring;
@@ -59,6 +76,15 @@ struct virtio_hdma_fe_priv {
 	 * which are not safe to run concurrently
 	 */
 	spinlock_t lock;
+
+	/* Request of sender waiting for response, per tx_ring entry */
+	struct hyper_dmabuf_req *tx_waiter[REQ_RING_SIZE];
+	/* Woken up on responses and freed tx_ring entries */
+	wait_queue_head_t tx_wq;
+
+	/* Requests queued since backend was last notified */
+	int tx_batched;
+	struct work_struct tx_kick_work;
 };
 
 /* Assuming there will be one FE instance per VM */
@@ -73,7 +99,8 @@ static void virtio_hdma_fe_tx_done(struct virtqueue *vq)
 {
 	struct virtio_hdma_fe_priv *priv =
 		(struct virtio_hdma_fe_priv *) vq->vdev->priv;
-	int len;
+	struct hyper_dmabuf_req *tx_req;
+	int len, slot;
 	unsigned long flags;
 
 	if (priv == NULL) {
@@ -84,22 +111,35 @@ static void virtio_hdma_fe_tx_done(struct virtqueue *vq)
 
 	spin_lock_irqsave(&priv->lock, flags);
 	/* Make sure that all pending responses are processed */
-	while (virtqueue_get_buf(vq, &len)) {
+	while ((tx_req = virtqueue_get_buf(vq, &len))) {
 		if (len == sizeof(struct hyper_dmabuf_req)) {
+			/* Hand response over to the waiting sender, the
+			 * buffer may be reused as soon as it is popped
+			 */
+			slot = tx_req -
+			       (struct hyper_dmabuf_req *)priv->tx_ring.data;
+			if (priv->tx_waiter[slot]) {
+				memcpy(priv->tx_waiter[slot], tx_req,
+				       sizeof(*tx_req));
+				priv->tx_waiter[slot] = NULL;
+			}
+
 			/* Mark that response was received
 			 * and buffer can be reused */
 			virtio_comm_ring_pop(&priv->tx_ring);
 		}
 	}
 	spin_unlock_irqrestore(&priv->lock, flags);
+
+	wake_up(&priv->tx_wq);
 }
 
 /*
- * Sends given data buffer via given virtqueue.
+ * Adds given data buffer to given virtqueue, without notifying backend.
  */
-static void virtio_hdma_fe_queue_buffer(struct virtio_hdma_fe_priv *priv,
-					unsigned int queue_nr,
-					void *buf, size_t size)
+static void virtio_hdma_fe_add_buffer(struct virtio_hdma_fe_priv *priv,
+				      unsigned int queue_nr,
+				      void *buf, size_t size)
 {
 	struct scatterlist sg;
 
@@ -111,11 +151,48 @@ static void virtio_hdma_fe_queue_buffer(struct virtio_hdma_fe_priv *priv,
 
 	sg_init_one(&sg, buf, size);
 
-	virtqueue_add_inbuf(priv->vqs[queue_nr], &sg, 1, buf, GFP_KERNEL);
+	virtqueue_add_inbuf(priv->vqs[queue_nr], &sg, 1, buf, GFP_ATOMIC);
+}
+
+/*
+ * Sends given data buffer via given virtqueue.
+ */
+static void virtio_hdma_fe_queue_buffer(struct virtio_hdma_fe_priv *priv,
+					unsigned int queue_nr,
+					void *buf, size_t size)
+{
+	if (queue_nr >= HDMA_VIRTIO_QUEUE_MAX) {
+		dev_dbg(hy_drv_priv->dev,
+			"queue_nr exceeding max queue number\n");
+		return;
+	}
+
+	virtio_hdma_fe_add_buffer(priv, queue_nr, buf, size);
 
 	virtqueue_kick(priv->vqs[queue_nr]);
 }
 
+/*
+ * Notifies backend about requests batched in tx queue.
+ */
+static void virtio_hdma_fe_tx_kick(struct work_struct *work)
+{
+	struct virtio_hdma_fe_priv *priv =
+		container_of(work, struct virtio_hdma_fe_priv, tx_kick_work);
+	struct virtqueue *vq = priv->vqs[HDMA_VIRTIO_TX_QUEUE];
+	bool notify = false;
+
+	spin_lock_irq(&priv->lock);
+	if (priv->tx_batched) {
+		notify = virtqueue_kick_prepare(vq);
+		priv->tx_batched = 0;
+	}
+	spin_unlock_irq(&priv->lock);
+
+	if (notify)
+		virtqueue_notify(vq);
+}
+
 /*
  *  Handle requests coming from other VMs
  */
@@ -125,6 +202,7 @@ static void virtio_hdma_fe_handle_rx(struct virtqueue *vq)
 		(struct virtio_hdma_fe_priv *) vq->vdev->priv;
 	struct hyper_dmabuf_req *rx_req;
 	int size, ret;
+	int responses = 0;
 
 	if (priv == NULL) {
 		dev_dbg(hy_drv_priv->dev,
@@ -147,9 +225,14 @@ static void virtio_hdma_fe_handle_rx(struct virtqueue *vq)
 		}
 
 		/* Send updated request back to virtqueue as a response.*/
-		virtio_hdma_fe_queue_buffer(priv, HDMA_VIRTIO_RX_QUEUE,
-				       rx_req, sizeof(*rx_req));
+		virtio_hdma_fe_add_buffer(priv, HDMA_VIRTIO_RX_QUEUE,
+					  rx_req, sizeof(*rx_req));
+		responses++;
 	}
+
+	/* Notify backend once about all responses */
+	if (responses)
+		virtqueue_kick(vq);
 }
 
 static int virtio_hdma_fe_probe_common(struct virtio_device *vdev)
@@ -175,6 +258,8 @@ static int virtio_hdma_fe_probe_common(struct virtio_device *vdev)
 	priv->vmid = -1;
 
 	spin_lock_init(&priv->lock);
+	init_waitqueue_head(&priv->tx_wq);
+	INIT_WORK(&priv->tx_kick_work, virtio_hdma_fe_tx_kick);
 
 	vdev->priv = priv;
 
@@ -205,6 +290,7 @@ static void virtio_hdma_fe_remove_common(struct virtio_device *vdev)
 		return;
 	}
 
+	cancel_work_sync(&priv->tx_kick_work);
 	vdev->config->reset(vdev);
 	vdev->config->del_vqs(vdev);
 	virtio_comm_ring_free(&priv->tx_ring);
@@ -366,9 +452,11 @@ static int virtio_hdma_fe_send_req(int vmid, struct hyper_dmabuf_req *req,
 			      int wait)
 {
 	struct virtio_hdma_fe_priv *priv = hyper_dmabuf_virtio_fe;
+	long timeout = msecs_to_jiffies(HDMA_TX_TIMEOUT_MS);
 	struct hyper_dmabuf_req *tx_req;
-	int timeout = 1000;
-	unsigned long flags;
+	struct virtqueue *vq;
+	bool notify = false;
+	int slot;
 
 	if (priv == NULL) {
 		dev_err(hy_drv_priv->dev,
@@ -376,20 +464,27 @@ static int virtio_hdma_fe_send_req(int vmid, struct hyper_dmabuf_req *req,
 		return -ENOENT;
 	}
 
-	/* Check if there are any free buffers in ring */
-	while (timeout--) {
-		if (!virtio_comm_ring_full(&priv->tx_ring))
-			break;
-		usleep_range(100, 120);
-	}
+	hyper_dmabuf_stats_msg(vmid, req, false);
 
-	if (timeout < 0) {
-		dev_err(hy_drv_priv->dev,
-			"Timedout while waiting for free request buffers\n");
-		return -EBUSY;
+	vq = priv->vqs[HDMA_VIRTIO_TX_QUEUE];
+
+	spin_lock_irq(&priv->lock);
+	/* Wait for a free buffer in ring */
+	while (virtio_comm_ring_full(&priv->tx_ring)) {
+		spin_unlock_irq(&priv->lock);
+
+		timeout = wait_event_timeout(priv->tx_wq,
+				!virtio_comm_ring_full(&priv->tx_ring),
+				timeout);
+		if (!timeout) {
+			dev_err(hy_drv_priv->dev,
+				"Timedout while waiting for free request buffers\n");
+			return -EBUSY;
+		}
+
+		spin_lock_irq(&priv->lock);
 	}
 
-	spin_lock_irqsave(&priv->lock, flags);
 	/* Get free buffer for sending request from ring */
 	tx_req = (struct hyper_dmabuf_req *)
 			virtio_comm_ring_push(&priv->tx_ring);
@@ -398,21 +493,39 @@ static int virtio_hdma_fe_send_req(int vmid, struct hyper_dmabuf_req *req,
 	/* copy request to buffer that will be used in virtqueue */
 	memcpy(tx_req, req, sizeof(*req));
 
-	virtio_hdma_fe_queue_buffer(hyper_dmabuf_virtio_fe,
-			       HDMA_VIRTIO_TX_QUEUE,
-			       tx_req, sizeof(*tx_req));
-	spin_unlock_irqrestore(&priv->lock, flags);
+	/* response is copied back to req by virtio_hdma_fe_tx_done */
+	slot = tx_req - (struct hyper_dmabuf_req *)priv->tx_ring.data;
+	priv->tx_waiter[slot] = wait ? req : NULL;
 
-	if (wait) {
-		while (timeout--) {
-			if (tx_req->stat !=
-				HYPER_DMABUF_REQ_NOT_RESPONDED)
-				break;
-			usleep_range(100, 120);
-		}
+	virtio_hdma_fe_add_buffer(priv, HDMA_VIRTIO_TX_QUEUE,
+				  tx_req, sizeof(*tx_req));
 
-		if (timeout < 0)
-			return -EBUSY;
+	/* requests waiting for a response also flush the batch */
+	if (wait || ++priv->tx_batched >= HDMA_TX_BATCH) {
+		notify = virtqueue_kick_prepare(vq);
+		priv->tx_batched = 0;
+	}
+	spin_unlock_irq(&priv->lock);
+
+	if (notify)
+		virtqueue_notify(vq);
+	else if (!wait)
+		schedule_work(&priv->tx_kick_work);
+
+	if (!wait)
+		return 0;
+
+	timeout = msecs_to_jiffies(HDMA_TX_TIMEOUT_MS);
+	if (!wait_event_timeout(priv->tx_wq,
+			READ_ONCE(req->stat) != HYPER_DMABUF_REQ_NOT_RESPONDED,
+			timeout)) {
+		/* req is freed by caller, don't let a late response in */
+		spin_lock_irq(&priv->lock);
+		if (priv->tx_waiter[slot] == req)
+			priv->tx_waiter[slot] = NULL;
+		spin_unlock_irq(&priv->lock);
+
+		return -EBUSY;
 	}
 
 	return 0;
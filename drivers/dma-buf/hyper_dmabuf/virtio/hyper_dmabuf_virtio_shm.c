@@ -43,6 +43,9 @@ struct virtio_shared_pages_info {
 	u64 **lvl2_table;
 	u64 lvl3_gref;
 	struct page **data_pages;
+	/* guest addresses of mapped runs of contiguous data pages */
+	u64 *data_runs;
+	int n_data_runs;
 	int n_lvl2_refs;
 	int nents_last;
 	int vmid;
@@ -76,6 +79,58 @@ static int virtio_be_unshare_pages(void **refs_info,
 	return -EINVAL;
 }
 
+/*
+ * Maps the nents data pages listed in lvl2_table with one map_guest_phys()
+ * call per run of pages contiguous in guest physical memory, splitting
+ * runs which can't be mapped at once. Start addresses of mapped runs are
+ * stored in runs. Returns the number of runs or a negative error code.
+ */
+static int virtio_be_map_data_pages(int vmid, u64 **lvl2_table, int nents,
+				    struct page **data_pages, u64 *runs)
+{
+	int n_runs = 0;
+	int k = 0;
+	int i, len;
+	u64 start;
+	void *pageaddr;
+
+	while (k < nents) {
+		start = lvl2_table[k / REFS_PER_PAGE][k % REFS_PER_PAGE];
+
+		for (len = 1; k + len < nents; len++) {
+			i = k + len;
+			if (lvl2_table[i / REFS_PER_PAGE][i % REFS_PER_PAGE] !=
+			    start + (u64)len * PAGE_SIZE)
+				break;
+		}
+
+		for (;;) {
+			pageaddr = map_guest_phys(vmid, start,
+						  (size_t)len * PAGE_SIZE);
+			if (pageaddr || len == 1)
+				break;
+			len /= 2;
+		}
+
+		if (pageaddr == NULL)
+			goto map_failed;
+
+		runs[n_runs++] = start;
+
+		for (i = 0; i < len; i++)
+			data_pages[k++] = virt_to_page(pageaddr +
+						       i * PAGE_SIZE);
+	}
+
+	return n_runs;
+
+map_failed:
+	while (n_runs--)
+		unmap_guest_phys(vmid, runs[n_runs]);
+
+	return -EFAULT;
+}
+
 static struct page **virtio_be_map_shared_pages(unsigned long lvl3_gref,
 						int vmid, int nents,
 						void **refs_info)
@@ -83,13 +138,14 @@ static struct page **virtio_be_map_shared_pages(unsigned long lvl3_gref,
 	u64 *lvl3_table = NULL;
 	u64 **lvl2_table = NULL;
 	struct page **data_pages = NULL;
+	u64 *data_runs = NULL;
 	struct virtio_shared_pages_info *sh_pages_info = NULL;
-	void *pageaddr;
 
 	int nents_last = (nents - 1) % REFS_PER_PAGE + 1;
 	int n_lvl2_refs = (nents / REFS_PER_PAGE) + ((nents_last > 0) ? 1 : 0) -
 			  (nents_last == REFS_PER_PAGE);
-	int i, j, k;
+	int n_data_runs;
+	int i;
 
 	sh_pages_info = kmalloc(sizeof(*sh_pages_info), GFP_KERNEL);
 	if (sh_pages_info == NULL)
@@ -101,6 +157,10 @@ static struct page **virtio_be_map_shared_pages(unsigned long lvl3_gref,
 	if (data_pages == NULL)
 		goto map_failed;
 
+	data_runs = kcalloc(nents, sizeof(u64), GFP_KERNEL);
+	if (data_runs == NULL)
+		goto map_failed;
+
 	lvl2_table = kcalloc(n_lvl2_refs, sizeof(u64 *), GFP_KERNEL);
 	if (lvl2_table == NULL)
 		goto map_failed;
@@ -117,30 +177,10 @@ static struct page **virtio_be_map_shared_pages(unsigned long lvl3_gref,
 			goto map_failed;
 	}
 
-	k = 0;
-	for (i = 0; i < n_lvl2_refs - 1; i++) {
-		for (j = 0; j < REFS_PER_PAGE; j++) {
-			pageaddr = map_guest_phys(vmid,
-						  lvl2_table[i][j],
-						  PAGE_SIZE);
-			if (pageaddr == NULL)
-				goto map_failed;
-
-			data_pages[k] = virt_to_page(pageaddr);
-			k++;
-		}
-	}
-
-	for (j = 0; j < nents_last; j++) {
-		pageaddr = map_guest_phys(vmid,
-					  lvl2_table[i][j],
-					  PAGE_SIZE);
-		if (pageaddr == NULL)
-			goto map_failed;
-
-		data_pages[k] = virt_to_page(pageaddr);
-		k++;
-	}
+	n_data_runs = virtio_be_map_data_pages(vmid, lvl2_table, nents,
+					       data_pages, data_runs);
+	if (n_data_runs < 0)
+		goto map_failed;
 
 	sh_pages_info->lvl2_table = lvl2_table;
 	sh_pages_info->lvl3_table = lvl3_table;
@@ -148,6 +188,8 @@ static struct page **virtio_be_map_shared_pages(unsigned long lvl3_gref,
 	sh_pages_info->n_lvl2_refs = n_lvl2_refs;
 	sh_pages_info->nents_last = nents_last;
 	sh_pages_info->data_pages = data_pages;
+	sh_pages_info->data_runs = data_runs;
+	sh_pages_info->n_data_runs = n_data_runs;
 	sh_pages_info->vmid = vmid;
 
 	return data_pages;
@@ -157,6 +199,7 @@ static struct page **virtio_be_map_shared_pages(unsigned long lvl3_gref,
 		"Cannot map guest memory\n");
 
 	kfree(lvl2_table);
+	kfree(data_runs);
 	kfree(data_pages);
 	kfree(sh_pages_info);
 
@@ -172,7 +215,7 @@ static int virtio_be_unmap_shared_pages(void **refs_info, int nents)
 {
 	struct virtio_shared_pages_info *sh_pages_info;
 	int vmid;
-	int i, j;
+	int i;
 
 	sh_pages_info = (struct virtio_shared_pages_info *)(*refs_info);
 
@@ -185,14 +228,8 @@ static int virtio_be_unmap_shared_pages(void **refs_info, int nents)
 	}
 	vmid = sh_pages_info->vmid;
 
-	for (i = 0; i < sh_pages_info->n_lvl2_refs - 1; i++) {
-		for (j = 0; j < REFS_PER_PAGE; j++)
-			unmap_guest_phys(vmid,
-					 sh_pages_info->lvl2_table[i][j]);
-	}
-
-	for (j = 0; j < sh_pages_info->nents_last; j++)
-		unmap_guest_phys(vmid, sh_pages_info->lvl2_table[i][j]);
+	for (i = 0; i < sh_pages_info->n_data_runs; i++)
+		unmap_guest_phys(vmid, sh_pages_info->data_runs[i]);
 
 	for (i = 0; i < sh_pages_info->n_lvl2_refs; i++)
 		unmap_guest_phys(vmid, sh_pages_info->lvl3_table[i]);
@@ -200,6 +237,7 @@ static int virtio_be_unmap_shared_pages(void **refs_info, int nents)
 	unmap_guest_phys(vmid, sh_pages_info->lvl3_gref);
 
 	kfree(sh_pages_info->lvl2_table);
+	kfree(sh_pages_info->data_runs);
 	kfree(sh_pages_info->data_pages);
 	sh_pages_info->data_pages = NULL;
 	kfree(sh_pages_info);
@@ -55,13 +55,61 @@ EXPORT_SYMBOL(reservation_seqcount_class);
 const char reservation_seqcount_string[] = "reservation_seqcount";
 EXPORT_SYMBOL(reservation_seqcount_string);
 
+/*
+ * Drop the signaled fences from a full shared list in place, so that it
+ * can take another fence without being reallocated. Readers see the
+ * list change through obj->seq and RCU keeps the dropped fences alive
+ * for those still looking at them.
+ */
+static void
+reservation_object_prune_shared(struct reservation_object *obj,
+				struct reservation_object_list *fobj)
+{
+	struct dma_fence *fence, *signaled;
+	u32 i, j, count = fobj->shared_count;
+
+	for (i = 0; i < count; ++i) {
+		fence = rcu_dereference_protected(fobj->shared[i],
+						reservation_object_held(obj));
+		if (dma_fence_is_signaled(fence))
+			break;
+	}
+	if (i == count)
+		return;
+
+	preempt_disable();
+	write_seqcount_begin(&obj->seq);
+
+	/* Move the live fences to the front, the signaled ones behind */
+	for (j = i++; i < count; ++i) {
+		fence = rcu_dereference_protected(fobj->shared[i],
+						reservation_object_held(obj));
+		if (dma_fence_is_signaled(fence))
+			continue;
+
+		signaled = rcu_dereference_protected(fobj->shared[j],
+						reservation_object_held(obj));
+		RCU_INIT_POINTER(fobj->shared[i], signaled);
+		RCU_INIT_POINTER(fobj->shared[j++], fence);
+	}
+	fobj->shared_count = j;
+
+	write_seqcount_end(&obj->seq);
+	preempt_enable();
+
+	for (; j < count; ++j)
+		dma_fence_put(rcu_dereference_protected(fobj->shared[j],
+						reservation_object_held(obj)));
+}
+
 /**
  * reservation_object_reserve_shared - Reserve space to add a shared
  * fence to a reservation_object.
  * @obj: reservation object
  *
  * Should be called before reservation_object_add_shared_fence().  Must
- * be called with obj->lock held.
+ * be called with obj->lock held. Signaled fences are pruned from a full
+ * list before it is grown.
  *
  * RETURNS
  * Zero for success, or -errno
@@ -74,6 +122,9 @@ int reservation_object_reserve_shared(struct reservation_object *obj)
 	old = reservation_object_get_list(obj);
 
 	if (old && old->shared_max) {
+		if (old->shared_count == old->shared_max)
+			reservation_object_prune_shared(obj, old);
+
 		if (old->shared_count < old->shared_max) {
 			/* perform an in-place update */
 			kfree(obj->staged);
@@ -15,6 +15,10 @@
  */
 
 #include <linux/debugfs.h>
+#include <linux/mutex.h>
+#include <linux/percpu.h>
+#include <linux/sort.h>
+#include <linux/vmalloc.h>
 #include "sync_debug.h"
 
 static struct dentry *dbgfs;
@@ -190,6 +194,239 @@ static const struct file_operations sync_info_debugfs_fops = {
 	.release        = single_release,
 };
 
+#ifdef CONFIG_SYNC_PROFILE
+#define SYNC_PROFILE_RING_SIZE	512
+
+struct sync_profile_entry {
+	const struct dma_fence_ops *ops;
+	u64 context;
+	u64 ts;
+	unsigned int seqno;
+	unsigned int event;
+};
+
+struct sync_profile_ring {
+	unsigned int head;
+	struct sync_profile_entry entries[SYNC_PROFILE_RING_SIZE];
+};
+
+DEFINE_STATIC_KEY_FALSE(sync_profile_key);
+static struct sync_profile_ring __percpu *sync_profile_rings;
+static DEFINE_MUTEX(sync_profile_lock);
+
+void __sync_profile_fence(struct dma_fence *fence,
+			  enum sync_profile_event event)
+{
+	struct sync_profile_ring *ring;
+	struct sync_profile_entry *e;
+	unsigned long flags;
+
+	local_irq_save(flags);
+	ring = this_cpu_ptr(sync_profile_rings);
+	e = &ring->entries[ring->head++ & (SYNC_PROFILE_RING_SIZE - 1)];
+	e->ops = fence->ops;
+	e->context = fence->context;
+	e->seqno = fence->seqno;
+	e->event = event;
+	e->ts = ktime_get_ns();
+	local_irq_restore(flags);
+}
+
+static int sync_profile_cmp(const void *a, const void *b)
+{
+	const struct sync_profile_entry *ea = a, *eb = b;
+
+	if (ea->context != eb->context)
+		return ea->context < eb->context ? -1 : 1;
+	if (ea->seqno != eb->seqno)
+		return ea->seqno < eb->seqno ? -1 : 1;
+	if (ea->ts != eb->ts)
+		return ea->ts < eb->ts ? -1 : 1;
+	return 0;
+}
+
+struct sync_profile_stats {
+	const struct dma_fence_ops *ops;
+	u64 context;
+	unsigned int fences;
+	unsigned int pending;
+	unsigned int init_cnt, enable_cnt;
+	u64 init_sum, init_max;
+	u64 enable_sum, enable_max;
+};
+
+static void sync_profile_print(struct seq_file *s,
+			       struct sync_profile_stats *st)
+{
+	seq_printf(s, "%-24ps %6llu %8u %8u %10llu %10llu %10llu %10llu\n",
+		   st->ops, st->context, st->fences, st->pending,
+		   st->init_cnt ? div_u64(st->init_sum, st->init_cnt) : 0,
+		   st->init_max,
+		   st->enable_cnt ? div_u64(st->enable_sum, st->enable_cnt) : 0,
+		   st->enable_max);
+}
+
+/*
+ * Walk the entries of one fence, already sorted by timestamp, and fold
+ * its init->signal and enable->signal latencies into @st.
+ */
+static void sync_profile_account(struct sync_profile_stats *st,
+				 struct sync_profile_entry *e, int n)
+{
+	u64 init = 0, enable = 0, signal = 0, delta;
+	int i;
+
+	for (i = 0; i < n; i++) {
+		switch (e[i].event) {
+		case SYNC_PROFILE_INIT:
+			init = e[i].ts;
+			break;
+		case SYNC_PROFILE_ENABLE:
+			enable = e[i].ts;
+			break;
+		case SYNC_PROFILE_SIGNAL:
+			signal = e[i].ts;
+			break;
+		}
+	}
+
+	st->fences++;
+	if (!signal) {
+		st->pending++;
+		return;
+	}
+
+	if (init && init <= signal) {
+		delta = div_u64(signal - init, NSEC_PER_USEC);
+		st->init_sum += delta;
+		st->init_max = max(st->init_max, delta);
+		st->init_cnt++;
+	}
+	if (enable && enable <= signal) {
+		delta = div_u64(signal - enable, NSEC_PER_USEC);
+		st->enable_sum += delta;
+		st->enable_max = max(st->enable_max, delta);
+		st->enable_cnt++;
+	}
+}
+
+static int sync_profile_show(struct seq_file *s, void *unused)
+{
+	struct sync_profile_entry *entries;
+	struct sync_profile_stats st;
+	int cpu, i, j, n = 0;
+
+	mutex_lock(&sync_profile_lock);
+	if (!sync_profile_rings) {
+		mutex_unlock(&sync_profile_lock);
+		seq_puts(s, "disabled\n");
+		return 0;
+	}
+
+	entries = vmalloc(array_size(num_possible_cpus(),
+				     sizeof(struct sync_profile_ring)));
+	if (!entries) {
+		mutex_unlock(&sync_profile_lock);
+		return -ENOMEM;
+	}
+
+	/*
+	 * The rings are copied while they may still be written to, so a
+	 * handful of the newest entries may be torn. That is fine for a
+	 * statistical profile and avoids stalling the signaling paths.
+	 */
+	for_each_possible_cpu(cpu) {
+		struct sync_profile_ring *ring =
+			per_cpu_ptr(sync_profile_rings, cpu);
+
+		for (i = 0; i < SYNC_PROFILE_RING_SIZE; i++) {
+			entries[n] = ring->entries[i];
+			if (entries[n].ops)
+				n++;
+		}
+	}
+	mutex_unlock(&sync_profile_lock);
+
+	sort(entries, n, sizeof(*entries), sync_profile_cmp, NULL);
+
+	seq_printf(s, "%-24s %6s %8s %8s %10s %10s %10s %10s\n",
+		   "ops", "ctx", "fences", "pending", "init_avg", "init_max",
+		   "enable_avg", "enable_max");
+
+	memset(&st, 0, sizeof(st));
+	for (i = 0; i < n; i = j) {
+		if (st.fences && entries[i].context != st.context) {
+			sync_profile_print(s, &st);
+			memset(&st, 0, sizeof(st));
+		}
+		st.ops = entries[i].ops;
+		st.context = entries[i].context;
+
+		for (j = i + 1; j < n; j++)
+			if (entries[j].context != entries[i].context ||
+			    entries[j].seqno != entries[i].seqno)
+				break;
+
+		sync_profile_account(&st, &entries[i], j - i);
+	}
+	if (st.fences)
+		sync_profile_print(s, &st);
+
+	vfree(entries);
+	return 0;
+}
+
+static int sync_profile_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, sync_profile_show, inode->i_private);
+}
+
+static ssize_t sync_profile_write(struct file *file, const char __user *ubuf,
+				  size_t len, loff_t *offp)
+{
+	bool enable;
+	int cpu, ret;
+
+	ret = kstrtobool_from_user(ubuf, len, &enable);
+	if (ret)
+		return ret;
+
+	mutex_lock(&sync_profile_lock);
+	if (enable) {
+		if (!sync_profile_rings)
+			sync_profile_rings =
+				alloc_percpu(struct sync_profile_ring);
+		if (!sync_profile_rings) {
+			mutex_unlock(&sync_profile_lock);
+			return -ENOMEM;
+		}
+
+		/* start from empty rings, nobody writes while the key is off */
+		if (!static_key_enabled(&sync_profile_key)) {
+			for_each_possible_cpu(cpu)
+				memset(per_cpu_ptr(sync_profile_rings, cpu), 0,
+				       sizeof(struct sync_profile_ring));
+			static_branch_enable(&sync_profile_key);
+		}
+	} else if (static_key_enabled(&sync_profile_key)) {
+		static_branch_disable(&sync_profile_key);
+		/* writers run with irqs off, wait for the last of them */
+		synchronize_sched();
+	}
+	mutex_unlock(&sync_profile_lock);
+
+	return len;
+}
+
+static const struct file_operations sync_profile_debugfs_fops = {
+	.open           = sync_profile_open,
+	.write          = sync_profile_write,
+	.read           = seq_read,
+	.llseek         = seq_lseek,
+	.release        = single_release,
+};
+#endif
+
 static __init int sync_debugfs_init(void)
 {
 	dbgfs = debugfs_create_dir("sync", NULL);
@@ -203,6 +440,10 @@ static __init int sync_debugfs_init(void)
 				   &sync_info_debugfs_fops);
 	debugfs_create_file_unsafe("sw_sync", 0644, dbgfs, NULL,
 				   &sw_sync_debugfs_fops);
+#ifdef CONFIG_SYNC_PROFILE
+	debugfs_create_file_unsafe("profile", 0644, dbgfs, NULL,
+				   &sync_profile_debugfs_fops);
+#endif
 
 	return 0;
 }
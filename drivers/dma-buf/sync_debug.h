@@ -17,6 +17,7 @@
 #include <linux/rbtree.h>
 #include <linux/spinlock.h>
 #include <linux/dma-fence.h>
+#include <linux/jump_label.h>
 
 #include <linux/sync_file.h>
 #include <uapi/linux/sync_file.h>
@@ -70,4 +71,29 @@ void sync_file_debug_add(struct sync_file *fence);
 void sync_file_debug_remove(struct sync_file *fence);
 void sync_dump(void);
 
+/* Points of a fence's life recorded by the fence profiler */
+enum sync_profile_event {
+	SYNC_PROFILE_INIT,
+	SYNC_PROFILE_ENABLE,
+	SYNC_PROFILE_SIGNAL,
+};
+
+#ifdef CONFIG_SYNC_PROFILE
+DECLARE_STATIC_KEY_FALSE(sync_profile_key);
+void __sync_profile_fence(struct dma_fence *fence,
+			  enum sync_profile_event event);
+
+static inline void sync_profile_fence(struct dma_fence *fence,
+				      enum sync_profile_event event)
+{
+	if (static_branch_unlikely(&sync_profile_key))
+		__sync_profile_fence(fence, event);
+}
+#else
+static inline void sync_profile_fence(struct dma_fence *fence,
+				      enum sync_profile_event event)
+{
+}
+#endif
+
 #endif /* _LINUX_SYNC_H */
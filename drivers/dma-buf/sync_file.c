@@ -21,6 +21,7 @@
 #include <linux/poll.h>
 #include <linux/sched.h>
 #include <linux/slab.h>
+#include <linux/sort.h>
 #include <linux/uaccess.h>
 #include <linux/anon_inodes.h>
 #include <linux/sync_file.h>
@@ -195,15 +196,60 @@ static struct dma_fence **get_fences(struct sync_file *sync_file,
 	return &sync_file->fence;
 }
 
-static void add_fence(struct dma_fence **fences,
-		      int *i, struct dma_fence *fence)
+/*
+ * Number of fences @fence stands for once nested fence arrays are
+ * flattened, or -EOVERFLOW if that doesn't fit in an int.
+ */
+static int sync_file_count_fences(struct dma_fence *fence)
 {
-	fences[*i] = fence;
+	struct dma_fence_array *array;
+	int i, n, num = 0;
+
+	if (!dma_fence_is_array(fence))
+		return 1;
 
-	if (!dma_fence_is_signaled(fence)) {
-		dma_fence_get(fence);
-		(*i)++;
+	array = to_dma_fence_array(fence);
+	for (i = 0; i < array->num_fences; i++) {
+		n = sync_file_count_fences(array->fences[i]);
+		if (n < 0 || num > INT_MAX - n)
+			return -EOVERFLOW;
+		num += n;
 	}
+
+	return num;
+}
+
+/* Collect the leaf fences of @fence, without taking references */
+static void sync_file_flatten_fences(struct dma_fence *fence,
+				     struct dma_fence **fences, int *num)
+{
+	struct dma_fence_array *array;
+	int i;
+
+	if (!dma_fence_is_array(fence)) {
+		fences[(*num)++] = fence;
+		return;
+	}
+
+	array = to_dma_fence_array(fence);
+	for (i = 0; i < array->num_fences; i++)
+		sync_file_flatten_fences(array->fences[i], fences, num);
+}
+
+/* Order by context, the latest fence of a context first */
+static int sync_file_fence_cmp(const void *a, const void *b)
+{
+	const struct dma_fence *pt_a = *(struct dma_fence * const *)a;
+	const struct dma_fence *pt_b = *(struct dma_fence * const *)b;
+
+	if (pt_a->context < pt_b->context)
+		return -1;
+	if (pt_a->context > pt_b->context)
+		return 1;
+	if (pt_a->seqno == pt_b->seqno)
+		return 0;
+
+	return __dma_fence_is_later(pt_a->seqno, pt_b->seqno) ? -1 : 1;
 }
 
 /**
@@ -215,22 +261,27 @@ static void add_fence(struct dma_fence **fences,
  * Creates a new sync_file which contains copies of all the fences in both
  * @a and @b.  @a and @b remain valid, independent sync_file. Returns the
  * new merged sync_file or NULL in case of error.
+ *
+ * Fence arrays nested in @a or @b are flattened, only the latest fence of
+ * each context is kept and fences which already signaled are dropped, so
+ * repeatedly merging the same timelines doesn't grow the result.
  */
 static struct sync_file *sync_file_merge(const char *name, struct sync_file *a,
 					 struct sync_file *b)
 {
 	struct sync_file *sync_file;
-	struct dma_fence **fences, **nfences, **a_fences, **b_fences;
-	int i, i_a, i_b, num_fences, a_num_fences, b_num_fences;
+	struct dma_fence **fences, **nfences;
+	int i, j, num_fences, a_num_fences, b_num_fences;
 
 	sync_file = sync_file_alloc();
 	if (!sync_file)
 		return NULL;
 
-	a_fences = get_fences(a, &a_num_fences);
-	b_fences = get_fences(b, &b_num_fences);
-	if (a_num_fences > INT_MAX - b_num_fences)
-		return NULL;
+	a_num_fences = sync_file_count_fences(a->fence);
+	b_num_fences = sync_file_count_fences(b->fence);
+	if (a_num_fences < 0 || b_num_fences < 0 ||
+	    a_num_fences > INT_MAX - b_num_fences)
+		goto err;
 
 	num_fences = a_num_fences + b_num_fences;
 
@@ -238,55 +289,43 @@ static struct sync_file *sync_file_merge(const char *name, struct sync_file *a,
 	if (!fences)
 		goto err;
 
+	num_fences = 0;
+	sync_file_flatten_fences(a->fence, fences, &num_fences);
+	sync_file_flatten_fences(b->fence, fences, &num_fences);
+
+	sort(fences, num_fences, sizeof(*fences), sync_file_fence_cmp, NULL);
+
 	/*
-	 * Assume sync_file a and b are both ordered and have no
-	 * duplicates with the same context.
-	 *
-	 * If a sync_file can only be created with sync_file_merge
-	 * and sync_file_create, this is a reasonable assumption.
+	 * Keep the first, i.e. latest, fence of each context unless it
+	 * already signaled, in which case so did the rest of the context.
 	 */
-	for (i = i_a = i_b = 0; i_a < a_num_fences && i_b < b_num_fences; ) {
-		struct dma_fence *pt_a = a_fences[i_a];
-		struct dma_fence *pt_b = b_fences[i_b];
-
-		if (pt_a->context < pt_b->context) {
-			add_fence(fences, &i, pt_a);
-
-			i_a++;
-		} else if (pt_a->context > pt_b->context) {
-			add_fence(fences, &i, pt_b);
-
-			i_b++;
-		} else {
-			if (pt_a->seqno - pt_b->seqno <= INT_MAX)
-				add_fence(fences, &i, pt_a);
-			else
-				add_fence(fences, &i, pt_b);
-
-			i_a++;
-			i_b++;
-		}
+	for (i = j = 0; j < num_fences; j++) {
+		if (j && fences[j - 1]->context == fences[j]->context)
+			continue;
+		if (dma_fence_is_signaled(fences[j]))
+			continue;
+		fences[i++] = dma_fence_get(fences[j]);
 	}
 
-	for (; i_a < a_num_fences; i_a++)
-		add_fence(fences, &i, a_fences[i_a]);
-
-	for (; i_b < b_num_fences; i_b++)
-		add_fence(fences, &i, b_fences[i_b]);
-
 	if (i == 0)
-		fences[i++] = dma_fence_get(a_fences[0]);
+		fences[i++] = dma_fence_get(a->fence);
 
 	if (num_fences > i) {
 		nfences = krealloc(fences, i * sizeof(*fences),
 				  GFP_KERNEL);
-		if (!nfences)
+		if (!nfences) {
+			while (i--)
+				dma_fence_put(fences[i]);
+			kfree(fences);
 			goto err;
+		}
 
 		fences = nfences;
 	}
 
 	if (sync_file_set_fence(sync_file, fences, i) < 0) {
+		while (i--)
+			dma_fence_put(fences[i]);
 		kfree(fences);
 		goto err;
 	}
@@ -223,6 +223,13 @@ static void handle_request_error(struct intel_vgpu *vgpu)
        mutex_unlock(&vgpu->gvt->lock);
 }
 
+/*
+ * A single thread handles the requests of all vCPUs of a VM. Emulation
+ * of MMIO and config space accesses is serialized on vgpu->vgpu_lock by
+ * the GVT core anyway, and requests of an ioreq client stay pending
+ * until they are completed, so further threads attached to the same
+ * client would only spin on requests already being handled.
+ */
 static int acrngt_emulation_thread(void *priv)
 {
 	struct intel_vgpu *vgpu = (struct intel_vgpu *)priv;
@@ -410,12 +417,48 @@ static ssize_t acrngt_sysfs_vgpu_id(struct kobject *kobj,
 	return 0;
 }
 
+static struct intel_vgpu *vgpu_from_kobj(struct kobject *kobj)
+{
+	struct acrngt_hvm_dev *info =
+		container_of(kobj, struct acrngt_hvm_dev, kobj);
+
+	return info->vgpu;
+}
+
+static ssize_t acrngt_sysfs_latency_target_show(struct kobject *kobj,
+		struct kobj_attribute *attr, char *buf)
+{
+	struct intel_vgpu *vgpu = vgpu_from_kobj(kobj);
+
+	return sprintf(buf, "%u\n", vgpu->sched_ctl.latency_target);
+}
+
+static ssize_t acrngt_sysfs_latency_target_store(struct kobject *kobj,
+		struct kobj_attribute *attr, const char *buf, size_t count)
+{
+	struct intel_vgpu *vgpu = vgpu_from_kobj(kobj);
+	unsigned int target;
+	int ret;
+
+	ret = kstrtouint(buf, 0, &target);
+	if (ret)
+		return ret;
+
+	intel_gvt_ops->vgpu_set_latency_target(vgpu, target);
+
+	return count;
+}
+
 static struct kobj_attribute acrngt_vm_attr =
 __ATTR(vgpu_id, 0440, acrngt_sysfs_vgpu_id, NULL);
 
+static struct kobj_attribute acrngt_latency_target_attr =
+__ATTR(latency_target_us, 0640, acrngt_sysfs_latency_target_show,
+	acrngt_sysfs_latency_target_store);
 
 static struct attribute *acrngt_vm_attrs[] = {
 	&acrngt_vm_attr.attr,
+	&acrngt_latency_target_attr.attr,
 	NULL,   /* need to NULL terminate the list of attributes */
 };
 
@@ -563,15 +606,37 @@ static ssize_t show_plane_owner(struct kobject *kobj,
 		acrngt_priv.gvt->pipe_info[PIPE_C].plane_owner[PLANE_SPRITE1]);
 }
 
+static ssize_t acrngt_sysfs_sched_policy_show(struct kobject *kobj,
+		struct kobj_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%s\n",
+		       intel_gvt_ops->get_sched_policy(acrngt_priv.gvt));
+}
+
+static ssize_t acrngt_sysfs_sched_policy_store(struct kobject *kobj,
+		struct kobj_attribute *attr, const char *buf, size_t count)
+{
+	int ret;
+
+	ret = intel_gvt_ops->set_sched_policy(acrngt_priv.gvt, buf);
+
+	return ret < 0 ? ret : count;
+}
+
 static struct kobj_attribute acrngt_instance_attr =
 __ATTR(create_gvt_instance, 0220, NULL, acrngt_sysfs_instance_manage);
 
 static struct kobj_attribute plane_owner_attr =
 __ATTR(plane_owner_show, 0440, show_plane_owner, NULL);
 
+static struct kobj_attribute sched_policy_attr =
+__ATTR(sched_policy, 0640, acrngt_sysfs_sched_policy_show,
+	acrngt_sysfs_sched_policy_store);
+
 static struct attribute *acrngt_ctrl_attrs[] = {
 	&acrngt_instance_attr.attr,
 	&plane_owner_attr.attr,
+	&sched_policy_attr.attr,
 	NULL,   /* need to NULL terminate the list of attributes */
 };
 
@@ -365,8 +365,6 @@ struct parser_exec_state;
 
 typedef int (*parser_cmd_handler)(struct parser_exec_state *s);
 
-#define GVT_CMD_HASH_BITS   7
-
 /* which DWords need address fix */
 #define ADDR_FIX_1(x1)			(1 << (x1))
 #define ADDR_FIX_2(x1, x2)		(ADDR_FIX_1(x1) | ADDR_FIX_1(x2))
@@ -423,11 +421,6 @@ struct cmd_info {
 	parser_cmd_handler handler;
 };
 
-struct cmd_entry {
-	struct hlist_node hlist;
-	struct cmd_info *info;
-};
-
 enum {
 	RING_BUFFER_INSTRUCTION,
 	BATCH_BUFFER_INSTRUCTION,
@@ -474,6 +467,15 @@ struct parser_exec_state {
 	int saved_buf_addr_type;
 	bool is_ctx_wa;
 
+	/* first level batch buffer to be added to bb cache once scanned */
+	void *cache_va;
+	unsigned long cache_gma;
+	unsigned long cache_size;
+	bool cache_ppgtt;
+
+	/* scanned commands patched themselves or changed vGPU state */
+	bool side_effect;
+
 	struct cmd_info *info;
 
 	struct intel_vgpu_workload *workload;
@@ -625,29 +627,30 @@ static inline u32 get_opcode(u32 cmd, int ring_id)
 	return cmd >> (32 - d_info->op_len);
 }
 
-static inline struct cmd_info *find_cmd_entry(struct intel_gvt *gvt,
-		unsigned int opcode, int ring_id)
+/*
+ * Commands are looked up by direct index, in a table per ring and command
+ * type covering all the opcodes of that type. Each slot holds the index
+ * of the command in cmd_info plus one, or zero for an unknown command.
+ */
+static inline unsigned int cmd_table_size(struct decode_info *d_info)
 {
-	struct cmd_entry *e;
-
-	hash_for_each_possible(gvt->cmd_table, e, hlist, opcode) {
-		if ((opcode == e->info->opcode) &&
-				(e->info->rings & (1 << ring_id)))
-			return e->info;
-	}
-	return NULL;
+	return 1 << (d_info->op_len - 3);
 }
 
 static inline struct cmd_info *get_cmd_info(struct intel_gvt *gvt,
 		u32 cmd, int ring_id)
 {
-	u32 opcode;
+	struct decode_info *d_info;
+	unsigned int type = CMD_TYPE(cmd);
+	u16 index;
 
-	opcode = get_opcode(cmd, ring_id);
-	if (opcode == INVALID_OP)
+	d_info = ring_decode_info[ring_id][type];
+	if (d_info == NULL)
 		return NULL;
 
-	return find_cmd_entry(gvt, opcode, ring_id);
+	index = gvt->cmd_table[ring_id][type][(cmd >> (32 - d_info->op_len)) &
+					      (cmd_table_size(d_info) - 1)];
+	return index ? &cmd_info[index - 1] : NULL;
 }
 
 static inline u32 sub_op_val(u32 cmd, u32 hi, u32 low)
@@ -793,6 +796,7 @@ static inline int cmd_length(struct parser_exec_state *s)
 /* do not remove this, some platform may need clflush here */
 #define patch_value(s, addr, val) do { \
 	*addr = val; \
+	s->side_effect = true; \
 } while (0)
 
 static bool is_shadowed_mmio(unsigned int offset)
@@ -855,6 +859,7 @@ static int mocs_cmd_reg_handler(struct parser_exec_state *s,
 	if (!is_mocs_mmio(offset))
 		return -EINVAL;
 	vgpu_vreg(s->vgpu, offset) = cmd_val(s, index + 1);
+	s->side_effect = true;
 	return 0;
 }
 
@@ -904,6 +909,7 @@ static int cmd_reg_handler(struct parser_exec_state *s,
 	if (IS_KABYLAKE(s->vgpu->gvt->dev_priv) &&
 			intel_gvt_mmio_is_in_ctx(gvt, offset) &&
 			!strncmp(cmd, "lri", 3)) {
+		s->side_effect = true;
 		intel_gvt_hypervisor_read_gpa(s->vgpu,
 			s->workload->ring_context_gpa + 12, &ctx_sr_ctl, 4);
 		/* check inhibit context */
@@ -1110,9 +1116,11 @@ static int cmd_handler_pipe_control(struct parser_exec_state *s)
 	if (ret)
 		return ret;
 
-	if (cmd_val(s, 1) & PIPE_CONTROL_NOTIFY)
+	if (cmd_val(s, 1) & PIPE_CONTROL_NOTIFY) {
 		set_bit(cmd_interrupt_events[s->ring_id].pipe_control_notify,
 				s->workload->pending_events);
+		s->side_effect = true;
+	}
 	return 0;
 }
 
@@ -1129,6 +1137,8 @@ static int cmd_advance_default(struct parser_exec_state *s)
 	return ip_gma_advance(s, cmd_length(s));
 }
 
+static void bb_cache_add(struct parser_exec_state *s);
+
 static int cmd_handler_mi_batch_buffer_end(struct parser_exec_state *s)
 {
 	int ret;
@@ -1143,6 +1153,10 @@ static int cmd_handler_mi_batch_buffer_end(struct parser_exec_state *s)
 		if (s->ret_ip_gma_ring >= s->ring_start + s->ring_size)
 			s->ret_ip_gma_ring -= s->ring_size;
 		ret = ip_gma_set(s, s->ret_ip_gma_ring);
+
+		if (s->cache_va && !s->side_effect)
+			bb_cache_add(s);
+		s->cache_va = NULL;
 	}
 	return ret;
 }
@@ -1584,9 +1598,11 @@ static int cmd_handler_mi_flush_dw(struct parser_exec_state *s)
 		ret = cmd_address_audit(s, gma, sizeof(u64), index_mode);
 	}
 	/* Check notify bit */
-	if ((cmd_val(s, 0) & (1 << 8)))
+	if ((cmd_val(s, 0) & (1 << 8))) {
 		set_bit(cmd_interrupt_events[s->ring_id].mi_flush_dw,
 				s->workload->pending_events);
+		s->side_effect = true;
+	}
 	return ret;
 }
 
@@ -1695,25 +1711,98 @@ static int find_bb_size(struct parser_exec_state *s, unsigned long *bb_size)
 	return 0;
 }
 
-static int perform_bb_shadow(struct parser_exec_state *s)
+/*
+ * Guests resubmit the same static batch buffers, e.g. for clears, again and
+ * again. A first level batch buffer which scanned without being patched or
+ * changing vGPU state is remembered with its content, so that an identical
+ * copy submitted later is shadowed without being scanned again. Content is
+ * compared in full, as a guest could forge a collision of a cheap hash to
+ * pass commands the scan would reject.
+ */
+#define GVT_BB_CACHE_ENTRIES 32
+#define GVT_BB_CACHE_MAX_SIZE (4 * PAGE_SIZE)
+
+struct intel_vgpu_bb_cache {
+	struct list_head list;
+	int ring_id;
+	bool ppgtt;
+	unsigned long gma;
+	unsigned long size;
+	void *data;
+};
+
+static struct intel_vgpu_bb_cache *bb_cache_find(struct parser_exec_state *s,
+		unsigned long gma, bool ppgtt)
+{
+	struct intel_vgpu_bb_cache *c;
+
+	list_for_each_entry(c, &s->vgpu->submission.bb_cache, list) {
+		if (c->gma == gma && c->ring_id == s->ring_id &&
+		    c->ppgtt == ppgtt)
+			return c;
+	}
+	return NULL;
+}
+
+static void bb_cache_free(struct intel_vgpu *vgpu,
+		struct intel_vgpu_bb_cache *c)
+{
+	list_del(&c->list);
+	vgpu->submission.nr_bb_cache--;
+	kfree(c->data);
+	kfree(c);
+}
+
+static void bb_cache_add(struct parser_exec_state *s)
+{
+	struct intel_vgpu_submission *submission = &s->vgpu->submission;
+	struct intel_vgpu_bb_cache *c;
+
+	c = bb_cache_find(s, s->cache_gma, s->cache_ppgtt);
+	if (c)
+		bb_cache_free(s->vgpu, c);
+
+	c = kmalloc(sizeof(*c), GFP_KERNEL);
+	if (!c)
+		return;
+
+	c->data = kmemdup(s->cache_va, s->cache_size, GFP_KERNEL);
+	if (!c->data) {
+		kfree(c);
+		return;
+	}
+
+	c->ring_id = s->ring_id;
+	c->ppgtt = s->cache_ppgtt;
+	c->gma = s->cache_gma;
+	c->size = s->cache_size;
+
+	list_add(&c->list, &submission->bb_cache);
+	if (++submission->nr_bb_cache > GVT_BB_CACHE_ENTRIES)
+		bb_cache_free(s->vgpu, list_last_entry(&submission->bb_cache,
+					struct intel_vgpu_bb_cache, list));
+}
+
+/**
+ * intel_gvt_clean_bb_cache - drop all cached batch buffers of a vGPU
+ * @vgpu: a vGPU
+ */
+void intel_gvt_clean_bb_cache(struct intel_vgpu *vgpu)
+{
+	struct intel_vgpu_bb_cache *c, *n;
+
+	list_for_each_entry_safe(c, n, &vgpu->submission.bb_cache, list)
+		bb_cache_free(vgpu, c);
+}
+
+static int shadow_bb(struct parser_exec_state *s, unsigned long gma,
+		unsigned long gma_start_offset, unsigned long bb_size,
+		struct intel_vgpu_shadow_bb **shadow)
 {
-	struct intel_vgpu *vgpu = s->vgpu;
 	struct intel_vgpu_shadow_bb *bb;
-	unsigned long gma = 0;
-	unsigned long bb_size;
 	int ret = 0;
 	struct intel_vgpu_mm *mm = (s->buf_addr_type == GTT_BUFFER) ?
 		s->vgpu->gtt.ggtt_mm : s->workload->shadow_mm;
-	unsigned long gma_start_offset = 0;
-
-	/* get the start gm address of the batch buffer */
-	gma = get_gma_bb_from_cmd(s, 1);
-	if (gma == INTEL_GVT_INVALID_ADDR)
-		return -EFAULT;
-
-	ret = find_bb_size(s, &bb_size);
-	if (ret)
-		return ret;
 
 	bb = kzalloc(sizeof(*bb), GFP_KERNEL);
 	if (!bb)
@@ -1721,20 +1810,6 @@ static int perform_bb_shadow(struct parser_exec_state *s)
 
 	bb->ppgtt = (s->buf_addr_type == GTT_BUFFER) ? false : true;
 
-	/* the gma_start_offset stores the batch buffer's start gma's
-	 * offset relative to page boundary. so for non-privileged batch
-	 * buffer, the shadowed gem object holds exactly the same page
-	 * layout as original gem object. This is for the convience of
-	 * replacing the whole non-privilged batch buffer page to this
-	 * shadowed one in PPGTT at the same gma address. (this replacing
-	 * action is not implemented yet now, but may be necessary in
-	 * future).
-	 * for prileged batch buffer, we just change start gma address to
-	 * that of shadowed page.
-	 */
-	if (bb->ppgtt)
-		gma_start_offset = gma & ~I915_GTT_PAGE_MASK;
-
 	bb->obj = i915_gem_object_create(s->vgpu->gvt->dev_priv,
 			 roundup(bb_size + gma_start_offset, PAGE_SIZE));
 	if (IS_ERR(bb->obj)) {
@@ -1766,6 +1841,89 @@ static int perform_bb_shadow(struct parser_exec_state *s)
 		goto err_unmap;
 	}
 
+	*shadow = bb;
+	return 0;
+err_unmap:
+	i915_gem_object_unpin_map(bb->obj);
+err_finish_shmem_access:
+	i915_gem_obj_finish_shmem_access(bb->obj);
+err_free_obj:
+	i915_gem_object_put(bb->obj);
+err_free_bb:
+	kfree(bb);
+	return ret;
+}
+
+static void free_shadow_bb(struct intel_vgpu_shadow_bb *bb)
+{
+	i915_gem_object_unpin_map(bb->obj);
+	i915_gem_obj_finish_shmem_access(bb->obj);
+	i915_gem_object_put(bb->obj);
+	kfree(bb);
+}
+
+/*
+ * Returns 1 when @cacheable batch buffer is found unchanged in bb cache,
+ * in which case it doesn't need to be scanned.
+ */
+static int perform_bb_shadow(struct parser_exec_state *s, bool cacheable)
+{
+	struct intel_vgpu *vgpu = s->vgpu;
+	struct intel_vgpu_shadow_bb *bb = NULL;
+	struct intel_vgpu_bb_cache *c = NULL;
+	unsigned long gma = 0;
+	unsigned long bb_size = 0;
+	int ret = 0;
+	bool ppgtt = s->buf_addr_type != GTT_BUFFER;
+	unsigned long gma_start_offset = 0;
+
+	/* get the start gm address of the batch buffer */
+	gma = get_gma_bb_from_cmd(s, 1);
+	if (gma == INTEL_GVT_INVALID_ADDR)
+		return -EFAULT;
+
+	/* the gma_start_offset stores the batch buffer's start gma's
+	 * offset relative to page boundary. so for non-privileged batch
+	 * buffer, the shadowed gem object holds exactly the same page
+	 * layout as original gem object. This is for the convience of
+	 * replacing the whole non-privilged batch buffer page to this
+	 * shadowed one in PPGTT at the same gma address. (this replacing
+	 * action is not implemented yet now, but may be necessary in
+	 * future).
+	 * for prileged batch buffer, we just change start gma address to
+	 * that of shadowed page.
+	 */
+	if (ppgtt)
+		gma_start_offset = gma & ~I915_GTT_PAGE_MASK;
+
+	if (cacheable) {
+		s->cache_va = NULL;
+		c = bb_cache_find(s, gma, ppgtt);
+	}
+
+	if (c) {
+		ret = shadow_bb(s, gma, gma_start_offset, c->size, &bb);
+		if (!ret && memcmp(bb->va + gma_start_offset, c->data,
+				   c->size)) {
+			free_shadow_bb(bb);
+			bb = NULL;
+		}
+		if (!bb) {
+			bb_cache_free(vgpu, c);
+			c = NULL;
+		}
+	}
+
+	if (!bb) {
+		ret = find_bb_size(s, &bb_size);
+		if (ret)
+			return ret;
+
+		ret = shadow_bb(s, gma, gma_start_offset, bb_size, &bb);
+		if (ret)
+			return ret;
+	}
+
 	INIT_LIST_HEAD(&bb->list);
 	list_add(&bb->list, &s->workload->shadow_bb);
 
@@ -1787,21 +1945,25 @@ static int perform_bb_shadow(struct parser_exec_state *s)
 	 */
 	s->ip_va = bb->va + gma_start_offset;
 	s->ip_gma = gma;
+
+	if (c) {
+		list_move(&c->list, &vgpu->submission.bb_cache);
+		return 1;
+	}
+
+	if (cacheable && bb_size <= GVT_BB_CACHE_MAX_SIZE) {
+		s->cache_va = s->ip_va;
+		s->cache_gma = gma;
+		s->cache_size = bb_size;
+		s->cache_ppgtt = ppgtt;
+		s->side_effect = false;
+	}
 	return 0;
-err_unmap:
-	i915_gem_object_unpin_map(bb->obj);
-err_finish_shmem_access:
-	i915_gem_obj_finish_shmem_access(bb->obj);
-err_free_obj:
-	i915_gem_object_put(bb->obj);
-err_free_bb:
-	kfree(bb);
-	return ret;
 }
 
 static int cmd_handler_mi_batch_buffer_start(struct parser_exec_state *s)
 {
-	bool second_level;
+	bool second_level, from_ring;
 	int ret = 0;
 	struct intel_vgpu *vgpu = s->vgpu;
 
@@ -1816,6 +1978,11 @@ static int cmd_handler_mi_batch_buffer_start(struct parser_exec_state *s)
 		return -EFAULT;
 	}
 
+	/* only batch buffers without nested or chained ones are cached */
+	from_ring = s->buf_type == RING_BUFFER_INSTRUCTION;
+	if (!from_ring)
+		s->side_effect = true;
+
 	s->saved_buf_addr_type = s->buf_addr_type;
 	addr_type_update_snb(s);
 	if (s->buf_type == RING_BUFFER_INSTRUCTION) {
@@ -1828,9 +1995,12 @@ static int cmd_handler_mi_batch_buffer_start(struct parser_exec_state *s)
 	}
 
 	if (batch_buffer_needs_scan(s)) {
-		ret = perform_bb_shadow(s);
+		ret = perform_bb_shadow(s, from_ring && !s->is_ctx_wa);
 		if (ret < 0)
 			gvt_vgpu_err("invalid shadow batch buffer\n");
+		else if (ret > 0)
+			/* unchanged batch buffer, skip to its end */
+			ret = cmd_handler_mi_batch_buffer_end(s);
 	} else {
 		/* emulate a batch buffer end to do return right */
 		ret = cmd_handler_mi_batch_buffer_end(s);
@@ -2512,11 +2682,6 @@ static struct cmd_info cmd_info[] = {
 		0, 20, NULL},
 };
 
-static void add_cmd_entry(struct intel_gvt *gvt, struct cmd_entry *e)
-{
-	hash_add(gvt->cmd_table, &e->hlist, e->info->opcode);
-}
-
 /* call the cmd handler, and advance ip */
 static int cmd_parser_exec(struct parser_exec_state *s)
 {
@@ -2647,6 +2812,8 @@ static int scan_workload(struct intel_vgpu_workload *workload)
 	s.rb_va = workload->shadow_ring_buffer_va;
 	s.workload = workload;
 	s.is_ctx_wa = false;
+	s.cache_va = NULL;
+	s.side_effect = false;
 
 	if ((bypass_scan_mask & (1 << workload->ring_id)) ||
 		gma_head == gma_tail)
@@ -2701,6 +2868,8 @@ static int scan_wa_ctx(struct intel_shadow_wa_ctx *wa_ctx)
 	s.rb_va = wa_ctx->indirect_ctx.shadow_va;
 	s.workload = workload;
 	s.is_ctx_wa = true;
+	s.cache_va = NULL;
+	s.side_effect = false;
 
 	if (!intel_gvt_ggtt_validate_range(s.vgpu, s.ring_start, s.ring_size)) {
 		ret = -EINVAL;
@@ -2922,68 +3091,84 @@ int intel_gvt_scan_and_shadow_wa_ctx(struct intel_shadow_wa_ctx *wa_ctx)
 	return 0;
 }
 
-static struct cmd_info *find_cmd_entry_any_ring(struct intel_gvt *gvt,
-		unsigned int opcode, unsigned long rings)
+static u16 *cmd_table_slot(struct intel_gvt *gvt,
+		unsigned int opcode, int ring_id)
 {
-	struct cmd_info *info = NULL;
-	unsigned int ring;
+	struct decode_info *d_info;
+	unsigned int type;
 
-	for_each_set_bit(ring, &rings, I915_NUM_ENGINES) {
-		info = find_cmd_entry(gvt, opcode, ring);
-		if (info)
-			break;
+	for (type = 0; type < GVT_CMD_TYPE_NUM; type++) {
+		d_info = ring_decode_info[ring_id][type];
+		if (d_info && (opcode >> (d_info->op_len - 3)) == type)
+			return &gvt->cmd_table[ring_id][type][opcode &
+					(cmd_table_size(d_info) - 1)];
 	}
-	return info;
+	return NULL;
 }
 
 static int init_cmd_table(struct intel_gvt *gvt)
 {
-	int i;
-	struct cmd_entry *e;
+	struct decode_info *d_info;
 	struct cmd_info	*info;
 	unsigned int gen_type;
+	unsigned long rings;
+	unsigned int ring, type;
+	u16 *slot;
+	int i;
 
 	gen_type = intel_gvt_get_device_type(gvt);
 
+	for (ring = 0; ring < I915_NUM_ENGINES; ring++) {
+		for (type = 0; type < GVT_CMD_TYPE_NUM; type++) {
+			d_info = ring_decode_info[ring][type];
+			if (!d_info)
+				continue;
+
+			gvt->cmd_table[ring][type] = kcalloc(
+					cmd_table_size(d_info), sizeof(u16),
+					GFP_KERNEL);
+			if (!gvt->cmd_table[ring][type])
+				return -ENOMEM;
+		}
+	}
+
 	for (i = 0; i < ARRAY_SIZE(cmd_info); i++) {
 		if (!(cmd_info[i].devices & gen_type))
 			continue;
 
-		e = kzalloc(sizeof(*e), GFP_KERNEL);
-		if (!e)
-			return -ENOMEM;
-
-		e->info = &cmd_info[i];
-		info = find_cmd_entry_any_ring(gvt,
-				e->info->opcode, e->info->rings);
-		if (info) {
-			gvt_err("%s %s duplicated\n", e->info->name,
-					info->name);
-			kfree(e);
-			return -EEXIST;
+		info = &cmd_info[i];
+		rings = info->rings;
+		for_each_set_bit(ring, &rings, I915_NUM_ENGINES) {
+			slot = cmd_table_slot(gvt, info->opcode, ring);
+			if (!slot)
+				continue;
+			if (*slot) {
+				gvt_err("%s %s duplicated\n", info->name,
+						cmd_info[*slot - 1].name);
+				return -EEXIST;
+			}
+			*slot = i + 1;
 		}
 		if (cmd_info[i].opcode == OP_MI_NOOP)
 			mi_noop_index = i;
 
-		INIT_HLIST_NODE(&e->hlist);
-		add_cmd_entry(gvt, e);
 		gvt_dbg_cmd("add %-30s op %04x flag %x devs %02x rings %02x\n",
-				e->info->name, e->info->opcode, e->info->flag,
-				e->info->devices, e->info->rings);
+				info->name, info->opcode, info->flag,
+				info->devices, info->rings);
 	}
 	return 0;
 }
 
 static void clean_cmd_table(struct intel_gvt *gvt)
 {
-	struct hlist_node *tmp;
-	struct cmd_entry *e;
-	int i;
-
-	hash_for_each_safe(gvt->cmd_table, i, tmp, e, hlist)
-		kfree(e);
+	unsigned int ring, type;
 
-	hash_init(gvt->cmd_table);
+	for (ring = 0; ring < I915_NUM_ENGINES; ring++) {
+		for (type = 0; type < GVT_CMD_TYPE_NUM; type++) {
+			kfree(gvt->cmd_table[ring][type]);
+			gvt->cmd_table[ring][type] = NULL;
+		}
+	}
 }
 
 void intel_gvt_clean_cmd_parser(struct intel_gvt *gvt)
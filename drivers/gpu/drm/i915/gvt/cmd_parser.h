@@ -36,7 +36,7 @@
 #ifndef _GVT_CMD_PARSER_H_
 #define _GVT_CMD_PARSER_H_
 
-#define GVT_CMD_HASH_BITS 7
+#define GVT_CMD_TYPE_NUM 8
 
 void intel_gvt_clean_cmd_parser(struct intel_gvt *gvt);
 
@@ -46,5 +46,7 @@ int intel_gvt_scan_and_shadow_ringbuffer(struct intel_vgpu_workload *workload);
 
 int intel_gvt_scan_and_shadow_wa_ctx(struct intel_shadow_wa_ctx *wa_ctx);
 
+void intel_gvt_clean_bb_cache(struct intel_vgpu *vgpu);
+
 int gvt_emit_pdps(struct intel_vgpu_workload *workload);
 #endif
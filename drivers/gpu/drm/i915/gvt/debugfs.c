@@ -124,6 +124,60 @@ static int vgpu_mmio_diff_show(struct seq_file *s, void *unused)
 }
 DEFINE_SHOW_ATTRIBUTE(vgpu_mmio_diff);
 
+static int vgpu_oos_stats_show(struct seq_file *s, void *unused)
+{
+	struct intel_vgpu *vgpu = s->private;
+	struct intel_vgpu_gtt *gtt = &vgpu->gtt;
+	struct intel_vgpu_oos_stats *stats = &gtt->oos_stats;
+
+	seq_printf(s, "pages: %u quota: %u\n",
+		   gtt->nr_oos_pages, gtt->oos_quota);
+	seq_printf(s, "attach: %lu evict: %lu idle: %lu trap: %lu sync: %lu\n",
+		   stats->attach, stats->evict, stats->idle, stats->trap,
+		   stats->sync);
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(vgpu_oos_stats);
+
+static int vgpu_stats_show(struct seq_file *s, void *unused)
+{
+	static const char * const mmio_class[GVT_MMIO_CLASS_NUM] = {
+		[GVT_MMIO_CLASS_GT] = "gt",
+		[GVT_MMIO_CLASS_DISPLAY] = "display",
+		[GVT_MMIO_CLASS_PVINFO] = "pvinfo",
+		[GVT_MMIO_CLASS_GGTT] = "ggtt",
+	};
+	struct intel_vgpu *vgpu = s->private;
+	struct intel_vgpu_stats *stats = &vgpu->stats;
+	struct intel_engine_cs *engine;
+	struct list_head *pos;
+	enum intel_engine_id id;
+	unsigned int depth;
+	int i;
+
+	mutex_lock(&vgpu->vgpu_lock);
+
+	for (i = 0; i < GVT_MMIO_CLASS_NUM; i++)
+		seq_printf(s, "mmio_trap_%s: %llu\n", mmio_class[i],
+			   stats->mmio_trap[i]);
+	seq_printf(s, "wp_fault: %llu\n", stats->wp_fault);
+	seq_printf(s, "oos_sync: %lu\n", vgpu->gtt.oos_stats.sync);
+	seq_printf(s, "workloads: %llu\n", stats->workloads);
+	seq_printf(s, "scan_ns: %llu\n", stats->scan_ns);
+
+	for_each_engine(engine, vgpu->gvt->dev_priv, id) {
+		depth = 0;
+		list_for_each(pos, workload_q_head(vgpu, id))
+			depth++;
+		seq_printf(s, "%s: queue_depth: %u busy_ns: %llu\n",
+			   engine->name, depth, stats->ring_busy_ns[id]);
+	}
+
+	mutex_unlock(&vgpu->vgpu_lock);
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(vgpu_stats);
+
 static int
 vgpu_scan_nonprivbb_get(void *data, u64 *val)
 {
@@ -218,6 +272,41 @@ int intel_gvt_debugfs_add_vgpu(struct intel_vgpu *vgpu)
 	if (!ent)
 		return -ENOMEM;
 
+	ent = debugfs_create_file("oos_stats", 0444, vgpu->debugfs,
+				  vgpu, &vgpu_oos_stats_fops);
+	if (!ent)
+		return -ENOMEM;
+
+	ent = debugfs_create_file("stats", 0444, vgpu->debugfs,
+				  vgpu, &vgpu_stats_fops);
+	if (!ent)
+		return -ENOMEM;
+
+	ent = debugfs_create_u32("oos_quota", 0644, vgpu->debugfs,
+				 &vgpu->gtt.oos_quota);
+	if (!ent)
+		return -ENOMEM;
+
+	ent = debugfs_create_u32("preempt_timeout_ms", 0644, vgpu->debugfs,
+				 &vgpu->submission.shadow_ctx->preempt_timeout);
+	if (!ent)
+		return -ENOMEM;
+
+	ent = debugfs_create_u32("vblank_offset", 0644, vgpu->debugfs,
+				 &vgpu->display.vblank_offset);
+	if (!ent)
+		return -ENOMEM;
+
+	ent = debugfs_create_u32("irq_coalesce_us", 0644, vgpu->debugfs,
+				 &vgpu->irq.coalesce_us);
+	if (!ent)
+		return -ENOMEM;
+
+	ent = debugfs_create_u32("irq_coalesce_count", 0644, vgpu->debugfs,
+				 &vgpu->irq.coalesce_count);
+	if (!ent)
+		return -ENOMEM;
+
 	return 0;
 }
 
@@ -254,6 +343,21 @@ int intel_gvt_debugfs_init(struct intel_gvt *gvt)
 	if (!ent)
 		return -ENOMEM;
 
+	ent = debugfs_create_u32("num_oos_pages", 0444, gvt->debugfs_root,
+				 &gvt->gtt.nr_oos_pages);
+	if (!ent)
+		return -ENOMEM;
+
+	ent = debugfs_create_u32("num_free_oos_pages", 0444, gvt->debugfs_root,
+				 &gvt->gtt.nr_free_oos_pages);
+	if (!ent)
+		return -ENOMEM;
+
+	ent = debugfs_create_u32("max_oos_pages", 0644, gvt->debugfs_root,
+				 &gvt->gtt.max_oos_pages);
+	if (!ent)
+		return -ENOMEM;
+
 	return 0;
 }
 
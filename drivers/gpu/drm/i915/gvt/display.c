@@ -464,6 +464,55 @@ void intel_gvt_emulate_vblank(struct intel_gvt *gvt)
 	mutex_unlock(&gvt->lock);
 }
 
+static void vgpu_vblank_work(struct work_struct *w)
+{
+	struct intel_vgpu_display *display = container_of(w,
+			struct intel_vgpu_display, vblank_work);
+	struct intel_vgpu *vgpu = container_of(display,
+			struct intel_vgpu, display);
+	int pipe;
+
+	mutex_lock(&vgpu->vgpu_lock);
+	for (pipe = PIPE_A; pipe <= PIPE_C; pipe++) {
+		if (test_and_clear_bit(pipe, &display->vblank_pending) &&
+		    vgpu->active)
+			emulate_vblank_on_pipe(vgpu, pipe);
+	}
+	mutex_unlock(&vgpu->vgpu_lock);
+}
+
+static enum hrtimer_restart vgpu_vblank_timer_fn(struct hrtimer *data)
+{
+	struct intel_vgpu_display *display = container_of(data,
+			struct intel_vgpu_display, vblank_timer);
+
+	queue_work(system_highpri_wq, &display->vblank_work);
+	return HRTIMER_NORESTART;
+}
+
+/*
+ * Emulate the vblank of a vGPU with a non-zero vblank_offset that long
+ * after the host vblank of @pipe, taking the host's vblank timestamp and
+ * not the time this work runs as the reference, so the phase relation to
+ * the physical pipe is kept.
+ */
+static void queue_vgpu_vblank(struct intel_vgpu *vgpu, int pipe)
+{
+	struct intel_vgpu_display *display = &vgpu->display;
+	struct intel_crtc *crtc = intel_get_crtc_for_pipe(vgpu->gvt->dev_priv,
+							  pipe);
+	ktime_t vblank_time;
+
+	set_bit(pipe, &display->vblank_pending);
+	if (hrtimer_active(&display->vblank_timer))
+		return;
+
+	drm_crtc_vblank_count_and_time(&crtc->base, &vblank_time);
+	hrtimer_start(&display->vblank_timer,
+		      ktime_add_us(vblank_time, display->vblank_offset),
+		      HRTIMER_MODE_ABS);
+}
+
 static void intel_gvt_vblank_work(struct work_struct *w)
 {
 	struct intel_gvt_pipe_info *pipe_info = container_of(w,
@@ -473,11 +522,28 @@ static void intel_gvt_vblank_work(struct work_struct *w)
 	int id;
 
 	mutex_lock(&gvt->lock);
-	for_each_active_vgpu(gvt, vgpu, id)
-		emulate_vblank_on_pipe(vgpu, pipe_info->pipe_num);
+	for_each_active_vgpu(gvt, vgpu, id) {
+		if (READ_ONCE(vgpu->display.vblank_offset))
+			queue_vgpu_vblank(vgpu, pipe_info->pipe_num);
+		else
+			emulate_vblank_on_pipe(vgpu, pipe_info->pipe_num);
+	}
 	mutex_unlock(&gvt->lock);
 }
 
+/**
+ * intel_vgpu_stop_vblank - stop the delayed vblank emulation of a vGPU
+ * @vgpu: a vGPU
+ *
+ * Called once @vgpu is no longer reachable from the host vblank work,
+ * without vgpu_lock held.
+ */
+void intel_vgpu_stop_vblank(struct intel_vgpu *vgpu)
+{
+	hrtimer_cancel(&vgpu->display.vblank_timer);
+	cancel_work_sync(&vgpu->display.vblank_work);
+}
+
 #define BITS_PER_DOMAIN 4
 #define MAX_SCALERS_PER_DOMAIN 2
 
@@ -608,9 +674,14 @@ void intel_vgpu_clean_display(struct intel_vgpu *vgpu)
 int intel_vgpu_init_display(struct intel_vgpu *vgpu, u64 resolution)
 {
 	struct drm_i915_private *dev_priv = vgpu->gvt->dev_priv;
+	struct intel_vgpu_display *display = &vgpu->display;
 
 	intel_vgpu_init_i2c_edid(vgpu);
 
+	hrtimer_init(&display->vblank_timer, CLOCK_MONOTONIC, HRTIMER_MODE_ABS);
+	display->vblank_timer.function = vgpu_vblank_timer_fn;
+	INIT_WORK(&display->vblank_work, vgpu_vblank_work);
+
 	if (IS_BROXTON(dev_priv) || IS_KABYLAKE(dev_priv))
 		return setup_virtual_monitors(vgpu);
 	else if (IS_SKYLAKE(dev_priv))
@@ -196,6 +196,73 @@ static struct drm_i915_gem_object *vgpu_create_gem(struct drm_device *dev,
 	return obj;
 }
 
+/*
+ * Maximum number of framebuffers per vGPU whose GEM object is kept, a
+ * guest flipping between a handful of buffers then reuses the same GEM
+ * objects and their pages frame after frame.
+ */
+#define GVT_DMABUF_GEM_CACHE_SIZE	4
+
+/* the guest may have remapped its framebuffer's GGTT range meanwhile */
+static bool vgpu_gem_pages_valid(struct drm_i915_gem_object *obj)
+{
+	struct drm_i915_private *dev_priv = to_i915(obj->base.dev);
+	struct intel_vgpu_fb_info *fb_info = obj->gvt_info;
+	gen8_pte_t __iomem *gtt_entries;
+	struct scatterlist *sg;
+	bool valid = true;
+	int i;
+
+	mutex_lock(&obj->mm.lock);
+	if (!i915_gem_object_has_pages(obj))
+		goto out;
+
+	gtt_entries = (gen8_pte_t __iomem *)dev_priv->ggtt.gsm +
+		(fb_info->start >> PAGE_SHIFT);
+	for_each_sg(obj->mm.pages->sgl, sg, fb_info->size, i) {
+		if (sg_dma_address(sg) !=
+		    GEN8_DECODE_PTE(readq(&gtt_entries[i]))) {
+			valid = false;
+			break;
+		}
+	}
+out:
+	mutex_unlock(&obj->mm.lock);
+	return valid;
+}
+
+static void uncache_dmabuf_gem(struct intel_vgpu *vgpu,
+		struct intel_vgpu_dmabuf_obj *dmabuf_obj)
+{
+	struct drm_i915_gem_object *obj = fetch_and_zero(&dmabuf_obj->gem);
+
+	if (!obj)
+		return;
+
+	vgpu->nr_cached_dmabuf_gem--;
+	i915_gem_object_put(obj);
+}
+
+static void cache_dmabuf_gem(struct intel_vgpu *vgpu,
+		struct intel_vgpu_dmabuf_obj *dmabuf_obj,
+		struct drm_i915_gem_object *obj)
+{
+	struct intel_vgpu_dmabuf_obj *pos;
+
+	/* the list is kept in LRU order, evict the oldest cached one */
+	if (vgpu->nr_cached_dmabuf_gem >= GVT_DMABUF_GEM_CACHE_SIZE) {
+		list_for_each_entry(pos, &vgpu->dmabuf_obj_list_head, list) {
+			if (pos->gem) {
+				uncache_dmabuf_gem(vgpu, pos);
+				break;
+			}
+		}
+	}
+
+	dmabuf_obj->gem = i915_gem_object_get(obj);
+	vgpu->nr_cached_dmabuf_gem++;
+}
+
 static bool validate_hotspot(struct intel_vgpu_cursor_plane_format *c)
 {
 	if (c && c->x_hot <= c->width && c->y_hot <= c->height)
@@ -489,14 +556,28 @@ int intel_vgpu_get_dmabuf(struct intel_vgpu *vgpu, unsigned int dmabuf_id)
 		goto out;
 	}
 
-	obj = vgpu_create_gem(dev, dmabuf_obj->info);
-	if (obj == NULL) {
-		gvt_vgpu_err("create gvt gem obj failed\n");
-		ret = -ENOMEM;
-		goto out;
+	obj = dmabuf_obj->gem;
+	if (obj && !vgpu_gem_pages_valid(obj)) {
+		uncache_dmabuf_gem(vgpu, dmabuf_obj);
+		obj = NULL;
 	}
 
-	obj->gvt_info = dmabuf_obj->info;
+	if (obj) {
+		i915_gem_object_get(obj);
+	} else {
+		obj = vgpu_create_gem(dev, dmabuf_obj->info);
+		if (obj == NULL) {
+			gvt_vgpu_err("create gvt gem obj failed\n");
+			ret = -ENOMEM;
+			goto out;
+		}
+
+		obj->gvt_info = dmabuf_obj->info;
+		/* dropped by vgpu_gem_release */
+		dmabuf_obj_get(dmabuf_obj);
+		cache_dmabuf_gem(vgpu, dmabuf_obj, obj);
+	}
+	list_move_tail(&dmabuf_obj->list, &vgpu->dmabuf_obj_list_head);
 
 	dmabuf = i915_gem_prime_export(dev, &obj->base, DRM_CLOEXEC | DRM_RDWR);
 	if (IS_ERR(dmabuf)) {
@@ -514,8 +595,6 @@ int intel_vgpu_get_dmabuf(struct intel_vgpu *vgpu, unsigned int dmabuf_id)
 	}
 	dmabuf_fd = ret;
 
-	dmabuf_obj_get(dmabuf_obj);
-
 	if (dmabuf_obj->initref) {
 		dmabuf_obj->initref = false;
 		dmabuf_obj_put(dmabuf_obj);
@@ -546,6 +625,7 @@ void intel_vgpu_dmabuf_cleanup(struct intel_vgpu *vgpu)
 {
 	struct list_head *pos, *n;
 	struct intel_vgpu_dmabuf_obj *dmabuf_obj;
+	bool initref;
 
 	mutex_lock(&vgpu->dmabuf_lock);
 	list_for_each_safe(pos, n, &vgpu->dmabuf_obj_list_head) {
@@ -557,12 +637,16 @@ void intel_vgpu_dmabuf_cleanup(struct intel_vgpu *vgpu)
 		intel_gvt_hypervisor_put_vfio_device(vgpu);
 		list_del(pos);
 
-		/* dmabuf_obj might be freed in dmabuf_obj_put */
-		if (dmabuf_obj->initref) {
-			dmabuf_obj->initref = false;
-			dmabuf_obj_put(dmabuf_obj);
-		}
+		initref = dmabuf_obj->initref;
+		dmabuf_obj->initref = false;
 
+		/*
+		 * dmabuf_obj might be freed by either put below, the cached
+		 * GEM object holds a reference of its own.
+		 */
+		uncache_dmabuf_gem(vgpu, dmabuf_obj);
+		if (initref)
+			dmabuf_obj_put(dmabuf_obj);
 	}
 	mutex_unlock(&vgpu->dmabuf_lock);
 }
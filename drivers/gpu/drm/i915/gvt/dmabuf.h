@@ -57,6 +57,8 @@ struct intel_vgpu_dmabuf_obj {
 	__u32 dmabuf_id;
 	struct kref kref;
 	bool initref;
+	/* GEM object kept across get_dmabuf calls, one ref held */
+	struct drm_i915_gem_object *gem;
 	struct list_head list;
 };
 
@@ -505,6 +505,94 @@ int intel_vgpu_submit_execlist(struct intel_vgpu *vgpu, int ring_id)
 	return -EINVAL;
 }
 
+/**
+ * intel_vgpu_pv_submit - consume a vGPU's PV submission ring
+ * @vgpu: a vGPU
+ * @ring_id: ring index
+ *
+ * Submit every descriptor pair the guest queued in the PV submission ring
+ * of @ring_id, then publish through the busy flag whether a later workload
+ * completion will do this again. Called with vgpu_lock held, both when the
+ * guest kicks through ELSP and whenever a workload of @ring_id completes.
+ *
+ * Returns:
+ * Zero on success, negative error code if failed.
+ */
+int intel_vgpu_pv_submit(struct intel_vgpu *vgpu, int ring_id)
+{
+	struct intel_vgpu_execlist *execlist =
+		&vgpu->submission.execlist[ring_id];
+	struct pv_submission *pv = &vgpu->mmio.shared_page->pv_submit[ring_id];
+	u32 head, tail;
+	bool busy;
+	int i, ret = 0;
+
+	if (!(VGPU_PVMMIO(vgpu) & PVMMIO_PV_SUBMIT))
+		return 0;
+
+again:
+	head = READ_ONCE(pv->head);
+	tail = READ_ONCE(pv->tail);
+	/* read the slots only after the tail which published them */
+	smp_rmb();
+
+	if (tail - head > PV_SUBMIT_SLOTS) {
+		gvt_vgpu_err("invalid pv submission ring %d head %u tail %u\n",
+			     ring_id, head, tail);
+		WRITE_ONCE(pv->head, tail);
+		return -EINVAL;
+	}
+
+	while (head != tail) {
+		for (i = 0; i < 4; i++)
+			execlist->elsp_dwords.data[3 - i] =
+				READ_ONCE(pv->descs[head % PV_SUBMIT_SLOTS][i]);
+		WRITE_ONCE(pv->head, ++head);
+
+		ret = intel_vgpu_submit_execlist(vgpu, ring_id);
+		if (ret)
+			return ret;
+	}
+
+	busy = !list_empty(workload_q_head(vgpu, ring_id));
+	WRITE_ONCE(pv->busy, busy);
+	/*
+	 * Pairs with the guest writing tail before reading busy: either
+	 * the guest sees busy clear and kicks, or we see its new tail here.
+	 */
+	smp_mb();
+	if (!busy && READ_ONCE(pv->tail) != tail)
+		goto again;
+
+	return 0;
+}
+
+/**
+ * intel_vgpu_pv_submit_idle - make the guest kick again
+ * @vgpu: a vGPU
+ * @engine_mask: engines whose workload queues were flushed
+ *
+ * Without queued workloads no completion will consume the PV submission
+ * ring any more, so clear busy and drop whatever the guest left behind.
+ */
+void intel_vgpu_pv_submit_idle(struct intel_vgpu *vgpu,
+		unsigned long engine_mask)
+{
+	struct drm_i915_private *dev_priv = vgpu->gvt->dev_priv;
+	struct intel_engine_cs *engine;
+	struct pv_submission *pv;
+	unsigned int tmp;
+
+	if (!(VGPU_PVMMIO(vgpu) & PVMMIO_PV_SUBMIT))
+		return;
+
+	for_each_engine_masked(engine, dev_priv, engine_mask, tmp) {
+		pv = &vgpu->mmio.shared_page->pv_submit[engine->id];
+		WRITE_ONCE(pv->head, READ_ONCE(pv->tail));
+		WRITE_ONCE(pv->busy, 0);
+	}
+}
+
 static void init_vgpu_execlist(struct intel_vgpu *vgpu, int ring_id)
 {
 	struct intel_vgpu_submission *s = &vgpu->submission;
@@ -179,6 +179,11 @@ int intel_vgpu_init_execlist(struct intel_vgpu *vgpu);
 
 int intel_vgpu_submit_execlist(struct intel_vgpu *vgpu, int ring_id);
 
+int intel_vgpu_pv_submit(struct intel_vgpu *vgpu, int ring_id);
+
+void intel_vgpu_pv_submit_idle(struct intel_vgpu *vgpu,
+		unsigned long engine_mask);
+
 void intel_vgpu_reset_execlist(struct intel_vgpu *vgpu,
 		unsigned long engine_mask);
 
@@ -146,6 +146,7 @@ void intel_gvt_free_firmware(struct intel_gvt *gvt)
 
 	kfree(gvt->firmware.cfg_space);
 	kfree(gvt->firmware.mmio);
+	vfree(gvt->firmware.mmio_template);
 }
 
 static int verify_firmware(struct intel_gvt *gvt,
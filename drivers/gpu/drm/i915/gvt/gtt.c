@@ -45,7 +45,19 @@
 #endif
 
 static bool enable_out_of_sync = true;
-static int preallocated_oos_pages = 8192;
+static int preallocated_oos_pages = 1024;
+static int max_oos_pages = 16384;
+
+/*
+ * A guest page table goes out of sync after being written twice while
+ * write protected. Once a vGPU runs out of oos pages, only a page written
+ * at least GVT_OOS_HOT_WRITE_CNT times may take the oos page of the least
+ * recently attached page of the same vGPU, which is synced eagerly, and
+ * colder pages keep trapping. An oos page is released after its guest
+ * page changed nothing in GVT_OOS_IDLE_SYNCS syncs in a row.
+ */
+#define GVT_OOS_HOT_WRITE_CNT 8
+#define GVT_OOS_IDLE_SYNCS 4
 
 /*
  * validate a gm address and related range size,
@@ -737,6 +749,8 @@ static void free_spt(struct intel_vgpu_ppgtt_spt *spt)
 
 static int detach_oos_page(struct intel_vgpu *vgpu,
 		struct intel_vgpu_oos_page *oos_page);
+static void free_oos_page(struct intel_gvt *gvt,
+		struct intel_vgpu_oos_page *oos_page);
 
 static void ppgtt_free_spt(struct intel_vgpu_ppgtt_spt *spt)
 {
@@ -750,8 +764,12 @@ static void ppgtt_free_spt(struct intel_vgpu_ppgtt_spt *spt)
 	radix_tree_delete(&spt->vgpu->gtt.spt_tree, spt->shadow_page.mfn);
 
 	if (spt->guest_page.gfn) {
-		if (spt->guest_page.oos_page)
-			detach_oos_page(spt->vgpu, spt->guest_page.oos_page);
+		struct intel_vgpu_oos_page *oos_page = spt->guest_page.oos_page;
+
+		if (oos_page) {
+			detach_oos_page(spt->vgpu, oos_page);
+			free_oos_page(spt->vgpu->gvt, oos_page);
+		}
 
 		intel_vgpu_unregister_page_track(spt->vgpu, spt->guest_page.gfn);
 	}
@@ -1005,7 +1023,8 @@ static int ppgtt_invalidate_spt(struct intel_vgpu_ppgtt_spt *spt)
 			continue;
 		case GTT_TYPE_PPGTT_PTE_2M_ENTRY:
 			gvt_vdbg_mm("invalidate 2M entry\n");
-			continue;
+			ppgtt_invalidate_pte(spt, &e);
+			break;
 		case GTT_TYPE_PPGTT_PTE_1G_ENTRY:
 			WARN(1, "GVT doesn't support 1GB page\n");
 			continue;
@@ -1127,12 +1146,18 @@ static inline void ppgtt_generate_shadow_entry(struct intel_gvt_gtt_entry *se,
 /**
  * Return 1 if 2MB huge gtt shadowing is possilbe, 0 if miscondition,
  * negtive if found err.
+ *
+ * The 2MB guest page can be shadowed by a single entry when the host
+ * backs it with one naturally aligned compound page of at least 2MB,
+ * i.e. a THP or a hugetlbfs page (the vhm_hugetlb guest memory on ACRN),
+ * 1GB hugetlbfs pages included.
  */
 static int is_2MB_gtt_possible(struct intel_vgpu *vgpu,
 	struct intel_gvt_gtt_entry *entry)
 {
 	struct intel_gvt_gtt_pte_ops *ops = vgpu->gvt->gtt.pte_ops;
 	unsigned long pfn;
+	struct page *page;
 
 	if (!HAS_PAGE_SIZES(vgpu->gvt->dev_priv, I915_GTT_PAGE_SIZE_2M))
 		return 0;
@@ -1141,7 +1166,16 @@ static int is_2MB_gtt_possible(struct intel_vgpu *vgpu,
 	if (pfn == INTEL_GVT_INVALID_ADDR)
 		return -EINVAL;
 
-	return PageTransHuge(pfn_to_page(pfn));
+	if (!IS_ALIGNED(pfn, I915_GTT_PAGE_SIZE_2M >> PAGE_SHIFT) ||
+	    !pfn_valid(pfn))
+		return 0;
+
+	page = pfn_to_page(pfn);
+	if (!PageCompound(page))
+		return 0;
+
+	return compound_order(compound_head(page)) >=
+		get_order(I915_GTT_PAGE_SIZE_2M);
 }
 
 static int split_2MB_gtt_entry(struct intel_vgpu *vgpu,
@@ -1268,6 +1302,8 @@ static int ppgtt_populate_shadow_entry(struct intel_vgpu *vgpu,
 	/* direct shadow */
 	ret = intel_gvt_hypervisor_dma_map_guest_page(vgpu, gfn, page_size,
 						      &dma_addr);
+	if (ret && page_size == I915_GTT_PAGE_SIZE_2M)
+		return split_2MB_gtt_entry(vgpu, spt, index, &se);
 	if (ret)
 		return -ENXIO;
 
@@ -1410,7 +1446,7 @@ static int sync_oos_page(struct intel_vgpu *vgpu,
 	struct intel_gvt_gtt_pte_ops *ops = gvt->gtt.pte_ops;
 	struct intel_vgpu_ppgtt_spt *spt = oos_page->spt;
 	struct intel_gvt_gtt_entry old, new;
-	int index;
+	int index, changed = 0;
 	int ret;
 
 	trace_oos_change(vgpu->id, "sync", oos_page->id,
@@ -1438,28 +1474,93 @@ static int sync_oos_page(struct intel_vgpu *vgpu,
 			return ret;
 
 		ops->set_entry(oos_page->mem, &new, index, false, 0, vgpu);
+		changed++;
 	}
 
+	if (changed)
+		spt->guest_page.idle_syncs = 0;
+	else
+		spt->guest_page.idle_syncs++;
+
+	vgpu->gtt.oos_stats.sync++;
 	spt->guest_page.write_cnt = 0;
 	list_del_init(&spt->post_shadow_list);
 	return 0;
 }
 
+static struct intel_vgpu_oos_page *alloc_oos_page(struct intel_gvt *gvt)
+{
+	struct intel_gvt_gtt *gtt = &gvt->gtt;
+	struct intel_vgpu_oos_page *oos_page;
+	int id;
+
+	spin_lock(&gtt->oos_lock);
+	if (!list_empty(&gtt->oos_page_free_list_head)) {
+		oos_page = list_first_entry(&gtt->oos_page_free_list_head,
+					    struct intel_vgpu_oos_page, list);
+		list_del_init(&oos_page->list);
+		gtt->nr_free_oos_pages--;
+		spin_unlock(&gtt->oos_lock);
+		return oos_page;
+	}
+
+	if (gtt->nr_oos_pages >= gtt->max_oos_pages) {
+		spin_unlock(&gtt->oos_lock);
+		return NULL;
+	}
+	gtt->nr_oos_pages++;
+	id = gtt->oos_page_id++;
+	spin_unlock(&gtt->oos_lock);
+
+	oos_page = kzalloc(sizeof(*oos_page), GFP_KERNEL | __GFP_NOWARN);
+	if (!oos_page) {
+		spin_lock(&gtt->oos_lock);
+		gtt->nr_oos_pages--;
+		spin_unlock(&gtt->oos_lock);
+		return NULL;
+	}
+
+	INIT_LIST_HEAD(&oos_page->list);
+	INIT_LIST_HEAD(&oos_page->vm_list);
+	oos_page->id = id;
+	return oos_page;
+}
+
+/* Keep up to preallocated_oos_pages free, give the rest back to system. */
+static void free_oos_page(struct intel_gvt *gvt,
+		struct intel_vgpu_oos_page *oos_page)
+{
+	struct intel_gvt_gtt *gtt = &gvt->gtt;
+
+	spin_lock(&gtt->oos_lock);
+	if (gtt->nr_free_oos_pages < preallocated_oos_pages) {
+		list_add(&oos_page->list, &gtt->oos_page_free_list_head);
+		gtt->nr_free_oos_pages++;
+		oos_page = NULL;
+	} else {
+		gtt->nr_oos_pages--;
+	}
+	spin_unlock(&gtt->oos_lock);
+
+	kfree(oos_page);
+}
+
 static int detach_oos_page(struct intel_vgpu *vgpu,
 		struct intel_vgpu_oos_page *oos_page)
 {
-	struct intel_gvt *gvt = vgpu->gvt;
 	struct intel_vgpu_ppgtt_spt *spt = oos_page->spt;
 
 	trace_oos_change(vgpu->id, "detach", oos_page->id,
 			 spt, spt->guest_page.type);
 
 	spt->guest_page.write_cnt = 0;
+	spt->guest_page.idle_syncs = 0;
 	spt->guest_page.oos_page = NULL;
 	oos_page->spt = NULL;
 
 	list_del_init(&oos_page->vm_list);
-	list_move_tail(&oos_page->list, &gvt->gtt.oos_page_free_list_head);
+	list_del_init(&oos_page->list);
+	vgpu->gtt.nr_oos_pages--;
 
 	return 0;
 }
@@ -1467,7 +1568,7 @@ static int detach_oos_page(struct intel_vgpu *vgpu,
 static int attach_oos_page(struct intel_vgpu_oos_page *oos_page,
 		struct intel_vgpu_ppgtt_spt *spt)
 {
-	struct intel_gvt *gvt = spt->vgpu->gvt;
+	struct intel_vgpu_gtt *gtt = &spt->vgpu->gtt;
 	int ret;
 
 	ret = intel_gvt_hypervisor_read_gpa(spt->vgpu,
@@ -1479,7 +1580,8 @@ static int attach_oos_page(struct intel_vgpu_oos_page *oos_page,
 	oos_page->spt = spt;
 	spt->guest_page.oos_page = oos_page;
 
-	list_move_tail(&oos_page->list, &gvt->gtt.oos_page_use_list_head);
+	list_add_tail(&oos_page->list, &gtt->oos_page_use_list_head);
+	gtt->nr_oos_pages++;
 
 	trace_oos_change(spt->vgpu->id, "attach", oos_page->id,
 			 spt, spt->guest_page.type);
@@ -1502,28 +1604,49 @@ static int ppgtt_set_guest_page_sync(struct intel_vgpu_ppgtt_spt *spt)
 	return sync_oos_page(spt->vgpu, oos_page);
 }
 
+/*
+ * Returns -ENOSPC when no oos page can be given to @spt, in which case
+ * the guest page stays write protected.
+ */
 static int ppgtt_allocate_oos_page(struct intel_vgpu_ppgtt_spt *spt)
 {
-	struct intel_gvt *gvt = spt->vgpu->gvt;
-	struct intel_gvt_gtt *gtt = &gvt->gtt;
+	struct intel_vgpu *vgpu = spt->vgpu;
+	struct intel_vgpu_gtt *gtt = &vgpu->gtt;
 	struct intel_vgpu_oos_page *oos_page = spt->guest_page.oos_page;
 	int ret;
 
 	WARN(oos_page, "shadow PPGTT page has already has a oos page\n");
 
-	if (list_empty(&gtt->oos_page_free_list_head)) {
-		oos_page = container_of(gtt->oos_page_use_list_head.next,
-			struct intel_vgpu_oos_page, list);
+	oos_page = NULL;
+	if (gtt->nr_oos_pages < gtt->oos_quota)
+		oos_page = alloc_oos_page(vgpu->gvt);
+
+	if (!oos_page) {
+		if (spt->guest_page.write_cnt < GVT_OOS_HOT_WRITE_CNT ||
+		    list_empty(&gtt->oos_page_use_list_head)) {
+			gtt->oos_stats.trap++;
+			return -ENOSPC;
+		}
+
+		oos_page = list_first_entry(&gtt->oos_page_use_list_head,
+					    struct intel_vgpu_oos_page, list);
 		ret = ppgtt_set_guest_page_sync(oos_page->spt);
 		if (ret)
 			return ret;
-		ret = detach_oos_page(spt->vgpu, oos_page);
+		ret = detach_oos_page(vgpu, oos_page);
 		if (ret)
 			return ret;
-	} else
-		oos_page = container_of(gtt->oos_page_free_list_head.next,
-			struct intel_vgpu_oos_page, list);
-	return attach_oos_page(oos_page, spt);
+		gtt->oos_stats.evict++;
+	}
+
+	ret = attach_oos_page(oos_page, spt);
+	if (ret) {
+		free_oos_page(vgpu->gvt, oos_page);
+		return ret;
+	}
+
+	gtt->oos_stats.attach++;
+	return 0;
 }
 
 static int ppgtt_set_guest_page_oos(struct intel_vgpu_ppgtt_spt *spt)
@@ -1565,6 +1688,14 @@ int intel_vgpu_sync_oos_pages(struct intel_vgpu *vgpu)
 		ret = ppgtt_set_guest_page_sync(oos_page->spt);
 		if (ret)
 			return ret;
+
+		/* going out of sync doesn't pay off, trap the page again */
+		if (oos_page->spt->guest_page.idle_syncs >=
+		    GVT_OOS_IDLE_SYNCS) {
+			detach_oos_page(vgpu, oos_page);
+			free_oos_page(vgpu->gvt, oos_page);
+			vgpu->gtt.oos_stats.idle++;
+		}
 	}
 	return 0;
 }
@@ -1847,8 +1978,13 @@ static int ppgtt_handle_guest_write_page_table_bytes(
 				false, 0, vgpu);
 
 	if (can_do_out_of_sync(spt)) {
-		if (!spt->guest_page.oos_page)
-			ppgtt_allocate_oos_page(spt);
+		if (!spt->guest_page.oos_page) {
+			ret = ppgtt_allocate_oos_page(spt);
+			if (ret == -ENOSPC)
+				return 0;
+			if (ret)
+				return ret;
+		}
 
 		ret = ppgtt_set_guest_page_oos(spt);
 		if (ret < 0)
@@ -2041,6 +2177,7 @@ struct intel_vgpu_mm *intel_vgpu_create_ppgtt_mm(struct intel_vgpu *vgpu,
 
 	INIT_LIST_HEAD(&mm->ppgtt_mm.list);
 	INIT_LIST_HEAD(&mm->ppgtt_mm.lru_list);
+	INIT_LIST_HEAD(&mm->ppgtt_mm.cache_list);
 
 	if (root_entry_type == GTT_TYPE_PPGTT_ROOT_L4_ENTRY)
 		mm->ppgtt_mm.guest_pdps[0] = pdps[0];
@@ -2107,6 +2244,10 @@ void _intel_vgpu_mm_release(struct kref *mm_ref)
 	if (mm->type == INTEL_GVT_MM_PPGTT) {
 		list_del(&mm->ppgtt_mm.list);
 		list_del(&mm->ppgtt_mm.lru_list);
+		if (!list_empty(&mm->ppgtt_mm.cache_list)) {
+			list_del(&mm->ppgtt_mm.cache_list);
+			mm->vgpu->gtt.nr_cached_ppgtt_mm--;
+		}
 		invalidate_ppgtt_mm(mm);
 	} else {
 		if (mm->ggtt_mm.virtual_ggtt) {
@@ -2167,6 +2308,17 @@ int intel_vgpu_pin_mm(struct intel_vgpu_mm *mm)
 	return 0;
 }
 
+/* Drop the reference the cache of destroyed ppgtt mm holds, if any. */
+static void uncache_ppgtt_mm(struct intel_vgpu_mm *mm)
+{
+	if (list_empty(&mm->ppgtt_mm.cache_list))
+		return;
+
+	list_del_init(&mm->ppgtt_mm.cache_list);
+	mm->vgpu->gtt.nr_cached_ppgtt_mm--;
+	intel_vgpu_mm_put(mm);
+}
+
 static int reclaim_one_ppgtt_mm(struct intel_gvt *gvt)
 {
 	struct intel_vgpu_mm *mm;
@@ -2180,6 +2332,8 @@ static int reclaim_one_ppgtt_mm(struct intel_gvt *gvt)
 
 		list_del_init(&mm->ppgtt_mm.lru_list);
 		invalidate_ppgtt_mm(mm);
+		/* nothing left worth caching */
+		uncache_ppgtt_mm(mm);
 		return 1;
 	}
 	return 0;
@@ -2346,6 +2500,32 @@ static void ggtt_invalidate_pte(struct intel_vgpu *vgpu,
 						pfn << PAGE_SHIFT);
 }
 
+/*
+ * Bound on the host GGTT PTEs a vGPU may leave behind the TLB before an
+ * invalidate is forced, i.e. 2MB worth of guest mappings.
+ */
+#define GVT_GGTT_INVALIDATE_BATCH	512
+
+/**
+ * intel_vgpu_flush_ggtt_invalidate - invalidate deferred GGTT updates
+ * @vgpu: a vGPU
+ *
+ * Trapped guest GGTT PTE writes only update the host GGTT, the invalidate
+ * is deferred until the guest does anything which could observe the new
+ * entries: any other MMIO access (its own GFX_FLSH_CNTL write included)
+ * or a workload dispatch. Called with vgpu_lock held.
+ */
+void intel_vgpu_flush_ggtt_invalidate(struct intel_vgpu *vgpu)
+{
+	struct intel_vgpu_mm *ggtt_mm = vgpu->gtt.ggtt_mm;
+
+	if (!ggtt_mm || !ggtt_mm->ggtt_mm.nr_pending_invalidate)
+		return;
+
+	ggtt_mm->ggtt_mm.nr_pending_invalidate = 0;
+	ggtt_invalidate(vgpu->gvt->dev_priv);
+}
+
 static int emulate_ggtt_mmio_write(struct intel_vgpu *vgpu, unsigned int off,
 	void *p_data, unsigned int bytes)
 {
@@ -2416,6 +2596,7 @@ static int emulate_ggtt_mmio_write(struct intel_vgpu *vgpu, unsigned int off,
 			ops->set_pfn(&m, gvt->gtt.scratch_mfn);
 			ops->clear_present(&m);
 			ggtt_set_host_entry(ggtt_mm, &m, last_offset);
+			ggtt_mm->ggtt_mm.nr_pending_invalidate = 0;
 			ggtt_invalidate(gvt->dev_priv);
 
 			ggtt_get_guest_entry(ggtt_mm, &e, last_offset);
@@ -2461,7 +2642,9 @@ static int emulate_ggtt_mmio_write(struct intel_vgpu *vgpu, unsigned int off,
 
 out:
 	ggtt_set_host_entry(ggtt_mm, &m, g_gtt_index);
-	ggtt_invalidate(gvt->dev_priv);
+	if (++ggtt_mm->ggtt_mm.nr_pending_invalidate >=
+			GVT_GGTT_INVALIDATE_BATCH)
+		intel_vgpu_flush_ggtt_invalidate(vgpu);
 	ggtt_set_guest_entry(ggtt_mm, &e, g_gtt_index);
 	return 0;
 }
@@ -2609,9 +2792,14 @@ int intel_vgpu_init_gtt(struct intel_vgpu *vgpu)
 	INIT_RADIX_TREE(&gtt->spt_tree, GFP_KERNEL);
 
 	INIT_LIST_HEAD(&gtt->ppgtt_mm_list_head);
+	INIT_LIST_HEAD(&gtt->ppgtt_mm_cache_head);
 	INIT_LIST_HEAD(&gtt->oos_page_list_head);
+	INIT_LIST_HEAD(&gtt->oos_page_use_list_head);
 	INIT_LIST_HEAD(&gtt->post_shadow_list_head);
 
+	/* a single vGPU may not take the whole oos page pool */
+	gtt->oos_quota = vgpu->gvt->gtt.max_oos_pages / 2;
+
 	gtt->ggtt_mm = intel_vgpu_create_ggtt_mm(vgpu);
 	if (IS_ERR(gtt->ggtt_mm)) {
 		gvt_vgpu_err("fail to create mm for ggtt.\n");
@@ -2635,6 +2823,12 @@ static void intel_vgpu_destroy_all_ppgtt_mm(struct intel_vgpu *vgpu)
 	struct list_head *pos, *n;
 	struct intel_vgpu_mm *mm;
 
+	list_for_each_safe(pos, n, &vgpu->gtt.ppgtt_mm_cache_head) {
+		mm = container_of(pos, struct intel_vgpu_mm,
+				  ppgtt_mm.cache_list);
+		uncache_ppgtt_mm(mm);
+	}
+
 	list_for_each_safe(pos, n, &vgpu->gtt.ppgtt_mm_list_head) {
 		mm = container_of(pos, struct intel_vgpu_mm, ppgtt_mm.list);
 		intel_vgpu_destroy_mm(mm);
@@ -2651,6 +2845,7 @@ static void intel_vgpu_destroy_all_ppgtt_mm(struct intel_vgpu *vgpu)
 
 static void intel_vgpu_destroy_ggtt_mm(struct intel_vgpu *vgpu)
 {
+	intel_vgpu_flush_ggtt_invalidate(vgpu);
 	intel_vgpu_destroy_mm(vgpu->gtt.ggtt_mm);
 	vgpu->gtt.ggtt_mm = NULL;
 }
@@ -2679,7 +2874,7 @@ static void clean_spt_oos(struct intel_gvt *gvt)
 	struct list_head *pos, *n;
 	struct intel_vgpu_oos_page *oos_page;
 
-	WARN(!list_empty(&gtt->oos_page_use_list_head),
+	WARN(gtt->nr_oos_pages != gtt->nr_free_oos_pages,
 		"someone is still using oos page\n");
 
 	list_for_each_safe(pos, n, &gtt->oos_page_free_list_head) {
@@ -2687,6 +2882,8 @@ static void clean_spt_oos(struct intel_gvt *gvt)
 		list_del(&oos_page->list);
 		kfree(oos_page);
 	}
+	gtt->nr_oos_pages -= gtt->nr_free_oos_pages;
+	gtt->nr_free_oos_pages = 0;
 }
 
 static int setup_spt_oos(struct intel_gvt *gvt)
@@ -2696,10 +2893,17 @@ static int setup_spt_oos(struct intel_gvt *gvt)
 	int i;
 	int ret;
 
+	spin_lock_init(&gtt->oos_lock);
 	INIT_LIST_HEAD(&gtt->oos_page_free_list_head);
-	INIT_LIST_HEAD(&gtt->oos_page_use_list_head);
+	gtt->nr_oos_pages = 0;
+	gtt->nr_free_oos_pages = 0;
 
-	for (i = 0; i < preallocated_oos_pages; i++) {
+	/* each oos page takes two pages from the slab, spend 1/64 of RAM */
+	gtt->max_oos_pages = min_t(unsigned long, max_oos_pages,
+				   totalram_pages >> 7);
+
+	for (i = 0; i < min_t(u32, preallocated_oos_pages,
+			      gtt->max_oos_pages); i++) {
 		oos_page = kzalloc(sizeof(*oos_page), GFP_KERNEL);
 		if (!oos_page) {
 			ret = -ENOMEM;
@@ -2710,9 +2914,13 @@ static int setup_spt_oos(struct intel_gvt *gvt)
 		INIT_LIST_HEAD(&oos_page->vm_list);
 		oos_page->id = i;
 		list_add_tail(&oos_page->list, &gtt->oos_page_free_list_head);
+		gtt->nr_oos_pages++;
+		gtt->nr_free_oos_pages++;
 	}
+	gtt->oos_page_id = i;
 
-	gvt_dbg_mm("%d oos pages preallocated\n", i);
+	gvt_dbg_mm("%d oos pages preallocated, up to %u\n", i,
+		   gtt->max_oos_pages);
 
 	return 0;
 fail:
@@ -2757,6 +2965,40 @@ struct intel_vgpu_mm *intel_vgpu_find_ppgtt_mm(struct intel_vgpu *vgpu,
 	return NULL;
 }
 
+/*
+ * Guests tend to destroy and recreate contexts with the same page tables,
+ * so the shadow of a ppgtt mm destroyed by the guest is kept, with its
+ * page tables still write protected, until the guest creates it again or
+ * GVT_PPGTT_MM_CACHE_SIZE more recently destroyed ones are kept. The
+ * cache holds a reference of its own on the mm. Under memory pressure
+ * the shadow is reclaimed like the one of any other unpinned mm.
+ */
+#define GVT_PPGTT_MM_CACHE_SIZE 4
+
+static void cache_ppgtt_mm(struct intel_vgpu_mm *mm)
+{
+	struct intel_vgpu_gtt *gtt = &mm->vgpu->gtt;
+	struct intel_vgpu_mm *oldest;
+
+	/* PV ppgtt is managed by guest, its mappings can't be kept */
+	if (VGPU_PVMMIO(mm->vgpu) & PVMMIO_PPGTT_UPDATE)
+		return;
+
+	if (!mm->ppgtt_mm.shadowed || !list_empty(&mm->ppgtt_mm.cache_list))
+		return;
+
+	intel_vgpu_mm_get(mm);
+	list_add_tail(&mm->ppgtt_mm.cache_list, &gtt->ppgtt_mm_cache_head);
+	gtt->nr_cached_ppgtt_mm++;
+
+	if (gtt->nr_cached_ppgtt_mm > GVT_PPGTT_MM_CACHE_SIZE) {
+		oldest = list_first_entry(&gtt->ppgtt_mm_cache_head,
+					  struct intel_vgpu_mm,
+					  ppgtt_mm.cache_list);
+		uncache_ppgtt_mm(oldest);
+	}
+}
+
 /**
  * intel_vgpu_get_ppgtt_mm - get or create a PPGTT mm object.
  * @vgpu: a vGPU
@@ -2776,6 +3018,9 @@ struct intel_vgpu_mm *intel_vgpu_get_ppgtt_mm(struct intel_vgpu *vgpu,
 	mm = intel_vgpu_find_ppgtt_mm(vgpu, pdps);
 	if (mm) {
 		intel_vgpu_mm_get(mm);
+
+		/* root pointer reused by guest, no longer cached */
+		uncache_ppgtt_mm(mm);
 	} else {
 		mm = intel_vgpu_create_ppgtt_mm(vgpu, root_entry_type, pdps);
 		if (IS_ERR(mm))
@@ -2803,6 +3048,7 @@ int intel_vgpu_put_ppgtt_mm(struct intel_vgpu *vgpu, u64 pdps[])
 		gvt_vgpu_err("fail to find ppgtt instance.\n");
 		return -EINVAL;
 	}
+	cache_ppgtt_mm(mm);
 	intel_vgpu_mm_put(mm);
 	return 0;
 }
@@ -2945,6 +3191,7 @@ void intel_vgpu_reset_ggtt(struct intel_vgpu *vgpu, bool invalidate_old)
 		ggtt_set_host_entry(vgpu->gtt.ggtt_mm, &entry, index++);
 	}
 
+	vgpu->gtt.ggtt_mm->ggtt_mm.nr_pending_invalidate = 0;
 	ggtt_invalidate(dev_priv);
 }
 
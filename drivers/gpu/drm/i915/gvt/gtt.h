@@ -87,8 +87,13 @@ struct intel_gvt_gtt {
 	struct intel_gvt_gtt_gma_ops *gma_ops;
 	int (*mm_alloc_page_table)(struct intel_vgpu_mm *mm);
 	void (*mm_free_page_table)(struct intel_vgpu_mm *mm);
-	struct list_head oos_page_use_list_head;
+	/* protects the oos page pool shared by all vGPUs */
+	spinlock_t oos_lock;
 	struct list_head oos_page_free_list_head;
+	u32 nr_oos_pages;
+	u32 nr_free_oos_pages;
+	u32 max_oos_pages;
+	int oos_page_id;
 	struct list_head ppgtt_mm_lru_list_head;
 
 	struct page *scratch_page;
@@ -154,12 +159,16 @@ struct intel_vgpu_mm {
 
 			struct list_head list;
 			struct list_head lru_list;
+			/* link in cache of ppgtt mm destroyed by guest */
+			struct list_head cache_list;
 			struct i915_hw_ppgtt *ppgtt;
 		} ppgtt_mm;
 		struct {
 			void *virtual_ggtt;
 			unsigned long last_partial_off;
 			u64 last_partial_data;
+			/* host PTEs written since the last GGTT invalidate */
+			unsigned int nr_pending_invalidate;
 		} ggtt_mm;
 	};
 };
@@ -191,12 +200,28 @@ struct intel_vgpu_scratch_pt {
 	unsigned long page_mfn;
 };
 
+struct intel_vgpu_oos_stats {
+	unsigned long attach;	/* oos page attached to a guest page */
+	unsigned long evict;	/* oos page taken from a colder guest page */
+	unsigned long idle;	/* oos page released by an idle guest page */
+	unsigned long trap;	/* no oos page available, keep trapping */
+	unsigned long sync;	/* out-of-sync guest page synced */
+};
+
 struct intel_vgpu_gtt {
 	struct intel_vgpu_mm *ggtt_mm;
 	unsigned long active_ppgtt_mm_bitmap;
 	struct list_head ppgtt_mm_list_head;
+	/* ppgtt mm destroyed by guest, kept shadowed for reuse */
+	struct list_head ppgtt_mm_cache_head;
+	int nr_cached_ppgtt_mm;
 	struct radix_tree_root spt_tree;
 	struct list_head oos_page_list_head;
+	/* oos pages attached to spt of this vGPU, oldest first */
+	struct list_head oos_page_use_list_head;
+	u32 nr_oos_pages;
+	u32 oos_quota;
+	struct intel_vgpu_oos_stats oos_stats;
 	struct list_head post_shadow_list_head;
 	struct intel_vgpu_scratch_pt scratch_pt[GTT_TYPE_MAX];
 
@@ -244,6 +269,7 @@ struct intel_vgpu_ppgtt_spt {
 		bool pde_ips; /* for 64KB PTEs */
 		unsigned long gfn;
 		unsigned long write_cnt;
+		unsigned int idle_syncs;
 		struct intel_vgpu_oos_page *oos_page;
 	} guest_page;
 
@@ -285,6 +311,8 @@ int intel_vgpu_g2v_pv_ppgtt_clear_4lvl(struct intel_vgpu *vgpu,
 int intel_vgpu_g2v_pv_ppgtt_insert_4lvl(struct intel_vgpu *vgpu,
 		int page_table_level);
 
+void intel_vgpu_flush_ggtt_invalidate(struct intel_vgpu *vgpu);
+
 int intel_vgpu_g2v_pv_ggtt_insert(struct intel_vgpu *vgpu);
 
 int intel_vgpu_g2v_pv_ggtt_clear(struct intel_vgpu *vgpu);
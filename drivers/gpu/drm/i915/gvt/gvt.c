@@ -186,6 +186,9 @@ static const struct intel_gvt_ops intel_gvt_ops = {
 	.vgpu_query_plane = intel_vgpu_query_plane,
 	.vgpu_get_dmabuf = intel_vgpu_get_dmabuf,
 	.write_protect_handler = intel_vgpu_page_track_handler,
+	.set_sched_policy = intel_gvt_set_sched_policy,
+	.get_sched_policy = intel_gvt_get_sched_policy,
+	.vgpu_set_latency_target = intel_vgpu_set_latency_target,
 };
 
 /**
@@ -446,6 +449,10 @@ int intel_gvt_init_device(struct drm_i915_private *dev_priv)
 	if (ret)
 		goto out_clean_mmio_info;
 
+	ret = intel_gvt_init_mmio_template(gvt);
+	if (ret)
+		goto out_free_firmware;
+
 	ret = intel_gvt_init_irq(gvt);
 	if (ret)
 		goto out_free_firmware;
@@ -549,6 +556,41 @@ int intel_gvt_init_device(struct drm_i915_private *dev_priv)
 	return ret;
 }
 
+/**
+ * intel_gvt_vgpu_context - look up the shadow context of a vGPU
+ * @dev_priv: drm i915 private data
+ * @vgpu_id: id of the vGPU
+ *
+ * All workloads of a vGPU are submitted to the host through its shadow
+ * context, so this is what the host needs to filter OA reports and other
+ * per-context state on to attribute them to a single guest.
+ *
+ * Returns:
+ * A new reference to the shadow context, or NULL if no such vGPU exists.
+ */
+struct i915_gem_context *
+intel_gvt_vgpu_context(struct drm_i915_private *dev_priv, unsigned int vgpu_id)
+{
+	struct intel_gvt *gvt = to_gvt(dev_priv);
+	struct i915_gem_context *ctx = NULL;
+	struct intel_vgpu *vgpu;
+
+	if (!intel_gvt_active(dev_priv))
+		return NULL;
+
+	mutex_lock(&gvt->lock);
+	vgpu = idr_find(&gvt->vgpu_idr, vgpu_id);
+	if (vgpu) {
+		mutex_lock(&vgpu->vgpu_lock);
+		if (vgpu->submission.shadow_ctx)
+			ctx = i915_gem_context_get(vgpu->submission.shadow_ctx);
+		mutex_unlock(&vgpu->vgpu_lock);
+	}
+	mutex_unlock(&gvt->lock);
+
+	return ctx;
+}
+
 int gvt_dom0_ready(struct drm_i915_private *dev_priv)
 {
 	if (!intel_gvt_active(dev_priv))
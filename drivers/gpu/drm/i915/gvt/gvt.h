@@ -125,6 +125,16 @@ struct intel_vgpu_irq {
 	bool irq_warn_once[INTEL_GVT_EVENT_MAX];
 	DECLARE_BITMAP(flip_done_event[INTEL_GVT_MAX_PIPE],
 		       INTEL_GVT_EVENT_MAX);
+	/*
+	 * GT events are held back for up to coalesce_us, or until
+	 * coalesce_count of them are pending, before the MSI is injected.
+	 * A zero coalesce_us disables coalescing.
+	 */
+	u32 coalesce_us;
+	u32 coalesce_count;
+	atomic_t nr_coalesced;
+	struct hrtimer coalesce_timer;
+	struct work_struct coalesce_work;
 };
 
 struct intel_vgpu_opregion {
@@ -139,10 +149,20 @@ struct intel_vgpu_display {
 	struct intel_vgpu_i2c_edid i2c_edid;
 	struct intel_vgpu_port ports[I915_MAX_PORTS];
 	struct intel_vgpu_sbi sbi;
+	/*
+	 * in us, how far the emulated vblanks trail the host pipe's,
+	 * 0 to forward host vblanks right away
+	 */
+	u32 vblank_offset;
+	unsigned long vblank_pending;
+	struct hrtimer vblank_timer;
+	struct work_struct vblank_work;
 };
 
 struct vgpu_sched_ctl {
 	int weight;
+	/* in us, used by deadline policy */
+	unsigned int latency_target;
 };
 
 enum {
@@ -167,11 +187,36 @@ struct intel_vgpu_submission {
 	DECLARE_BITMAP(tlb_handle_pending, I915_NUM_ENGINES);
 	void *ring_scan_buffer[I915_NUM_ENGINES];
 	int ring_scan_buffer_size[I915_NUM_ENGINES];
+	/* scanned batch buffers, most recently used first */
+	struct list_head bb_cache;
+	unsigned int nr_bb_cache;
 	const struct intel_vgpu_submission_ops *ops;
 	int virtual_submission_interface;
 	bool active;
 };
 
+/* MMIO trap classes accounted in intel_vgpu_stats */
+enum intel_vgpu_mmio_class {
+	GVT_MMIO_CLASS_GT = 0,
+	GVT_MMIO_CLASS_DISPLAY,
+	GVT_MMIO_CLASS_PVINFO,
+	GVT_MMIO_CLASS_GGTT,
+	GVT_MMIO_CLASS_NUM,
+};
+
+/*
+ * Per-vGPU counters exposed through debugfs, all updated under vgpu_lock.
+ * ring_busy_ns is the time from handing a workload to i915 until its
+ * completion, so it includes time spent queued behind other contexts.
+ */
+struct intel_vgpu_stats {
+	u64 mmio_trap[GVT_MMIO_CLASS_NUM];
+	u64 wp_fault;
+	u64 workloads;
+	u64 scan_ns;
+	u64 ring_busy_ns[I915_NUM_ENGINES];
+};
+
 struct intel_vgpu {
 	struct intel_gvt *gvt;
 	struct mutex vgpu_lock;
@@ -199,7 +244,9 @@ struct intel_vgpu {
 	struct intel_vgpu_display display;
 	struct intel_vgpu_submission submission;
 	struct radix_tree_root page_track_tree;
+	struct rb_root_cached page_track_ranges;
 	u32 hws_pga[I915_NUM_ENGINES];
+	struct intel_vgpu_stats stats;
 
 	struct dentry *debugfs;
 
@@ -231,6 +278,7 @@ struct intel_vgpu {
 
 	struct list_head dmabuf_obj_list_head;
 	struct mutex dmabuf_lock;
+	unsigned int nr_cached_dmabuf_gem;
 	struct idr object_idr;
 
 	struct completion vblank_done;
@@ -294,6 +342,8 @@ struct intel_gvt_mmio {
 struct intel_gvt_firmware {
 	void *cfg_space;
 	void *mmio;
+	/* mmio with the vGPU reset fixups applied, copied into new vGPUs */
+	void *mmio_template;
 	bool firmware_loaded;
 };
 
@@ -338,7 +388,7 @@ struct intel_gvt {
 	struct intel_gvt_gtt gtt;
 	struct intel_gvt_workload_scheduler scheduler;
 	struct notifier_block shadow_ctx_notifier_block[I915_NUM_ENGINES];
-	DECLARE_HASHTABLE(cmd_table, GVT_CMD_HASH_BITS);
+	u16 *cmd_table[I915_NUM_ENGINES][GVT_CMD_TYPE_NUM];
 	struct intel_vgpu_type *types;
 	unsigned int num_types;
 	struct intel_vgpu *idle_vgpu;
@@ -607,6 +657,10 @@ struct intel_gvt_ops {
 	int (*vgpu_get_dmabuf)(struct intel_vgpu *vgpu, unsigned int);
 	int (*write_protect_handler)(struct intel_vgpu *, u64, void *,
 				     unsigned int);
+	int (*set_sched_policy)(struct intel_gvt *gvt, const char *name);
+	const char *(*get_sched_policy)(struct intel_gvt *gvt);
+	void (*vgpu_set_latency_target)(struct intel_vgpu *vgpu,
+					unsigned int target_us);
 };
 
 int gvt_dom0_ready(struct drm_i915_private *dev_priv);
@@ -1768,7 +1768,10 @@ static int elsp_mmio_write(struct intel_vgpu *vgpu, unsigned int offset,
 
 	execlist = &vgpu->submission.execlist[ring_id];
 
-	if (VGPU_PVMMIO(vgpu) & PVMMIO_ELSP_SUBMIT) {
+	if (VGPU_PVMMIO(vgpu) & PVMMIO_PV_SUBMIT) {
+		/* a kick, the descriptors are in the pv submission ring */
+		ret = intel_vgpu_pv_submit(vgpu, ring_id);
+	} else if (VGPU_PVMMIO(vgpu) & PVMMIO_ELSP_SUBMIT) {
 		execlist->elsp_dwords.data[3] = elsp_data[0];
 		execlist->elsp_dwords.data[2] = elsp_data[1];
 		execlist->elsp_dwords.data[1] = elsp_data[2];
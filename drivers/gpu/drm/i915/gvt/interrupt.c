@@ -628,6 +628,40 @@ static struct intel_gvt_irq_ops gen8_irq_ops = {
  * will emulate the IRQ register bit change.
  *
  */
+/*
+ * Decide whether the MSI for @event can wait. Only GT (engine) events
+ * are coalesced, anything else, vblank and flip done in particular,
+ * injects right away together with whatever GT event is held back.
+ */
+static bool coalesce_event(struct intel_vgpu *vgpu,
+	enum intel_gvt_event_type event)
+{
+	struct intel_gvt_irq_info *info = vgpu->gvt->irq.events[event].info;
+	struct intel_vgpu_irq *virq = &vgpu->irq;
+	u32 coalesce_us = READ_ONCE(virq->coalesce_us);
+	u32 coalesce_count = READ_ONCE(virq->coalesce_count);
+	int pending;
+
+	if (!info || info->group < INTEL_GVT_IRQ_INFO_GT0 ||
+	    info->group > INTEL_GVT_IRQ_INFO_GT3 || !coalesce_us)
+		goto inject;
+
+	pending = atomic_inc_return(&virq->nr_coalesced);
+	if (coalesce_count && pending >= coalesce_count)
+		goto inject;
+
+	if (pending == 1)
+		hrtimer_start(&virq->coalesce_timer,
+			      ktime_set(0, coalesce_us * NSEC_PER_USEC),
+			      HRTIMER_MODE_REL);
+	return true;
+
+inject:
+	if (atomic_xchg(&virq->nr_coalesced, 0))
+		hrtimer_try_to_cancel(&virq->coalesce_timer);
+	return false;
+}
+
 void intel_vgpu_trigger_virtual_event(struct intel_vgpu *vgpu,
 	enum intel_gvt_event_type event)
 {
@@ -641,9 +675,61 @@ void intel_vgpu_trigger_virtual_event(struct intel_vgpu *vgpu,
 
 	handler(irq, event, vgpu);
 
+	if (coalesce_event(vgpu, event))
+		return;
+
 	ops->check_pending_irq(vgpu);
 }
 
+static void coalesce_work(struct work_struct *w)
+{
+	struct intel_vgpu_irq *virq = container_of(w,
+			struct intel_vgpu_irq, coalesce_work);
+	struct intel_vgpu *vgpu = container_of(virq, struct intel_vgpu, irq);
+
+	mutex_lock(&vgpu->vgpu_lock);
+	if (atomic_xchg(&virq->nr_coalesced, 0) && vgpu->active)
+		vgpu->gvt->irq.ops->check_pending_irq(vgpu);
+	mutex_unlock(&vgpu->vgpu_lock);
+}
+
+static enum hrtimer_restart coalesce_timer_fn(struct hrtimer *data)
+{
+	struct intel_vgpu_irq *virq = container_of(data,
+			struct intel_vgpu_irq, coalesce_timer);
+
+	queue_work(system_highpri_wq, &virq->coalesce_work);
+	return HRTIMER_NORESTART;
+}
+
+/**
+ * intel_vgpu_init_irq - initialize the interrupt coalescing of a vGPU
+ * @vgpu: a vGPU
+ *
+ * Coalescing starts disabled, it's tuned per vGPU through debugfs.
+ */
+void intel_vgpu_init_irq(struct intel_vgpu *vgpu)
+{
+	struct intel_vgpu_irq *virq = &vgpu->irq;
+
+	atomic_set(&virq->nr_coalesced, 0);
+	hrtimer_init(&virq->coalesce_timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+	virq->coalesce_timer.function = coalesce_timer_fn;
+	INIT_WORK(&virq->coalesce_work, coalesce_work);
+}
+
+/**
+ * intel_vgpu_clean_irq - stop the interrupt coalescing of a vGPU
+ * @vgpu: a vGPU
+ *
+ * Called without vgpu_lock held, once no more events can be triggered.
+ */
+void intel_vgpu_clean_irq(struct intel_vgpu *vgpu)
+{
+	hrtimer_cancel(&vgpu->irq.coalesce_timer);
+	cancel_work_sync(&vgpu->irq.coalesce_work);
+}
+
 static void init_events(
 	struct intel_gvt_irq *irq)
 {
@@ -218,6 +218,8 @@ struct intel_gvt_irq {
 
 int intel_gvt_init_irq(struct intel_gvt *gvt);
 void intel_gvt_clean_irq(struct intel_gvt *gvt);
+void intel_vgpu_init_irq(struct intel_vgpu *vgpu);
+void intel_vgpu_clean_irq(struct intel_vgpu *vgpu);
 
 void intel_vgpu_trigger_virtual_event(struct intel_vgpu *vgpu,
 	enum intel_gvt_event_type event);
@@ -88,6 +88,26 @@ static void failsafe_emulate_mmio_rw(struct intel_vgpu *vgpu, uint64_t pa,
 	mutex_unlock(&vgpu->vgpu_lock);
 }
 
+/* registers below this offset belong to the GT, the rest to display/PCH */
+#define GVT_MMIO_GT_END 0x40000
+
+static void account_mmio_trap(struct intel_vgpu *vgpu, unsigned int offset)
+{
+	enum intel_vgpu_mmio_class class;
+
+	if (reg_is_gtt(vgpu->gvt, offset))
+		class = GVT_MMIO_CLASS_GGTT;
+	else if (offset >= VGT_PVINFO_PAGE &&
+		 offset < VGT_PVINFO_PAGE + VGT_PVINFO_SIZE)
+		class = GVT_MMIO_CLASS_PVINFO;
+	else if (offset < GVT_MMIO_GT_END)
+		class = GVT_MMIO_CLASS_GT;
+	else
+		class = GVT_MMIO_CLASS_DISPLAY;
+
+	vgpu->stats.mmio_trap[class]++;
+}
+
 /**
  * intel_vgpu_emulate_mmio_read - emulate MMIO read
  * @vgpu: a vGPU
@@ -112,6 +132,7 @@ int intel_vgpu_emulate_mmio_read(struct intel_vgpu *vgpu, uint64_t pa,
 	mutex_lock(&vgpu->vgpu_lock);
 
 	offset = intel_vgpu_gpa_to_mmio_offset(vgpu, pa);
+	account_mmio_trap(vgpu, offset);
 
 	if (WARN_ON(bytes > 8))
 		goto err;
@@ -136,6 +157,8 @@ int intel_vgpu_emulate_mmio_read(struct intel_vgpu *vgpu, uint64_t pa,
 		goto out;
 	}
 
+	intel_vgpu_flush_ggtt_invalidate(vgpu);
+
 	if (WARN_ON(!reg_is_mmio(gvt, offset + bytes - 1)))
 		goto err;
 
@@ -185,6 +208,7 @@ int intel_vgpu_emulate_mmio_write(struct intel_vgpu *vgpu, uint64_t pa,
 	mutex_lock(&vgpu->vgpu_lock);
 
 	offset = intel_vgpu_gpa_to_mmio_offset(vgpu, pa);
+	account_mmio_trap(vgpu, offset);
 
 	if (WARN_ON(bytes > 8))
 		goto err;
@@ -209,6 +233,8 @@ int intel_vgpu_emulate_mmio_write(struct intel_vgpu *vgpu, uint64_t pa,
 		goto out;
 	}
 
+	intel_vgpu_flush_ggtt_invalidate(vgpu);
+
 	ret = intel_vgpu_mmio_reg_rw(vgpu, offset, p_data, bytes, false);
 	if (ret < 0)
 		goto err;
@@ -225,6 +251,72 @@ int intel_vgpu_emulate_mmio_write(struct intel_vgpu *vgpu, uint64_t pa,
 }
 
 
+#define template_reg(t, reg) (*(u32 *)((t) + i915_mmio_reg_offset(reg)))
+
+/**
+ * intel_gvt_init_mmio_template - prepare the MMIO state of new vGPUs
+ * @gvt: a GVT device
+ *
+ * The MMIO state of a vGPU after a device model reset only differs from
+ * the firmware snapshot by a fixed set of registers. Apply those fixups
+ * once here, so creating or resetting a vGPU is a plain copy of the
+ * template. Only HUC_STATUS2 is still read from the hardware per vGPU.
+ *
+ * Returns:
+ * Zero on success, negative error code if failed
+ */
+int intel_gvt_init_mmio_template(struct intel_gvt *gvt)
+{
+	const struct intel_gvt_device_info *info = &gvt->device_info;
+	void *t;
+
+	t = vmalloc(info->mmio_size);
+	if (!t)
+		return -ENOMEM;
+
+	memcpy(t, gvt->firmware.mmio, info->mmio_size);
+
+	template_reg(t, GEN6_GT_THREAD_STATUS_REG) = 0;
+
+	/* set the bit 0:2(Core C-State ) to C0 */
+	template_reg(t, GEN6_GT_CORE_STATUS) = 0;
+
+	if (IS_BROXTON(gvt->dev_priv)) {
+		template_reg(t, BXT_P_CR_GT_DISP_PWRON) &= ~(BIT(0) | BIT(1));
+		template_reg(t, BXT_PORT_CL1CM_DW0(DPIO_PHY0)) &=
+			~PHY_POWER_GOOD;
+		template_reg(t, BXT_PORT_CL1CM_DW0(DPIO_PHY1)) &=
+			~PHY_POWER_GOOD;
+		template_reg(t, BXT_PHY_CTL_FAMILY(DPIO_PHY0)) &= ~BIT(30);
+		template_reg(t, BXT_PHY_CTL_FAMILY(DPIO_PHY1)) &= ~BIT(30);
+		template_reg(t, BXT_PHY_CTL(PORT_A)) &= ~BXT_PHY_LANE_ENABLED;
+		template_reg(t, BXT_PHY_CTL(PORT_A)) |=
+			BXT_PHY_CMNLANE_POWERDOWN_ACK |
+			BXT_PHY_LANE_POWERDOWN_ACK;
+		template_reg(t, BXT_PHY_CTL(PORT_B)) &= ~BXT_PHY_LANE_ENABLED;
+		template_reg(t, BXT_PHY_CTL(PORT_B)) |=
+			BXT_PHY_CMNLANE_POWERDOWN_ACK |
+			BXT_PHY_LANE_POWERDOWN_ACK;
+		template_reg(t, BXT_PHY_CTL(PORT_C)) &= ~BXT_PHY_LANE_ENABLED;
+		template_reg(t, BXT_PHY_CTL(PORT_C)) |=
+			BXT_PHY_CMNLANE_POWERDOWN_ACK |
+			BXT_PHY_LANE_POWERDOWN_ACK;
+	}
+
+	/* below vreg init value are got from handler.c,
+	 * which won't change during vgpu life cycle
+	 */
+	*(u32 *)(t + 0xe651c) = 1 << 17;
+	*(u32 *)(t + 0xe661c) = 1 << 17;
+	*(u32 *)(t + 0xe671c) = 1 << 17;
+	*(u32 *)(t + 0xe681c) = 1 << 17;
+	*(u32 *)(t + 0xe6c04) = 3;
+	*(u32 *)(t + 0xe6e1c) = 0x2f << 16;
+
+	gvt->firmware.mmio_template = t;
+	return 0;
+}
+
 /**
  * intel_vgpu_reset_mmio - reset virtual MMIO space
  * @vgpu: a vGPU
@@ -234,45 +326,14 @@ void intel_vgpu_reset_mmio(struct intel_vgpu *vgpu, bool dmlr)
 {
 	struct intel_gvt *gvt = vgpu->gvt;
 	const struct intel_gvt_device_info *info = &gvt->device_info;
-	void  *mmio = gvt->firmware.mmio;
+	void  *mmio = gvt->firmware.mmio_template;
+	/* the fixups only apply to what the guest reads, not to sreg */
+	void  *hw_mmio = gvt->firmware.mmio;
 	struct drm_i915_private *dev_priv = gvt->dev_priv;
 
 	if (dmlr) {
 		memcpy(vgpu->mmio.vreg, mmio, info->mmio_size);
-		memcpy(vgpu->mmio.sreg, mmio, info->mmio_size);
-
-		vgpu_vreg_t(vgpu, GEN6_GT_THREAD_STATUS_REG) = 0;
-
-		/* set the bit 0:2(Core C-State ) to C0 */
-		vgpu_vreg_t(vgpu, GEN6_GT_CORE_STATUS) = 0;
-
-		if (IS_BROXTON(vgpu->gvt->dev_priv)) {
-			vgpu_vreg_t(vgpu, BXT_P_CR_GT_DISP_PWRON) &=
-				    ~(BIT(0) | BIT(1));
-			vgpu_vreg_t(vgpu, BXT_PORT_CL1CM_DW0(DPIO_PHY0)) &=
-				    ~PHY_POWER_GOOD;
-			vgpu_vreg_t(vgpu, BXT_PORT_CL1CM_DW0(DPIO_PHY1)) &=
-				    ~PHY_POWER_GOOD;
-			vgpu_vreg_t(vgpu, BXT_PHY_CTL_FAMILY(DPIO_PHY0)) &=
-				    ~BIT(30);
-			vgpu_vreg_t(vgpu, BXT_PHY_CTL_FAMILY(DPIO_PHY1)) &=
-				    ~BIT(30);
-			vgpu_vreg_t(vgpu, BXT_PHY_CTL(PORT_A)) &=
-				    ~BXT_PHY_LANE_ENABLED;
-			vgpu_vreg_t(vgpu, BXT_PHY_CTL(PORT_A)) |=
-				    BXT_PHY_CMNLANE_POWERDOWN_ACK |
-				    BXT_PHY_LANE_POWERDOWN_ACK;
-			vgpu_vreg_t(vgpu, BXT_PHY_CTL(PORT_B)) &=
-				    ~BXT_PHY_LANE_ENABLED;
-			vgpu_vreg_t(vgpu, BXT_PHY_CTL(PORT_B)) |=
-				    BXT_PHY_CMNLANE_POWERDOWN_ACK |
-				    BXT_PHY_LANE_POWERDOWN_ACK;
-			vgpu_vreg_t(vgpu, BXT_PHY_CTL(PORT_C)) &=
-				    ~BXT_PHY_LANE_ENABLED;
-			vgpu_vreg_t(vgpu, BXT_PHY_CTL(PORT_C)) |=
-				    BXT_PHY_CMNLANE_POWERDOWN_ACK |
-				    BXT_PHY_LANE_POWERDOWN_ACK;
-		}
+		memcpy(vgpu->mmio.sreg, hw_mmio, info->mmio_size);
 	} else {
 #define GVT_GEN8_MMIO_RESET_OFFSET		(0x44200)
 		/* only reset the engine related, so starting with 0x44200
@@ -280,18 +341,18 @@ void intel_vgpu_reset_mmio(struct intel_vgpu *vgpu, bool dmlr)
 		 * touched
 		 */
 		memcpy(vgpu->mmio.vreg, mmio, GVT_GEN8_MMIO_RESET_OFFSET);
-		memcpy(vgpu->mmio.sreg, mmio, GVT_GEN8_MMIO_RESET_OFFSET);
-	}
+		memcpy(vgpu->mmio.sreg, hw_mmio, GVT_GEN8_MMIO_RESET_OFFSET);
 
-	/* below vreg init value are got from handler.c,
-	 * which won't change during vgpu life cycle
-	 */
-	vgpu_vreg(vgpu, 0xe651c) = 1 << 17;
-	vgpu_vreg(vgpu, 0xe661c) = 1 << 17;
-	vgpu_vreg(vgpu, 0xe671c) = 1 << 17;
-	vgpu_vreg(vgpu, 0xe681c) = 1 << 17;
-	vgpu_vreg(vgpu, 0xe6c04) = 3;
-	vgpu_vreg(vgpu, 0xe6e1c) = 0x2f << 16;
+		/* below vreg init value are got from handler.c,
+		 * which won't change during vgpu life cycle
+		 */
+		vgpu_vreg(vgpu, 0xe651c) = 1 << 17;
+		vgpu_vreg(vgpu, 0xe661c) = 1 << 17;
+		vgpu_vreg(vgpu, 0xe671c) = 1 << 17;
+		vgpu_vreg(vgpu, 0xe681c) = 1 << 17;
+		vgpu_vreg(vgpu, 0xe6c04) = 3;
+		vgpu_vreg(vgpu, 0xe6e1c) = 0x2f << 16;
+	}
 
 	if (HAS_HUC_UCODE(dev_priv)) {
 		mmio_hw_access_pre(dev_priv);
@@ -312,24 +373,33 @@ int intel_vgpu_init_mmio(struct intel_vgpu *vgpu)
 	const struct intel_gvt_device_info *info = &vgpu->gvt->device_info;
 
 	BUILD_BUG_ON(sizeof(struct gvt_shared_page) != PAGE_SIZE);
+	BUILD_BUG_ON(I915_NUM_ENGINES > PV_SUBMIT_ENGINES);
 
-	vgpu->mmio.sreg = vzalloc(info->mmio_size);
+	/* both are fully overwritten from the template below */
+	vgpu->mmio.sreg = vmalloc(info->mmio_size);
+	if (!vgpu->mmio.sreg)
+		return -ENOMEM;
 	vgpu->mmio.vreg = (void *)__get_free_pages(GFP_KERNEL,
 			info->mmio_size_order);
 	if (!vgpu->mmio.vreg)
-		return -ENOMEM;
+		goto err_free_sreg;
 
 	vgpu->mmio.shared_page = (struct gvt_shared_page *) __get_free_pages(
 			GFP_KERNEL, 0);
-	if (!vgpu->mmio.shared_page) {
-		vfree(vgpu->mmio.vreg);
-		vgpu->mmio.vreg = NULL;
-		return -ENOMEM;
-	}
+	if (!vgpu->mmio.shared_page)
+		goto err_free_vreg;
 
 	intel_vgpu_reset_mmio(vgpu, true);
 
 	return 0;
+
+err_free_vreg:
+	free_pages((unsigned long)vgpu->mmio.vreg, info->mmio_size_order);
+	vgpu->mmio.vreg = NULL;
+err_free_sreg:
+	vfree(vgpu->mmio.sreg);
+	vgpu->mmio.sreg = NULL;
+	return -ENOMEM;
 }
 
 /**
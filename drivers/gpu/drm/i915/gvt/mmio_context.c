@@ -543,6 +543,11 @@ static void switch_mmio(struct intel_vgpu *pre,
  *
  * If pre is null indicates that host own the engine. If next is null
  * indicates that we are switching to host workload.
+ *
+ * Note the workload scheduler doesn't switch engine mmio on context
+ * schedule in/out, so scheduler.engine_owner is never set. Engine mmio in
+ * the context image follows the shadow context, and inhibit contexts get
+ * it from intel_vgpu_restore_inhibit_context().
  */
 void intel_gvt_switch_mmio(struct intel_vgpu *pre,
 			   struct intel_vgpu *next, int ring_id)
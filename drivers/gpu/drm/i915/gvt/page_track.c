@@ -20,9 +20,21 @@
  * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
  * SOFTWARE.
  */
+#include <linux/interval_tree_generic.h>
+
 #include "i915_drv.h"
 #include "gvt.h"
 
+#define START(track) ((track)->gfn)
+#define LAST(track) ((track)->gfn + (track)->nr_pages - 1)
+
+INTERVAL_TREE_DEFINE(struct intel_vgpu_page_track, rb, unsigned long,
+		     __subtree_last, START, LAST, static, page_track_range)
+
+#undef START
+#undef LAST
+
+
 /**
  * intel_vgpu_find_page_track - find page track rcord of guest page
  * @vgpu: a vGPU
@@ -34,7 +46,14 @@
 struct intel_vgpu_page_track *intel_vgpu_find_page_track(
 		struct intel_vgpu *vgpu, unsigned long gfn)
 {
-	return radix_tree_lookup(&vgpu->page_track_tree, gfn);
+	struct intel_vgpu_page_track *track;
+
+	track = radix_tree_lookup(&vgpu->page_track_tree, gfn);
+	if (track || RB_EMPTY_ROOT(&vgpu->page_track_ranges.rb_root))
+		return track;
+
+	return page_track_range_iter_first(&vgpu->page_track_ranges,
+					   gfn, gfn);
 }
 
 /**
@@ -61,6 +80,8 @@ int intel_vgpu_register_page_track(struct intel_vgpu *vgpu, unsigned long gfn,
 
 	track->handler = handler;
 	track->priv_data = priv;
+	track->gfn = gfn;
+	track->nr_pages = 1;
 
 	ret = radix_tree_insert(&vgpu->page_track_tree, gfn, track);
 	if (ret) {
@@ -103,7 +124,7 @@ int intel_vgpu_enable_page_track(struct intel_vgpu *vgpu, unsigned long gfn)
 	struct intel_vgpu_page_track *track;
 	int ret;
 
-	track = intel_vgpu_find_page_track(vgpu, gfn);
+	track = radix_tree_lookup(&vgpu->page_track_tree, gfn);
 	if (!track)
 		return -ENXIO;
 
@@ -118,7 +139,7 @@ int intel_vgpu_enable_page_track(struct intel_vgpu *vgpu, unsigned long gfn)
 }
 
 /**
- * intel_vgpu_enable_page_track - cancel write-protection on guest page
+ * intel_vgpu_disable_page_track - cancel write-protection on guest page
  * @vgpu: a vGPU
  * @gfn: the gfn of guest page
  *
@@ -130,7 +151,7 @@ int intel_vgpu_disable_page_track(struct intel_vgpu *vgpu, unsigned long gfn)
 	struct intel_vgpu_page_track *track;
 	int ret;
 
-	track = intel_vgpu_find_page_track(vgpu, gfn);
+	track = radix_tree_lookup(&vgpu->page_track_tree, gfn);
 	if (!track)
 		return -ENXIO;
 
@@ -144,6 +165,163 @@ int intel_vgpu_disable_page_track(struct intel_vgpu *vgpu, unsigned long gfn)
 	return 0;
 }
 
+static struct intel_vgpu_page_track *find_page_track_range(
+		struct intel_vgpu *vgpu, unsigned long gfn)
+{
+	struct intel_vgpu_page_track *track;
+
+	track = page_track_range_iter_first(&vgpu->page_track_ranges,
+					    gfn, gfn);
+	if (track && track->gfn == gfn)
+		return track;
+
+	return NULL;
+}
+
+static int set_page_track_range(struct intel_vgpu *vgpu,
+		struct intel_vgpu_page_track *track, bool enable)
+{
+	unsigned long i;
+	int ret = 0;
+
+	for (i = 0; i < track->nr_pages; i++) {
+		if (enable)
+			ret = intel_gvt_hypervisor_enable_page_track(vgpu,
+					track->gfn + i);
+		else
+			ret = intel_gvt_hypervisor_disable_page_track(vgpu,
+					track->gfn + i);
+		if (ret)
+			break;
+	}
+
+	if (ret && enable) {
+		while (i--)
+			intel_gvt_hypervisor_disable_page_track(vgpu,
+					track->gfn + i);
+		return ret;
+	}
+
+	/*
+	 * A failure to drop write-protection on a page only leaves extra
+	 * traps behind, which the handler ignores once the range is gone.
+	 */
+	track->tracked = enable;
+	return ret;
+}
+
+/**
+ * intel_vgpu_register_page_track_range - register contiguous guest pages
+ * to be tracked by a single handler
+ * @vgpu: a vGPU
+ * @gfn: the gfn of the first guest page
+ * @nr_pages: number of guest pages
+ * @handler: the write handler of the range
+ * @priv: private data passed to @handler
+ *
+ * Returns:
+ * zero on success, negative error code if failed.
+ */
+int intel_vgpu_register_page_track_range(struct intel_vgpu *vgpu,
+		unsigned long gfn, unsigned long nr_pages,
+		gvt_page_track_handler_t handler, void *priv)
+{
+	struct intel_vgpu_page_track *track;
+	unsigned long i;
+
+	if (WARN_ON(!nr_pages))
+		return -EINVAL;
+
+	if (page_track_range_iter_first(&vgpu->page_track_ranges,
+					gfn, gfn + nr_pages - 1))
+		return -EEXIST;
+
+	for (i = 0; i < nr_pages; i++)
+		if (radix_tree_lookup(&vgpu->page_track_tree, gfn + i))
+			return -EEXIST;
+
+	track = kzalloc(sizeof(*track), GFP_KERNEL);
+	if (!track)
+		return -ENOMEM;
+
+	track->handler = handler;
+	track->priv_data = priv;
+	track->gfn = gfn;
+	track->nr_pages = nr_pages;
+
+	page_track_range_insert(track, &vgpu->page_track_ranges);
+	return 0;
+}
+
+/**
+ * intel_vgpu_unregister_page_track_range - unregister a tracked range
+ * @vgpu: a vGPU
+ * @gfn: the gfn of the first guest page of the range
+ *
+ */
+void intel_vgpu_unregister_page_track_range(struct intel_vgpu *vgpu,
+		unsigned long gfn)
+{
+	struct intel_vgpu_page_track *track;
+
+	track = find_page_track_range(vgpu, gfn);
+	if (!track)
+		return;
+
+	if (track->tracked)
+		set_page_track_range(vgpu, track, false);
+	page_track_range_remove(track, &vgpu->page_track_ranges);
+	kfree(track);
+}
+
+/**
+ * intel_vgpu_enable_page_track_range - set write-protection on all guest
+ * pages of a tracked range
+ * @vgpu: a vGPU
+ * @gfn: the gfn of the first guest page of the range
+ *
+ * Returns:
+ * zero on success, negative error code if failed.
+ */
+int intel_vgpu_enable_page_track_range(struct intel_vgpu *vgpu,
+		unsigned long gfn)
+{
+	struct intel_vgpu_page_track *track;
+
+	track = find_page_track_range(vgpu, gfn);
+	if (!track)
+		return -ENXIO;
+
+	if (track->tracked)
+		return 0;
+
+	return set_page_track_range(vgpu, track, true);
+}
+
+/**
+ * intel_vgpu_disable_page_track_range - cancel write-protection on all
+ * guest pages of a tracked range
+ * @vgpu: a vGPU
+ * @gfn: the gfn of the first guest page of the range
+ *
+ * Returns:
+ * zero on success, negative error code if failed.
+ */
+int intel_vgpu_disable_page_track_range(struct intel_vgpu *vgpu,
+		unsigned long gfn)
+{
+	struct intel_vgpu_page_track *track;
+
+	track = find_page_track_range(vgpu, gfn);
+	if (!track)
+		return -ENXIO;
+
+	if (!track->tracked)
+		return 0;
+
+	return set_page_track_range(vgpu, track, false);
+}
+
 /**
  * intel_vgpu_page_track_handler - called when write to write-protected page
  * @vgpu: a vGPU
@@ -168,9 +346,14 @@ int intel_vgpu_page_track_handler(struct intel_vgpu *vgpu, u64 gpa,
 		goto out;
 	}
 
+	vgpu->stats.wp_fault++;
+
 	if (unlikely(vgpu->failsafe)) {
 		/* Remove write protection to prevent furture traps. */
-		intel_vgpu_disable_page_track(vgpu, gpa >> PAGE_SHIFT);
+		if (page_track->nr_pages > 1)
+			set_page_track_range(vgpu, page_track, false);
+		else
+			intel_vgpu_disable_page_track(vgpu, gpa >> PAGE_SHIFT);
 	} else {
 		ret = page_track->handler(page_track, gpa, data, bytes);
 		if (ret)
@@ -181,3 +364,38 @@ int intel_vgpu_page_track_handler(struct intel_vgpu *vgpu, u64 gpa,
 	mutex_unlock(&vgpu->vgpu_lock);
 	return ret;
 }
+
+/**
+ * intel_vgpu_init_page_track - initialize page track of a vGPU
+ * @vgpu: a vGPU
+ *
+ */
+void intel_vgpu_init_page_track(struct intel_vgpu *vgpu)
+{
+	INIT_RADIX_TREE(&vgpu->page_track_tree, GFP_KERNEL);
+	vgpu->page_track_ranges = RB_ROOT_CACHED;
+}
+
+/**
+ * intel_vgpu_clean_page_track - drop all page track records of a vGPU
+ * @vgpu: a vGPU
+ *
+ * Write-protection is removed from every page still tracked, so that the
+ * whole set can be torn down in one pass when the vGPU goes away.
+ */
+void intel_vgpu_clean_page_track(struct intel_vgpu *vgpu)
+{
+	struct intel_vgpu_page_track *track;
+	struct radix_tree_iter iter;
+	void __rcu **slot;
+
+	radix_tree_for_each_slot(slot, &vgpu->page_track_tree, &iter, 0) {
+		intel_vgpu_unregister_page_track(vgpu, iter.index);
+		/* the delete may have freed the node the iterator is on */
+		slot = radix_tree_iter_resume(slot, &iter);
+	}
+
+	while ((track = page_track_range_iter_first(&vgpu->page_track_ranges,
+						    0, ULONG_MAX)))
+		intel_vgpu_unregister_page_track_range(vgpu, track->gfn);
+}
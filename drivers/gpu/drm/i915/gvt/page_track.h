@@ -31,11 +31,20 @@ typedef int (*gvt_page_track_handler_t)(
 			struct intel_vgpu_page_track *page_track,
 			u64 gpa, void *data, int bytes);
 
-/* Track record for a write-protected guest page. */
+/*
+ * Track record for a write-protected guest page, or for a range of
+ * contiguous guest pages sharing one handler. Single pages are indexed by
+ * gfn in page_track_tree, ranges live in the page_track_ranges interval
+ * tree.
+ */
 struct intel_vgpu_page_track {
 	gvt_page_track_handler_t handler;
 	bool tracked;
 	void *priv_data;
+	unsigned long gfn;
+	unsigned long nr_pages;
+	struct rb_node rb;
+	unsigned long __subtree_last;
 };
 
 struct intel_vgpu_page_track *intel_vgpu_find_page_track(
@@ -50,6 +59,19 @@ void intel_vgpu_unregister_page_track(struct intel_vgpu *vgpu,
 int intel_vgpu_enable_page_track(struct intel_vgpu *vgpu, unsigned long gfn);
 int intel_vgpu_disable_page_track(struct intel_vgpu *vgpu, unsigned long gfn);
 
+int intel_vgpu_register_page_track_range(struct intel_vgpu *vgpu,
+		unsigned long gfn, unsigned long nr_pages,
+		gvt_page_track_handler_t handler, void *priv);
+void intel_vgpu_unregister_page_track_range(struct intel_vgpu *vgpu,
+		unsigned long gfn);
+int intel_vgpu_enable_page_track_range(struct intel_vgpu *vgpu,
+		unsigned long gfn);
+int intel_vgpu_disable_page_track_range(struct intel_vgpu *vgpu,
+		unsigned long gfn);
+
+void intel_vgpu_init_page_track(struct intel_vgpu *vgpu);
+void intel_vgpu_clean_page_track(struct intel_vgpu *vgpu);
+
 int intel_vgpu_page_track_handler(struct intel_vgpu *vgpu, u64 gpa,
 		void *data, unsigned int bytes);
 
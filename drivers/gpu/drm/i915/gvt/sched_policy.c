@@ -56,6 +56,8 @@ struct vgpu_sched_data {
 	ktime_t sched_time;
 	ktime_t left_ts;
 	ktime_t allocated_ts;
+	/* since when workloads are pending while being scheduled out */
+	ktime_t wait_start;
 
 	struct vgpu_sched_ctl sched_ctl;
 };
@@ -207,10 +209,10 @@ static struct intel_vgpu *find_busy_vgpu(struct gvt_sched_data *sched_data,
 /* in nanosecond */
 #define GVT_DEFAULT_TIME_SLICE 1000000
 
-static void tbs_sched_func(struct gvt_sched_data *sched_data,
+static void tbs_sched_func(struct intel_gvt *gvt,
 		enum intel_engine_id ring_id)
 {
-	struct intel_gvt *gvt = sched_data->gvt;
+	struct gvt_sched_data *sched_data = gvt->scheduler.sched_data;
 	struct intel_gvt_workload_scheduler *scheduler = &gvt->scheduler;
 	struct vgpu_sched_data *vgpu_data;
 	struct intel_vgpu *vgpu = NULL;
@@ -238,6 +240,83 @@ static void tbs_sched_func(struct gvt_sched_data *sched_data,
 		try_to_schedule_next_vgpu(gvt, ring_id);
 }
 
+/*
+ * Deadline policy: vGPUs with a latency target preempt the others once
+ * their workloads have been pending for almost that long, otherwise
+ * vGPUs are scheduled by time slices like with tbs. The time slices of
+ * a preempting vGPU are still accounted, and it only preempts while it
+ * has time slice left, so it can't starve the others.
+ */
+
+/* preempt when deadline is less than a scheduling period away */
+#define GVT_DL_SLACK GVT_DEFAULT_TIME_SLICE
+
+static struct intel_vgpu *find_urgent_vgpu(struct intel_gvt *gvt,
+		enum intel_engine_id ring_id, ktime_t now)
+{
+	struct gvt_sched_data *sched_data = gvt->scheduler.sched_data;
+	struct intel_vgpu *current_vgpu = gvt->scheduler.current_vgpu[ring_id];
+	struct vgpu_sched_data *vgpu_data;
+	struct intel_vgpu *vgpu, *urgent = NULL;
+	ktime_t deadline, urgent_deadline = 0;
+
+	list_for_each_entry(vgpu_data, &sched_data->lru_runq_head[ring_id],
+			    lru_list) {
+		vgpu = vgpu_data->vgpu;
+
+		if (vgpu == current_vgpu ||
+		    !vgpu_has_pending_workload(vgpu, ring_id)) {
+			vgpu_data->wait_start = 0;
+			continue;
+		}
+
+		if (!vgpu_data->wait_start)
+			vgpu_data->wait_start = now;
+
+		/* out of budget, it waits for the next balance like others */
+		if (!vgpu->sched_ctl.latency_target || vgpu_data->left_ts <= 0)
+			continue;
+
+		deadline = ktime_add_us(vgpu_data->wait_start,
+					vgpu->sched_ctl.latency_target);
+		if (ktime_to_ns(ktime_sub(deadline, now)) > GVT_DL_SLACK)
+			continue;
+
+		if (!urgent || ktime_before(deadline, urgent_deadline)) {
+			urgent = vgpu;
+			urgent_deadline = deadline;
+		}
+	}
+
+	return urgent;
+}
+
+static void dl_sched_func(struct intel_gvt *gvt,
+		enum intel_engine_id ring_id)
+{
+	struct gvt_sched_data *sched_data = gvt->scheduler.sched_data;
+	struct intel_gvt_workload_scheduler *scheduler = &gvt->scheduler;
+	struct vgpu_sched_data *vgpu_data;
+	struct intel_vgpu *vgpu;
+
+	vgpu = find_urgent_vgpu(gvt, ring_id, ktime_get());
+	if (!vgpu) {
+		tbs_sched_func(gvt, ring_id);
+		return;
+	}
+
+	/* replaces a target still waiting for the engine, too */
+	scheduler->next_vgpu[ring_id] = vgpu;
+
+	/* the others come first once it is no longer urgent */
+	vgpu_data = vgpu->sched_data[ring_id];
+	list_del_init(&vgpu_data->lru_list);
+	list_add_tail(&vgpu_data->lru_list,
+		      &sched_data->lru_runq_head[ring_id]);
+
+	try_to_schedule_next_vgpu(gvt, ring_id);
+}
+
 void intel_gvt_schedule(struct intel_gvt *gvt)
 {
 	struct gvt_sched_data *sched_data = gvt->scheduler.sched_data;
@@ -262,7 +341,7 @@ void intel_gvt_schedule(struct intel_gvt *gvt)
 	for_each_engine(engine, gvt->dev_priv, i) {
 		vgpu_update_timeslice(gvt->scheduler.current_vgpu[i],
 				cur_time, i);
-		tbs_sched_func(sched_data, i);
+		gvt->scheduler.sched_ops->schedule(gvt, i);
 	}
 
 	mutex_unlock(&gvt->sched_lock);
@@ -408,12 +487,31 @@ static void tbs_sched_stop_schedule(struct intel_vgpu *vgpu)
 }
 
 static struct intel_gvt_sched_policy_ops tbs_schedule_ops = {
+	.name = "tbs",
+	.init = tbs_sched_init,
+	.clean = tbs_sched_clean,
+	.init_vgpu = tbs_sched_init_vgpu,
+	.clean_vgpu = tbs_sched_clean_vgpu,
+	.start_schedule = tbs_sched_start_schedule,
+	.stop_schedule = tbs_sched_stop_schedule,
+	.schedule = tbs_sched_func,
+};
+
+/* shares the scheduling data of tbs, so policies can be switched any time */
+static struct intel_gvt_sched_policy_ops dl_schedule_ops = {
+	.name = "dl",
 	.init = tbs_sched_init,
 	.clean = tbs_sched_clean,
 	.init_vgpu = tbs_sched_init_vgpu,
 	.clean_vgpu = tbs_sched_clean_vgpu,
 	.start_schedule = tbs_sched_start_schedule,
 	.stop_schedule = tbs_sched_stop_schedule,
+	.schedule = dl_sched_func,
+};
+
+static struct intel_gvt_sched_policy_ops *sched_policies[] = {
+	&tbs_schedule_ops,
+	&dl_schedule_ops,
 };
 
 int intel_gvt_init_sched_policy(struct intel_gvt *gvt)
@@ -435,6 +533,41 @@ void intel_gvt_clean_sched_policy(struct intel_gvt *gvt)
 	mutex_unlock(&gvt->sched_lock);
 }
 
+/**
+ * intel_gvt_set_sched_policy - switch vGPU scheduling policy
+ * @gvt: a GVT device
+ * @name: name of the policy, "tbs" or "dl"
+ *
+ * Returns:
+ * Zero on success, -EINVAL if there is no such policy.
+ */
+int intel_gvt_set_sched_policy(struct intel_gvt *gvt, const char *name)
+{
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(sched_policies); i++) {
+		if (!sysfs_streq(name, sched_policies[i]->name))
+			continue;
+
+		mutex_lock(&gvt->sched_lock);
+		gvt->scheduler.sched_ops = sched_policies[i];
+		mutex_unlock(&gvt->sched_lock);
+
+		return 0;
+	}
+
+	return -EINVAL;
+}
+
+/**
+ * intel_gvt_get_sched_policy - get name of current scheduling policy
+ * @gvt: a GVT device
+ */
+const char *intel_gvt_get_sched_policy(struct intel_gvt *gvt)
+{
+	return gvt->scheduler.sched_ops->name;
+}
+
 /* for per-vgpu scheduler policy, there are 2 per-vgpu data:
  * sched_data, and sched_ctl. We see these 2 data as part of
  * the global scheduler which are proteced by gvt->sched_lock.
@@ -460,6 +593,22 @@ void intel_vgpu_clean_sched_policy(struct intel_vgpu *vgpu)
 	mutex_unlock(&vgpu->gvt->sched_lock);
 }
 
+/**
+ * intel_vgpu_set_latency_target - set latency target of a vGPU
+ * @vgpu: a vGPU
+ * @target_us: time in us workloads of the vGPU may be pending before it
+ *	       preempts other vGPUs, 0 for none
+ *
+ * The target is only taken into account by the "dl" policy.
+ */
+void intel_vgpu_set_latency_target(struct intel_vgpu *vgpu,
+				   unsigned int target_us)
+{
+	mutex_lock(&vgpu->gvt->sched_lock);
+	vgpu->sched_ctl.latency_target = target_us;
+	mutex_unlock(&vgpu->gvt->sched_lock);
+}
+
 void intel_vgpu_start_schedule(struct intel_vgpu *vgpu)
 {
 	struct vgpu_sched_data *vgpu_data;
@@ -35,12 +35,15 @@
 #define __GVT_SCHED_POLICY__
 
 struct intel_gvt_sched_policy_ops {
+	const char *name;
 	int (*init)(struct intel_gvt *gvt);
 	void (*clean)(struct intel_gvt *gvt);
 	int (*init_vgpu)(struct intel_vgpu *vgpu);
 	void (*clean_vgpu)(struct intel_vgpu *vgpu);
 	void (*start_schedule)(struct intel_vgpu *vgpu);
 	void (*stop_schedule)(struct intel_vgpu *vgpu);
+	/* pick next vGPU for engine, called with sched_lock held */
+	void (*schedule)(struct intel_gvt *gvt, enum intel_engine_id ring_id);
 };
 
 void intel_gvt_schedule(struct intel_gvt *gvt);
@@ -49,10 +52,17 @@ int intel_gvt_init_sched_policy(struct intel_gvt *gvt);
 
 void intel_gvt_clean_sched_policy(struct intel_gvt *gvt);
 
+int intel_gvt_set_sched_policy(struct intel_gvt *gvt, const char *name);
+
+const char *intel_gvt_get_sched_policy(struct intel_gvt *gvt);
+
 int intel_vgpu_init_sched_policy(struct intel_vgpu *vgpu);
 
 void intel_vgpu_clean_sched_policy(struct intel_vgpu *vgpu);
 
+void intel_vgpu_set_latency_target(struct intel_vgpu *vgpu,
+				   unsigned int target_us);
+
 void intel_vgpu_start_schedule(struct intel_vgpu *vgpu);
 
 void intel_vgpu_stop_schedule(struct intel_vgpu *vgpu);
@@ -356,6 +356,42 @@ static void release_shadow_wa_ctx(struct intel_shadow_wa_ctx *wa_ctx)
 	i915_gem_object_put(wa_ctx->indirect_ctx.obj);
 }
 
+/*
+ * Scanning only touches the per-ring scan buffer of the vGPU and the shadow
+ * objects of the workload itself, so unlike populating the shadow context
+ * it may run ahead of the workload being dispatched.
+ */
+static int scan_workload_commands(struct intel_vgpu_workload *workload)
+{
+	struct intel_vgpu *vgpu = workload->vgpu;
+	ktime_t start;
+	int ret;
+
+	if (workload->scanned)
+		return 0;
+
+	start = ktime_get();
+
+	ret = intel_gvt_scan_and_shadow_ringbuffer(workload);
+	if (ret)
+		goto out;
+
+	if ((workload->ring_id == RCS) &&
+	    (workload->wa_ctx.indirect_ctx.size != 0)
+	    && gvt_shadow_wa_ctx) {
+		ret = intel_gvt_scan_and_shadow_wa_ctx(&workload->wa_ctx);
+		if (ret) {
+			release_shadow_wa_ctx(&workload->wa_ctx);
+			goto out;
+		}
+	}
+
+	workload->scanned = true;
+out:
+	vgpu->stats.scan_ns += ktime_to_ns(ktime_sub(ktime_get(), start));
+	return ret;
+}
+
 /**
  * intel_gvt_scan_and_shadow_workload - audit the workload by scanning and
  * shadow it as well, include ringbuffer,wa_ctx and ctx.
@@ -400,18 +436,10 @@ int intel_gvt_scan_and_shadow_workload(struct intel_vgpu_workload *workload)
 	if (!test_and_set_bit(workload->ring_id, s->shadow_ctx_desc_updated))
 		shadow_context_descriptor_update(ce);
 
-	ret = intel_gvt_scan_and_shadow_ringbuffer(workload);
+	ret = scan_workload_commands(workload);
 	if (ret)
 		goto err_unpin;
 
-	if ((workload->ring_id == RCS) &&
-	    (workload->wa_ctx.indirect_ctx.size != 0)
-	    && gvt_shadow_wa_ctx) {
-		ret = intel_gvt_scan_and_shadow_wa_ctx(&workload->wa_ctx);
-		if (ret)
-			goto err_shadow;
-	}
-
 	rq = i915_request_alloc(engine, shadow_ctx);
 	if (IS_ERR(rq)) {
 		gvt_vgpu_err("fail to allocate gem request\n");
@@ -430,6 +458,7 @@ int intel_gvt_scan_and_shadow_workload(struct intel_vgpu_workload *workload)
 	i915_request_put(rq);
 err_shadow:
 	release_shadow_wa_ctx(&workload->wa_ctx);
+	workload->scanned = false;
 err_unpin:
 	intel_context_unpin(ce);
 	return ret;
@@ -710,6 +739,9 @@ static int dispatch_workload(struct intel_vgpu_workload *workload)
 	mutex_lock(&vgpu->vgpu_lock);
 	mutex_lock(&dev_priv->drm.struct_mutex);
 
+	/* the workload may use GGTT entries the guest just updated */
+	intel_vgpu_flush_ggtt_invalidate(vgpu);
+
 	ret = intel_gvt_scan_and_shadow_workload(workload);
 	if (ret)
 		goto out;
@@ -726,6 +758,8 @@ static int dispatch_workload(struct intel_vgpu_workload *workload)
 				ring_id, workload->req);
 		i915_request_add(workload->req);
 		workload->dispatched = true;
+		workload->dispatch_time = ktime_get();
+		vgpu->stats.workloads++;
 	}
 
 	mutex_unlock(&dev_priv->drm.struct_mutex);
@@ -733,6 +767,36 @@ static int dispatch_workload(struct intel_vgpu_workload *workload)
 	return ret;
 }
 
+/*
+ * Scan and shadow the workload queued after the one just dispatched while
+ * the latter runs on hardware, so it only needs its shadow context to be
+ * populated once the engine is done. A failure is left for dispatch to
+ * hit and report again.
+ */
+static void prescan_next_workload(struct intel_vgpu_workload *workload)
+{
+	struct intel_vgpu *vgpu = workload->vgpu;
+	struct drm_i915_private *dev_priv = vgpu->gvt->dev_priv;
+	struct list_head *q = workload_q_head(vgpu, workload->ring_id);
+	struct intel_vgpu_workload *next = NULL;
+	int ret = 0;
+
+	mutex_lock(&vgpu->vgpu_lock);
+	mutex_lock(&dev_priv->drm.struct_mutex);
+
+	if (!list_empty(&workload->list) && !list_is_last(&workload->list, q)) {
+		next = list_next_entry(workload, list);
+		ret = scan_workload_commands(next);
+	}
+
+	mutex_unlock(&dev_priv->drm.struct_mutex);
+
+	if (ret)
+		release_shadow_batch_buffer(next);
+
+	mutex_unlock(&vgpu->vgpu_lock);
+}
+
 static struct intel_vgpu_workload *pick_next_workload(
 		struct intel_gvt *gvt, int ring_id)
 {
@@ -872,10 +936,15 @@ void intel_vgpu_clean_workloads(struct intel_vgpu *vgpu,
 		list_for_each_entry_safe(pos, n,
 			&s->workload_q_head[engine->id], list) {
 			list_del_init(&pos->list);
+			if (pos->scanned && !pos->dispatched) {
+				release_shadow_batch_buffer(pos);
+				release_shadow_wa_ctx(&pos->wa_ctx);
+			}
 			intel_vgpu_destroy_workload(pos);
 		}
 		clear_bit(engine->id, s->shadow_ctx_desc_updated);
 	}
+	intel_vgpu_pv_submit_idle(vgpu, engine_mask);
 }
 
 static void complete_current_workload(struct intel_gvt *gvt, int ring_id)
@@ -933,6 +1002,10 @@ static void complete_current_workload(struct intel_gvt *gvt, int ring_id)
 
 	scheduler->current_workload[ring_id] = NULL;
 
+	if (workload->dispatched)
+		vgpu->stats.ring_busy_ns[ring_id] += ktime_to_ns(
+			ktime_sub(ktime_get(), workload->dispatch_time));
+
 	list_del_init(&workload->list);
 
 	if (workload->status == -EIO)
@@ -970,6 +1043,11 @@ static void complete_current_workload(struct intel_gvt *gvt, int ring_id)
 		intel_gvt_request_service(gvt, INTEL_GVT_REQUEST_EVENT_SCHED);
 
 	mutex_unlock(&gvt->sched_lock);
+
+	/* pick up what the guest queued without kicking */
+	if (intel_vgpu_pv_submit(vgpu, ring_id))
+		gvt_vgpu_err("fail pv submit workload on ring %d\n", ring_id);
+
 	mutex_unlock(&vgpu->vgpu_lock);
 }
 
@@ -1044,6 +1122,8 @@ static int workload_thread(void *priv)
 			goto complete;
 		}
 
+		prescan_next_workload(workload);
+
 		gvt_dbg_sched("ring id %d wait workload %p\n",
 				workload->ring_id, workload);
 		lret = i915_request_wait(workload->req, 0,
@@ -1169,6 +1249,7 @@ void intel_vgpu_clean_submission(struct intel_vgpu *vgpu)
 	struct intel_vgpu_submission *s = &vgpu->submission;
 
 	intel_vgpu_select_submission_ops(vgpu, ALL_ENGINES, 0);
+	intel_gvt_clean_bb_cache(vgpu);
 	i915_gem_context_put(s->shadow_ctx);
 	kmem_cache_destroy(s->workloads);
 }
@@ -1191,6 +1272,7 @@ void intel_vgpu_reset_submission(struct intel_vgpu *vgpu,
 		return;
 
 	intel_vgpu_clean_workloads(vgpu, engine_mask);
+	intel_gvt_clean_bb_cache(vgpu);
 	s->ops->reset(vgpu, engine_mask);
 }
 
@@ -1237,6 +1319,9 @@ int intel_vgpu_setup_submission(struct intel_vgpu *vgpu)
 	for_each_engine(engine, vgpu->gvt->dev_priv, i)
 		INIT_LIST_HEAD(&s->workload_q_head[i]);
 
+	INIT_LIST_HEAD(&s->bb_cache);
+	s->nr_bb_cache = 0;
+
 	atomic_set(&s->running_workload_num, 0);
 	bitmap_zero(s->tlb_handle_pending, I915_NUM_ENGINES);
 
@@ -1490,14 +1575,17 @@ intel_vgpu_create_workload(struct intel_vgpu *vgpu, int ring_id,
 		return ERR_PTR(ret);
 	}
 
-	/* Only scan and shadow the first workload in the queue
-	 * as there is only one pre-allocated buf-obj for shadow.
+	/* Only scan and shadow the workload when all the queued ones have
+	 * been dispatched, as there is only one pre-allocated buf-obj for
+	 * shadow. The shadow context is populated at dispatch time.
 	 */
-	if (list_empty(workload_q_head(vgpu, ring_id))) {
+	if (!last_workload || last_workload->dispatched) {
 		intel_runtime_pm_get(dev_priv);
 		mutex_lock(&dev_priv->drm.struct_mutex);
-		ret = intel_gvt_scan_and_shadow_workload(workload);
+		ret = scan_workload_commands(workload);
 		mutex_unlock(&dev_priv->drm.struct_mutex);
+		if (ret)
+			release_shadow_batch_buffer(workload);
 		intel_runtime_pm_put(dev_priv);
 	}
 
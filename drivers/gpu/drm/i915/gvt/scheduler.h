@@ -83,6 +83,9 @@ struct intel_vgpu_workload {
 	struct i915_request *req;
 	/* if this workload has been dispatched to i915? */
 	bool dispatched;
+	ktime_t dispatch_time;
+	/* if ring buffer and wa ctx have been scanned and shadowed? */
+	bool scanned;
 	int status;
 	unsigned int guilty_count;
 
@@ -91,6 +91,18 @@ void populate_pvinfo_page(struct intel_vgpu *vgpu)
 #define VGPU_WEIGHT(vgpu_num)	\
 	(VGPU_MAX_WEIGHT / (vgpu_num))
 
+/*
+ * With GuC submission the i915 scheduler orders and preempts requests by
+ * priority. Spread vGPU weights over the non-positive user priorities, so
+ * a heavier vGPU is preferred over a lighter one without ever preempting
+ * host clients running at default priority.
+ */
+static int vgpu_guc_priority(struct intel_vgpu *vgpu)
+{
+	return (vgpu->sched_ctl.weight - VGPU_MAX_WEIGHT) *
+		(I915_CONTEXT_MAX_USER_PRIORITY / VGPU_MAX_WEIGHT);
+}
+
 static struct {
 	unsigned int low_mm;
 	unsigned int high_mm;
@@ -298,6 +310,7 @@ void intel_gvt_destroy_vgpu(struct intel_vgpu *vgpu)
 	intel_vgpu_clean_opregion(vgpu);
 	intel_vgpu_reset_ggtt(vgpu, true);
 	intel_vgpu_clean_gtt(vgpu);
+	intel_vgpu_clean_page_track(vgpu);
 	intel_gvt_hypervisor_detach_vgpu(vgpu);
 	intel_vgpu_free_resource(vgpu);
 	intel_vgpu_reset_cfg_space(vgpu);
@@ -312,6 +325,10 @@ void intel_gvt_destroy_vgpu(struct intel_vgpu *vgpu)
 	intel_gvt_update_vgpu_types(gvt);
 	mutex_unlock(&gvt->lock);
 
+	/* out of the idr, host vblanks can't arm its vblank timer any more */
+	intel_vgpu_stop_vblank(vgpu);
+	intel_vgpu_clean_irq(vgpu);
+
 	vfree(vgpu);
 }
 
@@ -398,7 +415,8 @@ static struct intel_vgpu *__intel_gvt_create_vgpu(struct intel_gvt *gvt,
 	mutex_init(&vgpu->vgpu_lock);
 	mutex_init(&vgpu->dmabuf_lock);
 	INIT_LIST_HEAD(&vgpu->dmabuf_obj_list_head);
-	INIT_RADIX_TREE(&vgpu->page_track_tree, GFP_KERNEL);
+	intel_vgpu_init_irq(vgpu);
+	intel_vgpu_init_page_track(vgpu);
 	idr_init(&vgpu->object_idr);
 	intel_vgpu_init_cfg_space(vgpu, param->primary);
 
@@ -432,6 +450,10 @@ static struct intel_vgpu *__intel_gvt_create_vgpu(struct intel_gvt *gvt,
 	if (ret)
 		goto out_clean_display;
 
+	if (USES_GUC_SUBMISSION(gvt->dev_priv))
+		vgpu->submission.shadow_ctx->sched.priority =
+			vgpu_guc_priority(vgpu);
+
 	ret = intel_vgpu_init_sched_policy(vgpu);
 	if (ret)
 		goto out_clean_submission;
@@ -456,6 +478,7 @@ static struct intel_vgpu *__intel_gvt_create_vgpu(struct intel_gvt *gvt,
 	intel_vgpu_clean_opregion(vgpu);
 out_clean_gtt:
 	intel_vgpu_clean_gtt(vgpu);
+	intel_vgpu_clean_page_track(vgpu);
 out_detach_hypervisor_vgpu:
 	intel_gvt_hypervisor_detach_vgpu(vgpu);
 out_clean_vgpu_resource:
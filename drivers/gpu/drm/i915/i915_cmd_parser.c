@@ -25,6 +25,8 @@
  *
  */
 
+#include <linux/jhash.h>
+
 #include "i915_drv.h"
 #include "intel_ringbuffer.h"
 
@@ -865,6 +867,9 @@ void intel_engine_init_cmd_parser(struct intel_engine_cs *engine)
 	int cmd_table_count;
 	int ret;
 
+	INIT_LIST_HEAD(&engine->cmd_cache);
+	engine->cmd_cache_count = 0;
+
 	if (!IS_GEN7(engine->i915))
 		return;
 
@@ -953,9 +958,16 @@ void intel_engine_init_cmd_parser(struct intel_engine_cs *engine)
  */
 void intel_engine_cleanup_cmd_parser(struct intel_engine_cs *engine)
 {
+	struct cmd_cache_entry *entry, *next;
+
 	if (!intel_engine_needs_cmd_parser(engine))
 		return;
 
+	list_for_each_entry_safe(entry, next, &engine->cmd_cache, link)
+		kfree(entry);
+	INIT_LIST_HEAD(&engine->cmd_cache);
+	engine->cmd_cache_count = 0;
+
 	fini_hash_table(engine);
 }
 
@@ -1237,6 +1249,70 @@ static bool check_cmd(const struct intel_engine_cs *engine,
 
 #define LENGTH_BIAS 2
 
+/*
+ * Validated batches are remembered by content rather than by object, so a
+ * batch modified behind our back in any way (CPU mmap, pwrite, GPU writes,
+ * userptr) simply misses the cache. The full copy is compared on lookup,
+ * the hash only speeds up rejecting mismatches.
+ */
+#define CMD_CACHE_MAX_ENTRIES 8
+#define CMD_CACHE_MAX_LEN SZ_16K
+
+struct cmd_cache_entry {
+	struct list_head link;
+	u32 hash;
+	u32 len;
+	u32 end;	/* bytes up to and including MI_BATCH_BUFFER_END */
+	bool is_master;
+	u32 cmds[];
+};
+
+static struct cmd_cache_entry *
+cmd_cache_lookup(struct intel_engine_cs *engine, const u32 *cmd,
+		 u32 len, u32 hash, bool is_master)
+{
+	struct cmd_cache_entry *entry;
+
+	list_for_each_entry(entry, &engine->cmd_cache, link) {
+		if (entry->hash != hash || entry->len != len ||
+		    entry->is_master != is_master ||
+		    memcmp(entry->cmds, cmd, len))
+			continue;
+
+		list_move(&entry->link, &engine->cmd_cache);
+		return entry;
+	}
+
+	return NULL;
+}
+
+static void cmd_cache_insert(struct intel_engine_cs *engine, const u32 *cmd,
+			     u32 len, u32 end, u32 hash, bool is_master)
+{
+	struct cmd_cache_entry *entry;
+
+	if (engine->cmd_cache_count >= CMD_CACHE_MAX_ENTRIES) {
+		entry = list_last_entry(&engine->cmd_cache,
+					struct cmd_cache_entry, link);
+		list_del(&entry->link);
+		engine->cmd_cache_count--;
+		kfree(entry);
+	}
+
+	entry = kmalloc(sizeof(*entry) + len, GFP_KERNEL | __GFP_NOWARN);
+	if (!entry)
+		return;
+
+	entry->hash = hash;
+	entry->len = len;
+	entry->end = end;
+	entry->is_master = is_master;
+	memcpy(entry->cmds, cmd, len);
+
+	list_add(&entry->link, &engine->cmd_cache);
+	engine->cmd_cache_count++;
+}
+
 /**
  * i915_parse_cmds() - parse a submitted batch buffer for privilege violations
  * @engine: the engine on which the batch is to execute
@@ -1259,10 +1335,13 @@ int intel_engine_cmd_parser(struct intel_engine_cs *engine,
 			    u32 batch_len,
 			    bool is_master)
 {
-	u32 *cmd, *batch_end;
+	u32 *cmd, *batch_start, *batch_end;
 	struct drm_i915_cmd_descriptor default_desc = noop_desc;
 	const struct drm_i915_cmd_descriptor *desc = &default_desc;
+	struct cmd_cache_entry *cached;
 	bool needs_clflush_after = false;
+	bool cacheable;
+	u32 hash = 0;
 	int ret = 0;
 
 	cmd = copy_batch(shadow_batch_obj, batch_obj,
@@ -1272,6 +1351,19 @@ int intel_engine_cmd_parser(struct intel_engine_cs *engine,
 		DRM_DEBUG_DRIVER("CMD: Failed to copy batch\n");
 		return PTR_ERR(cmd);
 	}
+	batch_start = cmd;
+
+	cacheable = batch_len <= CMD_CACHE_MAX_LEN;
+	if (cacheable) {
+		hash = jhash2(cmd, batch_len / sizeof(*cmd), is_master);
+		cached = cmd_cache_lookup(engine, cmd, batch_len, hash,
+					  is_master);
+		if (cached) {
+			if (needs_clflush_after)
+				drm_clflush_virt_range(cmd, cached->end);
+			goto out;
+		}
+	}
 
 	/*
 	 * We use the batch length as size because the shadow object is as
@@ -1288,6 +1380,12 @@ int intel_engine_cmd_parser(struct intel_engine_cs *engine,
 				drm_clflush_virt_range(ptr,
 						       (void *)(cmd + 1) - ptr);
 			}
+			if (cacheable)
+				cmd_cache_insert(engine, batch_start,
+						 batch_len,
+						 (void *)(cmd + 1) -
+						 (void *)batch_start,
+						 hash, is_master);
 			break;
 		}
 
@@ -1336,6 +1434,7 @@ int intel_engine_cmd_parser(struct intel_engine_cs *engine,
 		}
 	} while (1);
 
+out:
 	i915_gem_object_unpin_map(shadow_batch_obj);
 	return ret;
 }
@@ -640,6 +640,14 @@ static int i915_gem_batch_pool_info(struct seq_file *m, void *data)
 
 			total += count;
 		}
+
+		seq_printf(m, "%s: %u objects, %llu bytes, %lu hits, %lu allocs, %lu aged\n",
+			   engine->name,
+			   engine->batch_pool.count,
+			   engine->batch_pool.size,
+			   engine->batch_pool.hits,
+			   engine->batch_pool.allocs,
+			   engine->batch_pool.aged);
 	}
 
 	seq_printf(m, "total: %d\n", total);
@@ -976,6 +984,27 @@ static int gpu_state_release(struct inode *inode, struct file *file)
 	return 0;
 }
 
+static int i915_error_capture_deferred_get(void *data, u64 *val)
+{
+	struct drm_i915_private *i915 = data;
+
+	*val = READ_ONCE(i915->gpu_error.capture_deferred);
+	return 0;
+}
+
+static int i915_error_capture_deferred_set(void *data, u64 val)
+{
+	struct drm_i915_private *i915 = data;
+
+	WRITE_ONCE(i915->gpu_error.capture_deferred, !!val);
+	return 0;
+}
+
+DEFINE_SIMPLE_ATTRIBUTE(i915_error_capture_deferred_fops,
+			i915_error_capture_deferred_get,
+			i915_error_capture_deferred_set,
+			"%llu\n");
+
 static int i915_gpu_info_open(struct inode *inode, struct file *file)
 {
 	struct drm_i915_private *i915 = inode->i_private;
@@ -3025,6 +3054,12 @@ static void intel_crtc_info(struct seq_file *m, struct intel_crtc *intel_crtc)
 			seq_puts(m, "\tprimary plane disabled\n");
 	}
 
+	seq_printf(m, "\tupdate: avg %uus, evasion %uus, %u updates, %u straddled vblank\n",
+		   intel_crtc->commit_timing.update_ns / NSEC_PER_USEC,
+		   intel_crtc->commit_timing.evade_us,
+		   intel_crtc->commit_timing.updates,
+		   intel_crtc->commit_timing.misses);
+
 	for_each_encoder_on_crtc(dev, crtc, intel_encoder)
 		intel_encoder_info(m, intel_crtc, intel_encoder);
 }
@@ -3331,6 +3366,53 @@ static int i915_engine_info(struct seq_file *m, void *unused)
 	return 0;
 }
 
+static void print_engine_latency(struct seq_file *m, const char *name,
+				 const struct intel_engine_latency *lat)
+{
+	static const char * const prio[] = {
+		[INTEL_ENGINE_LATENCY_PRIO_LOW] = "low",
+		[INTEL_ENGINE_LATENCY_PRIO_NORMAL] = "normal",
+		[INTEL_ENGINE_LATENCY_PRIO_HIGH] = "high",
+	};
+	unsigned int i, n;
+
+	seq_printf(m, "\t%s: total %lluns\n", name, READ_ONCE(lat->total_ns));
+	for (i = 0; i < INTEL_ENGINE_LATENCY_NUM_PRIO; i++) {
+		u64 count = READ_ONCE(lat->count[i]);
+
+		if (!count)
+			continue;
+
+		seq_printf(m, "\t\t%s: count %llu, avg %lluus, max %lluus\n",
+			   prio[i], count,
+			   div64_u64(READ_ONCE(lat->sum_ns[i]),
+				     count * NSEC_PER_USEC),
+			   div_u64(READ_ONCE(lat->max_ns[i]), NSEC_PER_USEC));
+		for (n = 0; n < INTEL_ENGINE_LATENCY_BUCKETS; n++) {
+			u32 hits = READ_ONCE(lat->hist[i][n]);
+
+			if (hits)
+				seq_printf(m, "\t\t\t>=%uus: %u\n",
+					   n ? 1u << n : 0, hits);
+		}
+	}
+}
+
+static int i915_engine_latency(struct seq_file *m, void *unused)
+{
+	struct drm_i915_private *dev_priv = node_to_i915(m->private);
+	struct intel_engine_cs *engine;
+	enum intel_engine_id id;
+
+	for_each_engine(engine, dev_priv, id) {
+		seq_printf(m, "%s\n", engine->name);
+		print_engine_latency(m, "queue", &engine->queue_time);
+		print_engine_latency(m, "exec", &engine->exec_time);
+	}
+
+	return 0;
+}
+
 static int i915_rcs_topology(struct seq_file *m, void *unused)
 {
 	struct drm_i915_private *dev_priv = node_to_i915(m->private);
@@ -3497,6 +3579,12 @@ static int i915_ddb_info(struct seq_file *m, void *unused)
 			   entry->end, skl_ddb_entry_size(entry));
 	}
 
+	seq_printf(m, "WM commits: %lld, %lld ns, planes computed: %lld, reused: %lld\n",
+		   atomic64_read(&dev_priv->wm.skl_stats.commits),
+		   atomic64_read(&dev_priv->wm.skl_stats.ns),
+		   atomic64_read(&dev_priv->wm.skl_stats.planes_computed),
+		   atomic64_read(&dev_priv->wm.skl_stats.planes_reused));
+
 	drm_modeset_unlock_all(dev);
 
 	return 0;
@@ -4800,6 +4888,7 @@ static const struct drm_info_list i915_debugfs_list[] = {
 	{"i915_dmc_info", i915_dmc_info, 0},
 	{"i915_display_info", i915_display_info, 0},
 	{"i915_engine_info", i915_engine_info, 0},
+	{"i915_engine_latency", i915_engine_latency, 0},
 	{"i915_rcs_topology", i915_rcs_topology, 0},
 	{"i915_shrinker_info", i915_shrinker_info, 0},
 	{"i915_shared_dplls_info", i915_shared_dplls_info, 0},
@@ -4824,6 +4913,7 @@ static const struct i915_debugfs_files {
 #if IS_ENABLED(CONFIG_DRM_I915_CAPTURE_ERROR)
 	{"i915_error_state", &i915_error_state_fops},
 	{"i915_gpu_info", &i915_gpu_info_fops},
+	{"i915_error_capture_deferred", &i915_error_capture_deferred_fops},
 #endif
 	{"i915_fifo_underrun_reset", &i915_fifo_underrun_reset_ops},
 	{"i915_next_seqno", &i915_next_seqno_fops},
@@ -926,6 +926,7 @@ static int i915_driver_init_early(struct drm_i915_private *dev_priv,
 	intel_power_domains_init(dev_priv);
 	intel_irq_init(dev_priv);
 	intel_hangcheck_init(dev_priv);
+	i915_error_state_init(dev_priv);
 	intel_init_display_hooks(dev_priv);
 	intel_init_clock_gating_hooks(dev_priv);
 	intel_init_audio_hooks(dev_priv);
@@ -1276,6 +1277,7 @@ static void i915_driver_register(struct drm_i915_private *dev_priv)
 
 	if (IS_GEN5(dev_priv))
 		intel_gpu_ips_init(dev_priv);
+	intel_gpu_busy_init(dev_priv);
 
 	intel_audio_init(dev_priv);
 
@@ -1312,6 +1314,7 @@ static void i915_driver_unregister(struct drm_i915_private *dev_priv)
 	 */
 	drm_kms_helper_poll_fini(&dev_priv->drm);
 
+	intel_gpu_busy_teardown();
 	intel_gpu_ips_teardown();
 	acpi_video_unregister();
 	intel_opregion_unregister(dev_priv);
@@ -985,6 +985,14 @@ struct i915_gem_mm {
 	struct notifier_block vmap_notifier;
 	struct shrinker shrinker;
 
+	/*
+	 * Pages the shrinker could not reclaim without waiting for
+	 * struct_mutex, released later by reclaim_work.
+	 */
+	struct workqueue_struct *reclaim_wq;
+	struct work_struct reclaim_work;
+	atomic_long_t reclaim_target;
+
 	/** LRU list of objects with fence regs on them. */
 	struct list_head fence_list;
 
@@ -1936,6 +1944,14 @@ struct drm_i915_private {
 		 * (which we don't fully trust).
 		 */
 		bool distrust_bios_wm;
+
+		/* Cost of the SKL+ watermark computation, for debugfs */
+		struct {
+			atomic64_t commits;
+			atomic64_t ns;
+			atomic64_t planes_computed;
+			atomic64_t planes_reused;
+		} skl_stats;
 	} wm;
 
 	struct i915_runtime_pm runtime_pm;
@@ -1189,8 +1189,8 @@ static void __start_cpu_write(struct drm_i915_gem_object *obj)
 {
 	obj->read_domains = I915_GEM_DOMAIN_CPU;
 	obj->write_domain = I915_GEM_DOMAIN_CPU;
-	if (cpu_write_needs_clflush(obj))
-		obj->cache_dirty = true;
+	if (cpu_write_needs_clflush(obj) || obj->cache_dirty)
+		i915_gem_object_set_cache_dirty(obj);
 }
 
 static void
@@ -1691,7 +1691,7 @@ flush_write_domain(struct drm_i915_gem_object *obj, unsigned int flush_domains)
 
 	case I915_GEM_DOMAIN_RENDER:
 		if (gpu_write_needs_clflush(obj))
-			obj->cache_dirty = true;
+			i915_gem_object_set_cache_dirty(obj);
 		break;
 	}
 
@@ -2386,6 +2386,7 @@ i915_gem_shmem_pwrite(struct drm_i915_gem_object *obj,
 	unsigned int partial_cacheline_write;
 	unsigned int needs_clflush;
 	unsigned int offset, idx;
+	bool defer_clflush;
 	int ret;
 
 	ret = mutex_lock_interruptible(&i915->drm.struct_mutex);
@@ -2401,6 +2402,22 @@ i915_gem_shmem_pwrite(struct drm_i915_gem_object *obj,
 	if (i915_gem_object_needs_bit17_swizzle(obj))
 		obj_do_bit17_swizzling = BIT(17);
 
+	/*
+	 * Rather than flushing every written cacheline straight away, leave
+	 * them in the CPU cache and only remember which pages we touched.
+	 * The next move to the GPU (or out of the CPU write domain) then
+	 * flushes just that range, so repeated small uploads into a large
+	 * buffer stop costing a flush each. We only do so if the object is
+	 * already in the CPU read domain (nothing to invalidate beforehand),
+	 * is not being scanned out and is not swizzled.
+	 */
+	defer_clflush =
+		needs_clflush == CLFLUSH_AFTER &&
+		!obj->pin_global &&
+		!obj_do_bit17_swizzling;
+	if (defer_clflush)
+		needs_clflush = 0;
+
 	/* If we don't overwrite a cacheline completely we need to be
 	 * careful to have up-to-date data by first clflushing. Don't
 	 * overcomplicate things and flush the entire patch.
@@ -2432,6 +2449,17 @@ i915_gem_shmem_pwrite(struct drm_i915_gem_object *obj,
 		offset = 0;
 	}
 
+	if (defer_clflush || obj->cache_dirty) {
+		mutex_lock(&i915->drm.struct_mutex);
+		if (defer_clflush || obj->cache_dirty) {
+			i915_gem_clflush_add_range(obj, args->offset,
+						   args->size - remain);
+			obj->read_domains = I915_GEM_DOMAIN_CPU;
+			obj->write_domain = I915_GEM_DOMAIN_CPU;
+		}
+		mutex_unlock(&i915->drm.struct_mutex);
+	}
+
 	intel_fb_obj_flush(obj, ORIGIN_CPU);
 	i915_gem_obj_finish_shmem_access(obj);
 	return ret;
@@ -2840,6 +2868,62 @@ compute_partial_view(struct drm_i915_gem_object *obj,
 	return view;
 }
 
+/*
+ * Also map the partial view following @vma into @area, provided it can be
+ * bound without evicting anything, so that streaming through a large mmap
+ * takes one fault per pair of chunks. Tiled objects are skipped as each
+ * view would tie up another fence register.
+ */
+static void prefetch_partial_view(struct vm_area_struct *area,
+				  struct i915_vma *vma)
+{
+	struct drm_i915_gem_object *obj = vma->obj;
+	struct drm_i915_private *i915 = to_i915(obj->base.dev);
+	struct i915_ggtt *ggtt = &i915->ggtt;
+	struct i915_ggtt_view view = vma->ggtt_view;
+	const unsigned int npages = obj->base.size >> PAGE_SHIFT;
+	unsigned long addr;
+	struct i915_vma *next;
+
+	if (view.type != I915_GGTT_VIEW_PARTIAL ||
+	    i915_gem_object_is_tiled(obj))
+		return;
+
+	view.partial.offset += view.partial.size;
+	if (view.partial.offset >= npages)
+		return;
+	view.partial.size = min_t(unsigned int, view.partial.size,
+				  npages - view.partial.offset);
+
+	addr = area->vm_start + (view.partial.offset << PAGE_SHIFT);
+	if (addr >= area->vm_end)
+		return;
+
+	next = i915_gem_object_ggtt_pin(obj, &view, 0, 0,
+					PIN_MAPPABLE |
+					PIN_NONBLOCK |
+					PIN_NONFAULT);
+	if (IS_ERR(next))
+		return;
+
+	if (i915_vma_has_userfault(next))
+		goto out;
+
+	if (remap_io_mapping(area, addr,
+			     (ggtt->gmadr.start + next->node.start) >>
+			     PAGE_SHIFT,
+			     min_t(u64, next->size, area->vm_end - addr),
+			     &ggtt->iomap))
+		goto out;
+
+	if (!i915_vma_set_userfault(next) && !obj->userfault_count++)
+		list_add(&obj->userfault_link, &i915->mm.userfault_list);
+	i915_vma_set_ggtt_write(next);
+
+out:
+	__i915_vma_unpin(next);
+}
+
 /**
  * i915_gem_fault - fault a page into the GTT
  * @vmf: fault info
@@ -2861,6 +2945,7 @@ compute_partial_view(struct drm_i915_gem_object *obj,
 vm_fault_t i915_gem_fault(struct vm_fault *vmf)
 {
 #define MIN_CHUNK_PAGES (SZ_1M >> PAGE_SHIFT)
+#define MAX_CHUNK_PAGES (SZ_8M >> PAGE_SHIFT)
 	struct vm_area_struct *area = vmf->vma;
 	struct drm_i915_gem_object *obj = to_intel_bo(area->vm_private_data);
 	struct drm_device *dev = obj->base.dev;
@@ -2914,6 +2999,21 @@ vm_fault_t i915_gem_fault(struct vm_fault *vmf)
 				       PIN_MAPPABLE |
 				       PIN_NONBLOCK |
 				       PIN_NONFAULT);
+	if (IS_ERR(vma) && obj->base.size > SZ_8M) {
+		/*
+		 * Before falling back to the smallest chunk, see if a larger
+		 * one fits without eviction, so that big objects fault far
+		 * less often.
+		 */
+		struct i915_ggtt_view view =
+			compute_partial_view(obj, page_offset, MAX_CHUNK_PAGES);
+
+		obj->frontbuffer_ggtt_origin = ORIGIN_CPU;
+		vma = i915_gem_object_ggtt_pin(obj, &view, 0, 0,
+					       PIN_MAPPABLE |
+					       PIN_NONBLOCK |
+					       PIN_NONFAULT);
+	}
 	if (IS_ERR(vma)) {
 		/* Use a partial view if it is bigger than available space */
 		struct i915_ggtt_view view =
@@ -2970,6 +3070,8 @@ vm_fault_t i915_gem_fault(struct vm_fault *vmf)
 
 	i915_vma_set_ggtt_write(vma);
 
+	prefetch_partial_view(area, vma);
+
 err_fence:
 	i915_vma_unpin_fence(vma);
 err_unpin:
@@ -4324,7 +4426,12 @@ i915_gem_retire_work_handler(struct work_struct *work)
 
 	/* Come back later if the device is busy... */
 	if (mutex_trylock(&dev->struct_mutex)) {
+		struct intel_engine_cs *engine;
+		enum intel_engine_id id;
+
 		i915_retire_requests(dev_priv);
+		for_each_engine(engine, dev_priv, id)
+			i915_gem_batch_pool_age(&engine->batch_pool);
 		mutex_unlock(&dev->struct_mutex);
 	}
 
@@ -4987,7 +5094,8 @@ int i915_gem_object_set_cache_level(struct drm_i915_gem_object *obj,
 	list_for_each_entry(vma, &obj->vma_list, obj_link)
 		vma->node.color = cache_level;
 	i915_gem_object_set_cache_coherency(obj, cache_level);
-	obj->cache_dirty = true; /* Always invalidate stale cachelines */
+	/* Always invalidate stale cachelines */
+	i915_gem_object_set_cache_dirty(obj);
 
 	return 0;
 }
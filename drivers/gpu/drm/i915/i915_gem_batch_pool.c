@@ -21,6 +21,18 @@
  * extended to support other uses cases should they arise.
  */
 
+/* Idle objects unused for longer than this are returned to the system. */
+#define I915_GEM_BATCH_POOL_AGE HZ
+
+static void batch_pool_release(struct i915_gem_batch_pool *pool,
+			       struct drm_i915_gem_object *obj)
+{
+	list_del_init(&obj->batch_pool_link);
+	pool->count--;
+	pool->size -= obj->base.size;
+	__i915_gem_object_release_unless_active(obj);
+}
+
 /**
  * i915_gem_batch_pool_init() - initialize a batch buffer pool
  * @pool: the batch buffer pool
@@ -59,6 +71,43 @@ void i915_gem_batch_pool_fini(struct i915_gem_batch_pool *pool)
 
 		INIT_LIST_HEAD(&pool->cache_list[n]);
 	}
+
+	pool->count = 0;
+	pool->size = 0;
+}
+
+/**
+ * i915_gem_batch_pool_age() - release cold objects of a batch buffer pool
+ * @pool: the batch buffer pool
+ *
+ * Frees the idle objects that have not been handed out for
+ * I915_GEM_BATCH_POOL_AGE, so that a burst of large batches does not pin
+ * memory until the engine parks.
+ *
+ * Note: Callers must hold the struct_mutex.
+ */
+void i915_gem_batch_pool_age(struct i915_gem_batch_pool *pool)
+{
+	unsigned long expire = jiffies - I915_GEM_BATCH_POOL_AGE;
+	int n;
+
+	lockdep_assert_held(&pool->engine->i915->drm.struct_mutex);
+
+	for (n = 0; n < ARRAY_SIZE(pool->cache_list); n++) {
+		struct drm_i915_gem_object *obj, *next;
+
+		/* LRU ordered, so stop at the first recently used object */
+		list_for_each_entry_safe(obj, next,
+					 &pool->cache_list[n],
+					 batch_pool_link) {
+			if (time_after(obj->batch_pool_age, expire) ||
+			    i915_gem_object_is_active(obj))
+				break;
+
+			batch_pool_release(pool, obj);
+			pool->aged++;
+		}
+	}
 }
 
 /**
@@ -84,13 +133,17 @@ i915_gem_batch_pool_get(struct i915_gem_batch_pool *pool,
 
 	lockdep_assert_held(&pool->engine->i915->drm.struct_mutex);
 
-	/* Compute a power-of-two bucket, but throw everything greater than
-	 * 16KiB into the same bucket: i.e. the the buckets hold objects of
-	 * (1 page, 2 pages, 4 pages, 8+ pages).
+	/*
+	 * Round the request up to a power-of-two number of pages, so that
+	 * every object of a size class fits and only the least recently
+	 * used one needs to be checked. Requests larger than the last size
+	 * class share one list, which is searched for a big enough object.
 	 */
-	n = fls(size >> PAGE_SHIFT) - 1;
-	if (n >= ARRAY_SIZE(pool->cache_list))
+	n = order_base_2(DIV_ROUND_UP(size, PAGE_SIZE));
+	if (n >= ARRAY_SIZE(pool->cache_list) - 1)
 		n = ARRAY_SIZE(pool->cache_list) - 1;
+	else
+		size = PAGE_SIZE << n;
 	list = &pool->cache_list[n];
 
 	list_for_each_entry(obj, list, batch_pool_link) {
@@ -122,19 +175,28 @@ i915_gem_batch_pool_get(struct i915_gem_batch_pool *pool,
 		GEM_BUG_ON(!reservation_object_test_signaled_rcu(obj->resv,
 								 true));
 
-		if (obj->base.size >= size)
+		if (obj->base.size >= size) {
+			pool->hits++;
 			goto found;
+		}
+
+		GEM_BUG_ON(n != ARRAY_SIZE(pool->cache_list) - 1);
 	}
 
 	obj = i915_gem_object_create_internal(pool->engine->i915, size);
 	if (IS_ERR(obj))
 		return obj;
 
+	pool->allocs++;
+	pool->count++;
+	pool->size += obj->base.size;
+
 found:
 	ret = i915_gem_object_pin_pages(obj);
 	if (ret)
 		return ERR_PTR(ret);
 
+	obj->batch_pool_age = jiffies;
 	list_move_tail(&obj->batch_pool_link, list);
 	return obj;
 }
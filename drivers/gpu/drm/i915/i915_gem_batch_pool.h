@@ -11,14 +11,28 @@
 
 struct intel_engine_cs;
 
+/*
+ * Objects of up to 64 pages are kept in power-of-two size classes, anything
+ * larger shares the last list.
+ */
+#define I915_GEM_BATCH_POOL_CLASSES 8
+
 struct i915_gem_batch_pool {
 	struct intel_engine_cs *engine;
-	struct list_head cache_list[4];
+	struct list_head cache_list[I915_GEM_BATCH_POOL_CLASSES];
+
+	/* statistics, protected by struct_mutex */
+	unsigned long hits;
+	unsigned long allocs;
+	unsigned long aged;
+	unsigned int count;
+	u64 size;
 };
 
 void i915_gem_batch_pool_init(struct i915_gem_batch_pool *pool,
 			      struct intel_engine_cs *engine);
 void i915_gem_batch_pool_fini(struct i915_gem_batch_pool *pool);
+void i915_gem_batch_pool_age(struct i915_gem_batch_pool *pool);
 struct drm_i915_gem_object*
 i915_gem_batch_pool_get(struct i915_gem_batch_pool *pool, size_t size);
 
@@ -33,6 +33,7 @@ struct clflush {
 	struct i915_sw_fence wait;
 	struct work_struct work;
 	struct drm_i915_gem_object *obj;
+	pgoff_t start, end;
 };
 
 static const char *i915_clflush_get_driver_name(struct dma_fence *fence)
@@ -68,10 +69,22 @@ static const struct dma_fence_ops i915_clflush_ops = {
 	.release = i915_clflush_release,
 };
 
-static void __i915_do_clflush(struct drm_i915_gem_object *obj)
+static void __i915_do_clflush(struct drm_i915_gem_object *obj,
+			      pgoff_t start, pgoff_t end)
 {
 	GEM_BUG_ON(!i915_gem_object_has_pages(obj));
-	drm_clflush_sg(obj->mm.pages);
+
+	if (end && end - start < obj->base.size >> PAGE_SHIFT) {
+		struct page *page;
+
+		for (; start < end; start++) {
+			page = i915_gem_object_get_page(obj, start);
+			drm_clflush_pages(&page, 1);
+		}
+	} else {
+		drm_clflush_sg(obj->mm.pages);
+	}
+
 	intel_fb_obj_flush(obj, ORIGIN_CPU);
 }
 
@@ -85,7 +98,7 @@ static void i915_clflush_work(struct work_struct *work)
 		goto out;
 	}
 
-	__i915_do_clflush(obj);
+	__i915_do_clflush(obj, clflush->start, clflush->end);
 
 	i915_gem_object_unpin_pages(obj);
 
@@ -115,9 +128,45 @@ i915_clflush_notify(struct i915_sw_fence *fence,
 	return NOTIFY_DONE;
 }
 
+/**
+ * i915_gem_clflush_add_range - record a partial CPU write to the object
+ * @obj: the object written through the CPU cache
+ * @offset: byte offset of the write
+ * @length: length of the write in bytes
+ *
+ * Mark the pages covering [@offset, @offset + @length) as dirty in the CPU
+ * cache, so that the next i915_gem_clflush_object() only has to flush
+ * those rather than the whole object. If the object is already known to be
+ * dirty in its entirety, this is a no-op.
+ */
+void i915_gem_clflush_add_range(struct drm_i915_gem_object *obj,
+				u64 offset, u64 length)
+{
+	pgoff_t start = offset >> PAGE_SHIFT;
+	pgoff_t end = DIV_ROUND_UP_ULL(offset + length, PAGE_SIZE);
+
+	lockdep_assert_held(&obj->base.dev->struct_mutex);
+
+	if (!length)
+		return;
+
+	if (!obj->cache_dirty) {
+		obj->cache_dirty_range.start = start;
+		obj->cache_dirty_range.end = end;
+		obj->cache_dirty = true;
+	} else if (obj->cache_dirty_range.end) {
+		obj->cache_dirty_range.start =
+			min(obj->cache_dirty_range.start, start);
+		obj->cache_dirty_range.end =
+			max(obj->cache_dirty_range.end, end);
+	}
+}
+
 bool i915_gem_clflush_object(struct drm_i915_gem_object *obj,
 			     unsigned int flags)
 {
+	pgoff_t start = obj->cache_dirty_range.start;
+	pgoff_t end = obj->cache_dirty_range.end;
 	struct clflush *clflush;
 
 	/*
@@ -129,6 +178,7 @@ bool i915_gem_clflush_object(struct drm_i915_gem_object *obj,
 	 */
 	if (!i915_gem_object_has_struct_page(obj)) {
 		obj->cache_dirty = false;
+		obj->cache_dirty_range.end = 0;
 		return false;
 	}
 
@@ -160,6 +210,8 @@ bool i915_gem_clflush_object(struct drm_i915_gem_object *obj,
 		i915_sw_fence_init(&clflush->wait, i915_clflush_notify);
 
 		clflush->obj = i915_gem_object_get(obj);
+		clflush->start = start;
+		clflush->end = end;
 		INIT_WORK(&clflush->work, i915_clflush_work);
 
 		dma_fence_get(&clflush->dma);
@@ -175,11 +227,12 @@ bool i915_gem_clflush_object(struct drm_i915_gem_object *obj,
 
 		i915_sw_fence_commit(&clflush->wait);
 	} else if (obj->mm.pages) {
-		__i915_do_clflush(obj);
+		__i915_do_clflush(obj, start, end);
 	} else {
 		GEM_BUG_ON(obj->write_domain != I915_GEM_DOMAIN_CPU);
 	}
 
 	obj->cache_dirty = false;
+	obj->cache_dirty_range.end = 0;
 	return true;
 }
@@ -33,4 +33,7 @@ bool i915_gem_clflush_object(struct drm_i915_gem_object *obj,
 #define I915_CLFLUSH_FORCE BIT(0)
 #define I915_CLFLUSH_SYNC BIT(1)
 
+void i915_gem_clflush_add_range(struct drm_i915_gem_object *obj,
+				u64 offset, u64 length);
+
 #endif /* __I915_GEM_CLFLUSH_H__ */
@@ -864,6 +864,9 @@ int i915_gem_context_getparam_ioctl(struct drm_device *dev, void *data,
 	case I915_CONTEXT_PARAM_PRIORITY:
 		args->value = ctx->sched.priority;
 		break;
+	case I915_CONTEXT_PARAM_PREEMPT_TIMEOUT:
+		args->value = ctx->preempt_timeout;
+		break;
 	default:
 		ret = -EINVAL;
 		break;
@@ -939,6 +942,19 @@ int i915_gem_context_setparam_ioctl(struct drm_device *dev, void *data,
 		}
 		break;
 
+	case I915_CONTEXT_PARAM_PREEMPT_TIMEOUT:
+		if (args->size)
+			ret = -EINVAL;
+		else if (!(to_i915(dev)->caps.scheduler & I915_SCHEDULER_CAP_PREEMPTION))
+			ret = -ENODEV;
+		else if (args->value > UINT_MAX)
+			ret = -EINVAL;
+		else if (!capable(CAP_SYS_NICE))
+			ret = -EPERM;
+		else
+			WRITE_ONCE(ctx->preempt_timeout, args->value);
+		break;
+
 	default:
 		ret = -EINVAL;
 		break;
@@ -147,6 +147,13 @@ struct i915_gem_context {
 
 	struct i915_sched_attr sched;
 
+	/**
+	 * @preempt_timeout: how long, in ms, requests from this context let
+	 * a lower priority context delay their preemption before it is
+	 * reset. 0 disables the timeout.
+	 */
+	unsigned int preempt_timeout;
+
 	/** ggtt_offset_bias: placement restriction for context objects */
 	u32 ggtt_offset_bias;
 
@@ -30,6 +30,7 @@
 #include <drm/drmP.h>
 
 #include "i915_drv.h"
+#include "i915_gem_clflush.h"
 
 static struct drm_i915_gem_object *dma_buf_to_obj(struct dma_buf *buf)
 {
@@ -211,6 +212,114 @@ static int i915_gem_end_cpu_access(struct dma_buf *dma_buf, enum dma_data_direct
 	return err;
 }
 
+static void i915_gem_dmabuf_clflush_range(struct drm_i915_gem_object *obj,
+					  unsigned int offset,
+					  unsigned int len)
+{
+	unsigned int idx = offset >> PAGE_SHIFT;
+
+	offset = offset_in_page(offset);
+	while (len) {
+		struct page *page = i915_gem_object_get_page(obj, idx++);
+		unsigned int length = min_t(unsigned int, len,
+					    PAGE_SIZE - offset);
+		void *vaddr;
+
+		vaddr = kmap_atomic(page);
+		drm_clflush_virt_range(vaddr + offset, length);
+		kunmap_atomic(vaddr);
+
+		len -= length;
+		offset = 0;
+	}
+}
+
+/*
+ * Unlike i915_gem_begin_cpu_access(), don't move the whole object into the
+ * CPU domain, as that marks all of it as dirty in the CPU cache and costs a
+ * clflush of every page on the way back to the GPU. Do what pread/pwrite do
+ * instead: invalidate only the cachelines of the range if required and, for
+ * writes, record the range so that only those pages get flushed later.
+ */
+static int i915_gem_begin_cpu_access_partial(struct dma_buf *dma_buf,
+					     enum dma_data_direction direction,
+					     unsigned int offset,
+					     unsigned int len)
+{
+	struct drm_i915_gem_object *obj = dma_buf_to_obj(dma_buf);
+	struct drm_device *dev = obj->base.dev;
+	bool write = (direction == DMA_BIDIRECTIONAL || direction == DMA_TO_DEVICE);
+	unsigned int needs_clflush;
+	int err;
+
+	err = i915_mutex_lock_interruptible(dev);
+	if (err)
+		return err;
+
+	if (write)
+		err = i915_gem_obj_prepare_shmem_write(obj, &needs_clflush);
+	else
+		err = i915_gem_obj_prepare_shmem_read(obj, &needs_clflush);
+	if (err == -ENODEV) {
+		/* no struct pages to flush by hand, take the slow path */
+		mutex_unlock(&dev->struct_mutex);
+		return i915_gem_begin_cpu_access(dma_buf, direction);
+	}
+	if (err)
+		goto out;
+
+	if (needs_clflush & CLFLUSH_BEFORE)
+		i915_gem_dmabuf_clflush_range(obj, offset, len);
+
+	if ((needs_clflush & CLFLUSH_AFTER) || (write && obj->cache_dirty)) {
+		i915_gem_clflush_add_range(obj, offset, len);
+		obj->read_domains = I915_GEM_DOMAIN_CPU;
+		obj->write_domain = I915_GEM_DOMAIN_CPU;
+	}
+
+	i915_gem_obj_finish_shmem_access(obj);
+out:
+	mutex_unlock(&dev->struct_mutex);
+	return err;
+}
+
+static int i915_gem_end_cpu_access_partial(struct dma_buf *dma_buf,
+					   enum dma_data_direction direction,
+					   unsigned int offset,
+					   unsigned int len)
+{
+	struct drm_i915_gem_object *obj = dma_buf_to_obj(dma_buf);
+	struct drm_device *dev = obj->base.dev;
+	bool write = (direction == DMA_BIDIRECTIONAL || direction == DMA_TO_DEVICE);
+	int err;
+
+	err = i915_gem_object_pin_pages(obj);
+	if (err)
+		return err;
+
+	err = i915_mutex_lock_interruptible(dev);
+	if (err)
+		goto out;
+
+	/*
+	 * Pages written through the CPU cache since begin are already
+	 * recorded, this only catches writes to an object that was moved
+	 * back to the CPU domain in between. Moving to the GTT domain then
+	 * flushes just the recorded pages.
+	 */
+	if (write && obj->write_domain == I915_GEM_DOMAIN_CPU &&
+	    !(obj->cache_coherent & I915_BO_CACHE_COHERENT_FOR_WRITE) &&
+	    i915_gem_object_has_struct_page(obj))
+		i915_gem_clflush_add_range(obj, offset, len);
+
+	err = i915_gem_object_set_to_gtt_domain(obj, false);
+	mutex_unlock(&dev->struct_mutex);
+
+out:
+	i915_gem_object_unpin_pages(obj);
+	return err;
+}
+
 static const struct dma_buf_ops i915_dmabuf_ops =  {
 	.map_dma_buf = i915_gem_map_dma_buf,
 	.unmap_dma_buf = i915_gem_unmap_dma_buf,
@@ -222,6 +331,8 @@ static const struct dma_buf_ops i915_dmabuf_ops =  {
 	.vunmap = i915_gem_dmabuf_vunmap,
 	.begin_cpu_access = i915_gem_begin_cpu_access,
 	.end_cpu_access = i915_gem_end_cpu_access,
+	.begin_cpu_access_partial = i915_gem_begin_cpu_access_partial,
+	.end_cpu_access_partial = i915_gem_end_cpu_access_partial,
 };
 
 struct dma_buf *i915_gem_prime_export(struct drm_device *dev,
@@ -152,6 +152,16 @@ enum {
  *      To avoid stalling, execobject.offset should match the current
  *      address of that object within the active context.
  *
+ * Repeated submissions of the same object set are therefore already cheap:
+ * each context keeps a handle to vma lookup table (ctx->handles_vma) so the
+ * objects are not looked up again, objects still bound where the user
+ * expects them are only re-pinned in place, and with I915_EXEC_NO_RELOC the
+ * relocation entries are not even read unless an object had to be moved.
+ * Userspace wanting the fast path should use softpin (EXEC_OBJECT_PINNED)
+ * or feed back the returned execobject.offset and set I915_EXEC_NO_RELOC.
+ * Without NO_RELOC we cannot know that the relocation entries, and the
+ * batch they patch, are unchanged, so they have to be walked every time.
+ *
  * The reservation is done is multiple phases. First we try and keep any
  * object already bound in its current location - so as long as meets the
  * constraints imposed by the new execbuffer. Any object left unbound after the
@@ -43,6 +43,7 @@ void i915_gem_object_set_cache_coherency(struct drm_i915_gem_object *obj,
 	else
 		obj->cache_coherent = 0;
 
-	obj->cache_dirty =
-		!(obj->cache_coherent & I915_BO_CACHE_COHERENT_FOR_WRITE);
+	obj->cache_dirty = false;
+	if (!(obj->cache_coherent & I915_BO_CACHE_COHERENT_FOR_WRITE))
+		i915_gem_object_set_cache_dirty(obj);
 }
@@ -127,6 +127,8 @@ struct drm_i915_gem_object {
 	struct list_head userfault_link;
 
 	struct list_head batch_pool_link;
+	/* jiffies of the last i915_gem_batch_pool_get() of this object */
+	unsigned long batch_pool_age;
 	I915_SELFTEST_DECLARE(struct list_head st_link);
 
 	unsigned long flags;
@@ -147,6 +149,16 @@ struct drm_i915_gem_object {
 #define I915_BO_CACHE_COHERENT_FOR_WRITE BIT(1)
 	unsigned int cache_dirty:1;
 
+	/**
+	 * @cache_dirty_range: Pages [start, end) dirtied through the CPU
+	 * cache while @cache_dirty is set. An empty range (end == 0) means
+	 * the whole object may be dirty, which is what every path other
+	 * than the shmem pwrite records.
+	 */
+	struct {
+		pgoff_t start, end;
+	} cache_dirty_range;
+
 #if IS_ENABLED(CONFIG_DRM_I915_MEMTRACK)
 	unsigned int has_backing_pages:1;
 #endif
@@ -382,6 +394,17 @@ i915_gem_object_has_struct_page(const struct drm_i915_gem_object *obj)
 	return obj->ops->flags & I915_GEM_OBJECT_HAS_STRUCT_PAGE;
 }
 
+/*
+ * Mark the whole object as dirty in the CPU cache, discarding any
+ * narrower range previously recorded by i915_gem_clflush_add_range().
+ */
+static inline void
+i915_gem_object_set_cache_dirty(struct drm_i915_gem_object *obj)
+{
+	obj->cache_dirty = true;
+	obj->cache_dirty_range.end = 0;
+}
+
 static inline bool
 i915_gem_object_is_shrinkable(const struct drm_i915_gem_object *obj)
 {
@@ -36,7 +36,8 @@
 #include "i915_drv.h"
 #include "i915_trace.h"
 
-static bool shrinker_lock(struct drm_i915_private *i915, bool *unlock)
+static bool __shrinker_lock(struct drm_i915_private *i915, bool *unlock,
+			    bool spin)
 {
 	switch (mutex_trylock_recursive(&i915->drm.struct_mutex)) {
 	case MUTEX_TRYLOCK_RECURSIVE:
@@ -45,6 +46,9 @@ static bool shrinker_lock(struct drm_i915_private *i915, bool *unlock)
 
 	case MUTEX_TRYLOCK_FAILED:
 		*unlock = false;
+		if (!spin)
+			return false;
+
 		preempt_disable();
 		do {
 			cpu_relax();
@@ -64,6 +68,11 @@ static bool shrinker_lock(struct drm_i915_private *i915, bool *unlock)
 	BUG();
 }
 
+static bool shrinker_lock(struct drm_i915_private *i915, bool *unlock)
+{
+	return __shrinker_lock(i915, unlock, true);
+}
+
 static void shrinker_unlock(struct drm_i915_private *i915, bool unlock)
 {
 	if (!unlock)
@@ -357,8 +366,23 @@ i915_gem_shrinker_scan(struct shrinker *shrinker, struct shrink_control *sc)
 
 	sc->nr_scanned = 0;
 
-	if (!shrinker_lock(i915, &unlock))
+	/*
+	 * Direct reclaim must not stall behind whoever holds struct_mutex,
+	 * possibly for a long time waiting on the GPU. Hand the request over
+	 * to the reclaim worker instead and let kswapd and the worker do
+	 * the blocking.
+	 */
+	if (!current_is_kswapd() && i915->mm.reclaim_wq) {
+		if (!__shrinker_lock(i915, &unlock, false)) {
+			atomic_long_add(sc->nr_to_scan,
+					&i915->mm.reclaim_target);
+			queue_work(i915->mm.reclaim_wq,
+				   &i915->mm.reclaim_work);
+			return SHRINK_STOP;
+		}
+	} else if (!shrinker_lock(i915, &unlock)) {
 		return SHRINK_STOP;
+	}
 
 	freed = i915_gem_shrink(i915,
 				sc->nr_to_scan,
@@ -388,6 +412,28 @@ i915_gem_shrinker_scan(struct shrinker *shrinker, struct shrink_control *sc)
 	return sc->nr_scanned ? freed : SHRINK_STOP;
 }
 
+static void i915_gem_shrinker_reclaim(struct work_struct *work)
+{
+	struct drm_i915_private *i915 =
+		container_of(work, typeof(*i915), mm.reclaim_work);
+	unsigned long target, freed;
+
+	target = atomic_long_xchg(&i915->mm.reclaim_target, 0);
+	if (!target)
+		return;
+
+	mutex_lock(&i915->drm.struct_mutex);
+	freed = i915_gem_shrink(i915, target, NULL,
+				I915_SHRINK_BOUND |
+				I915_SHRINK_UNBOUND |
+				I915_SHRINK_PURGEABLE);
+	if (freed < target)
+		freed += i915_gem_shrink(i915, target - freed, NULL,
+					 I915_SHRINK_BOUND |
+					 I915_SHRINK_UNBOUND);
+	mutex_unlock(&i915->drm.struct_mutex);
+}
+
 static bool
 shrinker_lock_uninterruptible(struct drm_i915_private *i915, bool *unlock,
 			      int timeout_ms)
@@ -507,6 +553,12 @@ i915_gem_shrinker_vmap(struct notifier_block *nb, unsigned long event, void *ptr
  */
 void i915_gem_shrinker_register(struct drm_i915_private *i915)
 {
+	/* Without the worker, direct reclaim waits for struct_mutex */
+	i915->mm.reclaim_wq = alloc_workqueue("i915-reclaim",
+					      WQ_UNBOUND | WQ_MEM_RECLAIM, 1);
+	INIT_WORK(&i915->mm.reclaim_work, i915_gem_shrinker_reclaim);
+	atomic_long_set(&i915->mm.reclaim_target, 0);
+
 	i915->mm.shrinker.scan_objects = i915_gem_shrinker_scan;
 	i915->mm.shrinker.count_objects = i915_gem_shrinker_count;
 	i915->mm.shrinker.seeks = DEFAULT_SEEKS;
@@ -531,6 +583,11 @@ void i915_gem_shrinker_unregister(struct drm_i915_private *i915)
 	WARN_ON(unregister_vmap_purge_notifier(&i915->mm.vmap_notifier));
 	WARN_ON(unregister_oom_notifier(&i915->mm.oom_notifier));
 	unregister_shrinker(&i915->mm.shrinker);
+
+	if (i915->mm.reclaim_wq) {
+		destroy_workqueue(i915->mm.reclaim_wq);
+		i915->mm.reclaim_wq = NULL;
+	}
 }
 
 void i915_gem_shrinker_taints_mutex(struct mutex *mutex)
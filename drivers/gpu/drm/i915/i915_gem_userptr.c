@@ -412,6 +412,9 @@ i915_gem_userptr_release__mm_struct(struct drm_i915_gem_object *obj)
 	obj->userptr.mm = NULL;
 }
 
+/* Number of user pages faulted in or pinned at a time */
+#define USERPTR_PIN_BATCH 512
+
 struct get_pages_work {
 	struct work_struct work;
 	struct drm_i915_gem_object *obj;
@@ -519,20 +522,26 @@ __i915_gem_userptr_get_pages_worker(struct work_struct *_work)
 
 		ret = -EFAULT;
 		if (mmget_not_zero(mm)) {
-			down_read(&mm->mmap_sem);
 			while (pinned < npages) {
+				/*
+				 * Drop mmap_sem between batches so that a
+				 * large object does not stall page faults
+				 * of the other threads for its whole size.
+				 */
+				down_read(&mm->mmap_sem);
 				ret = get_user_pages_remote
 					(work->task, mm,
 					 obj->userptr.ptr + pinned * PAGE_SIZE,
-					 npages - pinned,
+					 min(npages - pinned,
+					     USERPTR_PIN_BATCH),
 					 flags,
 					 pvec + pinned, NULL, NULL);
+				up_read(&mm->mmap_sem);
 				if (ret < 0)
 					break;
 
 				pinned += ret;
 			}
-			up_read(&mm->mmap_sem);
 			mmput(mm);
 		}
 	}
@@ -728,6 +737,45 @@ static const struct drm_i915_gem_object_ops i915_gem_userptr_ops = {
 	.release = i915_gem_userptr_release,
 };
 
+/*
+ * Fault in the user pages while we are still allowed to take mmap_sem, so
+ * that the first get_pages(), called under struct_mutex, finds them present
+ * and can use the __get_user_pages_fast() path instead of bouncing the
+ * execbuf back to userspace with -EAGAIN while a worker pins them. This is
+ * only a hint: failures are left for get_pages() to report.
+ */
+static void i915_gem_userptr_prefault(unsigned long ptr, unsigned long size,
+				      bool write)
+{
+	unsigned long npages = size >> PAGE_SHIFT;
+	struct page **pvec;
+	int pinned;
+
+	pvec = kmalloc_array(USERPTR_PIN_BATCH, sizeof(*pvec),
+			     GFP_KERNEL | __GFP_NOWARN);
+	if (!pvec)
+		return;
+
+	while (npages) {
+		pinned = get_user_pages_fast(ptr,
+					     min_t(unsigned long, npages,
+						   USERPTR_PIN_BATCH),
+					     write, pvec);
+		if (pinned <= 0)
+			break;
+
+		release_pages(pvec, pinned);
+		ptr += (unsigned long)pinned << PAGE_SHIFT;
+		npages -= pinned;
+
+		if (fatal_signal_pending(current))
+			break;
+		cond_resched();
+	}
+
+	kfree(pvec);
+}
+
 /*
  * Creates a new mm object that wraps some normal memory from the process
  * context - user memory.
@@ -828,6 +876,9 @@ i915_gem_userptr_ioctl(struct drm_device *dev,
 	ret = i915_gem_userptr_init__mm_struct(obj);
 	if (ret == 0)
 		ret = i915_gem_userptr_init__mmu_notifier(obj, args->flags);
+	if (ret == 0)
+		i915_gem_userptr_prefault(obj->userptr.ptr, args->user_size,
+					  !i915_gem_object_is_readonly(obj));
 	if (ret == 0)
 		ret = drm_gem_handle_create(file, &obj->base, &handle);
 
@@ -954,6 +954,15 @@ void __i915_gpu_state_free(struct kref *error_ref)
 			kfree(ee->waiters);
 	}
 
+	while (error->deferred) {
+		struct i915_error_deferred *d = error->deferred;
+
+		error->deferred = d->next;
+		i915_gem_object_unpin_pages(d->obj);
+		i915_gem_object_put(d->obj);
+		kfree(d);
+	}
+
 	for (i = 0; i < ARRAY_SIZE(error->active_bo); i++)
 		kfree(error->active_bo[i]);
 	kfree(error->pinned_bo);
@@ -1026,6 +1035,111 @@ i915_error_object_create(struct drm_i915_private *i915,
 	return dst;
 }
 
+/*
+ * Deferred counterpart to i915_error_object_create(), run from process
+ * context after the reset. The object's pages were pinned when the capture
+ * was taken, and we read them through the CPU rather than the single
+ * error capture GGTT slot, so this can run alongside another capture.
+ */
+static struct drm_i915_error_object *
+i915_error_object_create_deferred(struct i915_error_deferred *d)
+{
+	struct drm_i915_gem_object *obj = d->obj;
+	struct drm_i915_error_object *dst;
+	struct compress compress;
+	unsigned long num_pages;
+	struct sgt_iter iter;
+	struct page *page;
+	int ret;
+
+	num_pages = min_t(u64, d->gtt_size, obj->base.size) >> PAGE_SHIFT;
+	num_pages = DIV_ROUND_UP(10 * num_pages, 8); /* worstcase zlib growth */
+	dst = kmalloc(sizeof(*dst) + num_pages * sizeof(u32 *),
+		      GFP_KERNEL | __GFP_NOWARN);
+	if (!dst)
+		return NULL;
+
+	dst->gtt_offset = d->gtt_offset;
+	dst->gtt_size = d->gtt_size;
+	dst->num_pages = num_pages;
+	dst->page_count = 0;
+	dst->unused = 0;
+
+	if (!compress_init(&compress)) {
+		kfree(dst);
+		return NULL;
+	}
+
+	ret = -EINVAL;
+	for_each_sgt_page(page, iter, obj->mm.pages) {
+		void *s = kmap_atomic(page);
+
+		/* Discard stale cachelines, we want what the GPU wrote */
+		drm_clflush_virt_range(s, PAGE_SIZE);
+		ret = compress_page(&compress, s, dst);
+		kunmap_atomic(s);
+		if (ret)
+			break;
+	}
+
+	if (ret || compress_flush(&compress, dst)) {
+		while (dst->page_count--)
+			free_page((unsigned long)dst->pages[dst->page_count]);
+		kfree(dst);
+		dst = NULL;
+	}
+
+	compress_fini(&compress, dst);
+	return dst;
+}
+
+/*
+ * Capture the contents of @vma into @dst, either right away or, for
+ * ordinary shmem backed buffers when deferring, by keeping a reference to
+ * its pages for the capture worker. Returns false if nothing could be
+ * captured.
+ */
+static bool error_object_capture(struct i915_gpu_state *error,
+				 struct i915_vma *vma,
+				 struct drm_i915_error_object **dst)
+{
+	struct drm_i915_gem_object *obj;
+	struct i915_error_deferred *d;
+
+	*dst = NULL;
+	if (!vma)
+		return false;
+
+	obj = vma->obj;
+	if (!error->defer ||
+	    vma->pages != obj->mm.pages ||
+	    !i915_gem_object_has_struct_page(obj) ||
+	    !i915_gem_object_has_pinned_pages(obj))
+		goto now;
+
+	d = kmalloc(sizeof(*d), GFP_ATOMIC | __GFP_NOWARN);
+	if (!d)
+		goto now;
+
+	if (!kref_get_unless_zero(&obj->base.refcount)) {
+		kfree(d);
+		goto now;
+	}
+	__i915_gem_object_pin_pages(obj);
+
+	d->obj = obj;
+	d->dst = dst;
+	d->gtt_offset = vma->node.start;
+	d->gtt_size = vma->node.size;
+	d->next = error->deferred;
+	error->deferred = d;
+	return true;
+
+now:
+	*dst = i915_error_object_create(error->i915, vma);
+	return *dst;
+}
+
 /* The error capture is special as tries to run underneath the normal
  * locking rules - so we use the raw version of the i915_gem_active lookup.
  */
@@ -1421,7 +1535,8 @@ static void record_context(struct drm_i915_error_context *e,
 	e->active = atomic_read(&ctx->active_count);
 }
 
-static void request_record_user_bo(struct i915_request *request,
+static void request_record_user_bo(struct i915_gpu_state *error,
+				   struct i915_request *request,
 				   struct drm_i915_error_engine *ee)
 {
 	struct i915_capture_list *c;
@@ -1440,8 +1555,7 @@ static void request_record_user_bo(struct i915_request *request,
 
 	count = 0;
 	for (c = request->capture_list; c; c = c->next) {
-		bo[count] = i915_error_object_create(request->i915, c->vma);
-		if (!bo[count])
+		if (!error_object_capture(error, c->vma, &bo[count]))
 			break;
 		count++;
 	}
@@ -1503,18 +1617,17 @@ static void gem_record_rings(struct i915_gpu_state *error)
 			 * as the simplest method to avoid being overwritten
 			 * by userspace.
 			 */
-			ee->batchbuffer =
-				i915_error_object_create(i915, request->batch);
+			error_object_capture(error, request->batch,
+					     &ee->batchbuffer);
 
 			if (HAS_BROKEN_CS_TLB(i915))
 				ee->wa_batchbuffer =
 					i915_error_object_create(i915,
 								 engine->scratch);
-			request_record_user_bo(request, ee);
+			request_record_user_bo(error, request, ee);
 
-			ee->ctx =
-				i915_error_object_create(i915,
-							 request->hw_context->state);
+			error_object_capture(error, request->hw_context->state,
+					     &ee->ctx);
 
 			error->simulated |=
 				i915_gem_context_no_error_capture(ctx);
@@ -1526,8 +1639,7 @@ static void gem_record_rings(struct i915_gpu_state *error)
 			ring = request->ring;
 			ee->cpu_ring_head = ring->head;
 			ee->cpu_ring_tail = ring->tail;
-			ee->ringbuffer =
-				i915_error_object_create(i915, ring->vma);
+			error_object_capture(error, ring->vma, &ee->ringbuffer);
 
 			engine_record_requests(engine, request, ee);
 		}
@@ -1831,8 +1943,8 @@ static int capture(void *data)
 
 #define DAY_AS_SECONDS(x) (24 * 60 * 60 * (x))
 
-struct i915_gpu_state *
-i915_capture_gpu_state(struct drm_i915_private *i915)
+static struct i915_gpu_state *
+__i915_capture_gpu_state(struct drm_i915_private *i915, bool defer)
 {
 	struct i915_gpu_state *error;
 
@@ -1842,12 +1954,87 @@ i915_capture_gpu_state(struct drm_i915_private *i915)
 
 	kref_init(&error->ref);
 	error->i915 = i915;
+	error->defer = defer;
 
 	stop_machine(capture, error, NULL);
 
 	return error;
 }
 
+struct i915_gpu_state *
+i915_capture_gpu_state(struct drm_i915_private *i915)
+{
+	return __i915_capture_gpu_state(i915, false);
+}
+
+static void i915_error_state_publish(struct i915_gpu_state *error)
+{
+	struct drm_i915_private *i915 = error->i915;
+	static bool warned;
+	unsigned long flags;
+
+	if (!error->simulated) {
+		spin_lock_irqsave(&i915->gpu_error.lock, flags);
+		if (!i915->gpu_error.first_error) {
+			i915->gpu_error.first_error = error;
+			error = NULL;
+		}
+		spin_unlock_irqrestore(&i915->gpu_error.lock, flags);
+	}
+
+	if (error) {
+		__i915_gpu_state_free(&error->ref);
+		return;
+	}
+
+	if (!warned &&
+	    ktime_get_real_seconds() - DRIVER_TIMESTAMP < DAY_AS_SECONDS(180)) {
+		DRM_INFO("GPU hangs can indicate a bug anywhere in the entire gfx stack, including userspace.\n");
+		DRM_INFO("Please file a _new_ bug report on bugs.freedesktop.org against DRI -> DRM/Intel\n");
+		DRM_INFO("drm/i915 developers can then reassign to the right component if it's not a kernel issue.\n");
+		DRM_INFO("The gpu crash dump is required to analyze gpu hangs, so please always attach it.\n");
+		DRM_INFO("GPU crash dump saved to /sys/class/drm/card%d/error\n",
+			 i915->drm.primary->index);
+		warned = true;
+	}
+}
+
+static void i915_error_capture_work(struct work_struct *work)
+{
+	struct drm_i915_private *i915 =
+		container_of(work, typeof(*i915), gpu_error.capture_work);
+	struct i915_gpu_state *error;
+	struct i915_error_deferred *d;
+
+	spin_lock_irq(&i915->gpu_error.lock);
+	error = i915->gpu_error.capture_pending;
+	i915->gpu_error.capture_pending = NULL;
+	spin_unlock_irq(&i915->gpu_error.lock);
+	if (!error)
+		return;
+
+	while ((d = error->deferred)) {
+		error->deferred = d->next;
+
+		*d->dst = i915_error_object_create_deferred(d);
+
+		i915_gem_object_unpin_pages(d->obj);
+		i915_gem_object_put(d->obj);
+		kfree(d);
+	}
+
+	i915_error_state_publish(error);
+}
+
+/**
+ * i915_error_state_init - initialise the deferred error capture
+ * @i915: i915 device
+ */
+void i915_error_state_init(struct drm_i915_private *i915)
+{
+	INIT_WORK(&i915->gpu_error.capture_work, i915_error_capture_work);
+}
+
 /**
  * i915_capture_error_state - capture an error record for later analysis
  * @i915: i915 device
@@ -1863,9 +2050,9 @@ void i915_capture_error_state(struct drm_i915_private *i915,
 			      u32 engine_mask,
 			      const char *error_msg)
 {
-	static bool warned;
 	struct i915_gpu_state *error;
 	unsigned long flags;
+	bool defer;
 
 	if (!i915_modparams.error_capture)
 		return;
@@ -1873,7 +2060,11 @@ void i915_capture_error_state(struct drm_i915_private *i915,
 	if (READ_ONCE(i915->gpu_error.first_error))
 		return;
 
-	error = i915_capture_gpu_state(i915);
+	/* Only one capture may be pending on the worker at a time */
+	defer = READ_ONCE(i915->gpu_error.capture_deferred) &&
+		!READ_ONCE(i915->gpu_error.capture_pending);
+
+	error = __i915_capture_gpu_state(i915, defer);
 	if (!error) {
 		DRM_DEBUG_DRIVER("out of memory, not capturing error state\n");
 		return;
@@ -1882,30 +2073,22 @@ void i915_capture_error_state(struct drm_i915_private *i915,
 	i915_error_capture_msg(i915, error, engine_mask, error_msg);
 	DRM_INFO("%s\n", error->error_msg);
 
-	if (!error->simulated) {
+	if (error->deferred) {
 		spin_lock_irqsave(&i915->gpu_error.lock, flags);
-		if (!i915->gpu_error.first_error) {
-			i915->gpu_error.first_error = error;
+		if (!i915->gpu_error.capture_pending) {
+			i915->gpu_error.capture_pending = error;
 			error = NULL;
 		}
 		spin_unlock_irqrestore(&i915->gpu_error.lock, flags);
-	}
 
-	if (error) {
-		__i915_gpu_state_free(&error->ref);
-		return;
+		if (!error) {
+			queue_work(system_unbound_wq,
+				   &i915->gpu_error.capture_work);
+			return;
+		}
 	}
 
-	if (!warned &&
-	    ktime_get_real_seconds() - DRIVER_TIMESTAMP < DAY_AS_SECONDS(180)) {
-		DRM_INFO("GPU hangs can indicate a bug anywhere in the entire gfx stack, including userspace.\n");
-		DRM_INFO("Please file a _new_ bug report on bugs.freedesktop.org against DRI -> DRM/Intel\n");
-		DRM_INFO("drm/i915 developers can then reassign to the right component if it's not a kernel issue.\n");
-		DRM_INFO("The gpu crash dump is required to analyze gpu hangs, so please always attach it.\n");
-		DRM_INFO("GPU crash dump saved to /sys/class/drm/card%d/error\n",
-			 i915->drm.primary->index);
-		warned = true;
-	}
+	i915_error_state_publish(error);
 }
 
 struct i915_gpu_state *
@@ -1924,12 +2107,17 @@ i915_first_error_state(struct drm_i915_private *i915)
 
 void i915_reset_error_state(struct drm_i915_private *i915)
 {
-	struct i915_gpu_state *error;
+	struct i915_gpu_state *error, *pending;
+
+	cancel_work_sync(&i915->gpu_error.capture_work);
 
 	spin_lock_irq(&i915->gpu_error.lock);
 	error = i915->gpu_error.first_error;
 	i915->gpu_error.first_error = NULL;
+	pending = i915->gpu_error.capture_pending;
+	i915->gpu_error.capture_pending = NULL;
 	spin_unlock_irq(&i915->gpu_error.lock);
 
+	i915_gpu_state_put(pending);
 	i915_gpu_state_put(error);
 }
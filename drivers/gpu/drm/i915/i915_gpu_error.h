@@ -192,6 +192,20 @@ struct i915_gpu_state {
 	} *active_bo[I915_NUM_ENGINES], *pinned_bo;
 	u32 active_bo_count[I915_NUM_ENGINES], pinned_bo_count;
 	struct i915_address_space *active_vm[I915_NUM_ENGINES];
+
+	/*
+	 * Buffers whose contents are copied by the capture worker after the
+	 * reset rather than under stop_machine(), see
+	 * i915_gpu_error.capture_deferred.
+	 */
+	bool defer;
+	struct i915_error_deferred {
+		struct i915_error_deferred *next;
+		struct drm_i915_gem_object *obj;
+		struct drm_i915_error_object **dst;
+		u64 gtt_offset;
+		u64 gtt_size;
+	} *deferred;
 };
 
 struct i915_gpu_error {
@@ -294,6 +308,17 @@ struct i915_gpu_error {
 
 	/* For missed irq/seqno simulation. */
 	unsigned long test_irq_rings;
+
+	/**
+	 * @capture_deferred: Only snapshot registers and ring state while
+	 * the machine is stopped, leaving the copy of buffer contents to
+	 * @capture_work so that hang recovery is not held up by it. The
+	 * error state being completed is kept in @capture_pending, under
+	 * @lock, until then.
+	 */
+	bool capture_deferred;
+	struct i915_gpu_state *capture_pending;
+	struct work_struct capture_work;
 };
 
 struct drm_i915_error_state_buf {
@@ -350,6 +375,7 @@ static inline void i915_gpu_state_put(struct i915_gpu_state *gpu)
 
 struct i915_gpu_state *i915_first_error_state(struct drm_i915_private *i915);
 void i915_reset_error_state(struct drm_i915_private *i915);
+void i915_error_state_init(struct drm_i915_private *i915);
 
 #else
 
@@ -369,6 +395,10 @@ static inline void i915_reset_error_state(struct drm_i915_private *i915)
 {
 }
 
+static inline void i915_error_state_init(struct drm_i915_private *i915)
+{
+}
+
 #endif /* IS_ENABLED(CONFIG_DRM_I915_CAPTURE_ERROR) */
 
 #endif /* _I915_GPU_ERROR_H_ */
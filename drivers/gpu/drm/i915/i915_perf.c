@@ -340,6 +340,8 @@ static const struct i915_oa_format gen8_plus_oa_formats[I915_OA_FORMAT_MAX] = {
  * @sample_flags: `DRM_I915_PERF_PROP_SAMPLE_*` properties are tracked as flags
  * @single_context: Whether a single or all gpu contexts should be monitored
  * @ctx_handle: A gem ctx handle for use with @single_context
+ * @gvt_vgpu: Whether @single_context refers to a GVT-g vGPU
+ * @vgpu_id: The vGPU whose shadow context is used with @gvt_vgpu
  * @metrics_set: An ID for an OA unit metric set advertised via sysfs
  * @oa_format: An OA unit HW report format
  * @oa_periodic: Whether to enable periodic OA unit sampling
@@ -353,7 +355,9 @@ struct perf_open_properties {
 	u32 sample_flags;
 
 	u64 single_context:1;
+	u64 gvt_vgpu:1;
 	u64 ctx_handle;
+	u32 vgpu_id;
 
 	/* OA sampling state */
 	int metrics_set;
@@ -2644,7 +2648,15 @@ i915_perf_open_ioctl_locked(struct drm_i915_private *dev_priv,
 	int stream_fd;
 	int ret;
 
-	if (props->single_context) {
+	if (props->gvt_vgpu) {
+		specific_ctx = intel_gvt_vgpu_context(dev_priv, props->vgpu_id);
+		if (!specific_ctx) {
+			DRM_DEBUG("Failed to look up vGPU %u for opening perf stream\n",
+				  props->vgpu_id);
+			ret = -ENOENT;
+			goto err;
+		}
+	} else if (props->single_context) {
 		u32 ctx_handle = props->ctx_handle;
 		struct drm_i915_file_private *file_priv = file->driver_priv;
 
@@ -2671,7 +2683,7 @@ i915_perf_open_ioctl_locked(struct drm_i915_private *dev_priv,
 	 * MI_REPORT_PERF_COUNT commands and so consider it a privileged op to
 	 * enable the OA unit by default.
 	 */
-	if (IS_HASWELL(dev_priv) && specific_ctx)
+	if (IS_HASWELL(dev_priv) && specific_ctx && !props->gvt_vgpu)
 		privileged_op = false;
 
 	/* Similar to perf's kernel.perf_paranoid_cpu sysctl option
@@ -2807,9 +2819,26 @@ static int read_properties_unlocked(struct drm_i915_private *dev_priv,
 
 		switch ((enum drm_i915_perf_property_id)id) {
 		case DRM_I915_PERF_PROP_CTX_HANDLE:
+			if (props->gvt_vgpu) {
+				DRM_DEBUG("Context handle and vGPU id are mutually exclusive\n");
+				return -EINVAL;
+			}
 			props->single_context = 1;
 			props->ctx_handle = value;
 			break;
+		case DRM_I915_PERF_PROP_GVT_VGPU_ID:
+			if (props->single_context) {
+				DRM_DEBUG("Context handle and vGPU id are mutually exclusive\n");
+				return -EINVAL;
+			}
+			if (value > U32_MAX) {
+				DRM_DEBUG("Out-of-range vGPU id %llu\n", value);
+				return -EINVAL;
+			}
+			props->single_context = 1;
+			props->gvt_vgpu = 1;
+			props->vgpu_id = value;
+			break;
 		case DRM_I915_PERF_PROP_SAMPLE_OA:
 			if (value)
 				props->sample_flags |= SAMPLE_OA_REPORT;
@@ -329,6 +329,14 @@ engine_event_status(struct intel_engine_cs *engine,
 		if (INTEL_GEN(engine->i915) < 6)
 			return -ENODEV;
 		break;
+	case I915_SAMPLE_QUEUE_TIME:
+		break;
+	case I915_SAMPLE_EXEC_TIME:
+		/* Only execlists tells us when a context starts and ends */
+		if (!HAS_EXECLISTS(engine->i915) ||
+		    USES_GUC_SUBMISSION(engine->i915))
+			return -ENODEV;
+		break;
 	default:
 		return -ENOENT;
 	}
@@ -539,6 +547,10 @@ static u64 __i915_pmu_event_read(struct perf_event *event)
 		} else if (sample == I915_SAMPLE_BUSY &&
 			   intel_engine_supports_stats(engine)) {
 			val = ktime_to_ns(intel_engine_get_busy_time(engine));
+		} else if (sample == I915_SAMPLE_QUEUE_TIME) {
+			val = READ_ONCE(engine->queue_time.total_ns);
+		} else if (sample == I915_SAMPLE_EXEC_TIME) {
+			val = READ_ONCE(engine->exec_time.total_ns);
 		} else {
 			val = engine->pmu.sample[sample].cur;
 		}
@@ -618,7 +630,7 @@ static void i915_pmu_enable(struct perf_event *event)
 		GEM_BUG_ON(!engine);
 		engine->pmu.enable |= BIT(sample);
 
-		GEM_BUG_ON(sample >= I915_PMU_SAMPLE_BITS);
+		GEM_BUG_ON(sample >= I915_ENGINE_SAMPLE_MAX);
 		GEM_BUG_ON(engine->pmu.enable_count[sample] == ~0);
 		engine->pmu.enable_count[sample]++;
 	}
@@ -650,7 +662,7 @@ static void i915_pmu_disable(struct perf_event *event)
 						  engine_event_class(event),
 						  engine_event_instance(event));
 		GEM_BUG_ON(!engine);
-		GEM_BUG_ON(sample >= I915_PMU_SAMPLE_BITS);
+		GEM_BUG_ON(sample >= I915_ENGINE_SAMPLE_MAX);
 		GEM_BUG_ON(engine->pmu.enable_count[sample] == 0);
 		/*
 		 * Decrement the reference count and clear the enabled
@@ -839,6 +851,8 @@ create_event_attributes(struct drm_i915_private *i915)
 		__engine_event(I915_SAMPLE_BUSY, "busy"),
 		__engine_event(I915_SAMPLE_SEMA, "sema"),
 		__engine_event(I915_SAMPLE_WAIT, "wait"),
+		__engine_event(I915_SAMPLE_QUEUE_TIME, "queue-time"),
+		__engine_event(I915_SAMPLE_EXEC_TIME, "exec-time"),
 	};
 	unsigned int count = 0;
 	struct perf_pmu_events_attr *pmu_attr = NULL, *pmu_iter;
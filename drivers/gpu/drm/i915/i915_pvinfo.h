@@ -97,6 +97,25 @@ struct pv_ggtt_update {
 	u32 cache_level;
 };
 
+/*
+ * Paravirtualized submission ring, one per engine. The guest fills
+ * descs[tail % PV_SUBMIT_SLOTS] with the four ELSP dwords in the order
+ * they'd be written to the port and bumps tail; gvt consumes entries
+ * and bumps head. While busy is set gvt still has workloads queued on
+ * that engine and will pick up new entries when one of them completes,
+ * so the guest only has to kick (write ELSP) when busy is clear.
+ */
+#define PV_SUBMIT_SLOTS		4
+#define PV_SUBMIT_ENGINES	8
+
+struct pv_submission {
+	u32 head;
+	u32 tail;
+	u32 busy;
+	u32 rsvd;
+	u32 descs[PV_SUBMIT_SLOTS][4];
+};
+
 /* shared page(4KB) between gvt and VM, located at the first page next
  * to MMIO region(2MB size normally).
  */
@@ -107,7 +126,8 @@ struct gvt_shared_page {
 	struct pv_plane_wm_update pv_plane_wm;
 	struct pv_ppgtt_update pv_ppgtt;
 	struct pv_ggtt_update pv_ggtt;
-	u32 rsvd2[0x400 - 46];
+	struct pv_submission pv_submit[PV_SUBMIT_ENGINES];
+	u32 rsvd2[0x400 - 46 - 160];
 };
 
 #define VGPU_PVMMIO(vgpu) vgpu_vreg_t(vgpu, vgtif_reg(enable_pvmmio))
@@ -121,6 +141,7 @@ enum pvmmio_levels {
 	PVMMIO_PLANE_WM_UPDATE = 0x4,
 	PVMMIO_PPGTT_UPDATE = 0x10,
 	PVMMIO_GGTT_UPDATE = 0x20,
+	PVMMIO_PV_SUBMIT = 0x40,
 };
 
 /*
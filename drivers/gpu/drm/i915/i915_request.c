@@ -525,6 +525,15 @@ void __i915_request_submit(struct i915_request *request)
 
 	GEM_BUG_ON(request->global_seqno);
 
+	/* Resubmission after preemption is not queueing delay */
+	if (request->submit_time) {
+		intel_engine_account_latency(&engine->queue_time,
+					     request->sched.attr.priority,
+					     ktime_sub(ktime_get(),
+						       request->submit_time));
+		request->submit_time = 0;
+	}
+
 	seqno = timeline_get_seqno(&engine->timeline);
 	GEM_BUG_ON(!seqno);
 	GEM_BUG_ON(i915_seqno_passed(intel_engine_get_seqno(engine), seqno));
@@ -624,6 +633,7 @@ submit_notify(struct i915_sw_fence *fence, enum i915_sw_fence_notify state)
 	switch (state) {
 	case FENCE_COMPLETE:
 		trace_i915_request_submit(request);
+		request->submit_time = ktime_get();
 		/*
 		 * We need to serialize use of the submit_request() callback
 		 * with its hotplugging performed during an emergency
@@ -788,6 +798,7 @@ i915_request_alloc(struct intel_engine_cs *engine, struct i915_gem_context *ctx)
 	rq->batch = NULL;
 	rq->capture_list = NULL;
 	rq->waitboost = false;
+	rq->submit_time = 0;
 
 	/*
 	 * Reserve space in the ring buffer for all the commands required to
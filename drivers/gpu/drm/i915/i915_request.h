@@ -169,6 +169,14 @@ struct i915_request {
 	/** Time at which this request was emitted, in jiffies. */
 	unsigned long emitted_jiffies;
 
+	/**
+	 * Time at which all of the request's fences signaled and it was
+	 * passed to the backend, cleared once accounted at execution.
+	 */
+	ktime_t submit_time;
+	/** Time at which the request's context was scheduled in (execlists). */
+	ktime_t exec_start;
+
 	bool waitboost;
 
 	/** engine->request_list entry for this request */
@@ -101,4 +101,11 @@ bool __igt_timeout(unsigned long timeout, const char *fmt, ...);
 #define igt_timeout(t, fmt, ...) \
 	__igt_timeout((t), KERN_DEBUG pr_fmt(fmt), ##__VA_ARGS__)
 
+/*
+ * Results of the performance subtests are printed as a single line of
+ * key=value pairs, so that they can be collected and compared by scripts.
+ */
+#define igt_perf(test, fmt, ...) \
+	pr_info("i915_perf: test=%s " fmt "\n", (test), ##__VA_ARGS__)
+
 #endif /* !__I915_SELFTEST_H__ */
@@ -669,9 +669,24 @@ static int intel_breadcrumbs_signaler(void *arg)
 		spin_unlock_irq(&b->rb_lock);
 
 		if (!list_empty(&list)) {
+			struct dma_fence *fences[16];
+			unsigned int count = 0;
+
+			/*
+			 * Mark a whole batch of completed requests as
+			 * signaled before running any of their callbacks.
+			 */
 			local_bh_disable();
+			list_for_each_entry(rq, &list, signaling.link) {
+				fences[count++] = &rq->fence;
+				if (count == ARRAY_SIZE(fences)) {
+					dma_fence_signal_batch(fences, count);
+					count = 0;
+				}
+			}
+			dma_fence_signal_batch(fences, count);
+
 			list_for_each_entry_safe(rq, n, &list, signaling.link) {
-				dma_fence_signal(&rq->fence);
 				GEM_BUG_ON(!i915_request_completed(rq));
 				i915_request_put(rq);
 			}
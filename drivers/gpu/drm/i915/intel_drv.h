@@ -951,6 +951,18 @@ struct intel_crtc {
 		int scanline_start;
 	} debug;
 
+	/*
+	 * Vblank evasion timing: a running average of how long programming
+	 * an update under evasion takes, which sizes the evasion window, and
+	 * how many updates still straddled a vblank.
+	 */
+	struct {
+		unsigned int update_ns;
+		unsigned int evade_us;
+		unsigned int updates;
+		unsigned int misses;
+	} commit_timing;
+
 	/* scalers available on this crtc */
 	int num_scalers;
 };
@@ -2075,6 +2087,8 @@ void intel_init_clock_gating_hooks(struct drm_i915_private *dev_priv);
 void intel_pm_setup(struct drm_i915_private *dev_priv);
 void intel_gpu_ips_init(struct drm_i915_private *dev_priv);
 void intel_gpu_ips_teardown(void);
+void intel_gpu_busy_init(struct drm_i915_private *dev_priv);
+void intel_gpu_busy_teardown(void);
 void intel_init_gt_powersave(struct drm_i915_private *dev_priv);
 void intel_cleanup_gt_powersave(struct drm_i915_private *dev_priv);
 void intel_sanitize_gt_powersave(struct drm_i915_private *dev_priv);
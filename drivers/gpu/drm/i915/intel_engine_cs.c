@@ -1711,6 +1711,40 @@ void intel_disable_engine_stats(struct intel_engine_cs *engine)
 	write_sequnlock_irqrestore(&engine->stats.lock, flags);
 }
 
+/**
+ * intel_engine_account_latency - add a request latency sample
+ * @lat: the latency statistics to update
+ * @prio: priority of the request the sample belongs to
+ * @delta: the latency
+ *
+ * Callers must serialise updates to the same @lat, readers (PMU, debugfs)
+ * only ever see torn histograms, never torn totals on 64-bit.
+ */
+void intel_engine_account_latency(struct intel_engine_latency *lat,
+				  int prio, ktime_t delta)
+{
+	u64 ns = max_t(s64, ktime_to_ns(delta), 0);
+	u64 us = div_u64(ns, NSEC_PER_USEC);
+	unsigned int band, bucket;
+
+	if (prio < I915_PRIORITY_NORMAL)
+		band = INTEL_ENGINE_LATENCY_PRIO_LOW;
+	else if (prio == I915_PRIORITY_NORMAL)
+		band = INTEL_ENGINE_LATENCY_PRIO_NORMAL;
+	else
+		band = INTEL_ENGINE_LATENCY_PRIO_HIGH;
+
+	bucket = us ? min_t(unsigned int, ilog2(us),
+			    INTEL_ENGINE_LATENCY_BUCKETS - 1) : 0;
+
+	WRITE_ONCE(lat->total_ns, lat->total_ns + ns);
+	lat->count[band]++;
+	lat->sum_ns[band] += ns;
+	if (ns > lat->max_ns[band])
+		lat->max_ns[band] = ns;
+	lat->hist[band][bucket]++;
+}
+
 #if IS_ENABLED(CONFIG_DRM_I915_SELFTEST)
 #include "selftests/mock_engine.c"
 #include "selftests/intel_engine_cs.c"
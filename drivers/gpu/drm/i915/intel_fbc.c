@@ -46,6 +46,11 @@ static inline bool fbc_supported(struct drm_i915_private *dev_priv)
 	return HAS_FBC(dev_priv);
 }
 
+/*
+ * Gen2/3 can't use FBC while any other pipe is active. Later platforms have
+ * no such restriction, but still only a single compressor tied to one
+ * primary plane at a time, see intel_fbc_choose_crtc().
+ */
 static inline bool no_fbc_on_multiple_pipes(struct drm_i915_private *dev_priv)
 {
 	return INTEL_GEN(dev_priv) <= 3;
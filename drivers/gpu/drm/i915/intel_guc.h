@@ -73,6 +73,9 @@ struct intel_guc {
 	struct guc_preempt_work preempt_work[I915_NUM_ENGINES];
 	struct workqueue_struct *preempt_wq;
 
+	/* Completed GVT-g requests whose context may not be saved yet */
+	struct i915_request *switch_out[I915_NUM_ENGINES];
+
 	DECLARE_BITMAP(doorbell_bitmap, GUC_NUM_DOORBELLS);
 	/* Cyclic counter mod pagesize	*/
 	u32 db_cacheline;
@@ -91,6 +94,13 @@ struct intel_guc {
 	int (*send)(struct intel_guc *guc, const u32 *data, u32 len,
 		    u32 *response_buf, u32 response_buf_size);
 
+	/*
+	 * GuC's FW specific non-blocking send function, for actions whose
+	 * result is not needed. May be NULL.
+	 */
+	int (*send_nb)(struct intel_guc *guc, const u32 *data, u32 len,
+		       bool more);
+
 	/* GuC's FW specific event handler function */
 	void (*handler)(struct intel_guc *guc);
 
@@ -104,6 +114,22 @@ inline int intel_guc_send(struct intel_guc *guc, const u32 *action, u32 len)
 	return guc->send(guc, action, len, NULL, 0);
 }
 
+/*
+ * Queue an action without waiting for the GuC to process it. Set @more when
+ * further actions follow, to ring the doorbell only once for the whole
+ * batch; a later blocking send also flushes anything left queued. Falls
+ * back to a blocking send when the transport has no queue.
+ */
+static inline int
+intel_guc_send_nb(struct intel_guc *guc, const u32 *action, u32 len,
+		  bool more)
+{
+	if (guc->send_nb)
+		return guc->send_nb(guc, action, len, more);
+
+	return intel_guc_send(guc, action, len);
+}
+
 static inline int
 intel_guc_send_and_receive(struct intel_guc *guc, const u32 *action, u32 len,
 			   u32 *response_buf, u32 response_buf_size)
@@ -564,6 +564,62 @@ static int intel_guc_send_ct(struct intel_guc *guc, const u32 *action, u32 len,
 	return ret;
 }
 
+static int ctch_send_nb(struct intel_guc_ct *ct,
+			struct intel_guc_ct_channel *ctch,
+			const u32 *action,
+			u32 len,
+			bool more)
+{
+	struct intel_guc_ct_buffer *ctb = &ctch->ctbs[CTB_SEND];
+	u32 fence;
+	int err;
+
+	GEM_BUG_ON(!ctch_is_open(ctch));
+	GEM_BUG_ON(!len);
+	GEM_BUG_ON(len & ~GUC_CT_MSG_LEN_MASK);
+
+	fence = ctch_get_next_fence(ctch);
+
+	/*
+	 * If the buffer is full of queued messages, let the GuC drain it.
+	 * No GuC command should ever take longer than 10ms.
+	 */
+#define done (ctb_write(ctb, action, len, fence, false) != -ENOSPC)
+	err = 0;
+	if (unlikely(!done)) {
+		intel_guc_notify(ct_to_guc(ct));
+		err = wait_for(done, 10);
+	}
+#undef done
+	if (unlikely(err))
+		return -ENOSPC;
+
+	if (!more)
+		intel_guc_notify(ct_to_guc(ct));
+
+	return 0;
+}
+
+/*
+ * Command Transport (CT) buffer based GuC non-blocking send function.
+ */
+static int intel_guc_send_nb_ct(struct intel_guc *guc, const u32 *action,
+				u32 len, bool more)
+{
+	struct intel_guc_ct *ct = &guc->ct;
+	int ret;
+
+	mutex_lock(&guc->send_mutex);
+
+	ret = ctch_send_nb(ct, &ct->host_channel, action, len, more);
+	if (unlikely(ret))
+		DRM_ERROR("CT: queue action %#X failed; err=%d\n",
+			  action[0], ret);
+
+	mutex_unlock(&guc->send_mutex);
+	return ret;
+}
+
 static inline unsigned int ct_header_get_len(u32 header)
 {
 	return (header >> GUC_CT_MSG_LEN_SHIFT) & GUC_CT_MSG_LEN_MASK;
@@ -874,6 +930,7 @@ int intel_guc_ct_enable(struct intel_guc_ct *ct)
 
 	/* Switch into cmd transport buffer based send() */
 	guc->send = intel_guc_send_ct;
+	guc->send_nb = intel_guc_send_nb_ct;
 	guc->handler = intel_guc_to_host_event_handler_ct;
 	DRM_INFO("CT: %s\n", enableddisabled(true));
 	return 0;
@@ -900,6 +957,7 @@ void intel_guc_ct_disable(struct intel_guc_ct *ct)
 
 	/* Disable send */
 	guc->send = intel_guc_send_nop;
+	guc->send_nb = NULL;
 	guc->handler = intel_guc_to_host_event_handler_nop;
 	DRM_INFO("CT: %s\n", enableddisabled(false));
 }
@@ -44,7 +44,8 @@ static int guc_action_flush_log_complete(struct intel_guc *guc)
 		INTEL_GUC_ACTION_LOG_BUFFER_FILE_FLUSH_COMPLETE
 	};
 
-	return intel_guc_send(guc, action, ARRAY_SIZE(action));
+	/* Nothing to wait for, the GuC just resumes logging */
+	return intel_guc_send_nb(guc, action, ARRAY_SIZE(action), false);
 }
 
 static int guc_action_flush_log(struct intel_guc *guc)
@@ -622,6 +622,53 @@ static void wait_for_guc_preempt_report(struct intel_engine_cs *engine)
 	report->report_return_status = INTEL_GUC_REPORT_STATUS_UNKNOWN;
 }
 
+/*
+ * GVT-g tracks its shadow contexts through the engine context status
+ * notifier, as with execlists, and copies a shadow context back to the
+ * guest once it is scheduled out. GuC doesn't forward context switch
+ * events to the host, and the breadcrumb is written before the context
+ * image is saved. So a completed GVT-g request is held back until the
+ * engine has moved on: until a later request completes, or a preemption
+ * to idle has finished.
+ */
+static inline void
+guc_context_status_change(struct i915_request *rq, unsigned long status)
+{
+	if (!IS_ENABLED(CONFIG_DRM_I915_GVT))
+		return;
+
+	atomic_notifier_call_chain(&rq->engine->context_status_notifier,
+				   status, rq);
+}
+
+static void guc_flush_switch_out(struct intel_engine_cs *engine)
+{
+	struct i915_request *rq;
+
+	rq = fetch_and_zero(&engine->i915->guc.switch_out[engine->id]);
+	if (rq) {
+		guc_context_status_change(rq, INTEL_CONTEXT_SCHEDULE_OUT);
+		i915_request_put(rq);
+	}
+}
+
+/* Takes over the port's reference to @rq */
+static void guc_context_switch_out(struct intel_engine_cs *engine,
+				   struct i915_request *rq)
+{
+	/* @rq ran after the held back request, so that one was saved */
+	guc_flush_switch_out(engine);
+
+	if (IS_ENABLED(CONFIG_DRM_I915_GVT) &&
+	    i915_gem_context_force_single_submission(rq->gem_context)) {
+		engine->i915->guc.switch_out[engine->id] = rq;
+		return;
+	}
+
+	guc_context_status_change(rq, INTEL_CONTEXT_SCHEDULE_OUT);
+	i915_request_put(rq);
+}
+
 static void complete_preempt_context(struct intel_engine_cs *engine)
 {
 	struct intel_engine_execlists *execlists = &engine->execlists;
@@ -636,6 +683,9 @@ static void complete_preempt_context(struct intel_engine_cs *engine)
 
 	wait_for_guc_preempt_report(engine);
 	intel_write_status_page(engine, I915_GEM_HWS_PREEMPT_INDEX, 0);
+
+	/* The engine went idle through the preempt context */
+	guc_flush_switch_out(engine);
 }
 
 /**
@@ -662,6 +712,8 @@ static void guc_submit(struct intel_engine_cs *engine)
 
 			flush_ggtt_writes(rq->ring->vma);
 
+			guc_context_status_change(rq,
+						  INTEL_CONTEXT_SCHEDULE_IN);
 			guc_add_request(guc, rq);
 		}
 	}
@@ -784,13 +836,14 @@ static void guc_submission_tasklet(unsigned long data)
 {
 	struct intel_engine_cs * const engine = (struct intel_engine_cs *)data;
 	struct intel_engine_execlists * const execlists = &engine->execlists;
+	struct intel_guc *guc = &engine->i915->guc;
 	struct execlist_port *port = execlists->port;
 	struct i915_request *rq;
 
 	rq = port_request(port);
 	while (rq && i915_request_completed(rq)) {
 		trace_i915_request_out(rq);
-		i915_request_put(rq);
+		guc_context_switch_out(engine, rq);
 
 		port = execlists_port_complete(execlists, port);
 		if (port_isset(port)) {
@@ -802,6 +855,22 @@ static void guc_submission_tasklet(unsigned long data)
 		}
 	}
 
+	/*
+	 * Nothing else is going to switch the engine away from a held back
+	 * context, so preempt to idle to have it saved.
+	 */
+	if (!rq && guc->switch_out[engine->id] &&
+	    !execlists_is_active(execlists, EXECLISTS_ACTIVE_PREEMPT)) {
+		if (intel_engine_has_preemption(engine)) {
+			execlists_set_active(execlists,
+					     EXECLISTS_ACTIVE_PREEMPT);
+			queue_work(guc->preempt_wq,
+				   &guc->preempt_work[engine->id].work);
+		} else {
+			guc_flush_switch_out(engine);
+		}
+	}
+
 	if (execlists_is_active(execlists, EXECLISTS_ACTIVE_PREEMPT) &&
 	    intel_read_status_page(engine, I915_GEM_HWS_PREEMPT_INDEX) ==
 	    GUC_PREEMPT_FINISHED)
@@ -839,6 +908,8 @@ guc_reset_prepare(struct intel_engine_cs *engine)
 	if (engine->i915->guc.preempt_wq)
 		flush_workqueue(engine->i915->guc.preempt_wq);
 
+	guc_flush_switch_out(engine);
+
 	return i915_gem_find_active_request(engine);
 }
 
@@ -1261,6 +1332,7 @@ static void guc_interrupts_release(struct drm_i915_private *dev_priv)
 
 static void guc_submission_park(struct intel_engine_cs *engine)
 {
+	guc_flush_switch_out(engine);
 	intel_engine_unpin_breadcrumbs_irq(engine);
 }
 
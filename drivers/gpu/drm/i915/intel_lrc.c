@@ -395,13 +395,35 @@ execlists_user_end(struct intel_engine_execlists *execlists)
 static inline void
 execlists_context_schedule_in(struct i915_request *rq)
 {
+	rq->exec_start = ktime_get();
 	execlists_context_status_change(rq, INTEL_CONTEXT_SCHEDULE_IN);
 	intel_engine_context_in(rq->engine);
 }
 
+static void execlists_account_exec_time(struct i915_request *rq)
+{
+	struct intel_engine_cs *engine = rq->engine;
+	ktime_t now = ktime_get();
+	ktime_t start;
+
+	/*
+	 * The second port is scheduled in together with the first, but only
+	 * starts executing once the first completes.
+	 */
+	start = rq->exec_start;
+	if (ktime_after(engine->exec_last, start))
+		start = engine->exec_last;
+
+	intel_engine_account_latency(&engine->exec_time, rq_prio(rq),
+				     ktime_sub(now, start));
+	engine->exec_last = now;
+}
+
 static inline void
 execlists_context_schedule_out(struct i915_request *rq, unsigned long status)
 {
+	if (status == INTEL_CONTEXT_SCHEDULE_OUT)
+		execlists_account_exec_time(rq);
 	intel_engine_context_out(rq->engine);
 	execlists_context_status_change(rq, status);
 	trace_i915_request_out(rq);
@@ -447,6 +469,38 @@ static inline void write_desc(struct intel_engine_execlists *execlists, u64 desc
 	}
 }
 
+static void pv_submit_ports(struct intel_engine_cs *engine, u32 *descs)
+{
+	struct drm_i915_private *dev_priv = engine->i915;
+	struct intel_engine_execlists *execlists = &engine->execlists;
+	struct pv_submission __iomem *pv =
+		(struct pv_submission __iomem *)
+		&dev_priv->shared_page->pv_submit[engine->id];
+	u32 tail;
+	int i;
+
+	spin_lock(&dev_priv->shared_page_lock);
+	tail = readl(&pv->tail);
+	/* the kick is trapped and gvt empties the ring before it returns */
+	if (tail - readl(&pv->head) >= PV_SUBMIT_SLOTS)
+		writel(0, execlists->submit_reg);
+
+	for (i = 0; i < 4; i++)
+		writel(descs[i], &pv->descs[tail % PV_SUBMIT_SLOTS][i]);
+	/* publish the slot before the tail which covers it */
+	wmb();
+	writel(tail + 1, &pv->tail);
+
+	/*
+	 * Order the tail update before reading busy, gvt does the reverse
+	 * when it goes idle, so one of us always notices the new entry.
+	 */
+	mb();
+	if (!readl(&pv->busy))
+		writel(0, execlists->submit_reg);
+	spin_unlock(&dev_priv->shared_page_lock);
+}
+
 static void execlists_submit_ports(struct intel_engine_cs *engine)
 {
 	struct intel_engine_execlists *execlists = &engine->execlists;
@@ -496,8 +550,8 @@ static void execlists_submit_ports(struct intel_engine_cs *engine)
 			GEM_BUG_ON(!n);
 			desc = 0;
 		}
-		if (intel_vgpu_active(engine->i915) &&
-				PVMMIO_LEVEL(engine->i915, PVMMIO_ELSP_SUBMIT)) {
+		if (PVMMIO_LEVEL(engine->i915, PVMMIO_ELSP_SUBMIT) ||
+		    PVMMIO_LEVEL(engine->i915, PVMMIO_PV_SUBMIT)) {
 			BUG_ON(i >= 4);
 			descs[i] = upper_32_bits(desc);
 			descs[i + 1] = lower_32_bits(desc);
@@ -508,6 +562,9 @@ static void execlists_submit_ports(struct intel_engine_cs *engine)
 		write_desc(execlists, desc, n);
 	}
 	if (intel_vgpu_active(engine->i915) &&
+			PVMMIO_LEVEL(engine->i915, PVMMIO_PV_SUBMIT)) {
+		pv_submit_ports(engine, descs);
+	} else if (intel_vgpu_active(engine->i915) &&
 			PVMMIO_LEVEL(engine->i915, PVMMIO_ELSP_SUBMIT)) {
 		u32 __iomem *elsp_data = engine->i915->shared_page->elsp_data;
 		spin_lock(&engine->i915->shared_page_lock);
@@ -557,6 +614,10 @@ static void inject_preempt_context(struct intel_engine_cs *engine)
 	struct intel_engine_execlists *execlists = &engine->execlists;
 	struct intel_context *ce =
 		to_intel_context(engine->i915->preempt_context, engine);
+	u32 descs[4] = {
+		0, 0,
+		upper_32_bits(ce->lrc_desc), lower_32_bits(ce->lrc_desc)
+	};
 	unsigned int n;
 
 	GEM_BUG_ON(execlists->preempt_complete_status !=
@@ -574,6 +635,9 @@ static void inject_preempt_context(struct intel_engine_cs *engine)
 	GEM_TRACE("%s\n", engine->name);
 
 	if (intel_vgpu_active(engine->i915) &&
+			PVMMIO_LEVEL(engine->i915, PVMMIO_PV_SUBMIT)) {
+		pv_submit_ports(engine, descs);
+	} else if (intel_vgpu_active(engine->i915) &&
 			PVMMIO_LEVEL(engine->i915, PVMMIO_ELSP_SUBMIT)) {
 		u32 __iomem *elsp_data = engine->i915->shared_page->elsp_data;
 
@@ -599,6 +663,59 @@ static void inject_preempt_context(struct intel_engine_cs *engine)
 	execlists_set_active(execlists, EXECLISTS_ACTIVE_PREEMPT);
 }
 
+/*
+ * Arm the preemption timer with the timeout of the request we are
+ * preempting for, i.e. the first one in the queue.
+ */
+static void arm_preempt_timer(struct intel_engine_cs *engine)
+{
+	struct intel_engine_execlists *execlists = &engine->execlists;
+	struct i915_request *rq;
+	unsigned int timeout;
+	struct rb_node *rb;
+
+	rb = rb_first_cached(&execlists->queue);
+	if (!rb)
+		return;
+
+	rq = list_first_entry_or_null(&to_priolist(rb)->requests,
+				      struct i915_request, sched.link);
+	if (!rq)
+		return;
+
+	timeout = READ_ONCE(rq->gem_context->preempt_timeout);
+	if (timeout)
+		mod_timer(&execlists->preempt_timer,
+			  jiffies + msecs_to_jiffies(timeout) + 1);
+}
+
+static void execlists_preempt_timeout(struct timer_list *t)
+{
+	struct intel_engine_cs *engine =
+		from_timer(engine, t, execlists.preempt_timer);
+
+	if (execlists_is_active(&engine->execlists, EXECLISTS_ACTIVE_PREEMPT))
+		queue_work(system_highpri_wq, &engine->execlists.preempt_reset);
+}
+
+static void execlists_preempt_reset(struct work_struct *work)
+{
+	struct intel_engine_cs *engine =
+		container_of(work, typeof(*engine), execlists.preempt_reset);
+
+	/* Raced with the preemption completing, nothing to do */
+	if (!execlists_is_active(&engine->execlists, EXECLISTS_ACTIVE_PREEMPT))
+		return;
+
+	/*
+	 * The active context has not reached an arbitration point within the
+	 * budget of the preempting context; as a last resort reset it so the
+	 * queued work can run.
+	 */
+	i915_handle_error(engine->i915, intel_engine_flag(engine), 0,
+			  "preemption timeout on %s", engine->name);
+}
+
 static void complete_preempt_context(struct intel_engine_execlists *execlists)
 {
 	GEM_BUG_ON(!execlists_is_active(execlists, EXECLISTS_ACTIVE_PREEMPT));
@@ -606,6 +723,8 @@ static void complete_preempt_context(struct intel_engine_execlists *execlists)
 	if (inject_preempt_hang(execlists))
 		return;
 
+	del_timer(&execlists->preempt_timer);
+
 	execlists_cancel_port_requests(execlists);
 	__unwind_incomplete_requests(container_of(execlists,
 						  struct intel_engine_cs,
@@ -667,6 +786,7 @@ static void execlists_dequeue(struct intel_engine_cs *engine)
 
 		if (need_preempt(engine, last, execlists->queue_priority)) {
 			inject_preempt_context(engine);
+			arm_preempt_timer(engine);
 			return;
 		}
 
@@ -886,6 +1006,9 @@ static void execlists_cancel_requests(struct intel_engine_cs *engine)
 	 */
 	spin_lock_irqsave(&engine->timeline.lock, flags);
 
+	/* Nothing is left to preempt; may be called with irqs off */
+	del_timer(&execlists->preempt_timer);
+
 	/* Cancel the requests on the HW and clear the ELSP tracker. */
 	execlists_cancel_port_requests(execlists);
 	execlists_user_end(execlists);
@@ -1885,6 +2008,9 @@ execlists_reset_prepare(struct intel_engine_cs *engine)
 	 */
 	__tasklet_disable_sync_once(&execlists->tasklet);
 
+	/* The reset takes care of a stuck preemption itself */
+	del_timer_sync(&execlists->preempt_timer);
+
 	spin_lock_irqsave(&engine->timeline.lock, flags);
 
 	/*
@@ -2314,6 +2440,9 @@ void intel_logical_ring_cleanup(struct intel_engine_cs *engine)
 		WARN_ON((I915_READ_MODE(engine) & MODE_IDLE) == 0);
 	}
 
+	del_timer_sync(&engine->execlists.preempt_timer);
+	cancel_work_sync(&engine->execlists.preempt_reset);
+
 	if (engine->cleanup)
 		engine->cleanup(engine);
 
@@ -2423,6 +2552,9 @@ logical_ring_setup(struct intel_engine_cs *engine)
 
 	tasklet_init(&engine->execlists.tasklet,
 		     execlists_submission_tasklet, (unsigned long)engine);
+	timer_setup(&engine->execlists.preempt_timer,
+		    execlists_preempt_timeout, 0);
+	INIT_WORK(&engine->execlists.preempt_reset, execlists_preempt_reset);
 
 	logical_ring_default_vfuncs(engine);
 	logical_ring_default_irqs(engine);
@@ -4993,11 +4993,43 @@ static int skl_build_pipe_all_plane_wm(struct intel_crtc_state *cstate,
 	return 0;
 }
 
+/*
+ * A plane's watermarks only depend on its own state, the pipe's mode and
+ * its DDB allocation. If none of those changed in this commit, the
+ * watermarks computed for the current state are still valid.
+ */
+static bool skl_plane_wm_reusable(const struct intel_crtc_state *cstate,
+				  const struct skl_ddb_allocation *ddb,
+				  struct drm_plane *plane)
+{
+	struct drm_atomic_state *state = cstate->base.state;
+	struct drm_i915_private *dev_priv = to_i915(state->dev);
+	const struct skl_ddb_allocation *cur_ddb = &dev_priv->wm.skl_hw.ddb;
+	enum plane_id plane_id = to_intel_plane(plane)->id;
+	enum pipe pipe = to_intel_crtc(cstate->base.crtc)->pipe;
+
+	if (dev_priv->wm.distrust_bios_wm ||
+	    drm_atomic_crtc_needs_modeset(&cstate->base) ||
+	    cstate->update_pipe)
+		return false;
+
+	if (drm_atomic_get_existing_plane_state(state, plane))
+		return false;
+
+	return skl_ddb_entry_equal(&cur_ddb->plane[pipe][plane_id],
+				   &ddb->plane[pipe][plane_id]) &&
+	       skl_ddb_entry_equal(&cur_ddb->uv_plane[pipe][plane_id],
+				   &ddb->uv_plane[pipe][plane_id]);
+}
+
 static int skl_build_pipe_wm(struct intel_crtc_state *cstate,
 			     struct skl_ddb_allocation *ddb,
 			     struct skl_pipe_wm *pipe_wm)
 {
 	struct drm_crtc_state *crtc_state = &cstate->base;
+	struct drm_i915_private *dev_priv = to_i915(crtc_state->crtc->dev);
+	const struct skl_pipe_wm *old_pipe_wm =
+		&to_intel_crtc_state(crtc_state->crtc->state)->wm.skl.optimal;
 	struct drm_plane *plane;
 	const struct drm_plane_state *pstate;
 	int ret;
@@ -5014,10 +5046,18 @@ static int skl_build_pipe_wm(struct intel_crtc_state *cstate,
 		enum plane_id plane_id = to_intel_plane(plane)->id;
 		enum pipe pipe = to_intel_crtc(cstate->base.crtc)->pipe;
 
+		if (skl_plane_wm_reusable(cstate, ddb, plane)) {
+			pipe_wm->planes[plane_id] =
+				old_pipe_wm->planes[plane_id];
+			atomic64_inc(&dev_priv->wm.skl_stats.planes_reused);
+			continue;
+		}
+
 		ret = skl_build_plane_wm(cstate, ddb, pipe_wm,
 				pipe, plane_id, (struct intel_plane_state *) intel_pstate);
 		if (ret)
 			return ret;
+		atomic64_inc(&dev_priv->wm.skl_stats.planes_computed);
 	}
 
 	pipe_wm->linetime = skl_compute_linetime_wm(cstate);
@@ -5472,27 +5512,16 @@ skl_ddb_add_affected_pipes(struct drm_atomic_state *state, bool *changed)
 }
 
 static int
-skl_compute_wm(struct drm_atomic_state *state)
+__skl_compute_wm(struct drm_atomic_state *state)
 {
 	struct drm_crtc *crtc;
 	struct drm_crtc_state *cstate;
 	struct intel_atomic_state *intel_state = to_intel_atomic_state(state);
 	struct skl_ddb_values *results = &intel_state->wm_results;
-	struct drm_i915_private *dev_priv = to_i915(intel_state->base.dev);
 	struct skl_pipe_wm *pipe_wm;
 	bool changed = false;
 	int ret, i;
 
-	if (intel_vgpu_active(dev_priv) && i915_modparams.avail_planes_per_pipe)
-		return 0;
-
-	/* Clear all dirty flags */
-	results->dirty_pipes = 0;
-
-	ret = skl_ddb_add_affected_pipes(state, &changed);
-	if (ret || !changed)
-		return ret;
-
 	ret = skl_compute_ddb(state);
 	if (ret)
 		return ret;
@@ -5534,6 +5563,35 @@ skl_compute_wm(struct drm_atomic_state *state)
 	return 0;
 }
 
+static int
+skl_compute_wm(struct drm_atomic_state *state)
+{
+	struct intel_atomic_state *intel_state = to_intel_atomic_state(state);
+	struct skl_ddb_values *results = &intel_state->wm_results;
+	struct drm_i915_private *dev_priv = to_i915(intel_state->base.dev);
+	bool changed = false;
+	ktime_t start;
+	int ret;
+
+	if (intel_vgpu_active(dev_priv) && i915_modparams.avail_planes_per_pipe)
+		return 0;
+
+	/* Clear all dirty flags */
+	results->dirty_pipes = 0;
+
+	ret = skl_ddb_add_affected_pipes(state, &changed);
+	if (ret || !changed)
+		return ret;
+
+	start = ktime_get();
+	ret = __skl_compute_wm(state);
+	atomic64_inc(&dev_priv->wm.skl_stats.commits);
+	atomic64_add(ktime_to_ns(ktime_sub(ktime_get(), start)),
+		     &dev_priv->wm.skl_stats.ns);
+
+	return ret;
+}
+
 static void skl_atomic_update_crtc_wm(struct intel_atomic_state *state,
 				      struct intel_crtc_state *cstate)
 {
@@ -8254,6 +8312,57 @@ bool i915_gpu_turbo_disable(void)
 }
 EXPORT_SYMBOL_GPL(i915_gpu_turbo_disable);
 
+/*
+ * The RAPL power sharing governor samples how long the render engine was
+ * busy, on GPUs which keep engine busy stats.  Protected by mchdev_lock
+ * like i915_mch_dev.
+ */
+static struct drm_i915_private *i915_busy_dev;
+static bool i915_busy_stats;
+
+/**
+ * i915_gpu_busy_time - report how long the render engine has been busy
+ * @busy: outarg, busy time in nanoseconds, counted from an arbitrary point,
+ *	or %NULL to stop tracking
+ *
+ * The first call enables the engine busy stats, which cost a little on
+ * every context switch, until this is called with a %NULL @busy or the
+ * driver goes away.
+ *
+ * Return: %true if @busy was set.
+ */
+bool i915_gpu_busy_time(u64 *busy)
+{
+	struct intel_engine_cs *engine;
+	bool ret = false;
+
+	spin_lock_irq(&mchdev_lock);
+	if (!busy) {
+		if (i915_busy_dev && i915_busy_stats)
+			intel_disable_engine_stats(i915_busy_dev->engine[RCS]);
+		i915_busy_stats = false;
+		goto out_unlock;
+	}
+	if (!i915_busy_dev)
+		goto out_unlock;
+	engine = i915_busy_dev->engine[RCS];
+
+	if (!i915_busy_stats) {
+		if (intel_enable_engine_stats(engine))
+			goto out_unlock;
+		i915_busy_stats = true;
+	}
+
+	*busy = ktime_to_ns(intel_engine_get_busy_time(engine));
+	ret = true;
+
+out_unlock:
+	spin_unlock_irq(&mchdev_lock);
+
+	return ret;
+}
+EXPORT_SYMBOL_GPL(i915_gpu_busy_time);
+
 /**
  * Tells the intel_ips driver that the i915 driver is now loaded, if
  * IPS got loaded first.
@@ -8292,6 +8401,27 @@ void intel_gpu_ips_teardown(void)
 	spin_unlock_irq(&mchdev_lock);
 }
 
+void intel_gpu_busy_init(struct drm_i915_private *dev_priv)
+{
+	if (!dev_priv->engine[RCS] ||
+	    !intel_engine_supports_stats(dev_priv->engine[RCS]))
+		return;
+
+	spin_lock_irq(&mchdev_lock);
+	i915_busy_dev = dev_priv;
+	spin_unlock_irq(&mchdev_lock);
+}
+
+void intel_gpu_busy_teardown(void)
+{
+	spin_lock_irq(&mchdev_lock);
+	if (i915_busy_dev && i915_busy_stats)
+		intel_disable_engine_stats(i915_busy_dev->engine[RCS]);
+	i915_busy_stats = false;
+	i915_busy_dev = NULL;
+	spin_unlock_irq(&mchdev_lock);
+}
+
 static void intel_init_emon(struct drm_i915_private *dev_priv)
 {
 	u32 lcfuse;
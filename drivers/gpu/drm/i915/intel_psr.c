@@ -49,6 +49,10 @@
  * get called by the frontbuffer tracking code. Note that because of locking
  * issues the self-refresh re-enable code is done from a work queue, which
  * must be correctly synchronized/cancelled when shutting down the pipe."
+ *
+ * With PSR2 the source only transmits the region of the frame that changed
+ * (selective update). Up to gen11 the damaged region is tracked by the
+ * hardware itself, so there are no damage rectangles to program.
  */
 
 #include <drm/drmP.h>
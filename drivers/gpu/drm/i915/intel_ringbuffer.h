@@ -325,6 +325,14 @@ struct intel_engine_execlists {
 	 */
 	u32 preempt_complete_status;
 
+	/**
+	 * @preempt_timer: armed with the preempting context's timeout when
+	 * we inject a preemption, reset the engine via @preempt_reset if
+	 * the preemption has not completed by then
+	 */
+	struct timer_list preempt_timer;
+	struct work_struct preempt_reset;
+
 	/**
 	 * @csb_write_reset: reset value for CSB write pointer
 	 *
@@ -344,6 +352,32 @@ struct intel_engine_execlists {
 
 #define INTEL_ENGINE_CS_MAX_NAME 8
 
+/*
+ * Request latencies are bucketed by the priority of the request, as the
+ * point of tracking them is to tell apart high priority work stuck behind
+ * the queue from work that simply takes long on the GPU.
+ */
+enum intel_engine_latency_prio {
+	INTEL_ENGINE_LATENCY_PRIO_LOW = 0,
+	INTEL_ENGINE_LATENCY_PRIO_NORMAL,
+	INTEL_ENGINE_LATENCY_PRIO_HIGH,
+	INTEL_ENGINE_LATENCY_NUM_PRIO
+};
+
+/*
+ * Bucket 0 holds samples below 2us, bucket n those in [2^n, 2^(n + 1)) us
+ * and the last one everything above.
+ */
+#define INTEL_ENGINE_LATENCY_BUCKETS 16
+
+struct intel_engine_latency {
+	u64 total_ns;
+	u64 count[INTEL_ENGINE_LATENCY_NUM_PRIO];
+	u64 sum_ns[INTEL_ENGINE_LATENCY_NUM_PRIO];
+	u64 max_ns[INTEL_ENGINE_LATENCY_NUM_PRIO];
+	u32 hist[INTEL_ENGINE_LATENCY_NUM_PRIO][INTEL_ENGINE_LATENCY_BUCKETS];
+};
+
 struct intel_engine_cs {
 	struct drm_i915_private *i915;
 	char name[INTEL_ENGINE_CS_MAX_NAME];
@@ -419,13 +453,13 @@ struct intel_engine_cs {
 		 *
 		 * Index number corresponds to the bit number from @enable.
 		 */
-		unsigned int enable_count[I915_PMU_SAMPLE_BITS];
+#define I915_ENGINE_SAMPLE_MAX (I915_SAMPLE_EXEC_TIME + 1)
+		unsigned int enable_count[I915_ENGINE_SAMPLE_MAX];
 		/**
 		 * @sample: Counter values for sampling events.
 		 *
 		 * Our internal timer stores the current counters in this field.
 		 */
-#define I915_ENGINE_SAMPLE_MAX (I915_SAMPLE_SEMA + 1)
 		struct i915_pmu_sample sample[I915_ENGINE_SAMPLE_MAX];
 	} pmu;
 
@@ -602,6 +636,13 @@ struct intel_engine_cs {
 	const struct drm_i915_reg_table *reg_tables;
 	int reg_table_count;
 
+	/*
+	 * Recently validated batch contents, most recently used first, used
+	 * by the command parser to skip checking a resubmitted batch.
+	 */
+	struct list_head cmd_cache;
+	unsigned int cmd_cache_count;
+
 	/*
 	 * Returns the bitmask for the length field of the specified command.
 	 * Return 0 for an unrecognized/invalid command.
@@ -645,6 +686,24 @@ struct intel_engine_cs {
 		 */
 		ktime_t total;
 	} stats;
+
+	/**
+	 * @queue_time: Time requests spent between becoming ready to run
+	 * and being submitted to the hardware (ELSP or ring tail).
+	 *
+	 * Updated from __i915_request_submit() under the timeline lock.
+	 */
+	struct intel_engine_latency queue_time;
+	/**
+	 * @exec_time: Time requests spent on the hardware, from the later
+	 * of their context being scheduled in and the previous context
+	 * completing, until their completion event.
+	 *
+	 * Execlists only, updated from the CSB processing.
+	 */
+	struct intel_engine_latency exec_time;
+	/** @exec_last: Time of the last context completion. */
+	ktime_t exec_last;
 };
 
 static inline bool
@@ -1166,6 +1225,9 @@ static inline void intel_engine_context_out(struct intel_engine_cs *engine)
 int intel_enable_engine_stats(struct intel_engine_cs *engine);
 void intel_disable_engine_stats(struct intel_engine_cs *engine);
 
+void intel_engine_account_latency(struct intel_engine_latency *lat,
+				  int prio, ktime_t delta);
+
 ktime_t intel_engine_get_busy_time(struct intel_engine_cs *engine);
 
 #if IS_ENABLED(CONFIG_DRM_I915_SELFTEST)
@@ -63,6 +63,40 @@ int intel_usecs_to_scanlines(const struct drm_display_mode *adjusted_mode,
 #else
 #define VBLANK_EVASION_TIME_US 100
 #endif
+/* Stay well within the 1ms we are prepared to wait for the vblank */
+#define VBLANK_EVASION_MAX_US 500
+
+/*
+ * Evade the vblank for the larger of the static estimate and the recent
+ * average update time plus a quarter of margin, so that pipes with many
+ * planes do not keep overrunning into the next frame.
+ */
+static int intel_pipe_evasion_us(const struct intel_crtc *crtc)
+{
+	unsigned int us;
+
+	us = DIV_ROUND_UP(crtc->commit_timing.update_ns / 4 * 5,
+			  NSEC_PER_USEC);
+
+	return clamp_t(unsigned int, us,
+		       VBLANK_EVASION_TIME_US, VBLANK_EVASION_MAX_US);
+}
+
+static void intel_pipe_update_account(struct intel_crtc *crtc,
+				      ktime_t end_vbl_time, bool missed)
+{
+	u64 ns = ktime_to_ns(ktime_sub(end_vbl_time,
+				       crtc->debug.start_vbl_time));
+
+	ns = min_t(u64, ns, NSEC_PER_SEC);
+	if (crtc->commit_timing.update_ns)
+		ns = div_u64(crtc->commit_timing.update_ns * 7ull + ns, 8);
+	crtc->commit_timing.update_ns = ns;
+
+	crtc->commit_timing.updates++;
+	if (missed)
+		crtc->commit_timing.misses++;
+}
 
 /**
  * intel_pipe_update_start() - start update of a set of display registers
@@ -70,7 +104,8 @@ int intel_usecs_to_scanlines(const struct drm_display_mode *adjusted_mode,
  *
  * Mark the start of an update to pipe registers that should be updated
  * atomically regarding vblank. If the next vblank will happens within
- * the next 100 us, this function waits until the vblank passes.
+ * the evasion window (at least 100 us, more if recent updates took longer),
+ * this function waits until the vblank passes.
  *
  * After a successful call to this function, interrupts will be disabled
  * until a subsequent call to intel_pipe_update_end(). That is done to
@@ -82,7 +117,7 @@ void intel_pipe_update_start(const struct intel_crtc_state *new_crtc_state)
 	struct drm_i915_private *dev_priv = to_i915(crtc->base.dev);
 	const struct drm_display_mode *adjusted_mode = &new_crtc_state->base.adjusted_mode;
 	long timeout = msecs_to_jiffies_timeout(1);
-	int scanline, min, max, vblank_start;
+	int scanline, min, max, vblank_start, evade_us;
 	wait_queue_head_t *wq = drm_crtc_vblank_waitqueue(&crtc->base);
 	bool need_vlv_dsi_wa = (IS_VALLEYVIEW(dev_priv) || IS_CHERRYVIEW(dev_priv)) &&
 		intel_crtc_has_type(new_crtc_state, INTEL_OUTPUT_DSI);
@@ -92,9 +127,9 @@ void intel_pipe_update_start(const struct intel_crtc_state *new_crtc_state)
 	if (adjusted_mode->flags & DRM_MODE_FLAG_INTERLACE)
 		vblank_start = DIV_ROUND_UP(vblank_start, 2);
 
-	/* FIXME needs to be calibrated sensibly */
-	min = vblank_start - intel_usecs_to_scanlines(adjusted_mode,
-						      VBLANK_EVASION_TIME_US);
+	evade_us = intel_pipe_evasion_us(crtc);
+	crtc->commit_timing.evade_us = evade_us;
+	min = vblank_start - intel_usecs_to_scanlines(adjusted_mode, evade_us);
 	max = vblank_start - 1;
 
 	if (min <= 0 || max <= 0)
@@ -213,6 +248,11 @@ void intel_pipe_update_end(struct intel_crtc_state *new_crtc_state)
 	if (intel_vgpu_active(dev_priv))
 		return;
 
+	if (crtc->debug.start_vbl_count)
+		intel_pipe_update_account(crtc, end_vbl_time,
+					  crtc->debug.start_vbl_count !=
+					  end_vbl_count);
+
 	if (crtc->debug.start_vbl_count &&
 	    crtc->debug.start_vbl_count != end_vbl_count) {
 		DRM_ERROR("Atomic update failure on pipe %c (start=%u end=%u) time %lld us, min %d, max %d, scanline start %d, end %d\n",
@@ -224,11 +264,11 @@ void intel_pipe_update_end(struct intel_crtc_state *new_crtc_state)
 	}
 #ifdef CONFIG_DRM_I915_DEBUG_VBLANK_EVADE
 	else if (ktime_us_delta(end_vbl_time, crtc->debug.start_vbl_time) >
-		 VBLANK_EVASION_TIME_US)
+		 crtc->commit_timing.evade_us)
 		DRM_WARN("Atomic update on pipe (%c) took %lld us, max time under evasion is %u us\n",
 			 pipe_name(pipe),
 			 ktime_us_delta(end_vbl_time, crtc->debug.start_vbl_time),
-			 VBLANK_EVASION_TIME_US);
+			 crtc->commit_timing.evade_us);
 #endif
 }
 
@@ -494,10 +494,115 @@ int i915_gem_evict_mock_selftests(void)
 	return err;
 }
 
+static int igt_evict_rate(void *arg)
+{
+	struct drm_i915_private *i915 = arg;
+	const unsigned long count = 1024;
+	struct drm_i915_gem_object **objs;
+	unsigned long n, rounds = 0;
+	struct i915_vma **vmas;
+	struct i915_hw_ppgtt *ppgtt;
+	struct drm_file *file;
+	IGT_TIMEOUT(end_time);
+	u64 evict_ns = 0;
+	int err;
+
+	/*
+	 * Repeatedly bind a set of objects into a ppgtt and time how long
+	 * i915_gem_evict_vm() takes to throw them all out again.
+	 */
+
+	if (!USES_FULL_PPGTT(i915))
+		return 0;
+
+	objs = kvmalloc_array(count, sizeof(*objs), GFP_KERNEL | __GFP_ZERO);
+	if (!objs)
+		return -ENOMEM;
+
+	vmas = kvmalloc_array(count, sizeof(*vmas), GFP_KERNEL | __GFP_ZERO);
+	if (!vmas) {
+		err = -ENOMEM;
+		goto out_free;
+	}
+
+	file = mock_file(i915);
+	if (IS_ERR(file)) {
+		err = PTR_ERR(file);
+		goto out_free;
+	}
+
+	mutex_lock(&i915->drm.struct_mutex);
+	ppgtt = i915_ppgtt_create(i915, file->driver_priv);
+	if (IS_ERR(ppgtt)) {
+		err = PTR_ERR(ppgtt);
+		goto out_unlock;
+	}
+
+	for (n = 0; n < count; n++) {
+		objs[n] = i915_gem_object_create_internal(i915,
+							  I915_GTT_PAGE_SIZE);
+		if (IS_ERR(objs[n])) {
+			err = PTR_ERR(objs[n]);
+			objs[n] = NULL;
+			goto out_put;
+		}
+
+		vmas[n] = i915_vma_instance(objs[n], &ppgtt->vm, NULL);
+		if (IS_ERR(vmas[n])) {
+			err = PTR_ERR(vmas[n]);
+			vmas[n] = NULL;
+			goto out_put;
+		}
+	}
+
+	do {
+		ktime_t dt;
+
+		for (n = 0; n < count; n++) {
+			err = i915_vma_pin(vmas[n], 0, 0, PIN_USER);
+			if (err)
+				goto out_put;
+			i915_vma_unpin(vmas[n]);
+		}
+
+		dt = ktime_get_raw();
+		err = i915_gem_evict_vm(&ppgtt->vm);
+		dt = ktime_sub(ktime_get_raw(), dt);
+		if (err) {
+			pr_err("i915_gem_evict_vm failed with err=%d\n", err);
+			goto out_put;
+		}
+
+		evict_ns += ktime_to_ns(dt);
+		rounds++;
+	} while (!__igt_timeout(end_time, NULL));
+
+	igt_perf(__func__, "vmas=%lu rounds=%lu ns=%llu rate=%llu",
+		 count, rounds, evict_ns,
+		 div64_u64((u64)count * rounds * NSEC_PER_SEC, evict_ns ?: 1));
+
+out_put:
+	for (n = 0; n < count && objs[n]; n++) {
+		if (vmas[n])
+			i915_vma_close(vmas[n]);
+		i915_gem_object_put(objs[n]);
+	}
+	i915_ppgtt_close(&ppgtt->vm);
+	i915_ppgtt_put(ppgtt);
+out_unlock:
+	mutex_unlock(&i915->drm.struct_mutex);
+	mock_file_free(i915, file);
+out_free:
+	kvfree(vmas);
+	kvfree(objs);
+	return err;
+}
+
 int i915_gem_evict_live_selftests(struct drm_i915_private *i915)
 {
 	static const struct i915_subtest tests[] = {
 		SUBTEST(igt_evict_contexts),
+		SUBTEST(igt_evict_rate),
 	};
 
 	if (i915_terminally_wedged(&i915->gpu_error))
@@ -990,6 +990,97 @@ static int shrink_boom(struct drm_i915_private *i915,
 	return err;
 }
 
+static int bind_rate_hole(struct drm_i915_private *i915,
+			  struct i915_address_space *vm,
+			  u64 hole_start, u64 hole_end,
+			  unsigned long end_time)
+{
+	static const u64 sizes[] = { SZ_4K, SZ_64K, SZ_2M, SZ_16M };
+	unsigned long flags;
+	unsigned int i;
+
+	/*
+	 * Bind and unbind a single VMA, walking it through the hole, and
+	 * report the rate for a few object sizes. The objects have no real
+	 * backing store, so this is the cost of the drm_mm bookkeeping and
+	 * of writing (and clearing) the PTEs.
+	 */
+
+	flags = PIN_OFFSET_FIXED | PIN_USER;
+	if (i915_is_ggtt(vm))
+		flags |= PIN_GLOBAL;
+
+	for (i = 0; i < ARRAY_SIZE(sizes); i++) {
+		unsigned long timeout = jiffies + msecs_to_jiffies(100);
+		struct drm_i915_gem_object *obj;
+		unsigned long count = 0;
+		struct i915_vma *vma;
+		ktime_t dt;
+		u64 addr;
+		int err = 0;
+
+		if (round_up(hole_start, sizes[i]) + sizes[i] > hole_end)
+			break;
+
+		obj = fake_dma_object(i915, sizes[i]);
+		if (IS_ERR(obj))
+			break;
+
+		vma = i915_vma_instance(obj, vm, NULL);
+		if (IS_ERR(vma)) {
+			err = PTR_ERR(vma);
+			goto err_put;
+		}
+
+		addr = round_up(hole_start, sizes[i]);
+		dt = ktime_get_raw();
+		do {
+			if (addr + sizes[i] > hole_end)
+				addr = round_up(hole_start, sizes[i]);
+
+			err = i915_vma_pin(vma, 0, 0, addr | flags);
+			if (err) {
+				pr_err("%s bind failed at %llx + %llx [hole %llx- %llx] with err=%d\n",
+				       __func__, addr, vma->size,
+				       hole_start, hole_end, err);
+				goto err_close;
+			}
+			i915_vma_unpin(vma);
+
+			err = i915_vma_unbind(vma);
+			if (err) {
+				pr_err("%s unbind failed at %llx + %llx  with err=%d\n",
+				       __func__, addr, vma->size, err);
+				goto err_close;
+			}
+
+			addr += sizes[i];
+			count++;
+		} while (time_before(jiffies, timeout) &&
+			 !__igt_timeout(end_time, NULL));
+		dt = ktime_sub(ktime_get_raw(), dt);
+
+		igt_perf(__func__,
+			 "vm=%s size=%llu binds=%lu ns=%lld rate=%llu",
+			 i915_is_ggtt(vm) ? "ggtt" : "ppgtt", sizes[i], count,
+			 ktime_to_ns(dt),
+			 div64_u64((u64)count * NSEC_PER_SEC,
+				   ktime_to_ns(dt) ?: 1));
+
+err_close:
+		if (!i915_vma_is_ggtt(vma))
+			i915_vma_close(vma);
+err_put:
+		i915_gem_object_put(obj);
+		if (err)
+			return err;
+
+		cleanup_freed_objects(i915);
+	}
+
+	return 0;
+}
+
 static int exercise_ppgtt(struct drm_i915_private *dev_priv,
 			  int (*func)(struct drm_i915_private *i915,
 				      struct i915_address_space *vm,
@@ -1053,6 +1144,11 @@ static int igt_ppgtt_lowlevel(void *arg)
 	return exercise_ppgtt(arg, lowlevel_hole);
 }
 
+static int igt_ppgtt_bind_rate(void *arg)
+{
+	return exercise_ppgtt(arg, bind_rate_hole);
+}
+
 static int igt_ppgtt_shrink(void *arg)
 {
 	return exercise_ppgtt(arg, shrink_hole);
@@ -1137,6 +1233,36 @@ static int igt_ggtt_lowlevel(void *arg)
 	return exercise_ggtt(arg, lowlevel_hole);
 }
 
+static int igt_ggtt_bind_rate(void *arg)
+{
+	struct drm_i915_private *i915 = arg;
+	struct i915_ggtt *ggtt = &i915->ggtt;
+	u64 hole_start, hole_end, start = 0, end = 0;
+	struct drm_mm_node *node;
+	IGT_TIMEOUT(end_time);
+	int err = 0;
+
+	/* Measure in the largest hole only, one report per object size */
+
+	mutex_lock(&i915->drm.struct_mutex);
+	drm_mm_for_each_hole(node, &ggtt->vm.mm, hole_start, hole_end) {
+		if (ggtt->vm.mm.color_adjust)
+			ggtt->vm.mm.color_adjust(node, 0,
+						 &hole_start, &hole_end);
+		if (hole_end > hole_start &&
+		    hole_end - hole_start > end - start) {
+			start = hole_start;
+			end = hole_end;
+		}
+	}
+
+	if (end > start)
+		err = bind_rate_hole(i915, &ggtt->vm, start, end, end_time);
+	mutex_unlock(&i915->drm.struct_mutex);
+
+	return err;
+}
+
 static int igt_ggtt_page(void *arg)
 {
 	const unsigned int count = PAGE_SIZE/sizeof(u32);
@@ -1689,12 +1815,14 @@ int i915_gem_gtt_live_selftests(struct drm_i915_private *i915)
 		SUBTEST(igt_ppgtt_fill),
 		SUBTEST(igt_ppgtt_shrink),
 		SUBTEST(igt_ppgtt_shrink_boom),
+		SUBTEST(igt_ppgtt_bind_rate),
 		SUBTEST(igt_ggtt_lowlevel),
 		SUBTEST(igt_ggtt_drunk),
 		SUBTEST(igt_ggtt_walk),
 		SUBTEST(igt_ggtt_pot),
 		SUBTEST(igt_ggtt_fill),
 		SUBTEST(igt_ggtt_page),
+		SUBTEST(igt_ggtt_bind_rate),
 	};
 
 	GEM_BUG_ON(offset_in_page(i915->ggtt.vm.total));
@@ -406,6 +406,83 @@ static int live_nop_request(void *arg)
 	return err;
 }
 
+static int live_nop_throughput(void *arg)
+{
+	struct drm_i915_private *i915 = arg;
+	struct i915_request *prev = NULL;
+	struct intel_engine_cs *engine;
+	struct live_test t;
+	unsigned int id;
+	int err = -ENODEV;
+
+	/*
+	 * Keep each engine busy with empty requests for the duration of the
+	 * test, waiting for a batch only once the next one is queued, and
+	 * report how many requests it retires per second.
+	 */
+
+	mutex_lock(&i915->drm.struct_mutex);
+
+	for_each_engine(engine, i915, id) {
+		unsigned long count = 0;
+		IGT_TIMEOUT(end_time);
+		ktime_t dt;
+
+		err = begin_live_test(&t, i915, __func__, engine->name);
+		if (err)
+			goto out_unlock;
+
+		dt = ktime_get_raw();
+		do {
+			struct i915_request *request;
+			unsigned int n;
+
+			for (n = 0; n < 64; n++) {
+				request = i915_request_alloc(engine,
+							     i915->kernel_context);
+				if (IS_ERR(request)) {
+					err = PTR_ERR(request);
+					goto out_prev;
+				}
+
+				if (n == 63)
+					i915_request_get(request);
+				i915_request_add(request);
+			}
+			count += n;
+
+			if (prev) {
+				i915_request_wait(prev,
+						  I915_WAIT_LOCKED,
+						  MAX_SCHEDULE_TIMEOUT);
+				i915_request_put(prev);
+			}
+			prev = request;
+		} while (!__igt_timeout(end_time, NULL));
+
+		i915_request_wait(prev, I915_WAIT_LOCKED, MAX_SCHEDULE_TIMEOUT);
+		i915_request_put(prev);
+		prev = NULL;
+		dt = ktime_sub(ktime_get_raw(), dt);
+
+		err = end_live_test(&t);
+		if (err)
+			goto out_unlock;
+
+		igt_perf(__func__, "engine=%s requests=%lu ns=%lld rate=%llu",
+			 engine->name, count, ktime_to_ns(dt),
+			 div64_u64((u64)count * NSEC_PER_SEC,
+				   ktime_to_ns(dt) ?: 1));
+	}
+
+out_prev:
+	if (prev)
+		i915_request_put(prev);
+out_unlock:
+	mutex_unlock(&i915->drm.struct_mutex);
+	return err;
+}
+
 static struct i915_vma *empty_batch(struct drm_i915_private *i915)
 {
 	struct drm_i915_gem_object *obj;
@@ -861,6 +938,7 @@ int i915_request_live_selftests(struct drm_i915_private *i915)
 {
 	static const struct i915_subtest tests[] = {
 		SUBTEST(live_nop_request),
+		SUBTEST(live_nop_throughput),
 		SUBTEST(live_all_engines),
 		SUBTEST(live_sequential_engines),
 		SUBTEST(live_empty_request),
@@ -565,6 +565,230 @@ static int live_preempt_hang(void *arg)
 	return err;
 }
 
+static int submit_nops(struct intel_engine_cs *engine,
+		       struct i915_gem_context **ctx, unsigned int nctx,
+		       unsigned long count)
+{
+	struct i915_request *last[2] = {};
+	unsigned long n;
+	unsigned int i;
+	int err = 0;
+
+	GEM_BUG_ON(nctx > ARRAY_SIZE(last));
+
+	for (n = 0; n < count; n++) {
+		struct i915_request *rq;
+
+		rq = i915_request_alloc(engine, ctx[n % nctx]);
+		if (IS_ERR(rq)) {
+			err = PTR_ERR(rq);
+			break;
+		}
+
+		i = n % nctx;
+		if (last[i])
+			i915_request_put(last[i]);
+		last[i] = i915_request_get(rq);
+		i915_request_add(rq);
+	}
+
+	for (i = 0; i < nctx; i++) {
+		if (!last[i])
+			continue;
+
+		if (i915_request_wait(last[i], I915_WAIT_LOCKED, HZ) < 0)
+			err = -ETIME;
+		i915_request_put(last[i]);
+	}
+
+	return err;
+}
+
+static int live_perf_context_switch(void *arg)
+{
+	struct drm_i915_private *i915 = arg;
+	struct i915_gem_context *ctx[2];
+	struct intel_engine_cs *engine;
+	enum intel_engine_id id;
+	const unsigned long count = 1024;
+	int err = -ENOMEM;
+
+	/*
+	 * Empty requests from a single context are coalesced into a single
+	 * submission, alternating between two contexts forces a context
+	 * switch for each of them. The difference between the two runs is
+	 * the cost of a switch.
+	 */
+
+	mutex_lock(&i915->drm.struct_mutex);
+
+	ctx[0] = kernel_context(i915);
+	if (!ctx[0])
+		goto err_unlock;
+
+	ctx[1] = kernel_context(i915);
+	if (!ctx[1])
+		goto err_ctx0;
+
+	for_each_engine(engine, i915, id) {
+		ktime_t same, alternate;
+
+		/* Warm up both contexts, pinning their images */
+		err = submit_nops(engine, ctx, 2, 2);
+		if (err)
+			goto err_ctx1;
+
+		same = ktime_get_raw();
+		err = submit_nops(engine, ctx, 1, count);
+		same = ktime_sub(ktime_get_raw(), same);
+		if (err)
+			goto err_ctx1;
+
+		alternate = ktime_get_raw();
+		err = submit_nops(engine, ctx, 2, count);
+		alternate = ktime_sub(ktime_get_raw(), alternate);
+		if (err)
+			goto err_ctx1;
+
+		igt_perf(__func__,
+			 "engine=%s requests=%lu same_ns=%lld alternate_ns=%lld switch_ns=%lld",
+			 engine->name, count,
+			 ktime_to_ns(same), ktime_to_ns(alternate),
+			 div64_s64(ktime_to_ns(ktime_sub(alternate, same)),
+				   count));
+
+		if (igt_flush_test(i915, I915_WAIT_LOCKED)) {
+			err = -EIO;
+			goto err_ctx1;
+		}
+	}
+
+	err = 0;
+err_ctx1:
+	kernel_context_close(ctx[1]);
+err_ctx0:
+	kernel_context_close(ctx[0]);
+err_unlock:
+	igt_flush_test(i915, I915_WAIT_LOCKED);
+	mutex_unlock(&i915->drm.struct_mutex);
+	return err;
+}
+
+static int live_perf_preempt(void *arg)
+{
+	struct drm_i915_private *i915 = arg;
+	struct i915_gem_context *ctx_hi, *ctx_lo;
+	struct intel_engine_cs *engine;
+	enum intel_engine_id id;
+	struct spinner spin_lo;
+	int err = -ENOMEM;
+
+	/*
+	 * Time how long an empty high priority request takes to complete
+	 * while a low priority spinner occupies the engine, i.e. the latency
+	 * of preempting it.
+	 */
+
+	if (!HAS_LOGICAL_RING_PREEMPTION(i915))
+		return 0;
+
+	mutex_lock(&i915->drm.struct_mutex);
+
+	if (spinner_init(&spin_lo, i915))
+		goto err_unlock;
+
+	ctx_hi = kernel_context(i915);
+	if (!ctx_hi)
+		goto err_spin_lo;
+	ctx_hi->sched.priority = I915_CONTEXT_MAX_USER_PRIORITY;
+
+	ctx_lo = kernel_context(i915);
+	if (!ctx_lo)
+		goto err_ctx_hi;
+	ctx_lo->sched.priority = I915_CONTEXT_MIN_USER_PRIORITY;
+
+	for_each_engine(engine, i915, id) {
+		u64 min = U64_MAX, max = 0, total = 0;
+		struct i915_request *rq;
+		IGT_TIMEOUT(end_time);
+		unsigned long count;
+
+		rq = spinner_create_request(&spin_lo, ctx_lo, engine,
+					    MI_ARB_CHECK);
+		if (IS_ERR(rq)) {
+			err = PTR_ERR(rq);
+			goto err_ctx_lo;
+		}
+
+		i915_request_add(rq);
+		if (!wait_for_spinner(&spin_lo, rq)) {
+			GEM_TRACE("lo spinner failed to start\n");
+			GEM_TRACE_DUMP();
+			i915_gem_set_wedged(i915);
+			err = -EIO;
+			goto err_ctx_lo;
+		}
+
+		for (count = 0; count < 1024; count++) {
+			ktime_t dt;
+			long ret;
+
+			dt = ktime_get_raw();
+			rq = i915_request_alloc(engine, ctx_hi);
+			if (IS_ERR(rq)) {
+				spinner_end(&spin_lo);
+				err = PTR_ERR(rq);
+				goto err_ctx_lo;
+			}
+
+			i915_request_get(rq);
+			i915_request_add(rq);
+			ret = i915_request_wait(rq, I915_WAIT_LOCKED, HZ / 5);
+			dt = ktime_sub(ktime_get_raw(), dt);
+			i915_request_put(rq);
+			if (ret < 0) {
+				GEM_TRACE("hi request not preempting\n");
+				GEM_TRACE_DUMP();
+				i915_gem_set_wedged(i915);
+				err = -EIO;
+				goto err_ctx_lo;
+			}
+
+			min = min_t(u64, min, ktime_to_ns(dt));
+			max = max_t(u64, max, ktime_to_ns(dt));
+			total += ktime_to_ns(dt);
+
+			if (__igt_timeout(end_time, NULL)) {
+				count++;
+				break;
+			}
+		}
+
+		spinner_end(&spin_lo);
+		if (igt_flush_test(i915, I915_WAIT_LOCKED)) {
+			err = -EIO;
+			goto err_ctx_lo;
+		}
+
+		igt_perf(__func__,
+			 "engine=%s count=%lu min_ns=%llu avg_ns=%llu max_ns=%llu",
+			 engine->name, count, min,
+			 div64_u64(total, count), max);
+	}
+
+	err = 0;
+err_ctx_lo:
+	kernel_context_close(ctx_lo);
+err_ctx_hi:
+	kernel_context_close(ctx_hi);
+err_spin_lo:
+	spinner_fini(&spin_lo);
+err_unlock:
+	igt_flush_test(i915, I915_WAIT_LOCKED);
+	mutex_unlock(&i915->drm.struct_mutex);
+	return err;
+}
+
 int intel_execlists_live_selftests(struct drm_i915_private *i915)
 {
 	static const struct i915_subtest tests[] = {
@@ -572,6 +796,8 @@ int intel_execlists_live_selftests(struct drm_i915_private *i915)
 		SUBTEST(live_preempt),
 		SUBTEST(live_late_preempt),
 		SUBTEST(live_preempt_hang),
+		SUBTEST(live_perf_context_switch),
+		SUBTEST(live_perf_preempt),
 	};
 
 	if (!HAS_EXECLISTS(i915))
@@ -40,8 +40,24 @@ virtio_gpu_debugfs_irq_info(struct seq_file *m, void *data)
 	return 0;
 }
 
+static int
+virtio_gpu_debugfs_ctrlq_info(struct seq_file *m, void *data)
+{
+	struct drm_info_node *node = (struct drm_info_node *) m->private;
+	struct virtio_gpu_device *vgdev = node->minor->dev->dev_private;
+	struct virtio_gpu_queue *ctrlq = &vgdev->ctrlq;
+
+	spin_lock(&ctrlq->qlock);
+	seq_printf(m, "commands %llu\n", ctrlq->commands);
+	seq_printf(m, "notifies %llu\n", ctrlq->notifies);
+	seq_printf(m, "fences coalesced %llu\n", ctrlq->fences_coalesced);
+	spin_unlock(&ctrlq->qlock);
+	return 0;
+}
+
 static struct drm_info_list virtio_gpu_debugfs_list[] = {
 	{ "irq_fence", virtio_gpu_debugfs_irq_info, 0, NULL },
+	{ "ctrlq", virtio_gpu_debugfs_ctrlq_info, 0, NULL },
 };
 
 #define VIRTIO_GPU_DEBUGFS_ENTRIES ARRAY_SIZE(virtio_gpu_debugfs_list)
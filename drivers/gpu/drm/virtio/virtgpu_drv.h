@@ -52,6 +52,12 @@
 /* virtgpu_drm_bus.c */
 int drm_virtio_init(struct drm_driver *driver, struct virtio_device *vdev);
 
+enum virtio_gpu_map_state {
+	VIRTIO_GPU_MAP_STATE_INITIALIZING,
+	VIRTIO_GPU_MAP_STATE_MAPPED,
+	VIRTIO_GPU_MAP_STATE_ERROR,
+};
+
 struct virtio_gpu_object {
 	struct drm_gem_object gem_base;
 	uint32_t hw_res_handle;
@@ -59,6 +65,15 @@ struct virtio_gpu_object {
 	struct sg_table *pages;
 	void *vmap;
 	bool dumb;
+	/*
+	 * Blob resource backed by the host visible region rather than guest
+	 * pages. It is placed in TTM_PL_VRAM, at the offset the host maps it.
+	 */
+	bool host_visible;
+	enum virtio_gpu_map_state map_state;
+	uint32_t map_info;
+	/* drops the reference held by an in flight map command */
+	struct work_struct map_put_work;
 	struct ttm_place                placement_code;
 	struct ttm_placement		placement;
 	struct ttm_buffer_object	tbo;
@@ -101,6 +116,10 @@ struct virtio_gpu_vbuffer {
 	int resp_size;
 
 	virtio_gpu_resp_cb resp_cb;
+	void *resp_cb_data;
+
+	/* the command header carries VIRTIO_GPU_FLAG_FENCE */
+	bool fenced;
 
 	struct list_head list;
 };
@@ -145,6 +164,22 @@ struct virtio_gpu_queue {
 	spinlock_t qlock;
 	wait_queue_head_t ack_queue;
 	struct work_struct dequeue_work;
+
+	/*
+	 * Commands not added to the ring yet, in submission order. They
+	 * are held back while batch_owner has a batch open and added with
+	 * a single notification of the host when its outermost batch ends.
+	 * batch_depth counts the nesting of batch_owner's batches only.
+	 */
+	struct list_head pending;
+	struct virtio_gpu_vbuffer *last_fenced;
+	struct task_struct *batch_owner;
+	unsigned int batch_depth;
+
+	/* statistics, under qlock */
+	u64 commands;
+	u64 notifies;
+	u64 fences_coalesced;
 };
 
 struct virtio_gpu_drv_capset {
@@ -194,6 +229,9 @@ struct virtio_gpu_device {
 	spinlock_t ctx_id_idr_lock;
 
 	bool has_virgl_3d;
+	bool has_resource_blob;
+	bool has_host_visible;
+	struct virtio_shm_region host_visible_region;
 
 	struct work_struct config_changed_work;
 
@@ -207,7 +245,7 @@ struct virtio_gpu_fpriv {
 };
 
 /* virtio_ioctl.c */
-#define DRM_VIRTIO_NUM_IOCTLS 10
+#define DRM_VIRTIO_NUM_IOCTLS 11
 extern struct drm_ioctl_desc virtio_gpu_ioctls[DRM_VIRTIO_NUM_IOCTLS];
 
 /* virtio_kms.c */
@@ -314,9 +352,19 @@ void
 virtio_gpu_cmd_resource_create_3d(struct virtio_gpu_device *vgdev,
 				  struct virtio_gpu_resource_create_3d *rc_3d,
 				  struct virtio_gpu_fence **fence);
+void virtio_gpu_cmd_resource_create_blob(struct virtio_gpu_device *vgdev,
+					 uint32_t resource_id, uint32_t ctx_id,
+					 uint32_t blob_mem, uint32_t blob_flags,
+					 uint64_t blob_id, uint64_t size);
+int virtio_gpu_cmd_map(struct virtio_gpu_device *vgdev,
+		       struct virtio_gpu_object *bo, uint64_t offset);
+void virtio_gpu_cmd_unmap(struct virtio_gpu_device *vgdev,
+			  uint32_t resource_id);
 void virtio_gpu_ctrl_ack(struct virtqueue *vq);
 void virtio_gpu_cursor_ack(struct virtqueue *vq);
 void virtio_gpu_fence_ack(struct virtqueue *vq);
+void virtio_gpu_batch_begin(struct virtio_gpu_device *vgdev);
+void virtio_gpu_batch_end(struct virtio_gpu_device *vgdev);
 void virtio_gpu_dequeue_ctrl_func(struct work_struct *work);
 void virtio_gpu_dequeue_cursor_func(struct work_struct *work);
 void virtio_gpu_dequeue_fence_func(struct work_struct *work);
@@ -341,9 +389,10 @@ void virtio_gpu_ttm_fini(struct virtio_gpu_device *vgdev);
 int virtio_gpu_mmap(struct file *filp, struct vm_area_struct *vma);
 
 /* virtio_gpu_fence.c */
-int virtio_gpu_fence_emit(struct virtio_gpu_device *vgdev,
-			  struct virtio_gpu_ctrl_hdr *cmd_hdr,
-			  struct virtio_gpu_fence **fence);
+struct virtio_gpu_fence *virtio_gpu_fence_alloc(void);
+void virtio_gpu_fence_emit(struct virtio_gpu_device *vgdev,
+			   struct virtio_gpu_ctrl_hdr *cmd_hdr,
+			   struct virtio_gpu_fence *fence);
 void virtio_gpu_fence_event_process(struct virtio_gpu_device *vdev,
 				    u64 last_seq);
 
@@ -351,6 +400,10 @@ void virtio_gpu_fence_event_process(struct virtio_gpu_device *vdev,
 int virtio_gpu_object_create(struct virtio_gpu_device *vgdev,
 			     unsigned long size, bool kernel, bool pinned,
 			     struct virtio_gpu_object **bo_ptr);
+int virtio_gpu_object_create_host_visible(struct virtio_gpu_device *vgdev,
+					  unsigned long size,
+					  struct virtio_gpu_object **bo_ptr);
+void virtio_gpu_object_set_map_caching(struct virtio_gpu_object *bo);
 int virtio_gpu_object_kmap(struct virtio_gpu_object *bo, void **ptr);
 int virtio_gpu_object_get_sg_table(struct virtio_gpu_device *qdev,
 				   struct virtio_gpu_object *bo);
@@ -95,6 +95,7 @@ static int virtio_gpu_dirty_update(struct virtio_gpu_framebuffer *fb,
 
 	spin_unlock_irqrestore(&fb->dirty_lock, flags);
 
+	virtio_gpu_batch_begin(vgdev);
 	{
 		uint32_t offset;
 		uint32_t w = x2 - x + 1;
@@ -113,6 +114,7 @@ static int virtio_gpu_dirty_update(struct virtio_gpu_framebuffer *fb,
 	}
 	virtio_gpu_cmd_resource_flush(vgdev, obj->hw_res_handle,
 				      x, y, x2 - x + 1, y2 - y + 1);
+	virtio_gpu_batch_end(vgdev);
 	return 0;
 }
 
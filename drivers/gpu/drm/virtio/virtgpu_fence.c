@@ -67,29 +67,33 @@ static const struct dma_fence_ops virtio_fence_ops = {
 	.timeline_value_str  = virtio_timeline_value_str,
 };
 
-int virtio_gpu_fence_emit(struct virtio_gpu_device *vgdev,
-			  struct virtio_gpu_ctrl_hdr *cmd_hdr,
-			  struct virtio_gpu_fence **fence)
+/*
+ * Fences are allocated before taking the queue lock, so that emitting
+ * them in submission order doesn't need an atomic allocation.
+ */
+struct virtio_gpu_fence *virtio_gpu_fence_alloc(void)
+{
+	return kmalloc(sizeof(struct virtio_gpu_fence), GFP_KERNEL);
+}
+
+void virtio_gpu_fence_emit(struct virtio_gpu_device *vgdev,
+			   struct virtio_gpu_ctrl_hdr *cmd_hdr,
+			   struct virtio_gpu_fence *fence)
 {
 	struct virtio_gpu_fence_driver *drv = &vgdev->fence_drv;
 	unsigned long irq_flags;
 
-	*fence = kmalloc(sizeof(struct virtio_gpu_fence), GFP_ATOMIC);
-	if ((*fence) == NULL)
-		return -ENOMEM;
-
 	spin_lock_irqsave(&drv->lock, irq_flags);
-	(*fence)->drv = drv;
-	(*fence)->seq = ++drv->sync_seq;
-	dma_fence_init(&(*fence)->f, &virtio_fence_ops, &drv->lock,
-		       drv->context, (*fence)->seq);
-	dma_fence_get(&(*fence)->f);
-	list_add_tail(&(*fence)->node, &drv->fences);
+	fence->drv = drv;
+	fence->seq = ++drv->sync_seq;
+	dma_fence_init(&fence->f, &virtio_fence_ops, &drv->lock,
+		       drv->context, fence->seq);
+	dma_fence_get(&fence->f);
+	list_add_tail(&fence->node, &drv->fences);
 	spin_unlock_irqrestore(&drv->lock, irq_flags);
 
 	cmd_hdr->flags |= cpu_to_le32(VIRTIO_GPU_FLAG_FENCE);
-	cmd_hdr->fence_id = cpu_to_le64((*fence)->seq);
-	return 0;
+	cmd_hdr->fence_id = cpu_to_le64(fence->seq);
 }
 
 void virtio_gpu_fence_event_process(struct virtio_gpu_device *vgdev,
@@ -201,6 +201,12 @@ static int virtio_gpu_getparam_ioctl(struct drm_device *dev, void *data,
 	case VIRTGPU_PARAM_CAPSET_QUERY_FIX:
 		value = 1;
 		break;
+	case VIRTGPU_PARAM_RESOURCE_BLOB:
+		value = vgdev->has_resource_blob ? 1 : 0;
+		break;
+	case VIRTGPU_PARAM_HOST_VISIBLE:
+		value = vgdev->has_host_visible ? 1 : 0;
+		break;
 	default:
 		return -EINVAL;
 	}
@@ -260,10 +266,12 @@ static int virtio_gpu_resource_create_ioctl(struct drm_device *dev, void *data,
 	obj = &qobj->gem_base;
 
 	if (!vgdev->has_virgl_3d) {
+		virtio_gpu_batch_begin(vgdev);
 		virtio_gpu_cmd_create_resource(vgdev, res_id, rc->format,
 					       rc->width, rc->height);
 
 		ret = virtio_gpu_object_attach(vgdev, qobj, res_id, NULL);
+		virtio_gpu_batch_end(vgdev);
 	} else {
 		/* use a gem reference since unref list undoes them */
 		drm_gem_object_get(&qobj->gem_base);
@@ -288,8 +296,10 @@ static int virtio_gpu_resource_create_ioctl(struct drm_device *dev, void *data,
 		rc_3d.nr_samples = cpu_to_le32(rc->nr_samples);
 		rc_3d.flags = cpu_to_le32(rc->flags);
 
+		virtio_gpu_batch_begin(vgdev);
 		virtio_gpu_cmd_resource_create_3d(vgdev, &rc_3d, NULL);
 		ret = virtio_gpu_object_attach(vgdev, qobj, res_id, &fence);
+		virtio_gpu_batch_end(vgdev);
 		if (ret) {
 			ttm_eu_backoff_reservation(&ticket, &validate_list);
 			goto fail_unref;
@@ -537,6 +547,102 @@ static int virtio_gpu_get_caps_ioctl(struct drm_device *dev,
 	return 0;
 }
 
+#define VIRTGPU_BLOB_FLAG_USE_MASK (VIRTGPU_BLOB_FLAG_USE_MAPPABLE | \
+				    VIRTGPU_BLOB_FLAG_USE_SHAREABLE | \
+				    VIRTGPU_BLOB_FLAG_USE_CROSS_DEVICE)
+
+/*
+ * Create a host3d blob living in the host visible region. Userspace maps
+ * it through DRM_VIRTGPU_MAP like any other object, but the pages are the
+ * host's, so no transfer commands are needed to share the contents.
+ */
+static int virtio_gpu_resource_create_blob_ioctl(struct drm_device *dev,
+						 void *data,
+						 struct drm_file *file)
+{
+	struct virtio_gpu_device *vgdev = dev->dev_private;
+	struct virtio_gpu_fpriv *vfpriv = file->driver_priv;
+	struct drm_virtgpu_resource_create_blob *rc_blob = data;
+	struct virtio_gpu_object *qobj;
+	struct drm_gem_object *obj;
+	uint32_t handle = 0;
+	uint32_t res_id;
+	void *buf = NULL;
+	int ret;
+
+	if (!vgdev->has_virgl_3d || !vgdev->has_resource_blob ||
+	    !vgdev->has_host_visible)
+		return -ENOSYS;
+
+	if (rc_blob->blob_mem != VIRTGPU_BLOB_MEM_HOST3D ||
+	    !(rc_blob->blob_flags & VIRTGPU_BLOB_FLAG_USE_MAPPABLE) ||
+	    rc_blob->blob_flags & ~VIRTGPU_BLOB_FLAG_USE_MASK ||
+	    rc_blob->pad || !rc_blob->size)
+		return -EINVAL;
+
+	if (rc_blob->cmd_size) {
+		buf = memdup_user(u64_to_user_ptr(rc_blob->cmd),
+				  rc_blob->cmd_size);
+		if (IS_ERR(buf))
+			return PTR_ERR(buf);
+	}
+
+	ret = virtio_gpu_object_create_host_visible(vgdev, rc_blob->size,
+						    &qobj);
+	if (ret) {
+		kfree(buf);
+		return ret;
+	}
+	obj = &qobj->gem_base;
+
+	virtio_gpu_resource_id_get(vgdev, &res_id);
+	qobj->hw_res_handle = res_id;
+
+	virtio_gpu_batch_begin(vgdev);
+	/* the host creates the blob from this, it's freed with the vbuf */
+	if (buf)
+		virtio_gpu_cmd_submit(vgdev, buf, rc_blob->cmd_size,
+				      vfpriv->ctx_id, NULL);
+	virtio_gpu_cmd_resource_create_blob(vgdev, res_id, vfpriv->ctx_id,
+					    rc_blob->blob_mem,
+					    rc_blob->blob_flags,
+					    rc_blob->blob_id, rc_blob->size);
+	ret = virtio_gpu_cmd_map(vgdev, qobj,
+				 (u64)qobj->tbo.mem.start << PAGE_SHIFT);
+	virtio_gpu_batch_end(vgdev);
+	if (ret)
+		goto fail_put;
+
+	/* the map command keeps qobj alive if we stop waiting for it */
+	ret = wait_event_interruptible_timeout(vgdev->resp_wq,
+			READ_ONCE(qobj->map_state) !=
+			VIRTIO_GPU_MAP_STATE_INITIALIZING, 5 * HZ);
+	if (ret <= 0) {
+		if (!ret)
+			ret = -EBUSY;
+		goto fail_put;
+	}
+	if (qobj->map_state != VIRTIO_GPU_MAP_STATE_MAPPED) {
+		ret = -EIO;
+		goto fail_put;
+	}
+	virtio_gpu_object_set_map_caching(qobj);
+
+	ret = drm_gem_handle_create(file, obj, &handle);
+	if (ret)
+		goto fail_put;
+	drm_gem_object_put_unlocked(obj);
+
+	rc_blob->res_handle = res_id;
+	rc_blob->bo_handle = handle;
+	return 0;
+
+fail_put:
+	/* drops the resource and its id together with the object */
+	drm_gem_object_put_unlocked(obj);
+	return ret;
+}
+
 struct drm_ioctl_desc virtio_gpu_ioctls[DRM_VIRTIO_NUM_IOCTLS] = {
 	DRM_IOCTL_DEF_DRV(VIRTGPU_MAP, virtio_gpu_map_ioctl,
 			  DRM_AUTH | DRM_UNLOCKED | DRM_RENDER_ALLOW),
@@ -569,4 +675,8 @@ struct drm_ioctl_desc virtio_gpu_ioctls[DRM_VIRTIO_NUM_IOCTLS] = {
 
 	DRM_IOCTL_DEF_DRV(VIRTGPU_GET_CAPS, virtio_gpu_get_caps_ioctl,
 			  DRM_AUTH | DRM_UNLOCKED | DRM_RENDER_ALLOW),
+
+	DRM_IOCTL_DEF_DRV(VIRTGPU_RESOURCE_CREATE_BLOB,
+			  virtio_gpu_resource_create_blob_ioctl,
+			  DRM_AUTH | DRM_UNLOCKED | DRM_RENDER_ALLOW),
 };
@@ -93,6 +93,7 @@ static void virtio_gpu_init_vq(struct virtio_gpu_queue *vgvq,
 	spin_lock_init(&vgvq->qlock);
 	init_waitqueue_head(&vgvq->ack_queue);
 	INIT_WORK(&vgvq->dequeue_work, work_func);
+	INIT_LIST_HEAD(&vgvq->pending);
 }
 
 static void virtio_gpu_get_capsets(struct virtio_gpu_device *vgdev,
@@ -174,6 +175,22 @@ int virtio_gpu_driver_load(struct drm_device *dev, unsigned long flags)
 #else
 	DRM_INFO("virgl 3d acceleration not supported by guest\n");
 #endif
+	if (virtio_has_feature(vgdev->vdev, VIRTIO_GPU_F_RESOURCE_BLOB))
+		vgdev->has_resource_blob = true;
+	if (virtio_get_shm_region(vgdev->vdev, &vgdev->host_visible_region,
+				  VIRTIO_GPU_SHM_ID_HOST_VISIBLE)) {
+		if (!devm_request_mem_region(&vgdev->vdev->dev,
+					     vgdev->host_visible_region.addr,
+					     vgdev->host_visible_region.len,
+					     dev_name(&vgdev->vdev->dev))) {
+			DRM_ERROR("Could not reserve host visible region\n");
+		} else {
+			vgdev->has_host_visible = true;
+			DRM_INFO("Host visible region: 0x%llx, size 0x%llx\n",
+				 vgdev->host_visible_region.addr,
+				 vgdev->host_visible_region.len);
+		}
+	}
 
 	ret = virtio_find_vqs(vgdev->vdev, 2, vqs, callbacks, names, NULL);
 	if (ret) {
@@ -51,16 +51,23 @@ static void virtio_gpu_init_ttm_placement(struct virtio_gpu_object *vgbo,
 	vgbo->placement.busy_placement = &vgbo->placement_code;
 	vgbo->placement_code.fpfn = 0;
 	vgbo->placement_code.lpfn = 0;
-	vgbo->placement_code.flags =
-		TTM_PL_MASK_CACHING | TTM_PL_FLAG_TT | pflag;
+	if (vgbo->host_visible)
+		/* the host maps it at a fixed offset, it can never move */
+		vgbo->placement_code.flags =
+			TTM_PL_FLAG_WC | TTM_PL_FLAG_VRAM |
+			TTM_PL_FLAG_NO_EVICT;
+	else
+		vgbo->placement_code.flags =
+			TTM_PL_MASK_CACHING | TTM_PL_FLAG_TT | pflag;
 	vgbo->placement.num_placement = c;
 	vgbo->placement.num_busy_placement = c;
 
 }
 
-int virtio_gpu_object_create(struct virtio_gpu_device *vgdev,
-			     unsigned long size, bool kernel, bool pinned,
-			     struct virtio_gpu_object **bo_ptr)
+static int __virtio_gpu_object_create(struct virtio_gpu_device *vgdev,
+				      unsigned long size, bool kernel,
+				      bool pinned, bool host_visible,
+				      struct virtio_gpu_object **bo_ptr)
 {
 	struct virtio_gpu_object *bo;
 	enum ttm_bo_type type;
@@ -86,6 +93,7 @@ int virtio_gpu_object_create(struct virtio_gpu_device *vgdev,
 		return ret;
 	}
 	bo->dumb = false;
+	bo->host_visible = host_visible;
 	virtio_gpu_init_ttm_placement(bo, pinned);
 
 	ret = ttm_bo_init(&vgdev->mman.bdev, &bo->tbo, size, type,
@@ -99,6 +107,57 @@ int virtio_gpu_object_create(struct virtio_gpu_device *vgdev,
 	return 0;
 }
 
+int virtio_gpu_object_create(struct virtio_gpu_device *vgdev,
+			     unsigned long size, bool kernel, bool pinned,
+			     struct virtio_gpu_object **bo_ptr)
+{
+	return __virtio_gpu_object_create(vgdev, size, kernel, pinned, false,
+					  bo_ptr);
+}
+
+/*
+ * Reserve @size bytes of the host visible region for a blob resource.
+ * No guest pages are allocated, the object's offset in the region is
+ * bo->tbo.mem.start pages once this returns.
+ */
+int virtio_gpu_object_create_host_visible(struct virtio_gpu_device *vgdev,
+					  unsigned long size,
+					  struct virtio_gpu_object **bo_ptr)
+{
+	if (!vgdev->has_host_visible)
+		return -ENODEV;
+
+	return __virtio_gpu_object_create(vgdev, size, false, true, true,
+					  bo_ptr);
+}
+
+/*
+ * Make CPU mappings of a host visible object use the caching the host
+ * reported for it. Only valid before the object is mapped by anyone,
+ * which holds while it has no handle yet.
+ */
+void virtio_gpu_object_set_map_caching(struct virtio_gpu_object *bo)
+{
+	u32 caching;
+
+	switch (bo->map_info & VIRTIO_GPU_MAP_CACHE_MASK) {
+	case VIRTIO_GPU_MAP_CACHE_CACHED:
+		caching = TTM_PL_FLAG_CACHED;
+		break;
+	case VIRTIO_GPU_MAP_CACHE_UNCACHED:
+		caching = TTM_PL_FLAG_UNCACHED;
+		break;
+	default:
+		caching = TTM_PL_FLAG_WC;
+		break;
+	}
+
+	bo->placement_code.flags =
+		(bo->placement_code.flags & ~TTM_PL_MASK_CACHING) | caching;
+	bo->tbo.mem.placement =
+		(bo->tbo.mem.placement & ~TTM_PL_MASK_CACHING) | caching;
+}
+
 int virtio_gpu_object_kmap(struct virtio_gpu_object *bo, void **ptr)
 {
 	bool is_iomem;
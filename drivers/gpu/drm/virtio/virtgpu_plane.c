@@ -152,6 +152,9 @@ static void virtio_gpu_primary_plane_update(struct drm_plane *plane,
 	if (WARN_ON(!output))
 		return;
 
+	/* transfer, scanout and flush reach the host with one notification */
+	virtio_gpu_batch_begin(vgdev);
+
 	if (plane->state->fb) {
 		vgfb = to_virtio_gpu_framebuffer(plane->state->fb);
 		bo = gem_to_virtio_gpu_obj(vgfb->base.obj[0]);
@@ -185,6 +188,8 @@ static void virtio_gpu_primary_plane_update(struct drm_plane *plane,
 				      plane->state->src_y >> 16,
 				      plane->state->src_w >> 16,
 				      plane->state->src_h >> 16);
+
+	virtio_gpu_batch_end(vgdev);
 }
 
 static void virtio_gpu_cursor_plane_update(struct drm_plane *plane,
@@ -223,6 +223,13 @@ static int virtio_gpu_init_mem_type(struct ttm_bo_device *bdev, uint32_t type,
 		man->available_caching = TTM_PL_MASK_CACHING;
 		man->default_caching = TTM_PL_FLAG_CACHED;
 		break;
+	case TTM_PL_VRAM:
+		/* host visible shared memory region */
+		man->func = &ttm_bo_manager_func;
+		man->flags = TTM_MEMTYPE_FLAG_FIXED | TTM_MEMTYPE_FLAG_MAPPABLE;
+		man->available_caching = TTM_PL_MASK_CACHING;
+		man->default_caching = TTM_PL_FLAG_WC;
+		break;
 	default:
 		DRM_ERROR("Unsupported memory type %u\n", (unsigned int)type);
 		return -EINVAL;
@@ -254,6 +261,7 @@ static int virtio_gpu_verify_access(struct ttm_buffer_object *bo,
 static int virtio_gpu_ttm_io_mem_reserve(struct ttm_bo_device *bdev,
 					 struct ttm_mem_reg *mem)
 {
+	struct virtio_gpu_device *vgdev = virtio_gpu_get_vgdev(bdev);
 	struct ttm_mem_type_manager *man = &bdev->man[mem->mem_type];
 
 	mem->bus.addr = NULL;
@@ -268,6 +276,11 @@ static int virtio_gpu_ttm_io_mem_reserve(struct ttm_bo_device *bdev,
 	case TTM_PL_TT:
 		/* system memory */
 		return 0;
+	case TTM_PL_VRAM:
+		mem->bus.offset = mem->start << PAGE_SHIFT;
+		mem->bus.base = vgdev->host_visible_region.addr;
+		mem->bus.is_iomem = true;
+		return 0;
 	default:
 		return -EINVAL;
 	}
@@ -375,6 +388,16 @@ static void virtio_gpu_bo_move_notify(struct ttm_buffer_object *tbo,
 	bo = container_of(tbo, struct virtio_gpu_object, tbo);
 	vgdev = (struct virtio_gpu_device *)bo->gem_base.dev->dev_private;
 
+	if (bo->host_visible) {
+		/*
+		 * Called before the range is given back to the allocator, so
+		 * the unmap reaches the host ahead of any map reusing it.
+		 */
+		if (!new_mem && bo->map_state == VIRTIO_GPU_MAP_STATE_MAPPED)
+			virtio_gpu_cmd_unmap(vgdev, bo->hw_res_handle);
+		return;
+	}
+
 	if (!new_mem || (new_mem->placement & TTM_PL_FLAG_SYSTEM)) {
 		if (bo->hw_res_handle)
 			virtio_gpu_cmd_resource_inval_backing(vgdev,
@@ -437,6 +460,15 @@ int virtio_gpu_ttm_init(struct virtio_gpu_device *vgdev)
 		DRM_ERROR("Failed initializing GTT heap.\n");
 		goto err_mm_init;
 	}
+
+	if (vgdev->has_host_visible) {
+		r = ttm_bo_init_mm(&vgdev->mman.bdev, TTM_PL_VRAM,
+				   vgdev->host_visible_region.len >> PAGE_SHIFT);
+		if (r) {
+			DRM_ERROR("Failed initializing host visible heap.\n");
+			goto err_mm_init;
+		}
+	}
 	return 0;
 
 err_mm_init:
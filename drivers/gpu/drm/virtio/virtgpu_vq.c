@@ -178,15 +178,20 @@ static void free_vbuf(struct virtio_gpu_device *vgdev,
 	kmem_cache_free(vgdev->vbufs, vbuf);
 }
 
+#define VIRTIO_GPU_RECLAIM_BATCH 16
+
 static void reclaim_vbufs(struct virtqueue *vq, struct list_head *reclaim_list)
 {
-	struct virtio_gpu_vbuffer *vbuf;
-	unsigned int len;
+	struct virtio_gpu_vbuffer *vbufs[VIRTIO_GPU_RECLAIM_BATCH];
+	unsigned int lens[VIRTIO_GPU_RECLAIM_BATCH];
+	unsigned int i, n;
 	int freed = 0;
 
-	while ((vbuf = virtqueue_get_buf(vq, &len))) {
-		list_add_tail(&vbuf->list, reclaim_list);
-		freed++;
+	while ((n = virtqueue_get_bufs(vq, (void **)vbufs, lens,
+				       VIRTIO_GPU_RECLAIM_BATCH))) {
+		for (i = 0; i < n; i++)
+			list_add_tail(&vbufs[i]->list, reclaim_list);
+		freed += n;
 	}
 	if (freed == 0)
 		DRM_DEBUG("Huh? zero vbufs reclaimed");
@@ -260,18 +265,12 @@ void virtio_gpu_dequeue_cursor_func(struct work_struct *work)
 	wake_up(&vgdev->cursorq.ack_queue);
 }
 
-static int virtio_gpu_queue_ctrl_buffer_locked(struct virtio_gpu_device *vgdev,
-					       struct virtio_gpu_vbuffer *vbuf)
-		__releases(&vgdev->ctrlq.qlock)
-		__acquires(&vgdev->ctrlq.qlock)
+static int virtio_gpu_add_ctrl_buffer(struct virtqueue *vq,
+				      struct virtio_gpu_vbuffer *vbuf,
+				      int *nents)
 {
-	struct virtqueue *vq = vgdev->ctrlq.vq;
 	struct scatterlist *sgs[3], vcmd, vout, vresp;
 	int outcnt = 0, incnt = 0;
-	int ret;
-
-	if (!vgdev->vqs_ready)
-		return -ENODEV;
 
 	sg_init_one(&vcmd, vbuf->buf, vbuf->size);
 	sgs[outcnt + incnt] = &vcmd;
@@ -289,30 +288,106 @@ static int virtio_gpu_queue_ctrl_buffer_locked(struct virtio_gpu_device *vgdev,
 		incnt++;
 	}
 
-retry:
-	ret = virtqueue_add_sgs(vq, sgs, outcnt, incnt, vbuf, GFP_ATOMIC);
-	if (ret == -ENOSPC) {
-		spin_unlock(&vgdev->ctrlq.qlock);
-		wait_event(vgdev->ctrlq.ack_queue, vq->num_free >= outcnt + incnt);
-		spin_lock(&vgdev->ctrlq.qlock);
-		goto retry;
-	} else {
-		virtqueue_kick(vq);
+	*nents = outcnt + incnt;
+	return virtqueue_add_sgs(vq, sgs, outcnt, incnt, vbuf, GFP_ATOMIC);
+}
+
+/*
+ * Move the pending commands to the ring, in order, and return whether the
+ * host needs to be notified. Since everything goes through the pending
+ * list, waiting for ring space here can't reorder fence ids.
+ */
+static bool virtio_gpu_flush_ctrl_locked(struct virtio_gpu_device *vgdev)
+		__releases(&vgdev->ctrlq.qlock)
+		__acquires(&vgdev->ctrlq.qlock)
+{
+	struct virtio_gpu_queue *ctrlq = &vgdev->ctrlq;
+	struct virtqueue *vq = ctrlq->vq;
+	struct virtio_gpu_vbuffer *vbuf;
+	struct virtio_gpu_ctrl_hdr *hdr;
+	bool added = false;
+	int nents, ret;
+
+	while (!list_empty(&ctrlq->pending)) {
+		vbuf = list_first_entry(&ctrlq->pending,
+					struct virtio_gpu_vbuffer, list);
+
+		/*
+		 * The host completes fences in id order, so the newest
+		 * fence of the batch signals the older ones as well and
+		 * only that one has to be created on the host side.
+		 */
+		if (vbuf->fenced && vbuf != ctrlq->last_fenced) {
+			hdr = (struct virtio_gpu_ctrl_hdr *)vbuf->buf;
+			hdr->flags &= ~cpu_to_le32(VIRTIO_GPU_FLAG_FENCE);
+			vbuf->fenced = false;
+			ctrlq->fences_coalesced++;
+		}
+
+		ret = virtio_gpu_add_ctrl_buffer(vq, vbuf, &nents);
+		if (ret == -ENOSPC) {
+			bool notify = added && virtqueue_kick_prepare(vq);
+
+			if (added)
+				ctrlq->notifies++;
+			added = false;
+			spin_unlock(&ctrlq->qlock);
+			if (notify)
+				virtqueue_notify(vq);
+			wait_event(ctrlq->ack_queue, vq->num_free >= nents);
+			spin_lock(&ctrlq->qlock);
+			continue;
+		}
+
+		list_del(&vbuf->list);
+		if (vbuf == ctrlq->last_fenced)
+			ctrlq->last_fenced = NULL;
+		ctrlq->commands++;
+		added = true;
 	}
 
-	if (!ret)
-		ret = vq->num_free;
-	return ret;
+	if (!added)
+		return false;
+
+	ctrlq->notifies++;
+	return virtqueue_kick_prepare(vq);
+}
+
+static int virtio_gpu_queue_ctrl_buffer_locked(struct virtio_gpu_device *vgdev,
+					       struct virtio_gpu_vbuffer *vbuf,
+					       bool *notify)
+		__releases(&vgdev->ctrlq.qlock)
+		__acquires(&vgdev->ctrlq.qlock)
+{
+	struct virtio_gpu_queue *ctrlq = &vgdev->ctrlq;
+
+	*notify = false;
+	if (!vgdev->vqs_ready)
+		return -ENODEV;
+
+	list_add_tail(&vbuf->list, &ctrlq->pending);
+	if (vbuf->fenced)
+		ctrlq->last_fenced = vbuf;
+
+	/* only the batch owner's own commands are held back */
+	if (ctrlq->batch_owner != current)
+		*notify = virtio_gpu_flush_ctrl_locked(vgdev);
+	return 0;
 }
 
 static int virtio_gpu_queue_ctrl_buffer(struct virtio_gpu_device *vgdev,
 					struct virtio_gpu_vbuffer *vbuf)
 {
+	bool notify;
 	int rc;
 
 	spin_lock(&vgdev->ctrlq.qlock);
-	rc = virtio_gpu_queue_ctrl_buffer_locked(vgdev, vbuf);
+	rc = virtio_gpu_queue_ctrl_buffer_locked(vgdev, vbuf, &notify);
 	spin_unlock(&vgdev->ctrlq.qlock);
+
+	/* notify outside the lock, the VM exit can take a while */
+	if (notify)
+		virtqueue_notify(vgdev->ctrlq.vq);
 	return rc;
 }
 
@@ -321,38 +396,86 @@ static int virtio_gpu_queue_fenced_ctrl_buffer(struct virtio_gpu_device *vgdev,
 					       struct virtio_gpu_ctrl_hdr *hdr,
 					       struct virtio_gpu_fence **fence)
 {
-	struct virtqueue *vq = vgdev->ctrlq.vq;
+	bool notify;
 	int rc;
 
-again:
-	spin_lock(&vgdev->ctrlq.qlock);
+	if (fence) {
+		*fence = virtio_gpu_fence_alloc();
+		if (!*fence) {
+			free_vbuf(vgdev, vbuf);
+			return -ENOMEM;
+		}
+	}
 
 	/*
-	 * Make sure we have enouth space in the virtqueue.  If not
-	 * wait here until we have.
-	 *
-	 * Without that virtio_gpu_queue_ctrl_buffer_nolock might have
-	 * to wait for free space, which can result in fence ids being
-	 * submitted out-of-order.
+	 * Fence ids must reach the host in order, so the fence is emitted
+	 * under the same lock that appends the command to the pending list.
 	 */
-	if (vq->num_free < 3) {
-		spin_unlock(&vgdev->ctrlq.qlock);
-		wait_event(vgdev->ctrlq.ack_queue, vq->num_free >= 3);
-		goto again;
+	spin_lock(&vgdev->ctrlq.qlock);
+	if (fence) {
+		virtio_gpu_fence_emit(vgdev, hdr, *fence);
+		vbuf->fenced = true;
 	}
-
-	if (fence)
-		virtio_gpu_fence_emit(vgdev, hdr, fence);
-	rc = virtio_gpu_queue_ctrl_buffer_locked(vgdev, vbuf);
+	rc = virtio_gpu_queue_ctrl_buffer_locked(vgdev, vbuf, &notify);
 	spin_unlock(&vgdev->ctrlq.qlock);
+
+	if (notify)
+		virtqueue_notify(vgdev->ctrlq.vq);
 	return rc;
 }
 
+/**
+ * virtio_gpu_batch_begin - hold back control commands
+ * @vgdev: the device
+ *
+ * Commands the calling thread queues until the matching
+ * virtio_gpu_batch_end() are only added to the ring, with a single
+ * notification of the host, once its outermost batch ends. One thread
+ * batches at a time. While it does, batches of other threads are no-ops,
+ * and their commands flush whatever the owner has held back so far, so
+ * no thread waits for another thread's batch to end.
+ */
+void virtio_gpu_batch_begin(struct virtio_gpu_device *vgdev)
+{
+	struct virtio_gpu_queue *ctrlq = &vgdev->ctrlq;
+
+	spin_lock(&ctrlq->qlock);
+	if (!ctrlq->batch_owner)
+		ctrlq->batch_owner = current;
+	if (ctrlq->batch_owner == current)
+		ctrlq->batch_depth++;
+	spin_unlock(&ctrlq->qlock);
+}
+
+/**
+ * virtio_gpu_batch_end - submit the commands held back by a batch
+ * @vgdev: the device
+ *
+ * May sleep waiting for free space in the ring.
+ */
+void virtio_gpu_batch_end(struct virtio_gpu_device *vgdev)
+{
+	struct virtio_gpu_queue *ctrlq = &vgdev->ctrlq;
+	bool notify = false;
+
+	spin_lock(&ctrlq->qlock);
+	/* nothing to do if the matching begin was a no-op */
+	if (ctrlq->batch_owner == current && !--ctrlq->batch_depth) {
+		ctrlq->batch_owner = NULL;
+		notify = virtio_gpu_flush_ctrl_locked(vgdev);
+	}
+	spin_unlock(&ctrlq->qlock);
+
+	if (notify)
+		virtqueue_notify(vgdev->ctrlq.vq);
+}
+
 static int virtio_gpu_queue_cursor(struct virtio_gpu_device *vgdev,
 				   struct virtio_gpu_vbuffer *vbuf)
 {
 	struct virtqueue *vq = vgdev->cursorq.vq;
 	struct scatterlist *sgs[1], ccmd;
+	bool notify = false;
 	int ret;
 	int outcnt;
 
@@ -372,11 +495,14 @@ static int virtio_gpu_queue_cursor(struct virtio_gpu_device *vgdev,
 		spin_lock(&vgdev->cursorq.qlock);
 		goto retry;
 	} else {
-		virtqueue_kick(vq);
+		notify = virtqueue_kick_prepare(vq);
 	}
 
 	spin_unlock(&vgdev->cursorq.qlock);
 
+	if (notify)
+		virtqueue_notify(vq);
+
 	if (!ret)
 		ret = vq->num_free;
 	return ret;
@@ -823,6 +949,106 @@ void virtio_gpu_cmd_transfer_from_host_3d(struct virtio_gpu_device *vgdev,
 	virtio_gpu_queue_fenced_ctrl_buffer(vgdev, vbuf, &cmd_p->hdr, fence);
 }
 
+void virtio_gpu_cmd_resource_create_blob(struct virtio_gpu_device *vgdev,
+					 uint32_t resource_id, uint32_t ctx_id,
+					 uint32_t blob_mem, uint32_t blob_flags,
+					 uint64_t blob_id, uint64_t size)
+{
+	struct virtio_gpu_resource_create_blob *cmd_p;
+	struct virtio_gpu_vbuffer *vbuf;
+
+	cmd_p = virtio_gpu_alloc_cmd(vgdev, &vbuf, sizeof(*cmd_p));
+	memset(cmd_p, 0, sizeof(*cmd_p));
+
+	cmd_p->hdr.type = cpu_to_le32(VIRTIO_GPU_CMD_RESOURCE_CREATE_BLOB);
+	cmd_p->hdr.ctx_id = cpu_to_le32(ctx_id);
+	cmd_p->resource_id = cpu_to_le32(resource_id);
+	cmd_p->blob_mem = cpu_to_le32(blob_mem);
+	cmd_p->blob_flags = cpu_to_le32(blob_flags);
+	cmd_p->blob_id = cpu_to_le64(blob_id);
+	cmd_p->size = cpu_to_le64(size);
+
+	virtio_gpu_queue_ctrl_buffer(vgdev, vbuf);
+}
+
+static void virtio_gpu_cmd_resource_map_cb(struct virtio_gpu_device *vgdev,
+					   struct virtio_gpu_vbuffer *vbuf)
+{
+	struct virtio_gpu_object *bo = vbuf->resp_cb_data;
+	struct virtio_gpu_resp_map_info *resp =
+		(struct virtio_gpu_resp_map_info *)vbuf->resp_buf;
+
+	if (resp->hdr.type == cpu_to_le32(VIRTIO_GPU_RESP_OK_MAP_INFO)) {
+		bo->map_info = le32_to_cpu(resp->map_info);
+		WRITE_ONCE(bo->map_state, VIRTIO_GPU_MAP_STATE_MAPPED);
+	} else {
+		WRITE_ONCE(bo->map_state, VIRTIO_GPU_MAP_STATE_ERROR);
+	}
+	wake_up_all(&vgdev->resp_wq);
+
+	/* freeing the object queues commands, which can't wait in here */
+	schedule_work(&bo->map_put_work);
+}
+
+static void virtio_gpu_map_put_work_func(struct work_struct *work)
+{
+	struct virtio_gpu_object *bo =
+		container_of(work, struct virtio_gpu_object, map_put_work);
+
+	drm_gem_object_put_unlocked(&bo->gem_base);
+}
+
+/*
+ * Ask the host to map the blob of @bo at @offset of the host visible
+ * region. bo->map_state leaves VIRTIO_GPU_MAP_STATE_INITIALIZING once the
+ * host answered. The command holds its own reference to @bo until then,
+ * so the caller may give up waiting.
+ */
+int virtio_gpu_cmd_map(struct virtio_gpu_device *vgdev,
+		       struct virtio_gpu_object *bo, uint64_t offset)
+{
+	struct virtio_gpu_resource_map_blob *cmd_p;
+	struct virtio_gpu_vbuffer *vbuf;
+	void *resp_buf;
+
+	resp_buf = kzalloc(sizeof(struct virtio_gpu_resp_map_info),
+			   GFP_KERNEL);
+	if (!resp_buf)
+		return -ENOMEM;
+
+	cmd_p = virtio_gpu_alloc_cmd_resp
+		(vgdev, &virtio_gpu_cmd_resource_map_cb, &vbuf,
+		 sizeof(*cmd_p), sizeof(struct virtio_gpu_resp_map_info),
+		 resp_buf);
+	memset(cmd_p, 0, sizeof(*cmd_p));
+	vbuf->resp_cb_data = bo;
+
+	drm_gem_object_get(&bo->gem_base);
+	INIT_WORK(&bo->map_put_work, virtio_gpu_map_put_work_func);
+	bo->map_state = VIRTIO_GPU_MAP_STATE_INITIALIZING;
+	cmd_p->hdr.type = cpu_to_le32(VIRTIO_GPU_CMD_RESOURCE_MAP_BLOB);
+	cmd_p->resource_id = cpu_to_le32(bo->hw_res_handle);
+	cmd_p->offset = cpu_to_le64(offset);
+
+	virtio_gpu_queue_ctrl_buffer(vgdev, vbuf);
+	return 0;
+}
+
+void virtio_gpu_cmd_unmap(struct virtio_gpu_device *vgdev,
+			  uint32_t resource_id)
+{
+	struct virtio_gpu_resource_unmap_blob *cmd_p;
+	struct virtio_gpu_vbuffer *vbuf;
+
+	cmd_p = virtio_gpu_alloc_cmd(vgdev, &vbuf, sizeof(*cmd_p));
+	memset(cmd_p, 0, sizeof(*cmd_p));
+
+	cmd_p->hdr.type = cpu_to_le32(VIRTIO_GPU_CMD_RESOURCE_UNMAP_BLOB);
+	cmd_p->resource_id = cpu_to_le32(resource_id);
+
+	virtio_gpu_queue_ctrl_buffer(vgdev, vbuf);
+}
+
 void virtio_gpu_cmd_submit(struct virtio_gpu_device *vgdev,
 			   void *data, uint32_t data_size,
 			   uint32_t ctx_id, struct virtio_gpu_fence **fence)
@@ -109,6 +109,7 @@ struct mdd_transfer_data {
 	struct scatterlist *sg_trans;	/* not be allocated */
 	size_t block_count;
 	size_t block_size;
+	bool zero_copy;
 	spinlock_t lock;
 };
 
@@ -134,6 +135,7 @@ struct msu_dvc_dev {
 	u32 max_retry_count;
 	u32 transfer_type:2;
 	u32 process_type:2;
+	u32 zero_copy:1;
 	u32 min_transfer;
 
 #ifdef MDD_DEBUG
@@ -323,6 +325,39 @@ static ssize_t mdd_proc_type_store(struct device *dev,
 
 static DEVICE_ATTR_RW(mdd_proc_type);
 
+static ssize_t mdd_zero_copy_show(struct device *dev,
+				  struct device_attribute *attr, char *buf)
+{
+	struct msu_dvc_dev *mdd;
+
+	MDD_F_DEBUG();
+	mdd = container_of(dev, struct msu_dvc_dev, ddev.device);
+	return sprintf(buf, "%u\n", mdd->zero_copy);
+}
+
+static ssize_t mdd_zero_copy_store(struct device *dev,
+				   struct device_attribute *attr,
+				   const char *buf, size_t count)
+{
+	struct msu_dvc_dev *mdd;
+	bool tmp;
+
+	MDD_F_DEBUG();
+	mdd = container_of(dev, struct msu_dvc_dev, ddev.device);
+
+	if (mdd->dtc_status
+	    && dvct_get_status(mdd->dtc_status, DVCT_MASK_TRANS))
+		return -EBUSY;
+
+	if (!kstrtobool(buf, &tmp)) {
+		mdd->zero_copy = tmp;
+		return count;
+	}
+	return -EINVAL;
+}
+
+static DEVICE_ATTR_RW(mdd_zero_copy);
+
 #ifdef MDD_DEBUG
 
 static ssize_t mdd_stats_show(struct device *dev,
@@ -481,11 +516,18 @@ static int mdd_setup_transfer_data(struct msu_dvc_dev *mdd)
 			goto err_l_buf;
 		}
 	} else {
-		mdd->tdata.buffer_sg_len =
-		    mdd->tdata.block_count * mdd->tdata.block_size;
-		mdd->tdata.buffer_sg = kmalloc(mdd->tdata.buffer_sg_len, GFP_KERNEL);
-		if(mdd->tdata.buffer_sg == NULL)
+		/* the window pages go out as they are, no bounce buffer */
+		if (mdd->tdata.zero_copy) {
+			mdd->tdata.buffer_sg = NULL;
 			mdd->tdata.buffer_sg_len = 0;
+		} else {
+			mdd->tdata.buffer_sg_len =
+			    mdd->tdata.block_count * mdd->tdata.block_size;
+			mdd->tdata.buffer_sg = kmalloc(mdd->tdata.buffer_sg_len,
+						       GFP_KERNEL);
+			if (mdd->tdata.buffer_sg == NULL)
+				mdd->tdata.buffer_sg_len = 0;
+		}
 
 		mdd->tdata.buffer = NULL;
 		mdd->tdata.buffer_dma = 0;
@@ -698,13 +740,14 @@ static int (*send_funcs[])(struct msu_dvc_dev *, int) = {
 };
 
 #ifdef MDD_DEBUG
-static int mdd_proc_add_stats(struct msu_dvc_dev *mdd, int nents)
+static int mdd_proc_add_stats(struct msu_dvc_dev *mdd,
+			      struct scatterlist *sgl, int nents)
 {
 	int i, count;
 	struct scatterlist *sg;
 
 	/*MDD_F_DEBUG(); */
-	for_each_sg(mdd->tdata.sg_raw, sg, nents, i) {
+	for_each_sg(sgl, sg, nents, i) {
 		count = msc_data_sz((struct msc_block_desc *)sg_virt(sg));
 		mdd->stats.full_block_size += sg->length;
 		mdd->stats.valid_block_size += (count + MSC_BDESC);
@@ -714,10 +757,11 @@ static int mdd_proc_add_stats(struct msu_dvc_dev *mdd, int nents)
 	return i;
 }
 #else
-#define mdd_proc_add_stats(m, n) do {} while (0)
+#define mdd_proc_add_stats(m, s, n) do {} while (0)
 #endif
 
-static int mdd_proc_trimmed_blocks(struct msu_dvc_dev *mdd, int nents)
+static int mdd_proc_trimmed_blocks(struct msu_dvc_dev *mdd,
+				   struct scatterlist *sgl, int nents)
 {
 	u8 *ptr;
 	size_t len;
@@ -725,11 +769,11 @@ static int mdd_proc_trimmed_blocks(struct msu_dvc_dev *mdd, int nents)
 	struct scatterlist *sg, *sg_dest = NULL;
 
 	/*MDD_F_DEBUG(); */
-	mdd_proc_add_stats(mdd, nents);
+	mdd_proc_add_stats(mdd, sgl, nents);
 
 	sg_init_table(mdd->tdata.sg_proc, nents);
 
-	for_each_sg(mdd->tdata.sg_raw, sg, nents, i) {
+	for_each_sg(sgl, sg, nents, i) {
 		ptr = sg_virt(sg);
 		len = msc_data_sz((struct msc_block_desc *)ptr);
 		if (!len) {
@@ -752,7 +796,8 @@ static int mdd_proc_trimmed_blocks(struct msu_dvc_dev *mdd, int nents)
 	return out_cnt;
 }
 
-static int mdd_proc_stp_only(struct msu_dvc_dev *mdd, int nents)
+static int mdd_proc_stp_only(struct msu_dvc_dev *mdd,
+			     struct scatterlist *sgl, int nents)
 {
 	u8 *ptr;
 	size_t len;
@@ -760,11 +805,11 @@ static int mdd_proc_stp_only(struct msu_dvc_dev *mdd, int nents)
 	struct scatterlist *sg, *sg_dest = NULL;
 
 	/*MDD_F_DEBUG(); */
-	mdd_proc_add_stats(mdd, nents);
+	mdd_proc_add_stats(mdd, sgl, nents);
 
 	sg_init_table(mdd->tdata.sg_proc, nents);
 
-	for_each_sg(mdd->tdata.sg_raw, sg, nents, i) {
+	for_each_sg(sgl, sg, nents, i) {
 		ptr = sg_virt(sg);
 		len = msc_data_sz((struct msc_block_desc *)ptr);
 		ptr += MSC_BDESC;
@@ -785,7 +830,8 @@ static int mdd_proc_stp_only(struct msu_dvc_dev *mdd, int nents)
 	return out_cnt;
 }
 
-static int (*proc_funcs[]) (struct msu_dvc_dev *, int) = {
+static int (*proc_funcs[]) (struct msu_dvc_dev *, struct scatterlist *,
+			    int) = {
 #ifdef MDD_DEBUG
 	[MDD_PROC_NONE] = mdd_proc_add_stats,
 #endif
@@ -793,20 +839,106 @@ static int (*proc_funcs[]) (struct msu_dvc_dev *, int) = {
 	[MDD_PROC_REM_ALL] = mdd_proc_stp_only,
 };
 
+/*
+ * Zero copy: the MSU drain hands us each completed window and only gives it
+ * back to the hardware once we return, so the blocks are queued to the
+ * endpoint as they are and we wait for the request to complete.
+ */
+static int mdd_sink_emit(void *priv, struct scatterlist *sgl,
+			 unsigned int nents)
+{
+	struct msu_dvc_dev *mdd = priv;
+	int ret, n = nents;
+
+	if (atomic_read(mdd->dtc_status) != DVCT_MASK_ONLINE_TRANS)
+		return -ESHUTDOWN;
+
+	stats_loop(mdd);
+
+	if (proc_funcs[mdd->process_type]) {
+		n = proc_funcs[mdd->process_type] (mdd, sgl, n);
+		if (n < 0)
+			return n;
+	}
+
+	if (mdd->process_type == MDD_PROC_NONE)
+		mdd->tdata.sg_trans = sgl;
+
+	if (!n)
+		return 0;
+
+	stats_hit(mdd);
+	ret = mdd_send_sg(mdd, n);
+
+	/* stopped early, the window must not be reused under the transfer */
+	if (atomic_read(&mdd->req_ongoing)) {
+		usb_ep_dequeue(mdd->ep, mdd->req);
+		wait_event(mdd->wq, !atomic_read(&mdd->req_ongoing));
+	}
+
+	return ret;
+}
+
+static const struct msc_sink_ops mdd_sink_ops = {
+	.emit	= mdd_sink_emit,
+};
+
+static void mdd_zero_copy_loop(struct msu_dvc_dev *mdd)
+{
+	int ret, retry_cnt = 0;
+
+	while (atomic_read(mdd->dtc_status) == DVCT_MASK_ONLINE_TRANS) {
+		ret = msc_sink_drain(mdd->th_dev,
+				     retry_cnt >= mdd->max_retry_count ?
+				     0 : mdd->min_transfer);
+		if (ret < 0) {
+			mdd_err(mdd, "Cannot get ith data\n");
+			dvct_set_status(mdd->dtc_status, DVCT_MASK_ERR);
+			break;
+		}
+
+		if (ret)
+			retry_cnt = 0;
+		else if (retry_cnt < mdd->max_retry_count)
+			retry_cnt++;
+
+		/*wait for stop or timeout */
+		wait_event_timeout(mdd->wq,
+				   (atomic_read(mdd->dtc_status) !=
+				    DVCT_MASK_ONLINE_TRANS),
+				   msecs_to_jiffies(mdd->retry_timeout));
+	}
+}
+
 static void mdd_work(struct work_struct *work)
 {
 	int nents, current_bytes, retry_cnt = 0;
 	struct msu_dvc_dev *mdd;
+	bool zero_copy;
 
 	MDD_F_DEBUG();
 	mdd = container_of(work, struct msu_dvc_dev, work);
 	init_stats_start(mdd);
 
+	zero_copy = mdd->zero_copy && mdd->transfer_type != MDD_TRANSFER_SINGLE;
+	if (zero_copy &&
+	    msc_sink_register(mdd->th_dev, &mdd_sink_ops, mdd)) {
+		mdd_warn(mdd, "MSC window sink busy, copying\n");
+		zero_copy = false;
+	}
+	mdd->tdata.zero_copy = zero_copy;
+
 	if (mdd_setup_transfer_data(mdd)) {
 		mdd_err(mdd, "Cannot setup transfer data\n");
+		if (zero_copy)
+			msc_sink_unregister(mdd->th_dev);
 		return;
 	}
 	mdd_info(mdd, "Start transfer loop\n");
+	if (zero_copy) {
+		mdd_zero_copy_loop(mdd);
+		msc_sink_unregister(mdd->th_dev);
+	}
 	while (atomic_read(mdd->dtc_status) == DVCT_MASK_ONLINE_TRANS) {
 		sg_init_table(mdd->tdata.sg_raw, mdd->tdata.block_count);
 		/* Maybe will be better if msc_sg_oldest_win changes the window
@@ -841,7 +973,9 @@ static void mdd_work(struct work_struct *work)
 		}
 
 		if (nents && proc_funcs[mdd->process_type]) {
-			nents = proc_funcs[mdd->process_type] (mdd, nents);
+			nents = proc_funcs[mdd->process_type] (mdd,
+							mdd->tdata.sg_raw,
+							nents);
 			if (nents < 0) {
 				mdd_err(mdd, "Cannot process data\n");
 				dvct_set_status(mdd->dtc_status, DVCT_MASK_ERR);
@@ -1057,6 +1191,7 @@ static struct attribute *mdd_attrs[] = {
 	&dev_attr_mdd_max_retry.attr,
 	&dev_attr_mdd_transfer_type.attr,
 	&dev_attr_mdd_proc_type.attr,
+	&dev_attr_mdd_zero_copy.attr,
 #ifdef MDD_DEBUG
 	&dev_attr_mdd_stats.attr,
 #endif
@@ -18,6 +18,9 @@
 #include <linux/fs.h>
 #include <linux/io.h>
 #include <linux/dma-mapping.h>
+#include <linux/scatterlist.h>
+#include <linux/uio.h>
+#include <linux/workqueue.h>
 
 #ifdef CONFIG_X86
 #include <asm/set_memory.h>
@@ -104,6 +107,15 @@ struct msc_iter {
  * @index:		number of this MSC in the MSU
  *
  * @max_blocks:		Maximum number of blocks in a window
+ *
+ * @sink_ops:		in-kernel consumer of completed windows
+ * @sink_priv:		private data of @sink_ops
+ * @sink_file:		file of the built-in file sink, if attached
+ * @drain_work:		worker handing completed windows to the sink
+ * @drain_ms:		drain period, 0 to disable
+ * @drained_wins:	number of windows handed to the sink
+ * @drained_bytes:	amount of block data handed to the sink
+ * @drain_errors:	number of windows the sink failed to consume
  */
 struct msc {
 	void __iomem		*reg_base;
@@ -132,6 +144,15 @@ struct msc {
 	unsigned int		burst_len;
 	unsigned int		index;
 	unsigned int		max_blocks;
+
+	const struct msc_sink_ops *sink_ops;
+	void			*sink_priv;
+	struct file		*sink_file;
+	struct delayed_work	drain_work;
+	unsigned int		drain_ms;
+	unsigned long		drained_wins;
+	unsigned long		drained_bytes;
+	unsigned long		drain_errors;
 };
 
 static struct msc_probe_rem_cb msc_probe_rem_cb;
@@ -439,6 +460,40 @@ int msc_current_win_bytes(struct intel_th_device *thdev)
 }
 EXPORT_SYMBOL_GPL(msc_current_win_bytes);
 
+/**
+ * msc_win_to_sg() - collect the blocks of a window, oldest data first
+ * @win:	window to look at
+ * @sgl:	initialized scatterlist with at least @win->nr_blocks entries
+ *
+ * Return:	number of entries used in @sgl
+ */
+static unsigned int msc_win_to_sg(struct msc_window *win,
+				  struct scatterlist *sgl)
+{
+	unsigned int blk = msc_win_oldest_block(win), nents = 0;
+	struct msc_block_desc *bdesc;
+
+	/* start with the first block containing only oldest data */
+	if (msc_block_wrapped(win->block[blk].bdesc))
+		if (++blk == win->nr_blocks)
+			blk = 0;
+
+	do {
+		bdesc = win->block[blk].bdesc;
+		sg_set_buf(&sgl[nents++], bdesc, PAGE_SIZE);
+
+		if (bdesc->hw_tag & MSC_HW_TAG_ENDBIT)
+			break;
+
+		if (++blk == win->nr_blocks)
+			blk = 0;
+	} while (nents < win->nr_blocks);
+
+	sg_mark_end(&sgl[nents - 1]);
+
+	return nents;
+}
+
 /**
  * msc_sg_oldest_win() - get the data from the oldest window
  * @thdev:	the sub-device
@@ -451,8 +506,7 @@ int msc_sg_oldest_win(struct intel_th_device *thdev,
 {
 	struct msc *msc = dev_get_drvdata(&thdev->dev);
 	struct msc_window *win, *c_win;
-	struct msc_block_desc *bdesc;
-	unsigned int blk, sg = 0;
+	unsigned int sg;
 
 	/* proceed only if actively storing in muli-window mode */
 	if (!msc->enabled ||
@@ -469,26 +523,7 @@ int msc_sg_oldest_win(struct intel_th_device *thdev,
 	if (win == c_win)
 		return 0;
 
-	blk = msc_win_oldest_block(win);
-
-	/* start with the first block containing only oldest data */
-	if (msc_block_wrapped(win->block[blk].bdesc))
-		if (++blk == win->nr_blocks)
-			blk = 0;
-
-	do {
-		bdesc = win->block[blk].bdesc;
-		sg_set_buf(&sg_array[sg++], bdesc, PAGE_SIZE);
-
-		if (bdesc->hw_tag & MSC_HW_TAG_ENDBIT)
-			break;
-
-		if (++blk == win->nr_blocks)
-			blk = 0;
-
-	} while (sg <= win->nr_blocks);
-
-	sg_mark_end(&sg_array[sg - 1]);
+	sg = msc_win_to_sg(win, sg_array);
 
 	atomic_dec(&msc->user_count);
 
@@ -746,23 +781,27 @@ msc_buffer_iterate(struct msc_iter *iter, size_t size, void *data,
  * msc_buffer_clear_hw_header() - clear hw header for multiblock
  * @msc:	MSC device
  */
-static void msc_buffer_clear_hw_header(struct msc *msc)
+static void msc_win_clear_hw_header(struct msc_window *win)
 {
-	struct msc_window *win;
-
-	list_for_each_entry(win, &msc->win_list, entry) {
-		unsigned int blk;
-		size_t hw_sz = sizeof(struct msc_block_desc) -
-			offsetof(struct msc_block_desc, hw_tag);
+	unsigned int blk;
+	size_t hw_sz = sizeof(struct msc_block_desc) -
+		offsetof(struct msc_block_desc, hw_tag);
 
-		for (blk = 0; blk < win->nr_blocks; blk++) {
-			struct msc_block_desc *bdesc = win->block[blk].bdesc;
+	for (blk = 0; blk < win->nr_blocks; blk++) {
+		struct msc_block_desc *bdesc = win->block[blk].bdesc;
 
-			memset(&bdesc->hw_tag, 0, hw_sz);
-		}
+		memset(&bdesc->hw_tag, 0, hw_sz);
 	}
 }
 
+static void msc_buffer_clear_hw_header(struct msc *msc)
+{
+	struct msc_window *win;
+
+	list_for_each_entry(win, &msc->win_list, entry)
+		msc_win_clear_hw_header(win);
+}
+
 /**
  * msc_configure() - set up MSC hardware
  * @msc:	the MSC device to configure
@@ -852,6 +891,275 @@ static void msc_disable(struct msc *msc)
 	dev_dbg(msc_dev(msc), "MSCnSTS: %08x\n", reg);
 }
 
+/*
+ * In-kernel window consumer
+ *
+ * In multi-window mode, full windows are only retired by a reader that keeps
+ * switching and draining them; otherwise the oldest trace gets overwritten
+ * under load.  With a sink attached and drain_ms set, the drain worker hands
+ * every completed window to the sink, clears it for reuse by the hardware and
+ * switches away from the current window as soon as it holds data.
+ */
+
+/**
+ * msc_drain_windows() - hand completed windows to the sink
+ * @msc:	MSC device
+ * @all:	also drain the current window, only valid once disabled
+ *
+ * Caller should hold msc::buf_mutex and the msc::user_count reference.
+ */
+static void msc_drain_windows(struct msc *msc, bool all)
+{
+	struct msc_window *win, *cur;
+	struct scatterlist *sgl;
+	unsigned long budget = msc->nr_pages;
+	unsigned int nents;
+	int ret;
+
+	lockdep_assert_held(&msc->buf_mutex);
+
+	if (!msc->sink_ops || msc->mode != MSC_MODE_MULTI)
+		return;
+
+	cur = all ? NULL : msc_current_window(msc);
+
+	/* each drained window is cleared, so this visits it only once */
+	while (budget--) {
+		win = msc_oldest_window(msc);
+		if (!win || win == cur ||
+		    msc_block_is_empty(win->block[0].bdesc))
+			break;
+
+		sgl = kcalloc(win->nr_blocks, sizeof(*sgl), GFP_KERNEL);
+		if (!sgl) {
+			msc->drain_errors++;
+			break;
+		}
+
+		sg_init_table(sgl, win->nr_blocks);
+		nents = msc_win_to_sg(win, sgl);
+		ret = msc->sink_ops->emit(msc->sink_priv, sgl, nents);
+		kfree(sgl);
+
+		if (ret) {
+			msc->drain_errors++;
+		} else {
+			msc->drained_wins++;
+			msc->drained_bytes += nents * PAGE_SIZE;
+		}
+
+		msc_win_clear_hw_header(win);
+	}
+}
+
+/**
+ * msc_sink_drain() - run one drain round for the attached sink
+ * @thdev:	the sub-device
+ * @min_bytes:	switch away from the current window once it holds more
+ *
+ * Lets a sink pace the draining itself instead of relying on drain_ms.
+ *
+ * Return:	1 if the current window was switched, 0 if not, or -ENODEV
+ *		if there is no buffer
+ */
+int msc_sink_drain(struct intel_th_device *thdev, int min_bytes)
+{
+	struct msc *msc = dev_get_drvdata(&thdev->dev);
+	int ret = 0;
+
+	if (!atomic_inc_unless_negative(&msc->user_count))
+		return -ENODEV;
+
+	mutex_lock(&msc->buf_mutex);
+	if (msc->enabled && msc->sink_ops) {
+		msc_drain_windows(msc, false);
+
+		/* the current window is drained on the next round */
+		if (msc_current_win_bytes(msc->thdev) > min_bytes) {
+			intel_th_trace_switch(msc->thdev);
+			ret = 1;
+		}
+	}
+	mutex_unlock(&msc->buf_mutex);
+
+	atomic_dec(&msc->user_count);
+
+	return ret;
+}
+EXPORT_SYMBOL_GPL(msc_sink_drain);
+
+static void msc_drain_work(struct work_struct *work)
+{
+	struct msc *msc = container_of(to_delayed_work(work), struct msc,
+				       drain_work);
+	unsigned int ms;
+
+	msc_sink_drain(msc->thdev, 0);
+
+	ms = READ_ONCE(msc->drain_ms);
+	if (ms)
+		schedule_delayed_work(&msc->drain_work, msecs_to_jiffies(ms));
+}
+
+/**
+ * msc_sink_register() - attach an in-kernel consumer of completed windows
+ * @thdev:	the sub-device
+ * @ops:	sink operations
+ * @priv:	passed to @ops
+ *
+ * Return:	0 on success, -EBUSY if a sink is already attached
+ */
+static int __msc_sink_register(struct msc *msc, const struct msc_sink_ops *ops,
+			       void *priv)
+{
+	lockdep_assert_held(&msc->buf_mutex);
+
+	if (msc->sink_ops)
+		return -EBUSY;
+
+	msc->sink_ops = ops;
+	msc->sink_priv = priv;
+
+	return 0;
+}
+
+int msc_sink_register(struct intel_th_device *thdev,
+		      const struct msc_sink_ops *ops, void *priv)
+{
+	struct msc *msc = dev_get_drvdata(&thdev->dev);
+	int ret;
+
+	mutex_lock(&msc->buf_mutex);
+	ret = __msc_sink_register(msc, ops, priv);
+	mutex_unlock(&msc->buf_mutex);
+
+	return ret;
+}
+EXPORT_SYMBOL_GPL(msc_sink_register);
+
+static void __msc_sink_unregister(struct msc *msc)
+{
+	lockdep_assert_held(&msc->buf_mutex);
+
+	msc->sink_ops = NULL;
+	msc->sink_priv = NULL;
+}
+
+/**
+ * msc_sink_unregister() - detach the in-kernel consumer
+ * @thdev:	the sub-device
+ *
+ * No more calls to the sink's operations are made once this returns.
+ */
+void msc_sink_unregister(struct intel_th_device *thdev)
+{
+	struct msc *msc = dev_get_drvdata(&thdev->dev);
+
+	mutex_lock(&msc->buf_mutex);
+	__msc_sink_unregister(msc);
+	mutex_unlock(&msc->buf_mutex);
+}
+EXPORT_SYMBOL_GPL(msc_sink_unregister);
+
+/*
+ * Built-in file sink: the blocks are written straight from the MSU pages,
+ * with O_DIRECT where the file system supports it.
+ */
+static int msc_file_sink_emit(void *priv, struct scatterlist *sgl,
+			      unsigned int nents)
+{
+	struct file *file = priv;
+	struct scatterlist *sg;
+	struct bio_vec *bvec;
+	struct iov_iter iter;
+	size_t len = 0;
+	loff_t pos = 0;
+	unsigned int i;
+	ssize_t ret;
+
+	bvec = kcalloc(nents, sizeof(*bvec), GFP_KERNEL);
+	if (!bvec)
+		return -ENOMEM;
+
+	for_each_sg(sgl, sg, nents, i) {
+		bvec[i].bv_page = sg_page(sg);
+		bvec[i].bv_len = sg->length;
+		bvec[i].bv_offset = sg->offset;
+		len += sg->length;
+	}
+
+	/* O_APPEND takes care of the position */
+	iov_iter_bvec(&iter, ITER_BVEC | WRITE, bvec, nents, len);
+	file_start_write(file);
+	ret = vfs_iter_write(file, &iter, &pos, 0);
+	file_end_write(file);
+	kfree(bvec);
+
+	if (ret < 0)
+		return ret;
+
+	return ret == len ? 0 : -EIO;
+}
+
+static const struct msc_sink_ops msc_file_sink_ops = {
+	.emit	= msc_file_sink_emit,
+};
+
+static struct file *msc_file_sink_open(const char *path)
+{
+	int flags = O_WRONLY | O_CREAT | O_APPEND | O_LARGEFILE;
+	struct file *file;
+
+	file = filp_open(path, flags | O_DIRECT, 0600);
+	if (IS_ERR(file))
+		file = filp_open(path, flags, 0600);
+
+	return file;
+}
+
+/*
+ * Replace the file sink with @path, or just detach it if @path is NULL.
+ * The swap happens under msc::buf_mutex, so it can't race with a window
+ * switch or a drain round; the files are opened and closed outside of it.
+ */
+static int msc_file_sink_switch(struct msc *msc, const char *path)
+{
+	struct file *file = NULL, *old;
+	int ret = 0;
+
+	if (path) {
+		file = msc_file_sink_open(path);
+		if (IS_ERR(file))
+			return PTR_ERR(file);
+	}
+
+	mutex_lock(&msc->buf_mutex);
+	old = msc->sink_file;
+	if (old) {
+		__msc_sink_unregister(msc);
+		msc->sink_file = NULL;
+	}
+
+	if (file) {
+		ret = __msc_sink_register(msc, &msc_file_sink_ops, file);
+		if (!ret)
+			msc->sink_file = file;
+	}
+	mutex_unlock(&msc->buf_mutex);
+
+	if (old)
+		filp_close(old, NULL);
+	if (ret)
+		filp_close(file, NULL);
+
+	return ret;
+}
+
+static void msc_file_sink_detach(struct msc *msc)
+{
+	msc_file_sink_switch(msc, NULL);
+}
+
 static int intel_th_msc_activate(struct intel_th_device *thdev)
 {
 	struct msc *msc = dev_get_drvdata(&thdev->dev);
@@ -881,6 +1189,8 @@ static void intel_th_msc_deactivate(struct intel_th_device *thdev)
 	mutex_lock(&msc->buf_mutex);
 	if (msc->enabled) {
 		msc_disable(msc);
+		/* nothing is written any more, flush the tail to the sink */
+		msc_drain_windows(msc, true);
 		atomic_dec(&msc->user_count);
 	}
 	mutex_unlock(&msc->buf_mutex);
@@ -1817,6 +2127,7 @@ static int intel_th_msc_init(struct msc *msc)
 	mutex_init(&msc->buf_mutex);
 	INIT_LIST_HEAD(&msc->win_list);
 	INIT_LIST_HEAD(&msc->iter_list);
+	INIT_DELAYED_WORK(&msc->drain_work, msc_drain_work);
 
 	msc->burst_len =
 		(ioread32(msc->reg_base + REG_MSU_MSC0CTL) & MSC_LEN) >>
@@ -2026,11 +2337,101 @@ win_switch_store(struct device *dev, struct device_attribute *attr,
 
 static DEVICE_ATTR_WO(win_switch);
 
+static ssize_t
+sink_show(struct device *dev, struct device_attribute *attr, char *buf)
+{
+	struct msc *msc = dev_get_drvdata(dev);
+	const char *sink = "none";
+
+	mutex_lock(&msc->buf_mutex);
+	if (msc->sink_file)
+		sink = "file";
+	else if (msc->sink_ops)
+		sink = "external";
+	mutex_unlock(&msc->buf_mutex);
+
+	return scnprintf(buf, PAGE_SIZE, "%s\n", sink);
+}
+
+static ssize_t
+sink_store(struct device *dev, struct device_attribute *attr, const char *buf,
+	   size_t size)
+{
+	struct msc *msc = dev_get_drvdata(dev);
+	char *path;
+	int ret = 0;
+
+	if (!capable(CAP_SYS_ADMIN))
+		return -EPERM;
+
+	path = kstrndup(buf, size, GFP_KERNEL);
+	if (!path)
+		return -ENOMEM;
+
+	strim(path);
+
+	/* "none" detaches the file sink, anything else names a file */
+	if (*path && strcmp(path, "none"))
+		ret = msc_file_sink_switch(msc, path);
+	else
+		msc_file_sink_detach(msc);
+
+	kfree(path);
+
+	return ret ? ret : size;
+}
+
+static DEVICE_ATTR_RW(sink);
+
+static ssize_t
+drain_ms_show(struct device *dev, struct device_attribute *attr, char *buf)
+{
+	struct msc *msc = dev_get_drvdata(dev);
+
+	return scnprintf(buf, PAGE_SIZE, "%u\n", READ_ONCE(msc->drain_ms));
+}
+
+static ssize_t
+drain_ms_store(struct device *dev, struct device_attribute *attr,
+	       const char *buf, size_t size)
+{
+	struct msc *msc = dev_get_drvdata(dev);
+	unsigned int val, old;
+	int ret;
+
+	ret = kstrtouint(buf, 10, &val);
+	if (ret)
+		return ret;
+
+	old = xchg(&msc->drain_ms, val);
+	if (val && !old)
+		schedule_delayed_work(&msc->drain_work, msecs_to_jiffies(val));
+
+	return size;
+}
+
+static DEVICE_ATTR_RW(drain_ms);
+
+static ssize_t
+drain_stats_show(struct device *dev, struct device_attribute *attr, char *buf)
+{
+	struct msc *msc = dev_get_drvdata(dev);
+
+	return scnprintf(buf, PAGE_SIZE, "windows %lu bytes %lu errors %lu\n",
+			 msc->drained_wins, msc->drained_bytes,
+			 msc->drain_errors);
+}
+
+static DEVICE_ATTR_RO(drain_stats);
+
 static struct attribute *msc_output_attrs[] = {
 	&dev_attr_wrap.attr,
 	&dev_attr_mode.attr,
 	&dev_attr_nr_pages.attr,
 	&dev_attr_win_switch.attr,
+	&dev_attr_sink.attr,
+	&dev_attr_drain_ms.attr,
+	&dev_attr_drain_stats.attr,
 	NULL,
 };
 
@@ -2079,9 +2480,15 @@ static int intel_th_msc_probe(struct intel_th_device *thdev)
 static void intel_th_msc_remove(struct intel_th_device *thdev)
 {
 	struct msc *msc = dev_get_drvdata(&thdev->dev);
+
+	/* drain_ms and sink stores can't re-arm the drain from here on */
+	sysfs_remove_group(&thdev->dev.kobj, &msc_output_group);
+
+	WRITE_ONCE(msc->drain_ms, 0);
+	cancel_delayed_work_sync(&msc->drain_work);
+	msc_file_sink_detach(msc);
 	intel_th_npkt_remove(msc);
 	msc_rm_instance(thdev);
-	sysfs_remove_group(&thdev->dev.kobj, &msc_output_group);
 }
 
 static struct intel_th_driver intel_th_msc_driver = {
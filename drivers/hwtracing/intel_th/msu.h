@@ -122,4 +122,19 @@ int msc_sg_oldest_win(struct intel_th_device *thdev,
 		      struct scatterlist *sg_array);
 int msc_current_win_bytes(struct intel_th_device *thdev);
 
+/**
+ * struct msc_sink_ops - in-kernel consumer of completed windows
+ * @emit:	called by the drain worker with the blocks of a completed
+ *		window, oldest first; the window is handed back to the
+ *		hardware when this returns
+ */
+struct msc_sink_ops {
+	int (*emit)(void *priv, struct scatterlist *sgl, unsigned int nents);
+};
+
+int msc_sink_register(struct intel_th_device *thdev,
+		      const struct msc_sink_ops *ops, void *priv);
+void msc_sink_unregister(struct intel_th_device *thdev);
+int msc_sink_drain(struct intel_th_device *thdev, int min_bytes);
+
 #endif /* __INTEL_TH_MSU_H__ */
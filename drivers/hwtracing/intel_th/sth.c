@@ -14,6 +14,9 @@
 #include <linux/mm.h>
 #include <linux/slab.h>
 #include <linux/stm.h>
+#include <linux/hardirq.h>
+#include <linux/mutex.h>
+#include <linux/trace.h>
 
 #include "intel_th.h"
 #include "sth.h"
@@ -25,6 +28,13 @@ struct sth_device {
 	struct device	*dev;
 	struct stm_data	stm;
 	unsigned int	sw_nmasters;
+#ifdef CONFIG_INTEL_TH_STH_EXPORT
+	struct trace_export	export;
+	struct mutex		export_lock;
+	struct intel_th_channel __iomem *export_base;
+	unsigned int		export_master;
+	unsigned int		export_nmasters;
+#endif
 };
 
 static struct intel_th_channel __iomem *
@@ -36,8 +46,9 @@ sth_channel(struct sth_device *sth, unsigned int master, unsigned int channel)
 		       channel];
 }
 
-static void sth_iowrite(void __iomem *dest, const unsigned char *payload,
-			unsigned int size)
+static void notrace sth_iowrite(void __iomem *dest,
+				const unsigned char *payload,
+				unsigned int size)
 {
 	switch (size) {
 #ifdef CONFIG_64BIT
@@ -162,6 +173,212 @@ static int sth_stm_link(struct stm_data *stm_data, unsigned int master,
 	return 0;
 }
 
+#ifdef CONFIG_INTEL_TH_STH_EXPORT
+/*
+ * Direct ftrace export
+ *
+ * Going through stm_ftrace, every CPU writes its events into the same
+ * channel, so events from different CPUs interleave on the wire, and each
+ * one goes through the stm core first. Here, each CPU gets a channel per
+ * context it may trace from (task, softirq, irq, nmi), so an event is never
+ * interrupted by another one on its channel and can be written out with
+ * plain MMIO stores, without any locking. The first packet of an event is
+ * timestamped by the hardware.
+ */
+enum {
+	STH_EXPORT_TASK,
+	STH_EXPORT_SOFTIRQ,
+	STH_EXPORT_IRQ,
+	STH_EXPORT_NMI,
+	STH_EXPORT_NR_CTX,
+};
+
+#ifdef CONFIG_64BIT
+#define STH_EXPORT_MAX_PACKET	8
+#else
+#define STH_EXPORT_MAX_PACKET	4
+#endif
+
+static __always_inline unsigned int sth_export_ctx(void)
+{
+	if (in_nmi())
+		return STH_EXPORT_NMI;
+	if (in_irq())
+		return STH_EXPORT_IRQ;
+	if (in_serving_softirq())
+		return STH_EXPORT_SOFTIRQ;
+
+	return STH_EXPORT_TASK;
+}
+
+/* called by ftrace with preemption disabled */
+static void notrace
+sth_export_write(struct trace_export *export, const void *buf, unsigned int len)
+{
+	struct sth_device *sth =
+		container_of(export, struct sth_device, export);
+	struct intel_th_channel __iomem *out;
+	const unsigned char *p = buf;
+	u64 __iomem *outp;
+	unsigned int sz;
+
+	out = sth->export_base + raw_smp_processor_id() * STH_EXPORT_NR_CTX +
+	      sth_export_ctx();
+
+	for (outp = &out->DnTS; len; outp = &out->Dn, p += sz, len -= sz) {
+		sz = rounddown_pow_of_two(min_t(unsigned int, len,
+						STH_EXPORT_MAX_PACKET));
+		sth_iowrite(outp, p, sz);
+	}
+
+	writeb_relaxed(0, &out->FLAG);
+}
+
+static void sth_export_stop(struct sth_device *sth)
+{
+	if (!sth->export.flags)
+		return;
+
+	unregister_ftrace_export(&sth->export);
+	/* wait for sth_export_write() callers that saw it still listed */
+	synchronize_sched();
+	sth->export.flags = 0;
+}
+
+static int sth_export_start(struct sth_device *sth, int flags)
+{
+	unsigned int master;
+	int ret;
+
+	for (master = sth->export_master;
+	     master < sth->export_master + sth->export_nmasters; master++)
+		intel_th_set_output(to_intel_th_device(sth->dev), master);
+
+	sth->export_base = sth_channel(sth, sth->export_master, 0);
+	sth->export.flags = flags;
+
+	ret = register_ftrace_export(&sth->export);
+	if (ret)
+		sth->export.flags = 0;
+
+	return ret;
+}
+
+static int sth_export_init(struct sth_device *sth)
+{
+	unsigned int nch = nr_cpu_ids * STH_EXPORT_NR_CTX;
+
+	mutex_init(&sth->export_lock);
+	sth->export.write = sth_export_write;
+
+	/* channels of consecutive masters are contiguous in the MMIO space */
+	sth->export_nmasters = DIV_ROUND_UP(nch, sth->stm.sw_nchannels);
+	if (sth->export_nmasters >= sth->sw_nmasters) {
+		sth->export_nmasters = 0;
+		return 0;
+	}
+
+	/* default to the highest masters, out of the way of stm policies */
+	sth->export_master = sth->stm.sw_end - sth->export_nmasters;
+
+	return 0;
+}
+
+static const char * const sth_export_modes[] = {
+	[0]					= "none",
+	[TRACE_EXPORT_FUNCTION]			= "function",
+	[TRACE_EXPORT_EVENT]			= "event",
+	[TRACE_EXPORT_FUNCTION | TRACE_EXPORT_EVENT] = "all",
+};
+
+static ssize_t
+export_show(struct device *dev, struct device_attribute *attr, char *buf)
+{
+	struct sth_device *sth = dev_get_drvdata(dev);
+
+	return scnprintf(buf, PAGE_SIZE, "%s\n",
+			 sth_export_modes[READ_ONCE(sth->export.flags)]);
+}
+
+static ssize_t
+export_store(struct device *dev, struct device_attribute *attr,
+	     const char *buf, size_t size)
+{
+	struct sth_device *sth = dev_get_drvdata(dev);
+	int flags, ret = 0;
+
+	flags = sysfs_match_string(sth_export_modes, buf);
+	if (flags < 0)
+		return flags;
+
+	if (flags && !sth->export_nmasters)
+		return -ENOSPC;
+
+	mutex_lock(&sth->export_lock);
+	if (flags != sth->export.flags) {
+		sth_export_stop(sth);
+		if (flags)
+			ret = sth_export_start(sth, flags);
+	}
+	mutex_unlock(&sth->export_lock);
+
+	return ret ? ret : size;
+}
+
+static DEVICE_ATTR_RW(export);
+
+static ssize_t
+export_master_show(struct device *dev, struct device_attribute *attr,
+		   char *buf)
+{
+	struct sth_device *sth = dev_get_drvdata(dev);
+
+	return scnprintf(buf, PAGE_SIZE, "%u %u\n", sth->export_master,
+			 sth->export_nmasters);
+}
+
+static ssize_t
+export_master_store(struct device *dev, struct device_attribute *attr,
+		    const char *buf, size_t size)
+{
+	struct sth_device *sth = dev_get_drvdata(dev);
+	unsigned int val;
+	int ret;
+
+	ret = kstrtouint(buf, 0, &val);
+	if (ret)
+		return ret;
+
+	if (!sth->export_nmasters || val < sth->stm.sw_start ||
+	    val + sth->export_nmasters > sth->stm.sw_end)
+		return -EINVAL;
+
+	mutex_lock(&sth->export_lock);
+	if (sth->export.flags)
+		ret = -EBUSY;
+	else
+		sth->export_master = val;
+	mutex_unlock(&sth->export_lock);
+
+	return ret ? ret : size;
+}
+
+static DEVICE_ATTR_RW(export_master);
+
+static struct attribute *sth_export_attrs[] = {
+	&dev_attr_export.attr,
+	&dev_attr_export_master.attr,
+	NULL,
+};
+
+static struct attribute_group sth_export_group = {
+	.attrs	= sth_export_attrs,
+};
+#else
+static inline int sth_export_init(struct sth_device *sth) { return 0; }
+static inline void sth_export_stop(struct sth_device *sth) {}
+#endif
+
 static int intel_th_sw_init(struct sth_device *sth)
 {
 	u32 reg;
@@ -223,6 +440,10 @@ static int intel_th_sth_probe(struct intel_th_device *thdev)
 	if (err)
 		return err;
 
+	err = sth_export_init(sth);
+	if (err)
+		return err;
+
 	err = stm_register_device(dev, &sth->stm, THIS_MODULE);
 	if (err) {
 		dev_err(dev, "stm_register_device failed\n");
@@ -238,12 +459,16 @@ static void intel_th_sth_remove(struct intel_th_device *thdev)
 {
 	struct sth_device *sth = dev_get_drvdata(&thdev->dev);
 
+	sth_export_stop(sth);
 	stm_unregister_device(&sth->stm);
 }
 
 static struct intel_th_driver intel_th_sth_driver = {
 	.probe	= intel_th_sth_probe,
 	.remove	= intel_th_sth_remove,
+#ifdef CONFIG_INTEL_TH_STH_EXPORT
+	.attr_group = &sth_export_group,
+#endif
 	.driver	= {
 		.name	= "sth",
 		.owner	= THIS_MODULE,
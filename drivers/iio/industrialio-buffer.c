@@ -21,6 +21,9 @@
 #include <linux/slab.h>
 #include <linux/poll.h>
 #include <linux/sched/signal.h>
+#include <linux/sizes.h>
+#include <linux/uaccess.h>
+#include <linux/vmalloc.h>
 
 #include <linux/iio/iio.h>
 #include "iio_core.h"
@@ -28,6 +31,8 @@
 #include <linux/iio/buffer.h>
 #include <linux/iio/buffer_impl.h>
 
+#include <uapi/linux/iio/buffer.h>
+
 static const char * const iio_endian_prefix[] = {
 	[IIO_BE] = "be",
 	[IIO_LE] = "le",
@@ -90,6 +95,406 @@ static bool iio_buffer_ready(struct iio_dev *indio_dev, struct iio_buffer *buf,
 	return false;
 }
 
+/*
+ * Block queue
+ *
+ * Instead of storing samples in the buffer implementation, to be copied
+ * out by read(), the core can write them straight into blocks user space
+ * has mmap()ed from the buffer device. User space enqueues empty blocks,
+ * they are filled in order, and a block is completed, ready to be dequeued,
+ * once it holds watermark samples or no room is left. Sensor daemons get
+ * one wakeup and two ioctls per block rather than one read() per sample.
+ * Samples pushed while no block is queued are dropped.
+ */
+
+enum iio_block_state {
+	IIO_BLOCK_STATE_DEQUEUED,	/* owned by user space */
+	IIO_BLOCK_STATE_QUEUED,		/* waiting to be filled */
+	IIO_BLOCK_STATE_DONE,		/* waiting to be dequeued */
+};
+
+struct iio_block {
+	struct list_head head;
+	enum iio_block_state state;
+	struct iio_buffer_block block;
+};
+
+/* Lists and block states are protected by the block_lock of the buffer */
+struct iio_block_queue {
+	struct list_head incoming;
+	struct list_head outgoing;
+	struct iio_block *fill;
+	unsigned int dropped;
+
+	void *mem;
+	unsigned int nr_blocks;
+	struct iio_block blocks[];
+};
+
+static void iio_block_queue_free(struct iio_block_queue *queue)
+{
+	if (!queue)
+		return;
+
+	vfree(queue->mem);
+	kfree(queue);
+}
+
+/* Detach the queue of the buffer, which must not be active */
+static void iio_block_queue_release(struct iio_buffer *buf)
+{
+	struct iio_block_queue *queue;
+	unsigned long flags;
+
+	spin_lock_irqsave(&buf->block_lock, flags);
+	queue = buf->block_queue;
+	buf->block_queue = NULL;
+	spin_unlock_irqrestore(&buf->block_lock, flags);
+
+	iio_block_queue_free(queue);
+}
+
+static bool iio_block_queue_ready(struct iio_buffer *buf)
+{
+	unsigned long flags;
+	bool ready;
+
+	spin_lock_irqsave(&buf->block_lock, flags);
+	ready = buf->block_queue && !list_empty(&buf->block_queue->outgoing);
+	spin_unlock_irqrestore(&buf->block_lock, flags);
+
+	return ready;
+}
+
+/* Called with buf->block_lock held */
+static void iio_block_queue_complete(struct iio_dev *indio_dev,
+				     struct iio_block_queue *queue)
+{
+	struct iio_block *block = queue->fill;
+
+	block->block.timestamp = iio_get_time_ns(indio_dev);
+	block->state = IIO_BLOCK_STATE_DONE;
+	list_add_tail(&block->head, &queue->outgoing);
+	queue->fill = NULL;
+}
+
+static int iio_block_queue_store(struct iio_dev *indio_dev,
+				 struct iio_buffer *buf, const void *data)
+{
+	size_t bpd = buf->bytes_per_datum;
+	struct iio_block_queue *queue;
+	struct iio_block *block;
+	unsigned long flags;
+	bool done;
+
+	spin_lock_irqsave(&buf->block_lock, flags);
+
+	queue = buf->block_queue;
+	block = queue ? queue->fill : NULL;
+	if (!block) {
+		if (queue)
+			block = list_first_entry_or_null(&queue->incoming,
+							 struct iio_block,
+							 head);
+		if (!block) {
+			if (queue)
+				queue->dropped++;
+			spin_unlock_irqrestore(&buf->block_lock, flags);
+			return -EBUSY;
+		}
+		list_del(&block->head);
+		block->block.bytes_used = 0;
+		queue->fill = block;
+	}
+
+	memcpy(queue->mem + block->block.offset + block->block.bytes_used,
+	       data, bpd);
+	block->block.bytes_used += bpd;
+
+	done = block->block.bytes_used >= buf->watermark * bpd ||
+	       block->block.bytes_used + bpd > block->block.size;
+	if (done)
+		iio_block_queue_complete(indio_dev, queue);
+
+	spin_unlock_irqrestore(&buf->block_lock, flags);
+
+	if (done)
+		wake_up_interruptible_poll(&buf->pollq, EPOLLIN | EPOLLRDNORM);
+
+	return 0;
+}
+
+/* Hand the partly filled block to user space when the buffer is disabled */
+static void iio_block_queue_flush(struct iio_dev *indio_dev,
+				  struct iio_buffer *buf)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&buf->block_lock, flags);
+	if (buf->block_queue && buf->block_queue->fill)
+		iio_block_queue_complete(indio_dev, buf->block_queue);
+	spin_unlock_irqrestore(&buf->block_lock, flags);
+}
+
+static int iio_buffer_block_alloc(struct iio_dev *indio_dev,
+				  struct iio_buffer *buf, void __user *arg)
+{
+	struct iio_buffer_block_alloc_req req;
+	struct iio_block_queue *queue;
+	size_t size;
+	int i;
+
+	if (copy_from_user(&req, arg, sizeof(req)))
+		return -EFAULT;
+
+	if (req.type || req.id)
+		return -EINVAL;
+
+	if (iio_buffer_is_active(buf))
+		return -EBUSY;
+
+	iio_block_queue_release(buf);
+
+	if (!req.count)
+		return 0;
+
+	size = PAGE_ALIGN(req.size);
+	if (!size || size > SZ_16M || req.count > 64)
+		return -EINVAL;
+
+	/* a block must hold at least one scan */
+	if (size < buf->bytes_per_datum)
+		return -EINVAL;
+
+	queue = kzalloc(sizeof(*queue) + req.count * sizeof(queue->blocks[0]),
+			GFP_KERNEL);
+	if (!queue)
+		return -ENOMEM;
+
+	queue->mem = vmalloc_user(size * req.count);
+	if (!queue->mem) {
+		kfree(queue);
+		return -ENOMEM;
+	}
+
+	INIT_LIST_HEAD(&queue->incoming);
+	INIT_LIST_HEAD(&queue->outgoing);
+	queue->nr_blocks = req.count;
+	for (i = 0; i < req.count; i++) {
+		queue->blocks[i].state = IIO_BLOCK_STATE_DEQUEUED;
+		queue->blocks[i].block.id = i;
+		queue->blocks[i].block.size = size;
+		queue->blocks[i].block.offset = i * size;
+	}
+
+	spin_lock_irq(&buf->block_lock);
+	buf->block_queue = queue;
+	spin_unlock_irq(&buf->block_lock);
+
+	req.size = size;
+	if (copy_to_user(arg, &req, sizeof(req)))
+		return -EFAULT;
+
+	return 0;
+}
+
+static struct iio_block *iio_buffer_block_get(struct iio_block_queue *queue,
+					       void __user *arg)
+{
+	struct iio_buffer_block block;
+
+	if (copy_from_user(&block, arg, sizeof(block)))
+		return ERR_PTR(-EFAULT);
+
+	if (block.id >= queue->nr_blocks)
+		return ERR_PTR(-EINVAL);
+
+	return &queue->blocks[block.id];
+}
+
+static int iio_buffer_block_enqueue(struct iio_buffer *buf, void __user *arg)
+{
+	struct iio_block_queue *queue = buf->block_queue;
+	struct iio_block *block = iio_buffer_block_get(queue, arg);
+	unsigned long flags;
+	int ret = 0;
+
+	if (IS_ERR(block))
+		return PTR_ERR(block);
+
+	spin_lock_irqsave(&buf->block_lock, flags);
+	if (block->state == IIO_BLOCK_STATE_DEQUEUED) {
+		block->state = IIO_BLOCK_STATE_QUEUED;
+		list_add_tail(&block->head, &queue->incoming);
+	} else {
+		ret = -EBUSY;
+	}
+	spin_unlock_irqrestore(&buf->block_lock, flags);
+
+	return ret;
+}
+
+static int iio_buffer_block_query(struct iio_buffer *buf, void __user *arg)
+{
+	struct iio_block *block = iio_buffer_block_get(buf->block_queue, arg);
+	struct iio_buffer_block desc;
+	unsigned long flags;
+
+	if (IS_ERR(block))
+		return PTR_ERR(block);
+
+	/* the producer updates bytes_used and timestamp under the lock */
+	spin_lock_irqsave(&buf->block_lock, flags);
+	desc = block->block;
+	spin_unlock_irqrestore(&buf->block_lock, flags);
+
+	if (copy_to_user(arg, &desc, sizeof(desc)))
+		return -EFAULT;
+
+	return 0;
+}
+
+static int iio_buffer_block_dequeue(struct iio_buffer *buf, void __user *arg)
+{
+	struct iio_block_queue *queue = buf->block_queue;
+	struct iio_buffer_block desc;
+	struct iio_block *block;
+	unsigned long flags;
+
+	spin_lock_irqsave(&buf->block_lock, flags);
+	block = list_first_entry_or_null(&queue->outgoing, struct iio_block,
+					 head);
+	if (block) {
+		list_del(&block->head);
+		block->state = IIO_BLOCK_STATE_DEQUEUED;
+		desc = block->block;
+	}
+	spin_unlock_irqrestore(&buf->block_lock, flags);
+
+	if (!block)
+		return -EAGAIN;
+
+	if (copy_to_user(arg, &desc, sizeof(desc)))
+		return -EFAULT;
+
+	return 0;
+}
+
+/**
+ * iio_buffer_ioctl() - block queue ioctls of the buffer chrdev
+ * @indio_dev:	The IIO device
+ * @filp:	File structure pointer for the char device
+ * @cmd:	One of the IIO_BUFFER_BLOCK_*_IOCTL
+ * @arg:	User pointer to the ioctl argument
+ *
+ * Return: -ENOIOCTLCMD for other ioctls.
+ */
+long iio_buffer_ioctl(struct iio_dev *indio_dev, struct file *filp,
+		      unsigned int cmd, unsigned long arg)
+{
+	struct iio_buffer *buf = indio_dev->buffer;
+	void __user *uarg = (void __user *)arg;
+	long ret = 0;
+
+	switch (cmd) {
+	case IIO_BUFFER_BLOCK_ALLOC_IOCTL:
+	case IIO_BUFFER_BLOCK_FREE_IOCTL:
+	case IIO_BUFFER_BLOCK_QUERY_IOCTL:
+	case IIO_BUFFER_BLOCK_ENQUEUE_IOCTL:
+	case IIO_BUFFER_BLOCK_DEQUEUE_IOCTL:
+		break;
+	default:
+		return -ENOIOCTLCMD;
+	}
+
+	if (!buf)
+		return -ENODEV;
+
+	mutex_lock(&indio_dev->mlock);
+
+	if (cmd == IIO_BUFFER_BLOCK_ALLOC_IOCTL) {
+		ret = iio_buffer_block_alloc(indio_dev, buf, uarg);
+		goto out;
+	}
+
+	if (!buf->block_queue) {
+		ret = -EINVAL;
+		goto out;
+	}
+
+	switch (cmd) {
+	case IIO_BUFFER_BLOCK_FREE_IOCTL:
+		if (iio_buffer_is_active(buf)) {
+			ret = -EBUSY;
+			break;
+		}
+		iio_block_queue_release(buf);
+		break;
+	case IIO_BUFFER_BLOCK_QUERY_IOCTL:
+		ret = iio_buffer_block_query(buf, uarg);
+		break;
+	case IIO_BUFFER_BLOCK_ENQUEUE_IOCTL:
+		ret = iio_buffer_block_enqueue(buf, uarg);
+		break;
+	case IIO_BUFFER_BLOCK_DEQUEUE_IOCTL:
+		ret = iio_buffer_block_dequeue(buf, uarg);
+		/* Wait without the lock, poll() does the same */
+		while (ret == -EAGAIN && !(filp->f_flags & O_NONBLOCK)) {
+			mutex_unlock(&indio_dev->mlock);
+			ret = wait_event_interruptible(buf->pollq,
+					!indio_dev->info ||
+					!buf->block_queue ||
+					iio_block_queue_ready(buf));
+			mutex_lock(&indio_dev->mlock);
+			if (ret)
+				break;
+			if (!indio_dev->info || !buf->block_queue) {
+				ret = -ENODEV;
+				break;
+			}
+			ret = iio_buffer_block_dequeue(buf, uarg);
+		}
+		break;
+	}
+
+out:
+	mutex_unlock(&indio_dev->mlock);
+
+	return ret;
+}
+
+/**
+ * iio_buffer_mmap() - map the blocks of the block queue
+ * @filp:	File structure pointer for the char device
+ * @vma:	The area, at the offset of the first block to map
+ *
+ * The blocks are laid out one after the other, at the offset given by
+ * IIO_BUFFER_BLOCK_QUERY_IOCTL. The pages stay valid until unmapped even
+ * if the blocks are freed.
+ */
+int iio_buffer_mmap(struct file *filp, struct vm_area_struct *vma)
+{
+	struct iio_dev *indio_dev = filp->private_data;
+	struct iio_buffer *buf = indio_dev->buffer;
+	int ret;
+
+	if (!indio_dev->info)
+		return -ENODEV;
+
+	if (!buf || !(vma->vm_flags & VM_SHARED))
+		return -EINVAL;
+
+	mutex_lock(&indio_dev->mlock);
+	if (buf->block_queue)
+		ret = remap_vmalloc_range(vma, buf->block_queue->mem,
+					  vma->vm_pgoff);
+	else
+		ret = -EINVAL;
+	mutex_unlock(&indio_dev->mlock);
+
+	return ret;
+}
+
 /**
  * iio_buffer_read_first_n_outer() - chrdev read for buffer access
  * @filp:	File structure pointer for the char device
@@ -119,6 +524,10 @@ ssize_t iio_buffer_read_first_n_outer(struct file *filp, char __user *buf,
 	if (!rb || !rb->access->read_first_n)
 		return -EINVAL;
 
+	/* Samples go to the blocks user space has mapped */
+	if (rb->block_queue)
+		return -EBUSY;
+
 	datum_size = rb->bytes_per_datum;
 
 	/*
@@ -179,6 +588,11 @@ __poll_t iio_buffer_poll(struct file *filp,
 		return 0;
 
 	poll_wait(filp, &rb->pollq, wait);
+	if (READ_ONCE(rb->block_queue)) {
+		if (iio_block_queue_ready(rb))
+			return EPOLLIN | EPOLLRDNORM;
+		return 0;
+	}
 	if (iio_buffer_ready(indio_dev, rb, rb->watermark, 0))
 		return EPOLLIN | EPOLLRDNORM;
 	return 0;
@@ -204,6 +618,7 @@ void iio_buffer_init(struct iio_buffer *buffer)
 	INIT_LIST_HEAD(&buffer->demux_list);
 	INIT_LIST_HEAD(&buffer->buffer_list);
 	init_waitqueue_head(&buffer->pollq);
+	spin_lock_init(&buffer->block_lock);
 	kref_init(&buffer->ref);
 	if (!buffer->watermark)
 		buffer->watermark = 1;
@@ -623,6 +1038,8 @@ static int iio_buffer_enable(struct iio_buffer *buffer,
 static int iio_buffer_disable(struct iio_buffer *buffer,
 	struct iio_dev *indio_dev)
 {
+	iio_block_queue_flush(indio_dev, buffer);
+
 	if (!buffer->access->disable)
 		return 0;
 	return buffer->access->disable(buffer, indio_dev);
@@ -645,9 +1062,18 @@ static void iio_buffer_update_bytes_per_datum(struct iio_dev *indio_dev,
 static int iio_buffer_request_update(struct iio_dev *indio_dev,
 	struct iio_buffer *buffer)
 {
+	struct iio_block_queue *queue = buffer->block_queue;
 	int ret;
 
 	iio_buffer_update_bytes_per_datum(indio_dev, buffer);
+
+	/* the scan may have grown since the blocks were allocated */
+	if (queue && buffer->bytes_per_datum > queue->blocks[0].block.size) {
+		dev_dbg(&indio_dev->dev,
+			"Buffer not started: scan larger than a block\n");
+		return -EINVAL;
+	}
+
 	if (buffer->access->request_update) {
 		ret = buffer->access->request_update(buffer);
 		if (ret) {
@@ -1383,11 +1809,16 @@ static const void *iio_demux(struct iio_buffer *buffer,
 	return buffer->demux_bounce;
 }
 
-static int iio_push_to_buffer(struct iio_buffer *buffer, const void *data)
+static int iio_push_to_buffer(struct iio_dev *indio_dev,
+			      struct iio_buffer *buffer, const void *data)
 {
 	const void *dataout = iio_demux(buffer, data);
 	int ret;
 
+	/* The block queue wakes up readers once a block completes */
+	if (buffer->block_queue)
+		return iio_block_queue_store(indio_dev, buffer, dataout);
+
 	ret = buffer->access->store_to(buffer, dataout);
 	if (ret)
 		return ret;
@@ -1411,7 +1842,7 @@ int iio_push_to_buffers(struct iio_dev *indio_dev, const void *data)
 	struct iio_buffer *buf;
 
 	list_for_each_entry(buf, &indio_dev->buffer_list, buffer_list) {
-		ret = iio_push_to_buffer(buf, data);
+		ret = iio_push_to_buffer(indio_dev, buf, data);
 		if (ret < 0)
 			return ret;
 	}
@@ -1433,6 +1864,7 @@ static void iio_buffer_release(struct kref *ref)
 {
 	struct iio_buffer *buffer = container_of(ref, struct iio_buffer, ref);
 
+	iio_block_queue_free(buffer->block_queue);
 	buffer->access->release(buffer);
 }
 
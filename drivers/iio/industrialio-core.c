@@ -1606,6 +1606,7 @@ static long iio_ioctl(struct file *filp, unsigned int cmd, unsigned long arg)
 {
 	struct iio_dev *indio_dev = filp->private_data;
 	int __user *ip = (int __user *)arg;
+	long ret;
 	int fd;
 
 	if (!indio_dev->info)
@@ -1619,6 +1620,11 @@ static long iio_ioctl(struct file *filp, unsigned int cmd, unsigned long arg)
 			return -EFAULT;
 		return 0;
 	}
+
+	ret = iio_buffer_ioctl(indio_dev, filp, cmd, arg);
+	if (ret != -ENOIOCTLCMD)
+		return ret;
+
 	return -EINVAL;
 }
 
@@ -1627,6 +1633,7 @@ static const struct file_operations iio_buffer_fileops = {
 	.release = iio_chrdev_release,
 	.open = iio_chrdev_open,
 	.poll = iio_buffer_poll_addr,
+	.mmap = iio_buffer_mmap_addr,
 	.owner = THIS_MODULE,
 	.llseek = noop_llseek,
 	.unlocked_ioctl = iio_ioctl,
@@ -15,6 +15,7 @@
 #define EVDEV_MIN_BUFFER_SIZE	64U
 #define EVDEV_BUF_PACKETS	8
 
+#include <linux/hrtimer.h>
 #include <linux/poll.h>
 #include <linux/sched.h>
 #include <linux/slab.h>
@@ -28,17 +29,9 @@
 #include <linux/cdev.h>
 #include "input-compat.h"
 
-enum evdev_clock_type {
-	EV_CLK_REAL = 0,
-	EV_CLK_MONO,
-	EV_CLK_BOOT,
-	EV_CLK_MAX
-};
-
 struct evdev {
 	int open;
 	struct input_handle handle;
-	wait_queue_head_t wait;
 	struct evdev_client __rcu *grab;
 	struct list_head client_list;
 	spinlock_t client_lock; /* protects client_list */
@@ -53,10 +46,17 @@ struct evdev_client {
 	unsigned int tail;
 	unsigned int packet_head; /* [future] position of the first element of next packet */
 	spinlock_t buffer_lock; /* protects access to buffer, head and tail */
+	wait_queue_head_t wait;
 	struct fasync_struct *fasync;
 	struct evdev *evdev;
 	struct list_head node;
 	unsigned int clk_type;
+	/*
+	 * Readers are woken up once per batch_window instead of on each
+	 * SYN_REPORT, unless it is zero or the buffer gets half full.
+	 */
+	ktime_t batch_window;
+	struct hrtimer batch_timer;
 	bool revoked;
 	unsigned long *evmasks[EV_CNT];
 	unsigned int bufsize;
@@ -156,9 +156,9 @@ static void __evdev_queue_syn_dropped(struct evdev_client *client)
 	ktime_t time;
 	struct timespec64 ts;
 
-	time = client->clk_type == EV_CLK_REAL ?
+	time = client->clk_type == INPUT_CLK_REAL ?
 			ktime_get_real() :
-			client->clk_type == EV_CLK_MONO ?
+			client->clk_type == INPUT_CLK_MONO ?
 				ktime_get() :
 				ktime_get_boottime();
 
@@ -196,13 +196,13 @@ static int evdev_set_clk_type(struct evdev_client *client, unsigned int clkid)
 	switch (clkid) {
 
 	case CLOCK_REALTIME:
-		clk_type = EV_CLK_REAL;
+		clk_type = INPUT_CLK_REAL;
 		break;
 	case CLOCK_MONOTONIC:
-		clk_type = EV_CLK_MONO;
+		clk_type = INPUT_CLK_MONO;
 		break;
 	case CLOCK_BOOTTIME:
-		clk_type = EV_CLK_BOOT;
+		clk_type = INPUT_CLK_BOOT;
 		break;
 	default:
 		return -EINVAL;
@@ -252,20 +252,34 @@ static void __pass_event(struct evdev_client *client,
 		client->packet_head = client->tail;
 	}
 
-	if (event->type == EV_SYN && event->code == SYN_REPORT) {
+	if (event->type == EV_SYN && event->code == SYN_REPORT)
 		client->packet_head = client->head;
-		kill_fasync(&client->fasync, SIGIO, POLL_IN);
-	}
+}
+
+static void evdev_wakeup_client(struct evdev_client *client)
+{
+	kill_fasync(&client->fasync, SIGIO, POLL_IN);
+	wake_up_interruptible(&client->wait);
+}
+
+static enum hrtimer_restart evdev_batch_timer_fn(struct hrtimer *timer)
+{
+	struct evdev_client *client =
+		container_of(timer, struct evdev_client, batch_timer);
+
+	evdev_wakeup_client(client);
+
+	return HRTIMER_NORESTART;
 }
 
 static void evdev_pass_values(struct evdev_client *client,
 			const struct input_value *vals, unsigned int count,
 			ktime_t *ev_time)
 {
-	struct evdev *evdev = client->evdev;
 	const struct input_value *v;
 	struct input_event event;
 	struct timespec64 ts;
+	ktime_t batch_window;
 	bool wakeup = false;
 
 	if (client->revoked)
@@ -296,10 +310,20 @@ static void evdev_pass_values(struct evdev_client *client,
 		__pass_event(client, &event);
 	}
 
+	batch_window = READ_ONCE(client->batch_window);
+	if (wakeup && batch_window &&
+	    ((client->head - client->tail) & (client->bufsize - 1)) <
+	    client->bufsize / 2) {
+		wakeup = false;
+		if (!hrtimer_is_queued(&client->batch_timer))
+			hrtimer_start(&client->batch_timer, batch_window,
+				      HRTIMER_MODE_REL);
+	}
+
 	spin_unlock(&client->buffer_lock);
 
 	if (wakeup)
-		wake_up_interruptible(&evdev->wait);
+		evdev_wakeup_client(client);
 }
 
 /*
@@ -310,12 +334,7 @@ static void evdev_events(struct input_handle *handle,
 {
 	struct evdev *evdev = handle->private;
 	struct evdev_client *client;
-	ktime_t ev_time[EV_CLK_MAX];
-
-	ev_time[EV_CLK_MONO] = ktime_get();
-	ev_time[EV_CLK_REAL] = ktime_mono_to_real(ev_time[EV_CLK_MONO]);
-	ev_time[EV_CLK_BOOT] = ktime_mono_to_any(ev_time[EV_CLK_MONO],
-						 TK_OFFS_BOOT);
+	ktime_t *ev_time = input_get_timestamp(handle->dev);
 
 	rcu_read_lock();
 
@@ -461,11 +480,11 @@ static void evdev_hangup(struct evdev *evdev)
 	struct evdev_client *client;
 
 	spin_lock(&evdev->client_lock);
-	list_for_each_entry(client, &evdev->client_list, node)
+	list_for_each_entry(client, &evdev->client_list, node) {
 		kill_fasync(&client->fasync, SIGIO, POLL_HUP);
+		wake_up_interruptible(&client->wait);
+	}
 	spin_unlock(&evdev->client_lock);
-
-	wake_up_interruptible(&evdev->wait);
 }
 
 static int evdev_release(struct inode *inode, struct file *file)
@@ -479,6 +498,7 @@ static int evdev_release(struct inode *inode, struct file *file)
 	mutex_unlock(&evdev->mutex);
 
 	evdev_detach_client(evdev, client);
+	hrtimer_cancel(&client->batch_timer);
 
 	for (i = 0; i < EV_CNT; ++i)
 		bitmap_free(client->evmasks[i]);
@@ -516,6 +536,9 @@ static int evdev_open(struct inode *inode, struct file *file)
 
 	client->bufsize = bufsize;
 	spin_lock_init(&client->buffer_lock);
+	init_waitqueue_head(&client->wait);
+	hrtimer_init(&client->batch_timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+	client->batch_timer.function = evdev_batch_timer_fn;
 	client->evdev = evdev;
 	evdev_attach_client(evdev, client);
 
@@ -629,7 +652,7 @@ static ssize_t evdev_read(struct file *file, char __user *buffer,
 			break;
 
 		if (!(file->f_flags & O_NONBLOCK)) {
-			error = wait_event_interruptible(evdev->wait,
+			error = wait_event_interruptible(client->wait,
 					client->packet_head != client->tail ||
 					!evdev->exist || client->revoked);
 			if (error)
@@ -647,7 +670,7 @@ static __poll_t evdev_poll(struct file *file, poll_table *wait)
 	struct evdev *evdev = client->evdev;
 	__poll_t mask;
 
-	poll_wait(file, &evdev->wait, wait);
+	poll_wait(file, &client->wait, wait);
 
 	if (evdev->exist && !client->revoked)
 		mask = EPOLLOUT | EPOLLWRNORM;
@@ -980,7 +1003,7 @@ static int evdev_revoke(struct evdev *evdev, struct evdev_client *client,
 	client->revoked = true;
 	evdev_ungrab(evdev, client);
 	input_flush_device(&evdev->handle, file);
-	wake_up_interruptible(&evdev->wait);
+	wake_up_interruptible(&client->wait);
 
 	return 0;
 }
@@ -1159,6 +1182,17 @@ static long evdev_do_ioctl(struct file *file, unsigned int cmd,
 
 		return evdev_set_clk_type(client, i);
 
+	case EVIOCSBATCH:
+		if (copy_from_user(&i, p, sizeof(unsigned int)))
+			return -EFAULT;
+
+		if (i > USEC_PER_SEC)
+			return -EINVAL;
+
+		WRITE_ONCE(client->batch_window,
+			   ns_to_ktime((u64)i * NSEC_PER_USEC));
+		return 0;
+
 	case EVIOCGKEYCODE:
 		return evdev_handle_get_keycode(dev, p);
 
@@ -1393,7 +1427,6 @@ static int evdev_connect(struct input_handler *handler, struct input_dev *dev,
 	INIT_LIST_HEAD(&evdev->client_list);
 	spin_lock_init(&evdev->client_lock);
 	mutex_init(&evdev->mutex);
-	init_waitqueue_head(&evdev->wait);
 	evdev->exist = true;
 
 	dev_no = minor;
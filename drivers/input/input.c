@@ -194,6 +194,8 @@ static void input_repeat_key(struct timer_list *t)
 		};
 
 		input_pass_values(dev, vals, ARRAY_SIZE(vals));
+		/* Don't leave evdev's stamp behind for the next real frame */
+		dev->timestamp[INPUT_CLK_MONO] = ktime_set(0, 0);
 
 		if (dev->rep[REP_PERIOD])
 			mod_timer(&dev->timer, jiffies +
@@ -400,6 +402,13 @@ static void input_handle_event(struct input_dev *dev,
 		if (dev->num_vals >= 2)
 			input_pass_values(dev, dev->vals, dev->num_vals);
 		dev->num_vals = 0;
+		/*
+		 * Reset the timestamp on flush so we won't end up
+		 * with a stale one. Note we only need to reset the
+		 * monotonic one as we use its presence when deciding
+		 * whether to generate a synthetic timestamp.
+		 */
+		dev->timestamp[INPUT_CLK_MONO] = ktime_set(0, 0);
 	} else if (dev->num_vals >= dev->max_vals - 2) {
 		dev->vals[dev->num_vals++] = input_value_sync;
 		input_pass_values(dev, dev->vals, dev->num_vals);
@@ -439,6 +448,72 @@ void input_event(struct input_dev *dev,
 }
 EXPORT_SYMBOL(input_event);
 
+/**
+ * input_event_batch() - report several input events at once
+ * @dev: device that generated the events
+ * @vals: events to report, in order
+ * @count: number of events in @vals
+ *
+ * Same as calling input_event() for each of @vals, but takes the device
+ * event lock only once. Drivers that decode a whole multi-touch contact
+ * from one device read can report its axes with a single call rather
+ * than one input_event() per axis.
+ */
+void input_event_batch(struct input_dev *dev, const struct input_value *vals,
+		       unsigned int count)
+{
+	unsigned long flags;
+	unsigned int i;
+
+	spin_lock_irqsave(&dev->event_lock, flags);
+	for (i = 0; i < count; i++)
+		if (is_event_supported(vals[i].type, dev->evbit, EV_MAX))
+			input_handle_event(dev, vals[i].type, vals[i].code,
+					   vals[i].value);
+	spin_unlock_irqrestore(&dev->event_lock, flags);
+}
+EXPORT_SYMBOL(input_event_batch);
+
+/**
+ * input_set_timestamp - set timestamp for input events
+ * @dev: input device to set timestamp for
+ * @timestamp: the time at which the event has occurred
+ *   in CLOCK_MONOTONIC
+ *
+ * This function is intended to provide to the input system a more
+ * accurate time of when an event actually occurred. The driver should
+ * call this function as soon as a timestamp is acquired ensuring
+ * clock conversions in input_set_timestamp are done correctly.
+ *
+ * The system entering suspend state between timestamp acquisition and
+ * calling input_set_timestamp can result in inaccurate conversions.
+ */
+void input_set_timestamp(struct input_dev *dev, ktime_t timestamp)
+{
+	dev->timestamp[INPUT_CLK_MONO] = timestamp;
+	dev->timestamp[INPUT_CLK_REAL] = ktime_mono_to_real(timestamp);
+	dev->timestamp[INPUT_CLK_BOOT] = ktime_mono_to_any(timestamp,
+							   TK_OFFS_BOOT);
+}
+EXPORT_SYMBOL(input_set_timestamp);
+
+/**
+ * input_get_timestamp - get timestamp for input events
+ * @dev: input device to get timestamp from
+ *
+ * A valid timestamp is a timestamp of non-zero value.
+ */
+ktime_t *input_get_timestamp(struct input_dev *dev)
+{
+	const ktime_t invalid_timestamp = ktime_set(0, 0);
+
+	if (!ktime_compare(dev->timestamp[INPUT_CLK_MONO], invalid_timestamp))
+		input_set_timestamp(dev, ktime_get());
+
+	return dev->timestamp;
+}
+EXPORT_SYMBOL(input_get_timestamp);
+
 /**
  * input_inject_event() - send input event from input handler
  * @handle: input handle to send event through
@@ -690,8 +765,10 @@ static void input_dev_release_keys(struct input_dev *dev)
 			need_sync = true;
 		}
 
-		if (need_sync)
+		if (need_sync) {
 			input_pass_event(dev, EV_SYN, SYN_REPORT, 1);
+			dev->timestamp[INPUT_CLK_MONO] = ktime_set(0, 0);
+		}
 
 		memset(dev->key, 0, sizeof(dev->key));
 	}
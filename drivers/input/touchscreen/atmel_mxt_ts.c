@@ -299,6 +299,7 @@ struct mxt_data {
 	struct mxt_info *info;
 	void *raw_info_block;
 	unsigned int irq;
+	ktime_t irq_time;	/* when the current interrupt was raised */
 	unsigned int max_x;
 	unsigned int max_y;
 	bool invertx;
@@ -832,6 +833,15 @@ static void mxt_proc_t9_message(struct mxt_data *data, u8 *message)
 	input_mt_slot(input_dev, id);
 
 	if (status & MXT_T9_DETECT) {
+		/* if active, pressure must be non-zero */
+		struct input_value vals[] = {
+			{ EV_ABS, ABS_MT_POSITION_X, x },
+			{ EV_ABS, ABS_MT_POSITION_Y, y },
+			{ EV_ABS, ABS_MT_PRESSURE,
+			  amplitude ?: MXT_PRESSURE_DEFAULT },
+			{ EV_ABS, ABS_MT_TOUCH_MAJOR, area },
+		};
+
 		/*
 		 * Multiple bits may be set if the host is slow to read
 		 * the status messages, indicating all the events that
@@ -843,16 +853,9 @@ static void mxt_proc_t9_message(struct mxt_data *data, u8 *message)
 			mxt_input_sync(data);
 		}
 
-		/* if active, pressure must be non-zero */
-		if (!amplitude)
-			amplitude = MXT_PRESSURE_DEFAULT;
-
 		/* Touch active */
 		input_mt_report_slot_state(input_dev, MT_TOOL_FINGER, 1);
-		input_report_abs(input_dev, ABS_MT_POSITION_X, x);
-		input_report_abs(input_dev, ABS_MT_POSITION_Y, y);
-		input_report_abs(input_dev, ABS_MT_PRESSURE, amplitude);
-		input_report_abs(input_dev, ABS_MT_TOUCH_MAJOR, area);
+		input_event_batch(input_dev, vals, ARRAY_SIZE(vals));
 	} else {
 		/* Touch no longer active, close out slot */
 		input_mt_report_slot_state(input_dev, MT_TOOL_FINGER, 0);
@@ -949,16 +952,20 @@ static void mxt_proc_t100_message(struct mxt_data *data, u8 *message)
 	input_mt_slot(input_dev, id);
 
 	if (status & MXT_T100_DETECT) {
+		struct input_value vals[] = {
+			{ EV_ABS, ABS_MT_POSITION_X, x },
+			{ EV_ABS, ABS_MT_POSITION_Y, y },
+			{ EV_ABS, ABS_MT_TOUCH_MAJOR, major },
+			{ EV_ABS, ABS_MT_PRESSURE, pressure },
+			{ EV_ABS, ABS_MT_DISTANCE, distance },
+			{ EV_ABS, ABS_MT_ORIENTATION, orientation },
+		};
+
 		dev_dbg(dev, "[%u] type:%u x:%u y:%u a:%02X p:%02X v:%02X\n",
 			id, type, x, y, major, pressure, orientation);
 
 		input_mt_report_slot_state(input_dev, tool, 1);
-		input_report_abs(input_dev, ABS_MT_POSITION_X, x);
-		input_report_abs(input_dev, ABS_MT_POSITION_Y, y);
-		input_report_abs(input_dev, ABS_MT_TOUCH_MAJOR, major);
-		input_report_abs(input_dev, ABS_MT_PRESSURE, pressure);
-		input_report_abs(input_dev, ABS_MT_DISTANCE, distance);
-		input_report_abs(input_dev, ABS_MT_ORIENTATION, orientation);
+		input_event_batch(input_dev, vals, ARRAY_SIZE(vals));
 	} else {
 		dev_dbg(dev, "[%u] release\n", id);
 
@@ -1149,6 +1156,19 @@ static irqreturn_t mxt_process_messages(struct mxt_data *data)
 	return IRQ_HANDLED;
 }
 
+/*
+ * Reading the messages takes several I2C transfers, record when the touch
+ * actually happened before they start.
+ */
+static irqreturn_t mxt_hardirq(int irq, void *dev_id)
+{
+	struct mxt_data *data = dev_id;
+
+	data->irq_time = ktime_get();
+
+	return IRQ_WAKE_THREAD;
+}
+
 static irqreturn_t mxt_interrupt(int irq, void *dev_id)
 {
 	struct mxt_data *data = dev_id;
@@ -1162,6 +1182,9 @@ static irqreturn_t mxt_interrupt(int irq, void *dev_id)
 	if (!data->object_table)
 		return IRQ_HANDLED;
 
+	if (data->input_dev)
+		input_set_timestamp(data->input_dev, data->irq_time);
+
 	if (data->T44_address) {
 		return mxt_process_messages_t44(data);
 	} else {
@@ -3100,7 +3123,8 @@ static int mxt_probe(struct i2c_client *client, const struct i2c_device_id *id)
 	}
 
 	error = devm_request_threaded_irq(&client->dev, client->irq,
-					  NULL, mxt_interrupt, IRQF_ONESHOT,
+					  mxt_hardirq, mxt_interrupt,
+					  IRQF_ONESHOT,
 					  client->name, data);
 	if (error) {
 		dev_err(&client->dev, "Failed to register interrupt\n");
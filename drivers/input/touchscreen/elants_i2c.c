@@ -148,6 +148,7 @@ struct elants_data {
 	struct completion cmd_done;
 
 	u8 buf[MAX_PACKET_SIZE];
+	ktime_t irq_time;	/* when the current interrupt was raised */
 
 	bool wake_irq_enabled;
 	bool keep_power_in_suspend;
@@ -795,8 +796,17 @@ static void elants_i2c_mt_event(struct elants_data *ts, u8 *buf)
 	dev_dbg(&ts->client->dev,
 		"n_fingers: %u, state: %04x\n",  n_fingers, finger_state);
 
+	/* Reports queued by the controller all get the interrupt time */
+	input_set_timestamp(input, ts->irq_time);
+
 	for (i = 0; i < MAX_CONTACT_NUM && n_fingers; i++) {
 		if (finger_state & 1) {
+			struct input_value vals[] = {
+				{ EV_ABS, ABS_MT_POSITION_X },
+				{ EV_ABS, ABS_MT_POSITION_Y },
+				{ EV_ABS, ABS_MT_PRESSURE },
+				{ EV_ABS, ABS_MT_TOUCH_MAJOR },
+			};
 			unsigned int x, y, p, w;
 			u8 *pos;
 
@@ -811,10 +821,11 @@ static void elants_i2c_mt_event(struct elants_data *ts, u8 *buf)
 
 			input_mt_slot(input, i);
 			input_mt_report_slot_state(input, MT_TOOL_FINGER, true);
-			input_event(input, EV_ABS, ABS_MT_POSITION_X, x);
-			input_event(input, EV_ABS, ABS_MT_POSITION_Y, y);
-			input_event(input, EV_ABS, ABS_MT_PRESSURE, p);
-			input_event(input, EV_ABS, ABS_MT_TOUCH_MAJOR, w);
+			vals[0].value = x;
+			vals[1].value = y;
+			vals[2].value = p;
+			vals[3].value = w;
+			input_event_batch(input, vals, ARRAY_SIZE(vals));
 
 			n_fingers--;
 		}
@@ -854,6 +865,15 @@ static void elants_i2c_event(struct elants_data *ts, u8 *buf)
 		elants_i2c_mt_event(ts, buf);
 }
 
+static irqreturn_t elants_i2c_hardirq(int irq, void *_dev)
+{
+	struct elants_data *ts = _dev;
+
+	ts->irq_time = ktime_get();
+
+	return IRQ_WAKE_THREAD;
+}
+
 static irqreturn_t elants_i2c_irq(int irq, void *_dev)
 {
 	const u8 wait_packet[] = { 0x64, 0x64, 0x64, 0x64 };
@@ -1270,7 +1290,7 @@ static int elants_i2c_probe(struct i2c_client *client,
 		irqflags = IRQF_TRIGGER_FALLING;
 
 	error = devm_request_threaded_irq(&client->dev, client->irq,
-					  NULL, elants_i2c_irq,
+					  elants_i2c_hardirq, elants_i2c_irq,
 					  irqflags | IRQF_ONESHOT,
 					  client->name, ts);
 	if (error) {
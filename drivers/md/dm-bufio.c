@@ -80,6 +80,10 @@
  */
 struct dm_bufio_client {
 	struct mutex lock;
+	/* used instead of lock by clients set with dm_bufio_set_no_sleep() */
+	spinlock_t spinlock;
+	unsigned long spinlock_flags;
+	bool no_sleep;
 
 	struct list_head lru[LIST_SIZE];
 	unsigned long n_buffers[LIST_SIZE];
@@ -161,17 +165,37 @@ struct dm_buffer {
 
 static void dm_bufio_lock(struct dm_bufio_client *c)
 {
-	mutex_lock_nested(&c->lock, dm_bufio_in_request());
+	if (c->no_sleep)
+		spin_lock_irqsave_nested(&c->spinlock, c->spinlock_flags,
+					 dm_bufio_in_request());
+	else
+		mutex_lock_nested(&c->lock, dm_bufio_in_request());
 }
 
 static int dm_bufio_trylock(struct dm_bufio_client *c)
 {
+	if (c->no_sleep)
+		return spin_trylock_irqsave(&c->spinlock, c->spinlock_flags);
+
 	return mutex_trylock(&c->lock);
 }
 
 static void dm_bufio_unlock(struct dm_bufio_client *c)
 {
-	mutex_unlock(&c->lock);
+	if (c->no_sleep)
+		spin_unlock_irqrestore(&c->spinlock, c->spinlock_flags);
+	else
+		mutex_unlock(&c->lock);
+}
+
+/*
+ * Yield the CPU in long loops running with the client lock held, unless
+ * that lock is a spinlock.
+ */
+static void dm_bufio_cond_resched(struct dm_bufio_client *c)
+{
+	if (!c->no_sleep)
+		cond_resched();
 }
 
 /*----------------------------------------------------------------*/
@@ -747,23 +771,30 @@ static struct dm_buffer *__get_unclaimed_buffer(struct dm_bufio_client *c)
 		BUG_ON(test_bit(B_WRITING, &b->state));
 		BUG_ON(test_bit(B_DIRTY, &b->state));
 
+		/* can't wait for a prefetch to finish without sleeping */
+		if (c->no_sleep && b->state)
+			continue;
+
 		if (!b->hold_count) {
 			__make_buffer_clean(b);
 			__unlink_buffer(b);
 			return b;
 		}
-		cond_resched();
+		dm_bufio_cond_resched(c);
 	}
 
 	list_for_each_entry_reverse(b, &c->lru[LIST_DIRTY], lru_list) {
 		BUG_ON(test_bit(B_READING, &b->state));
 
+		if (c->no_sleep && b->state)
+			continue;
+
 		if (!b->hold_count) {
 			__make_buffer_clean(b);
 			__unlink_buffer(b);
 			return b;
 		}
-		cond_resched();
+		dm_bufio_cond_resched(c);
 	}
 
 	return NULL;
@@ -906,7 +937,7 @@ static void __write_dirty_buffers_async(struct dm_bufio_client *c, int no_wait,
 			return;
 
 		__write_dirty_buffer(b, write_list);
-		cond_resched();
+		dm_bufio_cond_resched(c);
 	}
 }
 
@@ -961,7 +992,7 @@ static void __check_watermark(struct dm_bufio_client *c,
 			return;
 
 		__free_buffer_wake(b);
-		cond_resched();
+		dm_bufio_cond_resched(c);
 	}
 
 	if (c->n_buffers[LIST_DIRTY] > threshold_buffers)
@@ -1295,7 +1326,7 @@ int dm_bufio_write_dirty_buffers(struct dm_bufio_client *c)
 		    !test_bit(B_WRITING, &b->state))
 			__relink_lru(b, LIST_CLEAN);
 
-		cond_resched();
+		dm_bufio_cond_resched(c);
 
 		/*
 		 * If we dropped the lock, the list is no longer consistent,
@@ -1454,6 +1485,17 @@ void dm_bufio_set_minimum_buffers(struct dm_bufio_client *c, unsigned n)
 }
 EXPORT_SYMBOL_GPL(dm_bufio_set_minimum_buffers);
 
+int dm_bufio_set_no_sleep(struct dm_bufio_client *c)
+{
+	/* larger buffers may need vmalloc, which can't be done atomically */
+	if (c->block_size > PAGE_SIZE)
+		return -EINVAL;
+
+	c->no_sleep = true;
+	return 0;
+}
+EXPORT_SYMBOL_GPL(dm_bufio_set_no_sleep);
+
 unsigned dm_bufio_get_block_size(struct dm_bufio_client *c)
 {
 	return c->block_size;
@@ -1546,7 +1588,7 @@ static void drop_buffers(struct dm_bufio_client *c)
  */
 static bool __try_evict_buffer(struct dm_buffer *b, gfp_t gfp)
 {
-	if (!(gfp & __GFP_FS)) {
+	if (!(gfp & __GFP_FS) || b->c->no_sleep) {
 		if (test_bit(B_READING, &b->state) ||
 		    test_bit(B_WRITING, &b->state) ||
 		    test_bit(B_DIRTY, &b->state))
@@ -1589,7 +1631,7 @@ static unsigned long __scan(struct dm_bufio_client *c, unsigned long nr_to_scan,
 				freed++;
 			if (!--nr_to_scan || ((count - freed) <= retain_target))
 				return freed;
-			cond_resched();
+			dm_bufio_cond_resched(c);
 		}
 	}
 	return freed;
@@ -1665,6 +1707,7 @@ struct dm_bufio_client *dm_bufio_client_create(struct block_device *bdev, unsign
 	}
 
 	mutex_init(&c->lock);
+	spin_lock_init(&c->spinlock);
 	INIT_LIST_HEAD(&c->reserved_buffers);
 	c->need_reserved_buffers = reserved_buffers;
 
@@ -1838,7 +1881,7 @@ static void __evict_old_buffers(struct dm_bufio_client *c, unsigned long age_hz)
 		if (__try_evict_buffer(b, 0))
 			count--;
 
-		cond_resched();
+		dm_bufio_cond_resched(c);
 	}
 
 	dm_bufio_unlock(c);
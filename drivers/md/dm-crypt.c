@@ -25,6 +25,7 @@
 #include <linux/scatterlist.h>
 #include <linux/rbtree.h>
 #include <linux/ctype.h>
+#include <linux/percpu.h>
 #include <asm/page.h>
 #include <asm/unaligned.h>
 #include <crypto/hash.h>
@@ -73,6 +74,7 @@ struct dm_crypt_io {
 	atomic_t io_pending;
 	blk_status_t error;
 	sector_t sector;
+	bool inline_crypt;
 
 	struct rb_node rb_node;
 } CRYPTO_MINALIGN_ATTR;
@@ -125,13 +127,24 @@ struct iv_tcw_private {
  * and encrypts / decrypts at the same time.
  */
 enum flags { DM_CRYPT_SUSPENDED, DM_CRYPT_KEY_VALID,
-	     DM_CRYPT_SAME_CPU, DM_CRYPT_NO_OFFLOAD };
+	     DM_CRYPT_SAME_CPU, DM_CRYPT_NO_OFFLOAD, DM_CRYPT_INLINE };
 
 enum cipher_flags {
 	CRYPT_MODE_INTEGRITY_AEAD,	/* Use authenticated mode for cihper */
 	CRYPT_IV_LARGE_SECTORS,		/* Calculate IV from sector_size, not 512B sectors */
 };
 
+/*
+ * Number of bios encrypted or decrypted without (inline) and with (queued)
+ * going through the kcryptd workqueue.
+ */
+struct crypt_path_stats {
+	unsigned long inline_reads;
+	unsigned long inline_writes;
+	unsigned long queued_reads;
+	unsigned long queued_writes;
+};
+
 /*
  * The fields in here must be read only after initialization.
  */
@@ -192,6 +205,8 @@ struct crypt_config {
 	unsigned int per_bio_data_size;
 
 	unsigned long flags;
+	unsigned int inline_max_sectors; /* largest bio crypted inline */
+	struct crypt_path_stats __percpu *path_stats;
 	unsigned int key_size;
 	unsigned int key_parts;      /* independent parts in key buffer */
 	unsigned int key_extra_size; /* additional keys length */
@@ -1354,7 +1369,9 @@ static blk_status_t crypt_convert(struct crypt_config *cc,
 			atomic_dec(&ctx->cc_pending);
 			ctx->cc_sector += sector_step;
 			tag_offset++;
-			cond_resched();
+			/* inline reads are decrypted from the bio completion */
+			if (likely(!in_interrupt()))
+				cond_resched();
 			continue;
 		/*
 		 * There was a data integrity error.
@@ -1464,6 +1481,7 @@ static void crypt_io_init(struct dm_crypt_io *io, struct crypt_config *cc,
 	io->ctx.r.req = NULL;
 	io->integrity_metadata = NULL;
 	io->integrity_metadata_from_pool = false;
+	io->inline_crypt = false;
 	atomic_set(&io->io_pending, 0);
 }
 
@@ -1680,7 +1698,8 @@ static void kcryptd_crypt_write_io_submit(struct dm_crypt_io *io, int async)
 
 	clone->bi_iter.bi_sector = cc->start + io->sector;
 
-	if (likely(!async) && test_bit(DM_CRYPT_NO_OFFLOAD, &cc->flags)) {
+	if (likely(!async) &&
+	    (io->inline_crypt || test_bit(DM_CRYPT_NO_OFFLOAD, &cc->flags))) {
 		generic_make_request(clone);
 		return;
 	}
@@ -1818,9 +1837,48 @@ static void kcryptd_crypt(struct work_struct *work)
 		kcryptd_crypt_write_convert(io);
 }
 
+/*
+ * Small bios can be crypted right away on the submitting (writes) or the
+ * completing (reads) CPU when the cipher is synchronous, saving the hops
+ * through kcryptd and, for writes, dmcrypt_write. The crypto API can't be
+ * used in hard interrupt context, and writes have to allocate the pages of
+ * the clone, so those cases still go through the workqueue.
+ */
+static bool kcryptd_crypt_inline(struct dm_crypt_io *io)
+{
+	struct crypt_config *cc = io->cc;
+
+	if (!test_bit(DM_CRYPT_INLINE, &cc->flags))
+		return false;
+
+	if (bio_sectors(io->base_bio) > cc->inline_max_sectors)
+		return false;
+
+	if (bio_data_dir(io->base_bio) == WRITE)
+		return !in_interrupt();
+
+	return !in_irq() && !irqs_disabled();
+}
+
 static void kcryptd_queue_crypt(struct dm_crypt_io *io)
 {
 	struct crypt_config *cc = io->cc;
+	bool write = bio_data_dir(io->base_bio) == WRITE;
+
+	if (kcryptd_crypt_inline(io)) {
+		if (write)
+			this_cpu_inc(cc->path_stats->inline_writes);
+		else
+			this_cpu_inc(cc->path_stats->inline_reads);
+		io->inline_crypt = true;
+		kcryptd_crypt(&io->work);
+		return;
+	}
+
+	if (write)
+		this_cpu_inc(cc->path_stats->queued_writes);
+	else
+		this_cpu_inc(cc->path_stats->queued_reads);
 
 	INIT_WORK(&io->work, kcryptd_crypt);
 	queue_work(cc->crypt_queue, &io->work);
@@ -1865,6 +1923,21 @@ static void crypt_free_tfms(struct crypt_config *cc)
 		crypt_free_tfms_skcipher(cc);
 }
 
+/*
+ * Inline crypto needs a synchronous cipher: prefer one when inline_crypt is
+ * requested, and fall back to the workqueue if there is none.
+ */
+static u32 crypt_tfm_mask(struct crypt_config *cc)
+{
+	return test_bit(DM_CRYPT_INLINE, &cc->flags) ? CRYPTO_ALG_ASYNC : 0;
+}
+
+static void crypt_no_sync_tfm(struct crypt_config *cc, char *ciphermode)
+{
+	DMINFO("no synchronous %s, inline_crypt disabled", ciphermode);
+	clear_bit(DM_CRYPT_INLINE, &cc->flags);
+}
+
 static int crypt_alloc_tfms_skcipher(struct crypt_config *cc, char *ciphermode)
 {
 	unsigned i;
@@ -1877,7 +1950,12 @@ static int crypt_alloc_tfms_skcipher(struct crypt_config *cc, char *ciphermode)
 		return -ENOMEM;
 
 	for (i = 0; i < cc->tfms_count; i++) {
-		cc->cipher_tfm.tfms[i] = crypto_alloc_skcipher(ciphermode, 0, 0);
+		cc->cipher_tfm.tfms[i] = crypto_alloc_skcipher(ciphermode, 0,
+							       crypt_tfm_mask(cc));
+		if (IS_ERR(cc->cipher_tfm.tfms[i]) && !i && crypt_tfm_mask(cc)) {
+			crypt_no_sync_tfm(cc, ciphermode);
+			cc->cipher_tfm.tfms[i] = crypto_alloc_skcipher(ciphermode, 0, 0);
+		}
 		if (IS_ERR(cc->cipher_tfm.tfms[i])) {
 			err = PTR_ERR(cc->cipher_tfm.tfms[i]);
 			crypt_free_tfms(cc);
@@ -1896,7 +1974,12 @@ static int crypt_alloc_tfms_aead(struct crypt_config *cc, char *ciphermode)
 	if (!cc->cipher_tfm.tfms)
 		return -ENOMEM;
 
-	cc->cipher_tfm.tfms_aead[0] = crypto_alloc_aead(ciphermode, 0, 0);
+	cc->cipher_tfm.tfms_aead[0] = crypto_alloc_aead(ciphermode, 0,
+							crypt_tfm_mask(cc));
+	if (IS_ERR(cc->cipher_tfm.tfms_aead[0]) && crypt_tfm_mask(cc)) {
+		crypt_no_sync_tfm(cc, ciphermode);
+		cc->cipher_tfm.tfms_aead[0] = crypto_alloc_aead(ciphermode, 0, 0);
+	}
 	if (IS_ERR(cc->cipher_tfm.tfms_aead[0])) {
 		err = PTR_ERR(cc->cipher_tfm.tfms_aead[0]);
 		crypt_free_tfms(cc);
@@ -2214,6 +2297,8 @@ static void crypt_dtr(struct dm_target *ti)
 
 	bioset_exit(&cc->bs);
 
+	free_percpu(cc->path_stats);
+
 	mempool_exit(&cc->page_pool);
 	mempool_exit(&cc->req_pool);
 	mempool_exit(&cc->tag_pool);
@@ -2584,7 +2669,7 @@ static int crypt_ctr_optional(struct dm_target *ti, unsigned int argc, char **ar
 	struct crypt_config *cc = ti->private;
 	struct dm_arg_set as;
 	static const struct dm_arg _args[] = {
-		{0, 6, "Invalid number of feature args"},
+		{0, 7, "Invalid number of feature args"},
 	};
 	unsigned int opt_params, val;
 	const char *opt_string, *sval;
@@ -2614,6 +2699,14 @@ static int crypt_ctr_optional(struct dm_target *ti, unsigned int argc, char **ar
 
 		else if (!strcasecmp(opt_string, "submit_from_crypt_cpus"))
 			set_bit(DM_CRYPT_NO_OFFLOAD, &cc->flags);
+		else if (sscanf(opt_string, "inline_crypt:%u%c", &val, &dummy) == 1) {
+			if (val == 0 || val > BIO_MAX_PAGES << (PAGE_SHIFT - SECTOR_SHIFT)) {
+				ti->error = "Invalid feature value for inline_crypt";
+				return -EINVAL;
+			}
+			cc->inline_max_sectors = val;
+			set_bit(DM_CRYPT_INLINE, &cc->flags);
+		}
 		else if (sscanf(opt_string, "integrity:%u:", &val) == 1) {
 			if (val == 0 || val > MAX_TAG_SIZE) {
 				ti->error = "Invalid integrity arguments";
@@ -2699,6 +2792,13 @@ static int crypt_ctr(struct dm_target *ti, unsigned int argc, char **argv)
 	if (ret < 0)
 		goto bad;
 
+	cc->path_stats = alloc_percpu(struct crypt_path_stats);
+	if (!cc->path_stats) {
+		ti->error = "Cannot allocate statistics";
+		ret = -ENOMEM;
+		goto bad;
+	}
+
 	/* Optional parameters need to be read before cipher constructor */
 	if (argc > 5) {
 		ret = crypt_ctr_optional(ti, argc - 5, &argv[5]);
@@ -2916,10 +3016,26 @@ static void crypt_status(struct dm_target *ti, status_type_t type,
 	struct crypt_config *cc = ti->private;
 	unsigned i, sz = 0;
 	int num_feature_args = 0;
+	struct crypt_path_stats stats = { };
+	int cpu;
 
 	switch (type) {
 	case STATUSTYPE_INFO:
 		result[0] = '\0';
+		if (!cc->inline_max_sectors)
+			break;
+
+		for_each_possible_cpu(cpu) {
+			struct crypt_path_stats *s = per_cpu_ptr(cc->path_stats, cpu);
+
+			stats.inline_reads += READ_ONCE(s->inline_reads);
+			stats.inline_writes += READ_ONCE(s->inline_writes);
+			stats.queued_reads += READ_ONCE(s->queued_reads);
+			stats.queued_writes += READ_ONCE(s->queued_writes);
+		}
+		DMEMIT("inline_reads %lu inline_writes %lu queued_reads %lu queued_writes %lu",
+		       stats.inline_reads, stats.inline_writes,
+		       stats.queued_reads, stats.queued_writes);
 		break;
 
 	case STATUSTYPE_TABLE:
@@ -2940,6 +3056,7 @@ static void crypt_status(struct dm_target *ti, status_type_t type,
 		num_feature_args += !!ti->num_discard_bios;
 		num_feature_args += test_bit(DM_CRYPT_SAME_CPU, &cc->flags);
 		num_feature_args += test_bit(DM_CRYPT_NO_OFFLOAD, &cc->flags);
+		num_feature_args += !!cc->inline_max_sectors;
 		num_feature_args += cc->sector_size != (1 << SECTOR_SHIFT);
 		num_feature_args += test_bit(CRYPT_IV_LARGE_SECTORS, &cc->cipher_flags);
 		if (cc->on_disk_tag_size)
@@ -2952,6 +3069,8 @@ static void crypt_status(struct dm_target *ti, status_type_t type,
 				DMEMIT(" same_cpu_crypt");
 			if (test_bit(DM_CRYPT_NO_OFFLOAD, &cc->flags))
 				DMEMIT(" submit_from_crypt_cpus");
+			if (cc->inline_max_sectors)
+				DMEMIT(" inline_crypt:%u", cc->inline_max_sectors);
 			if (cc->on_disk_tag_size)
 				DMEMIT(" integrity:%u:%s", cc->on_disk_tag_size, cc->cipher_auth);
 			if (cc->sector_size != (1 << SECTOR_SHIFT))
@@ -3070,7 +3189,7 @@ static void crypt_io_hints(struct dm_target *ti, struct queue_limits *limits)
 
 static struct target_type crypt_target = {
 	.name   = "crypt",
-	.version = {1, 18, 1},
+	.version = {1, 19, 0},
 	.module = THIS_MODULE,
 	.ctr    = crypt_ctr,
 	.dtr    = crypt_dtr,
@@ -12,6 +12,11 @@
  * hash device. Setting this greatly improves performance when data and hash
  * are on the same disk on different partitions on devices with poor random
  * access behavior.
+ *
+ * With the "try_verify_in_tasklet" option, reads are verified from a tasklet
+ * scheduled by the bio completion when the hash blocks they need are cached
+ * and verified, saving a switch to the verification workqueue. Cache misses
+ * and verification failures are handed over to the workqueue.
  */
 
 #include "dm-verity.h"
@@ -33,8 +38,9 @@
 #define DM_VERITY_OPT_RESTART		"restart_on_corruption"
 #define DM_VERITY_OPT_IGN_ZEROES	"ignore_zero_blocks"
 #define DM_VERITY_OPT_AT_MOST_ONCE	"check_at_most_once"
+#define DM_VERITY_OPT_TASKLET_VERIFY	"try_verify_in_tasklet"
 
-#define DM_VERITY_OPTS_MAX		(2 + DM_VERITY_OPTS_FEC)
+#define DM_VERITY_OPTS_MAX		(3 + DM_VERITY_OPTS_FEC)
 
 static unsigned dm_verity_prefetch_cluster = DM_VERITY_DEFAULT_PREFETCH_SIZE;
 
@@ -125,14 +131,16 @@ static int verity_hash_update(struct dm_verity *v, struct ahash_request *req,
  * Wrapper for crypto_ahash_init, which handles verity salting.
  */
 static int verity_hash_init(struct dm_verity *v, struct ahash_request *req,
-				struct crypto_wait *wait)
+				struct crypto_wait *wait, bool may_sleep)
 {
+	u32 flags = CRYPTO_TFM_REQ_MAY_BACKLOG;
 	int r;
 
+	if (may_sleep)
+		flags |= CRYPTO_TFM_REQ_MAY_SLEEP;
+
 	ahash_request_set_tfm(req, v->tfm);
-	ahash_request_set_callback(req, CRYPTO_TFM_REQ_MAY_SLEEP |
-					CRYPTO_TFM_REQ_MAY_BACKLOG,
-					crypto_req_done, (void *)wait);
+	ahash_request_set_callback(req, flags, crypto_req_done, (void *)wait);
 	crypto_init_wait(wait);
 
 	r = crypto_wait_req(crypto_ahash_init(req), wait);
@@ -168,13 +176,50 @@ static int verity_hash_final(struct dm_verity *v, struct ahash_request *req,
 	return r;
 }
 
-int verity_hash(struct dm_verity *v, struct ahash_request *req,
-		const u8 *data, size_t len, u8 *digest)
+/*
+ * Start a synchronous hash from the state saved after hashing the salt,
+ * instead of going through the ahash request and completion machinery.
+ */
+static int verity_shash_init(struct dm_verity *v, struct shash_desc *desc)
+{
+	desc->tfm = v->shash_tfm;
+	desc->flags = 0;
+
+	return crypto_shash_import(desc, v->initial_hashstate);
+}
+
+static int verity_shash_final(struct dm_verity *v, struct shash_desc *desc,
+			      u8 *digest)
+{
+	int r;
+
+	if (unlikely(v->salt_size && (!v->version))) {
+		r = crypto_shash_update(desc, v->salt, v->salt_size);
+		if (r < 0)
+			return r;
+	}
+
+	return crypto_shash_final(desc, digest);
+}
+
+static int __verity_hash(struct dm_verity *v, struct ahash_request *req,
+			 const u8 *data, size_t len, u8 *digest, bool may_sleep)
 {
 	int r;
 	struct crypto_wait wait;
 
-	r = verity_hash_init(v, req, &wait);
+	if (v->shash_tfm) {
+		struct shash_desc *desc = (struct shash_desc *)req;
+
+		r = verity_shash_init(v, desc);
+		if (likely(!r))
+			r = crypto_shash_update(desc, data, len);
+		if (likely(!r))
+			r = verity_shash_final(v, desc, digest);
+		return r;
+	}
+
+	r = verity_hash_init(v, req, &wait, may_sleep);
 	if (unlikely(r < 0))
 		goto out;
 
@@ -188,6 +233,12 @@ int verity_hash(struct dm_verity *v, struct ahash_request *req,
 	return r;
 }
 
+int verity_hash(struct dm_verity *v, struct ahash_request *req,
+		const u8 *data, size_t len, u8 *digest)
+{
+	return __verity_hash(v, req, data, len, digest, true);
+}
+
 static void verity_hash_at_level(struct dm_verity *v, sector_t block, int level,
 				 sector_t *hash_block, unsigned *offset)
 {
@@ -271,6 +322,9 @@ static int verity_handle_err(struct dm_verity *v, enum verity_block_type type,
  * If "skip_unverified" is true, unverified buffer is skipped and 1 is returned.
  * If "skip_unverified" is false, unverified buffer is hashed and verified
  * against current value of verity_io_want_digest(v, io).
+ *
+ * In a tasklet, -EAGAIN is returned if the buffer is not cached or doesn't
+ * match, for the io to be retried from the workqueue.
  */
 static int verity_verify_level(struct dm_verity *v, struct dm_verity_io *io,
 			       sector_t block, int level, bool skip_unverified,
@@ -285,7 +339,12 @@ static int verity_verify_level(struct dm_verity *v, struct dm_verity_io *io,
 
 	verity_hash_at_level(v, block, level, &hash_block, &offset);
 
-	data = dm_bufio_read(v->bufio, hash_block, &buf);
+	if (io->in_tasklet) {
+		data = dm_bufio_get(v->bufio, hash_block, &buf);
+		if (!data)
+			return -EAGAIN;
+	} else
+		data = dm_bufio_read(v->bufio, hash_block, &buf);
 	if (IS_ERR(data))
 		return PTR_ERR(data);
 
@@ -297,16 +356,20 @@ static int verity_verify_level(struct dm_verity *v, struct dm_verity_io *io,
 			goto release_ret_r;
 		}
 
-		r = verity_hash(v, verity_io_hash_req(v, io),
-				data, 1 << v->hash_dev_block_bits,
-				verity_io_real_digest(v, io));
+		r = __verity_hash(v, verity_io_hash_req(v, io),
+				  data, 1 << v->hash_dev_block_bits,
+				  verity_io_real_digest(v, io),
+				  !io->in_tasklet);
 		if (unlikely(r < 0))
 			goto release_ret_r;
 
 		if (likely(memcmp(verity_io_real_digest(v, io), want_digest,
 				  v->digest_size) == 0))
 			aux->hash_verified = 1;
-		else if (verity_fec_decode(v, io,
+		else if (io->in_tasklet) {
+			r = -EAGAIN;
+			goto release_ret_r;
+		} else if (verity_fec_decode(v, io,
 					   DM_VERITY_BLOCK_TYPE_METADATA,
 					   hash_block, data, NULL) == 0)
 			aux->hash_verified = 1;
@@ -453,6 +516,32 @@ static int verity_bv_zero(struct dm_verity *v, struct dm_verity_io *io,
 	return 0;
 }
 
+static int verity_bv_shash_update(struct dm_verity *v, struct dm_verity_io *io,
+				  u8 *data, size_t len)
+{
+	return crypto_shash_update(verity_io_shash_desc(v, io), data, len);
+}
+
+/*
+ * Digest of the next data block of the bio, with the synchronous hash.
+ */
+static int verity_shash_io_block(struct dm_verity *v, struct dm_verity_io *io,
+				 struct bvec_iter *iter, u8 *digest)
+{
+	struct shash_desc *desc = verity_io_shash_desc(v, io);
+	int r;
+
+	r = verity_shash_init(v, desc);
+	if (unlikely(r < 0))
+		return r;
+
+	r = verity_for_bv_block(v, io, iter, verity_bv_shash_update);
+	if (unlikely(r < 0))
+		return r;
+
+	return verity_shash_final(v, desc, digest);
+}
+
 /*
  * Moves the bio iter one data block forward.
  */
@@ -472,10 +561,17 @@ static int verity_verify_io(struct dm_verity_io *io)
 {
 	bool is_zero;
 	struct dm_verity *v = io->v;
-	struct bvec_iter start;
+	struct bvec_iter start, iter_copy, *iter;
 	unsigned b;
 	struct crypto_wait wait;
 
+	/* Keep io->iter intact in case the workqueue has to start over */
+	if (io->in_tasklet) {
+		iter_copy = io->iter;
+		iter = &iter_copy;
+	} else
+		iter = &io->iter;
+
 	for (b = 0; b < io->n_blocks; b++) {
 		int r;
 		sector_t cur_block = io->block + b;
@@ -483,7 +579,7 @@ static int verity_verify_io(struct dm_verity_io *io)
 
 		if (v->validated_blocks &&
 		    likely(test_bit(cur_block, v->validated_blocks))) {
-			verity_bv_skip_block(v, io, &io->iter);
+			verity_bv_skip_block(v, io, iter);
 			continue;
 		}
 
@@ -498,7 +594,7 @@ static int verity_verify_io(struct dm_verity_io *io)
 			 * If we expect a zero block, don't validate, just
 			 * return zeros.
 			 */
-			r = verity_for_bv_block(v, io, &io->iter,
+			r = verity_for_bv_block(v, io, iter,
 						verity_bv_zero);
 			if (unlikely(r < 0))
 				return r;
@@ -506,19 +602,27 @@ static int verity_verify_io(struct dm_verity_io *io)
 			continue;
 		}
 
-		r = verity_hash_init(v, req, &wait);
-		if (unlikely(r < 0))
-			return r;
+		start = *iter;
+		if (v->shash_tfm) {
+			r = verity_shash_io_block(v, io, iter,
+						  verity_io_real_digest(v, io));
+			if (unlikely(r < 0))
+				return r;
+		} else {
+			r = verity_hash_init(v, req, &wait, !io->in_tasklet);
+			if (unlikely(r < 0))
+				return r;
 
-		start = io->iter;
-		r = verity_for_io_block(v, io, &io->iter, &wait);
-		if (unlikely(r < 0))
-			return r;
+			r = verity_for_io_block(v, io, iter, &wait);
+			if (unlikely(r < 0))
+				return r;
 
-		r = verity_hash_final(v, req, verity_io_real_digest(v, io),
-					&wait);
-		if (unlikely(r < 0))
-			return r;
+			r = verity_hash_final(v, req,
+					      verity_io_real_digest(v, io),
+					      &wait);
+			if (unlikely(r < 0))
+				return r;
+		}
 
 		if (likely(memcmp(verity_io_real_digest(v, io),
 				  verity_io_want_digest(v, io), v->digest_size) == 0)) {
@@ -526,6 +630,8 @@ static int verity_verify_io(struct dm_verity_io *io)
 				set_bit(cur_block, v->validated_blocks);
 			continue;
 		}
+		else if (io->in_tasklet)
+			return -EAGAIN;
 		else if (verity_fec_decode(v, io, DM_VERITY_BLOCK_TYPE_DATA,
 					   cur_block, NULL, &start) == 0)
 			continue;
@@ -557,9 +663,27 @@ static void verity_work(struct work_struct *w)
 {
 	struct dm_verity_io *io = container_of(w, struct dm_verity_io, work);
 
+	io->in_tasklet = false;
 	verity_finish_io(io, errno_to_blk_status(verity_verify_io(io)));
 }
 
+static void verity_tasklet(unsigned long data)
+{
+	struct dm_verity_io *io = (struct dm_verity_io *)data;
+	int r;
+
+	io->in_tasklet = true;
+	r = verity_verify_io(io);
+	if (r == -EAGAIN) {
+		/* a hash block has to be read or something went wrong */
+		INIT_WORK(&io->work, verity_work);
+		queue_work(io->v->verify_wq, &io->work);
+		return;
+	}
+
+	verity_finish_io(io, errno_to_blk_status(r));
+}
+
 static void verity_end_io(struct bio *bio)
 {
 	struct dm_verity_io *io = bio->bi_private;
@@ -569,6 +693,12 @@ static void verity_end_io(struct bio *bio)
 		return;
 	}
 
+	if (io->v->use_tasklet && !bio->bi_status) {
+		tasklet_init(&io->tasklet, verity_tasklet, (unsigned long)io);
+		tasklet_schedule(&io->tasklet);
+		return;
+	}
+
 	INIT_WORK(&io->work, verity_work);
 	queue_work(io->v->verify_wq, &io->work);
 }
@@ -725,6 +855,8 @@ void verity_status(struct dm_target *ti, status_type_t type,
 			args++;
 		if (v->validated_blocks)
 			args++;
+		if (v->use_tasklet)
+			args++;
 		if (!args)
 			return;
 		DMEMIT(" %u", args);
@@ -745,6 +877,8 @@ void verity_status(struct dm_target *ti, status_type_t type,
 			DMEMIT(" " DM_VERITY_OPT_IGN_ZEROES);
 		if (v->validated_blocks)
 			DMEMIT(" " DM_VERITY_OPT_AT_MOST_ONCE);
+		if (v->use_tasklet)
+			DMEMIT(" " DM_VERITY_OPT_TASKLET_VERIFY);
 		sz = verity_fec_status_table(v, sz, result, maxlen);
 		break;
 	}
@@ -801,6 +935,10 @@ void verity_dtr(struct dm_target *ti)
 	if (v->tfm)
 		crypto_free_ahash(v->tfm);
 
+	kfree(v->initial_hashstate);
+	if (v->shash_tfm)
+		crypto_free_shash(v->shash_tfm);
+
 	kfree(v->alg_name);
 
 	if (v->hash_dev)
@@ -866,6 +1004,83 @@ static int verity_alloc_zero_digest(struct dm_verity *v)
 	return r;
 }
 
+/*
+ * If the ahash is implemented by a synchronous algorithm, use that algorithm
+ * directly to hash data and hash blocks, and save its state after the
+ * leading salt so that it doesn't have to be hashed for every block.
+ *
+ * Asynchronous implementations, including the x86 multi-buffer ones
+ * (sha*-mb, behind mcryptd), keep going through the ahash path.
+ */
+static int verity_setup_shash(struct dm_verity *v)
+{
+	struct crypto_shash *tfm;
+	struct shash_desc *desc;
+	int r;
+
+	tfm = crypto_alloc_shash(v->alg_name, 0, CRYPTO_ALG_ASYNC);
+	if (IS_ERR(tfm))
+		return 0;
+
+	if (strcmp(crypto_shash_driver_name(tfm),
+		   crypto_ahash_driver_name(v->tfm))) {
+		crypto_free_shash(tfm);
+		return 0;
+	}
+
+	r = -ENOMEM;
+	v->initial_hashstate = kmalloc(crypto_shash_statesize(tfm), GFP_KERNEL);
+	desc = kmalloc(sizeof(*desc) + crypto_shash_descsize(tfm), GFP_KERNEL);
+	if (!v->initial_hashstate || !desc)
+		goto out;
+
+	desc->tfm = tfm;
+	desc->flags = CRYPTO_TFM_REQ_MAY_SLEEP;
+	r = crypto_shash_init(desc);
+	if (!r && v->salt_size && v->version >= 1)
+		r = crypto_shash_update(desc, v->salt, v->salt_size);
+	if (!r)
+		r = crypto_shash_export(desc, v->initial_hashstate);
+	if (r)
+		goto out;
+
+	v->shash_tfm = tfm;
+	v->ahash_reqsize = max_t(unsigned int, v->ahash_reqsize,
+				 sizeof(*desc) + crypto_shash_descsize(tfm));
+out:
+	kfree(desc);
+	if (r) {
+		v->ti->error = "Cannot initialize hash state";
+		kfree(v->initial_hashstate);
+		v->initial_hashstate = NULL;
+		crypto_free_shash(tfm);
+	}
+	return r;
+}
+
+/*
+ * Verifying in a tasklet can't wait for an asynchronous hash
+ * implementation: switch to a synchronous one.
+ */
+static int verity_alloc_sync_tfm(struct dm_verity *v)
+{
+	struct dm_target *ti = v->ti;
+	struct crypto_ahash *tfm;
+
+	tfm = crypto_alloc_ahash(v->alg_name, 0, CRYPTO_ALG_ASYNC);
+	if (IS_ERR(tfm)) {
+		ti->error = "Cannot initialize synchronous hash function";
+		return PTR_ERR(tfm);
+	}
+
+	crypto_free_ahash(v->tfm);
+	v->tfm = tfm;
+	v->ahash_reqsize = sizeof(struct ahash_request) +
+		crypto_ahash_reqsize(v->tfm);
+
+	return 0;
+}
+
 static int verity_parse_opt_args(struct dm_arg_set *as, struct dm_verity *v)
 {
 	int r;
@@ -910,6 +1125,13 @@ static int verity_parse_opt_args(struct dm_arg_set *as, struct dm_verity *v)
 				return r;
 			continue;
 
+		} else if (!strcasecmp(arg_name, DM_VERITY_OPT_TASKLET_VERIFY)) {
+			r = verity_alloc_sync_tfm(v);
+			if (r)
+				return r;
+			v->use_tasklet = true;
+			continue;
+
 		} else if (verity_is_fec_opt_arg(arg_name)) {
 			r = verity_fec_parse_opt_args(as, v, &argc, arg_name);
 			if (r)
@@ -1102,6 +1324,10 @@ int verity_ctr(struct dm_target *ti, unsigned argc, char **argv)
 			goto bad;
 	}
 
+	r = verity_setup_shash(v);
+	if (r)
+		goto bad;
+
 #ifdef CONFIG_DM_ANDROID_VERITY_AT_MOST_ONCE_DEFAULT_ENABLED
 	if (!v->validated_blocks) {
 		r = verity_alloc_most_once(v);
@@ -1151,14 +1377,29 @@ int verity_ctr(struct dm_target *ti, unsigned argc, char **argv)
 		goto bad;
 	}
 
+	if (v->use_tasklet) {
+		r = dm_bufio_set_no_sleep(v->bufio);
+		if (r) {
+			ti->error = "Hash block size too large for " DM_VERITY_OPT_TASKLET_VERIFY;
+			goto bad;
+		}
+	}
+
 	if (dm_bufio_get_device_size(v->bufio) < v->hash_blocks) {
 		ti->error = "Hash device is too small";
 		r = -E2BIG;
 		goto bad;
 	}
 
-	/* WQ_UNBOUND greatly improves performance when running on ramdisk */
-	v->verify_wq = alloc_workqueue("kverityd", WQ_CPU_INTENSIVE | WQ_MEM_RECLAIM | WQ_UNBOUND, num_online_cpus());
+	/*
+	 * WQ_UNBOUND greatly improves performance when running on ramdisk,
+	 * WQ_CACHE_AFFINE keeps verification in the cache of the CPU which
+	 * completed the data bio.
+	 */
+	v->verify_wq = alloc_workqueue("kverityd",
+				       WQ_CPU_INTENSIVE | WQ_MEM_RECLAIM |
+				       WQ_UNBOUND | WQ_CACHE_AFFINE,
+				       num_online_cpus());
 	if (!v->verify_wq) {
 		ti->error = "Cannot allocate workqueue";
 		r = -ENOMEM;
@@ -1185,7 +1426,7 @@ int verity_ctr(struct dm_target *ti, unsigned argc, char **argv)
 
 static struct target_type verity_target = {
 	.name		= "verity",
-	.version	= {1, 4, 0},
+	.version	= {1, 5, 0},
 	.module		= THIS_MODULE,
 	.ctr		= verity_ctr,
 	.dtr		= verity_dtr,
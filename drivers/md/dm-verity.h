@@ -14,6 +14,7 @@
 
 #include <linux/dm-bufio.h>
 #include <linux/device-mapper.h>
+#include <linux/interrupt.h>
 #include <crypto/hash.h>
 
 #define DM_VERITY_MAX_LEVELS		63
@@ -38,6 +39,8 @@ struct dm_verity {
 	struct dm_bufio_client *bufio;
 	char *alg_name;
 	struct crypto_ahash *tfm;
+	struct crypto_shash *shash_tfm;	/* same algorithm, synchronous */
+	u8 *initial_hashstate;	/* shash state after the leading salt */
 	u8 *root_digest;	/* digest of the root block */
 	u8 *salt;		/* salt: its size is salt_size */
 	u8 *zero_digest;	/* digest for a zero block */
@@ -56,6 +59,7 @@ struct dm_verity {
 	int hash_failed;	/* set to 1 if hash of any block failed */
 	enum verity_mode mode;	/* mode for handling verification errors */
 	unsigned corrupted_errs;/* Number of errors for corrupted blocks */
+	bool use_tasklet;	/* try to verify in softirq context first */
 
 	struct workqueue_struct *verify_wq;
 
@@ -78,6 +82,8 @@ struct dm_verity_io {
 	struct bvec_iter iter;
 
 	struct work_struct work;
+	struct tasklet_struct tasklet;
+	bool in_tasklet;
 
 	/*
 	 * Three variably-size fields follow this struct:
@@ -97,6 +103,12 @@ static inline struct ahash_request *verity_io_hash_req(struct dm_verity *v,
 	return (struct ahash_request *)(io + 1);
 }
 
+static inline struct shash_desc *verity_io_shash_desc(struct dm_verity *v,
+						     struct dm_verity_io *io)
+{
+	return (struct shash_desc *)(io + 1);
+}
+
 static inline u8 *verity_io_real_digest(struct dm_verity *v,
 					struct dm_verity_io *io)
 {
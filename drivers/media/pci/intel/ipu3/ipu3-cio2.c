@@ -170,16 +170,17 @@ static void cio2_fbpt_entry_init_dummy(struct cio2_device *cio2,
 	cio2_fbpt_entry_enable(cio2, entry);
 }
 
-/* Initialize fpbt entries to point to a given buffer */
-static void cio2_fbpt_entry_init_buf(struct cio2_device *cio2,
-				     struct cio2_buffer *b,
-				     struct cio2_fbpt_entry
-				     entry[CIO2_MAX_LOPS])
+/* Prepare the fbpt entries of a buffer, once its LOP is filled */
+static void cio2_fbpt_entry_setup_buf(struct cio2_device *cio2,
+				      struct cio2_buffer *b)
 {
+	struct cio2_fbpt_entry *entry = b->fbpt;
 	struct vb2_buffer *vb = &b->vbb.vb2_buf;
 	unsigned int length = vb->planes[0].length;
 	int remaining, i;
 
+	memset(b->fbpt, 0, sizeof(b->fbpt));
+
 	entry[0].first_entry.first_page_offset = b->offset;
 	remaining = length + entry[0].first_entry.first_page_offset;
 	entry[1].second_entry.num_of_pages =
@@ -209,7 +210,21 @@ static void cio2_fbpt_entry_init_buf(struct cio2_device *cio2,
 	/*
 	 * The first not meaningful FBPT entry should point to a valid LOP
 	 */
-	entry->lop_page_addr = cio2->dummy_lop_bus_addr >> PAGE_SHIFT;
+	if (i < CIO2_MAX_LOPS)
+		entry->lop_page_addr = cio2->dummy_lop_bus_addr >> PAGE_SHIFT;
+}
+
+/* Initialize fpbt entries to point to a given buffer */
+static void cio2_fbpt_entry_init_buf(struct cio2_device *cio2,
+				     struct cio2_buffer *b,
+				     struct cio2_fbpt_entry
+				     entry[CIO2_MAX_LOPS])
+{
+	const size_t ctrl = sizeof(entry[0].first_entry.ctrl);
+
+	/* Everything but ctrl, which is written last to hand it to the DMA */
+	memcpy((u8 *)entry + ctrl, (u8 *)b->fbpt + ctrl,
+	       sizeof(b->fbpt) - ctrl);
 
 	cio2_fbpt_entry_enable(cio2, entry);
 }
@@ -543,6 +558,24 @@ static void cio2_hw_exit(struct cio2_device *cio2, struct cio2_queue *q)
 	}
 }
 
+static void cio2_latency_update(struct cio2_queue *q, unsigned int sequence,
+				u64 ns)
+{
+	u64 sof = q->sof_ns[sequence % CIO2_MAX_BUFFERS];
+	u64 latency;
+
+	if (!sof || sof > ns)
+		return;
+
+	latency = ns - sof;
+	if (!q->latency_count || latency < q->latency_min_ns)
+		q->latency_min_ns = latency;
+	if (latency > q->latency_max_ns)
+		q->latency_max_ns = latency;
+	q->latency_sum_ns += latency;
+	q->latency_count++;
+}
+
 static void cio2_buffer_done(struct cio2_device *cio2, unsigned int dma_chan)
 {
 	struct device *dev = &cio2->pci_dev->dev;
@@ -576,6 +609,7 @@ static void cio2_buffer_done(struct cio2_device *cio2, unsigned int dma_chan)
 			b->vbb.vb2_buf.timestamp = ns;
 			b->vbb.field = V4L2_FIELD_NONE;
 			b->vbb.sequence = atomic_read(&q->frame_sequence);
+			cio2_latency_update(q, b->vbb.sequence, ns);
 			if (b->vbb.vb2_buf.planes[0].length != bytes)
 				dev_warn(dev, "buffer length is %d received %d\n",
 					 b->vbb.vb2_buf.planes[0].length,
@@ -606,6 +640,8 @@ static void cio2_queue_event_sof(struct cio2_device *cio2, struct cio2_queue *q)
 		.u.frame_sync.frame_sequence = atomic_read(&q->frame_sequence),
 	};
 
+	q->sof_ns[event.u.frame_sync.frame_sequence % CIO2_MAX_BUFFERS] =
+		ktime_get_ns();
 	v4l2_event_queue(q->subdev.devnode, &event);
 }
 
@@ -836,6 +872,59 @@ static int cio2_vb2_queue_setup(struct vb2_queue *vq,
 	return 0;
 }
 
+/*
+ * Fill the LOP of a buffer from its current mapping. Only the entries which
+ * changed are written, so refreshing a recycled dmabuf buffer whose exporter
+ * kept its mapping does not touch the LOP nor the buffer's fbpt entries.
+ */
+static int cio2_buf_fill_lop(struct cio2_device *cio2, struct cio2_buffer *b)
+{
+	struct vb2_buffer *vb = &b->vbb.vb2_buf;
+	static const unsigned int entries_per_page =
+		CIO2_PAGE_SIZE / sizeof(u32);
+	unsigned int pages = DIV_ROUND_UP(vb->planes[0].length, CIO2_PAGE_SIZE);
+	unsigned int offset = 0;
+	bool changed = false;
+	struct sg_table *sg;
+	struct sg_page_iter sg_iter;
+	int i, j;
+	u32 pfn;
+
+	sg = vb2_dma_sg_plane_desc(vb, 0);
+	if (!sg)
+		return -ENOMEM;
+
+	if (sg->nents && sg->sgl)
+		offset = sg->sgl->offset;
+	if (b->offset != offset) {
+		b->offset = offset;
+		changed = true;
+	}
+
+	i = j = 0;
+	for_each_sg_page(sg->sgl, &sg_iter, sg->nents, 0) {
+		if (!pages--)
+			break;
+		pfn = sg_page_iter_dma_address(&sg_iter) >> PAGE_SHIFT;
+		if (b->lop[i][j] != pfn) {
+			b->lop[i][j] = pfn;
+			changed = true;
+		}
+		j++;
+		if (j == entries_per_page) {
+			i++;
+			j = 0;
+		}
+	}
+
+	b->lop[i][j] = cio2->dummy_page_bus_addr >> PAGE_SHIFT;
+
+	if (changed || !b->fbpt[1].second_entry.num_of_pages)
+		cio2_fbpt_entry_setup_buf(cio2, b);
+
+	return 0;
+}
+
 /* Called after each buffer is allocated */
 static int cio2_vb2_buf_init(struct vb2_buffer *vb)
 {
@@ -847,9 +936,7 @@ static int cio2_vb2_buf_init(struct vb2_buffer *vb)
 		CIO2_PAGE_SIZE / sizeof(u32);
 	unsigned int pages = DIV_ROUND_UP(vb->planes[0].length, CIO2_PAGE_SIZE);
 	unsigned int lops = DIV_ROUND_UP(pages + 1, entries_per_page);
-	struct sg_table *sg;
-	struct sg_page_iter sg_iter;
-	int i, j;
+	int i, r;
 
 	if (lops <= 0 || lops > CIO2_MAX_LOPS) {
 		dev_err(dev, "%s: bad buffer size (%i)\n", __func__,
@@ -858,6 +945,8 @@ static int cio2_vb2_buf_init(struct vb2_buffer *vb)
 	}
 
 	memset(b->lop, 0, sizeof(b->lop));
+	memset(b->fbpt, 0, sizeof(b->fbpt));
+	b->offset = 0;
 	/* Allocate LOP table */
 	for (i = 0; i < lops; i++) {
 		b->lop[i] = dma_alloc_coherent(dev, CIO2_PAGE_SIZE,
@@ -866,27 +955,10 @@ static int cio2_vb2_buf_init(struct vb2_buffer *vb)
 			goto fail;
 	}
 
-	/* Fill LOP */
-	sg = vb2_dma_sg_plane_desc(vb, 0);
-	if (!sg)
-		return -ENOMEM;
-
-	if (sg->nents && sg->sgl)
-		b->offset = sg->sgl->offset;
-
-	i = j = 0;
-	for_each_sg_page(sg->sgl, &sg_iter, sg->nents, 0) {
-		if (!pages--)
-			break;
-		b->lop[i][j] = sg_page_iter_dma_address(&sg_iter) >> PAGE_SHIFT;
-		j++;
-		if (j == entries_per_page) {
-			i++;
-			j = 0;
-		}
-	}
+	r = cio2_buf_fill_lop(cio2, b);
+	if (r)
+		return r;
 
-	b->lop[i][j] = cio2->dummy_page_bus_addr >> PAGE_SHIFT;
 	return 0;
 fail:
 	for (i--; i >= 0; i--)
@@ -895,6 +967,23 @@ static int cio2_vb2_buf_init(struct vb2_buffer *vb)
 	return -ENOMEM;
 }
 
+/*
+ * A dmabuf is mapped again each time it is queued. Exporters commonly hand
+ * back the same pages, in which case the LOP and fbpt entries made for the
+ * buffer are reused as they are.
+ */
+static int cio2_vb2_buf_prepare(struct vb2_buffer *vb)
+{
+	struct cio2_device *cio2 = vb2_get_drv_priv(vb->vb2_queue);
+	struct cio2_buffer *b =
+		container_of(vb, struct cio2_buffer, vbb.vb2_buf);
+
+	if (vb->memory != VB2_MEMORY_DMABUF)
+		return 0;
+
+	return cio2_buf_fill_lop(cio2, b);
+}
+
 /* Transfer buffer ownership to cio2 */
 static void cio2_vb2_buf_queue(struct vb2_buffer *vb)
 {
@@ -994,6 +1083,11 @@ static int cio2_vb2_start_streaming(struct vb2_queue *vq, unsigned int count)
 
 	cio2->cur_queue = q;
 	atomic_set(&q->frame_sequence, 0);
+	memset(q->sof_ns, 0, sizeof(q->sof_ns));
+	q->latency_min_ns = 0;
+	q->latency_max_ns = 0;
+	q->latency_sum_ns = 0;
+	q->latency_count = 0;
 
 	r = pm_runtime_get_sync(&cio2->pci_dev->dev);
 	if (r < 0) {
@@ -1050,6 +1144,7 @@ static void cio2_vb2_stop_streaming(struct vb2_queue *vq)
 
 static const struct vb2_ops cio2_vb2_ops = {
 	.buf_init = cio2_vb2_buf_init,
+	.buf_prepare = cio2_vb2_buf_prepare,
 	.buf_queue = cio2_vb2_buf_queue,
 	.buf_cleanup = cio2_vb2_buf_cleanup,
 	.queue_setup = cio2_vb2_queue_setup,
@@ -1061,6 +1156,22 @@ static const struct vb2_ops cio2_vb2_ops = {
 
 /**************** V4L2 interface ****************/
 
+static ssize_t frame_latency_show(struct device *dev,
+				  struct device_attribute *attr, char *buf)
+{
+	struct cio2_queue *q = container_of(to_video_device(dev),
+					    struct cio2_queue, vdev);
+	u32 count = READ_ONCE(q->latency_count);
+	u64 avg = count ? div_u64(READ_ONCE(q->latency_sum_ns), count) : 0;
+
+	/* frames, then min, average and max SOF to buffer done in us */
+	return scnprintf(buf, PAGE_SIZE, "%u %llu %llu %llu\n", count,
+			 div_u64(READ_ONCE(q->latency_min_ns), NSEC_PER_USEC),
+			 div_u64(avg, NSEC_PER_USEC),
+			 div_u64(READ_ONCE(q->latency_max_ns), NSEC_PER_USEC));
+}
+static DEVICE_ATTR_RO(frame_latency);
+
 static int cio2_v4l2_querycap(struct file *file, void *fh,
 			      struct v4l2_capability *cap)
 {
@@ -1651,6 +1762,10 @@ static int cio2_queue_init(struct cio2_device *cio2, struct cio2_queue *q)
 	if (r)
 		goto fail_link;
 
+	r = device_create_file(&vdev->dev, &dev_attr_frame_latency);
+	if (r)
+		goto fail_link;
+
 	return 0;
 
 fail_link:
@@ -1673,6 +1788,7 @@ static int cio2_queue_init(struct cio2_device *cio2, struct cio2_queue *q)
 
 static void cio2_queue_exit(struct cio2_device *cio2, struct cio2_queue *q)
 {
+	device_remove_file(&q->vdev.dev, &dev_attr_frame_latency);
 	video_unregister_device(&q->vdev);
 	media_entity_cleanup(&q->vdev.entity);
 	vb2_queue_release(&q->vbq);
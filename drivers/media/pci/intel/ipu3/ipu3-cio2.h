@@ -312,11 +312,39 @@ struct cio2_csi2_timing {
 	s32 dat_settle;
 };
 
+/*
+ * Frame Buffer Pointer Table(FBPT) entry
+ * each entry describe an output buffer and consists of
+ * several sub-entries
+ */
+struct __packed cio2_fbpt_entry {
+	union {
+		struct __packed {
+			u32 ctrl; /* status ctrl */
+			u16 cur_line_num; /* current line # written to DDR */
+			u16 frame_num; /* updated by DMA upon FE */
+			u32 first_page_offset; /* offset for 1st page in LOP */
+		} first_entry;
+		/* Second entry per buffer */
+		struct __packed {
+			u32 timestamp;
+			u32 num_of_bytes;
+			/* the number of bytes for write on last page */
+			u16 last_page_available_bytes;
+			/* the number of pages allocated for this buf */
+			u16 num_of_pages;
+		} second_entry;
+	};
+	u32 lop_page_addr;	/* Points to list of pointers (LOP) table */
+};
+
 struct cio2_buffer {
 	struct vb2_v4l2_buffer vbb;
 	u32 *lop[CIO2_MAX_LOPS];
 	dma_addr_t lop_bus_addr[CIO2_MAX_LOPS];
 	unsigned int offset;
+	/* FBPT entries for this buffer, copied into the FBPT on queue */
+	struct cio2_fbpt_entry fbpt[CIO2_MAX_LOPS];
 };
 
 struct csi2_bus_info {
@@ -351,6 +379,13 @@ struct cio2_queue {
 	unsigned int bufs_first;	/* Index of the first used entry */
 	unsigned int bufs_next;	/* Index of the first unused entry */
 	atomic_t bufs_queued;
+
+	/* Start of frame to buffer done latency, reset on stream start */
+	u64 sof_ns[CIO2_MAX_BUFFERS];	/* indexed by frame sequence */
+	u64 latency_min_ns;
+	u64 latency_max_ns;
+	u64 latency_sum_ns;
+	u32 latency_count;
 };
 
 struct cio2_device {
@@ -400,32 +435,6 @@ struct cio2_device {
 #define CIO2_FBPT_CTRL_SUCCXFAIL	BIT(3)
 #define CIO2_FBPT_CTRL_CMPLCODE_SHIFT	4
 
-/*
- * Frame Buffer Pointer Table(FBPT) entry
- * each entry describe an output buffer and consists of
- * several sub-entries
- */
-struct __packed cio2_fbpt_entry {
-	union {
-		struct __packed {
-			u32 ctrl; /* status ctrl */
-			u16 cur_line_num; /* current line # written to DDR */
-			u16 frame_num; /* updated by DMA upon FE */
-			u32 first_page_offset; /* offset for 1st page in LOP */
-		} first_entry;
-		/* Second entry per buffer */
-		struct __packed {
-			u32 timestamp;
-			u32 num_of_bytes;
-			/* the number of bytes for write on last page */
-			u16 last_page_available_bytes;
-			/* the number of pages allocated for this buf */
-			u16 num_of_pages;
-		} second_entry;
-	};
-	u32 lop_page_addr;	/* Points to list of pointers (LOP) table */
-};
-
 static inline struct cio2_queue *file_to_cio2_queue(struct file *file)
 {
 	return container_of(video_devdata(file), struct cio2_queue, vdev);
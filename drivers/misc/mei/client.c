@@ -1538,6 +1538,36 @@ int mei_cl_read_start(struct mei_cl *cl, size_t length, const struct file *fp)
 	return rets;
 }
 
+/**
+ * mei_cl_read_ahead - request the next message before the reader asks
+ *
+ * @cl: host client
+ * @fp: file the reads belong to
+ *
+ * Without read ahead, the flow control credit for the next message is only
+ * sent once the reader comes back, so a burst of messages from the firmware
+ * is paced by the read round trips. Keep one read pending as long as
+ * less than rx_queue_limit messages wait to be read.
+ *
+ * Locking: called under "dev->device_lock" lock
+ */
+void mei_cl_read_ahead(struct mei_cl *cl, const struct file *fp)
+{
+	struct mei_device *dev = cl->dev;
+	struct mei_cl_cb *cb;
+	unsigned int queued = 0;
+
+	if (!dev->rx_queue_limit || mei_cl_is_fixed_address(cl) ||
+	    !mei_cl_is_connected(cl))
+		return;
+
+	list_for_each_entry(cb, &cl->rd_completed, list)
+		if (++queued >= dev->rx_queue_limit)
+			return;
+
+	mei_cl_read_start(cl, mei_cl_mtu(cl), fp);
+}
+
 /**
  * mei_msg_hdr_init - initialize mei message header
  *
@@ -1806,8 +1836,10 @@ void mei_cl_complete(struct mei_cl *cl, struct mei_cl_cb *cb)
 		if (!mei_cl_is_fixed_address(cl) &&
 		    !WARN_ON(!cl->rx_flow_ctrl_creds))
 			cl->rx_flow_ctrl_creds--;
-		if (!mei_cl_bus_rx_event(cl))
+		if (!mei_cl_bus_rx_event(cl)) {
+			mei_cl_read_ahead(cl, cb->fp);
 			wake_up_interruptible(&cl->rx_wait);
+		}
 		break;
 
 	case MEI_FOP_CONNECT:
@@ -224,6 +224,45 @@ static const struct file_operations mei_dbgfs_fops_allow_fa = {
 	.llseek = generic_file_llseek,
 };
 
+static ssize_t mei_dbgfs_read_rpm(struct file *fp, char __user *ubuf,
+				  size_t cnt, loff_t *ppos)
+{
+	struct mei_device *dev = fp->private_data;
+	struct mei_rpm_stats *st = &dev->rpm_stats;
+	const size_t bufsz = 256;
+	char *buf = kzalloc(bufsz, GFP_KERNEL);
+	int pos = 0;
+	int ret;
+
+	if  (!buf)
+		return -ENOMEM;
+
+	mutex_lock(&dev->device_lock);
+	pos += scnprintf(buf + pos, bufsz - pos, "resumes: %lu\n",
+			 st->resumes);
+	pos += scnprintf(buf + pos, bufsz - pos,
+			 "resume us: last %llu avg %llu max %llu\n",
+			 div_u64(st->resume_ns_last, NSEC_PER_USEC),
+			 st->resumes ?
+			 div_u64(st->resume_ns_total,
+				 st->resumes * NSEC_PER_USEC) : 0,
+			 div_u64(st->resume_ns_max, NSEC_PER_USEC));
+	pos += scnprintf(buf + pos, bufsz - pos, "last suspended ms: %lld\n",
+			 st->suspended_ms_last);
+	pos += scnprintf(buf + pos, bufsz - pos, "autosuspend ms: %u%s\n",
+			 st->delay_ms, dev->rpm_adaptive ? " (adaptive)" : "");
+	mutex_unlock(&dev->device_lock);
+
+	ret = simple_read_from_buffer(ubuf, cnt, ppos, buf, pos);
+	kfree(buf);
+	return ret;
+}
+static const struct file_operations mei_dbgfs_fops_rpm = {
+	.open = simple_open,
+	.read = mei_dbgfs_read_rpm,
+	.llseek = generic_file_llseek,
+};
+
 /**
  * mei_dbgfs_deregister - Remove the debugfs files and directories
  *
@@ -280,6 +319,18 @@ int mei_dbgfs_register(struct mei_device *dev, const char *name)
 		dev_err(dev->dev, "allow_fixed_address: registration failed\n");
 		goto err;
 	}
+	f = debugfs_create_file("rpm", S_IRUSR, dir,
+				dev, &mei_dbgfs_fops_rpm);
+	if (!f) {
+		dev_err(dev->dev, "rpm: registration failed\n");
+		goto err;
+	}
+	f = debugfs_create_bool("rpm_adaptive", S_IRUSR | S_IWUSR, dir,
+				&dev->rpm_adaptive);
+	if (!f) {
+		dev_err(dev->dev, "rpm_adaptive: registration failed\n");
+		goto err;
+	}
 	return 0;
 err:
 	mei_dbgfs_deregister(dev);
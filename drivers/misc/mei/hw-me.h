@@ -46,6 +46,7 @@ struct mei_cfg {
 	.driver_data = (kernel_ulong_t)(cfg),
 
 #define MEI_ME_RPM_TIMEOUT    500 /* ms */
+#define MEI_ME_RPM_ADAPT_MAX  5000 /* ms */
 
 /**
  * struct mei_me_hw - me hw specific data
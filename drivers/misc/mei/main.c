@@ -234,6 +234,8 @@ static ssize_t mei_read(struct file *file, char __user *ubuf,
 free:
 	mei_io_cb_free(cb);
 	*offset = 0;
+	/* room in the read ahead queue again */
+	mei_cl_read_ahead(cl, file);
 
 out:
 	cl_dbg(dev, cl, "end mei read rets = %zd\n", rets);
@@ -811,6 +813,41 @@ static ssize_t tx_queue_limit_store(struct device *device,
 }
 static DEVICE_ATTR_RW(tx_queue_limit);
 
+static ssize_t rx_queue_limit_show(struct device *device,
+				   struct device_attribute *attr, char *buf)
+{
+	struct mei_device *dev = dev_get_drvdata(device);
+	u8 size = 0;
+
+	mutex_lock(&dev->device_lock);
+	size = dev->rx_queue_limit;
+	mutex_unlock(&dev->device_lock);
+
+	return snprintf(buf, PAGE_SIZE, "%u\n", size);
+}
+
+static ssize_t rx_queue_limit_store(struct device *device,
+				    struct device_attribute *attr,
+				    const char *buf, size_t count)
+{
+	struct mei_device *dev = dev_get_drvdata(device);
+	unsigned int inp;
+	int err;
+
+	err = kstrtouint(buf, 10, &inp);
+	if (err)
+		return err;
+	if (inp > MEI_RX_QUEUE_LIMIT_MAX)
+		return -EINVAL;
+
+	mutex_lock(&dev->device_lock);
+	dev->rx_queue_limit = inp;
+	mutex_unlock(&dev->device_lock);
+
+	return count;
+}
+static DEVICE_ATTR_RW(rx_queue_limit);
+
 /**
  * fw_ver_show - display ME FW version
  *
@@ -843,6 +880,7 @@ static struct attribute *mei_attrs[] = {
 	&dev_attr_hbm_ver.attr,
 	&dev_attr_hbm_ver_drv.attr,
 	&dev_attr_tx_queue_limit.attr,
+	&dev_attr_rx_queue_limit.attr,
 	&dev_attr_fw_ver.attr,
 	NULL
 };
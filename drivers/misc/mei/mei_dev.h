@@ -246,6 +246,30 @@ struct mei_cl {
 #define MEI_TX_QUEUE_LIMIT_MAX 255
 #define MEI_TX_QUEUE_LIMIT_MIN 30
 
+#define MEI_RX_QUEUE_LIMIT_DEFAULT 0
+#define MEI_RX_QUEUE_LIMIT_MAX 32
+
+/**
+ * struct mei_rpm_stats - runtime power gating statistics
+ *
+ * @resumes: number of runtime resumes
+ * @resume_ns_last: duration of the last resume
+ * @resume_ns_max: longest resume
+ * @resume_ns_total: time spent in all resumes
+ * @suspended_at: time of the last runtime suspend
+ * @suspended_ms_last: time spent suspended before the last resume
+ * @delay_ms: autosuspend delay currently in use
+ */
+struct mei_rpm_stats {
+	unsigned long resumes;
+	u64 resume_ns_last;
+	u64 resume_ns_max;
+	u64 resume_ns_total;
+	ktime_t suspended_at;
+	s64 suspended_ms_last;
+	unsigned int delay_ms;
+};
+
 /**
  * struct mei_hw_ops - hw specific ops
  *
@@ -384,6 +408,7 @@ struct mei_fw_version {
  * @ctrl_wr_list : pending control write list
  * @ctrl_rd_list : pending control read list
  * @tx_queue_limit: tx queues per client linit
+ * @rx_queue_limit: messages read ahead per client, 0 to read on demand
  *
  * @file_list   : list of opened handles
  * @open_handle_count: number of opened handles
@@ -404,6 +429,8 @@ struct mei_fw_version {
  *
  * @pg_event    : power gating event
  * @pg_domain   : runtime PM domain
+ * @rpm_stats   : runtime power gating statistics
+ * @rpm_adaptive : adapt the autosuspend delay to the traffic cadence
  *
  * @rd_msg_buf  : control messages buffer
  * @rd_msg_hdr  : read message header storage
@@ -451,6 +478,7 @@ struct mei_device {
 	struct list_head ctrl_wr_list;
 	struct list_head ctrl_rd_list;
 	u8 tx_queue_limit;
+	u8 rx_queue_limit;
 
 	struct list_head file_list;
 	long open_handle_count;
@@ -481,6 +509,8 @@ struct mei_device {
 #ifdef CONFIG_PM
 	struct dev_pm_domain pg_domain;
 #endif /* CONFIG_PM */
+	struct mei_rpm_stats rpm_stats;
+	bool rpm_adaptive;
 
 	unsigned char rd_msg_buf[MEI_RD_MSG_BUF_SIZE];
 	u32 rd_msg_hdr;
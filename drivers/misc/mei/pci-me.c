@@ -219,6 +219,7 @@ static int mei_me_probe(struct pci_dev *pdev, const struct pci_device_id *ent)
 
 	pm_runtime_set_autosuspend_delay(&pdev->dev, MEI_ME_RPM_TIMEOUT);
 	pm_runtime_use_autosuspend(&pdev->dev);
+	dev->rpm_stats.delay_ms = MEI_ME_RPM_TIMEOUT;
 
 	err = mei_register(dev, &pdev->dev);
 	if (err)
@@ -416,6 +417,9 @@ static int mei_me_pm_runtime_suspend(struct device *device)
 	else
 		ret = -EAGAIN;
 
+	if (!ret)
+		dev->rpm_stats.suspended_at = ktime_get();
+
 	mutex_unlock(&dev->device_lock);
 
 	dev_dbg(&pdev->dev, "rpm: me: runtime suspend ret=%d\n", ret);
@@ -426,10 +430,50 @@ static int mei_me_pm_runtime_suspend(struct device *device)
 	return ret;
 }
 
+/**
+ * mei_me_rpm_adapt - adapt the autosuspend delay to the traffic cadence
+ *
+ * @pdev: pci device
+ * @dev: mei device
+ *
+ * Periodic traffic, such as HDCP and PAVP keep-alives, that comes in just
+ * after the device went idle pays a power gating exit on every message.
+ * When the device is woken up within the maximal delay since it was last
+ * busy, stretch the autosuspend delay over that period, plus a quarter
+ * for the jitter, so that the next message finds the device up. Once the
+ * traffic stops, the delay is halved back to the default on every longer
+ * sleep.
+ */
+static void mei_me_rpm_adapt(struct pci_dev *pdev, struct mei_device *dev)
+{
+	struct mei_rpm_stats *st = &dev->rpm_stats;
+	s64 period = st->delay_ms + st->suspended_ms_last;
+	unsigned int delay = MEI_ME_RPM_TIMEOUT;
+
+	if (dev->rpm_adaptive) {
+		if (period <= MEI_ME_RPM_ADAPT_MAX)
+			delay = period + period / 4;
+		else
+			delay = st->delay_ms / 2;
+
+		delay = clamp_t(unsigned int, delay, MEI_ME_RPM_TIMEOUT,
+				MEI_ME_RPM_ADAPT_MAX);
+	}
+
+	if (delay == st->delay_ms)
+		return;
+
+	st->delay_ms = delay;
+	pm_runtime_set_autosuspend_delay(&pdev->dev, delay);
+}
+
 static int mei_me_pm_runtime_resume(struct device *device)
 {
 	struct pci_dev *pdev = to_pci_dev(device);
 	struct mei_device *dev;
+	struct mei_rpm_stats *st;
+	ktime_t start;
+	u64 ns;
 	int ret;
 
 	dev_dbg(&pdev->dev, "rpm: me: runtime resume\n");
@@ -440,8 +484,20 @@ static int mei_me_pm_runtime_resume(struct device *device)
 
 	mutex_lock(&dev->device_lock);
 
+	start = ktime_get();
 	ret = mei_me_pg_exit_sync(dev);
 
+	st = &dev->rpm_stats;
+	if (!ret) {
+		ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+		st->resumes++;
+		st->resume_ns_last = ns;
+		st->resume_ns_total += ns;
+		st->resume_ns_max = max(st->resume_ns_max, ns);
+		st->suspended_ms_last = ktime_ms_delta(start, st->suspended_at);
+		mei_me_rpm_adapt(pdev, dev);
+	}
+
 	mutex_unlock(&dev->device_lock);
 
 	dev_dbg(&pdev->dev, "rpm: me: runtime resume ret = %d\n", ret);
@@ -23,6 +23,7 @@
 #include <linux/mii.h>
 #include <linux/mdio.h>
 #include <linux/pm_qos.h>
+#include <net/xdp.h>
 #include "hw.h"
 
 struct e1000_info;
@@ -137,12 +138,17 @@ struct e1000_buffer {
 			unsigned int segs;
 			unsigned int bytecount;
 			u16 mapped_as_page;
+			/* frame sent by XDP_TX or ndo_xdp_xmit, not an skb */
+			struct xdp_frame *xdpf;
 		};
 		/* Rx */
 		struct {
 			/* arrays of page information for packet split */
 			struct e1000_ps_page *ps_pages;
 			struct page *page;
+			/* half page handed to the hardware in XDP mode */
+			unsigned int page_offset;
+			u16 pagecnt_bias;
 		};
 	};
 };
@@ -170,6 +176,8 @@ struct e1000_ring {
 	int set_itr;
 
 	struct sk_buff *rx_skb_top;
+
+	struct xdp_rxq_info xdp_rxq;
 };
 
 /* PHY register snapshot values */
@@ -254,6 +262,7 @@ struct e1000_adapter {
 	void (*alloc_rx_buf)(struct e1000_ring *ring, int cleaned_count,
 			     gfp_t gfp);
 	struct e1000_ring *rx_ring;
+	struct bpf_prog *xdp_prog;
 
 	u32 rx_int_delay;
 	u32 rx_abs_int_delay;
@@ -25,6 +25,9 @@
 #include <linux/pm_runtime.h>
 #include <linux/aer.h>
 #include <linux/prefetch.h>
+#include <linux/bpf.h>
+#include <linux/bpf_trace.h>
+#include <linux/filter.h>
 
 #include "e1000.h"
 
@@ -890,6 +893,112 @@ static void e1000_alloc_jumbo_rx_buffers(struct e1000_ring *rx_ring,
 	}
 }
 
+/* Receive buffers are half pages while an XDP program is attached: the
+ * frame is preceded by headroom for the program and the xdp_frame, and
+ * followed by room for the skb_shared_info of build_skb().
+ */
+#define E1000_XDP_PAD		(NET_SKB_PAD + NET_IP_ALIGN)
+#define E1000_XDP_TRUESIZE	2048
+#define E1000_RX_DMA_ATTR \
+	(DMA_ATTR_SKIP_CPU_SYNC | DMA_ATTR_WEAK_ORDERING)
+
+/**
+ * e1000_alloc_mapped_page - Allocate and map a page for XDP receives
+ * @adapter: board private structure
+ * @buffer_info: buffer to attach the page to
+ * @gfp: flags for allocation
+ **/
+static bool e1000_alloc_mapped_page(struct e1000_adapter *adapter,
+				    struct e1000_buffer *buffer_info, gfp_t gfp)
+{
+	struct pci_dev *pdev = adapter->pdev;
+	struct page *page;
+	dma_addr_t dma;
+
+	page = __dev_alloc_page(gfp);
+	if (unlikely(!page)) {
+		adapter->alloc_rx_buff_failed++;
+		return false;
+	}
+
+	dma = dma_map_page_attrs(&pdev->dev, page, 0, PAGE_SIZE,
+				 DMA_FROM_DEVICE, E1000_RX_DMA_ATTR);
+	if (dma_mapping_error(&pdev->dev, dma)) {
+		__free_page(page);
+		adapter->rx_dma_failed++;
+		return false;
+	}
+
+	buffer_info->dma = dma;
+	buffer_info->page = page;
+	buffer_info->page_offset = E1000_XDP_PAD;
+	/* take references in bulk so that handing a half page to the stack
+	 * is not an atomic operation
+	 */
+	page_ref_add(page, USHRT_MAX - 1);
+	buffer_info->pagecnt_bias = USHRT_MAX;
+
+	return true;
+}
+
+/**
+ * e1000_alloc_rx_buffers_xdp - Replace used receive buffers; XDP
+ * @rx_ring: Rx descriptor ring
+ * @cleaned_count: number of buffers to allocate this pass
+ *
+ * Buffers still holding a recycled page are handed back to the hardware
+ * as they are, so the page allocator is seldom involved.
+ **/
+static void e1000_alloc_rx_buffers_xdp(struct e1000_ring *rx_ring,
+				       int cleaned_count, gfp_t gfp)
+{
+	struct e1000_adapter *adapter = rx_ring->adapter;
+	struct pci_dev *pdev = adapter->pdev;
+	union e1000_rx_desc_extended *rx_desc;
+	struct e1000_buffer *buffer_info;
+	dma_addr_t dma;
+	unsigned int i;
+
+	i = rx_ring->next_to_use;
+	buffer_info = &rx_ring->buffer_info[i];
+
+	while (cleaned_count--) {
+		if (!buffer_info->page &&
+		    !e1000_alloc_mapped_page(adapter, buffer_info, gfp))
+			break;
+
+		dma_sync_single_range_for_device(&pdev->dev, buffer_info->dma,
+						 buffer_info->page_offset,
+						 adapter->rx_buffer_len,
+						 DMA_FROM_DEVICE);
+
+		rx_desc = E1000_RX_DESC_EXT(*rx_ring, i);
+		dma = buffer_info->dma + buffer_info->page_offset;
+		rx_desc->read.buffer_addr = cpu_to_le64(dma);
+
+		if (unlikely(++i == rx_ring->count))
+			i = 0;
+		buffer_info = &rx_ring->buffer_info[i];
+	}
+
+	if (likely(rx_ring->next_to_use != i)) {
+		rx_ring->next_to_use = i;
+		if (unlikely(i-- == 0))
+			i = (rx_ring->count - 1);
+
+		/* Force memory writes to complete before letting h/w
+		 * know there are new descriptors to fetch.  (Only
+		 * applicable for weak-ordered memory model archs,
+		 * such as IA-64).
+		 */
+		wmb();
+		if (adapter->flags2 & FLAG2_PCIM2PCI_ARBITER_WA)
+			e1000e_update_rdt_wa(rx_ring, i);
+		else
+			writel(i, rx_ring->tail);
+	}
+}
+
 static inline void e1000_rx_hash(struct net_device *netdev, __le32 rss,
 				 struct sk_buff *skb)
 {
@@ -1074,6 +1183,10 @@ static void e1000_put_txbuf(struct e1000_ring *tx_ring,
 			dev_consume_skb_any(buffer_info->skb);
 		buffer_info->skb = NULL;
 	}
+	if (buffer_info->xdpf) {
+		xdp_return_frame(buffer_info->xdpf);
+		buffer_info->xdpf = NULL;
+	}
 	buffer_info->time_stamp = 0;
 }
 
@@ -1666,6 +1779,385 @@ static bool e1000_clean_jumbo_rx_irq(struct e1000_ring *rx_ring, int *work_done,
 	return cleaned;
 }
 
+#define E1000_XDP_PASS		0
+#define E1000_XDP_CONSUMED	BIT(0)
+#define E1000_XDP_TX		BIT(1)
+#define E1000_XDP_REDIR		BIT(2)
+
+/**
+ * e1000_xdp_ring_xmit - Place an XDP frame on the Tx ring
+ * @tx_ring: Tx descriptor ring
+ * @xdpf: frame to send
+ *
+ * The Tx ring is shared with the stack, so the caller must hold the lock
+ * of Tx queue 0.  The tail is left to e1000_xdp_ring_update_tail().
+ **/
+static unsigned int e1000_xdp_ring_xmit(struct e1000_ring *tx_ring,
+					struct xdp_frame *xdpf)
+{
+	struct e1000_adapter *adapter = tx_ring->adapter;
+	struct pci_dev *pdev = adapter->pdev;
+	struct e1000_buffer *buffer_info;
+	struct e1000_tx_desc *tx_desc;
+	unsigned int i = tx_ring->next_to_use;
+	u32 len = xdpf->len;
+	dma_addr_t dma;
+
+	/* The minimum packet size with TCTL.PSP set is 17 bytes, and
+	 * e1000_xmit_frame() keeps a two descriptor gap to the head
+	 */
+	if (unlikely(len < 17 || len > adapter->tx_fifo_limit))
+		return E1000_XDP_CONSUMED;
+	if (e1000_desc_unused(tx_ring) < 3)
+		return E1000_XDP_CONSUMED;
+
+	dma = dma_map_single(&pdev->dev, xdpf->data, len, DMA_TO_DEVICE);
+	if (dma_mapping_error(&pdev->dev, dma)) {
+		adapter->tx_dma_failed++;
+		return E1000_XDP_CONSUMED;
+	}
+
+	buffer_info = &tx_ring->buffer_info[i];
+	buffer_info->dma = dma;
+	buffer_info->length = len;
+	buffer_info->time_stamp = jiffies;
+	buffer_info->next_to_watch = i;
+	buffer_info->mapped_as_page = false;
+	buffer_info->segs = 1;
+	buffer_info->bytecount = len;
+	buffer_info->xdpf = xdpf;
+
+	tx_desc = E1000_TX_DESC(*tx_ring, i);
+	tx_desc->buffer_addr = cpu_to_le64(dma);
+	tx_desc->lower.data = cpu_to_le32(adapter->txd_cmd | len);
+	tx_desc->upper.data = 0;
+
+	if (++i == tx_ring->count)
+		i = 0;
+	tx_ring->next_to_use = i;
+
+	return E1000_XDP_TX;
+}
+
+static void e1000_xdp_ring_update_tail(struct e1000_ring *tx_ring)
+{
+	struct e1000_adapter *adapter = tx_ring->adapter;
+
+	/* Force memory writes to complete before letting h/w
+	 * know there are new descriptors to fetch.
+	 */
+	wmb();
+	if (adapter->flags2 & FLAG2_PCIM2PCI_ARBITER_WA)
+		e1000e_update_tdt_wa(tx_ring, tx_ring->next_to_use);
+	else
+		writel(tx_ring->next_to_use, tx_ring->tail);
+	mmiowb();
+}
+
+static unsigned int e1000_xdp_tx(struct e1000_adapter *adapter,
+				 struct xdp_buff *xdp)
+{
+	struct netdev_queue *txq = netdev_get_tx_queue(adapter->netdev, 0);
+	struct xdp_frame *xdpf = convert_to_xdp_frame(xdp);
+	unsigned int result;
+
+	if (unlikely(!xdpf))
+		return E1000_XDP_CONSUMED;
+
+	__netif_tx_lock(txq, smp_processor_id());
+	result = e1000_xdp_ring_xmit(adapter->tx_ring, xdpf);
+	__netif_tx_unlock(txq);
+
+	return result;
+}
+
+static void e1000_xdp_tx_flush(struct e1000_adapter *adapter)
+{
+	struct netdev_queue *txq = netdev_get_tx_queue(adapter->netdev, 0);
+
+	__netif_tx_lock(txq, smp_processor_id());
+	e1000_xdp_ring_update_tail(adapter->tx_ring);
+	__netif_tx_unlock(txq);
+}
+
+/**
+ * e1000_run_xdp - Run the XDP program on a received frame
+ * @adapter: board private structure
+ * @xdp: buffer holding the frame
+ **/
+static unsigned int e1000_run_xdp(struct e1000_adapter *adapter,
+				  struct xdp_buff *xdp)
+{
+	unsigned int result = E1000_XDP_PASS;
+	struct bpf_prog *xdp_prog;
+	u32 act;
+
+	rcu_read_lock();
+	xdp_prog = READ_ONCE(adapter->xdp_prog);
+	if (!xdp_prog)
+		goto out;
+
+	act = bpf_prog_run_xdp(xdp_prog, xdp);
+	switch (act) {
+	case XDP_PASS:
+		break;
+	case XDP_TX:
+		result = e1000_xdp_tx(adapter, xdp);
+		break;
+	case XDP_REDIRECT:
+		if (xdp_do_redirect(adapter->netdev, xdp, xdp_prog))
+			result = E1000_XDP_CONSUMED;
+		else
+			result = E1000_XDP_REDIR;
+		break;
+	default:
+		bpf_warn_invalid_xdp_action(act);
+		/* fall through */
+	case XDP_ABORTED:
+		trace_xdp_exception(adapter->netdev, xdp_prog, act);
+		/* fall through */
+	case XDP_DROP:
+		result = E1000_XDP_CONSUMED;
+		break;
+	}
+out:
+	rcu_read_unlock();
+	return result;
+}
+
+/**
+ * e1000_can_reuse_rx_page - Check whether the other half page is free
+ * @buffer_info: buffer whose page_offset already points to that half
+ *
+ * With small pages the two halves alternate, one owned by the hardware
+ * while the stack or the Tx ring still uses the other one.  Larger pages
+ * are walked through once.
+ **/
+static bool e1000_can_reuse_rx_page(struct e1000_buffer *buffer_info)
+{
+	unsigned int pagecnt_bias = buffer_info->pagecnt_bias;
+	struct page *page = buffer_info->page;
+
+	/* don't keep remote pages or pages from the emergency reserves */
+	if (unlikely(page_to_nid(page) != numa_mem_id() ||
+		     page_is_pfmemalloc(page)))
+		return false;
+
+#if (PAGE_SIZE < 8192)
+	if (unlikely((page_count(page) - pagecnt_bias) > 1))
+		return false;
+#else
+#define E1000_XDP_LAST_OFFSET \
+	(PAGE_SIZE - E1000_XDP_TRUESIZE + E1000_XDP_PAD)
+	if (buffer_info->page_offset > E1000_XDP_LAST_OFFSET)
+		return false;
+#endif
+
+	/* restock the references before the bias runs out */
+	if (unlikely(pagecnt_bias == 1)) {
+		page_ref_add(page, USHRT_MAX - 1);
+		buffer_info->pagecnt_bias = USHRT_MAX;
+	}
+
+	return true;
+}
+
+/**
+ * e1000_put_rx_page - Give the current half page away
+ * @adapter: board private structure
+ * @buffer_info: buffer the frame was received in
+ *
+ * The frame now belongs to an skb or an xdp_frame.  Move the buffer to the
+ * next half of the page, or release the page if that half is not free.
+ **/
+static void e1000_put_rx_page(struct e1000_adapter *adapter,
+			      struct e1000_buffer *buffer_info)
+{
+	buffer_info->pagecnt_bias--;
+#if (PAGE_SIZE < 8192)
+	buffer_info->page_offset ^= E1000_XDP_TRUESIZE;
+#else
+	buffer_info->page_offset += E1000_XDP_TRUESIZE;
+#endif
+
+	if (e1000_can_reuse_rx_page(buffer_info))
+		return;
+
+	dma_unmap_page_attrs(&adapter->pdev->dev, buffer_info->dma, PAGE_SIZE,
+			     DMA_FROM_DEVICE, E1000_RX_DMA_ATTR);
+	__page_frag_cache_drain(buffer_info->page, buffer_info->pagecnt_bias);
+	buffer_info->page = NULL;
+	buffer_info->dma = 0;
+}
+
+static struct sk_buff *e1000_build_skb_xdp(struct xdp_buff *xdp)
+{
+	unsigned int metasize = xdp->data - xdp->data_meta;
+	struct sk_buff *skb;
+
+	skb = build_skb(xdp->data_hard_start, E1000_XDP_TRUESIZE);
+	if (unlikely(!skb))
+		return NULL;
+
+	skb_reserve(skb, xdp->data - xdp->data_hard_start);
+	__skb_put(skb, xdp->data_end - xdp->data);
+	if (metasize)
+		skb_metadata_set(skb, metasize);
+
+	return skb;
+}
+
+/**
+ * e1000_clean_rx_irq_xdp - Run XDP and send received data up the stack
+ * @rx_ring: Rx descriptor ring
+ *
+ * the return value indicates whether actual cleaning was done, there
+ * is no guarantee that everything was cleaned
+ **/
+static bool e1000_clean_rx_irq_xdp(struct e1000_ring *rx_ring, int *work_done,
+				   int work_to_do)
+{
+	struct e1000_adapter *adapter = rx_ring->adapter;
+	struct net_device *netdev = adapter->netdev;
+	struct pci_dev *pdev = adapter->pdev;
+	struct e1000_hw *hw = &adapter->hw;
+	union e1000_rx_desc_extended *rx_desc, *next_rxd;
+	struct e1000_buffer *buffer_info, *next_buffer;
+	u32 length, staterr;
+	unsigned int i;
+	int cleaned_count = 0;
+	bool cleaned = false;
+	unsigned int total_rx_bytes = 0, total_rx_packets = 0;
+	unsigned int xdp_xmit = 0;
+	struct xdp_buff xdp;
+
+	xdp.rxq = &rx_ring->xdp_rxq;
+
+	i = rx_ring->next_to_clean;
+	rx_desc = E1000_RX_DESC_EXT(*rx_ring, i);
+	staterr = le32_to_cpu(rx_desc->wb.upper.status_error);
+	buffer_info = &rx_ring->buffer_info[i];
+
+	while (staterr & E1000_RXD_STAT_DD) {
+		struct sk_buff *skb;
+		unsigned int act;
+
+		if (*work_done >= work_to_do)
+			break;
+		(*work_done)++;
+		dma_rmb();	/* read descriptor and rx_buffer_info after status DD */
+
+		i++;
+		if (i == rx_ring->count)
+			i = 0;
+		next_rxd = E1000_RX_DESC_EXT(*rx_ring, i);
+		prefetch(next_rxd);
+
+		next_buffer = &rx_ring->buffer_info[i];
+
+		cleaned = true;
+		cleaned_count++;
+
+		length = le16_to_cpu(rx_desc->wb.upper.length);
+
+		/* Jumbo frames are refused while XDP is on, so toss frames
+		 * that consumed multiple buffers like e1000_clean_rx_irq().
+		 * Tossed frames leave the buffer in place for reuse.
+		 */
+		if (unlikely(!(staterr & E1000_RXD_STAT_EOP)))
+			adapter->flags2 |= FLAG2_IS_DISCARDING;
+
+		if (adapter->flags2 & FLAG2_IS_DISCARDING) {
+			e_dbg("Receive packet consumed multiple buffers\n");
+			if (staterr & E1000_RXD_STAT_EOP)
+				adapter->flags2 &= ~FLAG2_IS_DISCARDING;
+			goto next_desc;
+		}
+
+		if (unlikely((staterr & E1000_RXDEXT_ERR_FRAME_ERR_MASK) &&
+			     !(netdev->features & NETIF_F_RXALL)))
+			goto next_desc;
+
+		dma_sync_single_range_for_cpu(&pdev->dev, buffer_info->dma,
+					      buffer_info->page_offset, length,
+					      DMA_FROM_DEVICE);
+
+		/* adjust length to remove Ethernet CRC */
+		if (!(adapter->flags2 & FLAG2_CRC_STRIPPING)) {
+			if (netdev->features & NETIF_F_RXFCS)
+				total_rx_bytes -= 4;
+			else
+				length -= 4;
+		}
+
+		xdp.data = page_address(buffer_info->page) +
+			   buffer_info->page_offset;
+		xdp.data_meta = xdp.data;
+		xdp.data_hard_start = xdp.data - E1000_XDP_PAD;
+		xdp.data_end = xdp.data + length;
+		prefetch(xdp.data);
+
+		act = e1000_run_xdp(adapter, &xdp);
+		if (act != E1000_XDP_PASS) {
+			if (act & (E1000_XDP_TX | E1000_XDP_REDIR)) {
+				xdp_xmit |= act;
+				e1000_put_rx_page(adapter, buffer_info);
+			}
+			total_rx_bytes += length;
+			total_rx_packets++;
+			goto next_desc;
+		}
+
+		skb = e1000_build_skb_xdp(&xdp);
+		if (unlikely(!skb)) {
+			adapter->alloc_rx_buff_failed++;
+			goto next_desc;
+		}
+		e1000_put_rx_page(adapter, buffer_info);
+
+		total_rx_bytes += length;
+		total_rx_packets++;
+
+		/* Receive Checksum Offload */
+		e1000_rx_checksum(adapter, staterr, skb);
+
+		e1000_rx_hash(netdev, rx_desc->wb.lower.hi_dword.rss, skb);
+
+		e1000_receive_skb(adapter, netdev, skb, staterr,
+				  rx_desc->wb.upper.vlan);
+
+next_desc:
+		rx_desc->wb.upper.status_error &= cpu_to_le32(~0xFF);
+
+		/* return some buffers to hardware, one at a time is too slow */
+		if (cleaned_count >= E1000_RX_BUFFER_WRITE) {
+			adapter->alloc_rx_buf(rx_ring, cleaned_count,
+					      GFP_ATOMIC);
+			cleaned_count = 0;
+		}
+
+		/* use prefetched values */
+		rx_desc = next_rxd;
+		buffer_info = next_buffer;
+
+		staterr = le32_to_cpu(rx_desc->wb.upper.status_error);
+	}
+	rx_ring->next_to_clean = i;
+
+	if (xdp_xmit & E1000_XDP_REDIR)
+		xdp_do_flush_map();
+	if (xdp_xmit & E1000_XDP_TX)
+		e1000_xdp_tx_flush(adapter);
+
+	cleaned_count = e1000_desc_unused(rx_ring);
+	if (cleaned_count)
+		adapter->alloc_rx_buf(rx_ring, cleaned_count, GFP_ATOMIC);
+
+	adapter->total_rx_bytes += total_rx_bytes;
+	adapter->total_rx_packets += total_rx_packets;
+	return cleaned;
+}
+
 /**
  * e1000_clean_rx_ring - Free Rx Buffers per Queue
  * @rx_ring: Rx descriptor ring
@@ -1693,11 +2185,20 @@ static void e1000_clean_rx_ring(struct e1000_ring *rx_ring)
 				dma_unmap_single(&pdev->dev, buffer_info->dma,
 						 adapter->rx_ps_bsize0,
 						 DMA_FROM_DEVICE);
+			else if (adapter->clean_rx == e1000_clean_rx_irq_xdp)
+				dma_unmap_page_attrs(&pdev->dev,
+						     buffer_info->dma,
+						     PAGE_SIZE, DMA_FROM_DEVICE,
+						     E1000_RX_DMA_ATTR);
 			buffer_info->dma = 0;
 		}
 
 		if (buffer_info->page) {
-			put_page(buffer_info->page);
+			if (adapter->clean_rx == e1000_clean_rx_irq_xdp)
+				__page_frag_cache_drain(buffer_info->page,
+					buffer_info->pagecnt_bias);
+			else
+				put_page(buffer_info->page);
 			buffer_info->page = NULL;
 		}
 
@@ -2640,6 +3141,9 @@ static int e1000_alloc_queues(struct e1000_adapter *adapter)
 	adapter->rx_ring->count = adapter->rx_ring_count;
 	adapter->rx_ring->adapter = adapter;
 
+	if (xdp_rxq_info_reg(&adapter->rx_ring->xdp_rxq, adapter->netdev, 0))
+		goto err;
+
 	return 0;
 err:
 	e_err("Unable to allocate memory for queues\n");
@@ -3186,7 +3690,11 @@ static void e1000_configure_rx(struct e1000_adapter *adapter)
 	u64 rdba;
 	u32 rdlen, rctl, rxcsum, ctrl_ext;
 
-	if (adapter->rx_ps_pages) {
+	if (adapter->xdp_prog) {
+		rdlen = rx_ring->count * sizeof(union e1000_rx_desc_extended);
+		adapter->clean_rx = e1000_clean_rx_irq_xdp;
+		adapter->alloc_rx_buf = e1000_alloc_rx_buffers_xdp;
+	} else if (adapter->rx_ps_pages) {
 		/* this is a 32 byte descriptor */
 		rdlen = rx_ring->count *
 		    sizeof(union e1000_rx_desc_packet_split);
@@ -5994,6 +6502,12 @@ static int e1000_change_mtu(struct net_device *netdev, int new_mtu)
 		return -EINVAL;
 	}
 
+	/* XDP receive buffers are half pages */
+	if (new_mtu > ETH_DATA_LEN && adapter->xdp_prog) {
+		e_err("Jumbo Frames not supported while XDP program is loaded.\n");
+		return -EINVAL;
+	}
+
 	/* Jumbo frame workaround on 82579 and newer requires CRC be stripped */
 	if ((adapter->hw.mac.type >= e1000_pch2lan) &&
 	    !(adapter->flags2 & FLAG2_CRC_STRIPPING) &&
@@ -6988,6 +7502,98 @@ static int e1000_set_features(struct net_device *netdev,
 	return 0;
 }
 
+/**
+ * e1000_xdp_setup - Attach or detach an XDP program
+ * @netdev: network interface device structure
+ * @bpf: XDP_SETUP_PROG command
+ **/
+static int e1000_xdp_setup(struct net_device *netdev, struct netdev_bpf *bpf)
+{
+	struct e1000_adapter *adapter = netdev_priv(netdev);
+	struct bpf_prog *old_prog;
+	bool need_reset;
+
+	BUILD_BUG_ON(E1000_XDP_PAD + VLAN_ETH_FRAME_LEN + ETH_FCS_LEN >
+		     SKB_WITH_OVERHEAD(E1000_XDP_TRUESIZE));
+
+	/* Frames have to fit in the half page of a single buffer */
+	if (bpf->prog &&
+	    adapter->max_frame_size > VLAN_ETH_FRAME_LEN + ETH_FCS_LEN) {
+		NL_SET_ERR_MSG_MOD(bpf->extack, "MTU too large for XDP");
+		return -EINVAL;
+	}
+
+	/* Switching between the skb and the XDP Rx path needs a reset */
+	need_reset = !!adapter->xdp_prog != !!bpf->prog;
+	old_prog = xchg(&adapter->xdp_prog, bpf->prog);
+
+	if (need_reset && netif_running(netdev))
+		e1000e_reinit_locked(adapter);
+
+	if (old_prog)
+		bpf_prog_put(old_prog);
+
+	return 0;
+}
+
+static int e1000_xdp(struct net_device *netdev, struct netdev_bpf *xdp)
+{
+	struct e1000_adapter *adapter = netdev_priv(netdev);
+
+	switch (xdp->command) {
+	case XDP_SETUP_PROG:
+		return e1000_xdp_setup(netdev, xdp);
+	case XDP_QUERY_PROG:
+		xdp->prog_id = adapter->xdp_prog ?
+			       adapter->xdp_prog->aux->id : 0;
+		return 0;
+	default:
+		return -EINVAL;
+	}
+}
+
+/**
+ * e1000_xdp_xmit - Send frames redirected to this device
+ * @netdev: network interface device structure
+ * @n: number of frames
+ * @frames: frames to send
+ * @flags: XDP_XMIT_FLUSH to bump the tail right away
+ *
+ * Returns the number of frames queued, the others are freed.
+ **/
+static int e1000_xdp_xmit(struct net_device *netdev, int n,
+			  struct xdp_frame **frames, u32 flags)
+{
+	struct e1000_adapter *adapter = netdev_priv(netdev);
+	struct e1000_ring *tx_ring = adapter->tx_ring;
+	struct netdev_queue *txq;
+	int drops = 0;
+	int i;
+
+	if (test_bit(__E1000_DOWN, &adapter->state))
+		return -ENETDOWN;
+
+	if (unlikely(flags & ~XDP_XMIT_FLAGS_MASK))
+		return -EINVAL;
+
+	txq = netdev_get_tx_queue(netdev, 0);
+	__netif_tx_lock(txq, smp_processor_id());
+
+	for (i = 0; i < n; i++) {
+		if (e1000_xdp_ring_xmit(tx_ring, frames[i]) != E1000_XDP_TX) {
+			xdp_return_frame_rx_napi(frames[i]);
+			drops++;
+		}
+	}
+
+	if (flags & XDP_XMIT_FLUSH)
+		e1000_xdp_ring_update_tail(tx_ring);
+
+	__netif_tx_unlock(txq);
+
+	return n - drops;
+}
+
 static const struct net_device_ops e1000e_netdev_ops = {
 	.ndo_open		= e1000e_open,
 	.ndo_stop		= e1000e_close,
@@ -7008,6 +7614,8 @@ static const struct net_device_ops e1000e_netdev_ops = {
 	.ndo_set_features = e1000_set_features,
 	.ndo_fix_features = e1000_fix_features,
 	.ndo_features_check	= passthru_features_check,
+	.ndo_bpf		= e1000_xdp,
+	.ndo_xdp_xmit		= e1000_xdp_xmit,
 };
 
 /**
@@ -7342,6 +7950,7 @@ static int e1000_probe(struct pci_dev *pdev, const struct pci_device_id *ent)
 	if (hw->phy.ops.check_reset_block && !hw->phy.ops.check_reset_block(hw))
 		e1000_phy_hw_reset(&adapter->hw);
 err_hw_init:
+	xdp_rxq_info_unreg(&adapter->rx_ring->xdp_rxq);
 	kfree(adapter->tx_ring);
 	kfree(adapter->rx_ring);
 err_sw_init:
@@ -7413,6 +8022,7 @@ static void e1000_remove(struct pci_dev *pdev)
 	e1000e_release_hw_control(adapter);
 
 	e1000e_reset_interrupt_capability(adapter);
+	xdp_rxq_info_unreg(&adapter->rx_ring->xdp_rxq);
 	kfree(adapter->tx_ring);
 	kfree(adapter->rx_ring);
 
@@ -555,7 +555,8 @@ static void tun_flow_update(struct tun_struct *tun, u32 rxhash,
 
 /**
  * Save the hash received in the stack receive path and update the
- * flow_hash table accordingly.
+ * flow_hash table accordingly.  This is the hash get_rps_cpu() looks the
+ * flow up with, not the symmetric one used to index tun->flows.
  */
 static inline void tun_flow_save_rps_rxhash(struct tun_flow_entry *e, u32 hash)
 {
@@ -582,7 +583,7 @@ static u16 tun_automq_select_queue(struct tun_struct *tun, struct sk_buff *skb)
 	if (txq) {
 		e = tun_flow_find(&tun->flows[tun_hashfn(txq)], txq);
 		if (e) {
-			tun_flow_save_rps_rxhash(e, txq);
+			tun_flow_save_rps_rxhash(e, skb->hash);
 			txq = e->queue_index;
 		} else
 			/* use multiply and shift instead of expensive divide */
@@ -1053,7 +1054,7 @@ static void tun_automq_xmit(struct tun_struct *tun, struct sk_buff *skb)
 			e = tun_flow_find(&tun->flows[tun_hashfn(rxhash)],
 					rxhash);
 			if (e)
-				tun_flow_save_rps_rxhash(e, rxhash);
+				tun_flow_save_rps_rxhash(e, skb->hash);
 		}
 	}
 #endif
@@ -2142,6 +2143,18 @@ static void *tun_ring_recv(struct tun_file *tfile, int noblock, int *err)
 	return ptr;
 }
 
+/* Whoever reads a queue consumes the flows it carries, just like the
+ * caller of recvmsg() on a socket.  With vhost-net that is the vhost
+ * worker of the guest, so let RFS steer the flow to the worker's CPU.
+ */
+static inline void tun_rps_record_flow(const struct sk_buff *skb)
+{
+#ifdef CONFIG_RPS
+	if (static_key_false(&rfs_needed))
+		sock_rps_record_flow_hash(skb->hash);
+#endif
+}
+
 static ssize_t tun_do_read(struct tun_struct *tun, struct tun_file *tfile,
 			   struct iov_iter *to,
 			   int noblock, void *ptr)
@@ -2171,6 +2184,7 @@ static ssize_t tun_do_read(struct tun_struct *tun, struct tun_file *tfile,
 	} else {
 		struct sk_buff *skb = ptr;
 
+		tun_rps_record_flow(skb);
 		ret = tun_put_user(tun, tfile, skb, to);
 		if (unlikely(ret < 0))
 			kfree_skb(skb);
@@ -50,6 +50,9 @@ module_param(napi_tx, bool, 0644);
 
 #define VIRTNET_RX_PAD (NET_IP_ALIGN + NET_SKB_PAD)
 
+/* Used buffers fetched from the rx ring per virtqueue_get_bufs() call */
+#define VIRTNET_RX_BATCH 16
+
 /* Amount of XDP headroom to prepend to packets for use by xdp_adjust_head */
 #define VIRTIO_XDP_HEADROOM 256
 
@@ -1286,24 +1289,25 @@ static int virtnet_receive(struct receive_queue *rq, int budget,
 {
 	struct virtnet_info *vi = rq->vq->vdev->priv;
 	struct virtnet_rq_stats stats = {};
-	unsigned int len;
-	void *buf;
+	unsigned int lens[VIRTNET_RX_BATCH];
+	void *bufs[VIRTNET_RX_BATCH];
+	void *ctxs[VIRTNET_RX_BATCH];
+	bool use_ctx = !vi->big_packets || vi->mergeable_rx_bufs;
+	unsigned int n, j;
 	int i;
 
-	if (!vi->big_packets || vi->mergeable_rx_bufs) {
-		void *ctx;
+	while (stats.packets < budget) {
+		n = min_t(unsigned int, budget - stats.packets,
+			  VIRTNET_RX_BATCH);
+		n = virtqueue_get_bufs_ctx(rq->vq, bufs, lens,
+					   use_ctx ? ctxs : NULL, n);
+		if (!n)
+			break;
 
-		while (stats.packets < budget &&
-		       (buf = virtqueue_get_buf_ctx(rq->vq, &len, &ctx))) {
-			receive_buf(vi, rq, buf, len, ctx, xdp_xmit, &stats);
-			stats.packets++;
-		}
-	} else {
-		while (stats.packets < budget &&
-		       (buf = virtqueue_get_buf(rq->vq, &len)) != NULL) {
-			receive_buf(vi, rq, buf, len, NULL, xdp_xmit, &stats);
-			stats.packets++;
-		}
+		for (j = 0; j < n; j++)
+			receive_buf(vi, rq, bufs[j], lens[j],
+				    use_ctx ? ctxs[j] : NULL, xdp_xmit, &stats);
+		stats.packets += n;
 	}
 
 	if (rq->vq->num_free > virtqueue_get_vring_size(rq->vq) / 2) {
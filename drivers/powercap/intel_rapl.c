@@ -30,7 +30,10 @@
 #include <linux/cpu.h>
 #include <linux/powercap.h>
 #include <linux/suspend.h>
+#include <linux/cpufreq.h>
+#include <linux/workqueue.h>
 #include <asm/iosf_mbi.h>
+#include <drm/i915_drm.h>
 
 #include <asm/processor.h>
 #include <asm/cpu_device_id.h>
@@ -198,6 +201,13 @@ struct rapl_package {
 	int lead_cpu; /* one active cpu per package for access */
 	/* Track active cpus */
 	struct cpumask cpumask;
+#ifdef CONFIG_INTEL_RAPL_POWER_SHARE
+	/* PP0/PP1 limits and enables to restore, valid while ps_active */
+	u64 ps_saved_limit[2];
+	u64 ps_saved_enable[2];
+	bool ps_active;
+	unsigned int ps_gpu_share; /* permille of the budget given to PP1 */
+#endif
 };
 
 struct rapl_defaults {
@@ -1604,6 +1614,288 @@ static void power_limit_state_restore(void)
 	put_online_cpus();
 }
 
+#ifdef CONFIG_INTEL_RAPL_POWER_SHARE
+/*
+ * Package power sharing governor.
+ *
+ * Every power_share_interval_ms, the long term limit of each package (or
+ * its TDP if no limit is set) is split between the PP0 and PP1 domains in
+ * proportion to the average utilization of the package CPUs and to the
+ * share of time the i915 render engine was busy. The split is smoothed
+ * and neither domain gets less than power_share_min_pct of the budget.
+ * The package limit itself is left alone, so the sum of both domains may
+ * exceed what the package is allowed, the hardware still enforces that.
+ *
+ * While the governor runs it owns the PP0 and PP1 long term limits, which
+ * are restored when it is turned off.
+ */
+static unsigned int power_share_interval_ms = 100;
+module_param(power_share_interval_ms, uint, 0644);
+MODULE_PARM_DESC(power_share_interval_ms,
+		 "Power sharing governor sampling interval in ms");
+
+static unsigned int power_share_min_pct = 20;
+module_param(power_share_min_pct, uint, 0644);
+MODULE_PARM_DESC(power_share_min_pct,
+		 "Minimum share of the package budget given to PP0 and PP1");
+
+struct rapl_ps_cpu_sample {
+	u64 idle;
+	u64 wall;
+};
+static DEFINE_PER_CPU(struct rapl_ps_cpu_sample, rapl_ps_cpu_sample);
+
+static bool power_share;
+static bool rapl_ps_ready;	/* rapl_init() is done */
+static DEFINE_MUTEX(rapl_ps_lock);
+static bool (*rapl_ps_gpu_busy_time)(u64 *busy);
+static u64 rapl_ps_gpu_busy, rapl_ps_gpu_wall;
+
+static void rapl_ps_work_fn(struct work_struct *work);
+static DECLARE_DELAYED_WORK(rapl_ps_work, rapl_ps_work_fn);
+
+static struct rapl_domain *rapl_ps_domain(struct rapl_package *rp,
+					  enum rapl_domain_type id)
+{
+	struct rapl_domain *rd;
+
+	for (rd = rp->domains; rd < rp->domains + rp->nr_domains; rd++) {
+		if (rd->id == id && !(rd->state & DOMAIN_STATE_BIOS_LOCKED))
+			return rd;
+	}
+
+	return NULL;
+}
+
+/* the budget the package has, in uW */
+static u64 rapl_ps_budget(struct rapl_package *rp)
+{
+	struct rapl_domain *rd;
+	u64 val;
+
+	/* a package limit locked by BIOS is still a budget to share */
+	for (rd = rp->domains; rd < rp->domains + rp->nr_domains; rd++) {
+		if (rd->id == RAPL_DOMAIN_PACKAGE)
+			break;
+	}
+	if (rd == rp->domains + rp->nr_domains)
+		return 0;
+
+	if (!rapl_read_data_raw(rd, PL1_ENABLE, false, &val) && val &&
+	    !rapl_read_data_raw(rd, POWER_LIMIT1, true, &val) && val)
+		return val;
+
+	if (!rapl_read_data_raw(rd, THERMAL_SPEC_POWER, true, &val))
+		return val;
+
+	return 0;
+}
+
+/* average utilization of the CPUs of @rp since the last call, permille */
+static unsigned int rapl_ps_cpu_util(struct rapl_package *rp)
+{
+	u64 idle = 0, wall = 0;
+	int cpu;
+
+	for_each_cpu(cpu, &rp->cpumask) {
+		struct rapl_ps_cpu_sample *s = per_cpu_ptr(&rapl_ps_cpu_sample,
+							   cpu);
+		u64 cur_wall, cur_idle = get_cpu_idle_time(cpu, &cur_wall, 0);
+
+		if (s->wall && cur_wall > s->wall) {
+			idle += min(cur_idle - s->idle, cur_wall - s->wall);
+			wall += cur_wall - s->wall;
+		}
+		s->idle = cur_idle;
+		s->wall = cur_wall;
+	}
+
+	if (!wall)
+		return 0;
+
+	return 1000 - div64_u64(idle * 1000, wall);
+}
+
+/* share of time the render engine was busy since the last call, permille */
+static int rapl_ps_gpu_util(void)
+{
+	u64 busy, wall = ktime_get_ns();
+	int util = -1;
+
+	if (!rapl_ps_gpu_busy_time)
+		rapl_ps_gpu_busy_time = symbol_get(i915_gpu_busy_time);
+	if (!rapl_ps_gpu_busy_time || !rapl_ps_gpu_busy_time(&busy))
+		return -1;
+
+	if (rapl_ps_gpu_wall && wall > rapl_ps_gpu_wall)
+		util = min_t(u64, div64_u64((busy - rapl_ps_gpu_busy) * 1000,
+					    wall - rapl_ps_gpu_wall), 1000);
+	rapl_ps_gpu_busy = busy;
+	rapl_ps_gpu_wall = wall;
+
+	return util;
+}
+
+static void rapl_ps_set_limit(struct rapl_domain *rd, u64 limit)
+{
+	u64 cur;
+
+	if (!rapl_read_data_raw(rd, POWER_LIMIT1, true, &cur) && cur == limit)
+		return;
+
+	rapl_write_data_raw(rd, POWER_LIMIT1, limit);
+	rapl_write_data_raw(rd, PL1_ENABLE, 1);
+}
+
+static void rapl_ps_update_package(struct rapl_package *rp, int gpu_util)
+{
+	struct rapl_domain *rd[2] = {
+		rapl_ps_domain(rp, RAPL_DOMAIN_PP0),
+		rapl_ps_domain(rp, RAPL_DOMAIN_PP1),
+	};
+	unsigned int cpu_util = rapl_ps_cpu_util(rp);
+	unsigned int min_share, target;
+	u64 budget, gpu_limit;
+	int i;
+
+	if (!rd[0] || !rd[1] || gpu_util < 0)
+		return;
+
+	budget = rapl_ps_budget(rp);
+	if (!budget)
+		return;
+
+	if (!rp->ps_active) {
+		for (i = 0; i < 2; i++) {
+			rapl_read_data_raw(rd[i], POWER_LIMIT1, true,
+					   &rp->ps_saved_limit[i]);
+			rapl_read_data_raw(rd[i], PL1_ENABLE, false,
+					   &rp->ps_saved_enable[i]);
+		}
+		rp->ps_gpu_share = 500;
+		rp->ps_active = true;
+	}
+
+	/* split in proportion to demand, evenly when both are idle */
+	if (cpu_util + gpu_util < 50U)
+		target = 500;
+	else
+		target = gpu_util * 1000 / (cpu_util + gpu_util);
+
+	min_share = min(power_share_min_pct, 50U) * 10;
+	target = clamp(target, min_share, 1000 - min_share);
+	rp->ps_gpu_share = (rp->ps_gpu_share * 3 + target) / 4;
+
+	gpu_limit = div_u64(budget * rp->ps_gpu_share, 1000);
+	rapl_ps_set_limit(rd[0], budget - gpu_limit);
+	rapl_ps_set_limit(rd[1], gpu_limit);
+}
+
+static void rapl_ps_work_fn(struct work_struct *work)
+{
+	struct rapl_package *rp;
+	unsigned int interval;
+	int gpu_util;
+
+	get_online_cpus();
+	gpu_util = rapl_ps_gpu_util();
+	list_for_each_entry(rp, &rapl_packages, plist)
+		rapl_ps_update_package(rp, gpu_util);
+	put_online_cpus();
+
+	interval = max(power_share_interval_ms, 10U);
+	schedule_delayed_work(&rapl_ps_work, msecs_to_jiffies(interval));
+}
+
+static void rapl_ps_start(void)
+{
+	rapl_ps_gpu_wall = 0;
+	schedule_delayed_work(&rapl_ps_work, 0);
+}
+
+static void rapl_ps_stop(void)
+{
+	struct rapl_package *rp;
+	int i;
+
+	cancel_delayed_work_sync(&rapl_ps_work);
+
+	get_online_cpus();
+	list_for_each_entry(rp, &rapl_packages, plist) {
+		struct rapl_domain *rd[2] = {
+			rapl_ps_domain(rp, RAPL_DOMAIN_PP0),
+			rapl_ps_domain(rp, RAPL_DOMAIN_PP1),
+		};
+
+		if (!rp->ps_active)
+			continue;
+		for (i = 0; i < 2; i++) {
+			rapl_write_data_raw(rd[i], POWER_LIMIT1,
+					    rp->ps_saved_limit[i]);
+			rapl_write_data_raw(rd[i], PL1_ENABLE,
+					    rp->ps_saved_enable[i]);
+		}
+		rp->ps_active = false;
+	}
+	put_online_cpus();
+
+	if (rapl_ps_gpu_busy_time) {
+		/* a NULL outarg turns the engine busy stats back off */
+		rapl_ps_gpu_busy_time(NULL);
+		rapl_ps_gpu_busy_time = NULL;
+		symbol_put(i915_gpu_busy_time);
+	}
+}
+
+static int power_share_set(const char *val, const struct kernel_param *kp)
+{
+	bool old;
+	int ret;
+
+	mutex_lock(&rapl_ps_lock);
+	old = power_share;
+	ret = param_set_bool(val, kp);
+	if (!ret && rapl_ps_ready && power_share != old) {
+		if (power_share)
+			rapl_ps_start();
+		else
+			rapl_ps_stop();
+	}
+	mutex_unlock(&rapl_ps_lock);
+
+	return ret;
+}
+
+static const struct kernel_param_ops power_share_ops = {
+	.set = power_share_set,
+	.get = param_get_bool,
+};
+module_param_cb(power_share, &power_share_ops, &power_share, 0644);
+MODULE_PARM_DESC(power_share,
+		 "Share the package power budget between PP0 and PP1");
+
+static void rapl_power_share_init(void)
+{
+	mutex_lock(&rapl_ps_lock);
+	rapl_ps_ready = true;
+	if (power_share)
+		rapl_ps_start();
+	mutex_unlock(&rapl_ps_lock);
+}
+
+static void rapl_power_share_exit(void)
+{
+	mutex_lock(&rapl_ps_lock);
+	if (rapl_ps_ready && power_share)
+		rapl_ps_stop();
+	rapl_ps_ready = false;
+	mutex_unlock(&rapl_ps_lock);
+}
+#else
+static inline void rapl_power_share_init(void) { }
+static inline void rapl_power_share_exit(void) { }
+#endif /* CONFIG_INTEL_RAPL_POWER_SHARE */
+
 static int rapl_pm_callback(struct notifier_block *nb,
 	unsigned long mode, void *_unused)
 {
@@ -1654,6 +1946,8 @@ static int __init rapl_init(void)
 	if (ret)
 		goto err_unreg_all;
 
+	rapl_power_share_init();
+
 	return 0;
 
 err_unreg_all:
@@ -1666,6 +1960,7 @@ static int __init rapl_init(void)
 
 static void __exit rapl_exit(void)
 {
+	rapl_power_share_exit();
 	unregister_pm_notifier(&rapl_pm_notifier);
 	cpuhp_remove_state(pcap_rapl_online);
 	rapl_unregister_powercap();
@@ -676,6 +676,28 @@ static int sdw_register_slave(struct sdw_master *mstr)
 
 }
 
+static bool sdw_program_scp_addr_page(struct sdw_master *mstr,
+					struct sdw_msg *msg)
+{
+	struct sdw_slv_capabilities *slv_cap;
+
+	/* If we are enumerating slave address 0,
+	 * we dont program scp, it should be set
+	 * default to 0
+	 */
+	if (msg->slave_addr == 0)
+		return false;
+	/* If we are broadcasting, we need to program
+	 * the SCP address as some slaves will be
+	 * supporting it while some wont be.
+	 * So it should be programmed
+	 */
+	if (msg->slave_addr == 15)
+		return true;
+	slv_cap = &mstr->sdw_addr[msg->slave_addr].slave->sdw_slv_cap;
+	return slv_cap->paging_supported;
+}
+
 /**
  * __sdw_transfer - unlocked flavor of sdw_slave_transfer
  * @mstr: Handle to SDW bus
@@ -693,9 +715,7 @@ int __sdw_transfer(struct sdw_master *mstr, struct sdw_msg *msg, int num,
 {
 	unsigned long orig_jiffies;
 	int ret = 0, try, i;
-	struct sdw_slv_capabilities *slv_cap;
 	int program_scp_addr_page;
-	int addr = msg->slave_addr;
 
 	/* sdw_trace_msg gets enabled when tracepoint sdw_slave_transfer gets
 	 * enabled.  This is an efficient way of keeping the for-loop from
@@ -712,31 +732,13 @@ int __sdw_transfer(struct sdw_master *mstr, struct sdw_msg *msg, int num,
 	}
 	orig_jiffies = jiffies;
 	for (i = 0; i < num; i++) {
+		program_scp_addr_page = sdw_program_scp_addr_page(mstr,
+								&msg[i]);
 		for (ret = 0, try = 0; try <= mstr->retries; try++) {
-			if (msg->slave_addr == 0)
-				/* If we are enumerating slave address 0,
-				 * we dont program scp, it should be set
-				 * default to 0
-				 */
-				program_scp_addr_page = 0;
-			else if (msg->slave_addr == 15)
-				/* If we are broadcasting, we need to program
-				 * the SCP address as some slaves will be
-				 * supporting it while some wont be.
-				 * So it should be programmed
-				 */
-				program_scp_addr_page = 1;
-
-			else {
-				slv_cap =
-					&mstr->sdw_addr[addr].slave->sdw_slv_cap;
-				program_scp_addr_page =
-					slv_cap->paging_supported;
-			}
 			/* Call async or sync handler based on call */
 			if (!async_data)
 				ret = mstr->driver->mstr_ops->xfer_msg(mstr,
-						msg, program_scp_addr_page);
+						&msg[i], program_scp_addr_page);
 			/* Async transfer is not mandatory to support
 			 * It requires only if stream is split across the
 			 * masters, where bus driver need to send the commands
@@ -746,7 +748,7 @@ int __sdw_transfer(struct sdw_master *mstr, struct sdw_msg *msg, int num,
 			else if (mstr->driver->mstr_ops->xfer_msg_async &&
 				async_data)
 				ret = mstr->driver->mstr_ops->xfer_msg_async(
-						mstr, msg,
+						mstr, &msg[i],
 						program_scp_addr_page,
 						async_data);
 			else
@@ -757,12 +759,14 @@ int __sdw_transfer(struct sdw_master *mstr, struct sdw_msg *msg, int num,
 					orig_jiffies + mstr->timeout))
 				break;
 		}
+		if (ret < 0)
+			break;
 	}
 
 	if (static_key_false(&sdw_trace_msg)) {
 		int i;
 
-		for (i = 0; i < msg->len; i++)
+		for (i = 0; i < num; i++)
 			if (msg[i].flag & SDW_MSG_FLAG_READ)
 				trace_sdw_reply(mstr, &msg[i], i);
 		trace_sdw_result(mstr, i, ret);
@@ -789,27 +793,126 @@ static int sdw_slave_transfer_nopm(struct sdw_master *mstr, struct sdw_msg *msg,
 	return -EOPNOTSUPP;
 }
 
+/*
+ * Queue a batch of messages to one Slave. Returns 0 once the batch is
+ * queued, async_data is then signalled when the last message is done.
+ * Masters which cannot queue a batch get it one message at a time.
+ */
+static int __sdw_transfer_batch(struct sdw_master *mstr, struct sdw_msg *msg,
+				int num,
+				struct sdw_async_xfer_data *async_data)
+{
+	const struct sdw_master_ops *ops = mstr->driver->mstr_ops;
+	int i;
+
+	for (i = 1; i < num; i++)
+		if (msg[i].slave_addr != msg[0].slave_addr)
+			return -EINVAL;
+
+	async_data->msg = msg;
+	async_data->num = num;
+
+	/*
+	 * Enumeration and broadcast have their own ack rules, keep them
+	 * on the synchronous path.
+	 */
+	if (ops->xfer_msg_batch && msg->slave_addr != 0 &&
+			msg->slave_addr != 15)
+		return ops->xfer_msg_batch(mstr, msg, num,
+				sdw_program_scp_addr_page(mstr, msg),
+				async_data);
+
+	async_data->result = __sdw_transfer(mstr, msg, num, NULL);
+	if (async_data->callback)
+		async_data->callback(async_data);
+	complete(&async_data->xfer_complete);
+	return 0;
+}
+
+/*
+ * Called by the Master once a queued batch is done, possibly from
+ * interrupt context. The Master is kept resumed until then.
+ */
+static void sdw_transfer_batch_done(struct sdw_async_xfer_data *async_data)
+{
+	struct sdw_master *mstr = async_data->mstr;
+
+	async_data->callback = async_data->caller_callback;
+	if (async_data->callback)
+		async_data->callback(async_data);
+	pm_runtime_mark_last_busy(&mstr->dev);
+	pm_runtime_put_autosuspend(&mstr->dev);
+}
+
 int sdw_slave_transfer_async(struct sdw_master *mstr, struct sdw_msg *msg,
 					int num,
 					struct sdw_async_xfer_data *async_data)
 {
 	int ret;
-	/* Currently we support only message asynchronously, This is mainly
-	 * used to do bank switch for multiple controllers
-	 */
-	if (num != 1)
+
+	if (num < 1)
 		return -EINVAL;
 	if (!(mstr->driver->mstr_ops->xfer_msg)) {
 		dev_dbg(&mstr->dev, "SDW level transfers not supported\n");
 		return -EOPNOTSUPP;
 	}
 	pm_runtime_get_sync(&mstr->dev);
-	ret = __sdw_transfer(mstr, msg, num, async_data);
+	/*
+	 * A single message is used to do bank switch for multiple
+	 * controllers, where the caller already holds the bus lock.
+	 * More than one message is a batch, which is queued under
+	 * the bus lock and completes in the background. The runtime
+	 * PM reference is then dropped once the batch is done.
+	 */
+	if (num > 1) {
+		async_data->mstr = mstr;
+		async_data->caller_callback = async_data->callback;
+		async_data->callback = sdw_transfer_batch_done;
+		sdw_lock_mstr(mstr);
+		ret = __sdw_transfer_batch(mstr, msg, num, async_data);
+		sdw_unlock_mstr(mstr);
+		if (!ret)
+			return 0;
+		async_data->callback = async_data->caller_callback;
+	} else {
+		ret = __sdw_transfer(mstr, msg, num, async_data);
+	}
 	pm_runtime_mark_last_busy(&mstr->dev);
 	pm_runtime_put_sync_autosuspend(&mstr->dev);
 	return ret;
 }
 
+/**
+ * sdw_slave_transfer_batch: Transfer a batch of messages to one slave.
+ * @mstr: mstr master which will transfer the messages
+ * @msg: Array of messages to be transferred, all to the same slave.
+ * @num: Number of messages to be transferred.
+ *
+ * Returns the number of messages transferred or a negative error code.
+ */
+int sdw_slave_transfer_batch(struct sdw_master *mstr, struct sdw_msg *msg,
+				int num)
+{
+	struct sdw_async_xfer_data async_data;
+	int ret;
+
+	if (num == 1)
+		return sdw_slave_transfer(mstr, msg, num);
+
+	memset(&async_data, 0, sizeof(async_data));
+	init_completion(&async_data.xfer_complete);
+	ret = sdw_slave_transfer_async(mstr, msg, num, &async_data);
+	if (ret)
+		return ret;
+	/*
+	 * Master signals every queued batch, on error or timeout as well,
+	 * so this can't wait forever.
+	 */
+	wait_for_completion(&async_data.xfer_complete);
+	return async_data.result;
+}
+EXPORT_SYMBOL_GPL(sdw_slave_transfer_batch);
+
 /**
  * sdw_slave_transfer:  Transfer message between slave and mstr on the bus.
  * @mstr: mstr master which will transfer the message
@@ -1192,53 +1295,71 @@ static int sdw_handle_slave_alerts(struct sdw_master *mstr,
 	return 0;
 }
 
-int sdw_en_intr(struct sdw_slv *sdw_slv, int port_num, int mask)
+/*
+ * Enable the interrupts of all the data ports of the slave, reading and
+ * then writing back all the masks in one batch each.
+ */
+static int sdw_en_dpn_intr(struct sdw_slv *sdw_slv)
 {
-
-	struct sdw_msg rd_msg, wr_msg;
-	u8 buf;
-	int ret;
+	struct sdw_slv_capabilities *cap = &sdw_slv->sdw_slv_cap;
 	struct sdw_master *mstr = sdw_slv->mstr;
+	int num = cap->num_of_sdw_ports;
+	struct sdw_msg *msg;
+	u8 *buf;
+	int ret, i;
 
-	rd_msg.addr = wr_msg.addr = SDW_DPN_INTMASK +
-			(SDW_NUM_DATA_PORT_REGISTERS * port_num);
+	if (!num)
+		return 0;
 
-	/* Create message for enabling the interrupts */
-	wr_msg.ssp_tag = 0;
-	wr_msg.flag = SDW_MSG_FLAG_WRITE;
-	wr_msg.len = 1;
-	wr_msg.buf = &buf;
-	wr_msg.slave_addr = sdw_slv->slv_number;
-	wr_msg.addr_page1 = 0x0;
-	wr_msg.addr_page2 = 0x0;
+	msg = kcalloc(num, sizeof(*msg), GFP_KERNEL);
+	buf = kcalloc(num, sizeof(*buf), GFP_KERNEL);
+	if (!msg || !buf) {
+		ret = -ENOMEM;
+		goto out;
+	}
 
-	/* Create message for reading the interrupts  for DP0 interrupts*/
-	rd_msg.ssp_tag = 0;
-	rd_msg.flag = SDW_MSG_FLAG_READ;
-	rd_msg.len = 1;
-	rd_msg.buf = &buf;
-	rd_msg.slave_addr = sdw_slv->slv_number;
-	rd_msg.addr_page1 = 0x0;
-	rd_msg.addr_page2 = 0x0;
-	ret = sdw_slave_transfer(mstr, &rd_msg, 1);
-	if (ret != 1) {
+	/* Create messages for reading the interrupt mask of DP1 onwards */
+	for (i = 0; i < num; i++) {
+		msg[i].addr = SDW_DPN_INTMASK +
+			(SDW_NUM_DATA_PORT_REGISTERS * (i + 1));
+		msg[i].ssp_tag = 0;
+		msg[i].flag = SDW_MSG_FLAG_READ;
+		msg[i].len = 1;
+		msg[i].buf = &buf[i];
+		msg[i].slave_addr = sdw_slv->slv_number;
+		msg[i].addr_page1 = 0x0;
+		msg[i].addr_page2 = 0x0;
+	}
+	ret = sdw_slave_transfer_batch(mstr, msg, num);
+	if (ret != num) {
 		dev_err(&mstr->dev, "DPn Intr mask read failed for slave %x\n",
 						sdw_slv->slv_number);
-		return -EINVAL;
+		ret = -EINVAL;
+		goto out;
 	}
 
-	buf |= mask;
+	for (i = 0; i < num; i++) {
+		buf[i] |= cap->sdw_dpn_cap[i].imp_def_intr_mask;
 
-	/* Set the port ready and Test fail interrupt mask as well */
-	buf |= SDW_DPN_INTSTAT_TEST_FAIL_MASK;
-	buf |= SDW_DPN_INTSTAT_PORT_READY_MASK;
-	ret = sdw_slave_transfer(mstr, &wr_msg, 1);
-	if (ret != 1) {
+		/* Set the port ready and Test fail interrupt mask as well */
+		buf[i] |= SDW_DPN_INTSTAT_TEST_FAIL_MASK;
+		buf[i] |= SDW_DPN_INTSTAT_PORT_READY_MASK;
+
+		/* Turn the message into one enabling the interrupts */
+		msg[i].flag = SDW_MSG_FLAG_WRITE;
+	}
+	ret = sdw_slave_transfer_batch(mstr, msg, num);
+	if (ret != num) {
 		dev_err(&mstr->dev, "DPn Intr mask write failed for slave %x\n",
 						sdw_slv->slv_number);
-		return -EINVAL;
+		ret = -EINVAL;
+		goto out;
 	}
-	return 0;
+	ret = 0;
+out:
+	kfree(buf);
+	kfree(msg);
+	return ret;
 }
 
 static int sdw_en_scp_intr(struct sdw_slv *sdw_slv, int mask)
@@ -1345,8 +1466,7 @@ static int sdw_prog_slv(struct sdw_slv *sdw_slv)
 {
 
 	struct sdw_slv_capabilities *cap;
-	int ret, i;
-	struct sdw_slv_dpn_capabilities *dpn_cap;
+	int ret;
 	struct sdw_master *mstr = sdw_slv->mstr;
 
 	if (!sdw_slv->slave_cap_updated)
@@ -1360,15 +1480,7 @@ static int sdw_prog_slv(struct sdw_slv *sdw_slv)
 	if (ret)
 		dev_err(&mstr->dev, "SCP program failed\n");
 
-	for (i = 0; i < cap->num_of_sdw_ports; i++) {
-		dpn_cap = &cap->sdw_dpn_cap[i];
-		ret = sdw_en_intr(sdw_slv, (i + 1),
-					dpn_cap->imp_def_intr_mask);
-
-		if (ret)
-			break;
-	}
-	return ret;
+	return sdw_en_dpn_intr(sdw_slv);
 }
 
 
@@ -119,6 +119,8 @@ int sdw_mstr_bw_init(struct sdw_bus *sdw_bs)
 	sdw_bs->clk_state = SDW_CLK_STATE_ON;
 	sdw_mstr_cap = &sdw_bs->mstr->mstr_capabilities;
 	sdw_bs->clk_freq = (sdw_mstr_cap->base_clk_freq * 2);
+	memset(sdw_bs->frmshp_cache, 0, sizeof(sdw_bs->frmshp_cache));
+	sdw_bs->frmshp_cache_next = 0;
 
 	return 0;
 }
@@ -196,7 +198,7 @@ int sdw_cfg_slv_params(struct sdw_bus *mstr_bs,
 		struct sdw_transport_params *t_slv_params,
 		struct sdw_port_params *p_slv_params, int slv_number)
 {
-	struct sdw_msg wr_msg, wr_msg1, rd_msg;
+	struct sdw_msg wr_msg[2], rd_msg;
 	int ret = 0;
 	int banktouse;
 	u8 wbuf[8] = {0, 0, 0, 0, 0, 0, 0, 0};
@@ -266,46 +268,40 @@ int sdw_cfg_slv_params(struct sdw_bus *mstr_bs,
 	wbuf1[1] = (p_slv_params->word_length - 1);
 
 	/* Check whether address computed is correct for both cases */
-	wr_msg.addr = ((SDW_DPN_BLOCKCTRL2 +
+	wr_msg[0].addr = ((SDW_DPN_BLOCKCTRL2 +
 				(1 * (!t_slv_params->blockgroupcontrol_valid))
 				+ (SDW_BANK1_REGISTER_OFFSET * banktouse)) +
 			(SDW_NUM_DATA_PORT_REGISTERS * t_slv_params->num));
 
-	wr_msg1.addr =  SDW_DPN_PORTCTRL +
+	wr_msg[1].addr =  SDW_DPN_PORTCTRL +
 		(SDW_NUM_DATA_PORT_REGISTERS * t_slv_params->num);
 
-	wr_msg.ssp_tag = 0x0;
-	wr_msg.flag = SDW_MSG_FLAG_WRITE;
+	wr_msg[0].ssp_tag = 0x0;
+	wr_msg[0].flag = SDW_MSG_FLAG_WRITE;
 #ifdef CONFIG_SND_SOC_SVFPGA
-	wr_msg.len = (5 + (1 * (t_slv_params->blockgroupcontrol_valid)));
+	wr_msg[0].len = (5 + (1 * (t_slv_params->blockgroupcontrol_valid)));
 #else
-	wr_msg.len = (7 + (1 * (t_slv_params->blockgroupcontrol_valid)));
+	wr_msg[0].len = (7 + (1 * (t_slv_params->blockgroupcontrol_valid)));
 #endif
 
-	wr_msg.slave_addr = slv_number;
-	wr_msg.buf = &wbuf[0 + (1 * (!t_slv_params->blockgroupcontrol_valid))];
-	wr_msg.addr_page1 = 0x0;
-	wr_msg.addr_page2 = 0x0;
-
-	wr_msg1.ssp_tag = 0x0;
-	wr_msg1.flag = SDW_MSG_FLAG_WRITE;
-	wr_msg1.len = 2;
+	wr_msg[0].slave_addr = slv_number;
+	wr_msg[0].buf =
+		&wbuf[0 + (1 * (!t_slv_params->blockgroupcontrol_valid))];
+	wr_msg[0].addr_page1 = 0x0;
+	wr_msg[0].addr_page2 = 0x0;
 
-	wr_msg1.slave_addr = slv_number;
-	wr_msg1.buf = &wbuf1[0];
-	wr_msg1.addr_page1 = 0x0;
-	wr_msg1.addr_page2 = 0x0;
-
-	ret = sdw_slave_transfer(mstr_bs->mstr, &wr_msg, 1);
-	if (ret != 1) {
-		ret = -EINVAL;
-		dev_err(&mstr_bs->mstr->dev, "Register transfer failed\n");
-		goto out;
-	}
+	wr_msg[1].ssp_tag = 0x0;
+	wr_msg[1].flag = SDW_MSG_FLAG_WRITE;
+	wr_msg[1].len = 2;
 
+	wr_msg[1].slave_addr = slv_number;
+	wr_msg[1].buf = &wbuf1[0];
+	wr_msg[1].addr_page1 = 0x0;
+	wr_msg[1].addr_page2 = 0x0;
 
-	ret = sdw_slave_transfer(mstr_bs->mstr, &wr_msg1, 1);
-	if (ret != 1) {
+	/* Transport and port parameters go out in one batch */
+	ret = sdw_slave_transfer_batch(mstr_bs->mstr, wr_msg, 2);
+	if (ret != 2) {
 		ret = -EINVAL;
 		dev_err(&mstr_bs->mstr->dev, "Register transfer failed\n");
 		goto out;
@@ -733,6 +729,53 @@ int sdw_en_dis_mstr_slv_state(struct sdw_bus *sdw_mstr_bs,
 }
 
 
+/*
+ * sdw_find_frmshp - returns index of the row/column combination to use
+ * MAX_NUM_ROW_COLS - In case none leaves enough data bits.
+ *
+ *
+ * This function finds the first frame shape leaving enough bandwidth
+ * for the bus at the given clock. The result only depends on the clock
+ * and the bus bandwidth, so it is remembered per master: recurring
+ * stream combinations skip the search.
+ */
+static int sdw_find_frmshp(struct sdw_bus *sdw_mstr_bs, int clock_reqd)
+{
+	struct sdw_frmshp_cache *entry;
+	int i, rc, frame_interval, frame_frequency;
+
+	for (i = 0; i < SDW_FRMSHP_CACHE_SIZE; i++) {
+		entry = &sdw_mstr_bs->frmshp_cache[i];
+		if (entry->clk_freq == clock_reqd &&
+				entry->bandwidth == sdw_mstr_bs->bandwidth)
+			return entry->rc;
+	}
+
+	/* Find frame shape based on bandwidth per controller */
+	for (rc = 0; rc < MAX_NUM_ROW_COLS; rc++) {
+		frame_interval =
+			sdw_core.rowcolcomb[rc].row *
+			sdw_core.rowcolcomb[rc].col;
+		frame_frequency = clock_reqd/frame_interval;
+
+		if ((clock_reqd - (frame_frequency *
+				sdw_core.rowcolcomb[rc].control_bits)) <
+				sdw_mstr_bs->bandwidth)
+			continue;
+
+		break;
+	}
+
+	entry = &sdw_mstr_bs->frmshp_cache[sdw_mstr_bs->frmshp_cache_next];
+	sdw_mstr_bs->frmshp_cache_next =
+		(sdw_mstr_bs->frmshp_cache_next + 1) % SDW_FRMSHP_CACHE_SIZE;
+	entry->clk_freq = clock_reqd;
+	entry->bandwidth = sdw_mstr_bs->bandwidth;
+	entry->rc = rc;
+
+	return rc;
+}
+
 /*
  * sdw_get_clock_frmshp - returns Success
  * -EINVAL - In case of error.
@@ -844,26 +887,16 @@ int sdw_get_clock_frmshp(struct sdw_bus *sdw_mstr_bs, int *frame_int,
 			continue;
 
 		/* Find frame shape based on bandwidth per controller */
-		for (rc = 0; rc < MAX_NUM_ROW_COLS; rc++) {
-			frame_interval =
-				sdw_core.rowcolcomb[rc].row *
-				sdw_core.rowcolcomb[rc].col;
-			frame_frequency = clock_reqd/frame_interval;
-
-			if ((clock_reqd -
-						(frame_frequency *
-						 sdw_core.rowcolcomb[rc].
-						 control_bits)) <
-					sdw_mstr_bs->bandwidth)
-				continue;
-
-			break;
-		}
+		rc = sdw_find_frmshp(sdw_mstr_bs, clock_reqd);
 
 		/* Valid frameshape not found, check for next clock freq */
 		if (rc == MAX_NUM_ROW_COLS)
 			continue;
 
+		frame_interval = sdw_core.rowcolcomb[rc].row *
+			sdw_core.rowcolcomb[rc].col;
+		frame_frequency = clock_reqd/frame_interval;
+
 		sel_row = sdw_core.rowcolcomb[rc].row;
 		sel_col = sdw_core.rowcolcomb[rc].col;
 		sdw_mstr_bs->frame_freq = frame_frequency;
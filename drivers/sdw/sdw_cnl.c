@@ -28,6 +28,7 @@
 #include <linux/slab.h>
 #include <linux/init.h>
 #include <linux/completion.h>
+#include <linux/workqueue.h>
 #include <linux/idr.h>
 #include <linux/rtmutex.h>
 #include <linux/pm_runtime.h>
@@ -85,6 +86,21 @@ struct cnl_sdw_async_msg {
 	int length;
 };
 
+/*
+ * Batch of messages to one Slave. Whole messages are packed into the
+ * command FIFO and the next fill is queued from the RX interrupt, so
+ * the caller is only woken up once the last message is done.
+ */
+struct cnl_sdw_batch {
+	struct sdw_async_xfer_data *data;
+	struct sdw_msg *msg;
+	int num;
+	int cur;	/* First message of the fill in flight */
+	int next;	/* First message of the next fill */
+	bool program_scp_addr_page;
+	unsigned long timeout;	/* jiffies the fill in flight times out */
+};
+
 struct cnl_sdw {
 	struct cnl_sdw_data data;
 	struct sdw_master *mstr;
@@ -107,6 +123,9 @@ struct cnl_sdw {
 	struct mutex	stream_lock;
 	spinlock_t ctrl_lock;
 	struct cnl_sdw_async_msg async_msg;
+	struct cnl_sdw_batch batch;
+	struct completion batch_idle;
+	struct delayed_work batch_work;
 	u32 response_buf[0x80];
 	bool sdw_link_status;
 
@@ -971,6 +990,161 @@ static enum sdw_command_response sdw_fill_message_response(
 	return 0;
 }
 
+static u32 cnl_sdw_cmd_word(struct sdw_msg *msg, int cmd, u16 addr, u8 data)
+{
+	u32 cmd_data = 0;
+
+	cmd_data |= (msg->slave_addr & MCP_COMMAND_DEV_ADDR_MASK) <<
+			MCP_COMMAND_DEV_ADDR_SHIFT;
+	cmd_data |= (cmd << MCP_COMMAND_COMMAND_SHIFT);
+	cmd_data |= (addr << MCP_COMMAND_REG_ADDR_L_SHIFT);
+	cmd_data |= data;
+	return cmd_data;
+}
+
+static int cnl_sdw_batch_msg_words(struct cnl_sdw_batch *batch,
+					struct sdw_msg *msg)
+{
+	if (batch->program_scp_addr_page)
+		return msg->len + CNL_SDW_SCP_ADDR_REGS;
+	return msg->len;
+}
+
+/* Queue as many whole messages of the batch as fit in the command FIFO */
+static void cnl_sdw_batch_fill(struct cnl_sdw *sdw)
+{
+	struct cnl_sdw_batch *batch = &sdw->batch;
+	struct cnl_sdw_data *data = &sdw->data;
+	u32 cmd_base = SDW_CNL_MCP_COMMAND_BASE;
+	struct sdw_msg *msg;
+	int count = 0, cmd, i, j;
+	u32 cmd_data;
+
+	batch->cur = batch->next;
+	for (i = batch->cur; i < batch->num; i++) {
+		msg = &batch->msg[i];
+		if (count + cnl_sdw_batch_msg_words(batch, msg) >
+				SDW_CNL_MCP_COMMAND_LENGTH)
+			break;
+		count += cnl_sdw_batch_msg_words(batch, msg);
+	}
+	batch->next = i;
+
+	/* Program the watermark level upto number of count */
+	cnl_sdw_reg_writel(data->sdw_regs, SDW_CNL_MCP_FIFOLEVEL, count);
+
+	for (i = batch->cur; i < batch->next; i++) {
+		msg = &batch->msg[i];
+		if (batch->program_scp_addr_page) {
+			cnl_sdw_reg_writel(data->sdw_regs, cmd_base,
+				cnl_sdw_cmd_word(msg, 0x3, SDW_SCP_ADDRPAGE1,
+						msg->addr_page1));
+			cmd_base += SDW_CNL_CMD_WORD_LEN;
+			cnl_sdw_reg_writel(data->sdw_regs, cmd_base,
+				cnl_sdw_cmd_word(msg, 0x3, SDW_SCP_ADDRPAGE2,
+						msg->addr_page2));
+			cmd_base += SDW_CNL_CMD_WORD_LEN;
+		}
+		cmd = (msg->flag == SDW_MSG_FLAG_WRITE) ? 0x3 : 0x2;
+		for (j = 0; j < msg->len; j++) {
+			cmd_data = cnl_sdw_cmd_word(msg, cmd, msg->addr + j,
+				(cmd == 0x3) ? msg->buf[j] : 0);
+			cmd_data |= ((msg->ssp_tag &
+					MCP_COMMAND_SSP_TAG_MASK) <<
+					MCP_COMMAND_SSP_TAG_SHIFT);
+			cnl_sdw_reg_writel(data->sdw_regs, cmd_base, cmd_data);
+			cmd_base += SDW_CNL_CMD_WORD_LEN;
+		}
+	}
+	batch->timeout = jiffies + 3 * HZ;
+	mod_delayed_work(system_wq, &sdw->batch_work, 3 * HZ);
+}
+
+/* Called with ctrl_lock held */
+static void cnl_sdw_batch_done(struct cnl_sdw *sdw, int result)
+{
+	struct sdw_async_xfer_data *data = sdw->batch.data;
+
+	sdw->batch.data = NULL;
+	sdw->batch.msg = NULL;
+	cancel_delayed_work(&sdw->batch_work);
+	data->result = result;
+	if (data->callback)
+		data->callback(data);
+	complete(&data->xfer_complete);
+	complete_all(&sdw->batch_idle);
+}
+
+/* Check the responses of the fill in flight and queue the next one */
+static void cnl_sdw_batch_rx(struct cnl_sdw *sdw)
+{
+	struct cnl_sdw_batch *batch = &sdw->batch;
+	struct sdw_master *mstr = sdw->mstr;
+	struct sdw_msg *msg;
+	u32 *res = sdw->response_buf;
+	int i, j, words;
+
+	/* Late response after the batch timed out */
+	if (!batch->data)
+		return;
+
+	for (i = batch->cur; i < batch->next; i++) {
+		msg = &batch->msg[i];
+		words = cnl_sdw_batch_msg_words(batch, msg);
+		for (j = 0; j < words; j++) {
+			if (MCP_RESPONSE_ACK_MASK & res[j])
+				continue;
+			dev_err(&mstr->dev, "%s for slave %d\n",
+				(MCP_RESPONSE_NACK_MASK & res[j]) ?
+				"Nack detected" : "Command ignored",
+				msg->slave_addr);
+			msg->len = 0;
+			cnl_sdw_batch_done(sdw, -EREMOTEIO);
+			return;
+		}
+		if (batch->program_scp_addr_page)
+			res += CNL_SDW_SCP_ADDR_REGS;
+		if (msg->flag == SDW_MSG_FLAG_READ)
+			for (j = 0; j < msg->len; j++)
+				msg->buf[j] = res[j] >>
+					MCP_RESPONSE_RDATA_SHIFT;
+		res += msg->len;
+	}
+
+	if (batch->next == batch->num)
+		cnl_sdw_batch_done(sdw, batch->num);
+	else
+		cnl_sdw_batch_fill(sdw);
+}
+
+static void cnl_sdw_batch_timeout(struct work_struct *work)
+{
+	struct cnl_sdw *sdw = container_of(work, struct cnl_sdw,
+						batch_work.work);
+	unsigned long flags;
+
+	spin_lock_irqsave(&sdw->ctrl_lock, flags);
+	if (sdw->batch.data) {
+		if (time_before(jiffies, sdw->batch.timeout)) {
+			/* Raced with a refill, wait for the new fill */
+			mod_delayed_work(system_wq, &sdw->batch_work,
+					sdw->batch.timeout - jiffies);
+		} else {
+			dev_err(&sdw->mstr->dev, "Controller timedout\n");
+			cnl_sdw_batch_done(sdw, -ETIMEDOUT);
+		}
+	}
+	spin_unlock_irqrestore(&sdw->ctrl_lock, flags);
+}
+
+/*
+ * Commands share the FIFO with a batch in flight, so wait for it to be
+ * done. The timeout work guarantees this doesn't wait forever.
+ */
+static void cnl_sdw_wait_batch_idle(struct cnl_sdw *sdw)
+{
+	wait_for_completion(&sdw->batch_idle);
+}
 
 irqreturn_t cnl_sdw_irq_handler(int irq, void *context)
 {
@@ -1004,7 +1178,11 @@ irqreturn_t cnl_sdw_irq_handler(int irq, void *context)
 
 	if (int_status & (MCP_INTSTAT_RXWL_MASK << MCP_INTSTAT_RXWL_SHIFT)) {
 		cnl_sdw_read_response(sdw);
-		if (sdw->async_msg.async_xfer_complete) {
+		if (sdw->batch.data) {
+			spin_lock(&sdw->ctrl_lock);
+			cnl_sdw_batch_rx(sdw);
+			spin_unlock(&sdw->ctrl_lock);
+		} else if (sdw->async_msg.async_xfer_complete) {
 			sdw_fill_message_response(mstr, sdw->async_msg.msg,
 					sdw->async_msg.length, 0);
 			complete(sdw->async_msg.async_xfer_complete);
@@ -1173,6 +1351,8 @@ static enum sdw_command_response cnl_sdw_xfer_msg_async(struct sdw_master *mstr,
 	int ret = 0, cmd;
 	struct cnl_sdw *sdw = sdw_master_get_drvdata(mstr);
 
+	cnl_sdw_wait_batch_idle(sdw);
+
 	/* Only 1 message can be handled in Async fashion. This is used
 	 * only for Bank switching where during aggregation it is required
 	 * to synchronously switch the bank on  more than 1 controller
@@ -1214,8 +1394,11 @@ static enum sdw_command_response cnl_sdw_xfer_msg_async(struct sdw_master *mstr,
 static enum sdw_command_response cnl_sdw_xfer_msg(struct sdw_master *mstr,
 		struct sdw_msg *msg, bool program_scp_addr_page)
 {
+	struct cnl_sdw *sdw = sdw_master_get_drvdata(mstr);
 	int i, ret = 0, cmd;
 
+	cnl_sdw_wait_batch_idle(sdw);
+
 	if (program_scp_addr_page)
 		ret = cnl_program_scp_addr(mstr, msg);
 
@@ -1251,6 +1434,41 @@ static enum sdw_command_response cnl_sdw_xfer_msg(struct sdw_master *mstr,
 	return ret;
 }
 
+static enum sdw_command_response cnl_sdw_xfer_msg_batch(
+		struct sdw_master *mstr, struct sdw_msg *msg, int num,
+		bool program_scp_addr_page, struct sdw_async_xfer_data *data)
+{
+	struct cnl_sdw *sdw = sdw_master_get_drvdata(mstr);
+	struct cnl_sdw_batch *batch = &sdw->batch;
+	unsigned long flags;
+	int i;
+
+	for (i = 0; i < num; i++) {
+		if (msg[i].flag != SDW_MSG_FLAG_READ &&
+				msg[i].flag != SDW_MSG_FLAG_WRITE) {
+			dev_err(&mstr->dev, "Command not supported\n");
+			return -EINVAL;
+		}
+		/* Every message has to fit in a single FIFO fill */
+		if (!msg[i].len || msg[i].len + CNL_SDW_SCP_ADDR_REGS >
+				SDW_CNL_MCP_COMMAND_LENGTH)
+			return -EINVAL;
+	}
+
+	cnl_sdw_wait_batch_idle(sdw);
+
+	spin_lock_irqsave(&sdw->ctrl_lock, flags);
+	reinit_completion(&sdw->batch_idle);
+	batch->data = data;
+	batch->msg = msg;
+	batch->num = num;
+	batch->next = 0;
+	batch->program_scp_addr_page = program_scp_addr_page;
+	cnl_sdw_batch_fill(sdw);
+	spin_unlock_irqrestore(&sdw->ctrl_lock, flags);
+	return 0;
+}
+
 static void cnl_sdw_bra_prep_crc(u8 *txdata_buf,
 		struct sdw_bra_block *block, int data_offset, int addr_offset)
 {
@@ -2279,6 +2497,9 @@ static int cnl_sdw_probe(struct sdw_master *mstr,
 	spin_lock_init(&sdw->ctrl_lock);
 	sdw_master_set_drvdata(mstr, sdw);
 	init_completion(&sdw->tx_complete);
+	init_completion(&sdw->batch_idle);
+	complete_all(&sdw->batch_idle);
+	INIT_DELAYED_WORK(&sdw->batch_work, cnl_sdw_batch_timeout);
 	mutex_init(&sdw->stream_lock);
 	ret = sdw_init(sdw, true);
 	if (ret) {
@@ -2319,6 +2540,7 @@ static int cnl_sdw_remove(struct sdw_master *mstr)
 {
 	struct cnl_sdw *sdw = sdw_master_get_drvdata(mstr);
 
+	cancel_delayed_work_sync(&sdw->batch_work);
 	sdw_power_down_link(sdw);
 
 	return 0;
@@ -2487,6 +2709,7 @@ static const struct dev_pm_ops cnl_sdw_pm_ops = {
 static struct sdw_master_ops cnl_sdw_master_ops  = {
 	.xfer_msg_async = cnl_sdw_xfer_msg_async,
 	.xfer_msg = cnl_sdw_xfer_msg,
+	.xfer_msg_batch = cnl_sdw_xfer_msg_batch,
 	.xfer_bulk = cnl_sdw_xfer_bulk,
 	.monitor_handover = cnl_sdw_mon_handover,
 	.set_ssp_interval = cnl_sdw_set_ssp_interval,
@@ -202,6 +202,15 @@ struct sdw_slv_status {
 	enum sdw_slave_status status[SOUNDWIRE_MAX_DEVICES+1];
 };
 
+#define SDW_FRMSHP_CACHE_SIZE		8
+
+/** Frame shape picked for a given clock and bus bandwidth */
+struct sdw_frmshp_cache {
+	unsigned int clk_freq;
+	unsigned int bandwidth;
+	int rc;
+};
+
 /** Bus structure which handles bus related information */
 struct sdw_bus {
 	struct list_head bus_node;
@@ -225,6 +234,9 @@ struct sdw_bus {
 	struct list_head status_list;
 	spinlock_t spinlock;
 	struct sdw_async_xfer_data async_data;
+	/* Recently computed frame shapes, see sdw_find_frmshp() */
+	struct sdw_frmshp_cache frmshp_cache[SDW_FRMSHP_CACHE_SIZE];
+	unsigned int frmshp_cache_next;
 };
 
 /** Holds supported Row-Column combination related information */
@@ -22,8 +22,12 @@
 #include <linux/uaccess.h>
 #include <linux/personality.h>
 #include <linux/bitops.h>
+#include <linux/interval_tree_generic.h>
 #include <linux/mutex.h>
 #include <linux/shmem_fs.h>
+#include <linux/spinlock.h>
+#include <linux/swap.h>
+#include <linux/workqueue.h>
 #include "ashmem.h"
 
 #define ASHMEM_NAME_PREFIX "dev/ashmem/"
@@ -33,19 +37,25 @@
 /**
  * struct ashmem_area - The anonymous shared memory area
  * @name:		The optional name in /proc/pid/maps
- * @unpinned_list:	The list of all ashmem areas
+ * @unpinned:		Interval tree of this area's unpinned ranges
+ * @mutex:		Protects this structure and its unpinned ranges
+ * @purge_entry:	The entry in ashmem_purge_list
+ * @purge_pending:	Number of ranges waiting for the purge worker
  * @file:		The shmem-based backing file
  * @size:		The size of the mapping, in bytes
  * @prot_mask:		The allowed protection bits, as vm_flags
  *
  * The lifecycle of this structure is from our parent file's open() until
- * its release(). It is also protected by 'ashmem_mutex'
+ * its release(). It is protected by its own 'mutex'
  *
  * Warning: Mappings do NOT pin this structure; It dies on close()
  */
 struct ashmem_area {
 	char name[ASHMEM_FULL_NAME_LEN];
-	struct list_head unpinned_list;
+	struct rb_root_cached unpinned;
+	struct mutex mutex;
+	struct list_head purge_entry;
+	unsigned int purge_pending;
 	struct file *file;
 	size_t size;
 	unsigned long prot_mask;
@@ -54,40 +64,58 @@ struct ashmem_area {
 /**
  * struct ashmem_range - A range of unpinned/evictable pages
  * @lru:	         The entry in the LRU list
- * @unpinned:	         The entry in its area's unpinned list
+ * @rb:		         The node in its area's unpinned interval tree
+ * @subtree_last:        The last page of @rb's subtree, for the interval tree
  * @asma:	         The associated anonymous shared memory area.
  * @pgstart:	         The starting page (inclusive)
  * @pgend:	         The ending page (inclusive)
  * @purged:	         The purge status (ASHMEM_NOT or ASHMEM_WAS_PURGED)
+ * @purge_pending:       Purged, but the hole hasn't been punched yet
  *
  * The lifecycle of this structure is from unpin to pin.
- * It is protected by 'ashmem_mutex'
+ * It is protected by its area's mutex, @lru is also protected by
+ * 'ashmem_lru_lock'
  */
 struct ashmem_range {
 	struct list_head lru;
-	struct list_head unpinned;
+	struct rb_node rb;
+	size_t subtree_last;
 	struct ashmem_area *asma;
 	size_t pgstart;
 	size_t pgend;
 	unsigned int purged;
+	bool purge_pending;
 };
 
-/* LRU list of unpinned pages, protected by ashmem_mutex */
+/* LRU list of unpinned pages, protected by ashmem_lru_lock */
 static LIST_HEAD(ashmem_lru_list);
 
 /*
  * long lru_count - The count of pages on our LRU list.
  *
- * This is protected by ashmem_mutex.
+ * This is protected by ashmem_lru_lock.
  */
 static unsigned long lru_count;
 
 /*
- * ashmem_mutex - protects the list of and each individual ashmem_area
+ * ashmem_lru_lock - protects the LRU list and lru_count
  *
- * Lock Ordering: ashmex_mutex -> i_mutex -> i_alloc_sem
+ * Lock Ordering: ashmem_area.mutex -> ashmem_lru_lock
+ *		  ashmem_area.mutex -> i_mutex -> i_alloc_sem
+ *
+ * The shrinker walks the LRU with ashmem_lru_lock held and only trylocks
+ * an area's mutex, skipping areas that are busy.
+ */
+static DEFINE_SPINLOCK(ashmem_lru_lock);
+
+/*
+ * Areas with ranges that direct reclaim marked purged and left for
+ * ashmem_purge_work to punch out, protected by ashmem_lru_lock.
  */
-static DEFINE_MUTEX(ashmem_mutex);
+static LIST_HEAD(ashmem_purge_list);
+
+static void ashmem_purge_work_fn(struct work_struct *work);
+static DECLARE_DELAYED_WORK(ashmem_purge_work, ashmem_purge_work_fn);
 
 static struct kmem_cache *ashmem_area_cachep __read_mostly;
 static struct kmem_cache *ashmem_range_cachep __read_mostly;
@@ -114,22 +142,11 @@ static inline bool page_range_subsumed_by_range(struct ashmem_range *range,
 	return (range->pgstart <= start) && (range->pgend >= end);
 }
 
-static inline bool page_in_range(struct ashmem_range *range, size_t page)
-{
-	return (range->pgstart <= page) && (range->pgend >= page);
-}
+#define range_start(range)	((range)->pgstart)
+#define range_last(range)	((range)->pgend)
 
-static inline bool page_range_in_range(struct ashmem_range *range,
-				       size_t start, size_t end)
-{
-	return page_in_range(range, start) || page_in_range(range, end) ||
-		page_range_subsumes_range(range, start, end);
-}
-
-static inline bool range_before_page(struct ashmem_range *range, size_t page)
-{
-	return range->pgend < page;
-}
+INTERVAL_TREE_DEFINE(struct ashmem_range, rb, size_t, subtree_last,
+		     range_start, range_last, static, range_tree)
 
 #define PROT_MASK		(PROT_EXEC | PROT_READ | PROT_WRITE)
 
@@ -142,8 +159,10 @@ static inline bool range_before_page(struct ashmem_range *range, size_t page)
  */
 static inline void lru_add(struct ashmem_range *range)
 {
+	spin_lock(&ashmem_lru_lock);
 	list_add_tail(&range->lru, &ashmem_lru_list);
 	lru_count += range_size(range);
+	spin_unlock(&ashmem_lru_lock);
 }
 
 /**
@@ -152,6 +171,8 @@ static inline void lru_add(struct ashmem_range *range)
  *
  * The range is first deleted from the LRU list.
  * After this, the size of the range is removed from @lru_count
+ *
+ * Caller must hold ashmem_lru_lock.
  */
 static inline void lru_del(struct ashmem_range *range)
 {
@@ -162,17 +183,15 @@ static inline void lru_del(struct ashmem_range *range)
 /**
  * range_alloc() - Allocates and initializes a new ashmem_range structure
  * @asma:	   The associated ashmem_area
- * @prev_range:	   The previous ashmem_range in the sorted asma->unpinned list
  * @purged:	   Initial purge status (ASMEM_NOT_PURGED or ASHMEM_WAS_PURGED)
  * @start:	   The starting page (inclusive)
  * @end:	   The ending page (inclusive)
  *
- * This function is protected by ashmem_mutex.
+ * This function is protected by asma->mutex.
  *
  * Return: 0 if successful, or -ENOMEM if there is an error
  */
-static int range_alloc(struct ashmem_area *asma,
-		       struct ashmem_range *prev_range, unsigned int purged,
+static int range_alloc(struct ashmem_area *asma, unsigned int purged,
 		       size_t start, size_t end)
 {
 	struct ashmem_range *range;
@@ -186,7 +205,7 @@ static int range_alloc(struct ashmem_area *asma,
 	range->pgend = end;
 	range->purged = purged;
 
-	list_add_tail(&range->unpinned, &prev_range->unpinned);
+	range_tree_insert(range, &asma->unpinned);
 
 	if (range_on_lru(range))
 		lru_add(range);
@@ -197,12 +216,17 @@ static int range_alloc(struct ashmem_area *asma,
 /**
  * range_del() - Deletes and dealloctes an ashmem_range structure
  * @range:	 The associated ashmem_range that has previously been allocated
+ *
+ * This function is protected by asma->mutex.
  */
 static void range_del(struct ashmem_range *range)
 {
-	list_del(&range->unpinned);
-	if (range_on_lru(range))
+	range_tree_remove(range, &range->asma->unpinned);
+	if (range_on_lru(range)) {
+		spin_lock(&ashmem_lru_lock);
 		lru_del(range);
+		spin_unlock(&ashmem_lru_lock);
+	}
 	kmem_cache_free(ashmem_range_cachep, range);
 }
 
@@ -217,17 +241,102 @@ static void range_del(struct ashmem_range *range)
  *
  * Theoretically, with a little tweaking, this could eventually be changed
  * to range_resize, and expand the lru_count if the new range is larger.
+ *
+ * This function is protected by asma->mutex.
  */
 static inline void range_shrink(struct ashmem_range *range,
 				size_t start, size_t end)
 {
+	struct rb_root_cached *root = &range->asma->unpinned;
 	size_t pre = range_size(range);
 
+	range_tree_remove(range, root);
 	range->pgstart = start;
 	range->pgend = end;
+	range_tree_insert(range, root);
 
-	if (range_on_lru(range))
+	if (range_on_lru(range)) {
+		spin_lock(&ashmem_lru_lock);
 		lru_count -= pre - range_size(range);
+		spin_unlock(&ashmem_lru_lock);
+	}
+}
+
+static void ashmem_punch(struct ashmem_area *asma, loff_t start, loff_t end)
+{
+	if (end > start)
+		asma->file->f_op->fallocate(asma->file,
+				FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE,
+				start, end - start);
+}
+
+/**
+ * ashmem_purge_area() - Punches out the ranges left for the purge worker
+ * @asma:	         The area to purge
+ *
+ * Adjacent pending ranges are punched with a single fallocate call. This
+ * must run before the area's unpinned ranges are changed, so that data
+ * written after a pin is never thrown away by a late purge.
+ *
+ * Caller must hold asma->mutex.
+ */
+static void ashmem_purge_area(struct ashmem_area *asma)
+{
+	struct ashmem_range *range;
+	struct rb_node *node;
+	loff_t start = 0, end = 0;
+
+	if (!asma->purge_pending)
+		return;
+
+	spin_lock(&ashmem_lru_lock);
+	list_del_init(&asma->purge_entry);
+	spin_unlock(&ashmem_lru_lock);
+
+	for (node = rb_first_cached(&asma->unpinned); node;
+	     node = rb_next(node)) {
+		range = rb_entry(node, struct ashmem_range, rb);
+		if (!range->purge_pending)
+			continue;
+		range->purge_pending = false;
+
+		if (range->pgstart * PAGE_SIZE != end) {
+			ashmem_punch(asma, start, end);
+			start = range->pgstart * PAGE_SIZE;
+		}
+		end = (range->pgend + 1) * PAGE_SIZE;
+	}
+	ashmem_punch(asma, start, end);
+	asma->purge_pending = 0;
+}
+
+static void ashmem_purge_work_fn(struct work_struct *work)
+{
+	struct ashmem_area *asma;
+	bool busy;
+
+	spin_lock(&ashmem_lru_lock);
+restart:
+	list_for_each_entry(asma, &ashmem_purge_list, purge_entry) {
+		/* Holding the mutex keeps asma alive, see ashmem_release() */
+		if (!mutex_trylock(&asma->mutex))
+			continue;
+		spin_unlock(&ashmem_lru_lock);
+
+		ashmem_purge_area(asma);
+		mutex_unlock(&asma->mutex);
+		cond_resched();
+
+		spin_lock(&ashmem_lru_lock);
+		goto restart;
+	}
+	busy = !list_empty(&ashmem_purge_list);
+	spin_unlock(&ashmem_lru_lock);
+
+	/* Areas that are busy get purged by their owner or on a later run */
+	if (busy)
+		queue_delayed_work(system_unbound_wq, &ashmem_purge_work,
+				   msecs_to_jiffies(10));
 }
 
 /**
@@ -253,7 +362,9 @@ static int ashmem_open(struct inode *inode, struct file *file)
 	if (!asma)
 		return -ENOMEM;
 
-	INIT_LIST_HEAD(&asma->unpinned_list);
+	asma->unpinned = RB_ROOT_CACHED;
+	mutex_init(&asma->mutex);
+	INIT_LIST_HEAD(&asma->purge_entry);
 	memcpy(asma->name, ASHMEM_NAME_PREFIX, ASHMEM_NAME_PREFIX_LEN);
 	asma->prot_mask = PROT_MASK;
 	file->private_data = asma;
@@ -272,12 +383,13 @@ static int ashmem_open(struct inode *inode, struct file *file)
 static int ashmem_release(struct inode *ignored, struct file *file)
 {
 	struct ashmem_area *asma = file->private_data;
-	struct ashmem_range *range, *next;
+	struct rb_node *node;
 
-	mutex_lock(&ashmem_mutex);
-	list_for_each_entry_safe(range, next, &asma->unpinned_list, unpinned)
-		range_del(range);
-	mutex_unlock(&ashmem_mutex);
+	mutex_lock(&asma->mutex);
+	ashmem_purge_area(asma);
+	while ((node = rb_first_cached(&asma->unpinned)))
+		range_del(rb_entry(node, struct ashmem_range, rb));
+	mutex_unlock(&asma->mutex);
 
 	if (asma->file)
 		fput(asma->file);
@@ -291,7 +403,7 @@ static ssize_t ashmem_read_iter(struct kiocb *iocb, struct iov_iter *iter)
 	struct ashmem_area *asma = iocb->ki_filp->private_data;
 	int ret = 0;
 
-	mutex_lock(&ashmem_mutex);
+	mutex_lock(&asma->mutex);
 
 	/* If size is not set, or set to 0, always return EOF. */
 	if (asma->size == 0)
@@ -308,13 +420,13 @@ static ssize_t ashmem_read_iter(struct kiocb *iocb, struct iov_iter *iter)
 	 * be destroyed until all references to the file are dropped and
 	 * ashmem_release is called.
 	 */
-	mutex_unlock(&ashmem_mutex);
+	mutex_unlock(&asma->mutex);
 	ret = vfs_iter_read(asma->file, iter, &iocb->ki_pos, 0);
-	mutex_lock(&ashmem_mutex);
+	mutex_lock(&asma->mutex);
 	if (ret > 0)
 		asma->file->f_pos = iocb->ki_pos;
 out_unlock:
-	mutex_unlock(&ashmem_mutex);
+	mutex_unlock(&asma->mutex);
 	return ret;
 }
 
@@ -323,19 +435,19 @@ static loff_t ashmem_llseek(struct file *file, loff_t offset, int origin)
 	struct ashmem_area *asma = file->private_data;
 	loff_t ret;
 
-	mutex_lock(&ashmem_mutex);
+	mutex_lock(&asma->mutex);
 
 	if (asma->size == 0) {
-		mutex_unlock(&ashmem_mutex);
+		mutex_unlock(&asma->mutex);
 		return -EINVAL;
 	}
 
 	if (!asma->file) {
-		mutex_unlock(&ashmem_mutex);
+		mutex_unlock(&asma->mutex);
 		return -EBADF;
 	}
 
-	mutex_unlock(&ashmem_mutex);
+	mutex_unlock(&asma->mutex);
 
 	ret = vfs_llseek(asma->file, offset, origin);
 	if (ret < 0)
@@ -358,7 +470,7 @@ static int ashmem_mmap(struct file *file, struct vm_area_struct *vma)
 	struct ashmem_area *asma = file->private_data;
 	int ret = 0;
 
-	mutex_lock(&ashmem_mutex);
+	mutex_lock(&asma->mutex);
 
 	/* user needs to SET_SIZE before mapping */
 	if (!asma->size) {
@@ -417,7 +529,7 @@ static int ashmem_mmap(struct file *file, struct vm_area_struct *vma)
 	vma->vm_file = asma->file;
 
 out:
-	mutex_unlock(&ashmem_mutex);
+	mutex_unlock(&asma->mutex);
 	return ret;
 }
 
@@ -434,35 +546,77 @@ static int ashmem_mmap(struct file *file, struct vm_area_struct *vma)
  * We approximate LRU via least-recently-unpinned, jettisoning unpinned partial
  * chunks of ashmem regions LRU-wise one-at-a-time until we hit 'nr_to_scan'
  * pages freed.
+ *
+ * Only the area being purged is locked, and areas whose mutex is contended
+ * are rotated to the tail of the LRU instead of being waited for. Holding
+ * the area's mutex keeps the area and the range alive while ashmem_lru_lock
+ * is dropped for the hole punch.
+ *
+ * kswapd punches the holes itself. In direct reclaim the ranges are only
+ * marked purged and counted as freed, and ashmem_purge_work punches them
+ * out in batches per area, so that the allocating task doesn't wait on
+ * shmem truncation.
  */
 static unsigned long
 ashmem_shrink_scan(struct shrinker *shrink, struct shrink_control *sc)
 {
-	struct ashmem_range *range, *next;
+	struct ashmem_range *range;
+	struct ashmem_area *asma;
 	unsigned long freed = 0;
+	unsigned long skipped = 0;
+	bool defer = !current_is_kswapd();
+	bool queued = false;
 
 	/* We might recurse into filesystem code, so bail out if necessary */
 	if (!(sc->gfp_mask & __GFP_FS))
 		return SHRINK_STOP;
 
-	if (!mutex_trylock(&ashmem_mutex))
-		return -1;
-
-	list_for_each_entry_safe(range, next, &ashmem_lru_list, lru) {
-		loff_t start = range->pgstart * PAGE_SIZE;
-		loff_t end = (range->pgend + 1) * PAGE_SIZE;
+	spin_lock(&ashmem_lru_lock);
+	while (!list_empty(&ashmem_lru_list)) {
+		loff_t start, end;
+
+		range = list_first_entry(&ashmem_lru_list,
+					 struct ashmem_range, lru);
+		asma = range->asma;
+		if (!mutex_trylock(&asma->mutex)) {
+			list_move_tail(&range->lru, &ashmem_lru_list);
+			if (++skipped >= sc->nr_to_scan)
+				break;
+			continue;
+		}
 
-		range->asma->file->f_op->fallocate(range->asma->file,
-				FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE,
-				start, end - start);
 		range->purged = ASHMEM_WAS_PURGED;
 		lru_del(range);
-
 		freed += range_size(range);
+
+		if (defer) {
+			range->purge_pending = true;
+			asma->purge_pending++;
+			if (list_empty(&asma->purge_entry))
+				list_add_tail(&asma->purge_entry,
+					      &ashmem_purge_list);
+			mutex_unlock(&asma->mutex);
+			queued = true;
+			if (--sc->nr_to_scan <= 0)
+				break;
+			continue;
+		}
+		spin_unlock(&ashmem_lru_lock);
+
+		start = range->pgstart * PAGE_SIZE;
+		end = (range->pgend + 1) * PAGE_SIZE;
+		ashmem_punch(asma, start, end);
+		mutex_unlock(&asma->mutex);
+
 		if (--sc->nr_to_scan <= 0)
-			break;
+			return freed;
+		spin_lock(&ashmem_lru_lock);
 	}
-	mutex_unlock(&ashmem_mutex);
+	spin_unlock(&ashmem_lru_lock);
+
+	if (queued)
+		queue_delayed_work(system_unbound_wq, &ashmem_purge_work, 0);
+
 	return freed;
 }
 
@@ -491,7 +645,7 @@ static int set_prot_mask(struct ashmem_area *asma, unsigned long prot)
 {
 	int ret = 0;
 
-	mutex_lock(&ashmem_mutex);
+	mutex_lock(&asma->mutex);
 
 	/* the user can only remove, not add, protection bits */
 	if ((asma->prot_mask & prot) != prot) {
@@ -506,7 +660,7 @@ static int set_prot_mask(struct ashmem_area *asma, unsigned long prot)
 	asma->prot_mask = prot;
 
 out:
-	mutex_unlock(&ashmem_mutex);
+	mutex_unlock(&asma->mutex);
 	return ret;
 }
 
@@ -517,10 +671,10 @@ static int set_name(struct ashmem_area *asma, void __user *name)
 	char local_name[ASHMEM_NAME_LEN];
 
 	/*
-	 * Holding the ashmem_mutex while doing a copy_from_user might cause
+	 * Holding the asma->mutex while doing a copy_from_user might cause
 	 * an data abort which would try to access mmap_sem. If another
 	 * thread has invoked ashmem_mmap then it will be holding the
-	 * semaphore and will be waiting for ashmem_mutex, there by leading to
+	 * semaphore and will be waiting for asma->mutex, there by leading to
 	 * deadlock. We'll release the mutex  and take the name to a local
 	 * variable that does not need protection and later copy the local
 	 * variable to the structure member with lock held.
@@ -530,14 +684,14 @@ static int set_name(struct ashmem_area *asma, void __user *name)
 		return len;
 	if (len == ASHMEM_NAME_LEN)
 		local_name[ASHMEM_NAME_LEN - 1] = '\0';
-	mutex_lock(&ashmem_mutex);
+	mutex_lock(&asma->mutex);
 	/* cannot change an existing mapping's name */
 	if (asma->file)
 		ret = -EINVAL;
 	else
 		strcpy(asma->name + ASHMEM_NAME_PREFIX_LEN, local_name);
 
-	mutex_unlock(&ashmem_mutex);
+	mutex_unlock(&asma->mutex);
 	return ret;
 }
 
@@ -553,7 +707,7 @@ static int get_name(struct ashmem_area *asma, void __user *name)
 	 */
 	char local_name[ASHMEM_NAME_LEN];
 
-	mutex_lock(&ashmem_mutex);
+	mutex_lock(&asma->mutex);
 	if (asma->name[ASHMEM_NAME_PREFIX_LEN] != '\0') {
 		/*
 		 * Copying only `len', instead of ASHMEM_NAME_LEN, bytes
@@ -565,7 +719,7 @@ static int get_name(struct ashmem_area *asma, void __user *name)
 		len = sizeof(ASHMEM_NAME_DEF);
 		memcpy(local_name, ASHMEM_NAME_DEF, len);
 	}
-	mutex_unlock(&ashmem_mutex);
+	mutex_unlock(&asma->mutex);
 
 	/*
 	 * Now we are just copying from the stack variable to userland
@@ -580,65 +734,61 @@ static int get_name(struct ashmem_area *asma, void __user *name)
  * ashmem_pin - pin the given ashmem region, returning whether it was
  * previously purged (ASHMEM_WAS_PURGED) or not (ASHMEM_NOT_PURGED).
  *
- * Caller must hold ashmem_mutex.
+ * Caller must hold asma->mutex.
  */
 static int ashmem_pin(struct ashmem_area *asma, size_t pgstart, size_t pgend)
 {
-	struct ashmem_range *range, *next;
+	struct ashmem_range *range;
 	int ret = ASHMEM_NOT_PURGED;
 
-	list_for_each_entry_safe(range, next, &asma->unpinned_list, unpinned) {
-		/* moved past last applicable page; we can short circuit */
-		if (range_before_page(range, pgstart))
-			break;
+	/*
+	 * The user can ask us to pin pages that span multiple ranges,
+	 * or to pin pages that aren't even unpinned, so this is messy.
+	 *
+	 * Every range handled below stops overlapping the requested range,
+	 * so looking up the first overlap again finds the next one.
+	 *
+	 * Four cases:
+	 * 1. The requested range subsumes an existing range, so we
+	 *    just remove the entire matching range.
+	 * 2. The requested range overlaps the start of an existing
+	 *    range, so we just update that range.
+	 * 3. The requested range overlaps the end of an existing
+	 *    range, so we just update that range.
+	 * 4. The requested range punches a hole in an existing range,
+	 *    so we have to update one side of the range and then
+	 *    create a new range for the other side.
+	 */
+	while ((range = range_tree_iter_first(&asma->unpinned,
+					      pgstart, pgend))) {
+		ret |= range->purged;
 
-		/*
-		 * The user can ask us to pin pages that span multiple ranges,
-		 * or to pin pages that aren't even unpinned, so this is messy.
-		 *
-		 * Four cases:
-		 * 1. The requested range subsumes an existing range, so we
-		 *    just remove the entire matching range.
-		 * 2. The requested range overlaps the start of an existing
-		 *    range, so we just update that range.
-		 * 3. The requested range overlaps the end of an existing
-		 *    range, so we just update that range.
-		 * 4. The requested range punches a hole in an existing range,
-		 *    so we have to update one side of the range and then
-		 *    create a new range for the other side.
-		 */
-		if (page_range_in_range(range, pgstart, pgend)) {
-			ret |= range->purged;
-
-			/* Case #1: Easy. Just nuke the whole thing. */
-			if (page_range_subsumes_range(range, pgstart, pgend)) {
-				range_del(range);
-				continue;
-			}
-
-			/* Case #2: We overlap from the start, so adjust it */
-			if (range->pgstart >= pgstart) {
-				range_shrink(range, pgend + 1, range->pgend);
-				continue;
-			}
-
-			/* Case #3: We overlap from the rear, so adjust it */
-			if (range->pgend <= pgend) {
-				range_shrink(range, range->pgstart,
-					     pgstart - 1);
-				continue;
-			}
-
-			/*
-			 * Case #4: We eat a chunk out of the middle. A bit
-			 * more complicated, we allocate a new range for the
-			 * second half and adjust the first chunk's endpoint.
-			 */
-			range_alloc(asma, range, range->purged,
-				    pgend + 1, range->pgend);
+		/* Case #1: Easy. Just nuke the whole thing. */
+		if (page_range_subsumes_range(range, pgstart, pgend)) {
+			range_del(range);
+			continue;
+		}
+
+		/* Case #2: We overlap from the start, so adjust it */
+		if (range->pgstart >= pgstart) {
+			range_shrink(range, pgend + 1, range->pgend);
+			continue;
+		}
+
+		/* Case #3: We overlap from the rear, so adjust it */
+		if (range->pgend <= pgend) {
 			range_shrink(range, range->pgstart, pgstart - 1);
-			break;
+			continue;
 		}
+
+		/*
+		 * Case #4: We eat a chunk out of the middle. A bit
+		 * more complicated, we allocate a new range for the
+		 * second half and adjust the first chunk's endpoint.
+		 */
+		range_alloc(asma, range->purged, pgend + 1, range->pgend);
+		range_shrink(range, range->pgstart, pgstart - 1);
+		break;
 	}
 
 	return ret;
@@ -647,59 +797,43 @@ static int ashmem_pin(struct ashmem_area *asma, size_t pgstart, size_t pgend)
 /*
  * ashmem_unpin - unpin the given range of pages. Returns zero on success.
  *
- * Caller must hold ashmem_mutex.
+ * Caller must hold asma->mutex.
  */
 static int ashmem_unpin(struct ashmem_area *asma, size_t pgstart, size_t pgend)
 {
-	struct ashmem_range *range, *next;
+	struct ashmem_range *range;
 	unsigned int purged = ASHMEM_NOT_PURGED;
 
-restart:
-	list_for_each_entry_safe(range, next, &asma->unpinned_list, unpinned) {
-		/* short circuit: this is our insertion point */
-		if (range_before_page(range, pgstart))
-			break;
-
-		/*
-		 * The user can ask us to unpin pages that are already entirely
-		 * or partially pinned. We handle those two cases here.
-		 */
+	/*
+	 * The user can ask us to unpin pages that are already entirely
+	 * or partially pinned. We handle those two cases here.
+	 */
+	while ((range = range_tree_iter_first(&asma->unpinned,
+					      pgstart, pgend))) {
 		if (page_range_subsumed_by_range(range, pgstart, pgend))
 			return 0;
-		if (page_range_in_range(range, pgstart, pgend)) {
-			pgstart = min(range->pgstart, pgstart);
-			pgend = max(range->pgend, pgend);
-			purged |= range->purged;
-			range_del(range);
-			goto restart;
-		}
+		pgstart = min(range->pgstart, pgstart);
+		pgend = max(range->pgend, pgend);
+		purged |= range->purged;
+		range_del(range);
 	}
 
-	return range_alloc(asma, range, purged, pgstart, pgend);
+	return range_alloc(asma, purged, pgstart, pgend);
 }
 
 /*
  * ashmem_get_pin_status - Returns ASHMEM_IS_UNPINNED if _any_ pages in the
  * given interval are unpinned and ASHMEM_IS_PINNED otherwise.
  *
- * Caller must hold ashmem_mutex.
+ * Caller must hold asma->mutex.
  */
 static int ashmem_get_pin_status(struct ashmem_area *asma, size_t pgstart,
 				 size_t pgend)
 {
-	struct ashmem_range *range;
-	int ret = ASHMEM_IS_PINNED;
-
-	list_for_each_entry(range, &asma->unpinned_list, unpinned) {
-		if (range_before_page(range, pgstart))
-			break;
-		if (page_range_in_range(range, pgstart, pgend)) {
-			ret = ASHMEM_IS_UNPINNED;
-			break;
-		}
-	}
+	if (range_tree_iter_first(&asma->unpinned, pgstart, pgend))
+		return ASHMEM_IS_UNPINNED;
 
-	return ret;
+	return ASHMEM_IS_PINNED;
 }
 
 static int ashmem_pin_unpin(struct ashmem_area *asma, unsigned long cmd,
@@ -712,7 +846,7 @@ static int ashmem_pin_unpin(struct ashmem_area *asma, unsigned long cmd,
 	if (copy_from_user(&pin, p, sizeof(pin)))
 		return -EFAULT;
 
-	mutex_lock(&ashmem_mutex);
+	mutex_lock(&asma->mutex);
 
 	if (!asma->file)
 		goto out_unlock;
@@ -735,9 +869,11 @@ static int ashmem_pin_unpin(struct ashmem_area *asma, unsigned long cmd,
 
 	switch (cmd) {
 	case ASHMEM_PIN:
+		ashmem_purge_area(asma);
 		ret = ashmem_pin(asma, pgstart, pgend);
 		break;
 	case ASHMEM_UNPIN:
+		ashmem_purge_area(asma);
 		ret = ashmem_unpin(asma, pgstart, pgend);
 		break;
 	case ASHMEM_GET_PIN_STATUS:
@@ -746,7 +882,7 @@ static int ashmem_pin_unpin(struct ashmem_area *asma, unsigned long cmd,
 	}
 
 out_unlock:
-	mutex_unlock(&ashmem_mutex);
+	mutex_unlock(&asma->mutex);
 
 	return ret;
 }
@@ -765,12 +901,12 @@ static long ashmem_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
 		break;
 	case ASHMEM_SET_SIZE:
 		ret = -EINVAL;
-		mutex_lock(&ashmem_mutex);
+		mutex_lock(&asma->mutex);
 		if (!asma->file) {
 			ret = 0;
 			asma->size = (size_t)arg;
 		}
-		mutex_unlock(&ashmem_mutex);
+		mutex_unlock(&asma->mutex);
 		break;
 	case ASHMEM_GET_SIZE:
 		ret = asma->size;
@@ -795,6 +931,7 @@ static long ashmem_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
 			};
 			ret = ashmem_shrink_count(&ashmem_shrinker, &sc);
 			ashmem_shrink_scan(&ashmem_shrinker, &sc);
+			flush_delayed_work(&ashmem_purge_work);
 		}
 		break;
 	}
@@ -823,7 +960,7 @@ static void ashmem_show_fdinfo(struct seq_file *m, struct file *file)
 {
 	struct ashmem_area *asma = file->private_data;
 
-	mutex_lock(&ashmem_mutex);
+	mutex_lock(&asma->mutex);
 
 	if (asma->file)
 		seq_printf(m, "inode:\t%ld\n", file_inode(asma->file)->i_ino);
@@ -832,7 +969,7 @@ static void ashmem_show_fdinfo(struct seq_file *m, struct file *file)
 		seq_printf(m, "name:\t%s\n",
 			   asma->name + ASHMEM_NAME_PREFIX_LEN);
 
-	mutex_unlock(&ashmem_mutex);
+	mutex_unlock(&asma->mutex);
 }
 #endif
 static const struct file_operations ashmem_fops = {
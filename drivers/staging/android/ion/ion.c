@@ -195,10 +195,16 @@ static void free_duped_table(struct sg_table *table)
 	kfree(table);
 }
 
+/*
+ * The DMA mapping of an attachment is created on first map and kept until
+ * detach, importers that map the same buffer every frame then only pay
+ * for the cache maintenance. @dir is DMA_NONE while the table is unmapped.
+ */
 struct ion_dma_buf_attachment {
 	struct device *dev;
 	struct sg_table *table;
 	struct list_head list;
+	enum dma_data_direction dir;
 };
 
 static int ion_dma_buf_attach(struct dma_buf *dmabuf,
@@ -220,6 +226,7 @@ static int ion_dma_buf_attach(struct dma_buf *dmabuf,
 
 	a->table = table;
 	a->dev = attachment->dev;
+	a->dir = DMA_NONE;
 	INIT_LIST_HEAD(&a->list);
 
 	attachment->priv = a;
@@ -237,11 +244,16 @@ static void ion_dma_buf_detatch(struct dma_buf *dmabuf,
 	struct ion_dma_buf_attachment *a = attachment->priv;
 	struct ion_buffer *buffer = dmabuf->priv;
 
-	free_duped_table(a->table);
 	mutex_lock(&buffer->lock);
 	list_del(&a->list);
 	mutex_unlock(&buffer->lock);
 
+	/* The last unmap already synced for the cpu */
+	if (a->dir != DMA_NONE)
+		dma_unmap_sg_attrs(a->dev, a->table->sgl, a->table->nents,
+				   a->dir, DMA_ATTR_SKIP_CPU_SYNC);
+	free_duped_table(a->table);
+
 	kfree(a);
 }
 
@@ -253,9 +265,28 @@ static struct sg_table *ion_map_dma_buf(struct dma_buf_attachment *attachment,
 
 	table = a->table;
 
+	if (a->dir == direction || a->dir == DMA_BIDIRECTIONAL) {
+		dma_sync_sg_for_device(attachment->dev, table->sgl,
+				       table->nents, direction);
+		return table;
+	}
+
+	/*
+	 * Remap for a direction the existing mapping doesn't cover. The
+	 * unmap doesn't need a sync, the previous ion_unmap_dma_buf() did
+	 * it and the new mapping syncs for the device.
+	 */
+	if (a->dir != DMA_NONE) {
+		dma_unmap_sg_attrs(attachment->dev, table->sgl, table->nents,
+				   a->dir, DMA_ATTR_SKIP_CPU_SYNC);
+		direction = DMA_BIDIRECTIONAL;
+		a->dir = DMA_NONE;
+	}
+
 	if (!dma_map_sg(attachment->dev, table->sgl, table->nents,
 			direction))
 		return ERR_PTR(-ENOMEM);
+	a->dir = direction;
 
 	return table;
 }
@@ -264,7 +295,9 @@ static void ion_unmap_dma_buf(struct dma_buf_attachment *attachment,
 			      struct sg_table *table,
 			      enum dma_data_direction direction)
 {
-	dma_unmap_sg(attachment->dev, table->sgl, table->nents, direction);
+	/* Keep the mapping, it is torn down in ion_dma_buf_detatch() */
+	dma_sync_sg_for_cpu(attachment->dev, table->sgl, table->nents,
+			    direction);
 }
 
 static int ion_mmap(struct dma_buf *dmabuf, struct vm_area_struct *vma)
@@ -312,8 +345,51 @@ static void ion_dma_buf_kunmap(struct dma_buf *dmabuf, unsigned long offset,
 {
 }
 
-static int ion_dma_buf_begin_cpu_access(struct dma_buf *dmabuf,
-					enum dma_data_direction direction)
+/*
+ * Sync the part of an attachment's mapping that backs [offset, offset + len)
+ * of the buffer. The DMA segments cover the buffer in order, so walking
+ * their lengths gives the buffer offset of each one even if the IOMMU
+ * merged some of them.
+ */
+static void ion_sgl_sync_range(struct device *dev, struct sg_table *table,
+			       unsigned int offset, unsigned int len,
+			       enum dma_data_direction direction, bool for_cpu)
+{
+	struct scatterlist *sg;
+	unsigned int pos = 0;
+	int i;
+
+	for_each_sg(table->sgl, sg, table->nents, i) {
+		unsigned int seg_len = sg_dma_len(sg);
+		unsigned int start, end;
+
+		if (pos + seg_len <= offset) {
+			pos += seg_len;
+			continue;
+		}
+
+		start = max(offset, pos) - pos;
+		end = min(offset + len, pos + seg_len) - pos;
+		if (for_cpu)
+			dma_sync_single_range_for_cpu(dev, sg_dma_address(sg),
+						      start, end - start,
+						      direction);
+		else
+			dma_sync_single_range_for_device(dev,
+							 sg_dma_address(sg),
+							 start, end - start,
+							 direction);
+
+		pos += seg_len;
+		if (pos >= offset + len)
+			break;
+	}
+}
+
+static int __ion_dma_buf_begin_cpu_access(struct dma_buf *dmabuf,
+					  enum dma_data_direction direction,
+					  unsigned int offset,
+					  unsigned int len)
 {
 	struct ion_buffer *buffer = dmabuf->priv;
 	void *vaddr;
@@ -335,8 +411,12 @@ static int ion_dma_buf_begin_cpu_access(struct dma_buf *dmabuf,
 
 	mutex_lock(&buffer->lock);
 	list_for_each_entry(a, &buffer->attachments, list) {
-		dma_sync_sg_for_cpu(a->dev, a->table->sgl, a->table->nents,
-				    direction);
+		if (offset == 0 && len == buffer->size)
+			dma_sync_sg_for_cpu(a->dev, a->table->sgl,
+					    a->table->nents, direction);
+		else
+			ion_sgl_sync_range(a->dev, a->table, offset, len,
+					   direction, true);
 	}
 
 unlock:
@@ -344,8 +424,27 @@ static int ion_dma_buf_begin_cpu_access(struct dma_buf *dmabuf,
 	return ret;
 }
 
-static int ion_dma_buf_end_cpu_access(struct dma_buf *dmabuf,
-				      enum dma_data_direction direction)
+static int ion_dma_buf_begin_cpu_access(struct dma_buf *dmabuf,
+					enum dma_data_direction direction)
+{
+	struct ion_buffer *buffer = dmabuf->priv;
+
+	return __ion_dma_buf_begin_cpu_access(dmabuf, direction, 0,
+					      buffer->size);
+}
+
+static int ion_dma_buf_begin_cpu_access_partial(struct dma_buf *dmabuf,
+						enum dma_data_direction direction,
+						unsigned int offset,
+						unsigned int len)
+{
+	return __ion_dma_buf_begin_cpu_access(dmabuf, direction, offset, len);
+}
+
+static int __ion_dma_buf_end_cpu_access(struct dma_buf *dmabuf,
+					enum dma_data_direction direction,
+					unsigned int offset,
+					unsigned int len)
 {
 	struct ion_buffer *buffer = dmabuf->priv;
 	struct ion_dma_buf_attachment *a;
@@ -358,14 +457,35 @@ static int ion_dma_buf_end_cpu_access(struct dma_buf *dmabuf,
 
 	mutex_lock(&buffer->lock);
 	list_for_each_entry(a, &buffer->attachments, list) {
-		dma_sync_sg_for_device(a->dev, a->table->sgl, a->table->nents,
-				       direction);
+		if (offset == 0 && len == buffer->size)
+			dma_sync_sg_for_device(a->dev, a->table->sgl,
+					       a->table->nents, direction);
+		else
+			ion_sgl_sync_range(a->dev, a->table, offset, len,
+					   direction, false);
 	}
 	mutex_unlock(&buffer->lock);
 
 	return 0;
 }
 
+static int ion_dma_buf_end_cpu_access(struct dma_buf *dmabuf,
+				      enum dma_data_direction direction)
+{
+	struct ion_buffer *buffer = dmabuf->priv;
+
+	return __ion_dma_buf_end_cpu_access(dmabuf, direction, 0,
+					    buffer->size);
+}
+
+static int ion_dma_buf_end_cpu_access_partial(struct dma_buf *dmabuf,
+					      enum dma_data_direction direction,
+					      unsigned int offset,
+					      unsigned int len)
+{
+	return __ion_dma_buf_end_cpu_access(dmabuf, direction, offset, len);
+}
+
 static const struct dma_buf_ops dma_buf_ops = {
 	.map_dma_buf = ion_map_dma_buf,
 	.unmap_dma_buf = ion_unmap_dma_buf,
@@ -375,6 +495,8 @@ static const struct dma_buf_ops dma_buf_ops = {
 	.detach = ion_dma_buf_detatch,
 	.begin_cpu_access = ion_dma_buf_begin_cpu_access,
 	.end_cpu_access = ion_dma_buf_end_cpu_access,
+	.begin_cpu_access_partial = ion_dma_buf_begin_cpu_access_partial,
+	.end_cpu_access_partial = ion_dma_buf_end_cpu_access_partial,
 	.map = ion_dma_buf_kmap,
 	.unmap = ion_dma_buf_kunmap,
 };
@@ -524,6 +646,25 @@ static int debug_shrink_get(void *data, u64 *val)
 DEFINE_SIMPLE_ATTRIBUTE(debug_shrink_fops, debug_shrink_get,
 			debug_shrink_set, "%llu\n");
 
+static int debug_heap_show(struct seq_file *s, void *unused)
+{
+	struct ion_heap *heap = s->private;
+
+	return heap->debug_show(heap, s, unused);
+}
+
+static int debug_heap_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, debug_heap_show, inode->i_private);
+}
+
+static const struct file_operations debug_heap_fops = {
+	.open = debug_heap_open,
+	.read = seq_read,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
 void ion_device_add_heap(struct ion_heap *heap)
 {
 	struct ion_device *dev = internal_dev;
@@ -563,6 +704,10 @@ void ion_device_add_heap(struct ion_heap *heap)
 				    heap, &debug_shrink_fops);
 	}
 
+	if (heap->debug_show)
+		debugfs_create_file(heap->name, 0444, dev->debug_root,
+				    heap, &debug_heap_fops);
+
 	dev->heap_cnt++;
 	up_write(&dev->lock);
 }
@@ -13,9 +13,12 @@
 #include <linux/kref.h>
 #include <linux/mm_types.h>
 #include <linux/mutex.h>
+#include <linux/percpu.h>
 #include <linux/rbtree.h>
 #include <linux/sched.h>
 #include <linux/shrinker.h>
+#include <linux/sizes.h>
+#include <linux/spinlock.h>
 #include <linux/types.h>
 #include <linux/miscdevice.h>
 
@@ -283,6 +286,22 @@ size_t ion_heap_freelist_size(struct ion_heap *heap);
  * many systems
  */
 
+#define ION_PAGE_POOL_PCP_MAX	32
+#define ION_PAGE_POOL_PCP_BYTES	SZ_256K
+
+/**
+ * struct ion_page_pool_pcp - per-cpu magazine in front of a page pool
+ * @lock:		protects @count and @pages, normally only taken by
+ *			the owning cpu
+ * @count:		number of pages in @pages
+ * @pages:		cached pages, most recently freed last
+ */
+struct ion_page_pool_pcp {
+	spinlock_t lock;
+	int count;
+	struct page *pages[ION_PAGE_POOL_PCP_MAX];
+};
+
 /**
  * struct ion_page_pool - pagepool struct
  * @high_count:		number of highmem items in the pool
@@ -294,6 +313,12 @@ size_t ion_heap_freelist_size(struct ion_heap *heap);
  * @gfp_mask:		gfp_mask to use from alloc
  * @order:		order of pages in the pool
  * @list:		plist node for list of pools
+ * @pcp:		per-cpu magazines, or NULL if the order is too large
+ *			to cache per cpu
+ * @pcp_high:		number of pages a magazine holds before it is
+ *			drained to the pool
+ * @pcp_batch:		number of pages moved between a magazine and the
+ *			pool at a time
  *
  * Allows you to keep a pool of pre allocated pages to use from your heap.
  * Keeping a pool of pages that is ready for dma, ie any cached mapping have
@@ -309,6 +334,9 @@ struct ion_page_pool {
 	gfp_t gfp_mask;
 	unsigned int order;
 	struct plist_node list;
+	struct ion_page_pool_pcp __percpu *pcp;
+	int pcp_high;
+	int pcp_batch;
 };
 
 struct ion_page_pool *ion_page_pool_create(gfp_t gfp_mask, unsigned int order);
@@ -326,6 +354,87 @@ void ion_page_pool_free(struct ion_page_pool *pool, struct page *page);
 int ion_page_pool_shrink(struct ion_page_pool *pool, gfp_t gfp_mask,
 			 int nr_to_scan);
 
+/**
+ * ion_page_pool_pcp_count - number of items cached in per-cpu magazines
+ * @pool:		the pool
+ */
+int ion_page_pool_pcp_count(struct ion_page_pool *pool);
+
+/**
+ * ion_page_pool_count - number of items in the pool, including magazines
+ * @pool:		the pool
+ *
+ * The result is not synchronized with concurrent allocs and frees and is
+ * only meant as a hint.
+ */
+int ion_page_pool_count(struct ion_page_pool *pool);
+
+/**
+ * ion_page_pool_prefill - add one freshly allocated item to the pool
+ * @pool:		the pool
+ * @gfp_mask:		extra flags for the allocation
+ *
+ * The allocation never enters reclaim. Pools are created with __GFP_ZERO
+ * so the page is cleared before it is added. Returns false if no page
+ * could be allocated.
+ */
+bool ion_page_pool_prefill(struct ion_page_pool *pool, gfp_t gfp_mask);
+
+/* Enough orders for any carveout, e.g. 2^31 4K pages */
+#define ION_BUDDY_ORDERS	32
+
+/**
+ * struct ion_buddy - buddy allocator over a reserved memory range
+ * @lock:		protects everything below
+ * @base_pfn:		first pfn of the range
+ * @nr_blocks:		size of the range, in blocks
+ * @block_order:	page order of a block, the allocation granularity
+ * @free_list:		free blocks of each order, linked through the
+ *			lru of their first page
+ * @nr_free:		number of free blocks of each order
+ * @free_blocks:	number of free blocks, whatever the order
+ * @alloc_fail:		number of allocations that found no free block
+ *
+ * Used by the carveout and chunk heaps instead of a gen_pool, whose
+ * bitmap scan gets slower as the range grows and fragments. Allocations
+ * and frees take a bounded number of steps. The free lists use the
+ * struct pages of the range, nothing is stored in the memory itself so
+ * it can be protected from the CPU.
+ */
+struct ion_buddy {
+	spinlock_t lock;
+	unsigned long base_pfn;
+	unsigned long nr_blocks;
+	unsigned int block_order;
+	struct list_head free_list[ION_BUDDY_ORDERS];
+	unsigned long nr_free[ION_BUDDY_ORDERS];
+	unsigned long free_blocks;
+	unsigned long alloc_fail;
+};
+
+void ion_buddy_init(struct ion_buddy *buddy, phys_addr_t base, size_t size,
+		    unsigned int block_order);
+
+/**
+ * ion_buddy_alloc - allocate physically contiguous memory
+ * @buddy:		the allocator
+ * @size:		bytes to allocate, rounded up to a block
+ * @paddr:		returns the physical address of the memory
+ *
+ * The power of two block the request is carved from is trimmed back to
+ * the requested size, so at most one block is lost to rounding. Returns
+ * 0 or -ENOMEM.
+ */
+int ion_buddy_alloc(struct ion_buddy *buddy, size_t size, phys_addr_t *paddr);
+void ion_buddy_free(struct ion_buddy *buddy, phys_addr_t paddr, size_t size);
+
+/**
+ * ion_buddy_debug_show - print free space and fragmentation statistics
+ * @buddy:		the allocator
+ * @s:			seq_file of the heap debug file
+ */
+void ion_buddy_debug_show(struct ion_buddy *buddy, struct seq_file *s);
+
 long ion_ioctl(struct file *filp, unsigned int cmd, unsigned long arg);
 
 int ion_query_heaps(struct ion_heap_query *query);
@@ -0,0 +1,205 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * drivers/staging/android/ion/ion_buddy.c
+ *
+ * Buddy allocator for the carveout and chunk heaps
+ *
+ * Blocks are indexed from the start of the range. A free block of order n
+ * starts at an index aligned to 2^n and is linked in free_list[n] through
+ * the lru of its first page, whose private field holds n + 1. All other
+ * pages of the range have a zero private field.
+ */
+#include <linux/kernel.h>
+#include <linux/log2.h>
+#include <linux/mm.h>
+#include <linux/seq_file.h>
+#include <linux/spinlock.h>
+#include "ion.h"
+
+static struct page *ion_buddy_page(struct ion_buddy *buddy, unsigned long idx)
+{
+	return pfn_to_page(buddy->base_pfn + (idx << buddy->block_order));
+}
+
+static unsigned long ion_buddy_count(struct ion_buddy *buddy, size_t size)
+{
+	return DIV_ROUND_UP(size, PAGE_SIZE << buddy->block_order);
+}
+
+static unsigned long ion_buddy_idx(struct ion_buddy *buddy, struct page *page)
+{
+	return (page_to_pfn(page) - buddy->base_pfn) >> buddy->block_order;
+}
+
+static void ion_buddy_add(struct ion_buddy *buddy, unsigned long idx,
+			  unsigned int order)
+{
+	struct page *page = ion_buddy_page(buddy, idx);
+
+	set_page_private(page, order + 1);
+	list_add(&page->lru, &buddy->free_list[order]);
+	buddy->nr_free[order]++;
+}
+
+static void ion_buddy_del(struct ion_buddy *buddy, struct page *page,
+			  unsigned int order)
+{
+	list_del(&page->lru);
+	set_page_private(page, 0);
+	buddy->nr_free[order]--;
+}
+
+/* Free the block of order @order at @idx, merging it with free buddies */
+static void ion_buddy_free_block(struct ion_buddy *buddy, unsigned long idx,
+				 unsigned int order)
+{
+	while (order < ION_BUDDY_ORDERS - 1) {
+		unsigned long buddy_idx = idx ^ (1UL << order);
+		struct page *page;
+
+		if (buddy_idx + (1UL << order) > buddy->nr_blocks)
+			break;
+
+		page = ion_buddy_page(buddy, buddy_idx);
+		if (page_private(page) != order + 1)
+			break;
+
+		ion_buddy_del(buddy, page, order);
+		idx &= buddy_idx;
+		order++;
+	}
+
+	ion_buddy_add(buddy, idx, order);
+}
+
+/* Free @count blocks at @idx, as the largest aligned blocks they hold */
+static void ion_buddy_free_range(struct ion_buddy *buddy, unsigned long idx,
+				 unsigned long count)
+{
+	while (count) {
+		unsigned int order = ilog2(count);
+
+		if (idx)
+			order = min_t(unsigned int, order, __ffs(idx));
+		order = min_t(unsigned int, order, ION_BUDDY_ORDERS - 1);
+
+		ion_buddy_free_block(buddy, idx, order);
+		idx += 1UL << order;
+		count -= 1UL << order;
+	}
+}
+
+void ion_buddy_init(struct ion_buddy *buddy, phys_addr_t base, size_t size,
+		    unsigned int block_order)
+{
+	unsigned long idx;
+	int i;
+
+	spin_lock_init(&buddy->lock);
+	buddy->base_pfn = PFN_DOWN(base);
+	buddy->block_order = block_order;
+	buddy->nr_blocks = size >> (PAGE_SHIFT + block_order);
+	for (i = 0; i < ION_BUDDY_ORDERS; i++) {
+		INIT_LIST_HEAD(&buddy->free_list[i]);
+		buddy->nr_free[i] = 0;
+	}
+	buddy->alloc_fail = 0;
+
+	for (idx = 0; idx < buddy->nr_blocks; idx++)
+		set_page_private(ion_buddy_page(buddy, idx), 0);
+
+	ion_buddy_free_range(buddy, 0, buddy->nr_blocks);
+	buddy->free_blocks = buddy->nr_blocks;
+}
+
+int ion_buddy_alloc(struct ion_buddy *buddy, size_t size, phys_addr_t *paddr)
+{
+	unsigned long count = ion_buddy_count(buddy, size);
+	unsigned int order, i;
+	unsigned long idx;
+	struct page *page;
+
+	if (!count)
+		return -ENOMEM;
+
+	order = order_base_2(count);
+	if (order >= ION_BUDDY_ORDERS)
+		return -ENOMEM;
+
+	spin_lock(&buddy->lock);
+
+	for (i = order; i < ION_BUDDY_ORDERS; i++)
+		if (!list_empty(&buddy->free_list[i]))
+			break;
+
+	if (i == ION_BUDDY_ORDERS) {
+		buddy->alloc_fail++;
+		spin_unlock(&buddy->lock);
+		return -ENOMEM;
+	}
+
+	page = list_first_entry(&buddy->free_list[i], struct page, lru);
+	ion_buddy_del(buddy, page, i);
+	idx = ion_buddy_idx(buddy, page);
+
+	/* Split down to the order of the request... */
+	while (i > order) {
+		i--;
+		ion_buddy_add(buddy, idx + (1UL << i), i);
+	}
+
+	/* ...and give back what is past its end */
+	if (count < (1UL << order))
+		ion_buddy_free_range(buddy, idx + count,
+				     (1UL << order) - count);
+
+	buddy->free_blocks -= count;
+
+	spin_unlock(&buddy->lock);
+
+	*paddr = PFN_PHYS(buddy->base_pfn + (idx << buddy->block_order));
+	return 0;
+}
+
+void ion_buddy_free(struct ion_buddy *buddy, phys_addr_t paddr, size_t size)
+{
+	unsigned long count = ion_buddy_count(buddy, size);
+	unsigned long idx = (PHYS_PFN(paddr) - buddy->base_pfn) >>
+			    buddy->block_order;
+
+	spin_lock(&buddy->lock);
+	ion_buddy_free_range(buddy, idx, count);
+	buddy->free_blocks += count;
+	spin_unlock(&buddy->lock);
+}
+
+void ion_buddy_debug_show(struct ion_buddy *buddy, struct seq_file *s)
+{
+	unsigned long block_size = PAGE_SIZE << buddy->block_order;
+	unsigned long nr_free[ION_BUDDY_ORDERS];
+	unsigned long free_blocks, alloc_fail, largest = 0;
+	int i;
+
+	spin_lock(&buddy->lock);
+	memcpy(nr_free, buddy->nr_free, sizeof(nr_free));
+	free_blocks = buddy->free_blocks;
+	alloc_fail = buddy->alloc_fail;
+	spin_unlock(&buddy->lock);
+
+	for (i = 0; i < ION_BUDDY_ORDERS; i++) {
+		if (!nr_free[i])
+			continue;
+		seq_printf(s, "%lu free order %d blocks %lu total\n",
+			   nr_free[i], i, (block_size << i) * nr_free[i]);
+		largest = block_size << i;
+	}
+
+	seq_printf(s, "free %lu of %lu bytes, largest free block %lu bytes\n",
+		   free_blocks * block_size, buddy->nr_blocks * block_size,
+		   largest);
+	/* Share of the free space that is not in the largest block */
+	seq_printf(s, "fragmentation %lu%%\n",
+		   free_blocks ?
+		   100 - largest * 100 / (free_blocks * block_size) : 0);
+	seq_printf(s, "%lu failed allocations\n", alloc_fail);
+}
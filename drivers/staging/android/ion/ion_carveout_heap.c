@@ -7,46 +7,20 @@
 #include <linux/spinlock.h>
 #include <linux/dma-mapping.h>
 #include <linux/err.h>
-#include <linux/genalloc.h>
 #include <linux/io.h>
 #include <linux/mm.h>
 #include <linux/scatterlist.h>
+#include <linux/seq_file.h>
 #include <linux/slab.h>
 #include <linux/vmalloc.h>
 #include "ion.h"
 
-#define ION_CARVEOUT_ALLOCATE_FAIL	-1
-
 struct ion_carveout_heap {
 	struct ion_heap heap;
-	struct gen_pool *pool;
+	struct ion_buddy buddy;
 	phys_addr_t base;
 };
 
-static phys_addr_t ion_carveout_allocate(struct ion_heap *heap,
-					 unsigned long size)
-{
-	struct ion_carveout_heap *carveout_heap =
-		container_of(heap, struct ion_carveout_heap, heap);
-	unsigned long offset = gen_pool_alloc(carveout_heap->pool, size);
-
-	if (!offset)
-		return ION_CARVEOUT_ALLOCATE_FAIL;
-
-	return offset;
-}
-
-static void ion_carveout_free(struct ion_heap *heap, phys_addr_t addr,
-			      unsigned long size)
-{
-	struct ion_carveout_heap *carveout_heap =
-		container_of(heap, struct ion_carveout_heap, heap);
-
-	if (addr == ION_CARVEOUT_ALLOCATE_FAIL)
-		return;
-	gen_pool_free(carveout_heap->pool, addr, size);
-}
-
 static int ion_carveout_heap_allocate(struct ion_heap *heap,
 				      struct ion_buffer *buffer,
 				      unsigned long size,
@@ -54,6 +28,8 @@ static int ion_carveout_heap_allocate(struct ion_heap *heap,
 {
 	struct sg_table *table;
 	phys_addr_t paddr;
+	struct ion_carveout_heap *carveout_heap =
+		container_of(heap, struct ion_carveout_heap, heap);
 	int ret;
 
 	table = kmalloc(sizeof(*table), GFP_KERNEL);
@@ -63,11 +39,9 @@ static int ion_carveout_heap_allocate(struct ion_heap *heap,
 	if (ret)
 		goto err_free;
 
-	paddr = ion_carveout_allocate(heap, size);
-	if (paddr == ION_CARVEOUT_ALLOCATE_FAIL) {
-		ret = -ENOMEM;
+	ret = ion_buddy_alloc(&carveout_heap->buddy, size, &paddr);
+	if (ret)
 		goto err_free_table;
-	}
 
 	sg_set_page(table->sgl, pfn_to_page(PFN_DOWN(paddr)), size, 0);
 	buffer->sg_table = table;
@@ -83,18 +57,29 @@ static int ion_carveout_heap_allocate(struct ion_heap *heap,
 
 static void ion_carveout_heap_free(struct ion_buffer *buffer)
 {
-	struct ion_heap *heap = buffer->heap;
+	struct ion_carveout_heap *carveout_heap =
+		container_of(buffer->heap, struct ion_carveout_heap, heap);
 	struct sg_table *table = buffer->sg_table;
 	struct page *page = sg_page(table->sgl);
 	phys_addr_t paddr = PFN_PHYS(page_to_pfn(page));
 
 	ion_heap_buffer_zero(buffer);
 
-	ion_carveout_free(heap, paddr, buffer->size);
+	ion_buddy_free(&carveout_heap->buddy, paddr, buffer->size);
 	sg_free_table(table);
 	kfree(table);
 }
 
+static int ion_carveout_heap_debug_show(struct ion_heap *heap,
+					struct seq_file *s, void *unused)
+{
+	struct ion_carveout_heap *carveout_heap =
+		container_of(heap, struct ion_carveout_heap, heap);
+
+	ion_buddy_debug_show(&carveout_heap->buddy, s);
+	return 0;
+}
+
 static struct ion_heap_ops carveout_heap_ops = {
 	.allocate = ion_carveout_heap_allocate,
 	.free = ion_carveout_heap_free,
@@ -122,17 +107,13 @@ struct ion_heap *ion_carveout_heap_create(struct ion_platform_heap *heap_data)
 	if (!carveout_heap)
 		return ERR_PTR(-ENOMEM);
 
-	carveout_heap->pool = gen_pool_create(PAGE_SHIFT, -1);
-	if (!carveout_heap->pool) {
-		kfree(carveout_heap);
-		return ERR_PTR(-ENOMEM);
-	}
 	carveout_heap->base = heap_data->base;
-	gen_pool_add(carveout_heap->pool, carveout_heap->base, heap_data->size,
-		     -1);
+	ion_buddy_init(&carveout_heap->buddy, carveout_heap->base,
+		       heap_data->size, 0);
 	carveout_heap->heap.ops = &carveout_heap_ops;
 	carveout_heap->heap.type = ION_HEAP_TYPE_CARVEOUT;
 	carveout_heap->heap.flags = ION_HEAP_FLAG_DEFER_FREE;
+	carveout_heap->heap.debug_show = ion_carveout_heap_debug_show;
 
 	return &carveout_heap->heap;
 }
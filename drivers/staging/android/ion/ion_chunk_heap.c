@@ -6,17 +6,17 @@
  */
 #include <linux/dma-mapping.h>
 #include <linux/err.h>
-#include <linux/genalloc.h>
 #include <linux/io.h>
 #include <linux/mm.h>
 #include <linux/scatterlist.h>
+#include <linux/seq_file.h>
 #include <linux/slab.h>
 #include <linux/vmalloc.h>
 #include "ion.h"
 
 struct ion_chunk_heap {
 	struct ion_heap heap;
-	struct gen_pool *pool;
+	struct ion_buddy buddy;
 	phys_addr_t base;
 	unsigned long chunk_size;
 	unsigned long size;
@@ -53,9 +53,10 @@ static int ion_chunk_heap_allocate(struct ion_heap *heap,
 
 	sg = table->sgl;
 	for (i = 0; i < num_chunks; i++) {
-		unsigned long paddr = gen_pool_alloc(chunk_heap->pool,
-						     chunk_heap->chunk_size);
-		if (!paddr)
+		phys_addr_t paddr;
+
+		if (ion_buddy_alloc(&chunk_heap->buddy, chunk_heap->chunk_size,
+				    &paddr))
 			goto err;
 		sg_set_page(sg, pfn_to_page(PFN_DOWN(paddr)),
 			    chunk_heap->chunk_size, 0);
@@ -68,8 +69,8 @@ static int ion_chunk_heap_allocate(struct ion_heap *heap,
 err:
 	sg = table->sgl;
 	for (i -= 1; i >= 0; i--) {
-		gen_pool_free(chunk_heap->pool, page_to_phys(sg_page(sg)),
-			      sg->length);
+		ion_buddy_free(&chunk_heap->buddy, page_to_phys(sg_page(sg)),
+			       sg->length);
 		sg = sg_next(sg);
 	}
 	sg_free_table(table);
@@ -92,14 +93,27 @@ static void ion_chunk_heap_free(struct ion_buffer *buffer)
 	ion_heap_buffer_zero(buffer);
 
 	for_each_sg(table->sgl, sg, table->nents, i) {
-		gen_pool_free(chunk_heap->pool, page_to_phys(sg_page(sg)),
-			      sg->length);
+		ion_buddy_free(&chunk_heap->buddy, page_to_phys(sg_page(sg)),
+			       sg->length);
 	}
 	chunk_heap->allocated -= allocated_size;
 	sg_free_table(table);
 	kfree(table);
 }
 
+static int ion_chunk_heap_debug_show(struct ion_heap *heap,
+				     struct seq_file *s, void *unused)
+{
+	struct ion_chunk_heap *chunk_heap =
+		container_of(heap, struct ion_chunk_heap, heap);
+
+	seq_printf(s, "chunk size %lu, %lu of %lu bytes allocated\n",
+		   chunk_heap->chunk_size, chunk_heap->allocated,
+		   chunk_heap->size);
+	ion_buddy_debug_show(&chunk_heap->buddy, s);
+	return 0;
+}
+
 static struct ion_heap_ops chunk_heap_ops = {
 	.allocate = ion_chunk_heap_allocate,
 	.free = ion_chunk_heap_free,
@@ -127,27 +141,19 @@ struct ion_heap *ion_chunk_heap_create(struct ion_platform_heap *heap_data)
 		return ERR_PTR(-ENOMEM);
 
 	chunk_heap->chunk_size = (unsigned long)heap_data->priv;
-	chunk_heap->pool = gen_pool_create(get_order(chunk_heap->chunk_size) +
-					   PAGE_SHIFT, -1);
-	if (!chunk_heap->pool) {
-		ret = -ENOMEM;
-		goto error_gen_pool_create;
-	}
 	chunk_heap->base = heap_data->base;
 	chunk_heap->size = heap_data->size;
 	chunk_heap->allocated = 0;
 
-	gen_pool_add(chunk_heap->pool, chunk_heap->base, heap_data->size, -1);
+	ion_buddy_init(&chunk_heap->buddy, chunk_heap->base, heap_data->size,
+		       get_order(chunk_heap->chunk_size));
 	chunk_heap->heap.ops = &chunk_heap_ops;
 	chunk_heap->heap.type = ION_HEAP_TYPE_CHUNK;
 	chunk_heap->heap.flags = ION_HEAP_FLAG_DEFER_FREE;
+	chunk_heap->heap.debug_show = ion_chunk_heap_debug_show;
 	pr_debug("%s: base %pa size %zu\n", __func__,
 		 &chunk_heap->base, heap_data->size);
 
 	return &chunk_heap->heap;
-
-error_gen_pool_create:
-	kfree(chunk_heap);
-	return ERR_PTR(ret);
 }
 
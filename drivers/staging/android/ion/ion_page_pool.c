@@ -6,6 +6,7 @@
  */
 
 #include <linux/list.h>
+#include <linux/percpu.h>
 #include <linux/slab.h>
 #include <linux/swap.h>
 
@@ -22,9 +23,16 @@ static void ion_page_pool_free_pages(struct ion_page_pool *pool,
 	__free_pages(page, pool->order);
 }
 
-static void ion_page_pool_add(struct ion_page_pool *pool, struct page *page)
+static void ion_page_pool_account(struct ion_page_pool *pool,
+				  struct page *page, int sign)
+{
+	mod_node_page_state(page_pgdat(page), NR_INDIRECTLY_RECLAIMABLE_BYTES,
+			    sign * (1 << (PAGE_SHIFT + pool->order)));
+}
+
+static void ion_page_pool_add_locked(struct ion_page_pool *pool,
+				     struct page *page)
 {
-	mutex_lock(&pool->mutex);
 	if (PageHighMem(page)) {
 		list_add_tail(&page->lru, &pool->high_items);
 		pool->high_count++;
@@ -32,9 +40,16 @@ static void ion_page_pool_add(struct ion_page_pool *pool, struct page *page)
 		list_add_tail(&page->lru, &pool->low_items);
 		pool->low_count++;
 	}
+}
 
-	mod_node_page_state(page_pgdat(page), NR_INDIRECTLY_RECLAIMABLE_BYTES,
-			    (1 << (PAGE_SHIFT + pool->order)));
+static void ion_page_pool_add(struct ion_page_pool *pool,
+			      struct page **pages, int nr)
+{
+	int i;
+
+	mutex_lock(&pool->mutex);
+	for (i = 0; i < nr; i++)
+		ion_page_pool_add_locked(pool, pages[i]);
 	mutex_unlock(&pool->mutex);
 }
 
@@ -53,25 +68,147 @@ static struct page *ion_page_pool_remove(struct ion_page_pool *pool, bool high)
 	}
 
 	list_del(&page->lru);
-	mod_node_page_state(page_pgdat(page), NR_INDIRECTLY_RECLAIMABLE_BYTES,
-			    -(1 << (PAGE_SHIFT + pool->order)));
 	return page;
 }
 
-struct page *ion_page_pool_alloc(struct ion_page_pool *pool)
+static struct page *ion_page_pool_remove_any(struct ion_page_pool *pool)
+{
+	if (pool->high_count)
+		return ion_page_pool_remove(pool, true);
+	if (pool->low_count)
+		return ion_page_pool_remove(pool, false);
+	return NULL;
+}
+
+static struct page *ion_page_pool_pcp_pop(struct ion_page_pool *pool)
 {
+	struct ion_page_pool_pcp *pcp;
 	struct page *page = NULL;
 
-	BUG_ON(!pool);
+	pcp = get_cpu_ptr(pool->pcp);
+	spin_lock(&pcp->lock);
+	if (pcp->count)
+		page = pcp->pages[--pcp->count];
+	spin_unlock(&pcp->lock);
+	put_cpu_ptr(pool->pcp);
+
+	return page;
+}
+
+/*
+ * Move a batch of pages from the pool into the local magazine under a
+ * single acquisition of the pool mutex and return one of them.
+ */
+static struct page *ion_page_pool_pcp_refill(struct ion_page_pool *pool)
+{
+	struct page *pages[ION_PAGE_POOL_PCP_MAX];
+	struct ion_page_pool_pcp *pcp;
+	struct page *page;
+	int nr = 0;
 
 	mutex_lock(&pool->mutex);
-	if (pool->high_count)
-		page = ion_page_pool_remove(pool, true);
-	else if (pool->low_count)
-		page = ion_page_pool_remove(pool, false);
+	while (nr < pool->pcp_batch) {
+		page = ion_page_pool_remove_any(pool);
+		if (!page)
+			break;
+		pages[nr++] = page;
+	}
 	mutex_unlock(&pool->mutex);
 
-	if (!page)
+	if (!nr)
+		return NULL;
+	page = pages[--nr];
+
+	pcp = get_cpu_ptr(pool->pcp);
+	spin_lock(&pcp->lock);
+	while (nr && pcp->count < pool->pcp_high)
+		pcp->pages[pcp->count++] = pages[--nr];
+	spin_unlock(&pcp->lock);
+	put_cpu_ptr(pool->pcp);
+
+	/* The magazine filled up under us, give the rest back */
+	if (nr)
+		ion_page_pool_add(pool, pages, nr);
+
+	return page;
+}
+
+static void ion_page_pool_pcp_free(struct ion_page_pool *pool,
+				   struct page *page)
+{
+	struct page *pages[ION_PAGE_POOL_PCP_MAX];
+	struct ion_page_pool_pcp *pcp;
+	int nr = 0;
+
+	pcp = get_cpu_ptr(pool->pcp);
+	spin_lock(&pcp->lock);
+	if (pcp->count == pool->pcp_high) {
+		/* Keep the most recently freed, cache hot, pages local */
+		nr = pool->pcp_batch;
+		memcpy(pages, pcp->pages, nr * sizeof(*pages));
+		pcp->count -= nr;
+		memmove(pcp->pages, pcp->pages + nr,
+			pcp->count * sizeof(*pages));
+	}
+	pcp->pages[pcp->count++] = page;
+	spin_unlock(&pcp->lock);
+	put_cpu_ptr(pool->pcp);
+
+	if (nr)
+		ion_page_pool_add(pool, pages, nr);
+}
+
+static void ion_page_pool_pcp_drain(struct ion_page_pool *pool)
+{
+	struct page *pages[ION_PAGE_POOL_PCP_MAX];
+	struct ion_page_pool_pcp *pcp;
+	int cpu, nr;
+
+	for_each_possible_cpu(cpu) {
+		pcp = per_cpu_ptr(pool->pcp, cpu);
+		spin_lock(&pcp->lock);
+		nr = pcp->count;
+		memcpy(pages, pcp->pages, nr * sizeof(*pages));
+		pcp->count = 0;
+		spin_unlock(&pcp->lock);
+
+		if (nr)
+			ion_page_pool_add(pool, pages, nr);
+	}
+}
+
+int ion_page_pool_pcp_count(struct ion_page_pool *pool)
+{
+	int cpu, count = 0;
+
+	if (!pool->pcp)
+		return 0;
+
+	for_each_possible_cpu(cpu)
+		count += READ_ONCE(per_cpu_ptr(pool->pcp, cpu)->count);
+
+	return count;
+}
+
+struct page *ion_page_pool_alloc(struct ion_page_pool *pool)
+{
+	struct page *page;
+
+	BUG_ON(!pool);
+
+	if (pool->pcp) {
+		page = ion_page_pool_pcp_pop(pool);
+		if (!page)
+			page = ion_page_pool_pcp_refill(pool);
+	} else {
+		mutex_lock(&pool->mutex);
+		page = ion_page_pool_remove_any(pool);
+		mutex_unlock(&pool->mutex);
+	}
+
+	if (page)
+		ion_page_pool_account(pool, page, -1);
+	else
 		page = ion_page_pool_alloc_pages(pool);
 
 	return page;
@@ -81,12 +218,36 @@ void ion_page_pool_free(struct ion_page_pool *pool, struct page *page)
 {
 	BUG_ON(pool->order != compound_order(page));
 
-	ion_page_pool_add(pool, page);
+	ion_page_pool_account(pool, page, 1);
+	if (pool->pcp)
+		ion_page_pool_pcp_free(pool, page);
+	else
+		ion_page_pool_add(pool, &page, 1);
+}
+
+bool ion_page_pool_prefill(struct ion_page_pool *pool, gfp_t gfp_mask)
+{
+	struct page *page;
+
+	page = alloc_pages((pool->gfp_mask | gfp_mask) & ~__GFP_RECLAIM,
+			   pool->order);
+	if (!page)
+		return false;
+
+	ion_page_pool_account(pool, page, 1);
+	ion_page_pool_add(pool, &page, 1);
+	return true;
+}
+
+int ion_page_pool_count(struct ion_page_pool *pool)
+{
+	return READ_ONCE(pool->high_count) + READ_ONCE(pool->low_count) +
+	       ion_page_pool_pcp_count(pool);
 }
 
 static int ion_page_pool_total(struct ion_page_pool *pool, bool high)
 {
-	int count = pool->low_count;
+	int count = pool->low_count + ion_page_pool_pcp_count(pool);
 
 	if (high)
 		count += pool->high_count;
@@ -108,6 +269,9 @@ int ion_page_pool_shrink(struct ion_page_pool *pool, gfp_t gfp_mask,
 	if (nr_to_scan == 0)
 		return ion_page_pool_total(pool, high);
 
+	if (pool->pcp)
+		ion_page_pool_pcp_drain(pool);
+
 	while (freed < nr_to_scan) {
 		struct page *page;
 
@@ -121,6 +285,7 @@ int ion_page_pool_shrink(struct ion_page_pool *pool, gfp_t gfp_mask,
 			break;
 		}
 		mutex_unlock(&pool->mutex);
+		ion_page_pool_account(pool, page, -1);
 		ion_page_pool_free_pages(pool, page);
 		freed += (1 << pool->order);
 	}
@@ -131,6 +296,7 @@ int ion_page_pool_shrink(struct ion_page_pool *pool, gfp_t gfp_mask,
 struct ion_page_pool *ion_page_pool_create(gfp_t gfp_mask, unsigned int order)
 {
 	struct ion_page_pool *pool = kmalloc(sizeof(*pool), GFP_KERNEL);
+	int cpu;
 
 	if (!pool)
 		return NULL;
@@ -143,10 +309,41 @@ struct ion_page_pool *ion_page_pool_create(gfp_t gfp_mask, unsigned int order)
 	mutex_init(&pool->mutex);
 	plist_node_init(&pool->list, order);
 
+	/*
+	 * Only cache orders small enough that a magazine of at least two
+	 * items fits in ION_PAGE_POOL_PCP_BYTES. The magazines are an
+	 * optimization, the pool works without them.
+	 */
+	pool->pcp = NULL;
+	pool->pcp_high = min_t(int, ION_PAGE_POOL_PCP_BYTES >>
+			       (PAGE_SHIFT + order), ION_PAGE_POOL_PCP_MAX);
+	pool->pcp_batch = pool->pcp_high / 2;
+	if (pool->pcp_high >= 2)
+		pool->pcp = alloc_percpu(struct ion_page_pool_pcp);
+	if (pool->pcp) {
+		for_each_possible_cpu(cpu)
+			spin_lock_init(&per_cpu_ptr(pool->pcp, cpu)->lock);
+	}
+
 	return pool;
 }
 
 void ion_page_pool_destroy(struct ion_page_pool *pool)
 {
+	struct ion_page_pool_pcp *pcp;
+	struct page *page;
+	int cpu;
+
+	if (pool->pcp) {
+		for_each_possible_cpu(cpu) {
+			pcp = per_cpu_ptr(pool->pcp, cpu);
+			while (pcp->count) {
+				page = pcp->pages[--pcp->count];
+				ion_page_pool_account(pool, page, -1);
+				ion_page_pool_free_pages(pool, page);
+			}
+		}
+		free_percpu(pool->pcp);
+	}
 	kfree(pool);
 }
@@ -8,20 +8,56 @@
 #include <asm/page.h>
 #include <linux/dma-mapping.h>
 #include <linux/err.h>
+#include <linux/freezer.h>
 #include <linux/highmem.h>
+#include <linux/kthread.h>
 #include <linux/mm.h>
+#include <linux/moduleparam.h>
 #include <linux/scatterlist.h>
 #include <linux/seq_file.h>
 #include <linux/slab.h>
 #include <linux/vmalloc.h>
+#include <uapi/linux/sched/types.h>
 #include "ion.h"
 
 #define NUM_ORDERS ARRAY_SIZE(orders)
 
+/*
+ * With 4K pages also pool PMD sized chunks, which keeps large scanout and
+ * codec buffers down to a few sg entries. Those allocations don't stall in
+ * direct reclaim or compaction but do wake kswapd, and with it kcompactd,
+ * so that later attempts are more likely to succeed. Like THP, sizes that
+ * can't be had fall back to the next order down.
+ */
+#if PAGE_SHIFT == 12 && MAX_ORDER > 9
+#define ION_HUGE_ORDER 9
+#endif
+
+static gfp_t huge_order_gfp_flags = (GFP_HIGHUSER | __GFP_ZERO | __GFP_NOWARN |
+				     __GFP_NORETRY) & ~__GFP_DIRECT_RECLAIM;
 static gfp_t high_order_gfp_flags = (GFP_HIGHUSER | __GFP_ZERO | __GFP_NOWARN |
 				     __GFP_NORETRY) & ~__GFP_RECLAIM;
 static gfp_t low_order_gfp_flags  = GFP_HIGHUSER | __GFP_ZERO;
-static const unsigned int orders[] = {8, 4, 0};
+static const unsigned int orders[] = {
+#ifdef ION_HUGE_ORDER
+	ION_HUGE_ORDER,
+#endif
+	8, 4, 0
+};
+
+/*
+ * Number of bytes per order the background thread keeps zeroed and ready
+ * in the pools, 0 disables it. Refilling starts once a pool drops below
+ * half of this.
+ */
+static unsigned long prezero_bytes = SZ_4M;
+module_param(prezero_bytes, ulong, 0644);
+MODULE_PARM_DESC(prezero_bytes,
+		 "Bytes per order to keep pre-zeroed in the page pools");
+
+/* Back off from refilling for this long after reclaim or a failed refill */
+#define ION_PREZERO_BACKOFF	HZ
+#define ION_PREZERO_BATCH	16
 
 static int order_to_index(unsigned int order)
 {
@@ -42,8 +78,107 @@ static inline unsigned int order_to_size(int order)
 struct ion_system_heap {
 	struct ion_heap heap;
 	struct ion_page_pool *pools[NUM_ORDERS];
+	struct task_struct *prezero_task;
+	wait_queue_head_t prezero_wait;
+	unsigned long prezero_backoff;
 };
 
+static int prezero_target(struct ion_page_pool *pool)
+{
+	return READ_ONCE(prezero_bytes) >> (PAGE_SHIFT + pool->order);
+}
+
+static bool prezero_throttled(struct ion_system_heap *heap)
+{
+	return time_before(jiffies, READ_ONCE(heap->prezero_backoff));
+}
+
+static void prezero_backoff(struct ion_system_heap *heap)
+{
+	WRITE_ONCE(heap->prezero_backoff, jiffies + ION_PREZERO_BACKOFF);
+}
+
+static bool prezero_needed(struct ion_system_heap *heap)
+{
+	int i;
+
+	if (prezero_throttled(heap))
+		return false;
+
+	for (i = 0; i < NUM_ORDERS; i++) {
+		struct ion_page_pool *pool = heap->pools[i];
+
+		if (ion_page_pool_count(pool) < prezero_target(pool) / 2)
+			return true;
+	}
+
+	return false;
+}
+
+/*
+ * Keep a watermark of zeroed pages in each pool so that allocations don't
+ * have to clear fresh pages. The thread runs as SCHED_IDLE, never enters
+ * reclaim to get pages, and stops for ION_PREZERO_BACKOFF when the pools
+ * are being shrunk or the page allocator can't satisfy it.
+ */
+static int ion_system_heap_prezero(void *data)
+{
+	struct ion_system_heap *heap = data;
+	int i, n, target;
+
+	set_freezable();
+
+	while (!kthread_should_stop()) {
+		wait_event_freezable(heap->prezero_wait,
+				     prezero_needed(heap) ||
+				     kthread_should_stop());
+
+		for (i = 0; i < NUM_ORDERS; i++) {
+			struct ion_page_pool *pool = heap->pools[i];
+
+			target = prezero_target(pool);
+			n = 0;
+			while (ion_page_pool_count(pool) < target) {
+				if (prezero_throttled(heap) ||
+				    kthread_should_stop())
+					break;
+				if (!ion_page_pool_prefill(pool, __GFP_NORETRY |
+							   __GFP_NOWARN)) {
+					prezero_backoff(heap);
+					break;
+				}
+				if (++n % ION_PREZERO_BATCH == 0)
+					cond_resched();
+			}
+		}
+	}
+
+	return 0;
+}
+
+static void prezero_init(struct ion_system_heap *heap)
+{
+	struct sched_param param = { .sched_priority = 0 };
+
+	init_waitqueue_head(&heap->prezero_wait);
+	heap->prezero_backoff = jiffies;
+	heap->prezero_task = kthread_run(ion_system_heap_prezero, heap,
+					 "ion_prezero");
+	if (IS_ERR(heap->prezero_task)) {
+		pr_warn("%s: creating thread for pre-zeroing failed\n",
+			__func__);
+		heap->prezero_task = NULL;
+		return;
+	}
+	sched_setscheduler(heap->prezero_task, SCHED_IDLE, &param);
+}
+
+static void prezero_kick(struct ion_system_heap *heap)
+{
+	if (heap->prezero_task && prezero_needed(heap))
+		wake_up(&heap->prezero_wait);
+}
+
 static struct page *alloc_buffer_page(struct ion_system_heap *heap,
 				      struct ion_buffer *buffer,
 				      unsigned long order)
@@ -139,6 +274,7 @@ static int ion_system_heap_allocate(struct ion_heap *heap,
 	}
 
 	buffer->sg_table = table;
+	prezero_kick(sys_heap);
 	return 0;
 
 free_table:
@@ -181,6 +317,8 @@ static int ion_system_heap_shrink(struct ion_heap *heap, gfp_t gfp_mask,
 
 	if (!nr_to_scan)
 		only_scan = 1;
+	else
+		prezero_backoff(sys_heap);
 
 	for (i = 0; i < NUM_ORDERS; i++) {
 		pool = sys_heap->pools[i];
@@ -218,7 +356,7 @@ static int ion_system_heap_debug_show(struct ion_heap *heap, struct seq_file *s,
 	struct ion_system_heap *sys_heap = container_of(heap,
 							struct ion_system_heap,
 							heap);
-	int i;
+	int i, count;
 	struct ion_page_pool *pool;
 
 	for (i = 0; i < NUM_ORDERS; i++) {
@@ -230,6 +368,10 @@ static int ion_system_heap_debug_show(struct ion_heap *heap, struct seq_file *s,
 		seq_printf(s, "%d order %u lowmem pages %lu total\n",
 			   pool->low_count, pool->order,
 			   (PAGE_SIZE << pool->order) * pool->low_count);
+		count = ion_page_pool_pcp_count(pool);
+		seq_printf(s, "%d order %u per-cpu cached pages %lu total\n",
+			   count, pool->order,
+			   (PAGE_SIZE << pool->order) * count);
 	}
 
 	return 0;
@@ -247,13 +389,17 @@ static void ion_system_heap_destroy_pools(struct ion_page_pool **pools)
 static int ion_system_heap_create_pools(struct ion_page_pool **pools)
 {
 	int i;
-	gfp_t gfp_flags = low_order_gfp_flags;
+	gfp_t gfp_flags;
 
 	for (i = 0; i < NUM_ORDERS; i++) {
 		struct ion_page_pool *pool;
 
-		if (orders[i] > 4)
+		if (orders[i] > 8)
+			gfp_flags = huge_order_gfp_flags;
+		else if (orders[i] > 4)
 			gfp_flags = high_order_gfp_flags;
+		else
+			gfp_flags = low_order_gfp_flags;
 
 		pool = ion_page_pool_create(gfp_flags, orders[i]);
 		if (!pool)
@@ -282,6 +428,7 @@ static struct ion_heap *__ion_system_heap_create(void)
 		goto free_heap;
 
 	heap->heap.debug_show = ion_system_heap_debug_show;
+	prezero_init(heap);
 	return &heap->heap;
 
 free_heap:
@@ -26,6 +26,8 @@
 #include <linux/pci.h>
 #include <linux/proc_fs.h>
 #include <linux/sched.h>
+#include <linux/sched/clock.h>
+#include <linux/sched/signal.h>
 #include <linux/syscalls.h>
 #include <linux/uaccess.h>
 #include <linux/interrupt.h>
@@ -128,6 +130,16 @@ struct vsoc_device {
 
 static struct vsoc_device vsoc_dev;
 
+/*
+ * Frame handoff through a region typically signals within a few
+ * microseconds, so waiting for it by polling the shared word is cheaper
+ * than going to sleep and being woken by an interrupt.
+ */
+static unsigned int spin_wait_us = 20;
+module_param(spin_wait_us, uint, 0644);
+MODULE_PARM_DESC(spin_wait_us,
+		 "Microseconds to poll shared memory before sleeping in a wait");
+
 /*
  * TODO(ghartman): Add a /sys filesystem entry that summarizes the permissions.
  */
@@ -392,6 +404,29 @@ static long do_vsoc_describe_region(struct file *filp,
 	return 0;
 }
 
+/**
+ * Polls @address for up to spin_wait_us while it still holds @value.
+ * Returns true if the value changed, false if the caller has to sleep.
+ */
+static bool vsoc_spin_while_equal(atomic_t *address, int value)
+{
+	unsigned int spin_us = READ_ONCE(spin_wait_us);
+	u64 end;
+
+	if (!spin_us)
+		return false;
+
+	end = local_clock() + (u64)spin_us * NSEC_PER_USEC;
+	do {
+		if (atomic_read(address) != value)
+			return true;
+		cpu_relax();
+	} while (!need_resched() && !signal_pending(current) &&
+		 local_clock() < end);
+
+	return false;
+}
+
 /**
  * Implements the inner logic of cond_wait. Copies to and from userspace are
  * done in the helper function below.
@@ -422,19 +457,22 @@ static int handle_vsoc_cond_wait(struct file *filp, struct vsoc_cond_wait *arg)
 	case VSOC_WAIT_IF_EQUAL:
 		break;
 	case VSOC_WAIT_IF_EQUAL_TIMEOUT:
+		if (arg->wake_time_nsec >= NSEC_PER_SEC)
+			return -EINVAL;
 		to = &timeout;
 		break;
 	default:
 		return -EINVAL;
 	}
 
+	if (vsoc_spin_while_equal(address, arg->value))
+		return 0;
+
 	if (to) {
 		/* Copy the user-supplied timesec into the kernel structure.
 		 * We do things this way to flatten differences between 32 bit
 		 * and 64 bit timespecs.
 		 */
-		if (arg->wake_time_nsec >= NSEC_PER_SEC)
-			return -EINVAL;
 		wake_time = ktime_set(arg->wake_time_sec, arg->wake_time_nsec);
 
 		hrtimer_init_on_stack(&to->timer, CLOCK_MONOTONIC,
@@ -523,8 +561,13 @@ static int do_vsoc_cond_wake(struct file *filp, uint32_t offset)
 	 * We need to wake every sleeper when the condition changes. Typically
 	 * only a single thread will be waiting on the condition, but there
 	 * are exceptions. The worst case is about 10 threads.
+	 *
+	 * Waiters that are still polling the word in vsoc_spin_while_equal()
+	 * aren't on the queue, so skip taking the queue lock when it's empty.
+	 * This pairs with the barrier in prepare_to_wait().
 	 */
-	wake_up_interruptible_all(&data->futex_wait_queue);
+	if (wq_has_sleeper(&data->futex_wait_queue))
+		wake_up_interruptible_all(&data->futex_wait_queue);
 	return 0;
 }
 
@@ -593,6 +636,8 @@ static long vsoc_ioctl(struct file *filp, unsigned int cmd, unsigned long arg)
 		writel(reg_num, vsoc_dev.regs + DOORBELL);
 		return 0;
 	case VSOC_WAIT_FOR_INCOMING_INTERRUPT:
+		if (vsoc_spin_while_equal(reg_data->incoming_signalled, 0))
+			break;
 		wait_event_interruptible
 			(reg_data->interrupt_wait_queue,
 			 (atomic_read(reg_data->incoming_signalled) != 0));
@@ -1118,6 +1163,27 @@ static ssize_t vsoc_get_area(struct file *filp, __u32 *area_offset)
 	return length;
 }
 
+/*
+ * Large mappings are populated on fault instead of by io_remap_pfn_range(),
+ * so that mmap() doesn't have to walk the whole region up front.
+ * vm_private_data holds the shared memory offset that corresponds to
+ * vm_pgoff 0, which stays valid across vma splits.
+ */
+static vm_fault_t vsoc_vm_fault(struct vm_fault *vmf)
+{
+	struct vm_area_struct *vma = vmf->vma;
+	phys_addr_t phys;
+
+	phys = shm_off_to_phys_addr((unsigned long)vma->vm_private_data) +
+	       ((phys_addr_t)vma->vm_pgoff << PAGE_SHIFT) +
+	       (vmf->address - vma->vm_start);
+	return vmf_insert_pfn(vma, vmf->address, phys >> PAGE_SHIFT);
+}
+
+static const struct vm_operations_struct vsoc_vm_ops = {
+	.fault = vsoc_vm_fault,
+};
+
 static int vsoc_mmap(struct file *filp, struct vm_area_struct *vma)
 {
 	unsigned long len = vma->vm_end - vma->vm_start;
@@ -1136,6 +1202,19 @@ static int vsoc_mmap(struct file *filp, struct vm_area_struct *vma)
 		return -EINVAL;
 	vma->vm_page_prot = pgprot_noncached(vma->vm_page_prot);
 	mem_off = shm_off_to_phys_addr(area_off);
+	/*
+	 * vmf_insert_pfn() can't back a private writable (COW) mapping,
+	 * leave those to io_remap_pfn_range().
+	 */
+	if (len >= PMD_SIZE &&
+	    (vma->vm_flags & (VM_SHARED | VM_MAYWRITE)) != VM_MAYWRITE) {
+		vma->vm_flags |= VM_PFNMAP | VM_IO | VM_DONTEXPAND |
+				 VM_DONTDUMP;
+		vma->vm_private_data = (void *)(unsigned long)
+			(area_off - (vma->vm_pgoff << PAGE_SHIFT));
+		vma->vm_ops = &vsoc_vm_ops;
+		return 0;
+	}
 	if (io_remap_pfn_range(vma, vma->vm_start, mem_off >> PAGE_SHIFT,
 			       len, vma->vm_page_prot))
 		return -EAGAIN;
@@ -0,0 +1,24 @@
+#ifndef _TRUSTY_BATCH_H_
+#define _TRUSTY_BATCH_H_
+
+#include <linux/types.h>
+
+struct device;
+
+/*
+ * One standard call of a batch issued by trusty_std_call32_batch(). The
+ * return value of the call is stored in @ret once it has been issued.
+ */
+struct trusty_std_call32_req {
+	u32 smcnr;
+	u32 a0;
+	u32 a1;
+	u32 a2;
+	s32 ret;
+};
+
+int trusty_std_call32_batch(struct device *dev,
+			    struct trusty_std_call32_req *reqs,
+			    unsigned int count);
+
+#endif
@@ -14,12 +14,14 @@
 
 #include <linux/aio.h>
 #include <linux/kernel.h>
+#include <linux/mm.h>
 #include <linux/module.h>
 #include <linux/cdev.h>
 #include <linux/slab.h>
 #include <linux/fs.h>
 #include <linux/poll.h>
 #include <linux/idr.h>
+#include <linux/sizes.h>
 #include <linux/completion.h>
 #include <linux/version.h>
 #if LINUX_VERSION_CODE >= KERNEL_VERSION(4, 14, 0)
@@ -41,6 +43,7 @@
 #define VIRTIO_ID_TRUSTY_IPC   13 /* virtio trusty ipc */
 
 #define REPLY_TIMEOUT			5000
+#define SHM_ACK_TIMEOUT			REPLY_TIMEOUT
 #define TXBUF_TIMEOUT			15000
 
 #define PULSE_ACTIVE                    1
@@ -57,8 +60,17 @@
 
 #define TIPC_MIN_LOCAL_ADDR		1024
 
+#define TIPC_MSG_FLAG_SHM		0x1
+#define TIPC_MSG_FLAG_SHM_ACK		0x2 /* remote is done with the buffer */
+#define TIPC_SHM_MAX_SIZE		SZ_16M
+
+/* device accepts TIPC_MSG_FLAG_SHM messages */
+#define VIRTIO_TIPC_F_SHM		1
+
 #define TIPC_IOC_MAGIC			'r'
 #define TIPC_IOC_CONNECT		_IOW(TIPC_IOC_MAGIC, 0x80, char *)
+#define TIPC_IOC_SEND_SHM		_IOW(TIPC_IOC_MAGIC, 0x81, \
+					     struct tipc_shm_req)
 #if defined(CONFIG_COMPAT)
 #define TIPC_IOC_CONNECT_COMPAT		_IOW(TIPC_IOC_MAGIC, 0x80, \
 					     compat_uptr_t)
@@ -66,6 +78,24 @@
 
 struct tipc_virtio_dev;
 
+/*
+ * TIPC_IOC_SEND_SHM request: sends the @msg_len bytes at @msg as a regular
+ * message, and shares @buf_len bytes at @buf with the remote service in
+ * place instead of copying them. The buffer stays shared until the service
+ * sends a message flagged TIPC_MSG_FLAG_SHM_ACK, or the channel goes away.
+ * Fails with -EOPNOTSUPP unless the device offers VIRTIO_TIPC_F_SHM.
+ */
+struct tipc_shm_req {
+	__u64 msg;
+	__u64 msg_len;
+	__u64 buf;
+	__u64 buf_len;
+	__u32 flags;
+	__u32 reserved;
+} __packed;
+
+#define TIPC_SHM_REQ_WRITE		0x1 /* remote may write to the buffer */
+
 struct tipc_dev_config {
 	u32 msg_buf_max_size;
 	u32 msg_buf_alignment;
@@ -81,6 +111,21 @@ struct tipc_msg_hdr {
 	u8 data[0];
 } __packed;
 
+/*
+ * Leads the payload of a TIPC_MSG_FLAG_SHM message. @page_list is the
+ * encoded first page of a physically contiguous array of @page_cnt
+ * ns_mem_page_info entries, one per page of the shared buffer. The data
+ * starts @offset bytes into the first page and is @size bytes long.
+ */
+struct tipc_shm_desc {
+	u64 page_list;
+	u32 page_cnt;
+	u32 offset;
+	u64 size;
+	u32 flags;
+	u32 reserved;
+} __packed;
+
 enum tipc_ctrl_msg_types {
 	TIPC_CTRL_MSGTYPE_GO_ONLINE = 1,
 	TIPC_CTRL_MSGTYPE_GO_OFFLINE,
@@ -139,6 +184,7 @@ struct tipc_virtio_dev {
 	enum tipc_device_state state;
 	struct tipc_cdev_node cdev_node;
 	char   cdev_name[MAX_DEV_NAME_LEN];
+	bool shm_supported;
 };
 
 enum tipc_chan_state {
@@ -485,14 +531,15 @@ static struct tipc_chan *vds_create_channel(struct tipc_virtio_dev *vds,
 	return chan;
 }
 
-static void fill_msg_hdr(struct tipc_msg_buf *mb, u32 src, u32 dst)
+static void fill_msg_hdr(struct tipc_msg_buf *mb, u32 src, u32 dst,
+			 u16 flags)
 {
 	struct tipc_msg_hdr *hdr = mb_get_data(mb, sizeof(*hdr));
 
 	hdr->src = src;
 	hdr->dst = dst;
 	hdr->len = mb_avail_data(mb);
-	hdr->flags = 0;
+	hdr->flags = flags;
 	hdr->reserved = 0;
 }
 
@@ -551,14 +598,15 @@ void tipc_chan_put_txbuf(struct tipc_chan *chan, struct tipc_msg_buf *mb)
 }
 EXPORT_SYMBOL(tipc_chan_put_txbuf);
 
-int tipc_chan_queue_msg(struct tipc_chan *chan, struct tipc_msg_buf *mb)
+static int _chan_queue_msg(struct tipc_chan *chan, struct tipc_msg_buf *mb,
+			   u16 flags)
 {
 	int err;
 
 	mutex_lock(&chan->lock);
 	switch (chan->state) {
 	case TIPC_CONNECTED:
-		fill_msg_hdr(mb, chan->local, chan->remote);
+		fill_msg_hdr(mb, chan->local, chan->remote, flags);
 		err = vds_queue_txbuf(chan->vds, mb);
 		if (err) {
 			/* this should never happen */
@@ -581,6 +629,11 @@ int tipc_chan_queue_msg(struct tipc_chan *chan, struct tipc_msg_buf *mb)
 	mutex_unlock(&chan->lock);
 	return err;
 }
+
+int tipc_chan_queue_msg(struct tipc_chan *chan, struct tipc_msg_buf *mb)
+{
+	return _chan_queue_msg(chan, mb, 0);
+}
 EXPORT_SYMBOL(tipc_chan_queue_msg);
 
 
@@ -612,7 +665,7 @@ int tipc_chan_connect(struct tipc_chan *chan, const char *name)
 		/* save service name we are connecting to */
 		strcpy(chan->srv_name, body->name);
 
-		fill_msg_hdr(txbuf, chan->local, TIPC_CTRL_ADDR);
+		fill_msg_hdr(txbuf, chan->local, TIPC_CTRL_ADDR, 0);
 		err = vds_queue_txbuf(chan->vds, txbuf);
 		if (err) {
 			/* this should never happen */
@@ -675,7 +728,7 @@ int tipc_chan_shutdown(struct tipc_chan *chan)
 		msg->body_len = sizeof(*body);
 		body->target = chan->remote;
 
-		fill_msg_hdr(txbuf, chan->local, TIPC_CTRL_ADDR);
+		fill_msg_hdr(txbuf, chan->local, TIPC_CTRL_ADDR, 0);
 		err = vds_queue_txbuf(chan->vds, txbuf);
 		if (err) {
 			/* this should never happen */
@@ -712,6 +765,15 @@ EXPORT_SYMBOL(tipc_chan_destroy);
 
 /***************************************************************************/
 
+struct tipc_shm {
+	struct page **pages;
+	uint page_cnt;
+	bool write;
+	struct ns_mem_page_info *page_list;
+	size_t page_list_sz;
+	phys_addr_t page_list_pa;
+};
+
 struct tipc_dn_chan {
 	int pulse;
 	int state;
@@ -720,8 +782,85 @@ struct tipc_dn_chan {
 	wait_queue_head_t readq;
 	struct completion reply_comp;
 	struct list_head rx_msg_queue;
+	struct tipc_shm *shm; /* buffer shared until acked */
 };
 
+static void _free_shm(struct tipc_shm *shm)
+{
+	uint i;
+
+	if (!shm)
+		return;
+
+	for (i = 0; i < shm->page_cnt; i++) {
+		if (shm->write)
+			set_page_dirty_lock(shm->pages[i]);
+		put_page(shm->pages[i]);
+	}
+	if (shm->page_list)
+		_free_shareable_mem(shm->page_list_sz, shm->page_list,
+				    shm->page_list_pa);
+	kvfree(shm->pages);
+	kfree(shm);
+}
+
+static struct tipc_shm *_create_shm(unsigned long addr, size_t len, bool write)
+{
+	struct tipc_shm *shm;
+	uint i;
+	int ret;
+
+	shm = kzalloc(sizeof(*shm), GFP_KERNEL);
+	if (!shm)
+		return ERR_PTR(-ENOMEM);
+
+	shm->write = write;
+	i = DIV_ROUND_UP(offset_in_page(addr) + len, PAGE_SIZE);
+	shm->pages = kvmalloc_array(i, sizeof(*shm->pages), GFP_KERNEL);
+	if (!shm->pages) {
+		ret = -ENOMEM;
+		goto err;
+	}
+
+	ret = get_user_pages_fast(addr & PAGE_MASK, i, write, shm->pages);
+	if (ret > 0)
+		shm->page_cnt = ret;
+	if (ret != i) {
+		ret = ret < 0 ? ret : -EFAULT;
+		goto err;
+	}
+
+	shm->page_list_sz = PAGE_ALIGN(i * sizeof(*shm->page_list));
+	shm->page_list = _alloc_shareable_mem(shm->page_list_sz,
+					      &shm->page_list_pa, GFP_KERNEL);
+	if (!shm->page_list) {
+		ret = -ENOMEM;
+		goto err;
+	}
+
+	for (i = 0; i < shm->page_cnt; i++) {
+		ret = trusty_encode_page_info(&shm->page_list[i],
+					      shm->pages[i],
+					      write ? PAGE_KERNEL :
+						      PAGE_KERNEL_RO);
+		if (ret)
+			goto err;
+	}
+
+	return shm;
+
+err:
+	_free_shm(shm);
+	return ERR_PTR(ret);
+}
+
+/* must be called with dn->lock held */
+static void dn_release_shm(struct tipc_dn_chan *dn)
+{
+	_free_shm(dn->shm);
+	WRITE_ONCE(dn->shm, NULL);
+}
+
 static int dn_wait_for_reply(struct tipc_dn_chan *dn, int timeout)
 {
 	int ret;
@@ -758,8 +897,15 @@ struct tipc_msg_buf *dn_handle_msg(void *data, struct tipc_msg_buf *rxbuf)
 {
 	struct tipc_dn_chan *dn = data;
 	struct tipc_msg_buf *newbuf = rxbuf;
+	struct tipc_msg_hdr *hdr = rxbuf->buf_va;
 
 	mutex_lock(&dn->lock);
+	/* the remote hands a shared buffer back explicitly */
+	if (hdr->flags & TIPC_MSG_FLAG_SHM_ACK) {
+		dn_release_shm(dn);
+		/* tipc_release() may be waiting for it */
+		wake_up_interruptible_all(&dn->readq);
+	}
 	if (dn->state == TIPC_CONNECTED) {
 		/* get new buffer */
 		newbuf = tipc_chan_get_rxbuf(dn->chan);
@@ -798,6 +944,9 @@ static void dn_disconnected(struct tipc_dn_chan *dn)
 	mutex_lock(&dn->lock);
 	dn->state = TIPC_DISCONNECTED;
 
+	/* a disconnected remote can't be using a shared buffer any more */
+	dn_release_shm(dn);
+
 	/* complete all pending  */
 	complete(&dn->reply_comp);
 
@@ -938,6 +1087,93 @@ static int dn_connect_ioctl(struct tipc_dn_chan *dn, char __user *usr_name)
 	return dn_wait_for_reply(dn, REPLY_TIMEOUT);
 }
 
+static int dn_send_shm_ioctl(struct tipc_dn_chan *dn,
+			     struct tipc_shm_req __user *usr_req)
+{
+	int ret;
+	struct tipc_shm_req req;
+	struct tipc_shm_desc *desc;
+	struct tipc_shm *shm;
+	struct tipc_msg_buf *txbuf;
+	struct ns_mem_page_info list_inf;
+
+	if (!dn->chan->vds->shm_supported)
+		return -EOPNOTSUPP;
+
+	if (copy_from_user(&req, usr_req, sizeof(req)))
+		return -EFAULT;
+
+	if ((req.flags & ~TIPC_SHM_REQ_WRITE) || req.reserved)
+		return -EINVAL;
+	if (!req.buf_len || req.buf_len > TIPC_SHM_MAX_SIZE)
+		return -EINVAL;
+
+	txbuf = tipc_chan_get_txbuf_timeout(dn->chan, TXBUF_TIMEOUT);
+	if (IS_ERR(txbuf))
+		return PTR_ERR(txbuf);
+
+	if (req.msg_len > mb_avail_space(txbuf) - sizeof(*desc)) {
+		ret = -EMSGSIZE;
+		goto err_put_txbuf;
+	}
+
+	shm = _create_shm(req.buf, req.buf_len,
+			  req.flags & TIPC_SHM_REQ_WRITE);
+	if (IS_ERR(shm)) {
+		ret = PTR_ERR(shm);
+		goto err_put_txbuf;
+	}
+
+	ret = trusty_encode_page_info(&list_inf,
+				      virt_to_page(shm->page_list),
+				      PAGE_KERNEL_RO);
+	if (ret)
+		goto err_free_shm;
+
+	desc = mb_put_data(txbuf, sizeof(*desc));
+	desc->page_list = list_inf.attr;
+	desc->page_cnt = shm->page_cnt;
+	desc->offset = offset_in_page(req.buf);
+	desc->size = req.buf_len;
+	desc->flags = req.flags;
+	desc->reserved = 0;
+
+	if (copy_from_user(mb_put_data(txbuf, req.msg_len),
+			   u64_to_user_ptr(req.msg), req.msg_len)) {
+		ret = -EFAULT;
+		goto err_free_shm;
+	}
+
+	mutex_lock(&dn->lock);
+	if (dn->shm) {
+		/* only one buffer can be outstanding per channel */
+		mutex_unlock(&dn->lock);
+		ret = -EBUSY;
+		goto err_free_shm;
+	}
+	dn->shm = shm;
+	mutex_unlock(&dn->lock);
+
+	ret = _chan_queue_msg(dn->chan, txbuf, TIPC_MSG_FLAG_SHM);
+	if (ret) {
+		mutex_lock(&dn->lock);
+		if (dn->shm == shm)
+			dn->shm = NULL;
+		else
+			shm = NULL;
+		mutex_unlock(&dn->lock);
+		goto err_free_shm;
+	}
+
+	return 0;
+
+err_free_shm:
+	_free_shm(shm);
+err_put_txbuf:
+	tipc_chan_put_txbuf(dn->chan, txbuf);
+	return ret;
+}
+
 static long tipc_ioctl(struct file *filp, unsigned int cmd, unsigned long arg)
 {
 	int ret;
@@ -950,6 +1186,9 @@ static long tipc_ioctl(struct file *filp, unsigned int cmd, unsigned long arg)
 	case TIPC_IOC_CONNECT:
 		ret = dn_connect_ioctl(dn, (char __user *)arg);
 		break;
+	case TIPC_IOC_SEND_SHM:
+		ret = dn_send_shm_ioctl(dn, (void __user *)arg);
+		break;
 	default:
 		pr_warn("%s: Unhandled ioctl cmd: 0x%x\n",
 			__func__, cmd);
@@ -973,6 +1212,9 @@ static long tipc_compat_ioctl(struct file *filp,
 	case TIPC_IOC_CONNECT_COMPAT:
 		ret = dn_connect_ioctl(dn, user_req);
 		break;
+	case TIPC_IOC_SEND_SHM:
+		ret = dn_send_shm_ioctl(dn, user_req);
+		break;
 	default:
 		pr_warn("%s: Unhandled ioctl cmd: 0x%x\n",
 			__func__, cmd);
@@ -1127,6 +1369,23 @@ static int tipc_release(struct inode *inode, struct file *filp)
 	/* shutdown channel  */
 	tipc_chan_shutdown(dn->chan);
 
+	/*
+	 * The disconnect is not acknowledged, so the remote may still
+	 * access a shared buffer until it hands it back. If it doesn't,
+	 * leave the pages pinned rather than giving them back to the
+	 * kernel while the secure side may still use them.
+	 */
+	if (!wait_event_timeout(dn->readq, !READ_ONCE(dn->shm),
+				msecs_to_jiffies(SHM_ACK_TIMEOUT))) {
+		mutex_lock(&dn->lock);
+		if (dn->shm) {
+			pr_warn("%s: shared buffer not released by remote, leaking it\n",
+				__func__);
+			dn->shm = NULL;
+		}
+		mutex_unlock(&dn->lock);
+	}
+
 	/* and destroy it */
 	tipc_chan_destroy(dn->chan);
 
@@ -1559,6 +1818,8 @@ static int tipc_virtio_probe(struct virtio_device *vdev)
 	strncpy(vds->cdev_name, config.dev_name, sizeof(vds->cdev_name));
 	vds->cdev_name[sizeof(vds->cdev_name)-1] = '\0';
 
+	vds->shm_supported = virtio_has_feature(vdev, VIRTIO_TIPC_F_SHM);
+
 	/* find tx virtqueues (rx and tx and in this order) */
 #if LINUX_VERSION_CODE >= KERNEL_VERSION(4, 14, 0)
 	err = vdev->config->find_vqs(vdev, 2, vqs, vq_cbs, vq_names, NULL, NULL);
@@ -1636,6 +1897,7 @@ static struct virtio_device_id tipc_virtio_id_table[] = {
 
 static unsigned int features[] = {
 	0,
+	VIRTIO_TIPC_F_SHM,
 };
 
 static struct virtio_driver virtio_tipc_driver = {
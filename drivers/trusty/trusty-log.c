@@ -24,6 +24,11 @@
 #include <linux/mm.h>
 #include <linux/module.h>
 #include <linux/log2.h>
+#include <linux/miscdevice.h>
+#include <linux/poll.h>
+#include <linux/fs.h>
+#include <linux/kref.h>
+#include <linux/uaccess.h>
 #include <asm/page.h>
 #include "trusty-log.h"
 
@@ -37,6 +42,8 @@ static uint32_t g_vmm_debug_buf;
 #endif
 
 struct trusty_log_state {
+	/* open files and mappings of the log device hold a reference */
+	struct kref kref;
 	struct device *dev;
 	struct device *trusty_dev;
 
@@ -53,6 +60,20 @@ struct trusty_log_state {
 	struct notifier_block call_notifier;
 	struct notifier_block panic_notifier;
 	char line_buffer[TRUSTY_LINE_BUFFER_SIZE];
+
+	/*
+	 * While a reader has the log device open it consumes the ring
+	 * from the mapping, and the call notifier only wakes it up.
+	 */
+	struct miscdevice misc;
+	wait_queue_head_t readq;
+	atomic_t readers;
+	uint32_t wake_put;
+};
+
+struct trusty_log_reader {
+	struct trusty_log_state *s;
+	uint32_t seen_put;
 };
 
 static int log_read_line(struct trusty_log_state *s, int put, int get)
@@ -127,6 +148,16 @@ static int trusty_log_call_notify(struct notifier_block *nb,
 
 	s = container_of(nb, struct trusty_log_state, call_notifier);
 	spin_lock_irqsave(&s->lock, flags);
+	if (atomic_read(&s->readers)) {
+		uint32_t put = READ_ONCE(s->log->put);
+
+		if (put != s->wake_put) {
+			s->wake_put = put;
+			wake_up_interruptible(&s->readq);
+		}
+		spin_unlock_irqrestore(&s->lock, flags);
+		return NOTIFY_OK;
+	}
 #ifdef CONFIG_DEBUG_INFO
 	trusty_dump_logs(s, true);
 #else
@@ -152,6 +183,148 @@ static int trusty_log_panic_notify(struct notifier_block *nb,
 	return NOTIFY_OK;
 }
 
+static void trusty_log_state_free(struct kref *kref)
+{
+	struct trusty_log_state *s = container_of(kref,
+						  struct trusty_log_state,
+						  kref);
+
+	__free_pages(s->log_pages, get_order(TRUSTY_LOG_SIZE));
+	kfree(s);
+}
+
+static int trusty_log_open(struct inode *inode, struct file *filp)
+{
+	struct trusty_log_state *s = container_of(filp->private_data,
+						  struct trusty_log_state,
+						  misc);
+	struct trusty_log_reader *r;
+
+	r = kzalloc(sizeof(*r), GFP_KERNEL);
+	if (!r)
+		return -ENOMEM;
+
+	r->s = s;
+	r->seen_put = READ_ONCE(s->log->put);
+	filp->private_data = r;
+	kref_get(&s->kref);
+	atomic_inc(&s->readers);
+
+	return nonseekable_open(inode, filp);
+}
+
+static int trusty_log_release(struct inode *inode, struct file *filp)
+{
+	struct trusty_log_reader *r = filp->private_data;
+	struct trusty_log_state *s = r->s;
+	unsigned long flags;
+
+	spin_lock_irqsave(&s->lock, flags);
+	/* the kernel log resumes from here, not from what readers consumed */
+	if (atomic_dec_and_test(&s->readers))
+		s->get = READ_ONCE(s->log->put);
+	spin_unlock_irqrestore(&s->lock, flags);
+
+	kfree(r);
+	kref_put(&s->kref, trusty_log_state_free);
+
+	return 0;
+}
+
+/*
+ * Hands out the put index the reader has caught up to, so that poll()
+ * stays quiet until the secure side writes more.
+ */
+static ssize_t trusty_log_read(struct file *filp, char __user *buf,
+			       size_t count, loff_t *ppos)
+{
+	struct trusty_log_reader *r = filp->private_data;
+	uint32_t put;
+
+	if (count < sizeof(put))
+		return -EINVAL;
+
+	put = READ_ONCE(r->s->log->put);
+	if (copy_to_user(buf, &put, sizeof(put)))
+		return -EFAULT;
+
+	r->seen_put = put;
+	return sizeof(put);
+}
+
+/* the ring stays mapped after the device is removed, until munmap */
+static void trusty_log_vm_open(struct vm_area_struct *vma)
+{
+	struct trusty_log_state *s = vma->vm_private_data;
+
+	kref_get(&s->kref);
+}
+
+static void trusty_log_vm_close(struct vm_area_struct *vma)
+{
+	struct trusty_log_state *s = vma->vm_private_data;
+
+	kref_put(&s->kref, trusty_log_state_free);
+}
+
+static const struct vm_operations_struct trusty_log_vm_ops = {
+	.open	= trusty_log_vm_open,
+	.close	= trusty_log_vm_close,
+};
+
+static int trusty_log_mmap(struct file *filp, struct vm_area_struct *vma)
+{
+	struct trusty_log_reader *r = filp->private_data;
+	unsigned long size = vma->vm_end - vma->vm_start;
+	int ret;
+
+	if (vma->vm_pgoff || size > TRUSTY_LOG_SIZE)
+		return -EINVAL;
+
+	if (vma->vm_flags & VM_WRITE)
+		return -EPERM;
+	vma->vm_flags &= ~VM_MAYWRITE;
+
+	ret = remap_pfn_range(vma, vma->vm_start,
+			      page_to_pfn(r->s->log_pages),
+			      size, vma->vm_page_prot);
+	if (ret)
+		return ret;
+
+	vma->vm_private_data = r->s;
+	vma->vm_ops = &trusty_log_vm_ops;
+	trusty_log_vm_open(vma);
+
+	return 0;
+}
+
+/*
+ * Readable once the secure side has put more data in the ring than the
+ * reader last picked up with read().
+ */
+static __poll_t trusty_log_poll(struct file *filp, poll_table *wait)
+{
+	struct trusty_log_reader *r = filp->private_data;
+	struct trusty_log_state *s = r->s;
+
+	poll_wait(filp, &s->readq, wait);
+
+	if (READ_ONCE(s->log->put) == READ_ONCE(r->seen_put))
+		return 0;
+
+	return EPOLLIN | EPOLLRDNORM;
+}
+
+static const struct file_operations trusty_log_fops = {
+	.owner		= THIS_MODULE,
+	.open		= trusty_log_open,
+	.release	= trusty_log_release,
+	.read		= trusty_log_read,
+	.mmap		= trusty_log_mmap,
+	.poll		= trusty_log_poll,
+	.llseek		= no_llseek,
+};
+
 static void trusty_vmm_dump_header(struct deadloop_dump *dump)
 {
 	struct dump_header *header;
@@ -284,7 +457,10 @@ static int trusty_log_probe(struct platform_device *pdev)
 		goto error_alloc_state;
 	}
 
+	kref_init(&s->kref);
 	spin_lock_init(&s->lock);
+	init_waitqueue_head(&s->readq);
+	atomic_set(&s->readers, 0);
 	s->dev = &pdev->dev;
 	s->trusty_dev = s->dev->parent;
 	s->get = 0;
@@ -316,6 +492,16 @@ static int trusty_log_probe(struct platform_device *pdev)
 		goto error_call_notifier;
 	}
 
+	s->misc.minor = MISC_DYNAMIC_MINOR;
+	s->misc.name = "trusty-log";
+	s->misc.fops = &trusty_log_fops;
+	s->misc.parent = &pdev->dev;
+	result = misc_register(&s->misc);
+	if (result < 0) {
+		dev_err(&pdev->dev, "failed to register log device\n");
+		goto error_misc_register;
+	}
+
 	s->panic_notifier.notifier_call = trusty_log_panic_notify;
 	result = atomic_notifier_chain_register(&panic_notifier_list,
 						&s->panic_notifier);
@@ -366,12 +552,16 @@ static int trusty_log_probe(struct platform_device *pdev)
 	atomic_notifier_chain_unregister(&panic_notifier_list,
 			&s->panic_notifier);
 error_panic_notifier:
+	misc_deregister(&s->misc);
+error_misc_register:
 	trusty_call_notifier_unregister(s->trusty_dev, &s->call_notifier);
 error_call_notifier:
 	trusty_std_call32(s->trusty_dev, SMC_SC_SHARED_LOG_RM,
 			  (u32)pa, (u32)HIULINT(pa), 0);
 error_std_call:
-	__free_pages(s->log_pages, get_order(TRUSTY_LOG_SIZE));
+	kref_put(&s->kref, trusty_log_state_free);
+	return result;
+
 error_alloc_log:
 	kfree(s);
 error_alloc_state:
@@ -390,6 +580,7 @@ static int trusty_log_remove(struct platform_device *pdev)
 					&trusty_vmm_panic_nb);
 	atomic_notifier_chain_unregister(&panic_notifier_list,
 					 &s->panic_notifier);
+	misc_deregister(&s->misc);
 	trusty_call_notifier_unregister(s->trusty_dev, &s->call_notifier);
 
 	result = trusty_std_call32(s->trusty_dev, SMC_SC_SHARED_LOG_RM,
@@ -398,8 +589,7 @@ static int trusty_log_remove(struct platform_device *pdev)
 		pr_err("trusty std call (SMC_SC_SHARED_LOG_RM) failed: %d\n",
 		       result);
 	}
-	__free_pages(s->log_pages, get_order(TRUSTY_LOG_SIZE));
-	kfree(s);
+	kref_put(&s->kref, trusty_log_state_free);
 	free_page(g_vmm_debug_buf);
 
 	return 0;
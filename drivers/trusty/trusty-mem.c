@@ -167,6 +167,7 @@ int trusty_encode_page_info(struct ns_mem_page_info *inf,
 	inf->attr = (pte & 0x0000FFFFFFFFFFFFull) | ((uint64_t)mem_attr << 48);
 	return 0;
 }
+EXPORT_SYMBOL(trusty_encode_page_info);
 
 int trusty_call32_mem_buf(struct device *dev, u32 smcnr,
 			  struct page *page,  u32 size,
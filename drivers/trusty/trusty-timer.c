@@ -38,6 +38,11 @@ struct trusty_timer_dev_state {
 	struct notifier_block call_notifier;
 	struct trusty_timer timer;
 	struct workqueue_struct *workqueue;
+	/*
+	 * How late the backup timer may fire, so that it can expire together
+	 * with other hrtimers instead of waking an idle cpu on its own.
+	 */
+	u64 slack_ns;
 };
 
 static void timer_work_func(struct work_struct *work)
@@ -83,8 +88,10 @@ static int trusty_timer_call_notify(struct notifier_block *nb,
 		hrtimer_cancel(&tt->tm);
 	} else if (sts->cv_ns > sts->tv_ns) {
 		/* need to set/reset timer */
-		hrtimer_start(&tt->tm, ns_to_ktime(sts->cv_ns - sts->tv_ns),
-				HRTIMER_MODE_REL_PINNED);
+		hrtimer_start_range_ns(&tt->tm,
+				       ns_to_ktime(sts->cv_ns - sts->tv_ns),
+				       READ_ONCE(s->slack_ns),
+				       HRTIMER_MODE_REL_PINNED);
 	}
 
 	sts->cv_ns = 0ULL;
@@ -93,6 +100,34 @@ static int trusty_timer_call_notify(struct notifier_block *nb,
 	return NOTIFY_OK;
 }
 
+static ssize_t slack_ns_show(struct device *dev,
+			     struct device_attribute *attr, char *buf)
+{
+	struct trusty_timer_dev_state *s = dev_get_drvdata(dev);
+
+	return scnprintf(buf, PAGE_SIZE, "%llu\n", READ_ONCE(s->slack_ns));
+}
+
+static ssize_t slack_ns_store(struct device *dev,
+			      struct device_attribute *attr,
+			      const char *buf, size_t count)
+{
+	struct trusty_timer_dev_state *s = dev_get_drvdata(dev);
+	u64 val;
+	int ret;
+
+	ret = kstrtou64(buf, 0, &val);
+	if (ret)
+		return ret;
+
+	/* takes effect the next time the secure side sets its timer */
+	WRITE_ONCE(s->slack_ns, val);
+
+	return count;
+}
+
+static DEVICE_ATTR_RW(slack_ns);
+
 static int trusty_timer_probe(struct platform_device *pdev)
 {
 	int ret;
@@ -123,36 +158,45 @@ static int trusty_timer_probe(struct platform_device *pdev)
 
 	tt = &s->timer;
 
+	s->workqueue = alloc_workqueue("trusty-timer-wq", WQ_CPU_INTENSIVE, 0);
+	if (!s->workqueue) {
+		ret = -ENODEV;
+		dev_err(&pdev->dev, "Failed to allocate work queue\n");
+		goto err_allocate_work_queue;
+	}
+
 	hrtimer_init(&tt->tm, CLOCK_BOOTTIME, HRTIMER_MODE_REL_PINNED);
 	tt->tm.function = trusty_timer_cb;
+	INIT_WORK(&tt->work, timer_work_func);
 	tt->sts =
 		trusty_wall_per_cpu_item_ptr(s->smwall_dev, 0,
 				SM_WALL_PER_CPU_SEC_TIMER_ID,
 				sizeof(*tt->sts));
 	WARN_ON(!tt->sts);
 
-	s->workqueue = alloc_workqueue("trusty-timer-wq", WQ_CPU_INTENSIVE, 0);
-	if (!s->workqueue) {
-		ret = -ENODEV;
-		dev_err(&pdev->dev, "Failed to allocate work queue\n");
-		goto err_allocate_work_queue;
-	}
-
 	/* register notifier */
 	s->call_notifier.notifier_call = trusty_timer_call_notify;
 	ret = trusty_call_notifier_register(s->trusty_dev, &s->call_notifier);
 	if (ret < 0) {
 		dev_err(&pdev->dev, "Failed to register call notifier\n");
-		kfree(s);
-		return ret;
+		goto err_register_call_notifier;
 	}
 
-	INIT_WORK(&s->timer.work, timer_work_func);
+	ret = device_create_file(&pdev->dev, &dev_attr_slack_ns);
+	if (ret) {
+		dev_err(&pdev->dev, "Failed to create slack_ns attribute\n");
+		goto err_create_file;
+	}
 
 	dev_info(s->dev, "initialized\n");
 
 	return 0;
 
+err_create_file:
+	trusty_call_notifier_unregister(s->trusty_dev, &s->call_notifier);
+err_register_call_notifier:
+	hrtimer_cancel(&tt->tm);
+	flush_work(&tt->work);
 	destroy_workqueue(s->workqueue);
 err_allocate_work_queue:
 	kfree(s);
@@ -168,6 +212,8 @@ static int trusty_timer_remove(struct platform_device *pdev)
 
 	dev_dbg(&pdev->dev, "%s\n", __func__);
 
+	device_remove_file(&pdev->dev, &dev_attr_slack_ns);
+
 	/* unregister notifier */
 	trusty_call_notifier_unregister(s->trusty_dev, &s->call_notifier);
 
@@ -22,6 +22,7 @@
 #include <linux/notifier.h>
 #include <linux/workqueue.h>
 #include <linux/remoteproc.h>
+#include <linux/sched.h>
 
 #include <linux/platform_device.h>
 #include <linux/trusty/smcall.h>
@@ -34,6 +35,8 @@
 
 #include <linux/atomic.h>
 
+#include "trusty-batch.h"
+
 #define  RSC_DESCR_VER  1
 
 struct trusty_vdev;
@@ -106,40 +109,89 @@ static int trusty_call_notify(struct notifier_block *nb,
 	return NOTIFY_OK;
 }
 
-static void kick_vq(struct trusty_ctx *tctx,
-		    struct trusty_vdev *tvdev,
-		    struct trusty_vring *tvr)
+#define KICK_BATCH_MAX	8
+
+static void kick_vq_batch(struct trusty_ctx *tctx,
+			  struct trusty_std_call32_req *reqs, uint count)
 {
-	int ret;
+	int done;
+	uint i;
 
-	dev_dbg(tctx->dev, "%s: vdev_id=%d: vq_id=%d\n",
-		__func__, tvdev->notifyid, tvr->notifyid);
+	done = trusty_std_call32_batch(tctx->dev->parent, reqs, count);
+	if (done < 0) {
+		dev_err(tctx->dev, "vq notify batch failed %d\n", done);
+		return;
+	}
 
-	ret = trusty_std_call32(tctx->dev->parent, SMC_SC_VDEV_KICK_VQ,
-				tvdev->notifyid, tvr->notifyid, 0);
-	if (ret) {
-		dev_err(tctx->dev, "vq notify (%d, %d) returned %d\n",
-			tvdev->notifyid, tvr->notifyid, ret);
+	for (i = 0; i < done; i++) {
+		if (reqs[i].ret)
+			dev_err(tctx->dev, "vq notify (%d, %d) returned %d\n",
+				reqs[i].a0, reqs[i].a1, reqs[i].ret);
 	}
 }
 
-static void kick_vqs(struct work_struct *work)
+static void kick_vqs_locked(struct trusty_ctx *tctx)
 {
-	uint i;
+	uint i, count = 0;
 	struct trusty_vdev *tvdev;
-	struct trusty_ctx *tctx = container_of(work, struct trusty_ctx,
-					       kick_vqs);
-	mutex_lock(&tctx->mlock);
+	struct trusty_std_call32_req reqs[KICK_BATCH_MAX];
+
+	lockdep_assert_held(&tctx->mlock);
+
 	list_for_each_entry(tvdev, &tctx->vdev_list, node) {
 		for (i = 0; i < tvdev->vring_num; i++) {
 			struct trusty_vring *tvr = &tvdev->vrings[i];
-			if (atomic_xchg(&tvr->needs_kick, 0))
-				kick_vq(tctx, tvdev, tvr);
+
+			if (!atomic_xchg(&tvr->needs_kick, 0))
+				continue;
+
+			dev_dbg(tctx->dev, "%s: vdev_id=%d: vq_id=%d\n",
+				__func__, tvdev->notifyid, tvr->notifyid);
+
+			reqs[count].smcnr = SMC_SC_VDEV_KICK_VQ;
+			reqs[count].a0 = tvdev->notifyid;
+			reqs[count].a1 = tvr->notifyid;
+			reqs[count].a2 = 0;
+			if (++count == KICK_BATCH_MAX) {
+				kick_vq_batch(tctx, reqs, count);
+				count = 0;
+			}
 		}
 	}
+	if (count)
+		kick_vq_batch(tctx, reqs, count);
+}
+
+static void kick_vqs(struct work_struct *work)
+{
+	struct trusty_ctx *tctx = container_of(work, struct trusty_ctx,
+					       kick_vqs);
+	mutex_lock(&tctx->mlock);
+	kick_vqs_locked(tctx);
 	mutex_unlock(&tctx->mlock);
 }
 
+/*
+ * Kick straight from the sender when it already runs where the secure
+ * OS expects the call (bound to cpu 0) and nobody else is kicking. A
+ * sender that loses the race leaves its needs_kick set for the current
+ * kicker or the worker, so concurrent kicks collapse into one pass.
+ */
+static bool kick_vqs_inline(struct trusty_ctx *tctx)
+{
+	if (!in_task() || current->nr_cpus_allowed != 1 ||
+	    !cpumask_test_cpu(0, &current->cpus_allowed))
+		return false;
+
+	if (!mutex_trylock(&tctx->mlock))
+		return false;
+
+	kick_vqs_locked(tctx);
+	mutex_unlock(&tctx->mlock);
+
+	return true;
+}
+
 static bool trusty_virtio_notify(struct virtqueue *vq)
 {
 	struct trusty_vring *tvr = vq->priv;
@@ -150,7 +202,8 @@ static bool trusty_virtio_notify(struct virtqueue *vq)
 
 	if (api_ver < TRUSTY_API_VERSION_SMP_NOP) {
 		atomic_set(&tvr->needs_kick, 1);
-		queue_work_on(0, tctx->kick_wq, &tctx->kick_vqs);
+		if (!kick_vqs_inline(tctx))
+			queue_work_on(0, tctx->kick_wq, &tctx->kick_vqs);
 	} else {
 		trusty_enqueue_nop(tctx->dev->parent, &tvr->kick_nop);
 	}
@@ -26,6 +26,8 @@
 #include <linux/trusty/sm_err.h>
 #include <linux/trusty/trusty.h>
 
+#include "trusty-batch.h"
+
 #define EVMM_SMC_HC_ID 0x74727500
 #define ACRN_HC_SWITCH_WORLD 0x80000071
 #define ACRN_HC_SAVE_SWORLD_CONTEXT 0x80000072
@@ -237,33 +239,14 @@ struct trusty_std_call32_args {
         u32 a2;
 };
 
-static long trusty_std_call32_work(void *args)
+static s32 __trusty_std_call32(struct device *dev, struct trusty_state *s,
+			       u32 smcnr, u32 a0, u32 a1, u32 a2)
 {
-	int ret;
-	struct device *dev;
-	u32 smcnr, a0, a1, a2;
-	struct trusty_state *s;
-	struct trusty_std_call32_args *work_args;
-
-	BUG_ON(!args);
-
-	work_args = (struct trusty_std_call32_args *)args;
-	dev = work_args->dev;
-	s = platform_get_drvdata(to_platform_device(dev));
-
-	smcnr = work_args->smcnr;
-	a0 = work_args->a0;
-	a1 = work_args->a1;
-	a2 = work_args->a2;
+	s32 ret;
 
 	BUG_ON(SMC_IS_FASTCALL(smcnr));
 	BUG_ON(SMC_IS_SMC64(smcnr));
 
-	if (smcnr != SMC_SC_NOP) {
-		mutex_lock(&s->smc_lock);
-		reinit_completion(&s->cpu_idle_completion);
-	}
-
 	dev_dbg(dev, "%s(0x%x 0x%x 0x%x 0x%x) started\n",
 		__func__, smcnr, a0, a1, a2);
 
@@ -280,6 +263,33 @@ static long trusty_std_call32_work(void *args)
 
 	WARN_ONCE(ret == SM_ERR_PANIC, "trusty crashed");
 
+	return ret;
+}
+
+static long trusty_std_call32_work(void *args)
+{
+	int ret;
+	struct device *dev;
+	u32 smcnr;
+	struct trusty_state *s;
+	struct trusty_std_call32_args *work_args;
+
+	BUG_ON(!args);
+
+	work_args = (struct trusty_std_call32_args *)args;
+	dev = work_args->dev;
+	s = platform_get_drvdata(to_platform_device(dev));
+
+	smcnr = work_args->smcnr;
+
+	if (smcnr != SMC_SC_NOP) {
+		mutex_lock(&s->smc_lock);
+		reinit_completion(&s->cpu_idle_completion);
+	}
+
+	ret = __trusty_std_call32(dev, s, smcnr, work_args->a0,
+				  work_args->a1, work_args->a2);
+
 	if (smcnr == SMC_SC_NOP)
 		complete(&s->cpu_idle_completion);
 	else
@@ -288,6 +298,12 @@ static long trusty_std_call32_work(void *args)
 	return ret;
 }
 
+static bool trusty_std_call32_local(u32 smcnr)
+{
+	return smcnr == SMC_SC_VDEV_KICK_VQ || smcnr == SMC_SC_LK_TIMER ||
+	       smcnr == SMC_SC_LOCKED_NOP || smcnr == SMC_SC_NOP;
+}
+
 s32 trusty_std_call32(struct device *dev, u32 smcnr, u32 a0, u32 a1, u32 a2)
 {
 	struct trusty_std_call32_args args = {
@@ -299,8 +315,7 @@ s32 trusty_std_call32(struct device *dev, u32 smcnr, u32 a0, u32 a1, u32 a2)
 	};
 
 	/* bind cpu 0 for now since trusty OS is running on physical cpu #0*/
-	if((smcnr == SMC_SC_VDEV_KICK_VQ) || (smcnr == SMC_SC_LK_TIMER)
-		|| (smcnr == SMC_SC_LOCKED_NOP) || (smcnr == SMC_SC_NOP))
+	if (trusty_std_call32_local(smcnr))
 		return trusty_std_call32_work((void *) &args);
 	else
 		return work_on_cpu(0, trusty_std_call32_work, (void *) &args);
@@ -308,6 +323,86 @@ s32 trusty_std_call32(struct device *dev, u32 smcnr, u32 a0, u32 a1, u32 a2)
 
 EXPORT_SYMBOL(trusty_std_call32);
 
+struct trusty_std_call32_batch_args {
+	struct device *dev;
+	struct trusty_std_call32_req *reqs;
+	unsigned int count;
+};
+
+static long trusty_std_call32_batch_work(void *args)
+{
+	struct trusty_std_call32_batch_args *batch = args;
+	struct device *dev = batch->dev;
+	struct trusty_state *s = platform_get_drvdata(to_platform_device(dev));
+	unsigned int i;
+	long done = 0;
+
+	mutex_lock(&s->smc_lock);
+	reinit_completion(&s->cpu_idle_completion);
+
+	for (i = 0; i < batch->count; i++) {
+		struct trusty_std_call32_req *req = &batch->reqs[i];
+
+		req->ret = __trusty_std_call32(dev, s, req->smcnr,
+					       req->a0, req->a1, req->a2);
+		done++;
+
+		/* nothing queued behind a crash can make progress */
+		if (req->ret == SM_ERR_PANIC)
+			break;
+	}
+
+	mutex_unlock(&s->smc_lock);
+
+	return done;
+}
+
+/**
+ * trusty_std_call32_batch - issue several standard calls back to back
+ * @dev: trusty device
+ * @reqs: calls to issue, in order; ->ret is filled in for each one issued
+ * @count: number of entries in @reqs
+ *
+ * All calls are issued under a single hold of the smc lock and, for
+ * calls that are not already allowed to run on the calling cpu, from a
+ * single migration to cpu 0 instead of one work_on_cpu() round trip per
+ * call. A batch stops early if trusty crashes.
+ *
+ * Returns the number of calls issued, or a negative error code if the
+ * batch contains a call that cannot be batched.
+ */
+int trusty_std_call32_batch(struct device *dev,
+			    struct trusty_std_call32_req *reqs,
+			    unsigned int count)
+{
+	struct trusty_std_call32_batch_args args = {
+		.dev = dev,
+		.reqs = reqs,
+		.count = count,
+	};
+	bool local = true;
+	unsigned int i;
+
+	for (i = 0; i < count; i++) {
+		/* SMC_SC_NOP runs from the nop queue, not under smc_lock */
+		if (reqs[i].smcnr == SMC_SC_NOP ||
+		    SMC_IS_FASTCALL(reqs[i].smcnr) ||
+		    SMC_IS_SMC64(reqs[i].smcnr))
+			return -EINVAL;
+		if (!trusty_std_call32_local(reqs[i].smcnr))
+			local = false;
+	}
+
+	if (!count)
+		return 0;
+
+	if (local)
+		return trusty_std_call32_batch_work(&args);
+	else
+		return work_on_cpu(0, trusty_std_call32_batch_work, &args);
+}
+EXPORT_SYMBOL(trusty_std_call32_batch);
+
 int trusty_call_notifier_register(struct device *dev, struct notifier_block *n)
 {
 	struct trusty_state *s = platform_get_drvdata(to_platform_device(dev));
@@ -20,6 +20,8 @@
 #include <linux/hid.h>
 #include <linux/module.h>
 #include <linux/sched/signal.h>
+#include <linux/scatterlist.h>
+#include <linux/sizes.h>
 #include <linux/uio.h>
 #include <asm/unaligned.h>
 
@@ -38,6 +40,9 @@
 
 #define FUNCTIONFS_MAGIC	0xa647361 /* Chosen by a honest dice roll ;) */
 
+/* Most user memory pinned by a single zero-copy transfer */
+#define FFS_ZEROCOPY_MAX	SZ_4M
+
 /* Reference counter handling */
 static void ffs_data_get(struct ffs_data *ffs);
 static void ffs_data_put(struct ffs_data *ffs);
@@ -875,6 +880,107 @@ static ssize_t __ffs_epfile_read_data(struct ffs_epfile *epfile,
 	return ret;
 }
 
+static bool ffs_epfile_zerocopy_ok(struct ffs_data *ffs,
+				   struct usb_gadget *gadget,
+				   struct ffs_io_data *io_data,
+				   ssize_t data_len)
+{
+	/*
+	 * Reads must not need rounding up to the max packet size since there
+	 * is nowhere to put the excess data.
+	 */
+	return ffs->zerocopy && gadget->sg_supported && !io_data->aio &&
+	       iter_is_iovec(&io_data->data) && data_len >= PAGE_SIZE &&
+	       data_len == iov_iter_count(&io_data->data);
+}
+
+/*
+ * Synchronous transfer straight from or to the pages of the user buffer,
+ * handed to the UDC as a scatter-gather list so that it can queue all of
+ * them at once.  Returns -EAGAIN if the buffer cannot be pinned as a
+ * whole, in which case the caller falls back to a bounce buffer.
+ *
+ * Assumes epfile->mutex is held.
+ */
+static ssize_t ffs_epfile_io_zerocopy(struct ffs_epfile *epfile,
+				      struct ffs_ep *ep,
+				      struct ffs_io_data *io_data,
+				      size_t data_len)
+{
+	DECLARE_COMPLETION_ONSTACK(done);
+	struct usb_request *req = ep->req;
+	struct sg_table sgt;
+	struct page **pages;
+	size_t offset;
+	ssize_t ret;
+	int i, n_pages;
+
+	ret = iov_iter_get_pages_alloc(&io_data->data, &pages, data_len,
+				       &offset);
+	if (ret < 0)
+		return ret;
+
+	n_pages = DIV_ROUND_UP(offset + ret, PAGE_SIZE);
+	if (ret != data_len) {
+		ret = -EAGAIN;
+		goto out_put;
+	}
+
+	ret = sg_alloc_table_from_pages(&sgt, pages, n_pages, offset,
+					data_len, GFP_KERNEL);
+	if (unlikely(ret))
+		goto out_put;
+
+	spin_lock_irq(&epfile->ffs->eps_lock);
+	if (epfile->ep != ep) {
+		/* In the meantime, endpoint got disabled or changed. */
+		spin_unlock_irq(&epfile->ffs->eps_lock);
+		ret = -ESHUTDOWN;
+		goto out_free;
+	}
+
+	req->buf      = NULL;
+	req->length   = data_len;
+	req->sg       = sgt.sgl;
+	req->num_sgs  = sgt.nents;
+
+	req->context  = &done;
+	req->complete = ffs_epfile_io_complete;
+
+	ret = usb_ep_queue(ep->ep, req, GFP_ATOMIC);
+	spin_unlock_irq(&epfile->ffs->eps_lock);
+	if (unlikely(ret < 0))
+		goto out_reset;
+
+	if (unlikely(wait_for_completion_interruptible(&done))) {
+		/* See ffs_epfile_io() */
+		usb_ep_dequeue(ep->ep, req);
+		if (ep->status < 0) {
+			ret = -EINTR;
+			goto out_reset;
+		}
+	}
+
+	ret = ep->status;
+	if (ret > 0)
+		iov_iter_advance(&io_data->data, ret);
+
+out_reset:
+	req->sg = NULL;
+	req->num_sgs = 0;
+out_free:
+	sg_free_table(&sgt);
+out_put:
+	for (i = 0; i < n_pages; i++) {
+		if (io_data->read)
+			set_page_dirty_lock(pages[i]);
+		put_page(pages[i]);
+	}
+	kvfree(pages);
+
+	return ret;
+}
+
 static ssize_t ffs_epfile_io(struct file *file, struct ffs_io_data *io_data)
 {
 	struct ffs_epfile *epfile = file->private_data;
@@ -949,6 +1055,15 @@ static ssize_t ffs_epfile_io(struct file *file, struct ffs_io_data *io_data)
 			data_len = usb_ep_align_maybe(gadget, ep->ep, data_len);
 		spin_unlock_irq(&epfile->ffs->eps_lock);
 
+		if (ffs_epfile_zerocopy_ok(epfile->ffs, gadget, io_data,
+					   data_len)) {
+			ret = ffs_epfile_io_zerocopy(epfile, ep, io_data,
+					min_t(size_t, data_len,
+					      FFS_ZEROCOPY_MAX));
+			if (ret != -EAGAIN)
+				goto error_mutex;
+		}
+
 		data = kmalloc(data_len, GFP_KERNEL);
 		if (unlikely(!data)) {
 			ret = -ENOMEM;
@@ -1373,6 +1488,7 @@ struct ffs_sb_fill_data {
 	umode_t root_mode;
 	const char *dev_name;
 	bool no_disconnect;
+	bool zerocopy;
 	struct ffs_data *ffs_data;
 };
 
@@ -1449,6 +1565,12 @@ static int ffs_fs_parse_opts(struct ffs_sb_fill_data *data, char *opts)
 			else
 				goto invalid;
 			break;
+		case 8:
+			if (!memcmp(opts, "zerocopy", 8))
+				data->zerocopy = !!value;
+			else
+				goto invalid;
+			break;
 		case 5:
 			if (!memcmp(opts, "rmode", 5))
 				data->root_mode  = (value & 0555) | S_IFDIR;
@@ -1514,6 +1636,7 @@ ffs_fs_mount(struct file_system_type *t, int flags,
 		},
 		.root_mode = S_IFDIR | 0500,
 		.no_disconnect = false,
+		.zerocopy = false,
 	};
 	struct dentry *rv;
 	int ret;
@@ -1531,6 +1654,7 @@ ffs_fs_mount(struct file_system_type *t, int flags,
 		return ERR_PTR(-ENOMEM);
 	ffs->file_perms = data.perms;
 	ffs->no_disconnect = data.no_disconnect;
+	ffs->zerocopy = data.zerocopy;
 
 	ffs->dev_name = kstrdup(dev_name, GFP_KERNEL);
 	if (unlikely(!ffs->dev_name)) {
@@ -457,6 +457,13 @@ static void rndis_command_complete(struct usb_ep *ep, struct usb_request *req)
 		pr_err("RNDIS command error %d, %d/%d\n",
 			status, req->actual, req->length);
 //	spin_unlock(&dev->lock);
+
+	/* pack packets when the host takes transfers larger than one */
+	if (rndis->params->host_max_transfer > RNDIS_MAX_TOTAL_SIZE)
+		WRITE_ONCE(rndis->port.tx_aggr_len,
+			   rndis->params->host_max_transfer);
+	else
+		WRITE_ONCE(rndis->port.tx_aggr_len, 0);
 }
 
 static int
@@ -616,6 +623,8 @@ static void rndis_disable(struct usb_function *f)
 
 	rndis_uninit(rndis->params);
 	gether_disconnect(&rndis->port);
+	rndis->port.tx_aggr_len = 0;
+	rndis->params->host_max_transfer = 0;
 
 	usb_ep_disable(rndis->notify);
 }
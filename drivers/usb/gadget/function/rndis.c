@@ -584,6 +584,8 @@ static int rndis_init_response(struct rndis_params *params,
 	resp->AFListOffset = cpu_to_le32(0);
 	resp->AFListSize = cpu_to_le32(0);
 
+	params->host_max_transfer = le32_to_cpu(buf->MaxTransferSize);
+
 	params->resp_avail(params->v);
 	return 0;
 }
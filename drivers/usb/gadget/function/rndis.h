@@ -174,6 +174,9 @@ typedef struct rndis_params {
 	void			(*resp_avail)(void *v);
 	void			*v;
 	struct list_head	resp_queue;
+
+	/* MaxTransferSize from the host's INITIALIZE message */
+	u32			host_max_transfer;
 } rndis_params;
 
 /* RNDIS Message parser and other useless functions */
@@ -49,6 +49,9 @@
  * blocks and still have efficient handling. */
 #define GETHER_MAX_ETH_FRAME_LEN 15412
 
+/* Largest transfer several wrapped tx frames are packed into */
+#define GETHER_TX_AGGR_MAX	16384
+
 struct eth_dev {
 	/* lock is held while accessing port_usb
 	 */
@@ -63,6 +66,17 @@ struct eth_dev {
 	atomic_t		tx_qlen;
 
 	struct sk_buff_head	rx_frames;
+	/* completed rx transfers, waiting for eth_rx_poll() */
+	struct sk_buff_head	rx_done;
+	struct napi_struct	napi;
+
+	/* tx frames packed while earlier transfers are in flight */
+	struct sk_buff		*tx_aggr;	/* P: req_lock */
+
+	/* per-link counters, reported through ethtool -S */
+	u64			rx_transfers;
+	u64			tx_transfers;
+	u64			tx_aggregated;
 
 	unsigned		qmult;
 
@@ -154,9 +168,44 @@ static void eth_get_drvinfo(struct net_device *net, struct ethtool_drvinfo *p)
  *   - ... probably more ethtool ops
  */
 
+static const char eth_gstrings_stats[][ETH_GSTRING_LEN] = {
+	"rx_transfers",
+	"tx_transfers",
+	"tx_aggregated",
+};
+
+static int eth_get_sset_count(struct net_device *net, int sset)
+{
+	switch (sset) {
+	case ETH_SS_STATS:
+		return ARRAY_SIZE(eth_gstrings_stats);
+	default:
+		return -EOPNOTSUPP;
+	}
+}
+
+static void eth_get_strings(struct net_device *net, u32 sset, u8 *data)
+{
+	if (sset == ETH_SS_STATS)
+		memcpy(data, eth_gstrings_stats, sizeof(eth_gstrings_stats));
+}
+
+static void eth_get_ethtool_stats(struct net_device *net,
+				  struct ethtool_stats *stats, u64 *data)
+{
+	struct eth_dev *dev = netdev_priv(net);
+
+	data[0] = dev->rx_transfers;
+	data[1] = dev->tx_transfers;
+	data[2] = dev->tx_aggregated;
+}
+
 static const struct ethtool_ops ops = {
 	.get_drvinfo = eth_get_drvinfo,
 	.get_link = ethtool_op_get_link,
+	.get_sset_count = eth_get_sset_count,
+	.get_strings = eth_get_strings,
+	.get_ethtool_stats = eth_get_ethtool_stats,
 };
 
 static void defer_kevent(struct eth_dev *dev, int flag)
@@ -250,7 +299,7 @@ rx_submit(struct eth_dev *dev, struct usb_request *req, gfp_t gfp_flags)
 
 static void rx_complete(struct usb_ep *ep, struct usb_request *req)
 {
-	struct sk_buff	*skb = req->context, *skb2;
+	struct sk_buff	*skb = req->context;
 	struct eth_dev	*dev = ep->driver_data;
 	int		status = req->status;
 
@@ -259,47 +308,12 @@ static void rx_complete(struct usb_ep *ep, struct usb_request *req)
 	/* normal completion */
 	case 0:
 		skb_put(skb, req->actual);
+		dev->rx_transfers++;
 
-		if (dev->unwrap) {
-			unsigned long	flags;
-
-			spin_lock_irqsave(&dev->lock, flags);
-			if (dev->port_usb) {
-				status = dev->unwrap(dev->port_usb,
-							skb,
-							&dev->rx_frames);
-			} else {
-				dev_kfree_skb_any(skb);
-				status = -ENOTCONN;
-			}
-			spin_unlock_irqrestore(&dev->lock, flags);
-		} else {
-			skb_queue_tail(&dev->rx_frames, skb);
-		}
+		/* unwrapping and delivery are left to eth_rx_poll() */
+		skb_queue_tail(&dev->rx_done, skb);
+		napi_schedule(&dev->napi);
 		skb = NULL;
-
-		skb2 = skb_dequeue(&dev->rx_frames);
-		while (skb2) {
-			if (status < 0
-					|| ETH_HLEN > skb2->len
-					|| skb2->len > GETHER_MAX_ETH_FRAME_LEN) {
-				dev->net->stats.rx_errors++;
-				dev->net->stats.rx_length_errors++;
-				DBG(dev, "rx length %d\n", skb2->len);
-				dev_kfree_skb_any(skb2);
-				goto next_frame;
-			}
-			skb2->protocol = eth_type_trans(skb2, dev->net);
-			dev->net->stats.rx_packets++;
-			dev->net->stats.rx_bytes += skb2->len;
-
-			/* no buffer copies needed, unless hardware can't
-			 * use skb buffers.
-			 */
-			status = netif_rx(skb2);
-next_frame:
-			skb2 = skb_dequeue(&dev->rx_frames);
-		}
 		break;
 
 	/* software-driven interface shutdown */
@@ -340,6 +354,79 @@ static void rx_complete(struct usb_ep *ep, struct usb_request *req)
 		rx_submit(dev, req, GFP_ATOMIC);
 }
 
+/* split one rx transfer into frames, queued on dev->rx_frames */
+static void eth_rx_unwrap(struct eth_dev *dev, struct sk_buff *skb)
+{
+	int		status = 0;
+
+	if (dev->unwrap) {
+		unsigned long	flags;
+
+		spin_lock_irqsave(&dev->lock, flags);
+		if (dev->port_usb) {
+			status = dev->unwrap(dev->port_usb,
+						skb,
+						&dev->rx_frames);
+		} else {
+			dev_kfree_skb_any(skb);
+			status = -ENOTCONN;
+		}
+		spin_unlock_irqrestore(&dev->lock, flags);
+	} else {
+		skb_queue_tail(&dev->rx_frames, skb);
+	}
+
+	if (status < 0) {
+		while ((skb = skb_dequeue(&dev->rx_frames))) {
+			dev->net->stats.rx_errors++;
+			dev->net->stats.rx_length_errors++;
+			DBG(dev, "rx length %d\n", skb->len);
+			dev_kfree_skb_any(skb);
+		}
+	}
+}
+
+static int eth_rx_poll(struct napi_struct *napi, int budget)
+{
+	struct eth_dev	*dev = container_of(napi, struct eth_dev, napi);
+	struct sk_buff	*skb;
+	int		work_done = 0;
+
+	while (work_done < budget) {
+		skb = skb_dequeue(&dev->rx_frames);
+		if (!skb) {
+			skb = skb_dequeue(&dev->rx_done);
+			if (!skb)
+				break;
+			eth_rx_unwrap(dev, skb);
+			continue;
+		}
+		work_done++;
+
+		if (ETH_HLEN > skb->len
+				|| skb->len > GETHER_MAX_ETH_FRAME_LEN) {
+			dev->net->stats.rx_errors++;
+			dev->net->stats.rx_length_errors++;
+			DBG(dev, "rx length %d\n", skb->len);
+			dev_kfree_skb_any(skb);
+			continue;
+		}
+		skb->protocol = eth_type_trans(skb, dev->net);
+		dev->net->stats.rx_packets++;
+		dev->net->stats.rx_bytes += skb->len;
+
+		/* no buffer copies needed, unless hardware can't
+		 * use skb buffers.
+		 */
+		napi_gro_receive(napi, skb);
+	}
+
+	if (work_done < budget)
+		napi_complete_done(napi, work_done);
+
+	return work_done;
+}
+
 static int prealloc(struct list_head *list, struct usb_ep *ep, unsigned n)
 {
 	unsigned		i;
@@ -433,10 +520,13 @@ static void eth_work(struct work_struct *work)
 		DBG(dev, "work done, flags = 0x%lx\n", dev->todo);
 }
 
+static void eth_tx_flush_aggr(struct eth_dev *dev);
+
 static void tx_complete(struct usb_ep *ep, struct usb_request *req)
 {
 	struct sk_buff	*skb = req->context;
 	struct eth_dev	*dev = ep->driver_data;
+	bool		flush;
 
 	switch (req->status) {
 	default:
@@ -453,13 +543,173 @@ static void tx_complete(struct usb_ep *ep, struct usb_request *req)
 	}
 	dev->net->stats.tx_packets++;
 
+	/*
+	 * eth_tx_aggregate() holds a frame back only while it sees a
+	 * transfer in flight under req_lock, so decide here under the same
+	 * lock whether that frame is now up to us.
+	 */
 	spin_lock(&dev->req_lock);
 	list_add(&req->list, &dev->tx_reqs);
+	atomic_dec(&dev->tx_qlen);
+	flush = dev->tx_aggr != NULL;
 	spin_unlock(&dev->req_lock);
 
-	atomic_dec(&dev->tx_qlen);
-	if (netif_carrier_ok(dev->net))
+	if (netif_carrier_ok(dev->net)) {
 		netif_wake_queue(dev->net);
+
+		/* send what was packed while this transfer was in flight */
+		if (flush)
+			eth_tx_flush_aggr(dev);
+	}
+}
+
+static int eth_tx_submit(struct eth_dev *dev, struct usb_ep *in,
+			 struct usb_request *req, struct sk_buff *skb)
+{
+	int			length = skb->len;
+	int			retval;
+
+	req->buf = skb->data;
+	req->context = skb;
+	req->complete = tx_complete;
+
+	/* NCM requires no zlp if transfer is dwNtbInMaxSize */
+	if (dev->port_usb &&
+	    dev->port_usb->is_fixed &&
+	    length == dev->port_usb->fixed_in_len &&
+	    (length % in->maxpacket) == 0)
+		req->zero = 0;
+	else
+		req->zero = 1;
+
+	/* use zlp framing on tx for strict CDC-Ether conformance,
+	 * though any robust network rx path ignores extra padding.
+	 * and some hardware doesn't like to write zlps.
+	 */
+	if (req->zero && !dev->zlp && (length % in->maxpacket) == 0)
+		length++;
+
+	req->length = length;
+
+	/* counted before it can complete, see tx_complete() */
+	atomic_inc(&dev->tx_qlen);
+	retval = usb_ep_queue(in, req, GFP_ATOMIC);
+	switch (retval) {
+	default:
+		DBG(dev, "tx queue err %d\n", retval);
+		atomic_dec(&dev->tx_qlen);
+		break;
+	case 0:
+		netif_trans_update(dev->net);
+		dev->tx_transfers++;
+	}
+
+	return retval;
+}
+
+/*
+ * Pack wrapped frames into one transfer, for links whose host accepts
+ * several of them per transfer, as long as earlier transfers are still in
+ * flight.  Returns the skb to send now, or NULL if @skb was held back.
+ */
+static struct sk_buff *eth_tx_aggregate(struct eth_dev *dev,
+					struct sk_buff *skb, u32 max_len)
+{
+	struct sk_buff		*aggr, *out;
+	unsigned long		flags;
+	bool			copied = false;
+	bool			in_flight;
+
+	/* leave room for the byte appended instead of a zlp */
+	max_len = min_t(u32, max_len, GETHER_TX_AGGR_MAX) - 1;
+
+	spin_lock_irqsave(&dev->req_lock, flags);
+	aggr = dev->tx_aggr;
+	in_flight = atomic_read(&dev->tx_qlen) > 0;
+	/* a frame waiting on its own may lack tailroom or be shared */
+	if (aggr && aggr->len + skb->len <= max_len &&
+	    skb_tailroom(aggr) >= skb->len && !skb_cloned(aggr)) {
+		skb_put_data(aggr, skb->data, skb->len);
+		dev->tx_aggregated++;
+		dev->net->stats.tx_packets++;
+		/* no completion left to flush it, send it with our request */
+		if (!in_flight)
+			dev->tx_aggr = NULL;
+		spin_unlock_irqrestore(&dev->req_lock, flags);
+		dev_consume_skb_any(skb);
+		return in_flight ? NULL : aggr;
+	}
+
+	/* nothing in flight to wait for, don't delay the frame */
+	if (!aggr && !in_flight) {
+		spin_unlock_irqrestore(&dev->req_lock, flags);
+		return skb;
+	}
+
+	out = aggr;
+	dev->tx_aggr = NULL;
+	if (skb->len <= max_len) {
+		aggr = alloc_skb(max_len + 1, GFP_ATOMIC);
+		if (aggr) {
+			skb_put_data(aggr, skb->data, skb->len);
+			dev_consume_skb_any(skb);
+			skb = aggr;
+			copied = true;
+		}
+	}
+
+	/*
+	 * The old aggregate goes with the request we hold. The frame starts
+	 * the next one, as a copy when possible, or else on its own.
+	 */
+	if (out || copied) {
+		dev->tx_aggr = skb;
+		skb = out;
+	}
+	spin_unlock_irqrestore(&dev->req_lock, flags);
+
+	return skb;
+}
+
+static void eth_tx_flush_aggr(struct eth_dev *dev)
+{
+	struct usb_request	*req;
+	struct sk_buff		*skb;
+	struct usb_ep		*in = NULL;
+	unsigned long		flags;
+
+	spin_lock_irqsave(&dev->lock, flags);
+	if (dev->port_usb)
+		in = dev->port_usb->in_ep;
+	spin_unlock_irqrestore(&dev->lock, flags);
+
+	if (!in)
+		return;
+
+	spin_lock_irqsave(&dev->req_lock, flags);
+	skb = dev->tx_aggr;
+	if (!skb || list_empty(&dev->tx_reqs)) {
+		spin_unlock_irqrestore(&dev->req_lock, flags);
+		return;
+	}
+	dev->tx_aggr = NULL;
+
+	req = list_first_entry(&dev->tx_reqs, struct usb_request, list);
+	list_del(&req->list);
+	if (list_empty(&dev->tx_reqs))
+		netif_stop_queue(dev->net);
+	spin_unlock_irqrestore(&dev->req_lock, flags);
+
+	if (eth_tx_submit(dev, in, req, skb)) {
+		dev_kfree_skb_any(skb);
+		dev->net->stats.tx_dropped++;
+
+		spin_lock_irqsave(&dev->req_lock, flags);
+		if (list_empty(&dev->tx_reqs))
+			netif_start_queue(dev->net);
+		list_add(&req->list, &dev->tx_reqs);
+		spin_unlock_irqrestore(&dev->req_lock, flags);
+	}
 }
 
 static inline int is_promisc(u16 cdc_filter)
@@ -471,20 +721,22 @@ static netdev_tx_t eth_start_xmit(struct sk_buff *skb,
 					struct net_device *net)
 {
 	struct eth_dev		*dev = netdev_priv(net);
-	int			length = 0;
 	int			retval;
 	struct usb_request	*req = NULL;
 	unsigned long		flags;
 	struct usb_ep		*in;
 	u16			cdc_filter;
+	u32			tx_aggr_len;
 
 	spin_lock_irqsave(&dev->lock, flags);
 	if (dev->port_usb) {
 		in = dev->port_usb->in_ep;
 		cdc_filter = dev->port_usb->cdc_filter;
+		tx_aggr_len = READ_ONCE(dev->port_usb->tx_aggr_len);
 	} else {
 		in = NULL;
 		cdc_filter = 0;
+		tx_aggr_len = 0;
 	}
 	spin_unlock_irqrestore(&dev->lock, flags);
 
@@ -556,39 +808,13 @@ static netdev_tx_t eth_start_xmit(struct sk_buff *skb,
 		}
 	}
 
-	length = skb->len;
-	req->buf = skb->data;
-	req->context = skb;
-	req->complete = tx_complete;
-
-	/* NCM requires no zlp if transfer is dwNtbInMaxSize */
-	if (dev->port_usb &&
-	    dev->port_usb->is_fixed &&
-	    length == dev->port_usb->fixed_in_len &&
-	    (length % in->maxpacket) == 0)
-		req->zero = 0;
-	else
-		req->zero = 1;
-
-	/* use zlp framing on tx for strict CDC-Ether conformance,
-	 * though any robust network rx path ignores extra padding.
-	 * and some hardware doesn't like to write zlps.
-	 */
-	if (req->zero && !dev->zlp && (length % in->maxpacket) == 0)
-		length++;
-
-	req->length = length;
-
-	retval = usb_ep_queue(in, req, GFP_ATOMIC);
-	switch (retval) {
-	default:
-		DBG(dev, "tx queue err %d\n", retval);
-		break;
-	case 0:
-		netif_trans_update(net);
-		atomic_inc(&dev->tx_qlen);
+	if (tx_aggr_len) {
+		skb = eth_tx_aggregate(dev, skb, tx_aggr_len);
+		if (!skb)
+			goto multiframe;
 	}
 
+	retval = eth_tx_submit(dev, in, req, skb);
 	if (retval) {
 		dev_kfree_skb_any(skb);
 drop:
@@ -623,6 +849,7 @@ static int eth_open(struct net_device *net)
 	struct gether	*link;
 
 	DBG(dev, "%s\n", __func__);
+	napi_enable(&dev->napi);
 	if (netif_carrier_ok(dev->net))
 		eth_start(dev, GFP_KERNEL);
 
@@ -642,6 +869,7 @@ static int eth_stop(struct net_device *net)
 
 	VDBG(dev, "%s\n", __func__);
 	netif_stop_queue(net);
+	napi_disable(&dev->napi);
 
 	DBG(dev, "stop stats: rx/tx %ld/%ld, errs %ld/%ld\n",
 		dev->net->stats.rx_packets, dev->net->stats.tx_packets,
@@ -681,6 +909,10 @@ static int eth_stop(struct net_device *net)
 	}
 	spin_unlock_irqrestore(&dev->lock, flags);
 
+	/* drop whatever completed after NAPI went down */
+	skb_queue_purge(&dev->rx_done);
+	skb_queue_purge(&dev->rx_frames);
+
 	return 0;
 }
 
@@ -762,6 +994,8 @@ struct eth_dev *gether_setup_name(struct usb_gadget *g,
 	INIT_LIST_HEAD(&dev->rx_reqs);
 
 	skb_queue_head_init(&dev->rx_frames);
+	skb_queue_head_init(&dev->rx_done);
+	netif_napi_add(net, &dev->napi, eth_rx_poll, NAPI_POLL_WEIGHT);
 
 	/* network device setup */
 	dev->net = net;
@@ -828,6 +1062,8 @@ struct net_device *gether_setup_name_default(const char *netname)
 	INIT_LIST_HEAD(&dev->rx_reqs);
 
 	skb_queue_head_init(&dev->rx_frames);
+	skb_queue_head_init(&dev->rx_done);
+	netif_napi_add(net, &dev->napi, eth_rx_poll, NAPI_POLL_WEIGHT);
 
 	/* network device setup */
 	dev->net = net;
@@ -1126,6 +1362,7 @@ void gether_disconnect(struct gether *link)
 	struct eth_dev		*dev = link->ioport;
 	struct usb_request	*req;
 	struct usb_request	*tmp;
+	struct sk_buff		*skb;
 
 	WARN_ON(!dev);
 	if (!dev)
@@ -1142,6 +1379,8 @@ void gether_disconnect(struct gether *link)
 	 */
 	usb_ep_disable(link->in_ep);
 	spin_lock(&dev->req_lock);
+	skb = dev->tx_aggr;
+	dev->tx_aggr = NULL;
 	list_for_each_entry_safe(req, tmp, &dev->tx_reqs, list) {
 		list_del(&req->list);
 
@@ -1151,6 +1390,7 @@ void gether_disconnect(struct gether *link)
 	}
 	spin_unlock(&dev->req_lock);
 	link->in_ep->desc = NULL;
+	dev_kfree_skb_any(skb);
 
 	usb_ep_disable(link->out_ep);
 	spin_lock(&dev->req_lock);
@@ -70,6 +70,10 @@ struct gether {
 	u32				fixed_out_len;
 	u32				fixed_in_len;
 	bool				supports_multi_frame;
+	/* largest transfer the host takes several wrapped frames in, or
+	 * 0 if it wants one frame per transfer
+	 */
+	u32				tx_aggr_len;
 	struct sk_buff			*(*wrap)(struct gether *port,
 						struct sk_buff *skb);
 	int				(*unwrap)(struct gether *port,
@@ -278,6 +278,8 @@ struct ffs_data {
 	struct eventfd_ctx *ffs_eventfd;
 	struct workqueue_struct *io_completion_wq;
 	bool no_disconnect;
+	/* do large synchronous transfers on the user pages, "zerocopy=1" */
+	bool zerocopy;
 	struct work_struct reset_work;
 
 	/*
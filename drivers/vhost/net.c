@@ -19,6 +19,7 @@
 #include <linux/slab.h>
 #include <linux/sched/clock.h>
 #include <linux/sched/signal.h>
+#include <linux/seq_file.h>
 #include <linux/vmalloc.h>
 
 #include <linux/net.h>
@@ -98,6 +99,9 @@ struct vhost_net_ubuf_ref {
 	struct vhost_virtqueue *vq;
 };
 
+/* Floor of the adaptive busy poll budget, in busy_clock() units */
+#define VHOST_NET_POLL_MIN 4
+
 #define VHOST_NET_BATCH 64
 struct vhost_net_buf {
 	void **queue;
@@ -123,6 +127,20 @@ struct vhost_net_virtqueue {
 	struct vhost_net_ubuf_ref *ubufs;
 	struct ptr_ring *rx_ring;
 	struct vhost_net_buf rxq;
+	/* Zerocopy TX used entries added but not signalled yet */
+	int used_pending;
+	/* Current busy poll budget, adapted between VHOST_NET_POLL_MIN and
+	 * the busyloop_timeout set by userspace.
+	 */
+	unsigned long poll_budget;
+	/* Per virtqueue counters, shown in fdinfo. Protected by vq mutex. */
+	struct {
+		u64 copy_pkts;
+		u64 zcopy_pkts;
+		u64 signals;
+		u64 polls;
+		u64 poll_hits;
+	} stats;
 };
 
 struct vhost_net {
@@ -343,8 +361,8 @@ static bool vhost_sock_zcopy(struct socket *sock)
  * of used idx. Once lower device DMA done contiguously, we will signal KVM
  * guest used idx.
  */
-static void vhost_zerocopy_signal_used(struct vhost_net *net,
-				       struct vhost_virtqueue *vq)
+static void vhost_zerocopy_complete(struct vhost_net *net,
+				    struct vhost_virtqueue *vq)
 {
 	struct vhost_net_virtqueue *nvq =
 		container_of(vq, struct vhost_net_virtqueue, vq);
@@ -362,13 +380,36 @@ static void vhost_zerocopy_signal_used(struct vhost_net *net,
 	}
 	while (j) {
 		add = min(UIO_MAXIOV - nvq->done_idx, j);
-		vhost_add_used_and_signal_n(vq->dev, vq,
-					    &vq->heads[nvq->done_idx], add);
+		vhost_add_used_n(vq, &vq->heads[nvq->done_idx], add);
 		nvq->done_idx = (nvq->done_idx + add) % UIO_MAXIOV;
+		nvq->used_pending += add;
 		j -= add;
 	}
 }
 
+/* Signal the guest once for all used entries added since the last call */
+static void vhost_zerocopy_flush(struct vhost_net_virtqueue *nvq)
+{
+	struct vhost_virtqueue *vq = &nvq->vq;
+
+	if (!nvq->used_pending)
+		return;
+
+	vhost_signal(vq->dev, vq);
+	nvq->used_pending = 0;
+	nvq->stats.signals++;
+}
+
+static void vhost_zerocopy_signal_used(struct vhost_net *net,
+				       struct vhost_virtqueue *vq)
+{
+	struct vhost_net_virtqueue *nvq =
+		container_of(vq, struct vhost_net_virtqueue, vq);
+
+	vhost_zerocopy_complete(net, vq);
+	vhost_zerocopy_flush(nvq);
+}
+
 static void vhost_zerocopy_callback(struct ubuf_info *ubuf, bool success)
 {
 	struct vhost_net_ubuf_ref *ubufs = ubuf->ctx;
@@ -406,6 +447,39 @@ static bool vhost_can_busy_poll(unsigned long endtime)
 		      !signal_pending(current));
 }
 
+static unsigned long vhost_net_poll_budget(struct vhost_net_virtqueue *nvq,
+					   unsigned long timeout)
+{
+	if (!nvq->poll_budget || nvq->poll_budget > timeout)
+		nvq->poll_budget = timeout;
+
+	nvq->stats.polls++;
+	return nvq->poll_budget;
+}
+
+/*
+ * Spinning only pays off while the queue keeps getting refilled within the
+ * budget: double it on every hit, halve it whenever the poll ran dry.
+ */
+static void vhost_net_poll_update(struct vhost_net_virtqueue *nvq,
+				  unsigned long timeout, bool hit)
+{
+	if (hit) {
+		nvq->stats.poll_hits++;
+		nvq->poll_budget = min(nvq->poll_budget * 2, timeout);
+	} else {
+		nvq->poll_budget = max(nvq->poll_budget / 2,
+				       min_t(unsigned long, timeout,
+					     VHOST_NET_POLL_MIN));
+	}
+}
+
+/* The queue was busy enough to exhaust the weight, poll for the full time */
+static void vhost_net_poll_busy(struct vhost_net_virtqueue *nvq)
+{
+	nvq->poll_budget = 0;
+}
+
 static void vhost_net_disable_vq(struct vhost_net *n,
 				 struct vhost_virtqueue *vq)
 {
@@ -442,6 +516,7 @@ static void vhost_net_signal_used(struct vhost_net_virtqueue *nvq)
 
 	vhost_add_used_and_signal_n(dev, vq, vq->heads, nvq->done_idx);
 	nvq->done_idx = 0;
+	nvq->stats.signals++;
 }
 
 static int vhost_net_tx_get_vq_desc(struct vhost_net *net,
@@ -455,20 +530,30 @@ static int vhost_net_tx_get_vq_desc(struct vhost_net *net,
 				  out_num, in_num, NULL, NULL);
 
 	if (r == vq->num && vq->busyloop_timeout) {
+		bool hit = false;
+
+		/* Let the guest see what is done before we start spinning */
 		if (!vhost_sock_zcopy(vq->private_data))
 			vhost_net_signal_used(nvq);
+		else
+			vhost_zerocopy_signal_used(net, vq);
 		preempt_disable();
-		endtime = busy_clock() + vq->busyloop_timeout;
+		endtime = busy_clock() +
+			  vhost_net_poll_budget(nvq, vq->busyloop_timeout);
 		while (vhost_can_busy_poll(endtime)) {
 			if (vhost_has_work(vq->dev)) {
 				*busyloop_intr = true;
 				break;
 			}
-			if (!vhost_vq_avail_empty(vq->dev, vq))
+			if (!vhost_vq_avail_empty(vq->dev, vq)) {
+				hit = true;
 				break;
+			}
 			cpu_relax();
 		}
 		preempt_enable();
+		if (!*busyloop_intr)
+			vhost_net_poll_update(nvq, vq->busyloop_timeout, hit);
 		r = vhost_get_vq_desc(vq, vq->iov, ARRAY_SIZE(vq->iov),
 				      out_num, in_num, NULL, NULL);
 	}
@@ -596,9 +681,11 @@ static void handle_tx_copy(struct vhost_net *net, struct socket *sock)
 		if (err != len)
 			pr_debug("Truncated TX packet: len %d != %zd\n",
 				 err, len);
+		nvq->stats.copy_pkts++;
 		if (++nvq->done_idx >= VHOST_NET_BATCH)
 			vhost_net_signal_used(nvq);
 		if (vhost_exceeds_weight(++sent_pkts, total_len)) {
+			vhost_net_poll_busy(nvq);
 			vhost_poll_queue(&vq->poll);
 			break;
 		}
@@ -629,8 +716,10 @@ static void handle_tx_zerocopy(struct vhost_net *net, struct socket *sock)
 	for (;;) {
 		bool busyloop_intr;
 
-		/* Release DMAs done buffers first */
-		vhost_zerocopy_signal_used(net, vq);
+		/* Release DMAs done buffers first, but signal in batches */
+		vhost_zerocopy_complete(net, vq);
+		if (nvq->used_pending >= VHOST_NET_BATCH)
+			vhost_zerocopy_flush(nvq);
 
 		busyloop_intr = false;
 		head = get_tx_bufs(net, nvq, &msg, &out, &in, &len,
@@ -696,16 +785,26 @@ static void handle_tx_zerocopy(struct vhost_net *net, struct socket *sock)
 		if (err != len)
 			pr_debug("Truncated TX packet: "
 				 " len %d != %zd\n", err, len);
-		if (!zcopy_used)
-			vhost_add_used_and_signal(&net->dev, vq, head, 0);
-		else
-			vhost_zerocopy_signal_used(net, vq);
+		/*
+		 * Copied buffers are done already; zerocopy ones are reaped
+		 * at the top of the loop once the lower device is done.
+		 */
+		if (!zcopy_used) {
+			vhost_add_used(vq, head, 0);
+			nvq->used_pending++;
+			nvq->stats.copy_pkts++;
+		} else {
+			nvq->stats.zcopy_pkts++;
+		}
 		vhost_net_tx_packet(net);
 		if (unlikely(vhost_exceeds_weight(++sent_pkts, total_len))) {
+			vhost_net_poll_busy(nvq);
 			vhost_poll_queue(&vq->poll);
 			break;
 		}
 	}
+
+	vhost_zerocopy_signal_used(net, vq);
 }
 
 /* Expects to be always run from workqueue - which acts as
@@ -778,6 +877,8 @@ static int vhost_net_rx_peek_head_len(struct vhost_net *net, struct sock *sk,
 	int len = peek_head_len(rnvq, sk);
 
 	if (!len && tvq->busyloop_timeout) {
+		bool hit = false;
+
 		/* Flush batched heads first */
 		vhost_net_signal_used(rnvq);
 		/* Both tx vq and rx socket were polled here */
@@ -785,7 +886,8 @@ static int vhost_net_rx_peek_head_len(struct vhost_net *net, struct sock *sk,
 		vhost_disable_notify(&net->dev, tvq);
 
 		preempt_disable();
-		endtime = busy_clock() + tvq->busyloop_timeout;
+		endtime = busy_clock() +
+			  vhost_net_poll_budget(rnvq, tvq->busyloop_timeout);
 
 		while (vhost_can_busy_poll(endtime)) {
 			if (vhost_has_work(&net->dev)) {
@@ -794,12 +896,16 @@ static int vhost_net_rx_peek_head_len(struct vhost_net *net, struct sock *sk,
 			}
 			if ((sk_has_rx_data(sk) &&
 			     !vhost_vq_avail_empty(&net->dev, rvq)) ||
-			    !vhost_vq_avail_empty(&net->dev, tvq))
+			    !vhost_vq_avail_empty(&net->dev, tvq)) {
+				hit = true;
 				break;
+			}
 			cpu_relax();
 		}
 
 		preempt_enable();
+		if (!*busyloop_intr)
+			vhost_net_poll_update(rnvq, tvq->busyloop_timeout, hit);
 
 		if (!vhost_vq_avail_empty(&net->dev, tvq)) {
 			vhost_poll_queue(&tvq->poll);
@@ -1021,12 +1127,14 @@ static void handle_rx(struct vhost_net *net)
 			goto out;
 		}
 		nvq->done_idx += headcount;
+		nvq->stats.copy_pkts++;
 		if (nvq->done_idx > VHOST_NET_BATCH)
 			vhost_net_signal_used(nvq);
 		if (unlikely(vq_log))
 			vhost_log_write(vq, vq_log, log, vhost_len);
 		total_len += vhost_len;
 		if (unlikely(vhost_exceeds_weight(++recv_pkts, total_len))) {
+			vhost_net_poll_busy(nvq);
 			vhost_poll_queue(&vq->poll);
 			goto out;
 		}
@@ -1111,6 +1219,9 @@ static int vhost_net_open(struct inode *inode, struct file *f)
 		n->vqs[i].vhost_hlen = 0;
 		n->vqs[i].sock_hlen = 0;
 		n->vqs[i].rx_ring = NULL;
+		n->vqs[i].used_pending = 0;
+		n->vqs[i].poll_budget = 0;
+		memset(&n->vqs[i].stats, 0, sizeof(n->vqs[i].stats));
 		vhost_net_buf_init(&n->vqs[i].rxq);
 	}
 	vhost_dev_init(dev, vqs, VHOST_NET_VQ_MAX);
@@ -1571,6 +1682,35 @@ static __poll_t vhost_net_chr_poll(struct file *file, poll_table *wait)
 	return vhost_chr_poll(file, dev, wait);
 }
 
+static void vhost_net_show_fdinfo(struct seq_file *m, struct file *f)
+{
+	static const char * const names[VHOST_NET_VQ_MAX] = {
+		[VHOST_NET_VQ_RX] = "rx",
+		[VHOST_NET_VQ_TX] = "tx",
+	};
+	struct vhost_net *n = f->private_data;
+	int i;
+
+	for (i = 0; i < VHOST_NET_VQ_MAX; i++) {
+		struct vhost_net_virtqueue *nvq = &n->vqs[i];
+
+		mutex_lock(&nvq->vq.mutex);
+		seq_printf(m, "%s-copy:\t%llu\n", names[i],
+			   nvq->stats.copy_pkts);
+		seq_printf(m, "%s-zerocopy:\t%llu\n", names[i],
+			   nvq->stats.zcopy_pkts);
+		seq_printf(m, "%s-signals:\t%llu\n", names[i],
+			   nvq->stats.signals);
+		seq_printf(m, "%s-polls:\t%llu\n", names[i],
+			   nvq->stats.polls);
+		seq_printf(m, "%s-poll-hits:\t%llu\n", names[i],
+			   nvq->stats.poll_hits);
+		seq_printf(m, "%s-poll-budget:\t%lu\n", names[i],
+			   nvq->poll_budget);
+		mutex_unlock(&nvq->vq.mutex);
+	}
+}
+
 static const struct file_operations vhost_net_fops = {
 	.owner          = THIS_MODULE,
 	.release        = vhost_net_release,
@@ -1583,6 +1723,7 @@ static const struct file_operations vhost_net_fops = {
 #endif
 	.open           = vhost_net_open,
 	.llseek		= noop_llseek,
+	.show_fdinfo	= vhost_net_show_fdinfo,
 };
 
 static struct miscdevice vhost_net_misc = {
@@ -327,6 +327,48 @@ vhost_vsock_alloc_pkt(struct vhost_virtqueue *vq,
 	return pkt;
 }
 
+static inline unsigned long busy_clock(void)
+{
+	return local_clock() >> 10;
+}
+
+static bool vhost_can_busy_poll(unsigned long endtime)
+{
+	return likely(!need_resched() && !time_after(busy_clock(), endtime) &&
+		      !signal_pending(current));
+}
+
+/* Spin on the tx avail ring for up to busyloop_timeout before waiting for
+ * the next guest kick.  Buffers used so far are signalled first so that the
+ * guest is not left waiting for them meanwhile.
+ */
+static bool vhost_vsock_tx_busy_poll(struct vhost_vsock *vsock,
+				     struct vhost_virtqueue *vq, bool *added)
+{
+	unsigned long endtime;
+	bool hit = false;
+
+	if (*added) {
+		vhost_signal(&vsock->dev, vq);
+		*added = false;
+	}
+
+	preempt_disable();
+	endtime = busy_clock() + vq->busyloop_timeout;
+	while (vhost_can_busy_poll(endtime)) {
+		if (vhost_has_work(&vsock->dev))
+			break;
+		if (!vhost_vq_avail_empty(&vsock->dev, vq)) {
+			hit = true;
+			break;
+		}
+		cpu_relax();
+	}
+	preempt_enable();
+
+	return hit;
+}
+
 /* Is there space left for replies to rx packets? */
 static bool vhost_vsock_more_replies(struct vhost_vsock *vsock)
 {
@@ -373,6 +415,9 @@ static void vhost_vsock_handle_tx_kick(struct vhost_work *work)
 			break;
 
 		if (head == vq->num) {
+			if (vq->busyloop_timeout &&
+			    vhost_vsock_tx_busy_poll(vsock, vq, &added))
+				continue;
 			if (unlikely(vhost_enable_notify(&vsock->dev, vq))) {
 				vhost_disable_notify(&vsock->dev, vq);
 				continue;
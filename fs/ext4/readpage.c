@@ -44,10 +44,45 @@
 #include <linux/backing-dev.h>
 #include <linux/pagevec.h>
 #include <linux/cleancache.h>
+#include <linux/llist.h>
+#include <linux/mempool.h>
+#include <linux/percpu.h>
+#include <linux/workqueue.h>
 
 #include "ext4.h"
 #include <trace/events/android_fs.h>
 
+#define NUM_PREALLOC_POST_READ_CTXS	128
+
+static struct kmem_cache *bio_post_read_ctx_cache;
+static mempool_t *bio_post_read_ctx_pool;
+static struct workqueue_struct *ext4_post_read_wq;
+
+/* postprocessing steps for read bios */
+enum bio_post_read_step {
+	STEP_DECRYPT,
+};
+
+struct bio_post_read_ctx {
+	struct bio *bio;
+	struct llist_node node;
+	unsigned int enabled_steps;
+};
+
+/*
+ * Bios needing postprocessing are queued on the list of the CPU they
+ * complete on, and a single work item per CPU processes whatever has
+ * accumulated there. The bios of a readahead window, which tend to complete
+ * together, are then handled in one worker pass instead of one work item
+ * each.
+ */
+struct post_read_batch {
+	struct llist_head list;
+	struct work_struct work;
+};
+
+static DEFINE_PER_CPU(struct post_read_batch, post_read_batch);
+
 static inline bool ext4_bio_encrypted(struct bio *bio)
 {
 #ifdef CONFIG_EXT4_FS_ENCRYPTION
@@ -57,6 +92,81 @@ static inline bool ext4_bio_encrypted(struct bio *bio)
 #endif
 }
 
+static void __read_end_io(struct bio *bio)
+{
+	struct bio_vec *bv;
+	int i;
+
+	bio_for_each_segment_all(bv, bio, i) {
+		struct page *page = bv->bv_page;
+
+		/* PG_error was set if any post_read step failed */
+		if (bio->bi_status || PageError(page)) {
+			ClearPageUptodate(page);
+			SetPageError(page);
+		} else {
+			SetPageUptodate(page);
+		}
+		unlock_page(page);
+	}
+
+	bio_put(bio);
+}
+
+static void post_read_batch_work(struct work_struct *work)
+{
+	struct post_read_batch *batch =
+		container_of(work, struct post_read_batch, work);
+	struct bio_post_read_ctx *ctx, *next;
+	struct llist_node *list;
+
+	list = llist_del_all(&batch->list);
+	list = llist_reverse_order(list);
+
+	llist_for_each_entry_safe(ctx, next, list, node) {
+		struct bio *bio = ctx->bio;
+
+		if (ctx->enabled_steps & (1 << STEP_DECRYPT))
+			fscrypt_decrypt_bio(bio);
+
+		mempool_free(ctx, bio_post_read_ctx_pool);
+		bio->bi_private = NULL;
+		__read_end_io(bio);
+	}
+}
+
+/*
+ * Runs from the bio completion, which is usually but not always in
+ * interrupt context, so stay on this cpu until the batch is queued.
+ */
+static void bio_post_read_queue(struct bio_post_read_ctx *ctx)
+{
+	int cpu = get_cpu();
+	struct post_read_batch *batch = per_cpu_ptr(&post_read_batch, cpu);
+
+	if (llist_add(&ctx->node, &batch->list))
+		queue_work_on(cpu, ext4_post_read_wq, &batch->work);
+	put_cpu();
+}
+
+static struct bio_post_read_ctx *get_bio_post_read_ctx(struct inode *inode,
+						       struct bio *bio)
+{
+	unsigned int post_read_steps = 0;
+	struct bio_post_read_ctx *ctx = NULL;
+
+	if (ext4_encrypted_inode(inode) && S_ISREG(inode->i_mode))
+		post_read_steps |= 1 << STEP_DECRYPT;
+
+	if (post_read_steps) {
+		ctx = mempool_alloc(bio_post_read_ctx_pool, GFP_NOFS);
+		ctx->bio = bio;
+		ctx->enabled_steps = post_read_steps;
+		bio->bi_private = ctx;
+	}
+	return ctx;
+}
+
 static void
 ext4_trace_read_completion(struct bio *bio)
 {
@@ -82,33 +192,20 @@ ext4_trace_read_completion(struct bio *bio)
  */
 static void mpage_end_io(struct bio *bio)
 {
-	struct bio_vec *bv;
-	int i;
-
 	if (trace_android_fs_dataread_start_enabled())
 		ext4_trace_read_completion(bio);
 
 	if (ext4_bio_encrypted(bio)) {
-		if (bio->bi_status) {
-			fscrypt_release_ctx(bio->bi_private);
-		} else {
-			fscrypt_enqueue_decrypt_bio(bio->bi_private, bio);
-			return;
-		}
-	}
-	bio_for_each_segment_all(bv, bio, i) {
-		struct page *page = bv->bv_page;
+		struct bio_post_read_ctx *ctx = bio->bi_private;
 
 		if (!bio->bi_status) {
-			SetPageUptodate(page);
-		} else {
-			ClearPageUptodate(page);
-			SetPageError(page);
+			bio_post_read_queue(ctx);
+			return;
 		}
-		unlock_page(page);
+		mempool_free(ctx, bio_post_read_ctx_pool);
+		bio->bi_private = NULL;
 	}
-
-	bio_put(bio);
+	__read_end_io(bio);
 }
 
 static void
@@ -279,25 +376,15 @@ int ext4_mpage_readpages(struct address_space *mapping,
 			bio = NULL;
 		}
 		if (bio == NULL) {
-			struct fscrypt_ctx *ctx = NULL;
-
-			if (ext4_encrypted_inode(inode) &&
-			    S_ISREG(inode->i_mode)) {
-				ctx = fscrypt_get_ctx(inode, GFP_NOFS);
-				if (IS_ERR(ctx))
-					goto set_error_page;
-			}
 			bio = bio_alloc(GFP_KERNEL,
 				min_t(int, nr_pages, BIO_MAX_PAGES));
-			if (!bio) {
-				if (ctx)
-					fscrypt_release_ctx(ctx);
+			if (!bio)
 				goto set_error_page;
-			}
 			bio_set_dev(bio, bdev);
 			bio->bi_iter.bi_sector = blocks[0] << (blkbits - 9);
 			bio->bi_end_io = mpage_end_io;
-			bio->bi_private = ctx;
+			bio->bi_private = NULL;
+			get_bio_post_read_ctx(inode, bio);
 			bio_set_op_attrs(bio, REQ_OP_READ,
 						is_readahead ? REQ_RAHEAD : 0);
 		}
@@ -332,3 +419,43 @@ int ext4_mpage_readpages(struct address_space *mapping,
 		ext4_submit_bio_read(bio);
 	return 0;
 }
+
+int __init ext4_init_post_read_processing(void)
+{
+	int cpu;
+
+	bio_post_read_ctx_cache = KMEM_CACHE(bio_post_read_ctx, 0);
+	if (!bio_post_read_ctx_cache)
+		goto fail;
+	bio_post_read_ctx_pool =
+		mempool_create_slab_pool(NUM_PREALLOC_POST_READ_CTXS,
+					 bio_post_read_ctx_cache);
+	if (!bio_post_read_ctx_pool)
+		goto fail_free_cache;
+	ext4_post_read_wq = alloc_workqueue("ext4_post_read",
+					    WQ_HIGHPRI | WQ_MEM_RECLAIM, 0);
+	if (!ext4_post_read_wq)
+		goto fail_free_pool;
+
+	for_each_possible_cpu(cpu) {
+		struct post_read_batch *batch = &per_cpu(post_read_batch, cpu);
+
+		init_llist_head(&batch->list);
+		INIT_WORK(&batch->work, post_read_batch_work);
+	}
+	return 0;
+
+fail_free_pool:
+	mempool_destroy(bio_post_read_ctx_pool);
+fail_free_cache:
+	kmem_cache_destroy(bio_post_read_ctx_cache);
+fail:
+	return -ENOMEM;
+}
+
+void ext4_exit_post_read_processing(void)
+{
+	destroy_workqueue(ext4_post_read_wq);
+	mempool_destroy(bio_post_read_ctx_pool);
+	kmem_cache_destroy(bio_post_read_ctx_cache);
+}
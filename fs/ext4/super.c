@@ -5955,6 +5955,10 @@ static int __init ext4_init_fs(void)
 		return err;
 
 	err = ext4_init_pageio();
+	if (err)
+		goto out6;
+
+	err = ext4_init_post_read_processing();
 	if (err)
 		goto out5;
 
@@ -5990,8 +5994,10 @@ static int __init ext4_init_fs(void)
 out3:
 	ext4_exit_system_zone();
 out4:
-	ext4_exit_pageio();
+	ext4_exit_post_read_processing();
 out5:
+	ext4_exit_pageio();
+out6:
 	ext4_exit_es();
 
 	return err;
@@ -6007,6 +6013,7 @@ static void __exit ext4_exit_fs(void)
 	ext4_exit_mballoc();
 	ext4_exit_sysfs();
 	ext4_exit_system_zone();
+	ext4_exit_post_read_processing();
 	ext4_exit_pageio();
 	ext4_exit_es();
 }
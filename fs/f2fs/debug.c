@@ -66,6 +66,9 @@ static void update_general_status(struct f2fs_sb_info *sbi)
 		si->flush_list_empty =
 			llist_empty(&SM_I(sbi)->fcc_info->issue_list);
 	}
+	si->nr_ckpt_issued = atomic_read(&sbi->cprc_info.issued_ckpt);
+	si->nr_ckpt_total = atomic_read(&sbi->cprc_info.total_ckpt);
+	si->nr_ckpt_queued = atomic_read(&sbi->cprc_info.queued_ckpt);
 	if (SM_I(sbi) && SM_I(sbi)->dcc_info) {
 		si->nr_discarded =
 			atomic_read(&SM_I(sbi)->dcc_info->issued_discard);
@@ -333,6 +336,9 @@ static int stat_show(struct seq_file *s, void *v)
 			   si->prefree_count, si->free_segs, si->free_secs);
 		seq_printf(s, "CP calls: %d (BG: %d)\n",
 				si->cp_count, si->bg_cp_count);
+		seq_printf(s, "  - merged: %d (requests: %d, queued: %d)\n",
+				si->nr_ckpt_issued, si->nr_ckpt_total,
+				si->nr_ckpt_queued);
 		seq_printf(s, "GC calls: %d (BG: %d)\n",
 			   si->call_count, si->bg_gc);
 		seq_printf(s, "  - data segments : %d (%d)\n",
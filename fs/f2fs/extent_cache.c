@@ -18,6 +18,31 @@
 #include "node.h"
 #include <trace/events/f2fs.h>
 
+/*
+ * Readers look up the largest extent and the cached node without et->lock,
+ * see f2fs_lookup_extent_tree_fast(). Every change to the tree is made in a
+ * write section of et->seq, so they can tell when they raced with a writer.
+ */
+static inline void __extent_tree_write_lock(struct extent_tree *et)
+{
+	write_lock(&et->lock);
+	write_seqcount_begin(&et->seq);
+}
+
+static inline bool __extent_tree_write_trylock(struct extent_tree *et)
+{
+	if (!write_trylock(&et->lock))
+		return false;
+	write_seqcount_begin(&et->seq);
+	return true;
+}
+
+static inline void __extent_tree_write_unlock(struct extent_tree *et)
+{
+	write_seqcount_end(&et->seq);
+	write_unlock(&et->lock);
+}
+
 static struct rb_entry *__lookup_rb_tree_fast(struct rb_entry *cached_re,
 							unsigned int ofs)
 {
@@ -260,6 +285,7 @@ static struct extent_tree *__grab_extent_tree(struct inode *inode)
 		et->root = RB_ROOT;
 		et->cached_en = NULL;
 		rwlock_init(&et->lock);
+		seqcount_init(&et->seq);
 		INIT_LIST_HEAD(&et->list);
 		atomic_set(&et->node_cnt, 0);
 		atomic_inc(&sbi->total_ext_tree);
@@ -343,7 +369,7 @@ static bool __f2fs_init_extent_tree(struct inode *inode, struct f2fs_extent *i_e
 
 	get_extent_info(&ei, i_ext);
 
-	write_lock(&et->lock);
+	__extent_tree_write_lock(et);
 	if (atomic_read(&et->node_cnt))
 		goto out;
 
@@ -354,7 +380,7 @@ static bool __f2fs_init_extent_tree(struct inode *inode, struct f2fs_extent *i_e
 		spin_unlock(&sbi->extent_lock);
 	}
 out:
-	write_unlock(&et->lock);
+	__extent_tree_write_unlock(et);
 	return false;
 }
 
@@ -368,18 +394,67 @@ bool f2fs_init_extent_tree(struct inode *inode, struct f2fs_extent *i_ext)
 	return ret;
 }
 
+/*
+ * Lockless lookup of the largest extent and of the cached node, the ones hot
+ * sequential readers hit. Extent nodes come from a SLAB_TYPESAFE_BY_RCU
+ * cache, so a node freed under us can still be read and is caught by the
+ * et->seq retry. A hit on the cached node doesn't refresh its LRU position;
+ * that was done when it became the cached node.
+ */
+static bool f2fs_lookup_extent_tree_fast(struct extent_tree *et,
+				pgoff_t pgofs, struct extent_info *ei,
+				bool *largest)
+{
+	struct extent_node *en;
+	unsigned int seq;
+	bool ret;
+
+	rcu_read_lock();
+	do {
+		seq = read_seqcount_begin(&et->seq);
+
+		ret = true;
+		*largest = true;
+		*ei = et->largest;
+		if (ei->fofs <= pgofs && ei->fofs + ei->len > pgofs)
+			continue;
+
+		*largest = false;
+		en = READ_ONCE(et->cached_en);
+		if (en) {
+			*ei = en->ei;
+			if (ei->fofs <= pgofs && ei->fofs + ei->len > pgofs)
+				continue;
+		}
+		ret = false;
+	} while (read_seqcount_retry(&et->seq, seq));
+	rcu_read_unlock();
+
+	return ret;
+}
+
 static bool f2fs_lookup_extent_tree(struct inode *inode, pgoff_t pgofs,
 							struct extent_info *ei)
 {
 	struct f2fs_sb_info *sbi = F2FS_I_SB(inode);
 	struct extent_tree *et = F2FS_I(inode)->extent_tree;
 	struct extent_node *en;
-	bool ret = false;
+	bool ret = false, largest;
 
 	f2fs_bug_on(sbi, !et);
 
 	trace_f2fs_lookup_extent_tree_start(inode, pgofs);
 
+	if (f2fs_lookup_extent_tree_fast(et, pgofs, ei, &largest)) {
+		if (largest)
+			stat_inc_largest_node_hit(sbi);
+		else
+			stat_inc_cached_node_hit(sbi);
+		stat_inc_total_hit(sbi);
+		trace_f2fs_lookup_extent_tree_end(inode, pgofs, ei);
+		return true;
+	}
+
 	read_lock(&et->lock);
 
 	if (et->largest.fofs <= pgofs &&
@@ -503,10 +578,10 @@ static void f2fs_update_extent_tree_range(struct inode *inode,
 
 	trace_f2fs_update_extent_tree_range(inode, fofs, blkaddr, len);
 
-	write_lock(&et->lock);
+	__extent_tree_write_lock(et);
 
 	if (is_inode_flag_set(inode, FI_NO_EXTENT)) {
-		write_unlock(&et->lock);
+		__extent_tree_write_unlock(et);
 		return;
 	}
 
@@ -606,7 +681,7 @@ static void f2fs_update_extent_tree_range(struct inode *inode,
 	if (is_inode_flag_set(inode, FI_NO_EXTENT))
 		__free_extent_tree(sbi, et);
 
-	write_unlock(&et->lock);
+	__extent_tree_write_unlock(et);
 }
 
 unsigned int f2fs_shrink_extent_tree(struct f2fs_sb_info *sbi, int nr_shrink)
@@ -628,9 +703,9 @@ unsigned int f2fs_shrink_extent_tree(struct f2fs_sb_info *sbi, int nr_shrink)
 	/* 1. remove unreferenced extent tree */
 	list_for_each_entry_safe(et, next, &sbi->zombie_list, list) {
 		if (atomic_read(&et->node_cnt)) {
-			write_lock(&et->lock);
+			__extent_tree_write_lock(et);
 			node_cnt += __free_extent_tree(sbi, et);
-			write_unlock(&et->lock);
+			__extent_tree_write_unlock(et);
 		}
 		f2fs_bug_on(sbi, atomic_read(&et->node_cnt));
 		list_del_init(&et->list);
@@ -660,7 +735,7 @@ unsigned int f2fs_shrink_extent_tree(struct f2fs_sb_info *sbi, int nr_shrink)
 		en = list_first_entry(&sbi->extent_list,
 					struct extent_node, list);
 		et = en->et;
-		if (!write_trylock(&et->lock)) {
+		if (!__extent_tree_write_trylock(et)) {
 			/* refresh this extent node's position in extent list */
 			list_move_tail(&en->list, &sbi->extent_list);
 			continue;
@@ -671,7 +746,7 @@ unsigned int f2fs_shrink_extent_tree(struct f2fs_sb_info *sbi, int nr_shrink)
 
 		__detach_extent_node(sbi, et, en);
 
-		write_unlock(&et->lock);
+		__extent_tree_write_unlock(et);
 		node_cnt++;
 		spin_lock(&sbi->extent_lock);
 	}
@@ -694,9 +769,9 @@ unsigned int f2fs_destroy_extent_node(struct inode *inode)
 	if (!et || !atomic_read(&et->node_cnt))
 		return 0;
 
-	write_lock(&et->lock);
+	__extent_tree_write_lock(et);
 	node_cnt = __free_extent_tree(sbi, et);
-	write_unlock(&et->lock);
+	__extent_tree_write_unlock(et);
 
 	return node_cnt;
 }
@@ -711,10 +786,10 @@ void f2fs_drop_extent_tree(struct inode *inode)
 
 	set_inode_flag(inode, FI_NO_EXTENT);
 
-	write_lock(&et->lock);
+	__extent_tree_write_lock(et);
 	__free_extent_tree(sbi, et);
 	__drop_largest_extent(inode, 0, UINT_MAX);
-	write_unlock(&et->lock);
+	__extent_tree_write_unlock(et);
 }
 
 void f2fs_destroy_extent_tree(struct inode *inode)
@@ -806,8 +881,10 @@ int __init f2fs_create_extent_cache(void)
 			sizeof(struct extent_tree));
 	if (!extent_tree_slab)
 		return -ENOMEM;
-	extent_node_slab = f2fs_kmem_cache_create("f2fs_extent_node",
-			sizeof(struct extent_node));
+	/* lockless lookups may read nodes which are being freed */
+	extent_node_slab = kmem_cache_create("f2fs_extent_node",
+			sizeof(struct extent_node), 0,
+			SLAB_RECLAIM_ACCOUNT | SLAB_TYPESAFE_BY_RCU, NULL);
 	if (!extent_node_slab) {
 		kmem_cache_destroy(extent_tree_slab);
 		return -ENOMEM;
@@ -23,12 +23,98 @@
 #include "gc.h"
 #include <trace/events/f2fs.h>
 
+/*
+ * Requests completed by the device since the last sample, and their average
+ * service time, from the block layer disk stats.
+ */
+static u64 gc_sample_device(struct f2fs_sb_info *sbi, unsigned int *lat_us)
+{
+	struct f2fs_gc_kthread *gc_th = sbi->gc_thread;
+	struct hd_struct *part = sbi->sb->s_bdev->bd_part;
+	u64 ios, nsecs, delta;
+
+	ios = part_stat_read(part, ios[STAT_READ]) +
+		part_stat_read(part, ios[STAT_WRITE]);
+	nsecs = part_stat_read(part, nsecs[STAT_READ]) +
+		part_stat_read(part, nsecs[STAT_WRITE]);
+
+	delta = ios - gc_th->last_ios;
+	*lat_us = delta ? div64_u64(nsecs - gc_th->last_nsecs, delta) /
+							NSEC_PER_USEC : 0;
+
+	gc_th->last_ios = ios;
+	gc_th->last_nsecs = nsecs;
+	return delta;
+}
+
+/*
+ * With idle_window_ms set, watch the device for that long before starting
+ * background GC, and only go ahead if it didn't complete any request in the
+ * meantime. is_idle() alone only sees f2fs's own activity and the legacy
+ * request lists.
+ */
+static bool gc_idle_window(struct f2fs_sb_info *sbi)
+{
+	struct f2fs_gc_kthread *gc_th = sbi->gc_thread;
+	unsigned int window = gc_th->idle_window_ms;
+	unsigned int lat_us;
+
+	if (!window)
+		return true;
+
+	gc_sample_device(sbi, &lat_us);
+	/* don't hold up unmount or suspend for the rest of the window */
+	if (wait_event_interruptible_timeout(gc_th->gc_wait_queue_head,
+				kthread_should_stop() || freezing(current),
+				msecs_to_jiffies(window)))
+		return false;
+	if (gc_sample_device(sbi, &lat_us)) {
+		gc_th->busy_windows++;
+		return false;
+	}
+
+	gc_th->idle_windows++;
+	return true;
+}
+
+/*
+ * Account the GC round which just finished, and tell whether another victim
+ * may be collected in the same idle window. gc_mutex is held on success.
+ */
+static bool gc_next_round(struct f2fs_sb_info *sbi, unsigned long start,
+							unsigned int rounds)
+{
+	struct f2fs_gc_kthread *gc_th = sbi->gc_thread;
+	unsigned int lat_us;
+
+	gc_sample_device(sbi, &lat_us);
+	gc_th->last_round_ms = jiffies_to_msecs(jiffies - start);
+	gc_th->last_round_lat_us = lat_us;
+	gc_th->max_round_lat_us = max(gc_th->max_round_lat_us, lat_us);
+
+	if (!gc_th->idle_window_ms || sbi->gc_mode == GC_URGENT)
+		return false;
+	if (rounds >= gc_th->victims_per_window)
+		return false;
+	if (gc_th->lat_target_us && lat_us > gc_th->lat_target_us) {
+		gc_th->throttled_windows++;
+		return false;
+	}
+	if (kthread_should_stop() || freezing(current))
+		return false;
+	if (!has_enough_invalid_blocks(sbi))
+		return false;
+
+	return mutex_trylock(&sbi->gc_mutex);
+}
+
 static int gc_thread_func(void *data)
 {
 	struct f2fs_sb_info *sbi = data;
 	struct f2fs_gc_kthread *gc_th = sbi->gc_thread;
 	wait_queue_head_t *wq = &sbi->gc_thread->gc_wait_queue_head;
-	unsigned int wait_ms;
+	unsigned int wait_ms, rounds, lat_us;
+	unsigned long start;
 
 	wait_ms = gc_th->min_sleep_time;
 
@@ -58,6 +144,11 @@ static int gc_thread_func(void *data)
 			f2fs_stop_checkpoint(sbi, false);
 		}
 
+		if (sbi->gc_mode != GC_URGENT && !gc_idle_window(sbi)) {
+			increase_sleep_time(gc_th, &wait_ms);
+			continue;
+		}
+
 		if (!sb_start_write_trylock(sbi->sb))
 			continue;
 
@@ -94,11 +185,19 @@ static int gc_thread_func(void *data)
 		else
 			increase_sleep_time(gc_th, &wait_ms);
 do_gc:
-		stat_inc_bggc_count(sbi);
-
-		/* if return value is not zero, no victim was selected */
-		if (f2fs_gc(sbi, test_opt(sbi, FORCE_FG_GC), true, NULL_SEGNO))
-			wait_ms = gc_th->no_gc_sleep_time;
+		rounds = 0;
+		do {
+			stat_inc_bggc_count(sbi);
+			start = jiffies;
+			gc_sample_device(sbi, &lat_us);
+
+			/* if return value isn't zero, no victim was selected */
+			if (f2fs_gc(sbi, test_opt(sbi, FORCE_FG_GC), true,
+							NULL_SEGNO)) {
+				wait_ms = gc_th->no_gc_sleep_time;
+				break;
+			}
+		} while (gc_next_round(sbi, start, ++rounds));
 
 		trace_f2fs_background_gc(sbi->sb, wait_ms,
 				prefree_segments(sbi), free_segments(sbi));
@@ -129,6 +228,18 @@ int f2fs_start_gc_thread(struct f2fs_sb_info *sbi)
 	gc_th->max_sleep_time = DEF_GC_THREAD_MAX_SLEEP_TIME;
 	gc_th->no_gc_sleep_time = DEF_GC_THREAD_NOGC_SLEEP_TIME;
 
+	gc_th->idle_window_ms = DEF_GC_IDLE_WINDOW_MS;
+	gc_th->lat_target_us = DEF_GC_LAT_TARGET_US;
+	gc_th->victims_per_window = DEF_GC_VICTIMS_PER_WINDOW;
+	gc_th->last_ios = 0;
+	gc_th->last_nsecs = 0;
+	gc_th->idle_windows = 0;
+	gc_th->busy_windows = 0;
+	gc_th->throttled_windows = 0;
+	gc_th->last_round_ms = 0;
+	gc_th->last_round_lat_us = 0;
+	gc_th->max_round_lat_us = 0;
+
 	gc_th->gc_wake= 0;
 
 	sbi->gc_thread = gc_th;
@@ -17,6 +17,9 @@
 #define DEF_GC_THREAD_MIN_SLEEP_TIME	30000	/* milliseconds */
 #define DEF_GC_THREAD_MAX_SLEEP_TIME	60000
 #define DEF_GC_THREAD_NOGC_SLEEP_TIME	300000	/* wait 5 min */
+#define DEF_GC_IDLE_WINDOW_MS		0	/* no device idle probing */
+#define DEF_GC_LAT_TARGET_US		0	/* no latency target */
+#define DEF_GC_VICTIMS_PER_WINDOW	1	/* victims per idle window */
 #define LIMIT_INVALID_BLOCK	40 /* percentage over total user space */
 #define LIMIT_FREE_BLOCK	40 /* percentage over invalid + free space */
 
@@ -37,6 +40,21 @@ struct f2fs_gc_kthread {
 
 	/* for changing gc mode */
 	unsigned int gc_wake;
+
+	/* for scheduling gc in device idle windows */
+	unsigned int idle_window_ms;	/* probe length, 0 to disable */
+	unsigned int lat_target_us;	/* stop the window above it, 0: none */
+	unsigned int victims_per_window;
+	u64 last_ios;			/* disk stats at the last sample */
+	u64 last_nsecs;
+
+	/* latency impact of background gc */
+	unsigned int idle_windows;	/* windows found idle */
+	unsigned int busy_windows;	/* windows skipped, device busy */
+	unsigned int throttled_windows;	/* windows cut by lat_target_us */
+	unsigned int last_round_ms;	/* duration of the last gc round */
+	unsigned int last_round_lat_us;	/* avg device latency during it */
+	unsigned int max_round_lat_us;
 };
 
 struct gc_inode_list {
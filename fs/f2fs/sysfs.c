@@ -372,6 +372,11 @@ static struct f2fs_attr f2fs_attr_##_name = {			\
 		f2fs_sbi_show, f2fs_sbi_store,			\
 		offsetof(struct struct_name, elname))
 
+#define F2FS_RO_ATTR(struct_type, struct_name, name, elname)	\
+	F2FS_ATTR_OFFSET(struct_type, name, 0444,		\
+		f2fs_sbi_show, NULL,				\
+		offsetof(struct struct_name, elname))
+
 #define F2FS_GENERAL_RO_ATTR(name) \
 static struct f2fs_attr f2fs_attr_##name = __ATTR(name, 0444, name##_show, NULL)
 
@@ -387,6 +392,19 @@ F2FS_RW_ATTR(GC_THREAD, f2fs_gc_kthread, gc_urgent_sleep_time,
 F2FS_RW_ATTR(GC_THREAD, f2fs_gc_kthread, gc_min_sleep_time, min_sleep_time);
 F2FS_RW_ATTR(GC_THREAD, f2fs_gc_kthread, gc_max_sleep_time, max_sleep_time);
 F2FS_RW_ATTR(GC_THREAD, f2fs_gc_kthread, gc_no_gc_sleep_time, no_gc_sleep_time);
+F2FS_RW_ATTR(GC_THREAD, f2fs_gc_kthread, gc_idle_window_ms, idle_window_ms);
+F2FS_RW_ATTR(GC_THREAD, f2fs_gc_kthread, gc_lat_target_us, lat_target_us);
+F2FS_RW_ATTR(GC_THREAD, f2fs_gc_kthread, gc_victims_per_window,
+							victims_per_window);
+F2FS_RO_ATTR(GC_THREAD, f2fs_gc_kthread, gc_idle_windows, idle_windows);
+F2FS_RO_ATTR(GC_THREAD, f2fs_gc_kthread, gc_busy_windows, busy_windows);
+F2FS_RO_ATTR(GC_THREAD, f2fs_gc_kthread, gc_throttled_windows,
+							throttled_windows);
+F2FS_RO_ATTR(GC_THREAD, f2fs_gc_kthread, gc_last_round_ms, last_round_ms);
+F2FS_RO_ATTR(GC_THREAD, f2fs_gc_kthread, gc_last_round_lat_us,
+							last_round_lat_us);
+F2FS_RO_ATTR(GC_THREAD, f2fs_gc_kthread, gc_max_round_lat_us,
+							max_round_lat_us);
 F2FS_RW_ATTR(F2FS_SBI, f2fs_sb_info, gc_idle, gc_mode);
 F2FS_RW_ATTR(F2FS_SBI, f2fs_sb_info, gc_urgent, gc_mode);
 F2FS_RW_ATTR(SM_INFO, f2fs_sm_info, reclaim_segments, rec_prefree_segments);
@@ -441,6 +459,15 @@ static struct attribute *f2fs_attrs[] = {
 	ATTR_LIST(gc_min_sleep_time),
 	ATTR_LIST(gc_max_sleep_time),
 	ATTR_LIST(gc_no_gc_sleep_time),
+	ATTR_LIST(gc_idle_window_ms),
+	ATTR_LIST(gc_lat_target_us),
+	ATTR_LIST(gc_victims_per_window),
+	ATTR_LIST(gc_idle_windows),
+	ATTR_LIST(gc_busy_windows),
+	ATTR_LIST(gc_throttled_windows),
+	ATTR_LIST(gc_last_round_ms),
+	ATTR_LIST(gc_last_round_lat_us),
+	ATTR_LIST(gc_max_round_lat_us),
 	ATTR_LIST(gc_idle),
 	ATTR_LIST(gc_urgent),
 	ATTR_LIST(reclaim_segments),
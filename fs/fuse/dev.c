@@ -327,11 +327,53 @@ static void queue_request(struct fuse_iqueue *fiq, struct fuse_req *req)
 {
 	req->in.h.len = sizeof(struct fuse_in_header) +
 		len_args(req->in.numargs, (struct fuse_arg *) req->in.args);
+	req->iq = fiq;
 	list_add_tail(&req->list, &fiq->pending);
 	wake_up_locked(&fiq->waitq);
 	kill_fasync(&fiq->fasync, SIGIO, POLL_IN);
 }
 
+/*
+ * Lock and return the input queue a new request goes to: the queue of the
+ * current CPU if multiqueue is enabled and a device is bound to it, else the
+ * shared queue.
+ */
+static struct fuse_iqueue *fuse_lock_iq(struct fuse_conn *fc)
+{
+	/* Pairs with smp_store_release() in fuse_init_iqs() */
+	unsigned nr_iqs = smp_load_acquire(&fc->nr_iqs);
+	struct fuse_iqueue *fiq;
+
+	if (nr_iqs) {
+		fiq = &fc->iqs[raw_smp_processor_id() % nr_iqs];
+		spin_lock(&fiq->waitq.lock);
+		if (fiq->nr_readers)
+			return fiq;
+		spin_unlock(&fiq->waitq.lock);
+	}
+
+	fiq = &fc->iq;
+	spin_lock(&fiq->waitq.lock);
+	return fiq;
+}
+
+/*
+ * Lock the input queue of a request.  Requests are moved from a per-CPU
+ * queue to the shared one when the last device bound to it is released.
+ */
+static struct fuse_iqueue *fuse_lock_req_iq(struct fuse_req *req)
+{
+	struct fuse_iqueue *fiq;
+
+	for (;;) {
+		fiq = READ_ONCE(req->iq);
+		spin_lock(&fiq->waitq.lock);
+		if (fiq == req->iq)
+			return fiq;
+		spin_unlock(&fiq->waitq.lock);
+	}
+}
+
 void fuse_queue_forget(struct fuse_conn *fc, struct fuse_forget_link *forget,
 		       u64 nodeid, u64 nlookup)
 {
@@ -357,12 +399,12 @@ static void flush_bg_queue(struct fuse_conn *fc)
 	while (fc->active_background < fc->max_background &&
 	       !list_empty(&fc->bg_queue)) {
 		struct fuse_req *req;
-		struct fuse_iqueue *fiq = &fc->iq;
+		struct fuse_iqueue *fiq;
 
 		req = list_entry(fc->bg_queue.next, struct fuse_req, list);
 		list_del(&req->list);
 		fc->active_background++;
-		spin_lock(&fiq->waitq.lock);
+		fiq = fuse_lock_iq(fc);
 		req->in.h.unique = fuse_get_unique(fiq);
 		queue_request(fiq, req);
 		spin_unlock(&fiq->waitq.lock);
@@ -456,7 +498,7 @@ static void request_wait_answer(struct fuse_conn *fc, struct fuse_req *req)
 		if (!err)
 			return;
 
-		spin_lock(&fiq->waitq.lock);
+		fiq = fuse_lock_req_iq(req);
 		/* Request is not yet in userspace, bail out */
 		if (test_bit(FR_PENDING, &req->flags)) {
 			list_del(&req->list);
@@ -477,10 +519,10 @@ static void request_wait_answer(struct fuse_conn *fc, struct fuse_req *req)
 
 static void __fuse_request_send(struct fuse_conn *fc, struct fuse_req *req)
 {
-	struct fuse_iqueue *fiq = &fc->iq;
+	struct fuse_iqueue *fiq;
 
 	BUG_ON(test_bit(FR_BACKGROUND, &req->flags));
-	spin_lock(&fiq->waitq.lock);
+	fiq = fuse_lock_iq(fc);
 	if (!fiq->connected) {
 		spin_unlock(&fiq->waitq.lock);
 		req->out.h.error = -ENOTCONN;
@@ -1234,7 +1276,7 @@ static ssize_t fuse_dev_do_read(struct fuse_dev *fud, struct file *file,
 {
 	ssize_t err;
 	struct fuse_conn *fc = fud->fc;
-	struct fuse_iqueue *fiq = &fc->iq;
+	struct fuse_iqueue *fiq = READ_ONCE(fud->iq);
 	struct fuse_pqueue *fpq = &fud->pq;
 	struct fuse_req *req;
 	struct fuse_in *in;
@@ -1316,8 +1358,9 @@ static ssize_t fuse_dev_do_read(struct fuse_dev *fud, struct file *file,
 	set_bit(FR_SENT, &req->flags);
 	/* matches barrier in request_wait_answer() */
 	smp_mb__after_atomic();
+	/* Interrupts are always read from the shared queue */
 	if (test_bit(FR_INTERRUPTED, &req->flags))
-		queue_interrupt(fiq, req);
+		queue_interrupt(&fc->iq, req);
 
 	return reqsize;
 
@@ -2037,7 +2080,7 @@ static __poll_t fuse_dev_poll(struct file *file, poll_table *wait)
 	if (!fud)
 		return EPOLLERR;
 
-	fiq = &fud->fc->iq;
+	fiq = READ_ONCE(fud->iq);
 	poll_wait(file, &fiq->waitq, wait);
 
 	spin_lock(&fiq->waitq.lock);
@@ -2082,6 +2125,21 @@ static void end_polls(struct fuse_conn *fc)
 	}
 }
 
+static void fuse_abort_iqueue(struct fuse_iqueue *fiq, struct list_head *to_end)
+{
+	struct fuse_req *req;
+
+	spin_lock(&fiq->waitq.lock);
+	fiq->connected = 0;
+	list_for_each_entry(req, &fiq->pending, list)
+		clear_bit(FR_PENDING, &req->flags);
+	list_splice_tail_init(&fiq->pending, to_end);
+	while (forget_pending(fiq))
+		kfree(dequeue_forget(fiq, 1, NULL));
+	wake_up_all_locked(&fiq->waitq);
+	spin_unlock(&fiq->waitq.lock);
+}
+
 /*
  * Abort all requests.
  *
@@ -2109,6 +2167,7 @@ void fuse_abort_conn(struct fuse_conn *fc, bool is_abort)
 		struct fuse_dev *fud;
 		struct fuse_req *req, *next;
 		LIST_HEAD(to_end);
+		unsigned i;
 
 		fc->connected = 0;
 		fc->blocked = 0;
@@ -2136,15 +2195,9 @@ void fuse_abort_conn(struct fuse_conn *fc, bool is_abort)
 		fc->max_background = UINT_MAX;
 		flush_bg_queue(fc);
 
-		spin_lock(&fiq->waitq.lock);
-		fiq->connected = 0;
-		list_for_each_entry(req, &fiq->pending, list)
-			clear_bit(FR_PENDING, &req->flags);
-		list_splice_tail_init(&fiq->pending, &to_end);
-		while (forget_pending(fiq))
-			kfree(dequeue_forget(fiq, 1, NULL));
-		wake_up_all_locked(&fiq->waitq);
-		spin_unlock(&fiq->waitq.lock);
+		for (i = 0; i < fc->nr_iqs; i++)
+			fuse_abort_iqueue(&fc->iqs[i], &to_end);
+		fuse_abort_iqueue(fiq, &to_end);
 		kill_fasync(&fiq->fasync, SIGIO, POLL_IN);
 		end_polls(fc);
 		wake_up_all(&fc->blocked_waitq);
@@ -2162,6 +2215,28 @@ void fuse_wait_aborted(struct fuse_conn *fc)
 	wait_event(fc->blocked_waitq, atomic_read(&fc->num_waiting) == 0);
 }
 
+/*
+ * Drop a reader of a per-CPU queue.  Requests still pending on it when the
+ * last reader goes away are handed over to the shared queue.
+ */
+static void fuse_unbind_queue(struct fuse_conn *fc, struct fuse_iqueue *fiq)
+{
+	struct fuse_iqueue *shared = &fc->iq;
+	struct fuse_req *req;
+
+	spin_lock(&fiq->waitq.lock);
+	if (!--fiq->nr_readers && !list_empty(&fiq->pending)) {
+		spin_lock_nested(&shared->waitq.lock, SINGLE_DEPTH_NESTING);
+		list_for_each_entry(req, &fiq->pending, list)
+			WRITE_ONCE(req->iq, shared);
+		list_splice_tail_init(&fiq->pending, &shared->pending);
+		wake_up_locked(&shared->waitq);
+		spin_unlock(&shared->waitq.lock);
+		kill_fasync(&shared->fasync, SIGIO, POLL_IN);
+	}
+	spin_unlock(&fiq->waitq.lock);
+}
+
 int fuse_dev_release(struct inode *inode, struct file *file)
 {
 	struct fuse_dev *fud = fuse_get_dev(file);
@@ -2178,6 +2253,9 @@ int fuse_dev_release(struct inode *inode, struct file *file)
 
 		end_requests(fc, &to_end);
 
+		if (fud->iq != &fc->iq)
+			fuse_unbind_queue(fc, fud->iq);
+
 		/* Are we the last open device? */
 		if (atomic_dec_and_test(&fc->dev_count)) {
 			WARN_ON(fc->iq.fasync != NULL);
@@ -2217,10 +2295,52 @@ static int fuse_device_clone(struct fuse_conn *fc, struct file *new)
 	return 0;
 }
 
+static int fuse_dev_bind_queue(struct fuse_dev *fud, u32 index)
+{
+	struct fuse_conn *fc = fud->fc;
+	/* Pairs with smp_store_release() in fuse_init_iqs() */
+	unsigned nr_iqs = smp_load_acquire(&fc->nr_iqs);
+	struct fuse_iqueue *fiq;
+	int err = 0;
+
+	if (index >= nr_iqs)
+		return -EINVAL;
+
+	fiq = &fc->iqs[index];
+	spin_lock(&fiq->waitq.lock);
+	if (!fiq->connected)
+		err = -ENOTCONN;
+	else if (cmpxchg(&fud->iq, &fc->iq, fiq) != &fc->iq)
+		err = -EBUSY;
+	else
+		fiq->nr_readers++;
+	spin_unlock(&fiq->waitq.lock);
+
+	return err;
+}
+
 static long fuse_dev_ioctl(struct file *file, unsigned int cmd,
 			   unsigned long arg)
 {
 	int err = -ENOTTY;
+	struct fuse_dev *fud;
+	u32 val;
+
+	if (cmd == FUSE_DEV_IOC_BIND_QUEUE ||
+	    cmd == FUSE_DEV_IOC_PASSTHROUGH_OPEN) {
+		fud = fuse_get_dev(file);
+		if (!fud)
+			return -EPERM;
+		if (get_user(val, (__u32 __user *) arg))
+			return -EFAULT;
+
+		if (cmd == FUSE_DEV_IOC_BIND_QUEUE)
+			return fuse_dev_bind_queue(fud, val);
+
+		if (!fud->fc->passthrough)
+			return -EINVAL;
+		return fuse_passthrough_open(fud->fc, val);
+	}
 
 	if (cmd == FUSE_DEV_IOC_CLONE) {
 		int oldfd;
@@ -72,6 +72,7 @@ struct fuse_file *fuse_file_alloc(struct fuse_conn *fc)
 
 void fuse_file_free(struct fuse_file *ff)
 {
+	fuse_passthrough_release(&ff->passthrough);
 	fuse_request_free(ff->reserved_req);
 	kfree(ff);
 }
@@ -111,6 +112,7 @@ static void fuse_file_put(struct fuse_file *ff, bool sync)
 			__set_bit(FR_BACKGROUND, &req->flags);
 			fuse_request_send_background(ff->fc, req);
 		}
+		fuse_passthrough_release(&ff->passthrough);
 		kfree(ff);
 	}
 }
@@ -135,6 +137,8 @@ int fuse_do_open(struct fuse_conn *fc, u64 nodeid, struct file *file,
 		if (!err) {
 			ff->fh = outarg.fh;
 			ff->open_flags = outarg.open_flags;
+			if (!isdir)
+				fuse_passthrough_setup(fc, ff, &outarg);
 
 		} else if (err != -ENOSYS || isdir) {
 			fuse_file_free(ff);
@@ -919,6 +923,10 @@ static ssize_t fuse_file_read_iter(struct kiocb *iocb, struct iov_iter *to)
 {
 	struct inode *inode = iocb->ki_filp->f_mapping->host;
 	struct fuse_conn *fc = get_fuse_conn(inode);
+	struct fuse_file *ff = iocb->ki_filp->private_data;
+
+	if (ff->passthrough.filp)
+		return fuse_passthrough_read_iter(iocb, to);
 
 	/*
 	 * In auto invalidate mode, always update attributes on read.
@@ -1174,9 +1182,13 @@ static ssize_t fuse_file_write_iter(struct kiocb *iocb, struct iov_iter *from)
 	ssize_t written = 0;
 	ssize_t written_buffered = 0;
 	struct inode *inode = mapping->host;
+	struct fuse_file *ff = file->private_data;
 	ssize_t err;
 	loff_t endbyte = 0;
 
+	if (ff->passthrough.filp)
+		return fuse_passthrough_write_iter(iocb, from);
+
 	if (get_fuse_conn(inode)->writeback_cache) {
 		/* Update size (EOF optimization) and mode (SUID clearing) */
 		err = fuse_update_attributes(mapping->host, file);
@@ -1426,6 +1438,11 @@ static ssize_t __fuse_direct_read(struct fuse_io_priv *io,
 static ssize_t fuse_direct_read_iter(struct kiocb *iocb, struct iov_iter *to)
 {
 	struct fuse_io_priv io = FUSE_IO_PRIV_SYNC(iocb);
+	struct fuse_file *ff = iocb->ki_filp->private_data;
+
+	if (ff->passthrough.filp)
+		return fuse_passthrough_read_iter(iocb, to);
+
 	return __fuse_direct_read(&io, to, &iocb->ki_pos);
 }
 
@@ -1433,11 +1450,15 @@ static ssize_t fuse_direct_write_iter(struct kiocb *iocb, struct iov_iter *from)
 {
 	struct inode *inode = file_inode(iocb->ki_filp);
 	struct fuse_io_priv io = FUSE_IO_PRIV_SYNC(iocb);
+	struct fuse_file *ff = iocb->ki_filp->private_data;
 	ssize_t res;
 
 	if (is_bad_inode(inode))
 		return -EIO;
 
+	if (ff->passthrough.filp)
+		return fuse_passthrough_write_iter(iocb, from);
+
 	/* Don't allow parallel writes to the same file */
 	inode_lock(inode);
 	res = generic_write_checks(iocb, from);
@@ -27,6 +27,7 @@
 #include <linux/pid_namespace.h>
 #include <linux/refcount.h>
 #include <linux/user_namespace.h>
+#include <linux/idr.h>
 
 /** Max number of pages that can be used in a single read request */
 #define FUSE_MAX_PAGES_PER_REQ 32
@@ -43,6 +44,12 @@
 /** Number of page pointers embedded in fuse_req */
 #define FUSE_REQ_INLINE_PAGES 1
 
+/** Max number of per-CPU input queues, bounded by the unique id encoding */
+#define FUSE_MAX_IQS 255
+
+/** Unique ids of a per-CPU queue carry its index + 1 in the top byte */
+#define FUSE_IQ_UNIQUE_SHIFT 56
+
 /** List of active connections */
 extern struct list_head fuse_conn_list;
 
@@ -122,6 +129,14 @@ enum {
 
 struct fuse_conn;
 
+/** Backing file of a passthrough fuse file */
+struct fuse_passthrough {
+	struct file *filp;
+
+	/** Credentials of the daemon, used to access filp */
+	const struct cred *cred;
+};
+
 /** FUSE specific file data */
 struct fuse_file {
 	/** Fuse connection for this file */
@@ -154,6 +169,9 @@ struct fuse_file {
 	/** Wait queue head for poll */
 	wait_queue_head_t poll_wait;
 
+	/** Backing file if opened in passthrough mode */
+	struct fuse_passthrough passthrough;
+
 	/** Has flock been performed on this file? */
 	bool flock:1;
 };
@@ -308,6 +326,9 @@ struct fuse_req {
 	/** Entry on the interrupts list  */
 	struct list_head intr_entry;
 
+	/** Input queue the request was last queued on */
+	struct fuse_iqueue *iq;
+
 	/** refcount */
 	refcount_t count;
 
@@ -412,6 +433,9 @@ struct fuse_iqueue {
 
 	/** O_ASYNC requests */
 	struct fasync_struct *fasync;
+
+	/** Number of devices bound to a per-CPU queue */
+	unsigned nr_readers;
 };
 
 struct fuse_pqueue {
@@ -438,6 +462,9 @@ struct fuse_dev {
 	/** Processing queue */
 	struct fuse_pqueue pq;
 
+	/** Input queue this device reads from */
+	struct fuse_iqueue *iq;
+
 	/** list entry on fc->devices */
 	struct list_head entry;
 };
@@ -482,6 +509,15 @@ struct fuse_conn {
 	/** Input queue */
 	struct fuse_iqueue iq;
 
+	/** Per-CPU input queues, allocated in INIT with FUSE_MULTIQUEUE */
+	struct fuse_iqueue *iqs;
+
+	/** Number of per-CPU input queues, zero if multiqueue is off */
+	unsigned nr_iqs;
+
+	/** Backing files registered for the next passthrough opens */
+	struct idr passthrough_req;
+
 	/** The next unique kernel file handle */
 	u64 khctr;
 
@@ -554,6 +590,9 @@ struct fuse_conn {
 	/** handle fs handles killing suid/sgid/cap on write/chown/trunc */
 	unsigned handle_killpriv:1;
 
+	/** read/write may be passed through to a backing file */
+	unsigned passthrough:1;
+
 	/*
 	 * The following bitfields are only for optimization purposes
 	 * and hence races in setting them will not cause malfunction
@@ -995,4 +1034,14 @@ struct posix_acl;
 struct posix_acl *fuse_get_acl(struct inode *inode, int type);
 int fuse_set_acl(struct inode *inode, struct posix_acl *acl, int type);
 
+/* passthrough.c */
+int fuse_passthrough_open(struct fuse_conn *fc, int fd);
+void fuse_passthrough_setup(struct fuse_conn *fc, struct fuse_file *ff,
+			    struct fuse_open_out *openarg);
+void fuse_passthrough_release(struct fuse_passthrough *passthrough);
+void fuse_passthrough_free_reqs(struct fuse_conn *fc);
+ssize_t fuse_passthrough_read_iter(struct kiocb *iocb, struct iov_iter *to);
+ssize_t fuse_passthrough_write_iter(struct kiocb *iocb,
+				    struct iov_iter *from);
+
 #endif /* _FS_FUSE_I_H */
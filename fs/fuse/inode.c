@@ -592,6 +592,36 @@ static void fuse_iqueue_init(struct fuse_iqueue *fiq)
 	fiq->connected = 1;
 }
 
+/*
+ * Allocate the per-CPU input queues negotiated with FUSE_MULTIQUEUE.  On
+ * failure all requests keep going through the shared queue.
+ */
+static void fuse_init_iqs(struct fuse_conn *fc)
+{
+	unsigned i, nr = min_t(unsigned, nr_cpu_ids, FUSE_MAX_IQS);
+	struct fuse_iqueue *iqs;
+
+	iqs = kcalloc(nr, sizeof(struct fuse_iqueue), GFP_KERNEL);
+	if (!iqs)
+		return;
+
+	for (i = 0; i < nr; i++) {
+		fuse_iqueue_init(&iqs[i]);
+		/* Keep unique ids disjoint from the other queues */
+		iqs[i].reqctr = (u64)(i + 1) << FUSE_IQ_UNIQUE_SHIFT;
+	}
+
+	spin_lock(&fc->lock);
+	if (fc->connected && !fc->iqs) {
+		fc->iqs = iqs;
+		/* Pairs with smp_load_acquire() in fuse_lock_iq() */
+		smp_store_release(&fc->nr_iqs, nr);
+		iqs = NULL;
+	}
+	spin_unlock(&fc->lock);
+	kfree(iqs);
+}
+
 static void fuse_pqueue_init(struct fuse_pqueue *fpq)
 {
 	memset(fpq, 0, sizeof(struct fuse_pqueue));
@@ -611,6 +641,7 @@ void fuse_conn_init(struct fuse_conn *fc, struct user_namespace *user_ns)
 	init_waitqueue_head(&fc->blocked_waitq);
 	init_waitqueue_head(&fc->reserved_req_waitq);
 	fuse_iqueue_init(&fc->iq);
+	idr_init(&fc->passthrough_req);
 	INIT_LIST_HEAD(&fc->bg_queue);
 	INIT_LIST_HEAD(&fc->entry);
 	INIT_LIST_HEAD(&fc->devices);
@@ -634,6 +665,8 @@ void fuse_conn_put(struct fuse_conn *fc)
 	if (refcount_dec_and_test(&fc->count)) {
 		if (fc->destroy_req)
 			fuse_request_free(fc->destroy_req);
+		fuse_passthrough_free_reqs(fc);
+		kfree(fc->iqs);
 		put_pid_ns(fc->pid_ns);
 		put_user_ns(fc->user_ns);
 		fc->release(fc);
@@ -926,6 +959,19 @@ static void process_init_reply(struct fuse_conn *fc, struct fuse_req *req)
 			}
 			if (arg->flags & FUSE_ABORT_ERROR)
 				fc->abort_err = 1;
+			if (arg->flags & FUSE_MULTIQUEUE)
+				fuse_init_iqs(fc);
+			/*
+			 * Writeback caching keeps dirty data and i_size in
+			 * the fuse inode, which passthrough writes bypass.
+			 */
+			if ((arg->flags & FUSE_PASSTHROUGH) &&
+			    !fc->writeback_cache) {
+				fc->passthrough = 1;
+				/* Nothing may stack on passthrough */
+				fc->sb->s_stack_depth =
+					FILESYSTEM_MAX_STACK_DEPTH;
+			}
 		} else {
 			ra_pages = fc->max_read / PAGE_SIZE;
 			fc->no_lock = 1;
@@ -957,7 +1003,7 @@ static void fuse_send_init(struct fuse_conn *fc, struct fuse_req *req)
 		FUSE_DO_READDIRPLUS | FUSE_READDIRPLUS_AUTO | FUSE_ASYNC_DIO |
 		FUSE_WRITEBACK_CACHE | FUSE_NO_OPEN_SUPPORT |
 		FUSE_PARALLEL_DIROPS | FUSE_HANDLE_KILLPRIV | FUSE_POSIX_ACL |
-		FUSE_ABORT_ERROR;
+		FUSE_ABORT_ERROR | FUSE_MULTIQUEUE | FUSE_PASSTHROUGH;
 	req->in.h.opcode = FUSE_INIT;
 	req->in.numargs = 1;
 	req->in.args[0].size = sizeof(*arg);
@@ -1026,6 +1072,7 @@ struct fuse_dev *fuse_dev_alloc(struct fuse_conn *fc)
 	fud = kzalloc(sizeof(struct fuse_dev), GFP_KERNEL);
 	if (fud) {
 		fud->fc = fuse_conn_get(fc);
+		fud->iq = &fc->iq;
 		fuse_pqueue_init(&fud->pq);
 
 		spin_lock(&fc->lock);
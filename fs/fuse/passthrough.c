@@ -0,0 +1,184 @@
+/*
+ * FUSE: Filesystem in Userspace
+ *
+ * Passthrough of read and write to a backing file provided by the daemon,
+ * so that the data of e.g. emulated storage does not have to be copied
+ * through userspace.
+ *
+ * This program can be distributed under the terms of the GNU GPL.
+ * See the file COPYING.
+ */
+
+#include "fuse_i.h"
+
+#include <linux/cred.h>
+#include <linux/file.h>
+#include <linux/pagemap.h>
+#include <linux/slab.h>
+#include <linux/uio.h>
+
+/*
+ * Register the backing file behind @fd for a later OPEN or CREATE reply.
+ * Runs in the context of the daemon, whose credentials are used for all
+ * accesses to the backing file.
+ */
+int fuse_passthrough_open(struct fuse_conn *fc, int fd)
+{
+	struct fuse_passthrough *passthrough;
+	struct file *filp;
+	int id;
+
+	filp = fget(fd);
+	if (!filp)
+		return -EBADF;
+
+	id = -EINVAL;
+	if (!filp->f_op->read_iter || !filp->f_op->write_iter)
+		goto out_fput;
+
+	/* No passthrough fuse (or anything stacked on one) below us */
+	if (file_inode(filp)->i_sb->s_stack_depth >= FILESYSTEM_MAX_STACK_DEPTH)
+		goto out_fput;
+
+	id = -ENOMEM;
+	passthrough = kmalloc(sizeof(*passthrough), GFP_KERNEL);
+	if (!passthrough)
+		goto out_fput;
+
+	passthrough->filp = filp;
+	passthrough->cred = get_current_cred();
+
+	idr_preload(GFP_KERNEL);
+	spin_lock(&fc->lock);
+	id = idr_alloc(&fc->passthrough_req, passthrough, 1, 0, GFP_ATOMIC);
+	spin_unlock(&fc->lock);
+	idr_preload_end();
+
+	if (id < 0) {
+		fuse_passthrough_release(passthrough);
+		kfree(passthrough);
+	}
+	return id;
+
+out_fput:
+	fput(filp);
+	return id;
+}
+
+/* Attach the backing file named by an open reply, if any */
+void fuse_passthrough_setup(struct fuse_conn *fc, struct fuse_file *ff,
+			    struct fuse_open_out *openarg)
+{
+	struct fuse_passthrough *passthrough;
+
+	if (!fc->passthrough || !openarg->passthrough_fh)
+		return;
+
+	spin_lock(&fc->lock);
+	passthrough = idr_remove(&fc->passthrough_req, openarg->passthrough_fh);
+	spin_unlock(&fc->lock);
+
+	/* Unknown id: fall back to sending read/write to the daemon */
+	if (!passthrough)
+		return;
+
+	ff->passthrough = *passthrough;
+	kfree(passthrough);
+}
+
+void fuse_passthrough_release(struct fuse_passthrough *passthrough)
+{
+	if (passthrough->filp) {
+		fput(passthrough->filp);
+		passthrough->filp = NULL;
+	}
+	if (passthrough->cred) {
+		put_cred(passthrough->cred);
+		passthrough->cred = NULL;
+	}
+}
+
+/* Drop the backing files no open reply has claimed */
+void fuse_passthrough_free_reqs(struct fuse_conn *fc)
+{
+	struct fuse_passthrough *passthrough;
+	int id;
+
+	idr_for_each_entry(&fc->passthrough_req, passthrough, id) {
+		fuse_passthrough_release(passthrough);
+		kfree(passthrough);
+	}
+	idr_destroy(&fc->passthrough_req);
+}
+
+static rwf_t fuse_passthrough_rwf(struct kiocb *iocb)
+{
+	rwf_t flags = 0;
+
+	if (iocb->ki_flags & IOCB_HIPRI)
+		flags |= RWF_HIPRI;
+	if (iocb->ki_flags & IOCB_DSYNC)
+		flags |= RWF_DSYNC;
+	if (iocb->ki_flags & IOCB_SYNC)
+		flags |= RWF_SYNC;
+
+	return flags;
+}
+
+ssize_t fuse_passthrough_read_iter(struct kiocb *iocb, struct iov_iter *to)
+{
+	struct fuse_file *ff = iocb->ki_filp->private_data;
+	const struct cred *old_cred;
+	ssize_t ret;
+
+	if (!iov_iter_count(to))
+		return 0;
+
+	old_cred = override_creds(ff->passthrough.cred);
+	ret = vfs_iter_read(ff->passthrough.filp, to, &iocb->ki_pos,
+			    fuse_passthrough_rwf(iocb));
+	revert_creds(old_cred);
+
+	if (ret >= 0)
+		fuse_invalidate_atime(file_inode(iocb->ki_filp));
+
+	return ret;
+}
+
+ssize_t fuse_passthrough_write_iter(struct kiocb *iocb, struct iov_iter *from)
+{
+	struct inode *inode = file_inode(iocb->ki_filp);
+	struct fuse_file *ff = iocb->ki_filp->private_data;
+	struct file *backing = ff->passthrough.filp;
+	const struct cred *old_cred;
+	loff_t pos;
+	ssize_t ret;
+
+	if (!iov_iter_count(from))
+		return 0;
+
+	inode_lock(inode);
+	if (iocb->ki_flags & IOCB_APPEND)
+		iocb->ki_pos = i_size_read(file_inode(backing));
+	pos = iocb->ki_pos;
+
+	old_cred = override_creds(ff->passthrough.cred);
+	file_start_write(backing);
+	ret = vfs_iter_write(backing, from, &iocb->ki_pos,
+			     fuse_passthrough_rwf(iocb));
+	file_end_write(backing);
+	revert_creds(old_cred);
+
+	if (ret > 0) {
+		fuse_write_update_size(inode, iocb->ki_pos);
+		fuse_invalidate_attr(inode);
+		/* Pages cached through mmap of the fuse inode are now stale */
+		if (inode->i_mapping->nrpages)
+			invalidate_inode_pages2_range(inode->i_mapping,
+					pos >> PAGE_SHIFT,
+					(iocb->ki_pos - 1) >> PAGE_SHIFT);
+	}
+	inode_unlock(inode);
+
+	return ret;
+}
@@ -23,25 +23,32 @@ static char ovl_whatisit(struct inode *inode, struct inode *realinode)
 		return 'm';
 }
 
-static struct file *ovl_open_realfile(const struct file *file,
-				      struct inode *realinode)
+static struct file *ovl_open_realfile_flags(const struct file *file,
+					    struct inode *realinode,
+					    unsigned int flags)
 {
 	struct inode *inode = file_inode(file);
 	struct file *realfile;
 	const struct cred *old_cred;
 
 	old_cred = ovl_override_creds(inode->i_sb);
-	realfile = open_with_fake_path(&file->f_path, file->f_flags | O_NOATIME,
+	realfile = open_with_fake_path(&file->f_path, flags | O_NOATIME,
 				       realinode, current_cred());
 	revert_creds(old_cred);
 
 	pr_debug("open(%p[%pD2/%c], 0%o) -> (%p, 0%o)\n",
-		 file, file, ovl_whatisit(inode, realinode), file->f_flags,
+		 file, file, ovl_whatisit(inode, realinode), flags,
 		 realfile, IS_ERR(realfile) ? 0 : realfile->f_flags);
 
 	return realfile;
 }
 
+static struct file *ovl_open_realfile(const struct file *file,
+				      struct inode *realinode)
+{
+	return ovl_open_realfile_flags(file, realinode, file->f_flags);
+}
+
 #define OVL_SETFL_MASK (O_APPEND | O_NONBLOCK | O_NDELAY | O_DIRECT)
 
 static int ovl_change_flags(struct file *file, unsigned int flags)
@@ -87,13 +94,22 @@ static int ovl_real_fdget_meta(const struct file *file, struct fd *real,
 	struct inode *realinode;
 
 	real->flags = 0;
-	real->file = file->private_data;
+	real->file = READ_ONCE(file->private_data);
 
 	if (allow_meta)
 		realinode = ovl_inode_real(inode);
 	else
 		realinode = ovl_inode_realdata(inode);
 
+	/* Data copy up deferred by lazy_datacopy, nothing written yet */
+	if (unlikely(!real->file)) {
+		real->flags = FDPUT_FPUT;
+		real->file = ovl_open_realfile_flags(file, realinode,
+				(file->f_flags & ~O_ACCMODE) | O_RDONLY);
+
+		return PTR_ERR_OR_ZERO(real->file);
+	}
+
 	/* Has it been copied up since we'd opened it? */
 	if (unlikely(file_inode(real->file) != realinode)) {
 		real->flags = FDPUT_FPUT;
@@ -114,19 +130,93 @@ static int ovl_real_fdget(const struct file *file, struct fd *real)
 	return ovl_real_fdget_meta(file, real, false);
 }
 
+/*
+ * Copy up the data of a file opened with lazy_datacopy and install its upper
+ * real file.  Called before the first operation that modifies the data.
+ */
+static int ovl_install_realfile(struct file *file)
+{
+	struct inode *inode = file_inode(file);
+	struct file *realfile;
+	int err;
+
+	if (likely(READ_ONCE(file->private_data)))
+		return 0;
+
+	err = ovl_open_maybe_copy_up(file_dentry(file), file->f_flags);
+	if (err)
+		return err;
+
+	realfile = ovl_open_realfile(file, ovl_inode_realdata(inode));
+	if (IS_ERR(realfile))
+		return PTR_ERR(realfile);
+
+	/* Lost a race with another writer of this file */
+	if (cmpxchg(&file->private_data, NULL, realfile))
+		fput(realfile);
+
+	return 0;
+}
+
+static int ovl_real_fdget_write(struct file *file, struct fd *real)
+{
+	int err = ovl_install_realfile(file);
+
+	if (err)
+		return err;
+
+	return ovl_real_fdget(file, real);
+}
+
+static bool ovl_open_lazy_datacopy(struct dentry *dentry, unsigned int flags)
+{
+	struct ovl_fs *ofs = dentry->d_sb->s_fs_info;
+
+	if (!ofs->config.metacopy || !ofs->config.lazy_datacopy)
+		return false;
+
+	if (!S_ISREG(d_inode(dentry)->i_mode) || (flags & O_TRUNC))
+		return false;
+
+	/*
+	 * A file that is also open for reading can be mapped shared and
+	 * writable, and ->mmap() runs under mmap_sem where copy up can't.
+	 * Only write-only opens, which can't be mapped at all, are deferred.
+	 */
+	if ((flags & O_ACCMODE) != O_WRONLY)
+		return false;
+
+	return ovl_dentry_needs_data_copy_up(dentry, flags);
+}
+
 static int ovl_open(struct inode *inode, struct file *file)
 {
 	struct dentry *dentry = file_dentry(file);
 	struct file *realfile;
+	bool lazy = ovl_open_lazy_datacopy(dentry, file->f_flags);
 	int err;
 
-	err = ovl_open_maybe_copy_up(dentry, file->f_flags);
+	if (lazy) {
+		/* Data is copied up by ovl_install_realfile() */
+		err = ovl_want_write(dentry);
+		if (!err) {
+			err = ovl_copy_up(dentry);
+			ovl_drop_write(dentry);
+		}
+	} else {
+		err = ovl_open_maybe_copy_up(dentry, file->f_flags);
+	}
 	if (err)
 		return err;
 
 	/* No longer need these flags, so don't pass them on to underlying fs */
 	file->f_flags &= ~(O_CREAT | O_EXCL | O_NOCTTY | O_TRUNC);
 
+	if (lazy) {
+		file->private_data = NULL;
+		return 0;
+	}
+
 	realfile = ovl_open_realfile(file, ovl_inode_realdata(inode));
 	if (IS_ERR(realfile))
 		return PTR_ERR(realfile);
@@ -138,7 +228,8 @@ static int ovl_open(struct inode *inode, struct file *file)
 
 static int ovl_release(struct inode *inode, struct file *file)
 {
-	fput(file->private_data);
+	if (file->private_data)
+		fput(file->private_data);
 
 	return 0;
 }
@@ -235,7 +326,7 @@ static ssize_t ovl_write_iter(struct kiocb *iocb, struct iov_iter *iter)
 	if (ret)
 		goto out_unlock;
 
-	ret = ovl_real_fdget(file, &real);
+	ret = ovl_real_fdget_write(file, &real);
 	if (ret)
 		goto out_unlock;
 
@@ -285,6 +376,10 @@ static int ovl_mmap(struct file *file, struct vm_area_struct *vma)
 	const struct cred *old_cred;
 	int ret;
 
+	/* lazy_datacopy opens are write-only, see ovl_open_lazy_datacopy() */
+	if (WARN_ON_ONCE(!realfile))
+		return -EACCES;
+
 	if (!realfile->f_op->mmap)
 		return -ENODEV;
 
@@ -317,7 +412,7 @@ static long ovl_fallocate(struct file *file, int mode, loff_t offset, loff_t len
 	const struct cred *old_cred;
 	int ret;
 
-	ret = ovl_real_fdget(file, &real);
+	ret = ovl_real_fdget_write(file, &real);
 	if (ret)
 		return ret;
 
@@ -443,7 +538,10 @@ static ssize_t ovl_copyfile(struct file *file_in, loff_t pos_in,
 	const struct cred *old_cred;
 	ssize_t ret;
 
-	ret = ovl_real_fdget(file_out, &real_out);
+	if (op == OVL_DEDUPE)
+		ret = ovl_real_fdget(file_out, &real_out);
+	else
+		ret = ovl_real_fdget_write(file_out, &real_out);
 	if (ret)
 		return ret;
 
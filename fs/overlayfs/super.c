@@ -69,6 +69,11 @@ module_param_named(metacopy, ovl_metacopy_def, bool, 0644);
 MODULE_PARM_DESC(ovl_metacopy_def,
 		 "Default to on or off for the metadata only copy up feature");
 
+static bool ovl_lazy_datacopy_def = IS_ENABLED(CONFIG_OVERLAY_FS_LAZY_DATACOPY);
+module_param_named(lazy_datacopy, ovl_lazy_datacopy_def, bool, 0644);
+MODULE_PARM_DESC(ovl_lazy_datacopy_def,
+		 "Default to on or off for deferring data copy up to the first write");
+
 static void ovl_dentry_release(struct dentry *dentry)
 {
 	struct ovl_entry *oe = dentry->d_fsdata;
@@ -362,6 +367,9 @@ static int ovl_show_options(struct seq_file *m, struct dentry *dentry)
 	if (ofs->config.metacopy != ovl_metacopy_def)
 		seq_printf(m, ",metacopy=%s",
 			   ofs->config.metacopy ? "on" : "off");
+	if (ofs->config.lazy_datacopy != ovl_lazy_datacopy_def)
+		seq_printf(m, ",lazy_datacopy=%s",
+			   ofs->config.lazy_datacopy ? "on" : "off");
 	return 0;
 }
 
@@ -401,6 +409,8 @@ enum {
 	OPT_XINO_AUTO,
 	OPT_METACOPY_ON,
 	OPT_METACOPY_OFF,
+	OPT_LAZY_DATACOPY_ON,
+	OPT_LAZY_DATACOPY_OFF,
 	OPT_ERR,
 };
 
@@ -419,6 +429,8 @@ static const match_table_t ovl_tokens = {
 	{OPT_XINO_AUTO,			"xino=auto"},
 	{OPT_METACOPY_ON,		"metacopy=on"},
 	{OPT_METACOPY_OFF,		"metacopy=off"},
+	{OPT_LAZY_DATACOPY_ON,		"lazy_datacopy=on"},
+	{OPT_LAZY_DATACOPY_OFF,		"lazy_datacopy=off"},
 	{OPT_ERR,			NULL}
 };
 
@@ -554,6 +566,14 @@ static int ovl_parse_opt(char *opt, struct ovl_config *config)
 			config->metacopy = false;
 			break;
 
+		case OPT_LAZY_DATACOPY_ON:
+			config->lazy_datacopy = true;
+			break;
+
+		case OPT_LAZY_DATACOPY_OFF:
+			config->lazy_datacopy = false;
+			break;
+
 		default:
 			pr_err("overlayfs: unrecognized mount option \"%s\" or missing value\n", p);
 			return -EINVAL;
@@ -1390,6 +1410,7 @@ static int ovl_fill_super(struct super_block *sb, void *data, int silent)
 	ofs->config.nfs_export = ovl_nfs_export_def;
 	ofs->config.xino = ovl_xino_def();
 	ofs->config.metacopy = ovl_metacopy_def;
+	ofs->config.lazy_datacopy = ovl_lazy_datacopy_def;
 	err = ovl_parse_opt((char *) data, &ofs->config);
 	if (err)
 		goto out_err;
@@ -650,6 +650,30 @@ int proc_pid_statm(struct seq_file *m, struct pid_namespace *ns,
 	return 0;
 }
 
+int proc_pid_workingset(struct seq_file *m, struct pid_namespace *ns,
+			struct pid *pid, struct task_struct *task)
+{
+	unsigned long refaults = 0, activations = 0, thrashing = 0, wss = 0;
+	struct mm_struct *mm = get_task_mm(task);
+
+	if (mm) {
+		refaults = atomic_long_read(&mm->refault_stat.refaults);
+		activations = atomic_long_read(&mm->refault_stat.activations);
+		thrashing = mm_workingset_thrashing(mm);
+		wss = get_mm_rss(mm) + thrashing;
+		mmput(mm);
+	}
+
+	/* all values in pages */
+	seq_put_decimal_ull(m, "refaults ", refaults);
+	seq_put_decimal_ull(m, "\nactivations ", activations);
+	seq_put_decimal_ull(m, "\nthrashing ", thrashing);
+	seq_put_decimal_ull(m, "\nwss_estimate ", wss);
+	seq_putc(m, '\n');
+
+	return 0;
+}
+
 #ifdef CONFIG_PROC_CHILDREN
 static struct pid *
 get_children_pid(struct inode *inode, struct pid *pid_prev, loff_t pos)
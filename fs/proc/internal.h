@@ -150,6 +150,8 @@ extern int proc_pid_status(struct seq_file *, struct pid_namespace *,
 			   struct pid *, struct task_struct *);
 extern int proc_pid_statm(struct seq_file *, struct pid_namespace *,
 			  struct pid *, struct task_struct *);
+extern int proc_pid_workingset(struct seq_file *, struct pid_namespace *,
+			       struct pid *, struct task_struct *);
 
 /*
  * base.c
@@ -306,6 +308,7 @@ extern const struct file_operations proc_pid_numa_maps_operations;
 extern const struct file_operations proc_pid_smaps_operations;
 extern const struct file_operations proc_pid_smaps_rollup_operations;
 extern const struct file_operations proc_clear_refs_operations;
+extern const struct file_operations proc_reclaim_operations;
 extern const struct file_operations proc_pagemap_operations;
 
 extern unsigned long task_vsize(struct mm_struct *);
@@ -1,5 +1,6 @@
 // SPDX-License-Identifier: GPL-2.0
 #include <linux/mm.h>
+#include <linux/mm_inline.h>
 #include <linux/vmacache.h>
 #include <linux/hugetlb.h>
 #include <linux/huge_mm.h>
@@ -1219,6 +1220,163 @@ const struct file_operations proc_clear_refs_operations = {
 	.llseek		= noop_llseek,
 };
 
+#ifdef CONFIG_PROCESS_RECLAIM
+enum reclaim_types {
+	RECLAIM_FILE,
+	RECLAIM_ANON,
+	RECLAIM_ALL,
+};
+
+struct reclaim_private {
+	enum reclaim_types type;
+	unsigned long nr_to_reclaim;
+	unsigned long nr_reclaimed;
+};
+
+static int reclaim_pte_range(pmd_t *pmd, unsigned long addr,
+			     unsigned long end, struct mm_walk *walk)
+{
+	struct reclaim_private *rp = walk->private;
+	struct vm_area_struct *vma = walk->vma;
+	pte_t *orig_pte, *pte, ptent;
+	unsigned int isolated;
+	spinlock_t *ptl;
+	struct page *page;
+	LIST_HEAD(page_list);
+
+	/* huge pages are left alone */
+	if (pmd_trans_unstable(pmd))
+		return 0;
+cont:
+	isolated = 0;
+	orig_pte = pte = pte_offset_map_lock(vma->vm_mm, pmd, addr, &ptl);
+	for (; addr != end; pte++, addr += PAGE_SIZE) {
+		if (isolated >= SWAP_CLUSTER_MAX)
+			break;
+
+		ptent = *pte;
+		if (!pte_present(ptent))
+			continue;
+
+		page = vm_normal_page(vma, addr, ptent);
+		if (!page || PageTransCompound(page))
+			continue;
+		if (rp->type == RECLAIM_FILE && PageAnon(page))
+			continue;
+		if (rp->type == RECLAIM_ANON && !PageAnon(page))
+			continue;
+		/* don't take pages other processes still use */
+		if (page_mapcount(page) != 1)
+			continue;
+
+		if (isolate_lru_page(page))
+			continue;
+		inc_node_page_state(page, NR_ISOLATED_ANON +
+				    page_is_file_cache(page));
+		list_add(&page->lru, &page_list);
+		isolated++;
+	}
+	pte_unmap_unlock(orig_pte, ptl);
+
+	rp->nr_reclaimed += reclaim_pages_from_list(&page_list);
+	if (rp->nr_reclaimed >= rp->nr_to_reclaim)
+		return 1;
+	if (fatal_signal_pending(current))
+		return -EINTR;
+
+	cond_resched();
+	if (addr != end)
+		goto cont;
+
+	return 0;
+}
+
+static int reclaim_test_walk(unsigned long start, unsigned long end,
+			     struct mm_walk *walk)
+{
+	struct reclaim_private *rp = walk->private;
+	struct vm_area_struct *vma = walk->vma;
+
+	if (vma->vm_flags & (VM_PFNMAP | VM_LOCKED))
+		return 1;
+	if (rp->type == RECLAIM_ANON && !vma->anon_vma)
+		return 1;
+	if (rp->type == RECLAIM_FILE && !vma->vm_file)
+		return 1;
+	return 0;
+}
+
+/*
+ * Writing "file", "anon" or "all" to /proc/pid/reclaim reclaims pages of
+ * that type mapped only by the process. An optional size, as in "anon 32M",
+ * stops once that much has been reclaimed.
+ */
+static ssize_t reclaim_write(struct file *file, const char __user *buf,
+			     size_t count, loff_t *ppos)
+{
+	struct reclaim_private rp = {
+		.nr_to_reclaim = ULONG_MAX,
+	};
+	struct mm_walk reclaim_walk = {
+		.pmd_entry = reclaim_pte_range,
+		.test_walk = reclaim_test_walk,
+		.private = &rp,
+	};
+	struct task_struct *task;
+	char buffer[32], *str, *type, *end;
+	unsigned long long size;
+	struct mm_struct *mm;
+	size_t len;
+
+	memset(buffer, 0, sizeof(buffer));
+	len = min(count, sizeof(buffer) - 1);
+	if (copy_from_user(buffer, buf, len))
+		return -EFAULT;
+
+	str = strstrip(buffer);
+	type = strsep(&str, " ");
+	if (!strcmp(type, "file"))
+		rp.type = RECLAIM_FILE;
+	else if (!strcmp(type, "anon"))
+		rp.type = RECLAIM_ANON;
+	else if (!strcmp(type, "all"))
+		rp.type = RECLAIM_ALL;
+	else
+		return -EINVAL;
+
+	if (str) {
+		size = memparse(skip_spaces(str), &end);
+		if (*end || size < PAGE_SIZE)
+			return -EINVAL;
+		rp.nr_to_reclaim = size >> PAGE_SHIFT;
+	}
+
+	task = get_proc_task(file_inode(file));
+	if (!task)
+		return -ESRCH;
+	mm = get_task_mm(task);
+	if (mm) {
+		reclaim_walk.mm = mm;
+
+		/* pages still in lru pagevecs can't be isolated */
+		lru_add_drain_all();
+
+		down_read(&mm->mmap_sem);
+		walk_page_range(0, mm->highest_vm_end, &reclaim_walk);
+		up_read(&mm->mmap_sem);
+		mmput(mm);
+	}
+	put_task_struct(task);
+
+	return count;
+}
+
+const struct file_operations proc_reclaim_operations = {
+	.write		= reclaim_write,
+	.llseek		= noop_llseek,
+};
+#endif /* CONFIG_PROCESS_RECLAIM */
+
 typedef struct {
 	u64 pme;
 } pagemap_entry_t;
@@ -47,11 +47,14 @@
 #include <linux/string.h>
 #include <linux/pagemap.h>
 #include <linux/mutex.h>
+#include <linux/mm_inline.h>
+#include <linux/workqueue.h>
 
 #include "squashfs_fs.h"
 #include "squashfs_fs_sb.h"
 #include "squashfs_fs_i.h"
 #include "squashfs.h"
+#include "page_actor.h"
 
 /*
  * Locate cache slot in range [offset, index] for specified inode.  If
@@ -507,7 +510,154 @@ static int squashfs_readpage(struct file *file, struct page *page)
 	return 0;
 }
 
+#ifdef CONFIG_SQUASHFS_FILE_DIRECT
+/*
+ * Readahead hands each complete datablock of the window to an unbound work
+ * item which decompresses it directly into the page cache.  Several blocks
+ * are thus decompressed in parallel on different CPUs, and the reader only
+ * waits on the lock of the pages it actually needs.  Fragments, sparse
+ * blocks and blocks whose pages are partly cached already go through
+ * squashfs_readpage().
+ */
+struct squashfs_ra_block {
+	struct work_struct work;
+	struct super_block *sb;
+	u64 block;
+	int bsize;
+	int expected;
+	int pages;
+	struct page *page[];
+};
+
+static void squashfs_ra_block_work(struct work_struct *work)
+{
+	struct squashfs_ra_block *rab = container_of(work,
+					struct squashfs_ra_block, work);
+	struct squashfs_page_actor *actor;
+	int i, bytes, res = -ENOMEM;
+	void *pageaddr;
+
+	actor = squashfs_page_actor_init_special(rab->page, rab->pages, 0);
+	if (actor) {
+		res = squashfs_read_data(rab->sb, rab->block, rab->bsize, NULL,
+					 actor);
+		kfree(actor);
+	}
+
+	if (res >= 0 && res != rab->expected)
+		res = -EIO;
+
+	if (res < 0) {
+		ERROR("Unable to read page, block %llx, size %x\n",
+			rab->block, rab->bsize);
+	} else {
+		/* Last page may have trailing bytes not filled */
+		bytes = res % PAGE_SIZE;
+		if (bytes) {
+			pageaddr = kmap_atomic(rab->page[rab->pages - 1]);
+			memset(pageaddr + bytes, 0, PAGE_SIZE - bytes);
+			kunmap_atomic(pageaddr);
+		}
+	}
+
+	for (i = 0; i < rab->pages; i++) {
+		flush_dcache_page(rab->page[i]);
+		if (res < 0)
+			SetPageError(rab->page[i]);
+		else
+			SetPageUptodate(rab->page[i]);
+		unlock_page(rab->page[i]);
+		put_page(rab->page[i]);
+	}
+
+	kfree(rab);
+}
+
+static int squashfs_readpages(struct file *file, struct address_space *mapping,
+	struct list_head *pages, unsigned int nr_pages)
+{
+	struct inode *inode = mapping->host;
+	struct squashfs_sb_info *msblk = inode->i_sb->s_fs_info;
+	int shift = msblk->block_log - PAGE_SHIFT;
+	int file_end = i_size_read(inode) >> msblk->block_log;
+	gfp_t gfp = readahead_gfp_mask(mapping);
+
+	while (!list_empty(pages)) {
+		int index = lru_to_page(pages)->index >> shift;
+		pgoff_t start = (pgoff_t) index << shift;
+		int expected = index == file_end ?
+				(i_size_read(inode) & (msblk->block_size - 1)) :
+				 msblk->block_size;
+		int i, n = DIV_ROUND_UP(expected, PAGE_SIZE);
+		u64 fragment_block = squashfs_i(inode)->fragment_block;
+		struct squashfs_ra_block *rab = NULL;
+		u64 block = 0;
+		int bsize = 0;
+
+		if (n && (index < file_end ||
+			  fragment_block == SQUASHFS_INVALID_BLK)) {
+			bsize = read_blocklist(inode, index, &block);
+			if (bsize > 0)
+				rab = kzalloc(struct_size(rab, page, n),
+					      GFP_KERNEL);
+		}
+
+		/* Insert the pages of this block, lowest index first */
+		while (!list_empty(pages)) {
+			struct page *page = lru_to_page(pages);
+
+			if (page->index >> shift != index)
+				break;
+
+			list_del(&page->lru);
+			if (add_to_page_cache_lru(page, mapping, page->index,
+						  gfp)) {
+				put_page(page);
+				continue;
+			}
+
+			if (rab && page->index - start < n) {
+				rab->page[page->index - start] = page;
+			} else {
+				squashfs_readpage(file, page);
+				put_page(page);
+			}
+		}
+
+		if (!rab)
+			continue;
+
+		for (i = 0; i < n && rab->page[i]; i++)
+			;
+
+		if (i == n) {
+			INIT_WORK(&rab->work, squashfs_ra_block_work);
+			rab->sb = inode->i_sb;
+			rab->block = block;
+			rab->bsize = bsize;
+			rab->expected = expected;
+			rab->pages = n;
+			queue_work(system_unbound_wq, &rab->work);
+			continue;
+		}
+
+		/* Not all pages of the block are ours, read them one by one */
+		for (i = 0; i < n; i++) {
+			if (!rab->page[i])
+				continue;
+			squashfs_readpage(file, rab->page[i]);
+			put_page(rab->page[i]);
+		}
+		kfree(rab);
+	}
+
+	return 0;
+}
+#endif
 
 const struct address_space_operations squashfs_aops = {
-	.readpage = squashfs_readpage
+	.readpage = squashfs_readpage,
+#ifdef CONFIG_SQUASHFS_FILE_DIRECT
+	.readpages = squashfs_readpages,
+#endif
 };
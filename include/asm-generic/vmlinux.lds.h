@@ -369,6 +369,13 @@
 		__end_builtin_fw = .;					\
 	}								\
 									\
+	/* Deferred initcalls, run after init memory is freed */	\
+	.deferred_initcall : AT(ADDR(.deferred_initcall) - LOAD_OFFSET) { \
+		__deferred_initcall_start = .;				\
+		KEEP(*(.deferred_initcall.init))			\
+		__deferred_initcall_end = .;				\
+	}								\
+									\
 	TRACEDATA							\
 									\
 	/* Kernel symbol table: Normal symbols */			\
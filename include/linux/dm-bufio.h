@@ -136,6 +136,15 @@ void dm_bufio_forget(struct dm_bufio_client *c, sector_t block);
  */
 void dm_bufio_set_minimum_buffers(struct dm_bufio_client *c, unsigned n);
 
+/*
+ * Protect the client with a spinlock instead of a mutex, so that
+ * dm_bufio_get and dm_bufio_release can be called from atomic context.
+ * This is only meant for clients that never dirty their buffers. Must be
+ * called before the client is used, returns -EINVAL if the block size
+ * doesn't allow it.
+ */
+int dm_bufio_set_no_sleep(struct dm_bufio_client *c);
+
 unsigned dm_bufio_get_block_size(struct dm_bufio_client *c);
 sector_t dm_bufio_get_device_size(struct dm_bufio_client *c);
 sector_t dm_bufio_get_block_number(struct dm_buffer *b);
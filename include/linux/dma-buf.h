@@ -205,6 +205,44 @@ struct dma_buf_ops {
 	 * to be restarted.
 	 */
 	int (*end_cpu_access)(struct dma_buf *, enum dma_data_direction);
+
+	/**
+	 * @begin_cpu_access_partial:
+	 *
+	 * This is called from dma_buf_begin_cpu_access_partial() and works
+	 * like @begin_cpu_access, except that only the @len bytes starting at
+	 * @offset need to be made coherent for the CPU. The range has already
+	 * been checked against the size of the buffer.
+	 *
+	 * This callback is optional, @begin_cpu_access is called instead for
+	 * exporters that don't implement it.
+	 *
+	 * Returns:
+	 *
+	 * 0 on success or a negative error code on failure, as for
+	 * @begin_cpu_access.
+	 */
+	int (*begin_cpu_access_partial)(struct dma_buf *,
+					enum dma_data_direction,
+					unsigned int offset, unsigned int len);
+
+	/**
+	 * @end_cpu_access_partial:
+	 *
+	 * This is called from dma_buf_end_cpu_access_partial() and works like
+	 * @end_cpu_access for the @len bytes starting at @offset.
+	 *
+	 * This callback is optional, @end_cpu_access is called instead for
+	 * exporters that don't implement it.
+	 *
+	 * Returns:
+	 *
+	 * 0 on success or a negative error code on failure, as for
+	 * @end_cpu_access.
+	 */
+	int (*end_cpu_access_partial)(struct dma_buf *,
+				      enum dma_data_direction,
+				      unsigned int offset, unsigned int len);
 	void *(*map)(struct dma_buf *, unsigned long);
 	void (*unmap)(struct dma_buf *, unsigned long, void *);
 
@@ -392,6 +430,12 @@ int dma_buf_begin_cpu_access(struct dma_buf *dma_buf,
 			     enum dma_data_direction dir);
 int dma_buf_end_cpu_access(struct dma_buf *dma_buf,
 			   enum dma_data_direction dir);
+int dma_buf_begin_cpu_access_partial(struct dma_buf *dma_buf,
+				     enum dma_data_direction dir,
+				     unsigned int offset, unsigned int len);
+int dma_buf_end_cpu_access_partial(struct dma_buf *dma_buf,
+				   enum dma_data_direction dir,
+				   unsigned int offset, unsigned int len);
 void *dma_buf_kmap(struct dma_buf *, unsigned long);
 void dma_buf_kunmap(struct dma_buf *, unsigned long, void *);
 
@@ -339,6 +339,8 @@ dma_fence_get_rcu_safe(struct dma_fence __rcu **fencep)
 
 int dma_fence_signal(struct dma_fence *fence);
 int dma_fence_signal_locked(struct dma_fence *fence);
+unsigned int dma_fence_signal_batch(struct dma_fence **fences,
+				    unsigned int count);
 signed long dma_fence_default_wait(struct dma_fence *fence,
 				   bool intr, signed long timeout);
 int dma_fence_add_callback(struct dma_fence *fence,
@@ -131,6 +131,15 @@ struct iio_buffer {
 
 	/* @ref: Reference count of the buffer. */
 	struct kref ref;
+
+	/*
+	 * @block_queue: Blocks mapped by user space that samples are written
+	 * to instead of the buffer implementation, see iio_buffer_mmap().
+	 */
+	struct iio_block_queue *block_queue;
+
+	/* @block_lock: Protects the block queue. */
+	spinlock_t block_lock;
 };
 
 /**
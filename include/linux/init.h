@@ -161,6 +161,12 @@ extern void (*late_time_init)(void);
 
 extern bool initcall_debug;
 
+#ifdef CONFIG_DEFERRED_INITCALLS
+void deferred_initcalls_start(void);
+#else
+static inline void deferred_initcalls_start(void) { }
+#endif
+
 #endif
   
 #ifndef MODULE
@@ -238,6 +244,21 @@ extern bool initcall_debug;
 #define console_initcall(fn)	___define_initcall(fn,, .con_initcall)
 #define security_initcall(fn)	___define_initcall(fn,, .security_initcall)
 
+/*
+ * Deferred initcalls are for built-in code that is not needed to bring up
+ * the first frame, e.g. WiFi or USB gadget drivers. They run from a
+ * workqueue once init has started, when userspace writes to
+ * /proc/deferred_initcalls or after deferred_initcall_timeout seconds.
+ * Init memory is gone by then, so neither the function nor anything it
+ * uses may be __init or __initdata. Without CONFIG_DEFERRED_INITCALLS
+ * they are plain device initcalls.
+ */
+#ifdef CONFIG_DEFERRED_INITCALLS
+#define deferred_initcall(fn)	___define_initcall(fn,, .deferred_initcall)
+#else
+#define deferred_initcall(fn)	device_initcall(fn)
+#endif
+
 struct obs_kernel_param {
 	const char *str;
 	int (*setup_func)(char *);
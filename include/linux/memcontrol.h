@@ -346,6 +346,10 @@ void mem_cgroup_commit_charge(struct page *page, struct mem_cgroup *memcg,
 			      bool lrucare, bool compound);
 void mem_cgroup_cancel_charge(struct page *page, struct mem_cgroup *memcg,
 		bool compound);
+int mem_cgroup_charge_pages(struct mem_cgroup *memcg, gfp_t gfp_mask,
+			    unsigned int nr_pages);
+void mem_cgroup_uncharge_pages(struct mem_cgroup *memcg,
+			       unsigned int nr_pages);
 void mem_cgroup_uncharge(struct page *page);
 void mem_cgroup_uncharge_list(struct list_head *page_list);
 
@@ -854,6 +858,18 @@ static inline void mem_cgroup_cancel_charge(struct page *page,
 {
 }
 
+static inline int mem_cgroup_charge_pages(struct mem_cgroup *memcg,
+					  gfp_t gfp_mask,
+					  unsigned int nr_pages)
+{
+	return 0;
+}
+
+static inline void mem_cgroup_uncharge_pages(struct mem_cgroup *memcg,
+					     unsigned int nr_pages)
+{
+}
+
 static inline void mem_cgroup_uncharge(struct page *page)
 {
 }
@@ -14,6 +14,7 @@
 #include <linux/uprobes.h>
 #include <linux/page-flags-layout.h>
 #include <linux/workqueue.h>
+#include <linux/seqlock.h>
 
 #include <asm/mmu.h>
 
@@ -330,6 +331,15 @@ struct vm_area_struct {
 	struct mempolicy *vm_policy;	/* NUMA policy for the VMA */
 #endif
 	struct vm_userfaultfd_ctx vm_userfaultfd_ctx;
+#ifdef CONFIG_SPECULATIVE_PAGE_FAULT
+	/*
+	 * Bumped around every change to the fields a speculative fault
+	 * relies on; odd while a change is in progress and left odd once
+	 * the VMA is detached.
+	 */
+	seqcount_t vm_sequence;
+	struct rcu_head vm_rcu;		/* vm_area_free() defers to RCU */
+#endif
 } __randomize_layout;
 
 struct core_thread {
@@ -426,6 +436,9 @@ struct mm_struct {
 		 */
 		struct mm_rss_stat rss_stat;
 
+		/* see mm/workingset.c */
+		struct mm_refault_stat refault_stat;
+
 		struct linux_binfmt *binfmt;
 
 		/* Architecture-specific MM context */
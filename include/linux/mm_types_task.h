@@ -57,6 +57,14 @@ struct mm_rss_stat {
 	atomic_long_t count[NR_MM_COUNTERS];
 };
 
+/* page cache refaults charged to the mm that faulted them back in */
+struct mm_refault_stat {
+	atomic_long_t refaults;		/* all refaults */
+	atomic_long_t activations;	/* refaults of working set pages */
+	atomic_long_t thrashing;	/* activations, decaying over time */
+	unsigned long thrashing_stamp;	/* jiffies of the last decay */
+};
+
 struct page_frag {
 	struct page *page;
 #if (BITS_PER_LONG > 32) || (PAGE_SIZE >= 65536)
@@ -271,6 +271,15 @@ enum zone_watermarks {
 #define low_wmark_pages(z) (z->watermark[WMARK_LOW])
 #define high_wmark_pages(z) (z->watermark[WMARK_HIGH])
 
+#ifdef CONFIG_PCP_HIGH_ORDER
+/* orders 4 and 8, plus the THP order; see pcp_high_orders[] */
+#ifdef CONFIG_TRANSPARENT_HUGEPAGE
+#define NR_PCP_HIGH_ORDERS	3
+#else
+#define NR_PCP_HIGH_ORDERS	2
+#endif
+#endif
+
 struct per_cpu_pages {
 	int count;		/* number of pages in the list */
 	int high;		/* high watermark, emptying needed */
@@ -278,6 +287,11 @@ struct per_cpu_pages {
 
 	/* Lists of pages, one per migrate type stored on the pcp-lists */
 	struct list_head lists[MIGRATE_PCPTYPES];
+#ifdef CONFIG_PCP_HIGH_ORDER
+	/* Free high-order blocks, and the number of pages they hold */
+	int ho_count;
+	struct list_head ho_lists[NR_PCP_HIGH_ORDERS][MIGRATE_PCPTYPES];
+#endif
 };
 
 struct per_cpu_pageset {
@@ -621,6 +635,10 @@ extern struct page *mem_map;
  * per-zone basis.
  */
 struct bootmem_data;
+
+/* Upper bound for vm.kswapd_threads */
+#define MAX_KSWAPD_THREADS	16
+
 typedef struct pglist_data {
 	struct zone node_zones[MAX_NR_ZONES];
 	struct zonelist node_zonelists[MAX_ZONELISTS];
@@ -655,8 +673,12 @@ typedef struct pglist_data {
 	int node_id;
 	wait_queue_head_t kswapd_wait;
 	wait_queue_head_t pfmemalloc_wait;
-	struct task_struct *kswapd;	/* Protected by
-					   mem_hotplug_begin/end() */
+	/*
+	 * mkswapd[0] is the node's main kswapd, the rest are the extra
+	 * threads asked for by vm.kswapd_threads.  Protected by
+	 * mem_hotplug_begin/end().
+	 */
+	struct task_struct *mkswapd[MAX_KSWAPD_THREADS];
 	int kswapd_order;
 	enum zone_type kswapd_classzone_idx;
 
@@ -667,6 +689,8 @@ typedef struct pglist_data {
 	enum zone_type kcompactd_classzone_idx;
 	wait_queue_head_t kcompactd_wait;
 	struct task_struct *kcompactd;
+	/* set when vm.compaction_proactiveness asks for a pass right away */
+	bool proactive_compact_trigger;
 #endif
 #ifdef CONFIG_NUMA_BALANCING
 	/* Lock serializing the migrate rate limiting window */
@@ -891,6 +915,8 @@ int min_free_kbytes_sysctl_handler(struct ctl_table *, int,
 					void __user *, size_t *, loff_t *);
 int watermark_scale_factor_sysctl_handler(struct ctl_table *, int,
 					void __user *, size_t *, loff_t *);
+int kswapd_threads_sysctl_handler(struct ctl_table *, int,
+					void __user *, size_t *, loff_t *);
 extern int sysctl_lowmem_reserve_ratio[MAX_NR_ZONES];
 int lowmem_reserve_ratio_sysctl_handler(struct ctl_table *, int,
 					void __user *, size_t *, loff_t *);
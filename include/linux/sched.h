@@ -407,6 +407,28 @@ struct sched_avg {
 	struct util_est			util_est;
 } ____cacheline_aligned;
 
+/**
+ * struct periodic_demand - Windowed max utilization of a periodic FAIR task
+ * @window:   the task's util_avg at the end of its last activations
+ * @demand:   the maximum of @window
+ * @enqueued: the demand added to the root cfs_rq, while the task is enqueued
+ * @next:     the slot of @window to overwrite with the next sample
+ * @enabled:  the task opted in, see /proc/<pid>/periodic_demand
+ *
+ * PELT decays the utilization of a periodic task while it sleeps, so each
+ * of its bursts starts at a frequency lower than the one it ended at. The
+ * windowed max is instead held across sleeps, and it is added to the CPU's
+ * utilization for frequency selection as soon as the task is enqueued.
+ */
+struct periodic_demand {
+#define PERIODIC_DEMAND_WINDOW		5
+	unsigned short			window[PERIODIC_DEMAND_WINDOW];
+	unsigned short			demand;
+	unsigned short			enqueued;
+	unsigned char			next;
+	bool				enabled;
+};
+
 struct sched_statistics {
 #ifdef CONFIG_SCHEDSTATS
 	u64				wait_start;
@@ -643,6 +665,9 @@ struct task_struct {
 
 	const struct sched_class	*sched_class;
 	struct sched_entity		se;
+#ifdef CONFIG_SCHED_PERIODIC_DEMAND
+	struct periodic_demand		pdemand;
+#endif
 	struct sched_rt_entity		rt;
 #ifdef CONFIG_CGROUP_SCHED
 	struct task_group		*sched_task_group;
@@ -1393,6 +1418,7 @@ extern struct pid *cad_pid;
 #define PF_KTHREAD		0x00200000	/* I am a kernel thread */
 #define PF_RANDOMIZE		0x00400000	/* Randomize virtual address space */
 #define PF_SWAPWRITE		0x00800000	/* Allowed to write to swap */
+#define PF_MEMSTALL		0x01000000	/* Stalled due to lack of memory */
 #define PF_NO_SETAFFINITY	0x04000000	/* Userland is not allowed to meddle with cpus_allowed */
 #define PF_MCE_EARLY		0x08000000      /* Early kill for mce process policy */
 #define PF_MUTEX_TESTER		0x20000000	/* Thread belongs to the rt mutex tester */
@@ -1525,6 +1551,9 @@ extern int sched_setscheduler(struct task_struct *, int, const struct sched_para
 extern int sched_setscheduler_nocheck(struct task_struct *, int, const struct sched_param *);
 extern int sched_setattr(struct task_struct *, const struct sched_attr *);
 extern int sched_setattr_nocheck(struct task_struct *, const struct sched_attr *);
+#ifdef CONFIG_SCHED_PERIODIC_DEMAND
+extern void sched_set_periodic_demand(struct task_struct *p, bool enable);
+#endif
 extern struct task_struct *idle_task(int cpu);
 
 /**
@@ -11,6 +11,7 @@
 
 #define SCHED_CPUFREQ_IOWAIT	(1U << 0)
 #define SCHED_CPUFREQ_MIGRATION	(1U << 1)
+#define SCHED_CPUFREQ_BOOST	(1U << 2)
 
 #ifdef CONFIG_CPU_FREQ
 struct update_util_data {
@@ -29,6 +30,11 @@ static inline unsigned long map_util_freq(unsigned long util,
 }
 #endif /* CONFIG_CPU_FREQ */
 
+#ifdef CONFIG_SCHED_TUNE
+/* Largest schedtune boost of the tasks RUNNABLE on @cpu */
+int schedtune_cpu_boost(int cpu);
+#endif
+
 #if defined(CONFIG_ENERGY_MODEL) && defined(CONFIG_CPU_FREQ_GOV_SCHEDUTIL)
 void sched_cpufreq_governor_change(struct cpufreq_policy *policy,
 			struct cpufreq_governor *old_gov);
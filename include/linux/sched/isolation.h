@@ -13,6 +13,7 @@ enum hk_flags {
 	HK_FLAG_TICK		= (1 << 4),
 	HK_FLAG_DOMAIN		= (1 << 5),
 	HK_FLAG_WQ		= (1 << 6),
+	HK_FLAG_KTHREAD		= (1 << 7),
 };
 
 #ifdef CONFIG_CPU_ISOLATION
@@ -22,6 +23,9 @@ extern const struct cpumask *housekeeping_cpumask(enum hk_flags flags);
 extern void housekeeping_affine(struct task_struct *t, enum hk_flags flags);
 extern bool housekeeping_test_cpu(int cpu, enum hk_flags flags);
 extern void __init housekeeping_init(void);
+#ifdef CONFIG_CPU_ISOLATION_RUNTIME
+extern int housekeeping_isolate(const struct cpumask *isolated);
+#endif
 
 #else
 
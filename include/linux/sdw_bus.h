@@ -408,16 +408,36 @@ struct sdw_slv_bra_capabilities {
  *				In this case bus driver will wait outside
  *				master controller context for bank switch
  *				to happen.
- *  @result:			Result of the asynchronous transfer.
+ *				It is also used for batches of register
+ *				accesses to one Slave, which the Master
+ *				controller queues in as few command FIFO
+ *				fills as possible.
+ *  @result:			Result of the asynchronous transfer. For a
+ *				batch this is the number of messages
+ *				transferred or a negative error code.
  *  @xfer_complete		Bus driver will wait on this. Master controller
  *				needs to ack on this for transfer complete.
  *  @msg			Message to be transferred.
+ *  @num			Number of messages in the batch.
+ *  @callback			Optional, called once the whole batch is
+ *				done, before @xfer_complete is signalled.
+ *				May be called from interrupt context.
+ *  @context			Private data for @callback.
+ *  @mstr			Private to the bus driver, Master a batch
+ *				is queued on.
+ *  @caller_callback		Private to the bus driver, @callback of the
+ *				caller while a batch is in flight.
  */
 
 struct sdw_async_xfer_data {
 	int result;
 	struct completion xfer_complete;
 	struct sdw_msg *msg;
+	int num;
+	void (*callback)(struct sdw_async_xfer_data *data);
+	void *context;
+	struct sdw_master *mstr;
+	void (*caller_callback)(struct sdw_async_xfer_data *data);
 };
 
 /**
@@ -953,6 +973,12 @@ struct sdw_master_port_ops {
  *				Slave registers are standard.
  * @xfer_msg: Callback function to Master driver to read/write
  *		Slave registers.
+ * @xfer_msg_async: Same as @xfer_msg, but returns once the message is
+ *		queued and signals data->xfer_complete when it is done.
+ * @xfer_msg_batch: Queue @num messages to the same Slave in one go. Returns
+ *		0 once queued, in which case data->callback and
+ *		data->xfer_complete are signalled when the last message is
+ *		done, or a negative error code if nothing was queued.
  * @xfer_bulk: Callback function to Master driver for bulk transfer.
  * @monitor_handover: Allow monitor to be owner of command, if requested.
  * @set_ssp_interval: Set SSP interval.
@@ -968,6 +994,9 @@ struct sdw_master_ops {
 	enum sdw_command_response (*xfer_msg_async)(struct sdw_master *mstr,
 		struct sdw_msg *msg, bool program_scp_addr_page,
 		struct sdw_async_xfer_data *data);
+	enum sdw_command_response (*xfer_msg_batch)(struct sdw_master *mstr,
+		struct sdw_msg *msg, int num, bool program_scp_addr_page,
+		struct sdw_async_xfer_data *data);
 	int (*xfer_bulk)(struct sdw_master *mstr,
 		struct sdw_bra_block *block);
 	int (*monitor_handover)(struct sdw_master *mstr,
@@ -1206,6 +1235,20 @@ void sdw_slave_driver_unregister(struct sdw_slave_driver *drv);
  */
 int sdw_slave_transfer(struct sdw_master *mstr, struct sdw_msg *msg, int num);
 
+/**
+ * sdw_slave_transfer_batch: Transfer a batch of SDW messages to one Slave
+ *			and wait for all of them. The Master controller
+ *			queues as many messages as its command FIFO
+ *			holds and only interrupts once per fill.
+ * @mstr: Master which will transfer the messages.
+ * @msg: Array of messages to be transferred, all to the same Slave.
+ * @num: Number of messages to be transferred.
+ *
+ * Returns the number of messages transferred or a negative error code.
+ */
+int sdw_slave_transfer_batch(struct sdw_master *mstr, struct sdw_msg *msg,
+				int num);
+
 /**
  * sdw_alloc_stream_tag: Allocate stream_tag for each audio stream
  *			between SoundWire Masters and Slaves.
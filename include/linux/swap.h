@@ -298,6 +298,7 @@ struct vma_swap_readahead {
 void *workingset_eviction(struct address_space *mapping, struct page *page);
 bool workingset_refault(void *shadow);
 void workingset_activation(struct page *page);
+unsigned long mm_workingset_thrashing(struct mm_struct *mm);
 
 /* Do not use directly, use workingset_lookup_update */
 void workingset_update_node(struct radix_tree_node *node);
@@ -345,6 +346,9 @@ extern unsigned long zone_reclaimable_pages(struct zone *zone);
 extern unsigned long try_to_free_pages(struct zonelist *zonelist, int order,
 					gfp_t gfp_mask, nodemask_t *mask);
 extern int __isolate_lru_page(struct page *page, isolate_mode_t mode);
+#ifdef CONFIG_PROCESS_RECLAIM
+extern unsigned long reclaim_pages_from_list(struct list_head *page_list);
+#endif
 extern unsigned long try_to_free_mem_cgroup_pages(struct mem_cgroup *memcg,
 						  unsigned long nr_pages,
 						  gfp_t gfp_mask,
@@ -375,6 +379,7 @@ static inline int node_reclaim(struct pglist_data *pgdat, gfp_t mask,
 extern int page_evictable(struct page *page);
 extern void check_move_unevictable_pages(struct page **, int nr_pages);
 
+extern int kswapd_threads;
 extern int kswapd_run(int nid);
 extern void kswapd_stop(int nid);
 
@@ -2,6 +2,8 @@
 #ifndef _LINUX_TRACE_H
 #define _LINUX_TRACE_H
 
+#include <linux/bits.h>
+
 #ifdef CONFIG_TRACING
 /*
  * The trace export - an export of Ftrace output. The trace_export
@@ -15,10 +17,17 @@
  * next		- pointer to the next trace_export
  * write	- copy traces which have been delt with ->commit() to
  *		  the destination
+ * flags	- which ftrace output to export, TRACE_EXPORT_*
  */
 struct trace_export {
 	struct trace_export __rcu	*next;
 	void (*write)(struct trace_export *, const void *, unsigned int);
+	int flags;
+};
+
+enum {
+	TRACE_EXPORT_FUNCTION	= BIT(0),
+	TRACE_EXPORT_EVENT	= BIT(1),
 };
 
 int register_ftrace_export(struct trace_export *export);
@@ -69,6 +69,13 @@ void *virtqueue_get_buf(struct virtqueue *vq, unsigned int *len);
 void *virtqueue_get_buf_ctx(struct virtqueue *vq, unsigned int *len,
 			    void **ctx);
 
+unsigned int virtqueue_get_bufs(struct virtqueue *vq, void **bufs,
+				unsigned int *lens, unsigned int max);
+
+unsigned int virtqueue_get_bufs_ctx(struct virtqueue *vq, void **bufs,
+				    unsigned int *lens, void **ctxs,
+				    unsigned int max);
+
 void virtqueue_disable_cb(struct virtqueue *vq);
 
 bool virtqueue_enable_cb(struct virtqueue *vq);
@@ -29,7 +29,18 @@ struct vmpressure {
 
 struct mem_cgroup;
 
+/* What a task stalled on, for the time based accounting in /proc/vmpressure */
+enum vmpressure_stall_type {
+	VMPRESSURE_STALL_RECLAIM = 0,
+	VMPRESSURE_STALL_COMPACT,
+	VMPRESSURE_STALL_THRASHING,
+	VMPRESSURE_NUM_STALLS,
+};
+
 #ifdef CONFIG_MEMCG
+extern u64 vmpressure_stall_enter(void);
+extern void vmpressure_stall_leave(u64 start, enum vmpressure_stall_type type);
+
 extern void vmpressure(gfp_t gfp, struct mem_cgroup *memcg, bool tree,
 		       unsigned long scanned, unsigned long reclaimed);
 extern void vmpressure_prio(gfp_t gfp, struct mem_cgroup *memcg, int prio);
@@ -48,5 +59,11 @@ static inline void vmpressure(gfp_t gfp, struct mem_cgroup *memcg, bool tree,
 			      unsigned long scanned, unsigned long reclaimed) {}
 static inline void vmpressure_prio(gfp_t gfp, struct mem_cgroup *memcg,
 				   int prio) {}
+static inline u64 vmpressure_stall_enter(void)
+{
+	return 0;
+}
+static inline void vmpressure_stall_leave(u64 start,
+					  enum vmpressure_stall_type type) {}
 #endif /* CONFIG_MEMCG */
 #endif /* __LINUX_VMPRESSURE_H */
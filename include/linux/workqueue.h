@@ -106,6 +106,9 @@ struct work_struct {
 #ifdef CONFIG_LOCKDEP
 	struct lockdep_map lockdep_map;
 #endif
+#ifdef CONFIG_WQ_LATENCY_HIST
+	u64 queued_at;
+#endif
 };
 
 #define WORK_DATA_INIT()	ATOMIC_LONG_INIT((unsigned long)WORK_STRUCT_NO_POOL)
@@ -153,6 +156,15 @@ struct workqueue_attrs {
 	 * doesn't participate in pool hash calculations or equality comparisons.
 	 */
 	bool no_numa;
+
+	/**
+	 * @cache_affine: spread pwqs over last level caches instead of nodes
+	 *
+	 * Like ``no_numa``, this only affects how
+	 * :c:func:`apply_workqueue_attrs` selects pools and isn't a property
+	 * of a worker_pool.
+	 */
+	bool cache_affine;
 };
 
 static inline struct delayed_work *to_delayed_work(struct work_struct *work)
@@ -340,6 +352,18 @@ enum {
 	 */
 	WQ_POWER_EFFICIENT	= 1 << 7,
 
+	/*
+	 * By default the work items of an unbound workqueue run on any CPU
+	 * of the NUMA node they are queued from, wherever the scheduler
+	 * puts the kworker.  Workqueues marked with WQ_CACHE_AFFINE narrow
+	 * this down to the CPUs sharing the last level cache with the
+	 * queueing CPU, so that data the submitter just touched is still
+	 * cache hot when the work item runs.  Only meaningful together with
+	 * WQ_UNBOUND, can be toggled through the cache_affine sysfs
+	 * attribute of WQ_SYSFS workqueues.
+	 */
+	WQ_CACHE_AFFINE		= 1 << 8,
+
 	__WQ_DRAINING		= 1 << 16, /* internal: workqueue is draining */
 	__WQ_ORDERED		= 1 << 17, /* internal: workqueue is ordered */
 	__WQ_LEGACY		= 1 << 18, /* internal: create*_workqueue() */
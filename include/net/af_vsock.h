@@ -161,6 +161,12 @@ struct vsock_transport {
 
 	/* Addressing. */
 	u32 (*get_local_cid)(void);
+
+	/* Busy polling, optional. Called without the socket lock held to
+	 * process incoming packets right away instead of waiting for the
+	 * interrupt driven path.
+	 */
+	void (*busy_poll)(struct vsock_sock *);
 };
 
 /**** CORE ****/
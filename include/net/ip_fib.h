@@ -231,7 +231,7 @@ int fib_table_delete(struct net *, struct fib_table *, struct fib_config *,
 int fib_table_dump(struct fib_table *table, struct sk_buff *skb,
 		   struct netlink_callback *cb);
 int fib_table_flush(struct net *net, struct fib_table *table);
-struct fib_table *fib_trie_unmerge(struct fib_table *main_tb);
+struct fib_table *fib_trie_unmerge(struct net *net, struct fib_table *main_tb);
 void fib_table_flush_external(struct fib_table *table);
 void fib_free_table(struct fib_table *tb);
 
@@ -405,7 +405,8 @@ void fib_select_path(struct net *net, struct fib_result *res,
 
 /* Exported by fib_trie.c */
 void fib_trie_init(void);
-struct fib_table *fib_trie_table(u32 id, struct fib_table *alias);
+struct fib_table *fib_trie_table(struct net *net, u32 id,
+				 struct fib_table *alias);
 
 static inline void fib_combine_itag(u32 *itag, const struct fib_result *res)
 {
@@ -0,0 +1,112 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM skl
+
+#if !defined(_TRACE_SKL_H) || defined(TRACE_HEADER_MULTI_READ)
+#define _TRACE_SKL_H
+
+#include <linux/types.h>
+#include <linux/tracepoint.h>
+
+DECLARE_EVENT_CLASS(skl_pcm_stamp,
+
+	TP_PROTO(int index, int dir, u32 wallclk),
+
+	TP_ARGS(index, dir, wallclk),
+
+	TP_STRUCT__entry(
+		__field(	int,		index		)
+		__field(	int,		dir		)
+		__field(	u32,		wallclk		)
+	),
+
+	TP_fast_assign(
+		__entry->index = index;
+		__entry->dir = dir;
+		__entry->wallclk = wallclk;
+	),
+
+	TP_printk("stream %d %s wallclk %u", __entry->index,
+		__entry->dir ? "capture" : "playback", __entry->wallclk)
+);
+
+DEFINE_EVENT(skl_pcm_stamp, skl_host_dma_prepare,
+
+	TP_PROTO(int index, int dir, u32 wallclk),
+
+	TP_ARGS(index, dir, wallclk)
+
+);
+
+DEFINE_EVENT(skl_pcm_stamp, skl_host_dma_start,
+
+	TP_PROTO(int index, int dir, u32 wallclk),
+
+	TP_ARGS(index, dir, wallclk)
+
+);
+
+DEFINE_EVENT(skl_pcm_stamp, skl_pipe_run,
+
+	TP_PROTO(int index, int dir, u32 wallclk),
+
+	TP_ARGS(index, dir, wallclk)
+
+);
+
+DEFINE_EVENT(skl_pcm_stamp, skl_link_dma_start,
+
+	TP_PROTO(int index, int dir, u32 wallclk),
+
+	TP_ARGS(index, dir, wallclk)
+
+);
+
+TRACE_EVENT(skl_pcm_position,
+
+	TP_PROTO(int index, u32 pos, u32 wallclk, s64 delay_us),
+
+	TP_ARGS(index, pos, wallclk, delay_us),
+
+	TP_STRUCT__entry(
+		__field(	int,		index		)
+		__field(	u32,		pos		)
+		__field(	u32,		wallclk		)
+		__field(	s64,		delay_us	)
+	),
+
+	TP_fast_assign(
+		__entry->index = index;
+		__entry->pos = pos;
+		__entry->wallclk = wallclk;
+		__entry->delay_us = delay_us;
+	),
+
+	TP_printk("stream %d pos %u wallclk %u delay %lld us",
+		__entry->index, __entry->pos, __entry->wallclk,
+		__entry->delay_us)
+);
+
+TRACE_EVENT(skl_pipe_state,
+
+	TP_PROTO(int ppl_id, int state),
+
+	TP_ARGS(ppl_id, state),
+
+	TP_STRUCT__entry(
+		__field(	int,		ppl_id		)
+		__field(	int,		state		)
+	),
+
+	TP_fast_assign(
+		__entry->ppl_id = ppl_id;
+		__entry->state = state;
+	),
+
+	TP_printk("pipe %d state %d", __entry->ppl_id, __entry->state)
+);
+
+#endif /* _TRACE_SKL_H */
+
+/* This part must be outside protection */
+#include <trace/define_trace.h>
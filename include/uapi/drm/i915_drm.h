@@ -110,7 +110,9 @@ enum drm_i915_gem_engine_class {
 enum drm_i915_pmu_engine_sample {
 	I915_SAMPLE_BUSY = 0,
 	I915_SAMPLE_WAIT = 1,
-	I915_SAMPLE_SEMA = 2
+	I915_SAMPLE_SEMA = 2,
+	I915_SAMPLE_QUEUE_TIME = 3,
+	I915_SAMPLE_EXEC_TIME = 4
 };
 
 #define I915_PMU_SAMPLE_BITS (4)
@@ -133,6 +135,17 @@ enum drm_i915_pmu_engine_sample {
 #define I915_PMU_ENGINE_SEMA(class, instance) \
 	__I915_PMU_ENGINE(class, instance, I915_SAMPLE_SEMA)
 
+/*
+ * Accumulated time, in ns, requests on the engine spent waiting between
+ * becoming ready to run and being handed to the hardware, and running on
+ * the hardware respectively.
+ */
+#define I915_PMU_ENGINE_QUEUE_TIME(class, instance) \
+	__I915_PMU_ENGINE(class, instance, I915_SAMPLE_QUEUE_TIME)
+
+#define I915_PMU_ENGINE_EXEC_TIME(class, instance) \
+	__I915_PMU_ENGINE(class, instance, I915_SAMPLE_EXEC_TIME)
+
 #define __I915_PMU_OTHER(x) (__I915_PMU_ENGINE(0xff, 0xff, 0xf) + 1 + (x))
 
 #define I915_PMU_ACTUAL_FREQUENCY	__I915_PMU_OTHER(0)
@@ -1459,6 +1472,16 @@ struct drm_i915_gem_context_param {
 #define   I915_CONTEXT_MAX_USER_PRIORITY	1023 /* inclusive */
 #define   I915_CONTEXT_DEFAULT_PRIORITY		0
 #define   I915_CONTEXT_MIN_USER_PRIORITY	-1023 /* inclusive */
+/*
+ * Upper bound, in milliseconds, on how long requests from this context wait
+ * for the engine to preempt lower priority work before that work is reset.
+ * 0 (the default) waits for the next arbitration point however long it
+ * takes. Requires CAP_SYS_NICE.
+ *
+ * Kept well clear of the sequential values upstream hands out (0x7 onwards
+ * are SSEU, RECOVERABLE, VM, ...), so it never aliases one of them.
+ */
+#define I915_CONTEXT_PARAM_PREEMPT_TIMEOUT	0x100
 	__u64 value;
 };
 
@@ -1513,6 +1536,16 @@ enum drm_i915_perf_property_id {
 	 */
 	DRM_I915_PERF_PROP_OA_EXPONENT,
 
+	/**
+	 * Open the stream for the shadow context of the GVT-g vGPU with the
+	 * given id, filtering OA reports down to those generated while that
+	 * guest was running. This is a system-wide view of another VM and so
+	 * always requires root privileges (subject to
+	 * dev.i915.perf_stream_paranoid). Mutually exclusive with
+	 * DRM_I915_PERF_PROP_CTX_HANDLE.
+	 */
+	DRM_I915_PERF_PROP_GVT_VGPU_ID,
+
 	DRM_I915_PERF_PROP_MAX /* non-ABI */
 };
 
@@ -35,7 +35,20 @@ struct dma_buf_sync {
 #define DMA_BUF_SYNC_VALID_FLAGS_MASK \
 	(DMA_BUF_SYNC_RW | DMA_BUF_SYNC_END)
 
+/*
+ * Same as struct dma_buf_sync, but only the @len bytes starting at @offset
+ * are made coherent, which saves cache maintenance when the CPU touches a
+ * small part of a large buffer.
+ */
+struct dma_buf_sync_partial {
+	__u64 flags;
+	__u32 offset;
+	__u32 len;
+};
+
 #define DMA_BUF_BASE		'b'
 #define DMA_BUF_IOCTL_SYNC	_IOW(DMA_BUF_BASE, 0, struct dma_buf_sync)
+#define DMA_BUF_IOCTL_SYNC_PARTIAL	\
+	_IOW(DMA_BUF_BASE, 2, struct dma_buf_sync_partial)
 
 #endif
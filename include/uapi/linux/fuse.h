@@ -116,6 +116,16 @@
  *
  *  7.27
  *  - add FUSE_ABORT_ERROR
+ *
+ *  7.28
+ *  - add FUSE_MULTIQUEUE and FUSE_DEV_IOC_BIND_QUEUE
+ *  - add FUSE_PASSTHROUGH, FUSE_DEV_IOC_PASSTHROUGH_OPEN and
+ *    fuse_open_out.passthrough_fh
+ *
+ *  7.29
+ *  - move FUSE_MULTIQUEUE and FUSE_PASSTHROUGH to bits 30 and 31
+ *  - renumber FUSE_DEV_IOC_BIND_QUEUE and FUSE_DEV_IOC_PASSTHROUGH_OPEN
+ *  - FUSE_PASSTHROUGH is not granted together with FUSE_WRITEBACK_CACHE
  */
 
 #ifndef _LINUX_FUSE_H
@@ -151,7 +161,7 @@
 #define FUSE_KERNEL_VERSION 7
 
 /** Minor version number of this interface */
-#define FUSE_KERNEL_MINOR_VERSION 27
+#define FUSE_KERNEL_MINOR_VERSION 29
 
 /** The node ID of the root inode */
 #define FUSE_ROOT_ID 1
@@ -249,6 +259,13 @@ struct fuse_file_lock {
  * FUSE_HANDLE_KILLPRIV: fs handles killing suid/sgid/cap on write/chown/trunc
  * FUSE_POSIX_ACL: filesystem supports posix acls
  * FUSE_ABORT_ERROR: reading the device after abort returns ECONNABORTED
+ * FUSE_MULTIQUEUE: one input queue per CPU, see FUSE_DEV_IOC_BIND_QUEUE
+ * FUSE_PASSTHROUGH: read/write of files opened with a passthrough_fh go
+ *		     directly to the backing file, not available together
+ *		     with FUSE_WRITEBACK_CACHE
+ *
+ * FUSE_MULTIQUEUE and FUSE_PASSTHROUGH are allocated from the top so they
+ * stay clear of the bits handed out by the upstream protocol.
  */
 #define FUSE_ASYNC_READ		(1 << 0)
 #define FUSE_POSIX_LOCKS	(1 << 1)
@@ -272,6 +289,8 @@ struct fuse_file_lock {
 #define FUSE_HANDLE_KILLPRIV	(1 << 19)
 #define FUSE_POSIX_ACL		(1 << 20)
 #define FUSE_ABORT_ERROR	(1 << 21)
+#define FUSE_MULTIQUEUE		(1 << 30)
+#define FUSE_PASSTHROUGH	(1U << 31)
 
 /**
  * CUSE INIT request/reply flags
@@ -504,7 +523,7 @@ struct fuse_create_in {
 struct fuse_open_out {
 	uint64_t	fh;
 	uint32_t	open_flags;
-	uint32_t	padding;
+	uint32_t	passthrough_fh;
 };
 
 struct fuse_release_in {
@@ -779,8 +798,24 @@ struct fuse_notify_retrieve_in {
 	uint64_t	dummy4;
 };
 
-/* Device ioctls: */
-#define FUSE_DEV_IOC_CLONE	_IOR(229, 0, uint32_t)
+/*
+ * Device ioctls:
+ *
+ * FUSE_DEV_IOC_BIND_QUEUE: with FUSE_MULTIQUEUE, make a cloned device read
+ * the requests issued on the given CPU (modulo the number of queues) instead
+ * of the shared queue.  FORGET, INTERRUPT and notify replies always go to
+ * the shared queue, so at least one device must be left unbound.
+ *
+ * FUSE_DEV_IOC_PASSTHROUGH_OPEN: with FUSE_PASSTHROUGH, register an open
+ * file descriptor as a backing file.  Returns an identifier to be put in
+ * fuse_open_out.passthrough_fh by the next OPEN or CREATE reply.
+ *
+ * Both are numbered from the top of the range, away from the numbers the
+ * upstream protocol assigns after FUSE_DEV_IOC_CLONE.
+ */
+#define FUSE_DEV_IOC_CLONE		_IOR(229, 0, uint32_t)
+#define FUSE_DEV_IOC_BIND_QUEUE		_IOW(229, 254, uint32_t)
+#define FUSE_DEV_IOC_PASSTHROUGH_OPEN	_IOW(229, 255, uint32_t)
 
 struct fuse_lseek_in {
 	uint64_t	fh;
@@ -124,6 +124,8 @@ enum hyper_dmabuf_query {
 	HYPER_DMABUF_QUERY_DELAYED_UNEXPORTED,
 	HYPER_DMABUF_QUERY_PRIV_INFO_SIZE,
 	HYPER_DMABUF_QUERY_PRIV_INFO,
+	/* sync_file fd of last pending fence of imported buffer */
+	HYPER_DMABUF_QUERY_FENCE_FD,
 };
 
 enum hyper_dmabuf_status {
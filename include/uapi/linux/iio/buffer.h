@@ -0,0 +1,52 @@
+/* SPDX-License-Identifier: GPL-2.0 WITH Linux-syscall-note */
+/* industrial I/O buffer definitions needed both in and out of kernel
+ */
+
+#ifndef _UAPI_IIO_BUFFER_H_
+#define _UAPI_IIO_BUFFER_H_
+
+#include <linux/types.h>
+
+/**
+ * struct iio_buffer_block_alloc_req - Descriptor for allocating IIO buffer
+ *	blocks
+ * @type:	Reserved for future use, must be 0
+ * @size:	Size of each block in bytes, rounded up to a page
+ * @count:	Number of blocks to allocate, 0 frees the blocks. Updated
+ *		with the number of blocks actually allocated.
+ * @id:		Reserved for future use, must be 0
+ */
+struct iio_buffer_block_alloc_req {
+	__u32 type;
+	__u32 size;
+	__u32 count;
+	__u32 id;
+};
+
+/**
+ * struct iio_buffer_block - Descriptor for a IIO buffer block
+ * @id:		Block ID, from 0 to count - 1
+ * @size:	Size of the block in bytes
+ * @bytes_used:	Number of bytes in the block that hold samples
+ * @type:	Reserved for future use, must be 0
+ * @flags:	Reserved for future use, must be 0
+ * @offset:	Offset of the block in the mmap()ed area of the device
+ * @timestamp:	Time, in the clock of the IIO device, the block completed
+ */
+struct iio_buffer_block {
+	__u32 id;
+	__u32 size;
+	__u32 bytes_used;
+	__u32 type;
+	__u32 flags;
+	__u32 offset;
+	__u64 timestamp;
+};
+
+#define IIO_BUFFER_BLOCK_ALLOC_IOCTL	_IOWR('i', 0xa0, struct iio_buffer_block_alloc_req)
+#define IIO_BUFFER_BLOCK_FREE_IOCTL	_IO('i', 0xa1)
+#define IIO_BUFFER_BLOCK_QUERY_IOCTL	_IOWR('i', 0xa2, struct iio_buffer_block)
+#define IIO_BUFFER_BLOCK_ENQUEUE_IOCTL	_IOW('i', 0xa3, struct iio_buffer_block)
+#define IIO_BUFFER_BLOCK_DEQUEUE_IOCTL	_IOR('i', 0xa4, struct iio_buffer_block)
+
+#endif /* _UAPI_IIO_BUFFER_H_ */
@@ -234,6 +234,18 @@ struct input_mask {
 
 #define EVIOCSCLOCKID		_IOW('E', 0xa0, int)			/* Set clockid to be used for timestamps */
 
+/**
+ * EVIOCSBATCH - set the wakeup batching window of a client
+ *
+ * The argument is a window in microseconds, at most one second. With a
+ * non-zero window, a reader blocked in read() or poll() is woken up at
+ * most once per window, with all the packets received in the meantime,
+ * instead of after every SYN_REPORT. Readers are still woken up right
+ * away when the client buffer gets half full. Zero (the default) wakes
+ * up readers on every packet, for latency sensitive clients.
+ */
+#define EVIOCSBATCH		_IOW('E', 0xa1, unsigned int)
+
 /*
  * IDs.
  */
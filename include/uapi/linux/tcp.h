@@ -124,6 +124,8 @@ enum {
 #define TCP_FASTOPEN_NO_COOKIE	34	/* Enable TFO without a TFO cookie */
 #define TCP_ZEROCOPY_RECEIVE	35
 #define TCP_INQ			36	/* Notify bytes available to read as a cmsg on read */
+/* Numbered off the upstream sequence, 37 and up are taken there */
+#define TCP_TSQ_LIMIT		200	/* Cap on bytes queued below the socket */
 
 #define TCP_CM_INQ		TCP_INQ
 
@@ -0,0 +1,56 @@
+/* SPDX-License-Identifier: GPL-2.0 WITH Linux-syscall-note */
+#ifndef _UAPI_TRACE_MMAP_H_
+#define _UAPI_TRACE_MMAP_H_
+
+#include <linux/types.h>
+
+/**
+ * struct trace_buffer_meta - Ring-buffer Meta-page description
+ * @meta_page_size:	Size of this meta-page.
+ * @meta_struct_len:	Size of this structure.
+ * @subbuf_size:	Size of each sub-buffer, header included.
+ * @nr_subbufs:		Number of sub-buffers in the ring-buffer, including
+ *			the reader one.
+ * @reader.lost_events:	Number of events lost before the reader sub-buffer.
+ * @reader.id:		ID of the sub-buffer currently owned by the reader.
+ * @reader.read:	Offset in the reader sub-buffer data of the first
+ *			event not yet consumed.
+ * @flags:		Flags, currently unused.
+ * @entries:		Number of entries in the ring-buffer.
+ * @overrun:		Number of entries lost in the ring-buffer.
+ * @read:		Number of entries that have been read.
+ *
+ * The meta-page is mapped at offset 0, followed by the sub-buffers in ID
+ * order: sub-buffer N is at offset (N + 1) * @meta_page_size. Only the
+ * reader sub-buffer may be read, the others belong to the writer. Events
+ * of the reader sub-buffer run from @reader.read to the commit field of
+ * its header, which keeps growing while the writer is still on it.
+ */
+struct trace_buffer_meta {
+	__u32		meta_page_size;
+	__u32		meta_struct_len;
+
+	__u32		subbuf_size;
+	__u32		nr_subbufs;
+
+	struct {
+		__u64	lost_events;
+		__u32	id;
+		__u32	read;
+	} reader;
+
+	__u64	flags;
+
+	__u64	entries;
+	__u64	overrun;
+	__u64	read;
+};
+
+/*
+ * Consume the reader sub-buffer and swap in the next one holding events,
+ * then update the meta-page. Blocks until there are events unless the file
+ * is opened O_NONBLOCK.
+ */
+#define TRACE_MMAP_IOCTL_GET_READER		_IO('R', 0x20)
+
+#endif /* _UAPI_TRACE_MMAP_H_ */
@@ -0,0 +1,109 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Deferred initcalls
+ *
+ * Boot time to the first frame on screen should only pay for the drivers
+ * that display it. Built-in code registered with deferred_initcall() is
+ * skipped by do_initcalls() and run from here instead, once userspace asks
+ * for it by writing to /proc/deferred_initcalls, or when
+ * deferred_initcall_timeout seconds have passed since init started.
+ * Reading the file tells whether the calls have run.
+ */
+
+#include <linux/init.h>
+#include <linux/kallsyms.h>
+#include <linux/ktime.h>
+#include <linux/moduleparam.h>
+#include <linux/proc_fs.h>
+#include <linux/seq_file.h>
+#include <linux/workqueue.h>
+
+extern initcall_entry_t __deferred_initcall_start[];
+extern initcall_entry_t __deferred_initcall_end[];
+
+static unsigned int deferred_initcall_timeout = 60;
+core_param(deferred_initcall_timeout, deferred_initcall_timeout, uint, 0444);
+
+static bool deferred_initcalls_done;
+
+static void deferred_initcall_run(initcall_t fn)
+{
+	ktime_t calltime;
+	int ret;
+
+	/* Its code has been freed along with the rest of init memory */
+	if (is_kernel_inittext((unsigned long)fn)) {
+		pr_err("deferred initcall %pF is __init, skipped\n", fn);
+		return;
+	}
+
+	calltime = ktime_get();
+	ret = fn();
+	if (initcall_debug)
+		printk(KERN_DEBUG "deferred initcall %pF returned %d after %lld usecs\n",
+		       fn, ret, ktime_us_delta(ktime_get(), calltime));
+}
+
+static void deferred_initcall_work_fn(struct work_struct *work)
+{
+	initcall_entry_t *fn;
+
+	/* Requeued by a write after the calls have run */
+	if (deferred_initcalls_done)
+		return;
+
+	for (fn = __deferred_initcall_start; fn < __deferred_initcall_end; fn++)
+		deferred_initcall_run(initcall_from_entry(fn));
+
+	WRITE_ONCE(deferred_initcalls_done, true);
+}
+
+static DECLARE_DELAYED_WORK(deferred_initcall_work, deferred_initcall_work_fn);
+
+/* Called by kernel_init() right before it starts init */
+void deferred_initcalls_start(void)
+{
+	if (deferred_initcall_timeout)
+		queue_delayed_work(system_unbound_wq, &deferred_initcall_work,
+				   deferred_initcall_timeout * HZ);
+}
+
+static int deferred_initcalls_show(struct seq_file *m, void *v)
+{
+	seq_printf(m, "%d\n", READ_ONCE(deferred_initcalls_done));
+	return 0;
+}
+
+static int deferred_initcalls_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, deferred_initcalls_show, NULL);
+}
+
+/* Any write runs the calls now and returns once they are done */
+static ssize_t deferred_initcalls_write(struct file *file,
+					const char __user *buf,
+					size_t count, loff_t *ppos)
+{
+	mod_delayed_work(system_unbound_wq, &deferred_initcall_work, 0);
+	flush_delayed_work(&deferred_initcall_work);
+
+	return count;
+}
+
+static const struct file_operations deferred_initcalls_fops = {
+	.open		= deferred_initcalls_open,
+	.read		= seq_read,
+	.write		= deferred_initcalls_write,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int __init deferred_initcalls_proc_init(void)
+{
+	if (!proc_create("deferred_initcalls", 0600, NULL,
+			 &deferred_initcalls_fops))
+		return -ENOMEM;
+
+	return 0;
+}
+late_initcall(deferred_initcalls_proc_init);
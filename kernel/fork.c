@@ -326,14 +326,31 @@ struct vm_area_struct *vm_area_dup(struct vm_area_struct *orig)
 	if (new) {
 		*new = *orig;
 		INIT_LIST_HEAD(&new->anon_vma_chain);
+		vma_init_sequence(new);
 	}
 	return new;
 }
 
+#ifdef CONFIG_SPECULATIVE_PAGE_FAULT
+static void __vm_area_free(struct rcu_head *head)
+{
+	struct vm_area_struct *vma = container_of(head, struct vm_area_struct,
+						  vm_rcu);
+
+	kmem_cache_free(vm_area_cachep, vma);
+}
+
+/* handle_speculative_fault() may still be looking at it */
+void vm_area_free(struct vm_area_struct *vma)
+{
+	call_rcu(&vma->vm_rcu, __vm_area_free);
+}
+#else
 void vm_area_free(struct vm_area_struct *vma)
 {
 	kmem_cache_free(vm_area_cachep, vma);
 }
+#endif
 
 static void account_kernel_stack(struct task_struct *tsk, int account)
 {
@@ -940,6 +957,8 @@ static struct mm_struct *mm_init(struct mm_struct *mm, struct task_struct *p,
 	mm->locked_vm = 0;
 	mm->pinned_vm = 0;
 	memset(&mm->rss_stat, 0, sizeof(mm->rss_stat));
+	memset(&mm->refault_stat, 0, sizeof(mm->refault_stat));
+	mm->refault_stat.thrashing_stamp = jiffies;
 	spin_lock_init(&mm->page_table_lock);
 	spin_lock_init(&mm->arg_lock);
 	mm_init_cpumask(mm);
@@ -41,6 +41,7 @@
 #include <linux/rculist.h>
 #include <linux/poll.h>
 #include <linux/irq_work.h>
+#include <linux/kthread.h>
 #include <linux/ctype.h>
 #include <linux/uio.h>
 #include <linux/sched/clock.h>
@@ -1833,21 +1834,32 @@ static size_t log_output(int facility, int level, enum log_flags lflags, const c
 	return log_store(facility, level, lflags, 0, dict, dictlen, text, text_len);
 }
 
-/* Must be called under logbuf_lock. */
-int vprintk_store(int facility, int level,
-		  const char *dict, size_t dictlen,
-		  const char *fmt, va_list args)
+/*
+ * Messages are formatted into a per-CPU buffer before logbuf_lock is
+ * taken, so that writers on different CPUs only serialize on copying the
+ * result into the log buffer. Interrupts are disabled while the buffer is
+ * in use. NMIs, which may store messages directly (see
+ * printk_nmi_direct_enter()), have a buffer of their own.
+ */
+struct printk_textbuf {
+	char text[LOG_LINE_MAX];
+};
+static DEFINE_PER_CPU(struct printk_textbuf, printk_textbuf[2]);
+
+static size_t vprintk_format(int facility, int *levelp,
+			     enum log_flags *lflagsp, const char *dict,
+			     char **textp, const char *fmt, va_list args)
 {
-	static char textbuf[LOG_LINE_MAX];
-	char *text = textbuf;
-	size_t text_len;
+	char *text = this_cpu_ptr(&printk_textbuf[!!in_nmi()])->text;
 	enum log_flags lflags = 0;
+	int level = *levelp;
+	size_t text_len;
 
 	/*
 	 * The printf needs to come first; we need the syslog
 	 * prefix which might be passed-in as a parameter.
 	 */
-	text_len = vscnprintf(text, sizeof(textbuf), fmt, args);
+	text_len = vscnprintf(text, LOG_LINE_MAX, fmt, args);
 
 	/* mark and strip a trailing newline */
 	if (text_len && text[text_len-1] == '\n') {
@@ -1883,17 +1895,53 @@ int vprintk_store(int facility, int level,
 	if (dict)
 		lflags |= LOG_PREFIX|LOG_NEWLINE;
 
+	*levelp = level;
+	*lflagsp = lflags;
+	*textp = text;
+	return text_len;
+}
+
+/* Must be called under logbuf_lock. */
+int vprintk_store(int facility, int level,
+		  const char *dict, size_t dictlen,
+		  const char *fmt, va_list args)
+{
+	enum log_flags lflags;
+	size_t text_len;
+	char *text;
+
+	text_len = vprintk_format(facility, &level, &lflags, dict, &text,
+				  fmt, args);
+
 	return log_output(facility, level, lflags,
 			  dict, dictlen, text, text_len);
 }
 
+static struct task_struct *printk_kthread;
+static bool printk_offload = IS_ENABLED(CONFIG_PRINTK_OFFLOAD);
+module_param_named(offload, printk_offload, bool, 0644);
+MODULE_PARM_DESC(offload, "print to consoles from a kernel thread");
+
+/*
+ * Leave console output to the printk kthread, unless the messages may be
+ * the last ones we get to print.
+ */
+static bool console_offload(void)
+{
+	return READ_ONCE(printk_offload) && printk_kthread &&
+	       !oops_in_progress && system_state <= SYSTEM_RUNNING;
+}
+
 asmlinkage int vprintk_emit(int facility, int level,
 			    const char *dict, size_t dictlen,
 			    const char *fmt, va_list args)
 {
 	int printed_len;
 	bool in_sched = false;
+	enum log_flags lflags;
 	unsigned long flags;
+	size_t text_len;
+	char *text;
 
 	if (level == LOGLEVEL_SCHED) {
 		level = LOGLEVEL_DEFAULT;
@@ -1903,13 +1951,20 @@ asmlinkage int vprintk_emit(int facility, int level,
 	boot_delay_msec(level);
 	printk_delay();
 
+	printk_safe_enter_irqsave(flags);
+	text_len = vprintk_format(facility, &level, &lflags, dict, &text,
+				  fmt, args);
 	/* This stops the holder of console_sem just where we want him */
-	logbuf_lock_irqsave(flags);
-	printed_len = vprintk_store(facility, level, dict, dictlen, fmt, args);
-	logbuf_unlock_irqrestore(flags);
+	raw_spin_lock(&logbuf_lock);
+	printed_len = log_output(facility, level, lflags,
+				 dict, dictlen, text, text_len);
+	raw_spin_unlock(&logbuf_lock);
+	printk_safe_exit_irqrestore(flags);
 
 	/* If called from the scheduler, we can not call up(). */
-	if (!in_sched) {
+	if (!in_sched && console_offload()) {
+		defer_console_output();
+	} else if (!in_sched) {
 		/*
 		 * Disable preemption to avoid being preempted while holding
 		 * console_sem which would prevent anyone from printing to
@@ -2875,8 +2930,10 @@ static void wake_up_klogd_work_func(struct irq_work *irq_work)
 	int pending = __this_cpu_xchg(printk_pending, 0);
 
 	if (pending & PRINTK_PENDING_OUTPUT) {
+		if (console_offload())
+			wake_up_process(printk_kthread);
 		/* If trylock fails, someone else is doing the printing */
-		if (console_trylock())
+		else if (console_trylock())
 			console_unlock();
 	}
 
@@ -2907,6 +2964,52 @@ void defer_console_output(void)
 	preempt_enable();
 }
 
+static bool console_output_pending(void)
+{
+	unsigned long flags;
+	bool ret;
+
+	logbuf_lock_irqsave(flags);
+	ret = console_seq != log_next_seq;
+	logbuf_unlock_irqrestore(flags);
+
+	return ret && !READ_ONCE(console_suspended);
+}
+
+/*
+ * Prints to the consoles on behalf of printk() when offloading is enabled,
+ * in a context that can be preempted between records.
+ */
+static int printk_kthread_func(void *data)
+{
+	while (!kthread_should_stop()) {
+		set_current_state(TASK_INTERRUPTIBLE);
+		if (!console_output_pending())
+			schedule();
+		__set_current_state(TASK_RUNNING);
+
+		console_lock();
+		console_unlock();
+	}
+
+	return 0;
+}
+
+static int __init printk_kthread_init(void)
+{
+	struct task_struct *tsk;
+
+	tsk = kthread_run(printk_kthread_func, NULL, "printk");
+	if (IS_ERR(tsk)) {
+		pr_err("failed to start printk kthread: %ld\n", PTR_ERR(tsk));
+		return PTR_ERR(tsk);
+	}
+	printk_kthread = tsk;
+
+	return 0;
+}
+early_initcall(printk_kthread_init);
+
 int vprintk_deferred(const char *fmt, va_list args)
 {
 	int r;
@@ -2159,6 +2159,11 @@ static void __sched_fork(unsigned long clone_flags, struct task_struct *p)
 	p->se.vruntime			= 0;
 	INIT_LIST_HEAD(&p->se.group_node);
 
+#ifdef CONFIG_SCHED_PERIODIC_DEMAND
+	/* Opting in is per task, and not inherited */
+	memset(&p->pdemand, 0, sizeof(p->pdemand));
+#endif
+
 #ifdef CONFIG_FAIR_GROUP_SCHED
 	p->se.cfs_rq			= NULL;
 #endif
@@ -24,12 +24,26 @@ struct cpuacct_usage {
 	u64	usages[CPUACCT_STAT_NSTATS];
 };
 
+/*
+ * Histogram of the time the tasks of a group waited on a runqueue before
+ * getting a CPU, in log2 buckets of microseconds (1024ns to keep the hot
+ * path free of divisions): bucket 0 counts the waits shorter than 1us,
+ * bucket i those in [2^(i-1), 2^i) us and the last bucket all the longer
+ * ones.
+ */
+#define CPUACCT_DELAY_BUCKETS	18
+
+struct cpuacct_delay {
+	u64	buckets[CPUACCT_DELAY_BUCKETS];
+};
+
 /* track CPU usage of a group of tasks and its child groups */
 struct cpuacct {
 	struct cgroup_subsys_state	css;
 	/* cpuusage holds pointer to a u64-type object on every CPU */
 	struct cpuacct_usage __percpu	*cpuusage;
 	struct kernel_cpustat __percpu	*cpustat;
+	struct cpuacct_delay __percpu	*delay;
 };
 
 static inline struct cpuacct *css_ca(struct cgroup_subsys_state *css)
@@ -49,9 +63,11 @@ static inline struct cpuacct *parent_ca(struct cpuacct *ca)
 }
 
 static DEFINE_PER_CPU(struct cpuacct_usage, root_cpuacct_cpuusage);
+static DEFINE_PER_CPU(struct cpuacct_delay, root_cpuacct_delay);
 static struct cpuacct root_cpuacct = {
 	.cpustat	= &kernel_cpustat,
 	.cpuusage	= &root_cpuacct_cpuusage,
+	.delay		= &root_cpuacct_delay,
 };
 
 /* Create a new CPU accounting group */
@@ -75,8 +91,14 @@ cpuacct_css_alloc(struct cgroup_subsys_state *parent_css)
 	if (!ca->cpustat)
 		goto out_free_cpuusage;
 
+	ca->delay = alloc_percpu(struct cpuacct_delay);
+	if (!ca->delay)
+		goto out_free_cpustat;
+
 	return &ca->css;
 
+out_free_cpustat:
+	free_percpu(ca->cpustat);
 out_free_cpuusage:
 	free_percpu(ca->cpuusage);
 out_free_ca:
@@ -90,6 +112,7 @@ static void cpuacct_css_free(struct cgroup_subsys_state *css)
 {
 	struct cpuacct *ca = css_ca(css);
 
+	free_percpu(ca->delay);
 	free_percpu(ca->cpustat);
 	free_percpu(ca->cpuusage);
 	kfree(ca);
@@ -293,6 +316,58 @@ static int cpuacct_stats_show(struct seq_file *sf, void *v)
 	return 0;
 }
 
+static int cpuacct_sched_delay_show(struct seq_file *sf, void *v)
+{
+	struct cpuacct *ca = css_ca(seq_css(sf));
+	u64 val[CPUACCT_DELAY_BUCKETS];
+	int cpu, i;
+
+	memset(val, 0, sizeof(val));
+	for_each_possible_cpu(cpu) {
+		struct cpuacct_delay *delay = per_cpu_ptr(ca->delay, cpu);
+
+#ifndef CONFIG_64BIT
+		/*
+		 * Take rq->lock to make 64-bit read safe on 32-bit platforms.
+		 */
+		raw_spin_lock_irq(&cpu_rq(cpu)->lock);
+#endif
+		for (i = 0; i < CPUACCT_DELAY_BUCKETS; i++)
+			val[i] += delay->buckets[i];
+#ifndef CONFIG_64BIT
+		raw_spin_unlock_irq(&cpu_rq(cpu)->lock);
+#endif
+	}
+
+	/* One line per bucket: lower bound in us, then the count */
+	for (i = 0; i < CPUACCT_DELAY_BUCKETS; i++)
+		seq_printf(sf, "%lu %llu\n", i ? 1UL << (i - 1) : 0UL, val[i]);
+
+	return 0;
+}
+
+static int cpuacct_sched_delay_write(struct cgroup_subsys_state *css,
+				     struct cftype *cft, u64 val)
+{
+	struct cpuacct *ca = css_ca(css);
+	int cpu;
+
+	/*
+	 * Only allow '0' here to do a reset.
+	 */
+	if (val)
+		return -EINVAL;
+
+	for_each_possible_cpu(cpu) {
+		raw_spin_lock_irq(&cpu_rq(cpu)->lock);
+		memset(per_cpu_ptr(ca->delay, cpu), 0,
+		       sizeof(struct cpuacct_delay));
+		raw_spin_unlock_irq(&cpu_rq(cpu)->lock);
+	}
+
+	return 0;
+}
+
 static struct cftype files[] = {
 	{
 		.name = "usage",
@@ -327,6 +402,11 @@ static struct cftype files[] = {
 		.name = "stat",
 		.seq_show = cpuacct_stats_show,
 	},
+	{
+		.name = "sched_delay_hist",
+		.seq_show = cpuacct_sched_delay_show,
+		.write_u64 = cpuacct_sched_delay_write,
+	},
 	{ }	/* terminate */
 };
 
@@ -367,6 +447,25 @@ void cpuacct_account_field(struct task_struct *tsk, int index, u64 val)
 	rcu_read_unlock();
 }
 
+/*
+ * Account the time a task waited on a runqueue before getting a CPU, to its
+ * accounting group and all of its parents.
+ *
+ * called with rq->lock held, on the CPU the task is about to run on.
+ */
+void cpuacct_sched_delay(struct task_struct *tsk, u64 delay)
+{
+	int bucket = min(fls64(delay >> 10), CPUACCT_DELAY_BUCKETS - 1);
+	struct cpuacct *ca;
+
+	rcu_read_lock();
+
+	for (ca = task_ca(tsk); ca; ca = parent_ca(ca))
+		this_cpu_ptr(ca->delay)->buckets[bucket]++;
+
+	rcu_read_unlock();
+}
+
 struct cgroup_subsys cpuacct_cgrp_subsys = {
 	.css_alloc	= cpuacct_css_alloc,
 	.css_free	= cpuacct_css_free,
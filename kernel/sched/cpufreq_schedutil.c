@@ -45,6 +45,7 @@ struct sugov_policy {
 	bool			work_in_progress;
 
 	bool			need_freq_update;
+	bool			boost_pending;
 };
 
 struct sugov_cpu {
@@ -128,10 +129,14 @@ static bool sugov_up_down_rate_limit(struct sugov_policy *sg_policy, u64 time,
 static bool sugov_update_next_freq(struct sugov_policy *sg_policy, u64 time,
 				   unsigned int next_freq)
 {
+	bool boost = sg_policy->boost_pending;
+
+	sg_policy->boost_pending = false;
+
 	if (sg_policy->next_freq == next_freq)
 		return false;
 
-	if (sugov_up_down_rate_limit(sg_policy, time, next_freq))
+	if (!boost && sugov_up_down_rate_limit(sg_policy, time, next_freq))
 		return false;
 
 	sg_policy->next_freq = next_freq;
@@ -317,6 +322,9 @@ static unsigned long sugov_get_util(struct sugov_cpu *sg_cpu)
 	struct rq *rq = cpu_rq(sg_cpu->cpu);
 	unsigned long util = boosted_cpu_util(sg_cpu->cpu, cpu_util_rt(rq));
 
+	/* Run periodic tasks at the frequency their bursts need from start */
+	util = max(util, cpu_util_periodic_demand(rq));
+
 	sg_cpu->max = arch_scale_cpu_capacity(NULL, sg_cpu->cpu);
 	sg_cpu->bw_dl = cpu_bw_dl(rq);
 
@@ -479,6 +487,20 @@ static inline void ignore_dl_rate_limit(struct sugov_cpu *sg_cpu, struct sugov_p
 		sg_policy->need_freq_update = true;
 }
 
+/*
+ * Make an explicit boost request (e.g. on input events) ignore both the
+ * min and the up/down rate limits: its whole point is to raise the frequency
+ * before the utilization catches up.
+ */
+static inline void ignore_boost_rate_limit(struct sugov_policy *sg_policy,
+					   unsigned int flags)
+{
+	if (flags & SCHED_CPUFREQ_BOOST) {
+		sg_policy->need_freq_update = true;
+		sg_policy->boost_pending = true;
+	}
+}
+
 static void sugov_update_single(struct update_util_data *hook, u64 time,
 				unsigned int flags)
 {
@@ -492,6 +514,7 @@ static void sugov_update_single(struct update_util_data *hook, u64 time,
 	sg_cpu->last_update = time;
 
 	ignore_dl_rate_limit(sg_cpu, sg_policy);
+	ignore_boost_rate_limit(sg_policy, flags);
 
 	if (!sugov_should_update_freq(sg_policy, time))
 		return;
@@ -501,6 +524,7 @@ static void sugov_update_single(struct update_util_data *hook, u64 time,
 	util = sugov_get_util(sg_cpu);
 	max = sg_cpu->max;
 	sugov_iowait_apply(sg_cpu, time, &util, &max);
+	util = schedtune_cpu_util_clamp(sg_cpu->cpu, util, max);
 	next_f = get_next_freq(sg_policy, util, max);
 	/*
 	 * Do not reduce the frequency if the CPU has not been idle
@@ -541,6 +565,7 @@ static unsigned int sugov_next_freq_shared(struct sugov_cpu *sg_cpu, u64 time)
 		j_util = sugov_get_util(j_sg_cpu);
 		j_max = j_sg_cpu->max;
 		sugov_iowait_apply(j_sg_cpu, time, &j_util, &j_max);
+		j_util = schedtune_cpu_util_clamp(j, j_util, j_max);
 
 		if (j_util * max > j_max * util) {
 			util = j_util;
@@ -564,6 +589,7 @@ sugov_update_shared(struct update_util_data *hook, u64 time, unsigned int flags)
 	sg_cpu->last_update = time;
 
 	ignore_dl_rate_limit(sg_cpu, sg_policy);
+	ignore_boost_rate_limit(sg_policy, flags);
 
 	if (sugov_should_update_freq(sg_policy, time)) {
 		next_f = sugov_next_freq_shared(sg_cpu, time);
@@ -3753,6 +3753,79 @@ util_est_dequeue(struct cfs_rq *cfs_rq, struct task_struct *p, bool task_sleep)
 	trace_sched_util_est_task(p, &p->se.avg);
 }
 
+#ifdef CONFIG_SCHED_PERIODIC_DEMAND
+static inline void
+periodic_demand_enqueue(struct cfs_rq *cfs_rq, struct task_struct *p)
+{
+	struct periodic_demand *pd = &p->pdemand;
+
+	if (!pd->enabled || !pd->demand)
+		return;
+
+	pd->enqueued = pd->demand;
+	WRITE_ONCE(cfs_rq->periodic_demand,
+		   cfs_rq->periodic_demand + pd->enqueued);
+}
+
+static void
+periodic_demand_dequeue(struct cfs_rq *cfs_rq, struct task_struct *p,
+			bool task_sleep)
+{
+	struct periodic_demand *pd = &p->pdemand;
+	unsigned short demand = 0;
+	int i;
+
+	if (pd->enqueued) {
+		WRITE_ONCE(cfs_rq->periodic_demand, cfs_rq->periodic_demand -
+			   min_t(unsigned long, cfs_rq->periodic_demand,
+				 pd->enqueued));
+		pd->enqueued = 0;
+	}
+
+	/* Only completed activations are sampled, not migrations */
+	if (!pd->enabled || !task_sleep)
+		return;
+
+	pd->window[pd->next] = task_util(p);
+	pd->next = (pd->next + 1) % PERIODIC_DEMAND_WINDOW;
+
+	for (i = 0; i < PERIODIC_DEMAND_WINDOW; i++)
+		demand = max(demand, pd->window[i]);
+	pd->demand = demand;
+}
+
+/**
+ * sched_set_periodic_demand() - Opt a task in or out of periodic demand
+ * @p:		the task
+ * @enable:	whether @p's windowed max utilization drives frequency
+ *
+ * The window restarts empty, so the estimate builds up over the next
+ * PERIODIC_DEMAND_WINDOW activations. A change applies from the next
+ * enqueue of @p.
+ */
+void sched_set_periodic_demand(struct task_struct *p, bool enable)
+{
+	struct rq_flags rf;
+	struct rq *rq;
+
+	rq = task_rq_lock(p, &rf);
+	if (p->pdemand.enabled != enable) {
+		memset(p->pdemand.window, 0, sizeof(p->pdemand.window));
+		p->pdemand.demand = 0;
+		p->pdemand.next = 0;
+		p->pdemand.enabled = enable;
+	}
+	task_rq_unlock(rq, p, &rf);
+}
+#else
+static inline void
+periodic_demand_enqueue(struct cfs_rq *cfs_rq, struct task_struct *p) {}
+
+static inline void
+periodic_demand_dequeue(struct cfs_rq *cfs_rq, struct task_struct *p,
+			bool task_sleep) {}
+#endif /* CONFIG_SCHED_PERIODIC_DEMAND */
+
 static inline int task_fits_capacity(struct task_struct *p, long capacity)
 {
 	return capacity * 1024 > task_util_est(p) * capacity_margin;
@@ -3805,6 +3878,13 @@ util_est_enqueue(struct cfs_rq *cfs_rq, struct task_struct *p) {}
 static inline void
 util_est_dequeue(struct cfs_rq *cfs_rq, struct task_struct *p,
 		 bool task_sleep) {}
+
+static inline void
+periodic_demand_enqueue(struct cfs_rq *cfs_rq, struct task_struct *p) {}
+
+static inline void
+periodic_demand_dequeue(struct cfs_rq *cfs_rq, struct task_struct *p,
+			bool task_sleep) {}
 static inline void update_misfit_status(struct task_struct *p, struct rq *rq) {}
 
 #endif /* CONFIG_SMP */
@@ -5146,6 +5226,7 @@ enqueue_task_fair(struct rq *rq, struct task_struct *p, int flags)
 	 * estimated utilization, before we update schedutil.
 	 */
 	util_est_enqueue(&rq->cfs, p);
+	periodic_demand_enqueue(&rq->cfs, p);
 
 	/*
 	 * The code below (indirectly) updates schedutil which looks at
@@ -5292,6 +5373,7 @@ static void dequeue_task_fair(struct rq *rq, struct task_struct *p, int flags)
 		sub_nr_running(rq, 1);
 
 	util_est_dequeue(&rq->cfs, p, task_sleep);
+	periodic_demand_dequeue(&rq->cfs, p, task_sleep);
 	hrtick_update(rq);
 }
 
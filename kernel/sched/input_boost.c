@@ -0,0 +1,211 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Input driven CPU frequency boosting
+ *
+ * PELT takes tens of milliseconds to ramp up the utilization of a task woken
+ * by a touch or a key press, so the first frames rendered in response to an
+ * input event run at whatever frequency the CPUs were idling at. This input
+ * handler raises a timed schedtune utilization floor on a configurable set
+ * of CPUs on each input event and kicks schedutil on them right away.
+ *
+ * Tunables live in /sys/module/input_boost/parameters:
+ *  - cpus:		 CPUs to boost (cpulist, defaults to all)
+ *  - util:		 utilization floor, in percent of the CPU capacity
+ *  - duration_ms:	 how long the floor is held after the last event
+ *  - min_interval_ms: minimum time between two boosts, to avoid kicking the
+ *			 CPUs for each event of a burst
+ */
+
+#define pr_fmt(fmt) KBUILD_MODNAME ": " fmt
+
+#include <linux/cpumask.h>
+#include <linux/init.h>
+#include <linux/input.h>
+#include <linux/irq_work.h>
+#include <linux/moduleparam.h>
+#include <linux/slab.h>
+
+#include "sched.h"
+
+static unsigned int input_boost_util = 80;
+module_param_named(util, input_boost_util, uint, 0644);
+
+static unsigned int input_boost_duration_ms = 40;
+module_param_named(duration_ms, input_boost_duration_ms, uint, 0644);
+
+static unsigned int input_boost_min_interval_ms = 10;
+module_param_named(min_interval_ms, input_boost_min_interval_ms, uint, 0644);
+
+static struct cpumask input_boost_cpus;
+
+/* This can be called from the command line parsing, before slab is up */
+static int input_boost_cpus_set(const char *val, const struct kernel_param *kp)
+{
+	static struct cpumask mask;
+	int ret;
+
+	ret = cpulist_parse(val, &mask);
+	if (!ret)
+		cpumask_copy(&input_boost_cpus, &mask);
+
+	return ret;
+}
+
+static int input_boost_cpus_get(char *buf, const struct kernel_param *kp)
+{
+	return cpumap_print_to_pagebuf(true, buf, &input_boost_cpus);
+}
+
+static const struct kernel_param_ops input_boost_cpus_ops = {
+	.set = input_boost_cpus_set,
+	.get = input_boost_cpus_get,
+};
+module_param_cb(cpus, &input_boost_cpus_ops, NULL, 0644);
+
+static DEFINE_PER_CPU(struct irq_work, input_boost_irq_work);
+static DEFINE_SPINLOCK(input_boost_lock);
+static u64 input_boost_last;
+
+/*
+ * Runs on the boosted CPU: re-evaluate its frequency with the new floor in
+ * place, bypassing the schedutil rate limits.
+ */
+static void input_boost_irq_work_fn(struct irq_work *work)
+{
+	struct rq *rq = this_rq();
+	struct rq_flags rf;
+
+	rq_lock(rq, &rf);
+	update_rq_clock(rq);
+	cpufreq_update_util(rq, SCHED_CPUFREQ_BOOST);
+	rq_unlock(rq, &rf);
+}
+
+static void input_boost_event(struct input_handle *handle, unsigned int type,
+			      unsigned int code, int value)
+{
+	unsigned int util = READ_ONCE(input_boost_util);
+	u64 duration_ns, now = local_clock();
+	unsigned long flags;
+	int cpu;
+
+	if (type != EV_KEY && type != EV_ABS && type != EV_REL)
+		return;
+
+	if (!util)
+		return;
+
+	spin_lock_irqsave(&input_boost_lock, flags);
+	if (now - input_boost_last <
+	    (u64)READ_ONCE(input_boost_min_interval_ms) * NSEC_PER_MSEC) {
+		spin_unlock_irqrestore(&input_boost_lock, flags);
+		return;
+	}
+	input_boost_last = now;
+	spin_unlock_irqrestore(&input_boost_lock, flags);
+
+	duration_ns = (u64)READ_ONCE(input_boost_duration_ms) * NSEC_PER_MSEC;
+
+	for_each_cpu_and(cpu, &input_boost_cpus, cpu_online_mask) {
+		schedtune_cpu_util_floor(cpu, min(util, 100U), duration_ns);
+		irq_work_queue_on(&per_cpu(input_boost_irq_work, cpu), cpu);
+	}
+}
+
+static int input_boost_connect(struct input_handler *handler,
+			       struct input_dev *dev,
+			       const struct input_device_id *id)
+{
+	struct input_handle *handle;
+	int error;
+
+	handle = kzalloc(sizeof(struct input_handle), GFP_KERNEL);
+	if (!handle)
+		return -ENOMEM;
+
+	handle->dev = dev;
+	handle->handler = handler;
+	handle->name = "input_boost";
+
+	error = input_register_handle(handle);
+	if (error)
+		goto err_free_handle;
+
+	error = input_open_device(handle);
+	if (error)
+		goto err_unregister_handle;
+
+	return 0;
+
+err_unregister_handle:
+	input_unregister_handle(handle);
+err_free_handle:
+	kfree(handle);
+	return error;
+}
+
+static void input_boost_disconnect(struct input_handle *handle)
+{
+	input_close_device(handle);
+	input_unregister_handle(handle);
+	kfree(handle);
+}
+
+static const struct input_device_id input_boost_ids[] = {
+	/* multi-touch touchscreens */
+	{
+		.flags = INPUT_DEVICE_ID_MATCH_EVBIT |
+			 INPUT_DEVICE_ID_MATCH_ABSBIT,
+		.evbit = { BIT_MASK(EV_ABS) },
+		.absbit = { [BIT_WORD(ABS_MT_POSITION_X)] =
+			    BIT_MASK(ABS_MT_POSITION_X) |
+			    BIT_MASK(ABS_MT_POSITION_Y) },
+	},
+	/* single-touch touchscreens and touchpads */
+	{
+		.flags = INPUT_DEVICE_ID_MATCH_KEYBIT |
+			 INPUT_DEVICE_ID_MATCH_ABSBIT,
+		.keybit = { [BIT_WORD(BTN_TOUCH)] = BIT_MASK(BTN_TOUCH) },
+		.absbit = { [BIT_WORD(ABS_X)] =
+			    BIT_MASK(ABS_X) | BIT_MASK(ABS_Y) },
+	},
+	/* keys and buttons */
+	{
+		.flags = INPUT_DEVICE_ID_MATCH_EVBIT,
+		.evbit = { BIT_MASK(EV_KEY) },
+	},
+	/* rotary knobs */
+	{
+		.flags = INPUT_DEVICE_ID_MATCH_EVBIT,
+		.evbit = { BIT_MASK(EV_REL) },
+	},
+	{ },
+};
+
+static struct input_handler input_boost_handler = {
+	.event		= input_boost_event,
+	.connect	= input_boost_connect,
+	.disconnect	= input_boost_disconnect,
+	.name		= "input_boost",
+	.id_table	= input_boost_ids,
+};
+
+static int __init input_boost_init(void)
+{
+	int cpu, ret;
+
+	for_each_possible_cpu(cpu)
+		init_irq_work(&per_cpu(input_boost_irq_work, cpu),
+			      input_boost_irq_work_fn);
+
+	/* Boost all CPUs unless configured on the command line */
+	if (cpumask_empty(&input_boost_cpus))
+		cpumask_copy(&input_boost_cpus, cpu_possible_mask);
+
+	ret = input_register_handler(&input_boost_handler);
+	if (ret)
+		pr_err("failed to register input handler: %d\n", ret);
+
+	return ret;
+}
+late_initcall(input_boost_init);
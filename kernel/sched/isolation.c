@@ -6,6 +6,12 @@
  * Copyright (C) 2017-2018 SUSE, Frederic Weisbecker
  *
  */
+#include <linux/cpu.h>
+#include <linux/interrupt.h>
+#include <linux/irq.h>
+#include <linux/irqdesc.h>
+#include <linux/irqnr.h>
+
 #include "sched.h"
 
 DEFINE_STATIC_KEY_FALSE(housekeeping_overriden);
@@ -13,37 +19,73 @@ EXPORT_SYMBOL_GPL(housekeeping_overriden);
 static cpumask_var_t housekeeping_mask;
 static unsigned int housekeeping_flags;
 
+#ifdef CONFIG_CPU_ISOLATION_RUNTIME
+/*
+ * Work that can be moved away from a CPU while it is running. The tick,
+ * timers and RCU callbacks can only be offloaded from the command line.
+ */
+#define HK_FLAG_RUNTIME	(HK_FLAG_DOMAIN | HK_FLAG_WQ | HK_FLAG_MISC | \
+			 HK_FLAG_KTHREAD)
+
+static struct cpumask housekeeping_runtime_mask;
+static struct cpumask housekeeping_isolated_mask;
+static unsigned int housekeeping_runtime_flags;
+#endif
+
+static const struct cpumask *__housekeeping_cpumask(enum hk_flags flags)
+{
+#ifdef CONFIG_CPU_ISOLATION_RUNTIME
+	if (READ_ONCE(housekeeping_runtime_flags) & flags)
+		return &housekeeping_runtime_mask;
+#endif
+	if (housekeeping_flags & flags)
+		return housekeeping_mask;
+	return NULL;
+}
+
 int housekeeping_any_cpu(enum hk_flags flags)
 {
-	if (static_branch_unlikely(&housekeeping_overriden))
-		if (housekeeping_flags & flags)
-			return cpumask_any_and(housekeeping_mask, cpu_online_mask);
+	if (static_branch_unlikely(&housekeeping_overriden)) {
+		const struct cpumask *mask = __housekeeping_cpumask(flags);
+
+		if (mask)
+			return cpumask_any_and(mask, cpu_online_mask);
+	}
 	return smp_processor_id();
 }
 EXPORT_SYMBOL_GPL(housekeeping_any_cpu);
 
 const struct cpumask *housekeeping_cpumask(enum hk_flags flags)
 {
-	if (static_branch_unlikely(&housekeeping_overriden))
-		if (housekeeping_flags & flags)
-			return housekeeping_mask;
+	if (static_branch_unlikely(&housekeeping_overriden)) {
+		const struct cpumask *mask = __housekeeping_cpumask(flags);
+
+		if (mask)
+			return mask;
+	}
 	return cpu_possible_mask;
 }
 EXPORT_SYMBOL_GPL(housekeeping_cpumask);
 
 void housekeeping_affine(struct task_struct *t, enum hk_flags flags)
 {
-	if (static_branch_unlikely(&housekeeping_overriden))
-		if (housekeeping_flags & flags)
-			set_cpus_allowed_ptr(t, housekeeping_mask);
+	if (static_branch_unlikely(&housekeeping_overriden)) {
+		const struct cpumask *mask = __housekeeping_cpumask(flags);
+
+		if (mask)
+			set_cpus_allowed_ptr(t, mask);
+	}
 }
 EXPORT_SYMBOL_GPL(housekeeping_affine);
 
 bool housekeeping_test_cpu(int cpu, enum hk_flags flags)
 {
-	if (static_branch_unlikely(&housekeeping_overriden))
-		if (housekeeping_flags & flags)
-			return cpumask_test_cpu(cpu, housekeeping_mask);
+	if (static_branch_unlikely(&housekeeping_overriden)) {
+		const struct cpumask *mask = __housekeeping_cpumask(flags);
+
+		if (mask)
+			return cpumask_test_cpu(cpu, mask);
+	}
 	return true;
 }
 EXPORT_SYMBOL_GPL(housekeeping_test_cpu);
@@ -151,3 +193,192 @@ static int __init housekeeping_isolcpus_setup(char *str)
 	return housekeeping_setup(str, flags);
 }
 __setup("isolcpus=", housekeeping_isolcpus_setup);
+
+#ifdef CONFIG_CPU_ISOLATION_RUNTIME
+static DEFINE_MUTEX(housekeeping_runtime_mutex);
+
+/*
+ * Restrict the kthreads that may run on an isolated CPU to the housekeeping
+ * ones. Per-CPU kthreads are bound with PF_NO_SETAFFINITY and kthreads only
+ * allowed on isolated CPUs were placed there on purpose: leave them alone.
+ */
+static void housekeeping_move_kthreads(const struct cpumask *hk,
+				       const struct cpumask *isolated,
+				       struct cpumask *tmp)
+{
+	struct task_struct **tasks, *p;
+	int nr = 0, max, i;
+
+	max = READ_ONCE(nr_threads);
+	tasks = kvmalloc_array(max, sizeof(*tasks), GFP_KERNEL);
+	if (!tasks)
+		return;
+
+	rcu_read_lock();
+	for_each_process(p) {
+		if (nr >= max)
+			break;
+		if (!(p->flags & PF_KTHREAD) || (p->flags & PF_NO_SETAFFINITY))
+			continue;
+		if (!cpumask_intersects(&p->cpus_allowed, isolated) ||
+		    !cpumask_intersects(&p->cpus_allowed, hk))
+			continue;
+		get_task_struct(p);
+		tasks[nr++] = p;
+	}
+	rcu_read_unlock();
+
+	for (i = 0; i < nr; i++) {
+		if (cpumask_and(tmp, &tasks[i]->cpus_allowed, hk))
+			set_cpus_allowed_ptr(tasks[i], tmp);
+		put_task_struct(tasks[i]);
+	}
+
+	kvfree(tasks);
+}
+
+/*
+ * Same for the interrupts that are not managed by the kernel, which is what
+ * writing /proc/irq/<irq>/smp_affinity would do. New interrupts default to
+ * the housekeeping CPUs; CPUs released from the partition are given back
+ * to them.
+ */
+static void housekeeping_move_irqs(const struct cpumask *hk,
+				   const struct cpumask *isolated,
+				   const struct cpumask *released,
+				   struct cpumask *tmp)
+{
+	struct irq_desc *desc;
+	unsigned int irq;
+
+	cpumask_or(tmp, irq_default_affinity, released);
+	if (cpumask_andnot(tmp, tmp, isolated))
+		cpumask_copy(irq_default_affinity, tmp);
+
+	irq_lock_sparse();
+	for_each_irq_desc(irq, desc) {
+		struct irq_data *data = irq_desc_get_irq_data(desc);
+		const struct cpumask *affinity;
+
+		if (irqd_affinity_is_managed(data) ||
+		    !irq_can_set_affinity(irq))
+			continue;
+
+		affinity = irq_data_get_affinity_mask(data);
+		if (!cpumask_intersects(affinity, isolated) ||
+		    !cpumask_and(tmp, affinity, hk))
+			continue;
+
+		irq_set_affinity(irq, tmp);
+	}
+	irq_unlock_sparse();
+}
+
+/**
+ * housekeeping_isolate - change the runtime isolated CPUs
+ * @isolated: CPUs to isolate, empty to end the isolation
+ *
+ * Move unbound workqueues, kthreads and interrupts to the other CPUs and
+ * rebuild the scheduler domains without @isolated. CPUs isolated on the
+ * command line stay isolated. Tasks are then expected to be placed on the
+ * isolated CPUs through a cpuset, which should have load balancing
+ * disabled.
+ *
+ * Return: 0 on success, -EINVAL if no online housekeeping CPU would be left
+ * or -ENOMEM.
+ */
+int housekeeping_isolate(const struct cpumask *isolated)
+{
+	const struct cpumask *base;
+	cpumask_var_t hk, released, tmp;
+	int ret = -ENOMEM;
+
+	if (!alloc_cpumask_var(&hk, GFP_KERNEL))
+		return ret;
+	if (!alloc_cpumask_var(&released, GFP_KERNEL))
+		goto free_hk;
+	if (!alloc_cpumask_var(&tmp, GFP_KERNEL))
+		goto free_released;
+
+	base = housekeeping_flags ? housekeeping_mask : cpu_possible_mask;
+	cpumask_andnot(hk, base, isolated);
+
+	mutex_lock(&housekeeping_runtime_mutex);
+
+	ret = -EINVAL;
+	if (!cpumask_intersects(hk, cpu_online_mask))
+		goto unlock;
+
+	cpumask_andnot(released, &housekeeping_isolated_mask, isolated);
+
+	/*
+	 * Readers don't serialize against this update: they may briefly
+	 * see a mix of the old and new masks, which is harmless for work
+	 * placement.
+	 */
+	cpumask_copy(&housekeeping_runtime_mask, hk);
+	cpumask_copy(&housekeeping_isolated_mask, isolated);
+	WRITE_ONCE(housekeeping_runtime_flags,
+		   cpumask_empty(isolated) ? 0 : HK_FLAG_RUNTIME);
+	if (!static_key_enabled(&housekeeping_overriden))
+		static_branch_enable(&housekeeping_overriden);
+
+	/* This clobbers any mask set through the workqueue sysfs file */
+	cpumask_copy(tmp, housekeeping_cpumask(HK_FLAG_WQ));
+	ret = workqueue_set_unbound_cpumask(tmp);
+	if (ret)
+		pr_warn("Housekeeping: failed to update unbound workqueues: %d\n",
+			ret);
+
+	housekeeping_move_kthreads(hk, isolated, tmp);
+	housekeeping_move_irqs(hk, isolated, released, tmp);
+
+	rebuild_sched_domains();
+	ret = 0;
+
+unlock:
+	mutex_unlock(&housekeeping_runtime_mutex);
+	free_cpumask_var(tmp);
+free_released:
+	free_cpumask_var(released);
+free_hk:
+	free_cpumask_var(hk);
+	return ret;
+}
+
+static ssize_t isolated_runtime_show(struct device *dev,
+				     struct device_attribute *attr, char *buf)
+{
+	return scnprintf(buf, PAGE_SIZE, "%*pbl\n",
+			 cpumask_pr_args(&housekeeping_isolated_mask));
+}
+
+static ssize_t isolated_runtime_store(struct device *dev,
+				      struct device_attribute *attr,
+				      const char *buf, size_t count)
+{
+	cpumask_var_t isolated;
+	int ret;
+
+	if (!alloc_cpumask_var(&isolated, GFP_KERNEL))
+		return -ENOMEM;
+
+	ret = cpulist_parse(buf, isolated);
+	if (!ret && !cpumask_subset(isolated, cpu_possible_mask))
+		ret = -EINVAL;
+	if (!ret)
+		ret = housekeeping_isolate(isolated);
+
+	free_cpumask_var(isolated);
+	return ret ? ret : count;
+}
+
+static DEVICE_ATTR_RW(isolated_runtime);
+
+static int __init housekeeping_runtime_init(void)
+{
+	return device_create_file(cpu_subsys.dev_root,
+				  &dev_attr_isolated_runtime);
+}
+late_initcall(housekeeping_runtime_init);
+#endif /* CONFIG_CPU_ISOLATION_RUNTIME */
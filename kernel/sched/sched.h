@@ -520,6 +520,10 @@ struct cfs_rq {
 		unsigned long	util_avg;
 		unsigned long	runnable_sum;
 	} removed;
+#ifdef CONFIG_SCHED_PERIODIC_DEMAND
+	/* Sum of the periodic demand of the enqueued tasks, root cfs_rq only */
+	unsigned long		periodic_demand;
+#endif
 
 #ifdef CONFIG_FAIR_GROUP_SCHED
 	unsigned long		tg_load_avg_contrib;
@@ -2278,6 +2282,18 @@ static inline unsigned long cpu_util_rt(struct rq *rq)
 {
 	return READ_ONCE(rq->avg_rt.util_avg);
 }
+
+#ifdef CONFIG_SCHED_PERIODIC_DEMAND
+static inline unsigned long cpu_util_periodic_demand(struct rq *rq)
+{
+	return READ_ONCE(rq->cfs.periodic_demand);
+}
+#else
+static inline unsigned long cpu_util_periodic_demand(struct rq *rq)
+{
+	return 0;
+}
+#endif
 #endif
 
 #ifdef HAVE_SCHED_AVG_IRQ
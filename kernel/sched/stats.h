@@ -97,6 +97,8 @@ static void sched_info_arrive(struct rq *rq, struct task_struct *t)
 	t->sched_info.pcount++;
 
 	rq_sched_info_arrive(rq, delta);
+	if (delta)
+		cpuacct_sched_delay(t, delta);
 }
 
 /*
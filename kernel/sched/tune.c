@@ -36,8 +36,13 @@ extern struct reciprocal_value schedtune_spc_rdiv;
  *
  * .:: Locking strategy
  *
- * The fast path uses a spin lock for each CPU boost_group which protects the
- * tasks counter.
+ * The fast path runs with the CPU's RQ lock held, which serializes all the
+ * updates of the tasks counters and of the per-CPU aggregates, so it does not
+ * take any lock of its own. It is also O(1): a boost group activation only
+ * raises the per-CPU aggregates, while a deactivation recomputes them, by
+ * walking the bitmap of active groups, only when the leaving group was the
+ * one defining them. boost_max is otherwise refreshed lazily once its hold
+ * time expires, see schedtune_cpu_boost().
  *
  * The "valid" and "boost" values of each CPU boost_group is instead
  * protected by the RCU lock provided by the CGroups callbacks. Thus, only the
@@ -54,7 +59,7 @@ extern struct reciprocal_value schedtune_spc_rdiv;
  *                                                        |     +--------------+----+---+----+----+
  *                                                        |     |  idle        |    |   |    |    |
  *                                                        |     |  boost_max   |    |   |    |    |
- *                                                        |  +---->lock        |    |   |    |    |
+ *                                                        |  |   active       |    |   |    |    |
  *  struct schedtune                  allocated_groups    |  |  |  group[    ] |    |   |    |    |
  *  +------------------------------+         +-------+    |  |  +--+---------+-+----+---+----+----+
  *  | idx                          |         |       |    |  |     |  valid  |
@@ -92,6 +97,11 @@ struct schedtune {
 	/* Hint to bias scheduling of tasks on that SchedTune CGroup
 	 * towards idle CPUs */
 	int prefer_idle;
+
+	/* Utilization clamps, in percent of CPU capacity, applied to the
+	 * frequency selection of CPUs running tasks of that CGroup */
+	int util_min;
+	int util_max;
 };
 
 static inline struct schedtune *css_st(struct cgroup_subsys_state *css)
@@ -122,6 +132,8 @@ static struct schedtune
 root_schedtune = {
 	.boost	= 0,
 	.prefer_idle = 0,
+	.util_min = 0,
+	.util_max = 100,
 };
 
 /*
@@ -155,18 +167,27 @@ struct boost_groups {
 	/* Maximum boost value for all RUNNABLE tasks on a CPU */
 	int boost_max;
 	u64 boost_ts;
+	/* Utilization clamps aggregated on all RUNNABLE tasks on a CPU */
+	int util_min;
+	int util_max;
+	/* Timed utilization floor and its expiration time */
+	int floor_min;
+	u64 floor_expires;
 	struct {
 		/* True when this boost group maps an actual cgroup */
 		bool valid;
 		/* The boost for tasks on that boost group */
 		int boost;
+		/* The utilization clamps for tasks on that boost group */
+		int util_min;
+		int util_max;
 		/* Count of RUNNABLE tasks on that boost group */
 		unsigned tasks;
 		/* Timestamp of boost activation */
 		u64 ts;
 	} group[BOOSTGROUPS_COUNT];
-	/* CPU's boost group locking */
-	raw_spinlock_t lock;
+	/* Bitmap of the boost groups with RUNNABLE tasks on a CPU */
+	unsigned long active;
 };
 
 /* Boost groups affecting each CPU in the system */
@@ -227,6 +248,90 @@ schedtune_cpu_update(int cpu, u64 now)
 	bg->boost_ts = boost_ts;
 }
 
+/*
+ * The clamps of a CPU are the most permissive ones among the boost groups
+ * with RUNNABLE tasks on it: a CPU is capped only when all of its tasks are
+ * capped, and floored as soon as one of them asks for it. Unlike boosting,
+ * clamps have no hold time and follow the RUNNABLE tasks only.
+ *
+ * Must be called with the CPU's boost group lock held.
+ */
+static void
+schedtune_cpu_clamp_update(int cpu)
+{
+	struct boost_groups *bg = &per_cpu(cpu_boost_groups, cpu);
+	int util_min = 0, util_max = 0;
+	int idx;
+
+	for_each_set_bit(idx, &bg->active, BOOSTGROUPS_COUNT) {
+		util_min = max(util_min, bg->group[idx].util_min);
+		util_max = max(util_max, bg->group[idx].util_max);
+	}
+
+	WRITE_ONCE(bg->util_min, util_min);
+	WRITE_ONCE(bg->util_max, bg->active ? util_max : 100);
+}
+
+/*
+ * A boost group got its first RUNNABLE task on a CPU: it can only raise the
+ * CPU's aggregates.
+ */
+static inline void
+schedtune_group_activate(struct boost_groups *bg, int idx)
+{
+	int util_max = bg->group[idx].util_max;
+
+	if (bg->active)
+		util_max = max(util_max, bg->util_max);
+	__set_bit(idx, &bg->active);
+
+	if (bg->group[idx].boost >= bg->boost_max) {
+		bg->boost_max = bg->group[idx].boost;
+		bg->boost_ts = bg->group[idx].ts;
+	}
+
+	WRITE_ONCE(bg->util_min, max(bg->util_min, bg->group[idx].util_min));
+	WRITE_ONCE(bg->util_max, util_max);
+}
+
+/*
+ * A boost group lost its last RUNNABLE task on a CPU: the clamps need a
+ * recompute only if that group was defining one of them. boost_max is kept
+ * until its hold time expires.
+ */
+static inline void
+schedtune_group_deactivate(struct boost_groups *bg, int idx, int cpu)
+{
+	int util_min = bg->group[idx].util_min;
+
+	__clear_bit(idx, &bg->active);
+
+	if (!bg->active || (util_min && util_min == bg->util_min) ||
+	    bg->group[idx].util_max == bg->util_max)
+		schedtune_cpu_clamp_update(cpu);
+}
+
+static void
+schedtune_boostgroup_clamp_update(int idx, int util_min, int util_max)
+{
+	struct boost_groups *bg;
+	struct rq_flags rf;
+	struct rq *rq;
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		bg = &per_cpu(cpu_boost_groups, cpu);
+		rq = cpu_rq(cpu);
+
+		/* Serialize with the fast path */
+		rq_lock_irqsave(rq, &rf);
+		bg->group[idx].util_min = util_min;
+		bg->group[idx].util_max = util_max;
+		schedtune_cpu_clamp_update(cpu);
+		rq_unlock_irqrestore(rq, &rf);
+	}
+}
+
 static int
 schedtune_boostgroup_update(int idx, int boost)
 {
@@ -301,14 +406,16 @@ schedtune_tasks_update(struct task_struct *p, int cpu, int idx, int task_count)
 
 	/* Update timeout on enqueue */
 	if (task_count > 0) {
-		u64 now = sched_clock_cpu(cpu);
-
 		if (schedtune_update_timestamp(p))
-			bg->group[idx].ts = now;
+			bg->group[idx].ts = sched_clock_cpu(cpu);
 
-		/* Boost group activation or deactivation on that RQ */
+		/* Boost group activation on that RQ */
 		if (bg->group[idx].tasks == 1)
-			schedtune_cpu_update(cpu, now);
+			schedtune_group_activate(bg, idx);
+	} else if (!bg->group[idx].tasks &&
+		   test_bit(idx, &bg->active)) {
+		/* Boost group deactivation on that RQ */
+		schedtune_group_deactivate(bg, idx, cpu);
 	}
 
 	trace_sched_tune_tasks_update(p, cpu, tasks, idx,
@@ -321,8 +428,6 @@ schedtune_tasks_update(struct task_struct *p, int cpu, int idx, int task_count)
  */
 void schedtune_enqueue_task(struct task_struct *p, int cpu)
 {
-	struct boost_groups *bg = &per_cpu(cpu_boost_groups, cpu);
-	unsigned long irq_flags;
 	struct schedtune *st;
 	int idx;
 
@@ -330,11 +435,10 @@ void schedtune_enqueue_task(struct task_struct *p, int cpu)
 		return;
 
 	/*
-	 * Boost group accouting is protected by a per-cpu lock and requires
-	 * interrupt to be disabled to avoid race conditions for example on
-	 * do_exit()::cgroup_exit() and task migration.
+	 * Boost group accounting is serialized by the RQ lock, which also
+	 * keeps do_exit()::cgroup_exit() and task migration away.
 	 */
-	raw_spin_lock_irqsave(&bg->lock, irq_flags);
+	lockdep_assert_held(&cpu_rq(cpu)->lock);
 	rcu_read_lock();
 
 	st = task_schedtune(p);
@@ -343,7 +447,6 @@ void schedtune_enqueue_task(struct task_struct *p, int cpu)
 	schedtune_tasks_update(p, cpu, idx, ENQUEUE_TASK);
 
 	rcu_read_unlock();
-	raw_spin_unlock_irqrestore(&bg->lock, irq_flags);
 }
 
 int schedtune_can_attach(struct cgroup_taskset *tset)
@@ -377,13 +480,9 @@ int schedtune_can_attach(struct cgroup_taskset *tset)
 			continue;
 		}
 
-		/*
-		 * Boost group accouting is protected by a per-cpu lock and requires
-		 * interrupt to be disabled to avoid race conditions on...
-		 */
+		/* Boost group accounting is serialized by the RQ lock */
 		cpu = cpu_of(rq);
 		bg = &per_cpu(cpu_boost_groups, cpu);
-		raw_spin_lock(&bg->lock);
 
 		dst_bg = css_st(css)->idx;
 		src_bg = task_schedtune(task)->idx;
@@ -393,7 +492,6 @@ int schedtune_can_attach(struct cgroup_taskset *tset)
 		 * happen when the new hierarchy is in use.
 		 */
 		if (unlikely(dst_bg == src_bg)) {
-			raw_spin_unlock(&bg->lock);
 			task_rq_unlock(rq, task, &rq_flags);
 			continue;
 		}
@@ -407,6 +505,9 @@ int schedtune_can_attach(struct cgroup_taskset *tset)
 		tasks = bg->group[src_bg].tasks - 1;
 		bg->group[src_bg].tasks = max(0, tasks);
 		bg->group[dst_bg].tasks += 1;
+		if (!bg->group[src_bg].tasks)
+			__clear_bit(src_bg, &bg->active);
+		__set_bit(dst_bg, &bg->active);
 
 		/* Update boost hold start for this group */
 		now = sched_clock_cpu(cpu);
@@ -415,7 +516,8 @@ int schedtune_can_attach(struct cgroup_taskset *tset)
 		/* Force boost group re-evaluation at next boost check */
 		bg->boost_ts = now - SCHEDTUNE_BOOST_HOLD_NS;
 
-		raw_spin_unlock(&bg->lock);
+		schedtune_cpu_clamp_update(cpu);
+
 		task_rq_unlock(rq, task, &rq_flags);
 	}
 
@@ -436,8 +538,6 @@ void schedtune_cancel_attach(struct cgroup_taskset *tset)
  */
 void schedtune_dequeue_task(struct task_struct *p, int cpu)
 {
-	struct boost_groups *bg = &per_cpu(cpu_boost_groups, cpu);
-	unsigned long irq_flags;
 	struct schedtune *st;
 	int idx;
 
@@ -445,10 +545,10 @@ void schedtune_dequeue_task(struct task_struct *p, int cpu)
 		return;
 
 	/*
-	 * Boost group accouting is protected by a per-cpu lock and requires
-	 * interrupt to be disabled to avoid race conditions on...
+	 * Boost group accounting is serialized by the RQ lock, which also
+	 * keeps do_exit()::cgroup_exit() and task migration away.
 	 */
-	raw_spin_lock_irqsave(&bg->lock, irq_flags);
+	lockdep_assert_held(&cpu_rq(cpu)->lock);
 	rcu_read_lock();
 
 	st = task_schedtune(p);
@@ -457,7 +557,6 @@ void schedtune_dequeue_task(struct task_struct *p, int cpu)
 	schedtune_tasks_update(p, cpu, idx, DEQUEUE_TASK);
 
 	rcu_read_unlock();
-	raw_spin_unlock_irqrestore(&bg->lock, irq_flags);
 }
 
 int schedtune_cpu_boost(int cpu)
@@ -475,6 +574,60 @@ int schedtune_cpu_boost(int cpu)
 	return bg->boost_max;
 }
 
+/**
+ * schedtune_cpu_util_clamp() - Clamp a CPU utilization for frequency selection
+ * @cpu:	the CPU the utilization refers to
+ * @util:	the utilization to clamp
+ * @max:	the capacity of @cpu
+ *
+ * Return: @util clamped within the utilization clamps of the boost groups
+ * currently RUNNABLE on @cpu. When the floor is above the cap, the floor
+ * wins so that latency sensitive tasks are never starved by a co-scheduled
+ * background task.
+ */
+unsigned long schedtune_cpu_util_clamp(int cpu, unsigned long util,
+				       unsigned long max)
+{
+	struct boost_groups *bg = &per_cpu(cpu_boost_groups, cpu);
+	unsigned long util_min, util_max;
+	int min_pct, floor_pct;
+
+	if (unlikely(!schedtune_initialized))
+		return util;
+
+	min_pct = READ_ONCE(bg->util_min);
+	floor_pct = READ_ONCE(bg->floor_min);
+	if (floor_pct > min_pct &&
+	    sched_clock_cpu(cpu) < READ_ONCE(bg->floor_expires))
+		min_pct = floor_pct;
+
+	util_min = max * min_pct / 100;
+	util_max = max * READ_ONCE(bg->util_max) / 100;
+
+	if (util_min >= util_max)
+		return util_min;
+
+	return clamp(util, util_min, util_max);
+}
+
+/**
+ * schedtune_cpu_util_floor() - Set a timed utilization floor on a CPU
+ * @cpu:		the CPU to boost
+ * @util_min:		the floor, in percent of the capacity of @cpu
+ * @duration_ns:	how long the floor is held from now
+ *
+ * The floor is applied on top of the boost groups clamps by
+ * schedtune_cpu_util_clamp() until it expires, regardless of the tasks
+ * RUNNABLE on @cpu. A new floor replaces the previous one.
+ */
+void schedtune_cpu_util_floor(int cpu, int util_min, u64 duration_ns)
+{
+	struct boost_groups *bg = &per_cpu(cpu_boost_groups, cpu);
+
+	WRITE_ONCE(bg->floor_expires, sched_clock_cpu(cpu) + duration_ns);
+	WRITE_ONCE(bg->floor_min, util_min);
+}
+
 int schedtune_task_boost(struct task_struct *p)
 {
 	struct schedtune *st;
@@ -552,6 +705,56 @@ boost_write(struct cgroup_subsys_state *css, struct cftype *cft,
 	return 0;
 }
 
+static s64
+util_min_read(struct cgroup_subsys_state *css, struct cftype *cft)
+{
+	struct schedtune *st = css_st(css);
+
+	return st->util_min;
+}
+
+static int
+util_min_write(struct cgroup_subsys_state *css, struct cftype *cft,
+	       s64 util_min)
+{
+	struct schedtune *st = css_st(css);
+
+	if (util_min < 0 || util_min > st->util_max)
+		return -EINVAL;
+
+	st->util_min = util_min;
+
+	/* Update CPU clamps */
+	schedtune_boostgroup_clamp_update(st->idx, st->util_min, st->util_max);
+
+	return 0;
+}
+
+static s64
+util_max_read(struct cgroup_subsys_state *css, struct cftype *cft)
+{
+	struct schedtune *st = css_st(css);
+
+	return st->util_max;
+}
+
+static int
+util_max_write(struct cgroup_subsys_state *css, struct cftype *cft,
+	       s64 util_max)
+{
+	struct schedtune *st = css_st(css);
+
+	if (util_max < st->util_min || util_max > 100)
+		return -EINVAL;
+
+	st->util_max = util_max;
+
+	/* Update CPU clamps */
+	schedtune_boostgroup_clamp_update(st->idx, st->util_min, st->util_max);
+
+	return 0;
+}
+
 static struct cftype files[] = {
 	{
 		.name = "boost",
@@ -563,6 +766,16 @@ static struct cftype files[] = {
 		.read_u64 = prefer_idle_read,
 		.write_u64 = prefer_idle_write,
 	},
+	{
+		.name = "util_min",
+		.read_s64 = util_min_read,
+		.write_s64 = util_min_write,
+	},
+	{
+		.name = "util_max",
+		.read_s64 = util_max_read,
+		.write_s64 = util_max_write,
+	},
 	{ }	/* terminate */
 };
 
@@ -576,6 +789,8 @@ schedtune_boostgroup_init(struct schedtune *st, int idx)
 	for_each_possible_cpu(cpu) {
 		bg = &per_cpu(cpu_boost_groups, cpu);
 		bg->group[idx].boost = 0;
+		bg->group[idx].util_min = 0;
+		bg->group[idx].util_max = 100;
 		bg->group[idx].valid = true;
 		bg->group[idx].ts = 0;
 	}
@@ -583,6 +798,8 @@ schedtune_boostgroup_init(struct schedtune *st, int idx)
 	/* Keep track of allocated boost groups */
 	allocated_group[idx] = st;
 	st->idx = idx;
+	st->util_min = 0;
+	st->util_max = 100;
 }
 
 static struct cgroup_subsys_state *
@@ -627,13 +844,24 @@ static void
 schedtune_boostgroup_release(struct schedtune *st)
 {
 	struct boost_groups *bg;
+	struct rq_flags rf;
+	struct rq *rq;
 	int cpu;
 
 	/* Reset per CPUs boost group support */
 	for_each_possible_cpu(cpu) {
 		bg = &per_cpu(cpu_boost_groups, cpu);
+		rq = cpu_rq(cpu);
+
+		/* Serialize with the fast path, which sets the active bits */
+		rq_lock_irqsave(rq, &rf);
 		bg->group[st->idx].valid = false;
 		bg->group[st->idx].boost = 0;
+		__clear_bit(st->idx, &bg->active);
+		bg->group[st->idx].util_min = 0;
+		bg->group[st->idx].util_max = 100;
+		schedtune_cpu_clamp_update(cpu);
+		rq_unlock_irqrestore(rq, &rf);
 	}
 
 	/* Keep track of allocated boost groups */
@@ -669,8 +897,9 @@ schedtune_init_cgroups(void)
 	for_each_possible_cpu(cpu) {
 		bg = &per_cpu(cpu_boost_groups, cpu);
 		memset(bg, 0, sizeof(struct boost_groups));
+		bg->util_max = 100;
 		bg->group[0].valid = true;
-		raw_spin_lock_init(&bg->lock);
+		bg->group[0].util_max = 100;
 	}
 
 	pr_info("schedtune: configured to support %d boost groups\n",
@@ -17,6 +17,10 @@ int schedtune_task_boost(struct task_struct *tsk);
 
 int schedtune_prefer_idle(struct task_struct *tsk);
 
+unsigned long schedtune_cpu_util_clamp(int cpu, unsigned long util,
+				       unsigned long max);
+void schedtune_cpu_util_floor(int cpu, int util_min, u64 duration_ns);
+
 void schedtune_enqueue_task(struct task_struct *p, int cpu);
 void schedtune_dequeue_task(struct task_struct *p, int cpu);
 
@@ -29,6 +33,9 @@ unsigned long boosted_cpu_util(int cpu, unsigned long other_util);
 
 #define schedtune_prefer_idle(tsk) 0
 
+#define schedtune_cpu_util_clamp(cpu, util, max) (util)
+#define schedtune_cpu_util_floor(cpu, util_min, duration_ns) do { } while (0)
+
 #define schedtune_enqueue_task(task, cpu) do { } while (0)
 #define schedtune_dequeue_task(task, cpu) do { } while (0)
 
@@ -25,6 +25,9 @@
 #include <linux/cpu.h>
 #include <linux/oom.h>
 
+#include <uapi/linux/trace_mmap.h>
+
+#include <asm/cacheflush.h>
 #include <asm/local.h>
 
 static void update_pages_handler(struct work_struct *work);
@@ -330,6 +333,7 @@ struct buffer_page {
 	unsigned	 read;		/* index for next read */
 	local_t		 entries;	/* entries on this page */
 	unsigned long	 real_end;	/* real end of data */
+	unsigned	 id;		/* ID for external mapping */
 	struct buffer_data_page *page;	/* Actual data page */
 };
 
@@ -498,6 +502,12 @@ struct ring_buffer_per_cpu {
 	struct completion		update_done;
 
 	struct rb_irq_work		irq_work;
+
+	/* user space mapping, see ring_buffer_map() */
+	struct mutex			mapping_lock;
+	unsigned int			mapped;
+	struct trace_buffer_meta	*meta_page;
+	unsigned long			*subbuf_ids;	/* ID to data page */
 };
 
 struct ring_buffer {
@@ -1280,6 +1290,7 @@ rb_allocate_cpu_buffer(struct ring_buffer *buffer, long nr_pages, int cpu)
 	init_irq_work(&cpu_buffer->irq_work.work, rb_wake_up_waiters);
 	init_waitqueue_head(&cpu_buffer->irq_work.waiters);
 	init_waitqueue_head(&cpu_buffer->irq_work.full_waiters);
+	mutex_init(&cpu_buffer->mapping_lock);
 
 	bpage = kzalloc_node(ALIGN(sizeof(*bpage), cache_line_size()),
 			    GFP_KERNEL, cpu_to_node(cpu));
@@ -1724,6 +1735,15 @@ int ring_buffer_resize(struct ring_buffer *buffer, unsigned long size,
 	/* prevent another thread from changing buffer sizes */
 	mutex_lock(&buffer->mutex);
 
+	/* User space expects the pages it mapped to stay in the buffer */
+	for_each_buffer_cpu(buffer, cpu) {
+		if ((cpu_id == RING_BUFFER_ALL_CPUS || cpu == cpu_id) &&
+		    buffer->buffers[cpu]->mapped) {
+			err = -EBUSY;
+			goto out_err;
+		}
+	}
+
 	if (cpu_id == RING_BUFFER_ALL_CPUS) {
 		/* calculate the pages to update */
 		for_each_buffer_cpu(buffer, cpu) {
@@ -3628,6 +3648,23 @@ rb_update_iter_read_stamp(struct ring_buffer_iter *iter,
 	return;
 }
 
+static void rb_update_meta_page(struct ring_buffer_per_cpu *cpu_buffer)
+{
+	struct trace_buffer_meta *meta = cpu_buffer->meta_page;
+
+	if (!meta)
+		return;
+
+	meta->reader.id = cpu_buffer->reader_page->id;
+	meta->reader.read = cpu_buffer->reader_page->read;
+	meta->entries = local_read(&cpu_buffer->entries);
+	meta->overrun = local_read(&cpu_buffer->overrun);
+	meta->read = cpu_buffer->read;
+
+	/* Some architectures have aliasing data caches */
+	flush_dcache_page(virt_to_page(meta));
+}
+
 static struct buffer_page *
 rb_get_reader_page(struct ring_buffer_per_cpu *cpu_buffer)
 {
@@ -3748,6 +3785,9 @@ rb_get_reader_page(struct ring_buffer_per_cpu *cpu_buffer)
 		cpu_buffer->last_overrun = overwrite;
 	}
 
+	/* Don't leave a mapping reader looking at a page back in the ring */
+	rb_update_meta_page(cpu_buffer);
+
 	goto again;
 
  out:
@@ -4373,6 +4413,7 @@ void ring_buffer_reset_cpu(struct ring_buffer *buffer, int cpu)
 	arch_spin_lock(&cpu_buffer->lock);
 
 	rb_reset_cpu(cpu_buffer);
+	rb_update_meta_page(cpu_buffer);
 
 	arch_spin_unlock(&cpu_buffer->lock);
 
@@ -4481,6 +4522,11 @@ int ring_buffer_swap_cpu(struct ring_buffer *buffer_a,
 	if (cpu_buffer_a->nr_pages != cpu_buffer_b->nr_pages)
 		goto out;
 
+	/* User space keeps reading the pages it has mapped */
+	ret = -EBUSY;
+	if (READ_ONCE(cpu_buffer_a->mapped) || READ_ONCE(cpu_buffer_b->mapped))
+		goto out;
+
 	ret = -EAGAIN;
 
 	if (atomic_read(&buffer_a->record_disabled))
@@ -4702,17 +4748,23 @@ int ring_buffer_read_page(struct ring_buffer *buffer,
 	 * if len is not big enough to read the rest of the page or
 	 * a writer is still on the page, then
 	 * we must copy the data from the page to the buffer.
-	 * Otherwise, we can simply swap the page with the one passed in.
+	 * Otherwise, we can simply swap the page with the one passed in,
+	 * unless it is mapped to user space.
 	 */
 	if (read || (len < (commit - read)) ||
-	    cpu_buffer->reader_page == cpu_buffer->commit_page) {
+	    cpu_buffer->reader_page == cpu_buffer->commit_page ||
+	    cpu_buffer->mapped) {
 		struct buffer_data_page *rpage = cpu_buffer->reader_page->page;
 		unsigned int rpos = read;
 		unsigned int pos = 0;
 		unsigned int size;
 
-		if (full)
+		/* The pages of a mapped buffer can not be swapped out */
+		if (full) {
+			if (cpu_buffer->mapped)
+				ret = -EBUSY;
 			goto out_unlock;
+		}
 
 		if (len > (commit - read))
 			len = (commit - read);
@@ -4814,6 +4866,276 @@ int ring_buffer_read_page(struct ring_buffer *buffer,
 }
 EXPORT_SYMBOL_GPL(ring_buffer_read_page);
 
+/*
+ * The data pages of a mapped buffer are given IDs: the reader page is 0
+ * and the others follow in ring order, starting from the head page. A
+ * page keeps its ID as it moves in and out of the ring.
+ */
+static void rb_setup_ids_meta_page(struct ring_buffer_per_cpu *cpu_buffer,
+				   unsigned long *subbuf_ids)
+{
+	struct trace_buffer_meta *meta = cpu_buffer->meta_page;
+	unsigned int nr_subbufs = cpu_buffer->nr_pages + 1;
+	struct buffer_page *first_subbuf, *subbuf;
+	unsigned int id = 0;
+
+	subbuf_ids[id] = (unsigned long)cpu_buffer->reader_page->page;
+	cpu_buffer->reader_page->id = id++;
+
+	first_subbuf = subbuf = rb_set_head_page(cpu_buffer);
+	while (subbuf) {
+		if (RB_WARN_ON(cpu_buffer, id >= nr_subbufs))
+			break;
+
+		subbuf_ids[id] = (unsigned long)subbuf->page;
+		subbuf->id = id++;
+
+		rb_inc_page(cpu_buffer, &subbuf);
+		if (subbuf == first_subbuf)
+			break;
+	}
+
+	cpu_buffer->subbuf_ids = subbuf_ids;
+
+	meta->meta_page_size = PAGE_SIZE;
+	meta->meta_struct_len = sizeof(*meta);
+	meta->subbuf_size = PAGE_SIZE;
+	meta->nr_subbufs = nr_subbufs;
+
+	rb_update_meta_page(cpu_buffer);
+}
+
+/* The meta page is at offset 0, sub-buffer N at page N + 1 */
+static int rb_map_vma(struct ring_buffer_per_cpu *cpu_buffer,
+		      struct vm_area_struct *vma)
+{
+	unsigned long nr_subbufs = cpu_buffer->nr_pages + 1;
+	unsigned long nr_pages = vma_pages(vma);
+	unsigned long pgoff = vma->vm_pgoff;
+	unsigned long addr = vma->vm_start;
+	void *kaddr;
+	int err;
+
+	if (vma->vm_flags & VM_WRITE)
+		return -EPERM;
+
+	if (pgoff > nr_subbufs || nr_pages > nr_subbufs + 1 - pgoff)
+		return -EINVAL;
+
+	for (; nr_pages; nr_pages--, pgoff++, addr += PAGE_SIZE) {
+		if (pgoff)
+			kaddr = (void *)cpu_buffer->subbuf_ids[pgoff - 1];
+		else
+			kaddr = cpu_buffer->meta_page;
+
+		err = vm_insert_page(vma, addr, virt_to_page(kaddr));
+		if (err)
+			return err;
+	}
+
+	return 0;
+}
+
+/**
+ * ring_buffer_map - map a per CPU buffer into user space
+ * @buffer: the buffer to map
+ * @cpu: the CPU buffer to map
+ * @vma: the vma to insert the pages into, or NULL to only take one more
+ *       reference on an existing mapping (e.g. from vm_operations open)
+ *
+ * Maps, read only, a meta page (struct trace_buffer_meta) followed by all
+ * the data pages of the CPU buffer. While a CPU buffer is mapped it can not
+ * be resized or swapped, and its pages are never handed out to readers,
+ * ring_buffer_read_page() copies them instead.
+ *
+ * Each successful call must be paired with a ring_buffer_unmap().
+ */
+int ring_buffer_map(struct ring_buffer *buffer, int cpu,
+		    struct vm_area_struct *vma)
+{
+	struct ring_buffer_per_cpu *cpu_buffer;
+	struct trace_buffer_meta *meta;
+	unsigned long *subbuf_ids;
+	unsigned long flags;
+	int err = 0;
+
+	if (!cpumask_test_cpu(cpu, buffer->cpumask))
+		return -EINVAL;
+
+	cpu_buffer = buffer->buffers[cpu];
+
+	mutex_lock(&cpu_buffer->mapping_lock);
+
+	if (cpu_buffer->mapped) {
+		if (vma)
+			err = rb_map_vma(cpu_buffer, vma);
+		if (!err)
+			cpu_buffer->mapped++;
+		goto unlock;
+	}
+
+	if (WARN_ON(!vma)) {
+		err = -EINVAL;
+		goto unlock;
+	}
+
+	/* prevent another thread from changing buffer sizes */
+	mutex_lock(&buffer->mutex);
+
+	meta = (void *)get_zeroed_page(GFP_KERNEL);
+	subbuf_ids = kcalloc(cpu_buffer->nr_pages + 1, sizeof(*subbuf_ids),
+			     GFP_KERNEL);
+	if (!meta || !subbuf_ids) {
+		err = -ENOMEM;
+		goto free;
+	}
+
+	raw_spin_lock_irqsave(&cpu_buffer->reader_lock, flags);
+	cpu_buffer->meta_page = meta;
+	rb_setup_ids_meta_page(cpu_buffer, subbuf_ids);
+	cpu_buffer->mapped = 1;
+	raw_spin_unlock_irqrestore(&cpu_buffer->reader_lock, flags);
+
+	err = rb_map_vma(cpu_buffer, vma);
+	if (!err) {
+		mutex_unlock(&buffer->mutex);
+		goto unlock;
+	}
+
+	raw_spin_lock_irqsave(&cpu_buffer->reader_lock, flags);
+	cpu_buffer->mapped = 0;
+	cpu_buffer->meta_page = NULL;
+	cpu_buffer->subbuf_ids = NULL;
+	raw_spin_unlock_irqrestore(&cpu_buffer->reader_lock, flags);
+ free:
+	mutex_unlock(&buffer->mutex);
+	kfree(subbuf_ids);
+	free_page((unsigned long)meta);
+ unlock:
+	mutex_unlock(&cpu_buffer->mapping_lock);
+
+	return err;
+}
+EXPORT_SYMBOL_GPL(ring_buffer_map);
+
+/**
+ * ring_buffer_unmap - drop a reference taken by ring_buffer_map()
+ * @buffer: the mapped buffer
+ * @cpu: the mapped CPU buffer
+ */
+int ring_buffer_unmap(struct ring_buffer *buffer, int cpu)
+{
+	struct ring_buffer_per_cpu *cpu_buffer;
+	struct trace_buffer_meta *meta;
+	unsigned long *subbuf_ids;
+	unsigned long flags;
+	int err = 0;
+
+	if (!cpumask_test_cpu(cpu, buffer->cpumask))
+		return -EINVAL;
+
+	cpu_buffer = buffer->buffers[cpu];
+
+	mutex_lock(&cpu_buffer->mapping_lock);
+
+	if (!cpu_buffer->mapped) {
+		err = -ENODEV;
+		goto unlock;
+	}
+
+	if (cpu_buffer->mapped > 1) {
+		cpu_buffer->mapped--;
+		goto unlock;
+	}
+
+	raw_spin_lock_irqsave(&cpu_buffer->reader_lock, flags);
+	meta = cpu_buffer->meta_page;
+	subbuf_ids = cpu_buffer->subbuf_ids;
+	cpu_buffer->mapped = 0;
+	cpu_buffer->meta_page = NULL;
+	cpu_buffer->subbuf_ids = NULL;
+	raw_spin_unlock_irqrestore(&cpu_buffer->reader_lock, flags);
+
+	kfree(subbuf_ids);
+	free_page((unsigned long)meta);
+ unlock:
+	mutex_unlock(&cpu_buffer->mapping_lock);
+
+	return err;
+}
+EXPORT_SYMBOL_GPL(ring_buffer_unmap);
+
+/**
+ * ring_buffer_map_get_reader - hand the next events to a mapping reader
+ * @buffer: the mapped buffer
+ * @cpu: the mapped CPU buffer
+ *
+ * If the reader page still holds events, user space is given those,
+ * otherwise the page is swapped with the next one of the ring holding
+ * events. Either way the events are accounted as read, and the meta page
+ * updated with the reader page ID, the offset of its first new event and
+ * the number of events lost since the previous call.
+ *
+ * User space keeps reading events appended to the reader page, up to the
+ * commit in its header, without calling this again until the page is full.
+ */
+int ring_buffer_map_get_reader(struct ring_buffer *buffer, int cpu)
+{
+	struct ring_buffer_per_cpu *cpu_buffer;
+	unsigned long lost_events = 0;
+	struct buffer_page *reader;
+	unsigned long flags;
+	unsigned int read;
+
+	if (!cpumask_test_cpu(cpu, buffer->cpumask))
+		return -EINVAL;
+
+	cpu_buffer = buffer->buffers[cpu];
+
+	mutex_lock(&cpu_buffer->mapping_lock);
+
+	if (!cpu_buffer->mapped) {
+		mutex_unlock(&cpu_buffer->mapping_lock);
+		return -ENODEV;
+	}
+
+	raw_spin_lock_irqsave(&cpu_buffer->reader_lock, flags);
+
+	for (;;) {
+		reader = cpu_buffer->reader_page;
+		read = reader->read;
+
+		if (rb_per_cpu_empty(cpu_buffer))
+			break;
+
+		/* User space is expected to consume all it is given */
+		if (read < rb_page_size(reader)) {
+			while (reader->read < rb_page_size(reader))
+				rb_advance_reader(cpu_buffer);
+			break;
+		}
+
+		if (RB_WARN_ON(cpu_buffer, !rb_get_reader_page(cpu_buffer)))
+			break;
+
+		lost_events += cpu_buffer->lost_events;
+		cpu_buffer->lost_events = 0;
+	}
+
+	rb_update_meta_page(cpu_buffer);
+	cpu_buffer->meta_page->reader.read = read;
+	cpu_buffer->meta_page->reader.lost_events = lost_events;
+
+	flush_dcache_page(virt_to_page(reader->page));
+
+	raw_spin_unlock_irqrestore(&cpu_buffer->reader_lock, flags);
+
+	mutex_unlock(&cpu_buffer->mapping_lock);
+
+	return 0;
+}
+EXPORT_SYMBOL_GPL(ring_buffer_map_get_reader);
+
 /*
  * We only allocate new buffers, never free them if the CPU goes down.
  * If we were to free the buffer, then the user would lose any trace that was in
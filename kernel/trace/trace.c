@@ -45,6 +45,8 @@
 #include <linux/sched/clock.h>
 #include <linux/sched/rt.h>
 
+#include <uapi/linux/trace_mmap.h>
+
 #include "trace.h"
 #include "trace_output.h"
 
@@ -1374,6 +1376,12 @@ update_max_tr(struct trace_array *tr, struct task_struct *tsk, int cpu)
 
 	arch_spin_lock(&tr->max_lock);
 
+	/* Mapping readers must keep the buffer they mapped */
+	if (tr->mapped) {
+		arch_spin_unlock(&tr->max_lock);
+		return;
+	}
+
 	/* Inherit the recordable setting from trace_buffer */
 	if (ring_buffer_record_is_set_on(tr->trace_buffer.buffer))
 		ring_buffer_record_on(tr->max_buffer.buffer);
@@ -1411,6 +1419,11 @@ update_max_tr_single(struct trace_array *tr, struct task_struct *tsk, int cpu)
 
 	arch_spin_lock(&tr->max_lock);
 
+	if (tr->mapped) {
+		arch_spin_unlock(&tr->max_lock);
+		return;
+	}
+
 	ret = ring_buffer_swap_cpu(tr->max_buffer.buffer, tr->trace_buffer.buffer, cpu);
 
 	if (ret == -EBUSY) {
@@ -2376,17 +2389,6 @@ int tracepoint_printk_sysctl(struct ctl_table *table, int write,
 	return ret;
 }
 
-void trace_event_buffer_commit(struct trace_event_buffer *fbuffer)
-{
-	if (static_key_false(&tracepoint_printk_key.key))
-		output_printk(fbuffer);
-
-	event_trigger_unlock_commit(fbuffer->trace_file, fbuffer->buffer,
-				    fbuffer->event, fbuffer->entry,
-				    fbuffer->flags, fbuffer->pc);
-}
-EXPORT_SYMBOL_GPL(trace_event_buffer_commit);
-
 /*
  * Skip 3:
  *
@@ -2441,18 +2443,27 @@ static DEFINE_MUTEX(ftrace_export_lock);
 static struct trace_export __rcu *ftrace_exports_list __read_mostly;
 
 static DEFINE_STATIC_KEY_FALSE(ftrace_exports_enabled);
+static DEFINE_STATIC_KEY_FALSE(trace_event_exports_enabled);
 
-static inline void ftrace_exports_enable(void)
+static inline void ftrace_exports_enable(struct trace_export *export)
 {
-	static_branch_enable(&ftrace_exports_enabled);
+	if (export->flags & TRACE_EXPORT_FUNCTION)
+		static_branch_inc(&ftrace_exports_enabled);
+
+	if (export->flags & TRACE_EXPORT_EVENT)
+		static_branch_inc(&trace_event_exports_enabled);
 }
 
-static inline void ftrace_exports_disable(void)
+static inline void ftrace_exports_disable(struct trace_export *export)
 {
-	static_branch_disable(&ftrace_exports_enabled);
+	if (export->flags & TRACE_EXPORT_FUNCTION)
+		static_branch_dec(&ftrace_exports_enabled);
+
+	if (export->flags & TRACE_EXPORT_EVENT)
+		static_branch_dec(&trace_event_exports_enabled);
 }
 
-void ftrace_exports(struct ring_buffer_event *event)
+static void ftrace_exports(struct ring_buffer_event *event, int flag)
 {
 	struct trace_export *export;
 
@@ -2460,7 +2471,8 @@ void ftrace_exports(struct ring_buffer_event *event)
 
 	export = rcu_dereference_raw_notrace(ftrace_exports_list);
 	while (export) {
-		trace_process_export(export, event);
+		if (export->flags & flag)
+			trace_process_export(export, event);
 		export = rcu_dereference_raw_notrace(export->next);
 	}
 
@@ -2500,8 +2512,7 @@ rm_trace_export(struct trace_export **list, struct trace_export *export)
 static inline void
 add_ftrace_export(struct trace_export **list, struct trace_export *export)
 {
-	if (*list == NULL)
-		ftrace_exports_enable();
+	ftrace_exports_enable(export);
 
 	add_trace_export(list, export);
 }
@@ -2512,8 +2523,8 @@ rm_ftrace_export(struct trace_export **list, struct trace_export *export)
 	int ret;
 
 	ret = rm_trace_export(list, export);
-	if (*list == NULL)
-		ftrace_exports_disable();
+	if (!ret)
+		ftrace_exports_disable(export);
 
 	return ret;
 }
@@ -2547,6 +2558,20 @@ int unregister_ftrace_export(struct trace_export *export)
 }
 EXPORT_SYMBOL_GPL(unregister_ftrace_export);
 
+void trace_event_buffer_commit(struct trace_event_buffer *fbuffer)
+{
+	if (static_key_false(&tracepoint_printk_key.key))
+		output_printk(fbuffer);
+
+	if (static_branch_unlikely(&trace_event_exports_enabled))
+		ftrace_exports(fbuffer->event, TRACE_EXPORT_EVENT);
+
+	event_trigger_unlock_commit(fbuffer->trace_file, fbuffer->buffer,
+				    fbuffer->event, fbuffer->entry,
+				    fbuffer->flags, fbuffer->pc);
+}
+EXPORT_SYMBOL_GPL(trace_event_buffer_commit);
+
 void
 trace_function(struct trace_array *tr,
 	       unsigned long ip, unsigned long parent_ip, unsigned long flags,
@@ -2567,7 +2592,7 @@ trace_function(struct trace_array *tr,
 
 	if (!call_filter_check_discard(call, entry, buffer, event)) {
 		if (static_branch_unlikely(&ftrace_exports_enabled))
-			ftrace_exports(event);
+			ftrace_exports(event, TRACE_EXPORT_FUNCTION);
 		__buffer_unlock_commit(buffer, event);
 	}
 }
@@ -6458,6 +6483,10 @@ tracing_snapshot_write(struct file *filp, const char __user *ubuf, size_t cnt,
 			free_snapshot(tr);
 		break;
 	case 1:
+		if (tr->mapped) {
+			ret = -EBUSY;
+			break;
+		}
 /* Only allow per-cpu swap if the ring buffer supports it */
 #ifndef CONFIG_RING_BUFFER_ALLOW_SWAP
 		if (iter->cpu_file != RING_BUFFER_ALL_CPUS) {
@@ -6915,6 +6944,9 @@ tracing_buffers_splice_read(struct file *file, loff_t *ppos,
 			ring_buffer_free_read_page(ref->buffer, ref->cpu,
 						   ref->page);
 			kfree(ref);
+			/* Mapped buffers can not be spliced */
+			if (r == -EBUSY)
+				ret = r;
 			break;
 		}
 
@@ -6956,12 +6988,112 @@ tracing_buffers_splice_read(struct file *file, loff_t *ppos,
 	return ret;
 }
 
+/*
+ * Zero-copy reading of a CPU buffer: the meta page and all the sub-buffers
+ * are mapped read only, see include/uapi/linux/trace_mmap.h. Consuming a
+ * sub-buffer and getting the next one is TRACE_MMAP_IOCTL_GET_READER.
+ *
+ * tr->mapped is changed under max_lock, which update_max_tr() checks it
+ * under, so that no max snapshot swaps the buffer once it is set.
+ */
+static void tracing_buffers_mapped_add(struct trace_array *tr, int nr)
+{
+	local_irq_disable();
+	arch_spin_lock(&tr->max_lock);
+	tr->mapped += nr;
+	arch_spin_unlock(&tr->max_lock);
+	local_irq_enable();
+}
+
+static void tracing_buffers_mmap_open(struct vm_area_struct *vma)
+{
+	struct ftrace_buffer_info *info = vma->vm_file->private_data;
+	struct trace_iterator *iter = &info->iter;
+
+	WARN_ON(ring_buffer_map(iter->trace_buffer->buffer, iter->cpu_file,
+				NULL));
+	tracing_buffers_mapped_add(iter->tr, 1);
+}
+
+static void tracing_buffers_mmap_close(struct vm_area_struct *vma)
+{
+	struct ftrace_buffer_info *info = vma->vm_file->private_data;
+	struct trace_iterator *iter = &info->iter;
+
+	WARN_ON(ring_buffer_unmap(iter->trace_buffer->buffer, iter->cpu_file));
+	tracing_buffers_mapped_add(iter->tr, -1);
+}
+
+/* Partial unmaps would leave the mapping reference count with no owner */
+static int tracing_buffers_mmap_split(struct vm_area_struct *vma,
+				      unsigned long addr)
+{
+	return -EINVAL;
+}
+
+static const struct vm_operations_struct tracing_buffers_vmops = {
+	.open		= tracing_buffers_mmap_open,
+	.close		= tracing_buffers_mmap_close,
+	.split		= tracing_buffers_mmap_split,
+};
+
+static int tracing_buffers_mmap(struct file *filp, struct vm_area_struct *vma)
+{
+	struct ftrace_buffer_info *info = filp->private_data;
+	struct trace_iterator *iter = &info->iter;
+	struct trace_array *tr = iter->tr;
+	int ret;
+
+	if (iter->cpu_file == RING_BUFFER_ALL_CPUS)
+		return -EINVAL;
+
+	if (vma->vm_flags & VM_WRITE)
+		return -EPERM;
+
+	vma->vm_flags &= ~VM_MAYWRITE;
+	vma->vm_flags |= VM_DONTCOPY | VM_DONTEXPAND | VM_DONTDUMP;
+	vma->vm_ops = &tracing_buffers_vmops;
+
+	/* Stop max snapshots from swapping the buffer before it is mapped */
+	tracing_buffers_mapped_add(tr, 1);
+
+	ret = ring_buffer_map(iter->trace_buffer->buffer, iter->cpu_file, vma);
+	if (ret)
+		tracing_buffers_mapped_add(tr, -1);
+
+	return ret;
+}
+
+static long tracing_buffers_ioctl(struct file *file, unsigned int cmd,
+				  unsigned long arg)
+{
+	struct ftrace_buffer_info *info = file->private_data;
+	struct trace_iterator *iter = &info->iter;
+	int ret;
+
+	if (cmd != TRACE_MMAP_IOCTL_GET_READER)
+		return -ENOTTY;
+
+	if (!(file->f_flags & O_NONBLOCK)) {
+		ret = wait_on_pipe(iter, false);
+		if (ret)
+			return ret;
+	}
+
+	return ring_buffer_map_get_reader(iter->trace_buffer->buffer,
+					  iter->cpu_file);
+}
+
 static const struct file_operations tracing_buffers_fops = {
 	.open		= tracing_buffers_open,
 	.read		= tracing_buffers_read,
 	.poll		= tracing_buffers_poll,
 	.release	= tracing_buffers_release,
 	.splice_read	= tracing_buffers_splice_read,
+	.mmap		= tracing_buffers_mmap,
+	.unlocked_ioctl	= tracing_buffers_ioctl,
+	/* The only command takes no argument, nothing to translate */
+	.compat_ioctl	= tracing_buffers_ioctl,
 	.llseek		= no_llseek,
 };
 
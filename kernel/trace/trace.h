@@ -244,6 +244,8 @@ struct trace_array {
 	struct trace_event_file __rcu *exit_syscall_files[NR_syscalls];
 #endif
 	int			stop_count;
+	/* per_cpu trace_pipe_raw mappings, no max snapshots while set */
+	int			mapped;
 	int			clock_id;
 	int			nr_topts;
 	bool			clear_trace;
@@ -49,6 +49,8 @@
 #include <linux/uaccess.h>
 #include <linux/sched/isolation.h>
 #include <linux/nmi.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
 
 #include "workqueue_internal.h"
 
@@ -105,6 +107,8 @@ enum {
 	HIGHPRI_NICE_LEVEL	= MIN_NICE,
 
 	WQ_NAME_LEN		= 24,
+
+	WQ_LAT_HIST_BUCKETS	= 22,		/* <1us up to >=1s */
 };
 
 /*
@@ -260,6 +264,10 @@ struct workqueue_struct {
 #endif
 #ifdef CONFIG_LOCKDEP
 	struct lockdep_map	lockdep_map;
+#endif
+#ifdef CONFIG_WQ_LATENCY_HIST
+	/* queue to execution latency, see wq_lat_hist_account() */
+	atomic_long_t		lat_hist[WQ_LAT_HIST_BUCKETS];
 #endif
 	char			name[WQ_NAME_LEN]; /* I: workqueue name */
 
@@ -273,7 +281,7 @@ struct workqueue_struct {
 	/* hot fields used during command issue, aligned to cacheline */
 	unsigned int		flags ____cacheline_aligned; /* WQ: WQ_* flags */
 	struct pool_workqueue __percpu *cpu_pwqs; /* I: per-cpu pwqs */
-	struct pool_workqueue __rcu *numa_pwq_tbl[]; /* PWR: unbound pwqs indexed by node */
+	struct pool_workqueue __rcu *numa_pwq_tbl[]; /* PWR: unbound pwqs indexed by pod */
 };
 
 static struct kmem_cache *pwq_cache;
@@ -281,6 +289,15 @@ static struct kmem_cache *pwq_cache;
 static cpumask_var_t *wq_numa_possible_cpumask;
 					/* possible CPUs of each node */
 
+/*
+ * WQ_CACHE_AFFINE workqueues index their pwqs by LLC instead of node.  An
+ * LLC is identified by the first CPU of it which came online and holds the
+ * CPUs which have been online in it so far.  A CPU keeps its LLC once
+ * assigned, -1 until it first comes online.
+ */
+static cpumask_var_t *wq_llc_possible_cpumask;	/* PL: CPUs of each LLC */
+static DEFINE_PER_CPU(int, wq_cpu_llc) = -1;	/* PL: LLC of each CPU */
+
 static bool wq_disable_numa;
 module_param_named(disable_numa, wq_disable_numa, bool, 0444);
 
@@ -335,6 +352,9 @@ static struct workqueue_attrs *unbound_std_wq_attrs[NR_STD_WORKER_POOLS];
 /* I: attributes used when instantiating ordered pools on demand */
 static struct workqueue_attrs *ordered_wq_attrs[NR_STD_WORKER_POOLS];
 
+/* I: attributes used when instantiating WQ_CACHE_AFFINE pools on demand */
+static struct workqueue_attrs *cache_affine_wq_attrs[NR_STD_WORKER_POOLS];
+
 struct workqueue_struct *system_wq __read_mostly;
 EXPORT_SYMBOL(system_wq);
 struct workqueue_struct *system_highpri_wq __read_mostly;
@@ -545,10 +565,71 @@ static int worker_pool_assign_id(struct worker_pool *pool)
 	return ret;
 }
 
+/*
+ * The pwqs of an unbound workqueue are spread over NUMA nodes or, for
+ * WQ_CACHE_AFFINE ones, over LLCs.  Either is called a pod below and
+ * numa_pwq_tbl[] has a slot for every possible pod ID of both kinds, so
+ * that it stays valid while ->cache_affine changes under a lockless user.
+ */
+static int wq_pwq_tbl_size(void)
+{
+	return max_t(int, nr_node_ids, nr_cpu_ids);
+}
+
+/* is slot @pod of numa_pwq_tbl[] a pod pwqs are spread over? */
+static bool wq_pod_possible(bool cache_affine, int pod)
+{
+	if (cache_affine)
+		return pod < nr_cpu_ids && cpu_possible(pod);
+	return pod < nr_node_ids && node_possible(pod);
+}
+
+/* the pod of @cpu, -1 if unknown like NUMA_NO_NODE */
+static int wq_cpu_pod(bool cache_affine, int cpu)
+{
+	if (cache_affine)
+		return READ_ONCE(per_cpu(wq_cpu_llc, cpu));
+	return cpu_to_node(cpu);
+}
+
+/* the CPUs sharing the last level cache with @cpu */
+static const struct cpumask *wq_llc_mask(int cpu)
+{
+#ifdef CONFIG_SCHED_MC
+	return cpu_coregroup_mask(cpu);
+#else
+	return cpumask_of_node(cpu_to_node(cpu));
+#endif
+}
+
+/*
+ * Put @cpu, which is coming online, in the LLC of the CPUs it shares the
+ * cache with, or in a new one it identifies if it is the first of them.
+ */
+static void wq_llc_add_cpu(int cpu)
+{
+	int llc = cpu, sibling;
+
+	lockdep_assert_held(&wq_pool_mutex);
+
+	if (per_cpu(wq_cpu_llc, cpu) >= 0)
+		return;
+
+	for_each_cpu(sibling, wq_llc_mask(cpu)) {
+		if (per_cpu(wq_cpu_llc, sibling) >= 0) {
+			llc = per_cpu(wq_cpu_llc, sibling);
+			break;
+		}
+	}
+
+	cpumask_set_cpu(cpu, wq_llc_possible_cpumask[llc]);
+	WRITE_ONCE(per_cpu(wq_cpu_llc, cpu), llc);
+}
+
 /**
- * unbound_pwq_by_node - return the unbound pool_workqueue for the given node
+ * unbound_pwq_by_node - return the unbound pool_workqueue for the given pod
  * @wq: the target workqueue
- * @node: the node ID
+ * @node: the node ID, or the LLC ID for WQ_CACHE_AFFINE workqueues
  *
  * This must be called with any of wq_pool_mutex, wq->mutex or sched RCU
  * read locked.
@@ -566,7 +647,8 @@ static struct pool_workqueue *unbound_pwq_by_node(struct workqueue_struct *wq,
 	 * XXX: @node can be NUMA_NO_NODE if CPU goes offline while a
 	 * delayed item is pending.  The plan is to keep CPU -> NODE
 	 * mapping valid and stable across CPU on/offlines.  Once that
-	 * happens, this workaround can be removed.
+	 * happens, this workaround can be removed.  The LLC of a CPU which
+	 * hasn't been online yet is -1 as well.
 	 */
 	if (unlikely(node == NUMA_NO_NODE))
 		return wq->dfl_pwq;
@@ -574,6 +656,15 @@ static struct pool_workqueue *unbound_pwq_by_node(struct workqueue_struct *wq,
 	return rcu_dereference_raw(wq->numa_pwq_tbl[node]);
 }
 
+/* return the unbound pool_workqueue work items queued on @cpu go to */
+static struct pool_workqueue *unbound_pwq_by_cpu(struct workqueue_struct *wq,
+						 int cpu)
+{
+	bool cache_affine = READ_ONCE(wq->unbound_attrs->cache_affine);
+
+	return unbound_pwq_by_node(wq, wq_cpu_pod(cache_affine, cpu));
+}
+
 static unsigned int work_color_to_flags(int color)
 {
 	return color << WORK_STRUCT_COLOR_SHIFT;
@@ -1290,6 +1381,32 @@ static int try_to_grab_pending(struct work_struct *work, bool is_dwork,
  * CONTEXT:
  * spin_lock_irq(pool->lock).
  */
+#ifdef CONFIG_WQ_LATENCY_HIST
+static void wq_lat_hist_queue(struct work_struct *work)
+{
+	work->queued_at = ktime_get_mono_fast_ns();
+}
+
+/*
+ * Account the time @work spent queued on @wq in its latency histogram.
+ * Bucket 0 counts waits under 1us, bucket n [2^(n-1), 2^n) usecs and the
+ * last one everything longer.
+ */
+static void wq_lat_hist_account(struct workqueue_struct *wq,
+				struct work_struct *work)
+{
+	u64 usecs = div_u64(ktime_get_mono_fast_ns() - work->queued_at,
+			    NSEC_PER_USEC);
+	int bucket = min_t(int, fls64(usecs), WQ_LAT_HIST_BUCKETS - 1);
+
+	atomic_long_inc(&wq->lat_hist[bucket]);
+}
+#else
+static inline void wq_lat_hist_queue(struct work_struct *work) { }
+static inline void wq_lat_hist_account(struct workqueue_struct *wq,
+				       struct work_struct *work) { }
+#endif
+
 static void insert_work(struct pool_workqueue *pwq, struct work_struct *work,
 			struct list_head *head, unsigned int extra_flags)
 {
@@ -1299,6 +1416,7 @@ static void insert_work(struct pool_workqueue *pwq, struct work_struct *work,
 	set_work_pwq(work, pwq, extra_flags);
 	list_add_tail(&work->entry, head);
 	get_pwq(pwq);
+	wq_lat_hist_queue(work);
 
 	/*
 	 * Ensure either wq_worker_sleeping() sees the above
@@ -1391,7 +1509,7 @@ static void __queue_work(int cpu, struct workqueue_struct *wq,
 	if (!(wq->flags & WQ_UNBOUND))
 		pwq = per_cpu_ptr(wq->cpu_pwqs, cpu);
 	else
-		pwq = unbound_pwq_by_node(wq, cpu_to_node(cpu));
+		pwq = unbound_pwq_by_cpu(wq, cpu);
 
 	/*
 	 * If @work was previously on a different pool, it might still be
@@ -2087,6 +2205,7 @@ __acquires(&pool->lock)
 	worker->current_func = work->func;
 	worker->current_pwq = pwq;
 	work_color = get_work_color(work);
+	wq_lat_hist_account(pwq->wq, work);
 
 	/*
 	 * Record wq name for cmdline and debug reporting, may get
@@ -3247,10 +3366,12 @@ static void copy_workqueue_attrs(struct workqueue_attrs *to,
 	cpumask_copy(to->cpumask, from->cpumask);
 	/*
 	 * Unlike hash and equality test, this function doesn't ignore
-	 * ->no_numa as it is used for both pool and wq attrs.  Instead,
-	 * get_unbound_pool() explicitly clears ->no_numa after copying.
+	 * ->no_numa and ->cache_affine as it is used for both pool and wq
+	 * attrs.  Instead, get_unbound_pool() explicitly clears them after
+	 * copying.
 	 */
 	to->no_numa = from->no_numa;
+	to->cache_affine = from->cache_affine;
 }
 
 /* hash value of the content of @attr */
@@ -3451,10 +3572,11 @@ static struct worker_pool *get_unbound_pool(const struct workqueue_attrs *attrs)
 	pool->node = target_node;
 
 	/*
-	 * no_numa isn't a worker_pool attribute, always clear it.  See
-	 * 'struct workqueue_attrs' comments for detail.
+	 * no_numa and cache_affine aren't worker_pool attributes, always
+	 * clear them.  See 'struct workqueue_attrs' comments for detail.
 	 */
 	pool->attrs->no_numa = false;
+	pool->attrs->cache_affine = false;
 
 	if (worker_pool_assign_id(pool) < 0)
 		goto fail;
@@ -3675,6 +3797,39 @@ static bool wq_calc_node_cpumask(const struct workqueue_attrs *attrs, int node,
 	return false;
 }
 
+/* wq_calc_node_cpumask() for the LLC @llc of a WQ_CACHE_AFFINE workqueue */
+static bool wq_calc_llc_cpumask(const struct workqueue_attrs *attrs, int llc,
+				int cpu_going_down, cpumask_t *cpumask)
+{
+	/* does @llc have any online CPUs @attrs wants? */
+	cpumask_and(cpumask, wq_llc_possible_cpumask[llc], cpu_online_mask);
+	cpumask_and(cpumask, cpumask, attrs->cpumask);
+	if (cpu_going_down >= 0)
+		cpumask_clear_cpu(cpu_going_down, cpumask);
+
+	if (cpumask_empty(cpumask)) {
+		cpumask_copy(cpumask, attrs->cpumask);
+		return false;
+	}
+
+	cpumask_and(cpumask, attrs->cpumask, wq_llc_possible_cpumask[llc]);
+	return !cpumask_equal(cpumask, attrs->cpumask);
+}
+
+/*
+ * Calculate the cpumask for pod @pod, a node or an LLC depending on
+ * @cache_affine.  @attrs are pool attrs when called on CPU hotplug, which
+ * is why @cache_affine is passed separately.
+ */
+static bool wq_calc_pod_cpumask(const struct workqueue_attrs *attrs,
+				bool cache_affine, int pod,
+				int cpu_going_down, cpumask_t *cpumask)
+{
+	if (cache_affine)
+		return wq_calc_llc_cpumask(attrs, pod, cpu_going_down, cpumask);
+	return wq_calc_node_cpumask(attrs, pod, cpu_going_down, cpumask);
+}
+
 /* install @pwq into @wq's numa_pwq_tbl[] for @node and return the old pwq */
 static struct pool_workqueue *numa_pwq_tbl_install(struct workqueue_struct *wq,
 						   int node,
@@ -3706,10 +3861,10 @@ struct apply_wqattrs_ctx {
 static void apply_wqattrs_cleanup(struct apply_wqattrs_ctx *ctx)
 {
 	if (ctx) {
-		int node;
+		int pod;
 
-		for_each_node(node)
-			put_pwq_unlocked(ctx->pwq_tbl[node]);
+		for (pod = 0; pod < wq_pwq_tbl_size(); pod++)
+			put_pwq_unlocked(ctx->pwq_tbl[pod]);
 		put_pwq_unlocked(ctx->dfl_pwq);
 
 		free_workqueue_attrs(ctx->attrs);
@@ -3725,11 +3880,11 @@ apply_wqattrs_prepare(struct workqueue_struct *wq,
 {
 	struct apply_wqattrs_ctx *ctx;
 	struct workqueue_attrs *new_attrs, *tmp_attrs;
-	int node;
+	int pod;
 
 	lockdep_assert_held(&wq_pool_mutex);
 
-	ctx = kzalloc(struct_size(ctx, pwq_tbl, nr_node_ids), GFP_KERNEL);
+	ctx = kzalloc(struct_size(ctx, pwq_tbl, wq_pwq_tbl_size()), GFP_KERNEL);
 
 	new_attrs = alloc_workqueue_attrs(GFP_KERNEL);
 	tmp_attrs = alloc_workqueue_attrs(GFP_KERNEL);
@@ -3762,14 +3917,21 @@ apply_wqattrs_prepare(struct workqueue_struct *wq,
 	if (!ctx->dfl_pwq)
 		goto out_free;
 
-	for_each_node(node) {
-		if (wq_calc_node_cpumask(new_attrs, node, -1, tmp_attrs->cpumask)) {
-			ctx->pwq_tbl[node] = alloc_unbound_pwq(wq, tmp_attrs);
-			if (!ctx->pwq_tbl[node])
+	/*
+	 * Every slot gets a pwq, the ones which aren't pods of the new
+	 * attrs the default one, so that lockless users never see a stale
+	 * or NULL pwq when ->cache_affine changes.
+	 */
+	for (pod = 0; pod < wq_pwq_tbl_size(); pod++) {
+		if (wq_pod_possible(new_attrs->cache_affine, pod) &&
+		    wq_calc_pod_cpumask(new_attrs, new_attrs->cache_affine, pod,
+					-1, tmp_attrs->cpumask)) {
+			ctx->pwq_tbl[pod] = alloc_unbound_pwq(wq, tmp_attrs);
+			if (!ctx->pwq_tbl[pod])
 				goto out_free;
 		} else {
 			ctx->dfl_pwq->refcnt++;
-			ctx->pwq_tbl[node] = ctx->dfl_pwq;
+			ctx->pwq_tbl[pod] = ctx->dfl_pwq;
 		}
 	}
 
@@ -3792,7 +3954,7 @@ apply_wqattrs_prepare(struct workqueue_struct *wq,
 /* set attrs and install prepared pwqs, @ctx points to old pwqs on return */
 static void apply_wqattrs_commit(struct apply_wqattrs_ctx *ctx)
 {
-	int node;
+	int pod;
 
 	/* all pwqs have been created successfully, let's install'em */
 	mutex_lock(&ctx->wq->mutex);
@@ -3800,9 +3962,9 @@ static void apply_wqattrs_commit(struct apply_wqattrs_ctx *ctx)
 	copy_workqueue_attrs(ctx->wq->unbound_attrs, ctx->attrs);
 
 	/* save the previous pwq and install the new one */
-	for_each_node(node)
-		ctx->pwq_tbl[node] = numa_pwq_tbl_install(ctx->wq, node,
-							  ctx->pwq_tbl[node]);
+	for (pod = 0; pod < wq_pwq_tbl_size(); pod++)
+		ctx->pwq_tbl[pod] = numa_pwq_tbl_install(ctx->wq, pod,
+							 ctx->pwq_tbl[pod]);
 
 	/* @dfl_pwq might not have been used, ensure it's linked */
 	link_pwq(ctx->dfl_pwq);
@@ -3889,7 +4051,8 @@ EXPORT_SYMBOL_GPL(apply_workqueue_attrs);
  *
  * This function is to be called from %CPU_DOWN_PREPARE, %CPU_ONLINE and
  * %CPU_DOWN_FAILED.  @cpu is being hot[un]plugged, update NUMA affinity of
- * @wq accordingly.
+ * @wq accordingly.  WQ_CACHE_AFFINE workqueues get the pwq of the LLC
+ * of @cpu updated instead.
  *
  * If NUMA affinity can't be adjusted due to memory allocation failure, it
  * falls back to @wq->dfl_pwq which may not be optimal but is always
@@ -3906,16 +4069,25 @@ EXPORT_SYMBOL_GPL(apply_workqueue_attrs);
 static void wq_update_unbound_numa(struct workqueue_struct *wq, int cpu,
 				   bool online)
 {
-	int node = cpu_to_node(cpu);
 	int cpu_off = online ? -1 : cpu;
 	struct pool_workqueue *old_pwq = NULL, *pwq;
 	struct workqueue_attrs *target_attrs;
+	bool cache_affine;
 	cpumask_t *cpumask;
+	int node;
 
 	lockdep_assert_held(&wq_pool_mutex);
 
-	if (!wq_numa_enabled || !(wq->flags & WQ_UNBOUND) ||
-	    wq->unbound_attrs->no_numa)
+	if (!(wq->flags & WQ_UNBOUND))
+		return;
+
+	cache_affine = wq->unbound_attrs->cache_affine;
+	if (!cache_affine &&
+	    (!wq_numa_enabled || wq->unbound_attrs->no_numa))
+		return;
+
+	node = wq_cpu_pod(cache_affine, cpu);
+	if (node < 0)
 		return;
 
 	/*
@@ -3935,7 +4107,8 @@ static void wq_update_unbound_numa(struct workqueue_struct *wq, int cpu,
 	 * and create a new one if they don't match.  If the target cpumask
 	 * equals the default pwq's, the default pwq should be used.
 	 */
-	if (wq_calc_node_cpumask(wq->dfl_pwq->pool->attrs, node, cpu_off, cpumask)) {
+	if (wq_calc_pod_cpumask(wq->dfl_pwq->pool->attrs, cache_affine, node,
+				cpu_off, cpumask)) {
 		if (cpumask_equal(cpumask, pwq->pool->attrs->cpumask))
 			return;
 	} else {
@@ -3996,6 +4169,9 @@ static int alloc_and_link_pwqs(struct workqueue_struct *wq)
 			      wq->pwqs.prev != &wq->dfl_pwq->pwqs_node),
 		     "ordering guarantee broken for workqueue %s\n", wq->name);
 		return ret;
+	} else if (wq->flags & WQ_CACHE_AFFINE) {
+		return apply_workqueue_attrs(wq,
+					     cache_affine_wq_attrs[highpri]);
 	} else {
 		return apply_workqueue_attrs(wq, unbound_std_wq_attrs[highpri]);
 	}
@@ -4071,7 +4247,7 @@ struct workqueue_struct *__alloc_workqueue_key(const char *fmt,
 
 	/* allocate wq and format name */
 	if (flags & WQ_UNBOUND)
-		tbl_size = nr_node_ids * sizeof(wq->numa_pwq_tbl[0]);
+		tbl_size = wq_pwq_tbl_size() * sizeof(wq->numa_pwq_tbl[0]);
 
 	wq = kzalloc(sizeof(*wq) + tbl_size, GFP_KERNEL);
 	if (!wq)
@@ -4149,7 +4325,7 @@ EXPORT_SYMBOL_GPL(__alloc_workqueue_key);
 void destroy_workqueue(struct workqueue_struct *wq)
 {
 	struct pool_workqueue *pwq;
-	int node;
+	int pod;
 
 	/* drain it before proceeding with destruction */
 	drain_workqueue(wq);
@@ -4202,9 +4378,9 @@ void destroy_workqueue(struct workqueue_struct *wq)
 		 * access numa_pwq_tbl[] and dfl_pwq to put the base refs.
 		 * @wq will be freed when the last pwq is released.
 		 */
-		for_each_node(node) {
-			pwq = rcu_access_pointer(wq->numa_pwq_tbl[node]);
-			RCU_INIT_POINTER(wq->numa_pwq_tbl[node], NULL);
+		for (pod = 0; pod < wq_pwq_tbl_size(); pod++) {
+			pwq = rcu_access_pointer(wq->numa_pwq_tbl[pod]);
+			RCU_INIT_POINTER(wq->numa_pwq_tbl[pod], NULL);
 			put_pwq_unlocked(pwq);
 		}
 
@@ -4313,7 +4489,7 @@ bool workqueue_congested(int cpu, struct workqueue_struct *wq)
 	if (!(wq->flags & WQ_UNBOUND))
 		pwq = per_cpu_ptr(wq->cpu_pwqs, cpu);
 	else
-		pwq = unbound_pwq_by_node(wq, cpu_to_node(cpu));
+		pwq = unbound_pwq_by_cpu(wq, cpu);
 
 	ret = !list_empty(&pwq->delayed_works);
 	rcu_read_unlock_sched();
@@ -4836,7 +5012,8 @@ int workqueue_online_cpu(unsigned int cpu)
 		mutex_unlock(&wq_pool_attach_mutex);
 	}
 
-	/* update NUMA affinity of unbound workqueues */
+	/* update NUMA and LLC affinity of unbound workqueues */
+	wq_llc_add_cpu(cpu);
 	list_for_each_entry(wq, &workqueues, list)
 		wq_update_unbound_numa(wq, cpu, true);
 
@@ -5189,9 +5366,15 @@ static ssize_t wq_pool_ids_show(struct device *dev,
 	struct workqueue_struct *wq = dev_to_wq(dev);
 	const char *delim = "";
 	int node, written = 0;
+	bool cache_affine;
 
 	rcu_read_lock_sched();
-	for_each_node(node) {
+	cache_affine = READ_ONCE(wq->unbound_attrs->cache_affine);
+	for (node = 0; node < wq_pwq_tbl_size(); node++) {
+		if (!wq_pod_possible(cache_affine, node) ||
+		    (cache_affine &&
+		     cpumask_empty(wq_llc_possible_cpumask[node])))
+			continue;
 		written += scnprintf(buf + written, PAGE_SIZE - written,
 				     "%s%d:%d", delim, node,
 				     unbound_pwq_by_node(wq, node)->pool->id);
@@ -5332,11 +5515,52 @@ static ssize_t wq_numa_store(struct device *dev, struct device_attribute *attr,
 	return ret ?: count;
 }
 
+static ssize_t wq_cache_affine_show(struct device *dev,
+				    struct device_attribute *attr, char *buf)
+{
+	struct workqueue_struct *wq = dev_to_wq(dev);
+	int written;
+
+	mutex_lock(&wq->mutex);
+	written = scnprintf(buf, PAGE_SIZE, "%d\n",
+			    wq->unbound_attrs->cache_affine);
+	mutex_unlock(&wq->mutex);
+
+	return written;
+}
+
+static ssize_t wq_cache_affine_store(struct device *dev,
+				     struct device_attribute *attr,
+				     const char *buf, size_t count)
+{
+	struct workqueue_struct *wq = dev_to_wq(dev);
+	struct workqueue_attrs *attrs;
+	int v, ret = -ENOMEM;
+
+	apply_wqattrs_lock();
+
+	attrs = wq_sysfs_prep_attrs(wq);
+	if (!attrs)
+		goto out_unlock;
+
+	ret = -EINVAL;
+	if (sscanf(buf, "%d", &v) == 1) {
+		attrs->cache_affine = !!v;
+		ret = apply_workqueue_attrs_locked(wq, attrs);
+	}
+
+out_unlock:
+	apply_wqattrs_unlock();
+	free_workqueue_attrs(attrs);
+	return ret ?: count;
+}
+
 static struct device_attribute wq_sysfs_unbound_attrs[] = {
 	__ATTR(pool_ids, 0444, wq_pool_ids_show, NULL),
 	__ATTR(nice, 0644, wq_nice_show, wq_nice_store),
 	__ATTR(cpumask, 0644, wq_cpumask_show, wq_cpumask_store),
 	__ATTR(numa, 0644, wq_numa_show, wq_numa_store),
+	__ATTR(cache_affine, 0644, wq_cache_affine_show, wq_cache_affine_store),
 	__ATTR_NULL,
 };
 
@@ -5486,6 +5710,84 @@ static void workqueue_sysfs_unregister(struct workqueue_struct *wq)
 static void workqueue_sysfs_unregister(struct workqueue_struct *wq)	{ }
 #endif	/* CONFIG_SYSFS */
 
+/*
+ * Workqueue latency histograms.
+ *
+ * /sys/kernel/debug/workqueue_latency shows, for each workqueue which ran
+ * work items, how long they waited between being queued and starting to
+ * execute in power of two buckets of microseconds.  Writing to the file
+ * resets the histograms.
+ */
+#ifdef CONFIG_WQ_LATENCY_HIST
+
+static int wq_lat_hist_show(struct seq_file *m, void *v)
+{
+	struct workqueue_struct *wq;
+	int i;
+
+	/* buckets are labelled with their lower bound */
+	seq_printf(m, "%-24s %7dus", "# workqueue", 0);
+	for (i = 1; i < WQ_LAT_HIST_BUCKETS; i++)
+		seq_printf(m, " %7luus", 1UL << (i - 1));
+	seq_putc(m, '\n');
+
+	mutex_lock(&wq_pool_mutex);
+	list_for_each_entry(wq, &workqueues, list) {
+		for (i = 0; i < WQ_LAT_HIST_BUCKETS; i++)
+			if (atomic_long_read(&wq->lat_hist[i]))
+				break;
+		if (i == WQ_LAT_HIST_BUCKETS)
+			continue;
+
+		seq_printf(m, "%-24s", wq->name);
+		for (i = 0; i < WQ_LAT_HIST_BUCKETS; i++)
+			seq_printf(m, " %9ld",
+				   atomic_long_read(&wq->lat_hist[i]));
+		seq_putc(m, '\n');
+	}
+	mutex_unlock(&wq_pool_mutex);
+
+	return 0;
+}
+
+static int wq_lat_hist_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, wq_lat_hist_show, NULL);
+}
+
+static ssize_t wq_lat_hist_write(struct file *file, const char __user *ubuf,
+				 size_t count, loff_t *ppos)
+{
+	struct workqueue_struct *wq;
+	int i;
+
+	mutex_lock(&wq_pool_mutex);
+	list_for_each_entry(wq, &workqueues, list)
+		for (i = 0; i < WQ_LAT_HIST_BUCKETS; i++)
+			atomic_long_set(&wq->lat_hist[i], 0);
+	mutex_unlock(&wq_pool_mutex);
+
+	return count;
+}
+
+static const struct file_operations wq_lat_hist_fops = {
+	.open		= wq_lat_hist_open,
+	.read		= seq_read,
+	.write		= wq_lat_hist_write,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int __init wq_lat_hist_init(void)
+{
+	debugfs_create_file("workqueue_latency", 0644, NULL, NULL,
+			    &wq_lat_hist_fops);
+	return 0;
+}
+late_initcall(wq_lat_hist_init);
+
+#endif	/* CONFIG_WQ_LATENCY_HIST */
+
 /*
  * Workqueue watchdog.
  *
@@ -5637,6 +5939,10 @@ static void __init wq_numa_init(void)
 	cpumask_var_t *tbl;
 	int node, cpu;
 
+	/* WQ_CACHE_AFFINE workqueues need it even without NUMA */
+	wq_update_unbound_numa_attrs_buf = alloc_workqueue_attrs(GFP_KERNEL);
+	BUG_ON(!wq_update_unbound_numa_attrs_buf);
+
 	if (num_possible_nodes() <= 1)
 		return;
 
@@ -5645,9 +5951,6 @@ static void __init wq_numa_init(void)
 		return;
 	}
 
-	wq_update_unbound_numa_attrs_buf = alloc_workqueue_attrs(GFP_KERNEL);
-	BUG_ON(!wq_update_unbound_numa_attrs_buf);
-
 	/*
 	 * We want masks of possible CPUs of each node which isn't readily
 	 * available.  Build one from cpu_to_node() which should have been
@@ -5697,6 +6000,14 @@ int __init workqueue_init_early(void)
 
 	pwq_cache = KMEM_CACHE(pool_workqueue, SLAB_PANIC);
 
+	wq_llc_possible_cpumask = kcalloc(nr_cpu_ids,
+					  sizeof(wq_llc_possible_cpumask[0]),
+					  GFP_KERNEL);
+	BUG_ON(!wq_llc_possible_cpumask);
+	for_each_possible_cpu(cpu)
+		BUG_ON(!zalloc_cpumask_var(&wq_llc_possible_cpumask[cpu],
+					   GFP_KERNEL));
+
 	/* initialize CPU pools */
 	for_each_possible_cpu(cpu) {
 		struct worker_pool *pool;
@@ -5733,6 +6044,11 @@ int __init workqueue_init_early(void)
 		attrs->nice = std_nice[i];
 		attrs->no_numa = true;
 		ordered_wq_attrs[i] = attrs;
+
+		BUG_ON(!(attrs = alloc_workqueue_attrs(GFP_KERNEL)));
+		attrs->nice = std_nice[i];
+		attrs->cache_affine = true;
+		cache_affine_wq_attrs[i] = attrs;
 	}
 
 	system_wq = alloc_workqueue("events", 0, 0);
@@ -5789,6 +6105,9 @@ int __init workqueue_init(void)
 		}
 	}
 
+	/* the boot CPU doesn't go through workqueue_online_cpu() */
+	wq_llc_add_cpu(smp_processor_id());
+
 	list_for_each_entry(wq, &workqueues, list) {
 		wq_update_unbound_numa(wq, smp_processor_id(), true);
 		WARN(init_rescuer(wq),
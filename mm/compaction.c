@@ -1309,6 +1309,92 @@ static inline bool is_via_compact_memory(int order)
 	return order == -1;
 }
 
+/*
+ * Proactive compaction: kcompactd checks the node's fragmentation score
+ * every HPAGE_FRAG_CHECK_INTERVAL_MSEC and compacts in the background
+ * until it is back under the target set by vm.compaction_proactiveness.
+ *
+ * The score is the external fragmentation of the node with respect to
+ * COMPACTION_HPAGE_ORDER, in [0, 100]: each zone contributes its
+ * extfrag_for_order() weighted by its share of the node's pages.
+ * A single zone being compacted is judged on its own, unweighted score.
+ */
+static const unsigned int HPAGE_FRAG_CHECK_INTERVAL_MSEC = 500;
+
+#if defined CONFIG_TRANSPARENT_HUGEPAGE
+#define COMPACTION_HPAGE_ORDER	HPAGE_PMD_ORDER
+#elif defined CONFIG_HUGETLBFS
+#define COMPACTION_HPAGE_ORDER	HUGETLB_PAGE_ORDER
+#else
+#define COMPACTION_HPAGE_ORDER	(PMD_SHIFT - PAGE_SHIFT)
+#endif
+
+int sysctl_compaction_proactiveness = 20;
+
+static unsigned int fragmentation_score_zone(struct zone *zone)
+{
+	return extfrag_for_order(zone, COMPACTION_HPAGE_ORDER);
+}
+
+static unsigned int fragmentation_score_zone_weighted(struct zone *zone)
+{
+	unsigned long score;
+
+	score = zone->present_pages * fragmentation_score_zone(zone);
+	return div64_ul(score, zone->zone_pgdat->node_present_pages + 1);
+}
+
+static unsigned int fragmentation_score_node(pg_data_t *pgdat)
+{
+	unsigned int score = 0;
+	int zoneid;
+
+	for (zoneid = 0; zoneid < MAX_NR_ZONES; zoneid++)
+		score += fragmentation_score_zone_weighted(
+				&pgdat->node_zones[zoneid]);
+
+	return score;
+}
+
+/*
+ * Compaction starts above the high mark and stops once below the low one,
+ * so that it does not flip on and off around a single threshold.
+ */
+static unsigned int fragmentation_score_wmark(bool low)
+{
+	unsigned int wmark_low;
+
+	wmark_low = max(100U - sysctl_compaction_proactiveness, 5U);
+	return low ? wmark_low : min(wmark_low + 10, 100U);
+}
+
+static bool kswapd_is_running(pg_data_t *pgdat)
+{
+	struct task_struct *kswapd = pgdat->mkswapd[0];
+
+	return kswapd && kswapd->state == TASK_RUNNING;
+}
+
+/*
+ * Proactive compaction is background work: it stays away while kswapd is
+ * reclaiming on the node and steps aside for on-demand kcompactd requests.
+ */
+static bool proactive_compaction_yield(pg_data_t *pgdat)
+{
+	return kswapd_is_running(pgdat) ||
+		READ_ONCE(pgdat->kcompactd_max_order);
+}
+
+static bool should_proactive_compact_node(pg_data_t *pgdat)
+{
+	if (!sysctl_compaction_proactiveness ||
+	    proactive_compaction_yield(pgdat))
+		return false;
+
+	return fragmentation_score_node(pgdat) >
+		fragmentation_score_wmark(false);
+}
+
 static enum compact_result __compact_finished(struct zone *zone,
 						struct compact_control *cc)
 {
@@ -1338,6 +1424,17 @@ static enum compact_result __compact_finished(struct zone *zone,
 			return COMPACT_PARTIAL_SKIPPED;
 	}
 
+	if (cc->proactive_compaction) {
+		if (proactive_compaction_yield(zone->zone_pgdat))
+			return COMPACT_PARTIAL_SKIPPED;
+
+		if (fragmentation_score_zone(zone) >
+		    fragmentation_score_wmark(true))
+			return COMPACT_CONTINUE;
+
+		return COMPACT_SUCCESS;
+	}
+
 	if (is_via_compact_memory(cc->order))
 		return COMPACT_CONTINUE;
 
@@ -1847,6 +1944,49 @@ static void compact_node(int nid)
 	}
 }
 
+/*
+ * Compact the zones of a node until its fragmentation score drops below
+ * the low mark.  Runs from kcompactd, so it uses sync-light migration and
+ * does not defer on failure; kcompactd backs off instead.
+ */
+static void proactive_compact_node(pg_data_t *pgdat)
+{
+	int zoneid;
+	struct zone *zone;
+	struct compact_control cc = {
+		.order = -1,
+		.mode = MIGRATE_SYNC_LIGHT,
+		.ignore_skip_hint = true,
+		.whole_zone = true,
+		.gfp_mask = GFP_KERNEL,
+		.proactive_compaction = true,
+	};
+
+	for (zoneid = 0; zoneid < MAX_NR_ZONES; zoneid++) {
+		zone = &pgdat->node_zones[zoneid];
+		if (!populated_zone(zone))
+			continue;
+
+		cc.nr_freepages = 0;
+		cc.nr_migratepages = 0;
+		cc.total_migrate_scanned = 0;
+		cc.total_free_scanned = 0;
+		cc.zone = zone;
+		INIT_LIST_HEAD(&cc.freepages);
+		INIT_LIST_HEAD(&cc.migratepages);
+
+		compact_zone(zone, &cc);
+
+		count_compact_events(KCOMPACTD_MIGRATE_SCANNED,
+				     cc.total_migrate_scanned);
+		count_compact_events(KCOMPACTD_FREE_SCANNED,
+				     cc.total_free_scanned);
+
+		VM_BUG_ON(!list_empty(&cc.freepages));
+		VM_BUG_ON(!list_empty(&cc.migratepages));
+	}
+}
+
 /* Compact all nodes in the system */
 static void compact_nodes(void)
 {
@@ -1883,6 +2023,34 @@ int sysctl_extfrag_handler(struct ctl_table *table, int write,
 	return 0;
 }
 
+/*
+ * kcompactd does not poll while proactive compaction is off, so kick it
+ * when the knob is turned on.
+ */
+int compaction_proactiveness_sysctl_handler(struct ctl_table *table, int write,
+			void __user *buffer, size_t *length, loff_t *ppos)
+{
+	int rc, nid;
+
+	rc = proc_dointvec_minmax(table, write, buffer, length, ppos);
+	if (rc)
+		return rc;
+
+	if (write && sysctl_compaction_proactiveness) {
+		for_each_online_node(nid) {
+			pg_data_t *pgdat = NODE_DATA(nid);
+
+			if (pgdat->proactive_compact_trigger)
+				continue;
+
+			pgdat->proactive_compact_trigger = true;
+			wake_up_interruptible(&pgdat->kcompactd_wait);
+		}
+	}
+
+	return 0;
+}
+
 #if defined(CONFIG_SYSFS) && defined(CONFIG_NUMA)
 static ssize_t sysfs_compact_node(struct device *dev,
 			struct device_attribute *attr,
@@ -1914,7 +2082,8 @@ void compaction_unregister_node(struct node *node)
 
 static inline bool kcompactd_work_requested(pg_data_t *pgdat)
 {
-	return pgdat->kcompactd_max_order > 0 || kthread_should_stop();
+	return pgdat->kcompactd_max_order > 0 || kthread_should_stop() ||
+		pgdat->proactive_compact_trigger;
 }
 
 static bool kcompactd_node_suitable(pg_data_t *pgdat)
@@ -2056,6 +2225,8 @@ static int kcompactd(void *p)
 {
 	pg_data_t *pgdat = (pg_data_t*)p;
 	struct task_struct *tsk = current;
+	long default_timeout = msecs_to_jiffies(HPAGE_FRAG_CHECK_INTERVAL_MSEC);
+	unsigned int proactive_defer = 0;
 
 	const struct cpumask *cpumask = cpumask_of_node(pgdat->node_id);
 
@@ -2068,11 +2239,35 @@ static int kcompactd(void *p)
 	pgdat->kcompactd_classzone_idx = pgdat->nr_zones - 1;
 
 	while (!kthread_should_stop()) {
+		long timeout = sysctl_compaction_proactiveness ?
+			       default_timeout : MAX_SCHEDULE_TIMEOUT;
+		unsigned int prev_score, score;
+
 		trace_mm_compaction_kcompactd_sleep(pgdat->node_id);
-		wait_event_freezable(pgdat->kcompactd_wait,
-				kcompactd_work_requested(pgdat));
+		if (wait_event_freezable_timeout(pgdat->kcompactd_wait,
+				kcompactd_work_requested(pgdat), timeout) &&
+		    !pgdat->proactive_compact_trigger) {
+			kcompactd_do_work(pgdat);
+			continue;
+		}
+
+		/* Timed out, or proactiveness was just raised */
+		pgdat->proactive_compact_trigger = false;
+		if (!should_proactive_compact_node(pgdat))
+			continue;
+
+		if (proactive_defer) {
+			proactive_defer--;
+			continue;
+		}
+
+		prev_score = fragmentation_score_node(pgdat);
+		proactive_compact_node(pgdat);
+		score = fragmentation_score_node(pgdat);
 
-		kcompactd_do_work(pgdat);
+		/* Back off for a while if compaction made no progress */
+		proactive_defer = score < prev_score ?
+				  0 : 1 << COMPACT_MAX_DEFER_SHIFT;
 	}
 
 	return 0;
@@ -36,6 +36,7 @@
 #include <linux/cleancache.h>
 #include <linux/shmem_fs.h>
 #include <linux/rmap.h>
+#include <linux/vmpressure.h>
 #include "internal.h"
 
 #define CREATE_TRACE_POINTS
@@ -1076,8 +1077,16 @@ static inline int wait_on_page_bit_common(wait_queue_head_t *q,
 {
 	struct wait_page_queue wait_page;
 	wait_queue_entry_t *wait = &wait_page.wait;
+	u64 stall = 0;
 	int ret = 0;
 
+	/*
+	 * A locked, active page that is not uptodate yet is being read
+	 * back in after it was evicted from the workingset.
+	 */
+	if (bit_nr == PG_locked && PageActive(page) && !PageUptodate(page))
+		stall = vmpressure_stall_enter();
+
 	init_wait(wait);
 	wait->flags = lock ? WQ_FLAG_EXCLUSIVE : 0;
 	wait->func = wake_page_function;
@@ -1116,6 +1125,8 @@ static inline int wait_on_page_bit_common(wait_queue_head_t *q,
 
 	finish_wait(q, wait);
 
+	vmpressure_stall_leave(stall, VMPRESSURE_STALL_THRASHING);
+
 	/*
 	 * A signal could leave PageWaiters set. Clearing it here if
 	 * !waitqueue_active would be possible (by open-coding finish_wait),
@@ -1013,6 +1013,8 @@ static void collapse_huge_page(struct mm_struct *mm,
 		goto out;
 
 	anon_vma_lock_write(vma->anon_vma);
+	/* keep speculative faults away from the ptes being collapsed */
+	vm_write_begin(vma);
 
 	pte = pte_offset_map(pmd, address);
 	pte_ptl = pte_lockptr(mm, pmd);
@@ -1046,6 +1048,7 @@ static void collapse_huge_page(struct mm_struct *mm,
 		 */
 		pmd_populate(mm, pmd, pmd_pgtable(_pmd));
 		spin_unlock(pmd_ptl);
+		vm_write_end(vma);
 		anon_vma_unlock_write(vma->anon_vma);
 		result = SCAN_FAIL;
 		goto out;
@@ -1055,6 +1058,7 @@ static void collapse_huge_page(struct mm_struct *mm,
 	 * All pages are isolated and locked so anon_vma rmap
 	 * can't run anymore.
 	 */
+	vm_write_end(vma);
 	anon_vma_unlock_write(vma->anon_vma);
 
 	__collapse_huge_page_copy(pte, new_page, vma, address, pte_ptl);
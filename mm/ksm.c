@@ -21,6 +21,7 @@
 #include <linux/sched.h>
 #include <linux/sched/mm.h>
 #include <linux/sched/coredump.h>
+#include <linux/sched/clock.h>
 #include <linux/rwsem.h>
 #include <linux/pagemap.h>
 #include <linux/rmap.h>
@@ -151,6 +152,7 @@ struct ksm_scan {
  * @kpfn: page frame number of this ksm page (perhaps temporarily on wrong nid)
  * @chain_prune_time: time of the last full garbage collection
  * @rmap_hlist_len: number of rmap_item entries in hlist or STABLE_NODE_CHAIN
+ * @checksum: checksum of the ksm page, the first sort key in lite mode
  * @nid: NUMA node id of stable tree in which linked (may not match kpfn)
  */
 struct stable_node {
@@ -176,6 +178,7 @@ struct stable_node {
 	 */
 #define STABLE_NODE_CHAIN -1024
 	int rmap_hlist_len;
+	u32 checksum;
 #ifdef CONFIG_NUMA
 	int nid;
 #endif
@@ -279,6 +282,16 @@ static unsigned int zero_checksum __read_mostly;
 /* Whether to merge empty (zeroed) pages with actual zero pages */
 static bool ksm_use_zero_pages __read_mostly;
 
+/*
+ * Lite mode: order both trees by page checksum first, so that a tree walk
+ * only looks up and compares the pages whose checksum matches, and always
+ * merge zero-filled pages with the zero page.
+ */
+static bool ksm_lite __read_mostly;
+
+/* Upper bound on the share of a CPU ksmd may use, 0 for no bound */
+static unsigned int ksm_max_cpu_percent;
+
 #ifdef CONFIG_NUMA
 /* Zeroed when merging across nodes is not allowed */
 static unsigned int ksm_merge_across_nodes = 1;
@@ -596,6 +609,7 @@ static struct stable_node *alloc_stable_node_chain(struct stable_node *dup,
 		INIT_HLIST_HEAD(&chain->hlist);
 		chain->chain_prune_time = jiffies;
 		chain->rmap_hlist_len = STABLE_NODE_CHAIN;
+		chain->checksum = dup->checksum;
 #if defined (CONFIG_DEBUG_VM) && defined(CONFIG_NUMA)
 		chain->nid = -1; /* debug */
 #endif
@@ -1032,6 +1046,22 @@ static inline int pages_identical(struct page *page1, struct page *page2)
 	return !memcmp_pages(page1, page2);
 }
 
+/*
+ * Where a tree walk goes next in lite mode, from the checksums alone:
+ * < 0 or > 0 to go left or right, 0 when the pages have to be compared.
+ */
+static inline int ksm_lite_cmp(u32 checksum, u32 tree_checksum)
+{
+	if (!ksm_lite || checksum == tree_checksum)
+		return 0;
+	return checksum < tree_checksum ? -1 : 1;
+}
+
+static inline bool ksm_zero_pages_enabled(void)
+{
+	return ksm_use_zero_pages || ksm_lite;
+}
+
 static int write_protect_page(struct vm_area_struct *vma, struct page *page,
 			      pte_t *orig_pte)
 {
@@ -1151,8 +1181,8 @@ static int replace_page(struct vm_area_struct *vma, struct page *page,
 	}
 
 	/*
-	 * No need to check ksm_use_zero_pages here: we can only have a
-	 * zero_page here if ksm_use_zero_pages was enabled alreaady.
+	 * No need to check ksm_zero_pages_enabled() here: we can only have a
+	 * zero_page here if it was enabled already.
 	 */
 	if (!is_zero_pfn(page_to_pfn(kpage))) {
 		get_page(kpage);
@@ -1552,7 +1582,7 @@ static __always_inline struct page *chain(struct stable_node **s_n_d,
  * This function returns the stable tree node of identical content if found,
  * NULL otherwise.
  */
-static struct page *stable_tree_search(struct page *page)
+static struct page *stable_tree_search(struct page *page, u32 checksum)
 {
 	int nid;
 	struct rb_root *root;
@@ -1580,6 +1610,12 @@ static struct page *stable_tree_search(struct page *page)
 
 		cond_resched();
 		stable_node = rb_entry(*new, struct stable_node, node);
+		ret = ksm_lite_cmp(checksum, stable_node->checksum);
+		if (ret) {
+			parent = *new;
+			new = ret < 0 ? &parent->rb_left : &parent->rb_right;
+			continue;
+		}
 		stable_node_any = NULL;
 		tree_page = chain_prune(&stable_node_dup, &stable_node,	root);
 		/*
@@ -1798,7 +1834,8 @@ static struct page *stable_tree_search(struct page *page)
  * This function returns the stable tree node just allocated on success,
  * NULL otherwise.
  */
-static struct stable_node *stable_tree_insert(struct page *kpage)
+static struct stable_node *stable_tree_insert(struct page *kpage,
+					      u32 checksum)
 {
 	int nid;
 	unsigned long kpfn;
@@ -1821,6 +1858,12 @@ static struct stable_node *stable_tree_insert(struct page *kpage)
 
 		cond_resched();
 		stable_node = rb_entry(*new, struct stable_node, node);
+		ret = ksm_lite_cmp(checksum, stable_node->checksum);
+		if (ret) {
+			parent = *new;
+			new = ret < 0 ? &parent->rb_left : &parent->rb_right;
+			continue;
+		}
 		stable_node_any = NULL;
 		tree_page = chain(&stable_node_dup, stable_node, root);
 		if (!stable_node_dup) {
@@ -1882,6 +1925,7 @@ static struct stable_node *stable_tree_insert(struct page *kpage)
 	stable_node_dup->kpfn = kpfn;
 	set_page_stable_node(kpage, stable_node_dup);
 	stable_node_dup->rmap_hlist_len = 0;
+	stable_node_dup->checksum = checksum;
 	DO_NUMA(stable_node_dup->nid = nid);
 	if (!need_chain) {
 		rb_link_node(&stable_node_dup->node, parent, new);
@@ -1937,6 +1981,13 @@ struct rmap_item *unstable_tree_search_insert(struct rmap_item *rmap_item,
 
 		cond_resched();
 		tree_rmap_item = rb_entry(*new, struct rmap_item, node);
+		ret = ksm_lite_cmp(rmap_item->oldchecksum,
+				   tree_rmap_item->oldchecksum);
+		if (ret) {
+			parent = *new;
+			new = ret < 0 ? &parent->rb_left : &parent->rb_right;
+			continue;
+		}
 		tree_page = get_mergeable_page(tree_rmap_item);
 		if (!tree_page)
 			return NULL;
@@ -2036,7 +2087,7 @@ static void cmp_and_merge_page(struct page *page, struct rmap_item *rmap_item)
 	struct page *tree_page = NULL;
 	struct stable_node *stable_node;
 	struct page *kpage;
-	unsigned int checksum;
+	unsigned int checksum = 0;
 	int err;
 	bool max_page_sharing_bypass = false;
 
@@ -2060,8 +2111,12 @@ static void cmp_and_merge_page(struct page *page, struct rmap_item *rmap_item)
 			max_page_sharing_bypass = true;
 	}
 
+	/* Lite mode needs the checksum to walk the stable tree */
+	if (ksm_lite)
+		checksum = calc_checksum(page);
+
 	/* We first start with searching the page inside the stable tree */
-	kpage = stable_tree_search(page);
+	kpage = stable_tree_search(page, checksum);
 	if (kpage == page && rmap_item->head == stable_node) {
 		put_page(kpage);
 		return;
@@ -2091,7 +2146,8 @@ static void cmp_and_merge_page(struct page *page, struct rmap_item *rmap_item)
 	 * don't want to insert it in the unstable tree, and we don't want
 	 * to waste our time searching for something identical to it there.
 	 */
-	checksum = calc_checksum(page);
+	if (!ksm_lite)
+		checksum = calc_checksum(page);
 	if (rmap_item->oldchecksum != checksum) {
 		rmap_item->oldchecksum = checksum;
 		return;
@@ -2101,7 +2157,7 @@ static void cmp_and_merge_page(struct page *page, struct rmap_item *rmap_item)
 	 * Same checksum as an empty page. We attempt to merge it with the
 	 * appropriate zero page if the user enabled this via sysfs.
 	 */
-	if (ksm_use_zero_pages && (checksum == zero_checksum)) {
+	if (ksm_zero_pages_enabled() && (checksum == zero_checksum)) {
 		struct vm_area_struct *vma;
 
 		down_read(&mm->mmap_sem);
@@ -2142,7 +2198,7 @@ static void cmp_and_merge_page(struct page *page, struct rmap_item *rmap_item)
 			 * node in the stable tree and add both rmap_items.
 			 */
 			lock_page(kpage);
-			stable_node = stable_tree_insert(kpage);
+			stable_node = stable_tree_insert(kpage, checksum);
 			if (stable_node) {
 				stable_tree_append(tree_rmap_item, stable_node,
 						   false);
@@ -2389,23 +2445,46 @@ static int ksmd_should_run(void)
 	return (ksm_run & KSM_RUN_MERGE) && !list_empty(&ksm_mm_head.mm_list);
 }
 
+/*
+ * How long ksmd sleeps after a batch that took @busy_ns: at least
+ * sleep_millisecs, and long enough to stay under max_cpu_percent.
+ */
+static unsigned int ksm_sleep_millisecs(u64 busy_ns)
+{
+	unsigned int sleep_ms = READ_ONCE(ksm_thread_sleep_millisecs);
+	unsigned int pct = READ_ONCE(ksm_max_cpu_percent);
+	u64 budget_ms;
+
+	if (!pct || pct >= 100)
+		return sleep_ms;
+
+	budget_ms = div_u64(busy_ns * (100 - pct), pct * NSEC_PER_MSEC);
+	return max_t(u64, sleep_ms, min_t(u64, budget_ms, MSEC_PER_SEC));
+}
+
 static int ksm_scan_thread(void *nothing)
 {
 	set_freezable();
 	set_user_nice(current, 5);
 
 	while (!kthread_should_stop()) {
+		u64 busy_ns = 0;
+
 		mutex_lock(&ksm_thread_mutex);
 		wait_while_offlining();
-		if (ksmd_should_run())
+		if (ksmd_should_run()) {
+			u64 start = local_clock();
+
 			ksm_do_scan(ksm_thread_pages_to_scan);
+			busy_ns = local_clock() - start;
+		}
 		mutex_unlock(&ksm_thread_mutex);
 
 		try_to_freeze();
 
 		if (ksmd_should_run()) {
 			schedule_timeout_interruptible(
-				msecs_to_jiffies(ksm_thread_sleep_millisecs));
+				msecs_to_jiffies(ksm_sleep_millisecs(busy_ns)));
 		} else {
 			wait_event_freezable(ksm_thread_wait,
 				ksmd_should_run() || kthread_should_stop());
@@ -2980,6 +3059,60 @@ static ssize_t use_zero_pages_store(struct kobject *kobj,
 }
 KSM_ATTR(use_zero_pages);
 
+static ssize_t lite_show(struct kobject *kobj,
+			 struct kobj_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%u\n", ksm_lite);
+}
+
+static ssize_t lite_store(struct kobject *kobj, struct kobj_attribute *attr,
+			  const char *buf, size_t count)
+{
+	int err;
+	bool value;
+
+	err = kstrtobool(buf, &value);
+	if (err)
+		return -EINVAL;
+
+	/* The stable tree is sorted differently: it has to be empty */
+	mutex_lock(&ksm_thread_mutex);
+	wait_while_offlining();
+	if (ksm_lite != value) {
+		if (ksm_pages_shared || remove_all_stable_nodes())
+			err = -EBUSY;
+		else
+			ksm_lite = value;
+	}
+	mutex_unlock(&ksm_thread_mutex);
+
+	return err ? err : count;
+}
+KSM_ATTR(lite);
+
+static ssize_t max_cpu_percent_show(struct kobject *kobj,
+				    struct kobj_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%u\n", ksm_max_cpu_percent);
+}
+
+static ssize_t max_cpu_percent_store(struct kobject *kobj,
+				     struct kobj_attribute *attr,
+				     const char *buf, size_t count)
+{
+	unsigned int pct;
+	int err;
+
+	err = kstrtouint(buf, 10, &pct);
+	if (err || pct > 100)
+		return -EINVAL;
+
+	ksm_max_cpu_percent = pct;
+
+	return count;
+}
+KSM_ATTR(max_cpu_percent);
+
 static ssize_t max_page_sharing_show(struct kobject *kobj,
 				     struct kobj_attribute *attr, char *buf)
 {
@@ -3123,6 +3256,8 @@ static struct attribute *ksm_attrs[] = {
 	&stable_node_dups_attr.attr,
 	&stable_node_chains_prune_millisecs_attr.attr,
 	&use_zero_pages_attr.attr,
+	&lite_attr.attr,
+	&max_cpu_percent_attr.attr,
 	NULL,
 };
 
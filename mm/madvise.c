@@ -184,7 +184,9 @@ static long madvise_behavior(struct vm_area_struct *vma,
 	/*
 	 * vm_flags is protected by the mmap_sem held in write mode.
 	 */
+	vm_write_begin(vma);
 	vma->vm_flags = new_flags;
+	vm_write_end(vma);
 out:
 	return error;
 }
@@ -6009,6 +6009,42 @@ void mem_cgroup_cancel_charge(struct page *page, struct mem_cgroup *memcg,
 	cancel_charge(memcg, nr_pages);
 }
 
+/**
+ * mem_cgroup_charge_pages - charge pages that are not tracked by the memcg
+ * @memcg: memcg to charge
+ * @gfp_mask: reclaim mode
+ * @nr_pages: number of pages to charge
+ *
+ * Charge @nr_pages to @memcg without binding them to a struct page, for
+ * driver pages that are mapped into userspace but never sit on the LRU or
+ * in the page cache.  The caller must drop the charge again with
+ * mem_cgroup_uncharge_pages() before freeing the pages.
+ *
+ * Returns 0 on success, an error code otherwise.
+ */
+int mem_cgroup_charge_pages(struct mem_cgroup *memcg, gfp_t gfp_mask,
+			    unsigned int nr_pages)
+{
+	if (mem_cgroup_disabled() || !memcg)
+		return 0;
+
+	return try_charge(memcg, gfp_mask, nr_pages);
+}
+
+/**
+ * mem_cgroup_uncharge_pages - drop a charge taken by mem_cgroup_charge_pages()
+ * @memcg: memcg that was charged
+ * @nr_pages: number of pages to uncharge
+ */
+void mem_cgroup_uncharge_pages(struct mem_cgroup *memcg,
+			       unsigned int nr_pages)
+{
+	if (mem_cgroup_disabled() || !memcg)
+		return;
+
+	cancel_charge(memcg, nr_pages);
+}
+
 struct uncharge_gather {
 	struct mem_cgroup *memcg;
 	unsigned long pgpgout;
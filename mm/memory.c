@@ -4159,6 +4159,259 @@ vm_fault_t handle_mm_fault(struct vm_area_struct *vma, unsigned long address,
 }
 EXPORT_SYMBOL_GPL(handle_mm_fault);
 
+#ifdef CONFIG_SPECULATIVE_PAGE_FAULT
+/*
+ * Lockless find_vma().  rbtree updates are done with WRITE_ONCE(), so a
+ * concurrent rotation can make this miss the right vma but never loop;
+ * the caller validates whatever comes back.
+ */
+static struct vm_area_struct *find_vma_rcu(struct mm_struct *mm,
+					   unsigned long addr)
+{
+	struct rb_node *node = READ_ONCE(mm->mm_rb.rb_node);
+	struct vm_area_struct *vma = NULL;
+
+	while (node) {
+		struct vm_area_struct *tmp;
+
+		tmp = rb_entry(node, struct vm_area_struct, vm_rb);
+		if (READ_ONCE(tmp->vm_end) > addr) {
+			vma = tmp;
+			if (READ_ONCE(tmp->vm_start) <= addr)
+				break;
+			node = READ_ONCE(node->rb_left);
+		} else {
+			node = READ_ONCE(node->rb_right);
+		}
+	}
+
+	return vma;
+}
+
+/*
+ * Only page cache pages that filemap_map_pages() would map as well: up to
+ * date, not under readahead, not compound and inside i_size.  Returns the
+ * page locked and with a reference held, or NULL.
+ */
+static struct page *spf_find_file_page(struct vm_area_struct *vma,
+				       unsigned long address)
+{
+	struct file *file = READ_ONCE(vma->vm_file);
+	struct address_space *mapping;
+	pgoff_t pgoff, max_idx;
+	struct page *page;
+
+	if (!file)
+		return NULL;
+	mapping = file->f_mapping;
+	pgoff = linear_page_index(vma, address);
+
+	page = find_get_page(mapping, pgoff);
+	if (!page)
+		return NULL;
+	if (PageTransCompound(page) || !PageUptodate(page) ||
+	    PageReadahead(page) || PageHWPoison(page))
+		goto put;
+	if (!trylock_page(page))
+		goto put;
+	if (page->mapping != mapping || !PageUptodate(page))
+		goto unlock;
+	max_idx = DIV_ROUND_UP(i_size_read(mapping->host), PAGE_SIZE);
+	if (page->index >= max_idx)
+		goto unlock;
+
+	return page;
+unlock:
+	unlock_page(page);
+put:
+	put_page(page);
+	return NULL;
+}
+
+/**
+ * handle_speculative_fault - try to handle a user fault without mmap_sem
+ * @mm: the faulting mm, which must be current->mm
+ * @address: faulting address
+ * @flags: FAULT_FLAG_xxx flags
+ *
+ * Handles the simple cases whose only dependency on mmap_sem is that the
+ * vma stays put: the first touch of a page in an anonymous vma that
+ * already has an anon_vma, and a read fault on a file page that is up to
+ * date in the page cache.  The vma is found under RCU and its sequence
+ * count checked again with the pte lock held, right before the pte is
+ * set; any concurrent change to the vma sends us back to the regular
+ * path.  The page table walk runs with interrupts off, as in
+ * get_user_pages_fast(), so the tables cannot be freed under us, and
+ * nothing here sleeps.
+ *
+ * Return: 0 if the fault was handled, VM_FAULT_RETRY if the caller has to
+ * take mmap_sem and call handle_mm_fault().
+ */
+vm_fault_t handle_speculative_fault(struct mm_struct *mm,
+				    unsigned long address, unsigned int flags)
+{
+	bool write = flags & FAULT_FLAG_WRITE;
+	bool exec = flags & FAULT_FLAG_INSTRUCTION;
+	struct mem_cgroup *memcg = NULL;
+	struct vm_area_struct *vma;
+	struct page *page = NULL;
+	bool anon, zero = false;
+	unsigned long vm_flags;
+	pgd_t pgdval, *pgdp;
+	p4d_t p4dval, *p4dp;
+	pud_t pudval, *pudp;
+	pmd_t pmdval, *pmdp;
+	spinlock_t *ptl;
+	pte_t *pte, entry;
+	unsigned int seq;
+	gfp_t gfp;
+
+	if (!(flags & FAULT_FLAG_USER))
+		return VM_FAULT_RETRY;
+
+	rcu_read_lock();
+	vma = find_vma_rcu(mm, address);
+	if (!vma)
+		goto out_rcu;
+	seq = raw_read_seqcount(&vma->vm_sequence);
+	if (seq & 1)
+		goto out_rcu;
+	if (vma->vm_mm != mm || address < READ_ONCE(vma->vm_start) ||
+	    address >= READ_ONCE(vma->vm_end))
+		goto out_rcu;
+
+	vm_flags = READ_ONCE(vma->vm_flags);
+	if (write ? !(vm_flags & VM_WRITE) :
+	    exec ? !(vm_flags & VM_EXEC) :
+	    !(vm_flags & (VM_READ | VM_WRITE | VM_EXEC)))
+		goto out_rcu;
+	if (!arch_vma_access_permitted(vma, write, exec, false))
+		goto out_rcu;
+	if (vm_flags & (VM_LOCKED | VM_HUGETLB | VM_PFNMAP | VM_MIXEDMAP |
+			VM_UFFD_MISSING | VM_UFFD_WP))
+		goto out_rcu;
+#ifdef CONFIG_NUMA
+	if (READ_ONCE(vma->vm_policy))
+		goto out_rcu;
+#endif
+
+	anon = !READ_ONCE(vma->vm_ops);
+	if (anon) {
+		if (!READ_ONCE(vma->anon_vma))
+			goto out_rcu;
+		if (!write) {
+			if (mm_forbids_zeropage(mm))
+				goto out_rcu;
+			zero = true;
+		} else {
+			gfp = (GFP_HIGHUSER_MOVABLE | __GFP_ZERO | __GFP_NOWARN) &
+			      ~__GFP_DIRECT_RECLAIM;
+			page = alloc_page_vma(gfp, vma, address);
+			if (!page)
+				goto out_rcu;
+			if (mem_cgroup_try_charge(page, mm, gfp, &memcg,
+						  false)) {
+				put_page(page);
+				goto out_rcu;
+			}
+			__SetPageUptodate(page);
+		}
+	} else {
+		if (write || vma->vm_ops->map_pages != filemap_map_pages)
+			goto out_rcu;
+		page = spf_find_file_page(vma, address);
+		if (!page)
+			goto out_rcu;
+	}
+
+	local_irq_disable();
+	pgdp = pgd_offset(mm, address);
+	pgdval = READ_ONCE(*pgdp);
+	if (pgd_none(pgdval) || unlikely(pgd_bad(pgdval)))
+		goto out_walk;
+	p4dp = p4d_offset(&pgdval, address);
+	p4dval = READ_ONCE(*p4dp);
+	if (p4d_none(p4dval) || unlikely(p4d_bad(p4dval)))
+		goto out_walk;
+	pudp = pud_offset(&p4dval, address);
+	pudval = READ_ONCE(*pudp);
+	if (pud_none(pudval) || pud_trans_huge(pudval) ||
+	    pud_devmap(pudval) || unlikely(pud_bad(pudval)))
+		goto out_walk;
+	pmdp = pmd_offset(&pudval, address);
+	pmdval = READ_ONCE(*pmdp);
+	if (pmd_none(pmdval) || pmd_trans_huge(pmdval) ||
+	    pmd_devmap(pmdval) || unlikely(pmd_bad(pmdval)))
+		goto out_walk;
+
+	/*
+	 * A trylock, as the holder may be waiting for a TLB flush IPI that
+	 * cannot reach us with interrupts off.
+	 */
+	ptl = pte_lockptr(mm, &pmdval);
+	pte = pte_offset_map(&pmdval, address);
+	if (!spin_trylock(ptl)) {
+		pte_unmap(pte);
+		goto out_walk;
+	}
+	if (!pte_none(*pte) || !pmd_same(pmdval, READ_ONCE(*pmdp)) ||
+	    read_seqcount_retry(&vma->vm_sequence, seq)) {
+		pte_unmap_unlock(pte, ptl);
+		goto out_walk;
+	}
+
+	if (zero) {
+		entry = pte_mkspecial(pfn_pte(my_zero_pfn(address),
+					      vma->vm_page_prot));
+	} else if (anon) {
+		entry = mk_pte(page, vma->vm_page_prot);
+		entry = pte_mkwrite(pte_mkdirty(entry));
+		inc_mm_counter_fast(mm, MM_ANONPAGES);
+		page_add_new_anon_rmap(page, vma, address, false);
+	} else {
+		flush_icache_page(vma, page);
+		entry = mk_pte(page, vma->vm_page_prot);
+		inc_mm_counter_fast(mm, mm_counter_file(page));
+		page_add_file_rmap(page, false);
+	}
+	set_pte_at(mm, address, pte, entry);
+	update_mmu_cache(vma, address, pte);
+	/*
+	 * The pte lock now holds off anyone tearing the table down, and
+	 * the memcg commit below wants interrupts on.
+	 */
+	local_irq_enable();
+
+	if (anon && !zero) {
+		mem_cgroup_commit_charge(page, memcg, false, false);
+		lru_cache_add_active_or_unevictable(page, vma);
+	}
+	pte_unmap_unlock(pte, ptl);
+	if (!anon)
+		unlock_page(page);
+	rcu_read_unlock();
+
+	count_vm_event(PGFAULT);
+	count_vm_event(SPECULATIVE_PGFAULT);
+	count_memcg_event_mm(mm, PGFAULT);
+	check_sync_rss_stat(current);
+	return 0;
+
+out_walk:
+	local_irq_enable();
+	if (page) {
+		if (anon)
+			mem_cgroup_cancel_charge(page, memcg, false);
+		else
+			unlock_page(page);
+		put_page(page);
+	}
+out_rcu:
+	rcu_read_unlock();
+	return VM_FAULT_RETRY;
+}
+#endif /* CONFIG_SPECULATIVE_PAGE_FAULT */
+
 #ifndef __PAGETABLE_P4D_FOLDED
 /*
  * Allocate p4d page table.
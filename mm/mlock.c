@@ -570,10 +570,12 @@ static int mlock_fixup(struct vm_area_struct *vma, struct vm_area_struct **prev,
 	 * set VM_LOCKED, populate_vma_page_range will bring it back.
 	 */
 
+	vm_write_begin(vma);
 	if (lock)
 		vma->vm_flags = newflags;
 	else
 		munlock_vma_pages_range(vma, start, end);
+	vm_write_end(vma);
 
 out:
 	*prev = vma;
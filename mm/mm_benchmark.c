@@ -0,0 +1,233 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Micro-benchmarks of mm hot paths, driven from userspace through
+ * /sys/kernel/debug/mm_benchmark like gup_benchmark.
+ *
+ * MM_BENCH_FAULT times the page faults taken while touching a range of
+ * the caller's address space. The range is zapped before each iteration,
+ * so what is measured depends on the mapping userspace set up: anonymous,
+ * file backed or THP (fault one byte per huge page with a huge stride).
+ *
+ * MM_BENCH_DMABUF_MAP times CPU access to a dma-buf, e.g. one allocated
+ * from ION: begin_cpu_access, kmap, touch and kunmap of each page, and
+ * end_cpu_access. kmap is used rather than vmap, which ION doesn't
+ * implement.
+ *
+ * Both report nanoseconds and CPU cycles, and the CPU they ran on. Per-CPU
+ * scaling is measured by issuing the ioctl from several pinned threads, see
+ * tools/testing/selftests/vm/mm_benchmark.c.
+ */
+
+#include <linux/debugfs.h>
+#include <linux/dma-buf.h>
+#include <linux/kernel.h>
+#include <linux/ktime.h>
+#include <linux/mm.h>
+#include <linux/sched.h>
+#include <linux/timex.h>
+#include <linux/uaccess.h>
+
+#define MM_BENCH_FAULT		_IOWR('b', 1, struct mm_benchmark)
+#define MM_BENCH_DMABUF_MAP	_IOWR('b', 2, struct mm_benchmark)
+
+#define MM_BENCH_WRITE		0x1
+
+struct mm_benchmark {
+	__u64 delta_nsec;
+	__u64 delta_cycles;
+	__u64 addr;
+	__u64 size;
+	__u64 stride;
+	__u32 nr_iter;
+	__u32 flags;
+	__s32 fd;
+	__u32 cpu;
+};
+
+/* Same restrictions as MADV_DONTNEED */
+static int mm_bench_zap(unsigned long start, unsigned long size)
+{
+	struct mm_struct *mm = current->mm;
+	struct vm_area_struct *vma;
+	int ret = -EINVAL;
+
+	down_read(&mm->mmap_sem);
+	vma = find_vma(mm, start);
+	if (vma && vma->vm_start <= start && start + size <= vma->vm_end &&
+	    !(vma->vm_flags & (VM_LOCKED | VM_HUGETLB | VM_PFNMAP))) {
+		zap_page_range(vma, start, size);
+		ret = 0;
+	}
+	up_read(&mm->mmap_sem);
+
+	return ret;
+}
+
+static int mm_bench_fault(struct mm_benchmark *bench)
+{
+	unsigned long addr, end = bench->addr + bench->size;
+	u64 nsec = 0, cycles = 0;
+	ktime_t start_time;
+	cycles_t start;
+	unsigned int i;
+	int ret;
+
+	/* keeps addr + stride from wrapping around in the loop below */
+	if (!bench->stride || bench->stride > bench->size ||
+	    end < bench->addr || end > TASK_SIZE)
+		return -EINVAL;
+
+	for (i = 0; i < bench->nr_iter; i++) {
+		ret = mm_bench_zap(bench->addr, bench->size);
+		if (ret)
+			return ret;
+
+		start_time = ktime_get();
+		start = get_cycles();
+		for (addr = bench->addr; addr < end; addr += bench->stride) {
+			char __user *p = (char __user *)addr;
+			char c;
+
+			if (bench->flags & MM_BENCH_WRITE)
+				ret = put_user(0, p);
+			else
+				ret = get_user(c, p);
+			if (ret)
+				break;
+		}
+		cycles += get_cycles() - start;
+		nsec += ktime_to_ns(ktime_sub(ktime_get(), start_time));
+
+		if (ret) {
+			bench->size = addr - bench->addr;
+			break;
+		}
+		cond_resched();
+	}
+
+	bench->delta_nsec = nsec;
+	bench->delta_cycles = cycles;
+	return 0;
+}
+
+#ifdef CONFIG_DMA_SHARED_BUFFER
+static int mm_bench_dmabuf_touch(struct dma_buf *dmabuf,
+				 struct mm_benchmark *bench)
+{
+	enum dma_data_direction dir = bench->flags & MM_BENCH_WRITE ?
+				      DMA_BIDIRECTIONAL : DMA_FROM_DEVICE;
+	unsigned long pgnum;
+	char *vaddr;
+	int ret;
+
+	ret = dma_buf_begin_cpu_access(dmabuf, dir);
+	if (ret)
+		return ret;
+
+	for (pgnum = 0; pgnum < PAGE_ALIGN(dmabuf->size) >> PAGE_SHIFT;
+	     pgnum++) {
+		vaddr = dma_buf_kmap(dmabuf, pgnum);
+		if (!vaddr) {
+			ret = -ENOMEM;
+			break;
+		}
+
+		if (bench->flags & MM_BENCH_WRITE)
+			WRITE_ONCE(vaddr[0], 0);
+		else
+			(void)READ_ONCE(vaddr[0]);
+
+		dma_buf_kunmap(dmabuf, pgnum, vaddr);
+	}
+
+	dma_buf_end_cpu_access(dmabuf, dir);
+	return ret;
+}
+
+static int mm_bench_dmabuf_map(struct mm_benchmark *bench)
+{
+	u64 nsec = 0, cycles = 0;
+	struct dma_buf *dmabuf;
+	ktime_t start_time;
+	cycles_t start;
+	unsigned int i;
+	int ret = 0;
+
+	dmabuf = dma_buf_get(bench->fd);
+	if (IS_ERR(dmabuf))
+		return PTR_ERR(dmabuf);
+
+	for (i = 0; i < bench->nr_iter; i++) {
+		start_time = ktime_get();
+		start = get_cycles();
+		ret = mm_bench_dmabuf_touch(dmabuf, bench);
+		cycles += get_cycles() - start;
+		nsec += ktime_to_ns(ktime_sub(ktime_get(), start_time));
+		if (ret)
+			break;
+		cond_resched();
+	}
+
+	bench->size = dmabuf->size;
+	bench->delta_nsec = nsec;
+	bench->delta_cycles = cycles;
+	dma_buf_put(dmabuf);
+	return ret;
+}
+#else
+static int mm_bench_dmabuf_map(struct mm_benchmark *bench)
+{
+	return -ENODEV;
+}
+#endif
+
+static long mm_benchmark_ioctl(struct file *filep, unsigned int cmd,
+		unsigned long arg)
+{
+	struct mm_benchmark bench;
+	int ret;
+
+	if (copy_from_user(&bench, (void __user *)arg, sizeof(bench)))
+		return -EFAULT;
+
+	if (!bench.nr_iter)
+		bench.nr_iter = 1;
+	bench.cpu = raw_smp_processor_id();
+
+	switch (cmd) {
+	case MM_BENCH_FAULT:
+		ret = mm_bench_fault(&bench);
+		break;
+	case MM_BENCH_DMABUF_MAP:
+		ret = mm_bench_dmabuf_map(&bench);
+		break;
+	default:
+		return -EINVAL;
+	}
+	if (ret)
+		return ret;
+
+	if (copy_to_user((void __user *)arg, &bench, sizeof(bench)))
+		return -EFAULT;
+
+	return 0;
+}
+
+static const struct file_operations mm_benchmark_fops = {
+	.open = nonseekable_open,
+	.unlocked_ioctl = mm_benchmark_ioctl,
+};
+
+static int mm_benchmark_init(void)
+{
+	void *ret;
+
+	ret = debugfs_create_file_unsafe("mm_benchmark", 0600, NULL, NULL,
+			&mm_benchmark_fops);
+	if (!ret)
+		pr_warn("Failed to create mm_benchmark in debugfs");
+
+	return 0;
+}
+
+late_initcall(mm_benchmark_init);
@@ -63,6 +63,7 @@
 #include <linux/page_owner.h>
 #include <linux/kthread.h>
 #include <linux/memcontrol.h>
+#include <linux/vmpressure.h>
 #include <linux/ftrace.h>
 #include <linux/lockdep.h>
 #include <linux/nmi.h>
@@ -1184,6 +1185,150 @@ static void free_one_page(struct zone *zone,
 	spin_unlock(&zone->lock);
 }
 
+/* Used by zones whose pagesets are not set up, see setup_pageset() users */
+static DEFINE_PER_CPU(struct per_cpu_pageset, boot_pageset);
+
+#ifdef CONFIG_PCP_HIGH_ORDER
+static const unsigned int pcp_high_orders[NR_PCP_HIGH_ORDERS] = {
+	4, 8,
+#ifdef CONFIG_TRANSPARENT_HUGEPAGE
+	HPAGE_PMD_ORDER,
+#endif
+};
+
+static int pcp_high_order_index(unsigned int order)
+{
+	int idx;
+
+	for (idx = 0; idx < NR_PCP_HIGH_ORDERS; idx++) {
+		if (pcp_high_orders[idx] == order)
+			return idx;
+	}
+	return -1;
+}
+
+/* Room for the order-0 high mark, and always for one of the largest blocks */
+static int pcp_high_order_limit(struct per_cpu_pages *pcp)
+{
+	return max(pcp->high, 1 << pcp_high_orders[NR_PCP_HIGH_ORDERS - 1]);
+}
+
+static inline int pcp_high_order_count(struct per_cpu_pages *pcp)
+{
+	return pcp->ho_count;
+}
+
+static void pcp_high_order_init(struct per_cpu_pages *pcp)
+{
+	int idx, mt;
+
+	pcp->ho_count = 0;
+	for (idx = 0; idx < NR_PCP_HIGH_ORDERS; idx++)
+		for (mt = 0; mt < MIGRATE_PCPTYPES; mt++)
+			INIT_LIST_HEAD(&pcp->ho_lists[idx][mt]);
+}
+
+/*
+ * Give at least @count pages back to the buddy allocator, from the cold
+ * end of the lists and the largest order first.
+ */
+static void free_pcp_high_order_bulk(struct zone *zone,
+				     struct per_cpu_pages *pcp, int count)
+{
+	bool isolated_pageblocks;
+	int idx, mt;
+
+	spin_lock(&zone->lock);
+	isolated_pageblocks = has_isolate_pageblock(zone);
+	for (idx = NR_PCP_HIGH_ORDERS - 1; idx >= 0 && count > 0; idx--) {
+		unsigned int order = pcp_high_orders[idx];
+
+		for (mt = 0; mt < MIGRATE_PCPTYPES && count > 0; mt++) {
+			struct list_head *list = &pcp->ho_lists[idx][mt];
+
+			while (count > 0 && !list_empty(list)) {
+				struct page *page;
+				int pmt;
+
+				page = list_last_entry(list, struct page, lru);
+				list_del(&page->lru);
+				pcp->ho_count -= 1 << order;
+				count -= 1 << order;
+
+				pmt = get_pcppage_migratetype(page);
+				/* the pageblock may have been isolated since */
+				if (unlikely(isolated_pageblocks))
+					pmt = get_pageblock_migratetype(page);
+				__free_one_page(page, page_to_pfn(page), zone,
+						order, pmt);
+				trace_mm_page_pcpu_drain(page, order, pmt);
+			}
+		}
+	}
+	spin_unlock(&zone->lock);
+}
+
+/*
+ * Put a freed high-order block on this cpu's lists instead of the buddy
+ * allocator.  Returns false if the caller has to free it to the zone.
+ * Interrupts must be disabled.
+ */
+static bool free_pcp_high_order(struct page *page, unsigned int order,
+				int migratetype)
+{
+	struct zone *zone = page_zone(page);
+	struct per_cpu_pages *pcp;
+	int idx = pcp_high_order_index(order);
+	int limit;
+
+	if (idx < 0 || migratetype >= MIGRATE_PCPTYPES)
+		return false;
+	if (unlikely(has_isolate_pageblock(zone)))
+		return false;
+	/* let it merge back while the zone is short of free memory */
+	if (zone_page_state(zone, NR_FREE_PAGES) < low_wmark_pages(zone))
+		return false;
+
+	/*
+	 * The boot pageset is shared by every zone, and pages parked on it
+	 * could be freed under the wrong zone->lock.
+	 */
+	if (unlikely(zone->pageset == &boot_pageset))
+		return false;
+	pcp = &this_cpu_ptr(zone->pageset)->pcp;
+	if (!pcp->high)
+		return false;
+	set_pcppage_migratetype(page, migratetype);
+	list_add(&page->lru, &pcp->ho_lists[idx][migratetype]);
+	pcp->ho_count += 1 << order;
+
+	limit = pcp_high_order_limit(pcp);
+	if (pcp->ho_count > limit)
+		free_pcp_high_order_bulk(zone, pcp, pcp->ho_count - limit);
+	return true;
+}
+#else
+static inline int pcp_high_order_count(struct per_cpu_pages *pcp)
+{
+	return 0;
+}
+
+static inline void pcp_high_order_init(struct per_cpu_pages *pcp)
+{
+}
+
+static inline void free_pcp_high_order_bulk(struct zone *zone,
+				struct per_cpu_pages *pcp, int count)
+{
+}
+
+static inline bool free_pcp_high_order(struct page *page, unsigned int order,
+				int migratetype)
+{
+	return false;
+}
+#endif /* CONFIG_PCP_HIGH_ORDER */
+
 static void __meminit __init_single_page(struct page *page, unsigned long pfn,
 				unsigned long zone, int nid)
 {
@@ -1264,7 +1409,8 @@ static void __free_pages_ok(struct page *page, unsigned int order)
 	migratetype = get_pfnblock_migratetype(page, pfn);
 	local_irq_save(flags);
 	__count_vm_events(PGFREE, 1 << order);
-	free_one_page(page_zone(page), page, pfn, order, migratetype);
+	if (!free_pcp_high_order(page, order, migratetype))
+		free_one_page(page_zone(page), page, pfn, order, migratetype);
 	local_irq_restore(flags);
 }
 
@@ -2560,6 +2706,8 @@ static void drain_pages_zone(unsigned int cpu, struct zone *zone)
 	pcp = &pset->pcp;
 	if (pcp->count)
 		free_pcppages_bulk(zone, pcp->count, pcp);
+	if (pcp_high_order_count(pcp))
+		free_pcp_high_order_bulk(zone, pcp, pcp_high_order_count(pcp));
 	local_irq_restore(flags);
 }
 
@@ -2657,12 +2805,13 @@ void drain_all_pages(struct zone *zone)
 
 		if (zone) {
 			pcp = per_cpu_ptr(zone->pageset, cpu);
-			if (pcp->pcp.count)
+			if (pcp->pcp.count || pcp_high_order_count(&pcp->pcp))
 				has_pcps = true;
 		} else {
 			for_each_populated_zone(z) {
 				pcp = per_cpu_ptr(z->pageset, cpu);
-				if (pcp->pcp.count) {
+				if (pcp->pcp.count ||
+				    pcp_high_order_count(&pcp->pcp)) {
 					has_pcps = true;
 					break;
 				}
@@ -2983,8 +3132,49 @@ static struct page *rmqueue_pcplist(struct zone *preferred_zone,
 	return page;
 }
 
+#ifdef CONFIG_PCP_HIGH_ORDER
+/* Take a block off this cpu's high-order lists, if it has one cached */
+static struct page *rmqueue_pcp_high_order(struct zone *preferred_zone,
+			struct zone *zone, unsigned int order, int migratetype)
+{
+	struct per_cpu_pages *pcp;
+	struct list_head *list;
+	struct page *page = NULL;
+	unsigned long flags;
+	int idx = pcp_high_order_index(order);
+
+	if (idx < 0 || migratetype >= MIGRATE_PCPTYPES)
+		return NULL;
+
+	local_irq_save(flags);
+	pcp = &this_cpu_ptr(zone->pageset)->pcp;
+	list = &pcp->ho_lists[idx][migratetype];
+	while (!list_empty(list)) {
+		page = list_first_entry(list, struct page, lru);
+		list_del(&page->lru);
+		pcp->ho_count -= 1 << order;
+		if (!check_new_pages(page, order))
+			break;
+		page = NULL;
+	}
+	if (page) {
+		__count_zid_vm_events(PGALLOC, page_zonenum(page), 1 << order);
+		zone_statistics(preferred_zone, zone);
+	}
+	local_irq_restore(flags);
+	return page;
+}
+#else
+static inline struct page *rmqueue_pcp_high_order(struct zone *preferred_zone,
+			struct zone *zone, unsigned int order, int migratetype)
+{
+	return NULL;
+}
+#endif
+
 /*
- * Allocate a page from the given zone. Use pcplists for order-0 allocations.
+ * Allocate a page from the given zone. Use pcplists for order-0 allocations,
+ * and for the cached high orders when CONFIG_PCP_HIGH_ORDER is set.
  */
 static inline
 struct page *rmqueue(struct zone *preferred_zone,
@@ -3006,6 +3196,11 @@ struct page *rmqueue(struct zone *preferred_zone,
 	 * allocate greater than order-1 page units with __GFP_NOFAIL.
 	 */
 	WARN_ON_ONCE((gfp_flags & __GFP_NOFAIL) && (order > 1));
+
+	page = rmqueue_pcp_high_order(preferred_zone, zone, order, migratetype);
+	if (page)
+		goto out;
+
 	spin_lock_irqsave(&zone->lock, flags);
 
 	do {
@@ -3566,14 +3761,17 @@ __alloc_pages_direct_compact(gfp_t gfp_mask, unsigned int order,
 {
 	struct page *page;
 	unsigned int noreclaim_flag;
+	u64 stall;
 
 	if (!order)
 		return NULL;
 
+	stall = vmpressure_stall_enter();
 	noreclaim_flag = memalloc_noreclaim_save();
 	*compact_result = try_to_compact_pages(gfp_mask, order, alloc_flags, ac,
 									prio);
 	memalloc_noreclaim_restore(noreclaim_flag);
+	vmpressure_stall_leave(stall, VMPRESSURE_STALL_COMPACT);
 
 	if (*compact_result <= COMPACT_INACTIVE)
 		return NULL;
@@ -3772,11 +3970,13 @@ __perform_reclaim(gfp_t gfp_mask, unsigned int order,
 	struct reclaim_state reclaim_state;
 	int progress;
 	unsigned int noreclaim_flag;
+	u64 stall;
 
 	cond_resched();
 
 	/* We now go into synchronous reclaim */
 	cpuset_memory_pressure_bump();
+	stall = vmpressure_stall_enter();
 	fs_reclaim_acquire(gfp_mask);
 	noreclaim_flag = memalloc_noreclaim_save();
 	reclaim_state.reclaimed_slab = 0;
@@ -3788,6 +3988,7 @@ __perform_reclaim(gfp_t gfp_mask, unsigned int order,
 	current->reclaim_state = NULL;
 	memalloc_noreclaim_restore(noreclaim_flag);
 	fs_reclaim_release(gfp_mask);
+	vmpressure_stall_leave(stall, VMPRESSURE_STALL_RECLAIM);
 
 	cond_resched();
 
@@ -5356,7 +5557,6 @@ static void build_zonelists(pg_data_t *pgdat)
  * Other parts of the kernel may not check if the zone is available.
  */
 static void setup_pageset(struct per_cpu_pageset *p, unsigned long batch);
-static DEFINE_PER_CPU(struct per_cpu_pageset, boot_pageset);
 static DEFINE_PER_CPU(struct per_cpu_nodestat, boot_nodestats);
 
 static void __build_all_zonelists(void *data)
@@ -5665,6 +5865,7 @@ static void pageset_init(struct per_cpu_pageset *p)
 	pcp->count = 0;
 	for (migratetype = 0; migratetype < MIGRATE_PCPTYPES; migratetype++)
 		INIT_LIST_HEAD(&pcp->lists[migratetype]);
+	pcp_high_order_init(pcp);
 }
 
 static void setup_pageset(struct per_cpu_pageset *p, unsigned long batch)
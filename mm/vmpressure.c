@@ -22,6 +22,10 @@
 #include <linux/slab.h>
 #include <linux/swap.h>
 #include <linux/printk.h>
+#include <linux/proc_fs.h>
+#include <linux/seq_file.h>
+#include <linux/poll.h>
+#include <linux/uaccess.h>
 #include <linux/vmpressure.h>
 
 /*
@@ -440,6 +444,277 @@ void vmpressure_unregister_event(struct mem_cgroup *memcg,
 	mutex_unlock(&vmpr->events_lock);
 }
 
+/*
+ * Time based stall accounting
+ *
+ * The scanned/reclaimed ratio says how hard reclaim works, not how much
+ * the tasks that wait for it suffer. So we also account the time tasks
+ * spend stalled on memory: in direct reclaim, in direct compaction, and
+ * waiting for the read of a page that was refaulted while still in the
+ * workingset (thrashing). "some" is the wall time during which at least
+ * one task was stalled, the per-type values sum the time of all tasks.
+ *
+ * /proc/vmpressure shows all of them in microseconds. Writing
+ * "<stall us> <window us>" to an open file arms a trigger on it: poll()
+ * then reports POLLPRI whenever "some" grew by at least the stall time
+ * within one window, at most once per window.
+ */
+#define VMSTALL_WINDOW_MIN_US	(500 * USEC_PER_MSEC)
+#define VMSTALL_WINDOW_MAX_US	(10 * USEC_PER_SEC)
+
+static const char * const vmpressure_str_stalls[] = {
+	[VMPRESSURE_STALL_RECLAIM] = "reclaim",
+	[VMPRESSURE_STALL_COMPACT] = "compaction",
+	[VMPRESSURE_STALL_THRASHING] = "thrashing",
+};
+
+struct vmstall_trigger {
+	struct list_head node;
+	u64 threshold;
+	u64 window;
+	/* start time and "some" value of the current window */
+	u64 win_start;
+	u64 win_some;
+	u64 last_event;
+	int event;
+	wait_queue_head_t wait;
+};
+
+/*
+ * Stalling tasks only share vmstall_nr_tasks. The per-type times are per
+ * cpu, and the "some" clock is only touched when the number of stalled
+ * tasks goes from or to zero.
+ */
+static atomic_t vmstall_nr_tasks = ATOMIC_INIT(0);
+static DEFINE_PER_CPU(u64 [VMPRESSURE_NUM_STALLS], vmstall_total);
+
+/* protects the "some" clock */
+static DEFINE_SPINLOCK(vmstall_some_lock);
+static bool vmstall_some_running;
+static u64 vmstall_some_start;
+static u64 vmstall_some_total;
+
+/* protects the triggers */
+static DEFINE_SPINLOCK(vmstall_trigger_lock);
+static LIST_HEAD(vmstall_triggers);
+
+/* start or stop the "some" clock after vmstall_nr_tasks left or hit 0 */
+static void vmstall_some_sync(void)
+{
+	bool stalled;
+	u64 now;
+
+	spin_lock(&vmstall_some_lock);
+	now = ktime_get_ns();
+	stalled = atomic_read(&vmstall_nr_tasks) > 0;
+	if (stalled && !vmstall_some_running)
+		vmstall_some_start = now;
+	else if (!stalled && vmstall_some_running)
+		vmstall_some_total += now - vmstall_some_start;
+	vmstall_some_running = stalled;
+	spin_unlock(&vmstall_some_lock);
+}
+
+static u64 vmstall_some(u64 now)
+{
+	u64 some;
+
+	spin_lock(&vmstall_some_lock);
+	some = vmstall_some_total;
+	if (vmstall_some_running && now > vmstall_some_start)
+		some += now - vmstall_some_start;
+	spin_unlock(&vmstall_some_lock);
+
+	return some;
+}
+
+/* must be called with vmstall_trigger_lock held */
+static void vmstall_update_triggers(u64 now)
+{
+	struct vmstall_trigger *t;
+	u64 some = vmstall_some(now);
+
+	list_for_each_entry(t, &vmstall_triggers, node) {
+		if (now - t->win_start >= t->window) {
+			t->win_start = now;
+			t->win_some = some;
+		}
+		if (some - t->win_some < t->threshold)
+			continue;
+		/* one event per window */
+		if (t->last_event && now - t->last_event < t->window)
+			continue;
+		t->last_event = now;
+		t->event = 1;
+		wake_up_interruptible(&t->wait);
+	}
+}
+
+/**
+ * vmpressure_stall_enter() - Mark the current task as stalled on memory
+ *
+ * Returns the value to pass to vmpressure_stall_leave(). Nested stalls,
+ * e.g. a thrashing refault from within reclaim, are only accounted once.
+ */
+u64 vmpressure_stall_enter(void)
+{
+	u64 now;
+
+	if (current->flags & PF_MEMSTALL)
+		return 0;
+	current->flags |= PF_MEMSTALL;
+
+	now = ktime_get_ns();
+	if (atomic_inc_return(&vmstall_nr_tasks) == 1)
+		vmstall_some_sync();
+
+	return now;
+}
+
+/**
+ * vmpressure_stall_leave() - End a stall started by vmpressure_stall_enter()
+ * @start:	return value of vmpressure_stall_enter()
+ * @type:	what the task stalled on
+ */
+void vmpressure_stall_leave(u64 start, enum vmpressure_stall_type type)
+{
+	u64 now;
+
+	if (!start)
+		return;
+	current->flags &= ~PF_MEMSTALL;
+
+	now = ktime_get_ns();
+	this_cpu_add(vmstall_total[type], now - start);
+	if (atomic_dec_and_test(&vmstall_nr_tasks))
+		vmstall_some_sync();
+
+	/*
+	 * Triggers only need one task to look at them at a time, the others
+	 * don't wait for it.
+	 */
+	if (list_empty(&vmstall_triggers) ||
+	    !spin_trylock(&vmstall_trigger_lock))
+		return;
+	vmstall_update_triggers(now);
+	spin_unlock(&vmstall_trigger_lock);
+}
+
+#ifdef CONFIG_PROC_FS
+static int vmstall_show(struct seq_file *m, void *v)
+{
+	u64 total[VMPRESSURE_NUM_STALLS] = { 0 };
+	u64 some = vmstall_some(ktime_get_ns());
+	int cpu, i;
+
+	for_each_possible_cpu(cpu)
+		for (i = 0; i < VMPRESSURE_NUM_STALLS; i++)
+			total[i] += per_cpu(vmstall_total, cpu)[i];
+
+	seq_printf(m, "some %llu\n", div_u64(some, NSEC_PER_USEC));
+	for (i = 0; i < VMPRESSURE_NUM_STALLS; i++)
+		seq_printf(m, "%s %llu\n", vmpressure_str_stalls[i],
+			   div_u64(total[i], NSEC_PER_USEC));
+
+	return 0;
+}
+
+static int vmstall_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, vmstall_show, NULL);
+}
+
+static ssize_t vmstall_write(struct file *file, const char __user *ubuf,
+			     size_t count, loff_t *ppos)
+{
+	struct seq_file *m = file->private_data;
+	struct vmstall_trigger *t;
+	u64 threshold, window, now;
+	char buf[32];
+	size_t len;
+
+	len = min(count, sizeof(buf) - 1);
+	if (copy_from_user(buf, ubuf, len))
+		return -EFAULT;
+	buf[len] = '\0';
+
+	if (sscanf(buf, "%llu %llu", &threshold, &window) != 2)
+		return -EINVAL;
+	if (window < VMSTALL_WINDOW_MIN_US || window > VMSTALL_WINDOW_MAX_US)
+		return -EINVAL;
+	if (!threshold || threshold > window)
+		return -EINVAL;
+
+	t = kzalloc(sizeof(*t), GFP_KERNEL);
+	if (!t)
+		return -ENOMEM;
+	t->threshold = threshold * NSEC_PER_USEC;
+	t->window = window * NSEC_PER_USEC;
+	init_waitqueue_head(&t->wait);
+
+	/* one trigger per open file */
+	if (cmpxchg(&m->private, NULL, t)) {
+		kfree(t);
+		return -EBUSY;
+	}
+
+	now = ktime_get_ns();
+	spin_lock(&vmstall_trigger_lock);
+	t->win_start = now;
+	t->win_some = vmstall_some(now);
+	list_add(&t->node, &vmstall_triggers);
+	spin_unlock(&vmstall_trigger_lock);
+
+	return count;
+}
+
+static __poll_t vmstall_poll(struct file *file, poll_table *wait)
+{
+	struct seq_file *m = file->private_data;
+	struct vmstall_trigger *t = READ_ONCE(m->private);
+
+	if (!t)
+		return DEFAULT_POLLMASK | EPOLLERR | EPOLLPRI;
+
+	poll_wait(file, &t->wait, wait);
+	if (cmpxchg(&t->event, 1, 0) == 1)
+		return EPOLLPRI;
+
+	return 0;
+}
+
+static int vmstall_release(struct inode *inode, struct file *file)
+{
+	struct seq_file *m = file->private_data;
+	struct vmstall_trigger *t = m->private;
+
+	if (t) {
+		spin_lock(&vmstall_trigger_lock);
+		list_del(&t->node);
+		spin_unlock(&vmstall_trigger_lock);
+		kfree(t);
+	}
+
+	return single_release(inode, file);
+}
+
+static const struct file_operations vmstall_fops = {
+	.open		= vmstall_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.write		= vmstall_write,
+	.poll		= vmstall_poll,
+	.release	= vmstall_release,
+};
+
+static int __init vmstall_proc_init(void)
+{
+	proc_create("vmpressure", 0644, NULL, &vmstall_fops);
+	return 0;
+}
+module_init(vmstall_proc_init);
+#endif /* CONFIG_PROC_FS */
+
 /**
  * vmpressure_init() - Initialize vmpressure control structure
  * @vmpr:	Structure to be initialized
@@ -49,6 +49,7 @@
 #include <linux/prefetch.h>
 #include <linux/printk.h>
 #include <linux/dax.h>
+#include <linux/memory_hotplug.h>
 
 #include <asm/tlbflush.h>
 #include <asm/div64.h>
@@ -160,6 +161,15 @@ struct scan_control {
  * From 0 .. 100.  Higher means more swappy.
  */
 int vm_swappiness = 60;
+/*
+ * Number of kswapd threads per node.  The extra threads run the same
+ * balance_pgdat() loop as the main one; each isolates its own
+ * SWAP_CLUSTER_MAX batches off the LRU tails and the shared memcg reclaim
+ * iterator hands them different cgroups, so they work disjoint parts of
+ * the LRUs and background reclaim scales with the number of cores.
+ */
+int kswapd_threads = 1;
+static int kswapd_threads_current = 1;
 /*
  * The total number of pages which are beyond the high watermark within all
  * zones.
@@ -1533,6 +1543,61 @@ unsigned long reclaim_clean_pages_from_list(struct zone *zone,
 	return ret;
 }
 
+#ifdef CONFIG_PROCESS_RECLAIM
+/**
+ * reclaim_pages_from_list - reclaim a list of isolated pages
+ * @page_list: pages isolated with isolate_lru_page() and accounted in
+ *	       NR_ISOLATED_ANON/NR_ISOLATED_FILE by the caller
+ *
+ * Reclaims the pages regardless of their references, writing dirty and
+ * anonymous pages out as needed, and puts back those that could not be
+ * reclaimed. @page_list is empty on return.
+ *
+ * Returns the number of pages reclaimed.
+ */
+unsigned long reclaim_pages_from_list(struct list_head *page_list)
+{
+	struct scan_control sc = {
+		.gfp_mask = GFP_KERNEL,
+		.priority = DEF_PRIORITY,
+		.may_writepage = 1,
+		.may_unmap = 1,
+		.may_swap = 1,
+	};
+	unsigned long nr_reclaimed = 0;
+	struct pglist_data *pgdat;
+	struct page *page, *next;
+	LIST_HEAD(node_list);
+
+	/* shrink_page_list() works on one node at a time */
+	while (!list_empty(page_list)) {
+		unsigned long nr_isolated[2] = { 0, };
+
+		pgdat = page_pgdat(lru_to_page(page_list));
+		list_for_each_entry_safe(page, next, page_list, lru) {
+			if (page_pgdat(page) != pgdat)
+				continue;
+			ClearPageActive(page);
+			nr_isolated[page_is_file_cache(page)]++;
+			list_move(&page->lru, &node_list);
+		}
+
+		nr_reclaimed += shrink_page_list(&node_list, pgdat, &sc,
+						 TTU_IGNORE_ACCESS, NULL, true);
+		mod_node_page_state(pgdat, NR_ISOLATED_ANON, -nr_isolated[0]);
+		mod_node_page_state(pgdat, NR_ISOLATED_FILE, -nr_isolated[1]);
+
+		while (!list_empty(&node_list)) {
+			page = lru_to_page(&node_list);
+			list_del(&page->lru);
+			putback_lru_page(page);
+		}
+	}
+
+	return nr_reclaimed;
+}
+#endif
+
 /*
  * Attempt to remove the specified page from its LRU.  Only take this page
  * if it is of the appropriate PageActive status.  Pages which are being
@@ -3907,9 +3972,16 @@ static int kswapd_cpu_online(unsigned int cpu)
 
 		mask = cpumask_of_node(pgdat->node_id);
 
-		if (cpumask_any_and(cpu_online_mask, mask) < nr_cpu_ids)
+		if (cpumask_any_and(cpu_online_mask, mask) < nr_cpu_ids) {
+			int hid;
+
 			/* One of our CPUs online: restore mask */
-			set_cpus_allowed_ptr(pgdat->kswapd, mask);
+			for (hid = 0; hid < MAX_KSWAPD_THREADS; hid++) {
+				if (pgdat->mkswapd[hid])
+					set_cpus_allowed_ptr(pgdat->mkswapd[hid],
+							     mask);
+			}
+		}
 	}
 	return 0;
 }
@@ -3921,20 +3993,41 @@ static int kswapd_cpu_online(unsigned int cpu)
 int kswapd_run(int nid)
 {
 	pg_data_t *pgdat = NODE_DATA(nid);
-	int ret = 0;
+	struct task_struct *tsk;
+	int hid;
 
-	if (pgdat->kswapd)
-		return 0;
+	for (hid = 0; hid < kswapd_threads_current; hid++) {
+		if (pgdat->mkswapd[hid])
+			continue;
 
-	pgdat->kswapd = kthread_run(kswapd, pgdat, "kswapd%d", nid);
-	if (IS_ERR(pgdat->kswapd)) {
-		/* failure at boot is fatal */
-		BUG_ON(system_state < SYSTEM_RUNNING);
-		pr_err("Failed to start kswapd on node %d\n", nid);
-		ret = PTR_ERR(pgdat->kswapd);
-		pgdat->kswapd = NULL;
+		if (hid)
+			tsk = kthread_run(kswapd, pgdat, "kswapd%d:%d",
+					  nid, hid);
+		else
+			tsk = kthread_run(kswapd, pgdat, "kswapd%d", nid);
+		if (IS_ERR(tsk)) {
+			/* failure at boot is fatal, for the main thread */
+			BUG_ON(!hid && system_state < SYSTEM_RUNNING);
+			pr_err("Failed to start kswapd%d:%d\n", nid, hid);
+			return PTR_ERR(tsk);
+		}
+		pgdat->mkswapd[hid] = tsk;
+	}
+	return 0;
+}
+
+/* Stop the threads of a node from thread @first on. */
+static void kswapd_stop_threads(int nid, int first)
+{
+	pg_data_t *pgdat = NODE_DATA(nid);
+	int hid;
+
+	for (hid = first; hid < MAX_KSWAPD_THREADS; hid++) {
+		if (pgdat->mkswapd[hid]) {
+			kthread_stop(pgdat->mkswapd[hid]);
+			pgdat->mkswapd[hid] = NULL;
+		}
 	}
-	return ret;
 }
 
 /*
@@ -3943,12 +4036,34 @@ int kswapd_run(int nid)
  */
 void kswapd_stop(int nid)
 {
-	struct task_struct *kswapd = NODE_DATA(nid)->kswapd;
+	kswapd_stop_threads(nid, 0);
+}
+
+static DEFINE_MUTEX(kswapd_threads_lock);
+
+int kswapd_threads_sysctl_handler(struct ctl_table *table, int write,
+				  void __user *buffer, size_t *length,
+				  loff_t *ppos)
+{
+	int rc, nid;
+
+	mutex_lock(&kswapd_threads_lock);
+	rc = proc_dointvec_minmax(table, write, buffer, length, ppos);
+	if (rc || !write || kswapd_threads == kswapd_threads_current)
+		goto out;
 
-	if (kswapd) {
-		kthread_stop(kswapd);
-		NODE_DATA(nid)->kswapd = NULL;
+	mem_hotplug_begin();
+	kswapd_threads_current = kswapd_threads;
+	for_each_node_state(nid, N_MEMORY) {
+		kswapd_stop_threads(nid, kswapd_threads_current);
+		rc = kswapd_run(nid);
+		if (rc)
+			break;
 	}
+	mem_hotplug_done();
+out:
+	mutex_unlock(&kswapd_threads_lock);
+	return rc;
 }
 
 static int __init kswapd_init(void)
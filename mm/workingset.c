@@ -223,6 +223,73 @@ void *workingset_eviction(struct address_space *mapping, struct page *page)
 	return pack_shadow(memcgid, pgdat, eviction);
 }
 
+/*
+ * Per-mm refault accounting
+ *
+ * Refaults are charged to the mm of the task that faults the page back
+ * in, which for page cache reads and mapped file faults is the task that
+ * wanted the data. Refaults from kernel threads, such as readahead done
+ * on behalf of nobody in particular, are not charged.
+ *
+ * Refaults that activate the page mean the mm lost a page of its working
+ * set to reclaim and had to read it back: it is thrashing. Those are also
+ * kept in a counter that halves every MM_THRASHING_DECAY_PERIOD, so it
+ * tracks how many pages the mm recently could not keep resident. Added to
+ * its RSS that estimates the memory the mm needs to stop thrashing.
+ */
+#define MM_THRASHING_DECAY_PERIOD	(10 * HZ)
+
+static void mm_thrashing_decay(struct mm_refault_stat *stat)
+{
+	unsigned long stamp = READ_ONCE(stat->thrashing_stamp);
+	unsigned long periods;
+	long old, new;
+
+	periods = (jiffies - stamp) / MM_THRASHING_DECAY_PERIOD;
+	if (!periods)
+		return;
+
+	/* whoever moves the stamp does the decay */
+	if (cmpxchg(&stat->thrashing_stamp, stamp,
+		    stamp + periods * MM_THRASHING_DECAY_PERIOD) != stamp)
+		return;
+
+	do {
+		old = atomic_long_read(&stat->thrashing);
+		new = periods < BITS_PER_LONG ? old >> periods : 0;
+	} while (atomic_long_cmpxchg(&stat->thrashing, old, new) != old);
+}
+
+static void mm_workingset_refault(struct mm_struct *mm, bool activate)
+{
+	struct mm_refault_stat *stat;
+
+	if (!mm)
+		return;
+
+	stat = &mm->refault_stat;
+	atomic_long_inc(&stat->refaults);
+	if (!activate)
+		return;
+
+	atomic_long_inc(&stat->activations);
+	mm_thrashing_decay(stat);
+	atomic_long_inc(&stat->thrashing);
+}
+
+/**
+ * mm_workingset_thrashing - recent working set refaults of an mm
+ * @mm: the mm to query
+ *
+ * Returns the number of pages @mm recently had to refault because they
+ * were reclaimed while still in its working set, decayed over time.
+ */
+unsigned long mm_workingset_thrashing(struct mm_struct *mm)
+{
+	mm_thrashing_decay(&mm->refault_stat);
+	return atomic_long_read(&mm->refault_stat.thrashing);
+}
+
 /**
  * workingset_refault - evaluate the refault of a previously evicted page
  * @shadow: shadow entry of the evicted page
@@ -294,9 +361,11 @@ bool workingset_refault(void *shadow)
 	if (refault_distance <= active_file) {
 		inc_lruvec_state(lruvec, WORKINGSET_ACTIVATE);
 		rcu_read_unlock();
+		mm_workingset_refault(current->mm, true);
 		return true;
 	}
 	rcu_read_unlock();
+	mm_workingset_refault(current->mm, false);
 	return false;
 }
 
@@ -55,6 +55,7 @@
 #include <linux/migrate.h>
 #include <linux/pagemap.h>
 #include <linux/fs.h>
+#include <linux/workqueue.h>
 
 #define ZSPAGE_MAGIC	0x58
 
@@ -195,6 +196,22 @@ static struct vfsmount *zsmalloc_mnt;
 static const int fullness_threshold_frac = 4;
 static size_t huge_class_size;
 
+/*
+ * Background compaction: once the share of allocated but unused objects
+ * in a class reaches compact_fragmentation_percent, and at least one
+ * zspage could be freed, a per-pool worker compacts the pool in steps of
+ * at most compact_batch_pages freed pages. 0 disables it.
+ */
+static unsigned int zs_compact_fragmentation_percent = 25;
+module_param_named(compact_fragmentation_percent,
+		   zs_compact_fragmentation_percent, uint, 0644);
+
+static unsigned int zs_compact_batch_pages = 32;
+module_param_named(compact_batch_pages, zs_compact_batch_pages, uint, 0644);
+
+/* lets frees coalesce before the worker runs */
+#define ZS_COMPACT_DELAY	(HZ / 10)
+
 struct size_class {
 	spinlock_t lock;
 	struct list_head fullness_list[NR_ZS_FULLNESS];
@@ -260,6 +277,8 @@ struct zs_pool {
 
 	/* Compact classes */
 	struct shrinker shrinker;
+	/* Compact fragmented classes in the background */
+	struct delayed_work compact_work;
 
 #ifdef CONFIG_ZSMALLOC_STAT
 	struct dentry *stat_dentry;
@@ -296,6 +315,8 @@ struct mapping_area {
 	enum zs_mapmode vm_mm; /* mapping mode */
 };
 
+static void zs_compact_kick(struct zs_pool *pool, struct size_class *class);
+
 #ifdef CONFIG_COMPACTION
 static int zs_register_migration(struct zs_pool *pool);
 static void zs_unregister_migration(struct zs_pool *pool);
@@ -1588,7 +1609,7 @@ void zs_free(struct zs_pool *pool, unsigned long handle)
 	if (likely(!isolated))
 		free_zspage(pool, class, zspage);
 out:
-
+	zs_compact_kick(pool, class);
 	spin_unlock(&class->lock);
 	unpin_tag(handle);
 	cache_free_handle(pool, handle);
@@ -2214,14 +2235,22 @@ static unsigned long zs_can_compact(struct size_class *class)
 	return obj_wasted * class->pages_per_zspage;
 }
 
-static void __zs_compact(struct zs_pool *pool, struct size_class *class)
+/*
+ * Compacts @class until no more zspages can be freed or @budget pages have
+ * been freed. Returns the number of pages freed.
+ */
+static unsigned long __zs_compact(struct zs_pool *pool,
+				  struct size_class *class,
+				  unsigned long budget)
 {
 	struct zs_compact_control cc;
-	struct zspage *src_zspage;
+	struct zspage *src_zspage = NULL;
 	struct zspage *dst_zspage = NULL;
+	unsigned long pages_freed = 0;
 
 	spin_lock(&class->lock);
-	while ((src_zspage = isolate_zspage(class, true))) {
+	while (pages_freed < budget &&
+	       (src_zspage = isolate_zspage(class, true))) {
 
 		if (!zs_can_compact(class))
 			break;
@@ -2249,7 +2278,9 @@ static void __zs_compact(struct zs_pool *pool, struct size_class *class)
 		if (putback_zspage(class, src_zspage) == ZS_EMPTY) {
 			free_zspage(pool, class, src_zspage);
 			pool->stats.pages_compacted += class->pages_per_zspage;
+			pages_freed += class->pages_per_zspage;
 		}
+		src_zspage = NULL;
 		spin_unlock(&class->lock);
 		cond_resched();
 		spin_lock(&class->lock);
@@ -2259,6 +2290,65 @@ static void __zs_compact(struct zs_pool *pool, struct size_class *class)
 		putback_zspage(class, src_zspage);
 
 	spin_unlock(&class->lock);
+
+	return pages_freed;
+}
+
+/*
+ * A class is worth compacting in the background when at least one zspage
+ * can be freed and the unused share of its allocated objects has reached
+ * compact_fragmentation_percent. Stats are read locklessly, this is only a
+ * hint.
+ */
+static bool zs_class_fragmented(struct size_class *class)
+{
+	unsigned int pct = READ_ONCE(zs_compact_fragmentation_percent);
+	unsigned long obj_allocated = zs_stat_get(class, OBJ_ALLOCATED);
+	unsigned long obj_used = zs_stat_get(class, OBJ_USED);
+
+	if (!pct || !zs_can_compact(class))
+		return false;
+
+	return (obj_allocated - obj_used) * 100 >= obj_allocated * pct;
+}
+
+static void zs_compact_kick(struct zs_pool *pool, struct size_class *class)
+{
+	if (delayed_work_pending(&pool->compact_work))
+		return;
+
+	if (zs_class_fragmented(class))
+		queue_delayed_work(system_power_efficient_wq,
+				   &pool->compact_work, ZS_COMPACT_DELAY);
+}
+
+static void zs_compact_work(struct work_struct *work)
+{
+	struct zs_pool *pool = container_of(to_delayed_work(work),
+					    struct zs_pool, compact_work);
+	unsigned long budget = READ_ONCE(zs_compact_batch_pages);
+	unsigned long pages_freed = 0;
+	struct size_class *class;
+	int i;
+
+	if (!budget)
+		return;
+
+	for (i = ZS_SIZE_CLASSES - 1; i >= 0 && pages_freed < budget; i--) {
+		class = pool->size_class[i];
+		if (!class)
+			continue;
+		if (class->index != i)
+			continue;
+		if (!zs_class_fragmented(class))
+			continue;
+		pages_freed += __zs_compact(pool, class, budget - pages_freed);
+	}
+
+	/* used up the batch, other classes may still be fragmented */
+	if (pages_freed >= budget)
+		queue_delayed_work(system_power_efficient_wq,
+				   &pool->compact_work, ZS_COMPACT_DELAY);
 }
 
 unsigned long zs_compact(struct zs_pool *pool)
@@ -2272,7 +2362,7 @@ unsigned long zs_compact(struct zs_pool *pool)
 			continue;
 		if (class->index != i)
 			continue;
-		__zs_compact(pool, class);
+		__zs_compact(pool, class, ULONG_MAX);
 	}
 
 	return pool->stats.pages_compacted;
@@ -2361,6 +2451,7 @@ struct zs_pool *zs_create_pool(const char *name)
 		return NULL;
 
 	init_deferred_free(pool);
+	INIT_DELAYED_WORK(&pool->compact_work, zs_compact_work);
 
 	pool->name = kstrdup(name, GFP_KERNEL);
 	if (!pool->name)
@@ -2466,6 +2557,7 @@ void zs_destroy_pool(struct zs_pool *pool)
 {
 	int i;
 
+	cancel_delayed_work_sync(&pool->compact_work);
 	zs_unregister_shrinker(pool);
 	zs_unregister_migration(pool);
 	zs_pool_stat_destroy(pool);
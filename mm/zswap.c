@@ -35,6 +35,8 @@
 #include <linux/crypto.h>
 #include <linux/mempool.h>
 #include <linux/zpool.h>
+#include <linux/workqueue.h>
+#include <linux/mutex.h>
 
 #include <linux/mm_types.h>
 #include <linux/page-flags.h>
@@ -73,6 +75,18 @@ static u64 zswap_reject_alloc_fail;
 static u64 zswap_reject_kmemcache_fail;
 /* Duplicate store was encountered (rare) */
 static u64 zswap_duplicate_entry;
+/* The number of pages currently stored in the cold compressor tier */
+static atomic_t zswap_cold_stored_pages = ATOMIC_INIT(0);
+/* Cold entries moved to the cold tier */
+static u64 zswap_cold_recompressed_pages;
+/* Bytes saved by moving entries to the cold tier */
+static u64 zswap_cold_saved_bytes;
+/* Cold compressor did not shrink the entry, left in its hot pool */
+static u64 zswap_cold_reject_compress_poor;
+/* Cold pool could not allocate room for the recompressed entry */
+static u64 zswap_cold_reject_alloc_fail;
+/* Entry was loaded or written back while being recompressed */
+static u64 zswap_cold_reject_busy;
 
 /*********************************
 * tunables
@@ -123,6 +137,27 @@ static bool zswap_same_filled_pages_enabled = true;
 module_param_named(same_filled_pages_enabled, zswap_same_filled_pages_enabled,
 		   bool, 0644);
 
+/*
+ * Higher-ratio compressor used to recompress entries that stay in zswap
+ * for longer than cold_age_secs.  Stores always use the (fast) compressor
+ * above; the cold tier is filled from a background worker only, so it
+ * never adds latency to reclaim.  Empty (the default) disables the tier.
+ */
+static char *zswap_cold_compressor = ZSWAP_PARAM_UNSET;
+static int zswap_cold_compressor_param_set(const char *,
+					   const struct kernel_param *);
+static struct kernel_param_ops zswap_cold_compressor_param_ops = {
+	.set =		zswap_cold_compressor_param_set,
+	.get =		param_get_charp,
+	.free =		param_free_charp,
+};
+module_param_cb(cold_compressor, &zswap_cold_compressor_param_ops,
+		&zswap_cold_compressor, 0644);
+
+/* Seconds an entry must stay unloaded before it is moved to the cold tier */
+static unsigned int zswap_cold_age_secs = 60;
+module_param_named(cold_age_secs, zswap_cold_age_secs, uint, 0644);
+
 /*********************************
 * data structures
 **********************************/
@@ -134,6 +169,7 @@ struct zswap_pool {
 	struct list_head list;
 	struct work_struct work;
 	struct hlist_node node;
+	bool cold;
 	char tfm_name[CRYPTO_MAX_ALG_NAME];
 };
 
@@ -154,6 +190,9 @@ struct zswap_pool {
  * length - the length in bytes of the compressed page data.  Needed during
  *          decompression. For a same value filled page length is 0.
  * pool - the zswap_pool the entry's data is in
+ * lru - links the entry into the tree's list of cold tier candidates, in
+ *       store order.  Protected by the tree lock.
+ * stored - jiffies at which the entry was stored
  * handle - zpool allocation handle that stores the compressed page data
  * value - value of the same-value filled pages which have same content
  */
@@ -163,6 +202,8 @@ struct zswap_entry {
 	int refcount;
 	unsigned int length;
 	struct zswap_pool *pool;
+	struct list_head lru;
+	unsigned long stored;
 	union {
 		unsigned long handle;
 		unsigned long value;
@@ -177,9 +218,11 @@ struct zswap_header {
  * The tree lock in the zswap_tree struct protects a few things:
  * - the rbtree
  * - the refcount field of each entry in the tree
+ * - the cold tier candidate list
  */
 struct zswap_tree {
 	struct rb_root rbroot;
+	struct list_head cold_lru;
 	spinlock_t lock;
 };
 
@@ -191,6 +234,8 @@ static LIST_HEAD(zswap_pools);
 static DEFINE_SPINLOCK(zswap_pools_lock);
 /* pool counter to provide unique names to zpool */
 static atomic_t zswap_pools_count = ATOMIC_INIT(0);
+/* pool for the cold tier, or NULL; protected by zswap_pools_lock */
+static struct zswap_pool *zswap_cold_pool;
 
 /* used by param callback function */
 static bool zswap_init_started;
@@ -212,6 +257,7 @@ static bool zswap_has_pool;
 static int zswap_writeback_entry(struct zpool *pool, unsigned long handle);
 static int zswap_pool_get(struct zswap_pool *pool);
 static void zswap_pool_put(struct zswap_pool *pool);
+static void zswap_cold_schedule(void);
 
 static const struct zpool_ops zswap_zpool_ops = {
 	.evict = zswap_writeback_entry
@@ -262,6 +308,7 @@ static struct zswap_entry *zswap_entry_cache_alloc(gfp_t gfp)
 		return NULL;
 	entry->refcount = 1;
 	RB_CLEAR_NODE(&entry->rbnode);
+	INIT_LIST_HEAD(&entry->lru);
 	return entry;
 }
 
@@ -323,6 +370,8 @@ static void zswap_rb_erase(struct rb_root *root, struct zswap_entry *entry)
 		rb_erase(&entry->rbnode, root);
 		RB_CLEAR_NODE(&entry->rbnode);
 	}
+	/* an entry off the tree is no longer a cold tier candidate */
+	list_del_init(&entry->lru);
 }
 
 /*
@@ -334,6 +383,8 @@ static void zswap_free_entry(struct zswap_entry *entry)
 	if (!entry->length)
 		atomic_dec(&zswap_same_filled_pages);
 	else {
+		if (entry->pool->cold)
+			atomic_dec(&zswap_cold_stored_pages);
 		zpool_free(entry->pool->zpool, entry->handle);
 		zswap_pool_put(entry->pool);
 	}
@@ -477,8 +528,12 @@ static struct zswap_pool *zswap_pool_last_get(void)
 
 	rcu_read_lock();
 
-	list_for_each_entry_rcu(pool, &zswap_pools, list)
+	list_for_each_entry_rcu(pool, &zswap_pools, list) {
+		/* an empty cold pool has nothing to write back */
+		if (pool->cold && !zpool_get_total_size(pool->zpool))
+			continue;
 		last = pool;
+	}
 	WARN_ONCE(!last && zswap_has_pool,
 		  "%s: no page storage pool!\n", __func__);
 	if (!zswap_pool_get(last))
@@ -497,6 +552,9 @@ static struct zswap_pool *zswap_pool_find_get(char *type, char *compressor)
 	assert_spin_locked(&zswap_pools_lock);
 
 	list_for_each_entry_rcu(pool, &zswap_pools, list) {
+		/* cold pools are never promoted to the current pool */
+		if (pool->cold)
+			continue;
 		if (strcmp(pool->tfm_name, compressor))
 			continue;
 		if (strcmp(zpool_get_type(pool->zpool), type))
@@ -779,6 +837,69 @@ static int zswap_zpool_param_set(const char *val,
 	return __zswap_param_set(val, kp, NULL, zswap_compressor);
 }
 
+static int zswap_cold_compressor_param_set(const char *val,
+					   const struct kernel_param *kp)
+{
+	struct zswap_pool *pool = NULL, *put_pool;
+	char *s = strstrip((char *)val);
+	int ret;
+
+	if (zswap_init_failed) {
+		pr_err("can't set param, initialization failed\n");
+		return -ENODEV;
+	}
+
+	/* no change required */
+	if (!strcmp(s, *(char **)kp->arg))
+		return 0;
+
+	/* the cold pool is created during init, like the current pool */
+	if (!zswap_init_started)
+		return param_set_charp(s, kp);
+
+	if (strcmp(s, ZSWAP_PARAM_UNSET)) {
+		if (!crypto_has_comp(s, 0, 0)) {
+			pr_err("compressor %s not available\n", s);
+			return -ENOENT;
+		}
+		if (!zswap_has_pool) {
+			pr_err("can't set cold compressor, no pool configured\n");
+			return -ENODEV;
+		}
+
+		pool = zswap_pool_create(zswap_zpool_type, s);
+		if (!pool)
+			return -EINVAL;
+		pool->cold = true;
+	}
+
+	ret = param_set_charp(s, kp);
+	if (ret) {
+		if (pool)
+			zswap_pool_put(pool);
+		return ret;
+	}
+
+	/* the cold pool sits at the tail of the list, so it is written
+	 * back first when zswap is full; being the cold pool takes the
+	 * initial ref, entries already in an old cold pool keep it alive
+	 */
+	spin_lock(&zswap_pools_lock);
+	put_pool = zswap_cold_pool;
+	zswap_cold_pool = pool;
+	if (pool)
+		list_add_tail_rcu(&pool->list, &zswap_pools);
+	spin_unlock(&zswap_pools_lock);
+
+	if (put_pool)
+		zswap_pool_put(put_pool);
+
+	if (pool)
+		zswap_cold_schedule();
+
+	return 0;
+}
+
 static int zswap_enabled_param_set(const char *val,
 				   const struct kernel_param *kp)
 {
@@ -990,6 +1111,196 @@ static void zswap_fill_page(void *ptr, unsigned long value)
 	memset_l(page, value, PAGE_SIZE / sizeof(unsigned long));
 }
 
+/*********************************
+* cold tier
+**********************************/
+/* entries recompressed per worker run, so a run never hogs the cpu */
+#define ZSWAP_COLD_BATCH 256
+/* delay between worker runs while candidates are still warming up */
+#define ZSWAP_COLD_INTERVAL HZ
+
+/* serialises the worker against zswap_frontswap_invalidate_area() */
+static DEFINE_MUTEX(zswap_cold_lock);
+/* worker-private buffers, zswap_dstmem is per-cpu and used by stores */
+static u8 *zswap_cold_src;
+static u8 *zswap_cold_dst;
+
+static void zswap_cold_work_fn(struct work_struct *work);
+static DECLARE_DELAYED_WORK(zswap_cold_work, zswap_cold_work_fn);
+
+static void zswap_cold_schedule(void)
+{
+	queue_delayed_work(system_freezable_power_efficient_wq,
+			   &zswap_cold_work,
+			   round_jiffies_relative(ZSWAP_COLD_INTERVAL));
+}
+
+static struct zswap_pool *zswap_cold_pool_get(void)
+{
+	struct zswap_pool *pool;
+
+	spin_lock(&zswap_pools_lock);
+	pool = zswap_cold_pool;
+	if (!zswap_pool_get(pool))
+		pool = NULL;
+	spin_unlock(&zswap_pools_lock);
+
+	return pool;
+}
+
+/*
+ * Recompresses a referenced entry with the cold compressor and, if that
+ * saves space, moves it into the cold pool.  The switch is only made while
+ * nobody else holds a reference, so concurrent loads and writebacks always
+ * see either the old or the new pool/handle/length triple, never a mix.
+ */
+static void zswap_cold_recompress(struct zswap_tree *tree, unsigned type,
+				  struct zswap_entry *entry,
+				  struct zswap_pool *cold)
+{
+	struct zswap_pool *pool = entry->pool;
+	struct zswap_header zhdr = {
+		.swpentry = swp_entry(type, entry->offset)
+	};
+	struct crypto_comp *tfm;
+	unsigned int hlen, dlen = PAGE_SIZE;
+	unsigned long handle, old_handle;
+	unsigned int old_length;
+	u8 *src;
+	char *buf;
+	int ret;
+
+	/* decompress */
+	src = zpool_map_handle(pool->zpool, entry->handle, ZPOOL_MM_RO);
+	if (zpool_evictable(pool->zpool))
+		src += sizeof(struct zswap_header);
+	tfm = *get_cpu_ptr(pool->tfm);
+	ret = crypto_comp_decompress(tfm, src, entry->length,
+				     zswap_cold_src, &dlen);
+	put_cpu_ptr(pool->tfm);
+	zpool_unmap_handle(pool->zpool, entry->handle);
+	BUG_ON(ret);
+
+	/* compress */
+	dlen = PAGE_SIZE;
+	tfm = *get_cpu_ptr(cold->tfm);
+	ret = crypto_comp_compress(tfm, zswap_cold_src, PAGE_SIZE,
+				   zswap_cold_dst, &dlen);
+	put_cpu_ptr(cold->tfm);
+	if (ret || dlen >= entry->length) {
+		zswap_cold_reject_compress_poor++;
+		return;
+	}
+
+	/* store */
+	hlen = zpool_evictable(cold->zpool) ? sizeof(zhdr) : 0;
+	ret = zpool_malloc(cold->zpool, hlen + dlen,
+			   __GFP_NORETRY | __GFP_NOWARN, &handle);
+	if (ret) {
+		zswap_cold_reject_alloc_fail++;
+		return;
+	}
+	buf = zpool_map_handle(cold->zpool, handle, ZPOOL_MM_WO);
+	memcpy(buf, &zhdr, hlen);
+	memcpy(buf + hlen, zswap_cold_dst, dlen);
+	zpool_unmap_handle(cold->zpool, handle);
+
+	/* switch, unless a load, writeback or invalidate got in meanwhile */
+	spin_lock(&tree->lock);
+	if (entry->refcount != 2 ||
+	    zswap_rb_search(&tree->rbroot, entry->offset) != entry) {
+		spin_unlock(&tree->lock);
+		zpool_free(cold->zpool, handle);
+		zswap_cold_reject_busy++;
+		return;
+	}
+	old_handle = entry->handle;
+	old_length = entry->length;
+	/* the caller's ref on cold keeps this from racing with the release */
+	kref_get(&cold->kref);
+	entry->pool = cold;
+	entry->handle = handle;
+	entry->length = dlen;
+	spin_unlock(&tree->lock);
+
+	zpool_free(pool->zpool, old_handle);
+	zswap_pool_put(pool);
+
+	atomic_inc(&zswap_cold_stored_pages);
+	zswap_cold_recompressed_pages++;
+	zswap_cold_saved_bytes += old_length - dlen;
+	zswap_update_total_size();
+}
+
+/*
+ * Moves up to @budget entries that were stored more than cold_age_secs ago
+ * to the cold tier.  Returns the number of entries looked at, and sets
+ * @more if younger candidates are left for a later run.
+ */
+static unsigned int zswap_cold_scan(struct zswap_tree *tree, unsigned type,
+				    struct zswap_pool *cold,
+				    unsigned int budget, bool *more)
+{
+	unsigned long age = READ_ONCE(zswap_cold_age_secs) * HZ;
+	struct zswap_entry *entry;
+	unsigned int scanned = 0;
+
+	while (scanned < budget) {
+		spin_lock(&tree->lock);
+		entry = list_first_entry_or_null(&tree->cold_lru,
+						 struct zswap_entry, lru);
+		if (!entry || time_before(jiffies, entry->stored + age)) {
+			if (entry)
+				*more = true;
+			spin_unlock(&tree->lock);
+			break;
+		}
+		/* each entry gets one try, whatever the outcome */
+		list_del_init(&entry->lru);
+		zswap_entry_get(entry);
+		spin_unlock(&tree->lock);
+
+		zswap_cold_recompress(tree, type, entry, cold);
+		scanned++;
+
+		spin_lock(&tree->lock);
+		zswap_entry_put(tree, entry);
+		spin_unlock(&tree->lock);
+
+		cond_resched();
+	}
+
+	return scanned;
+}
+
+static void zswap_cold_work_fn(struct work_struct *work)
+{
+	unsigned int budget = ZSWAP_COLD_BATCH;
+	struct zswap_pool *cold;
+	struct zswap_tree *tree;
+	bool more = false;
+	unsigned type;
+
+	cold = zswap_cold_pool_get();
+	if (!cold)
+		return;
+
+	mutex_lock(&zswap_cold_lock);
+	for (type = 0; type < MAX_SWAPFILES && budget; type++) {
+		tree = zswap_trees[type];
+		if (!tree)
+			continue;
+		budget -= zswap_cold_scan(tree, type, cold, budget, &more);
+	}
+	mutex_unlock(&zswap_cold_lock);
+
+	zswap_pool_put(cold);
+
+	/* the next store rearms the worker once all candidates are done */
+	if (more || !budget)
+		zswap_cold_schedule();
+}
+
 /*********************************
 * frontswap hooks
 **********************************/
@@ -1102,6 +1413,8 @@ static int zswap_frontswap_store(unsigned type, pgoff_t offset,
 	entry->length = dlen;
 
 insert_entry:
+	entry->stored = jiffies;
+
 	/* map */
 	spin_lock(&tree->lock);
 	do {
@@ -1113,8 +1426,14 @@ static int zswap_frontswap_store(unsigned type, pgoff_t offset,
 			zswap_entry_put(tree, dupentry);
 		}
 	} while (ret == -EEXIST);
+	if (entry->length)
+		list_add_tail(&entry->lru, &tree->cold_lru);
 	spin_unlock(&tree->lock);
 
+	if (entry->length && READ_ONCE(zswap_cold_pool) &&
+	    !delayed_work_pending(&zswap_cold_work))
+		zswap_cold_schedule();
+
 	/* update stats */
 	atomic_inc(&zswap_stored_pages);
 	zswap_update_total_size();
@@ -1215,14 +1534,20 @@ static void zswap_frontswap_invalidate_area(unsigned type)
 	if (!tree)
 		return;
 
+	/* the cold tier worker must not be walking this tree */
+	mutex_lock(&zswap_cold_lock);
+
 	/* walk the tree and free everything */
 	spin_lock(&tree->lock);
 	rbtree_postorder_for_each_entry_safe(entry, n, &tree->rbroot, rbnode)
 		zswap_free_entry(entry);
 	tree->rbroot = RB_ROOT;
+	INIT_LIST_HEAD(&tree->cold_lru);
 	spin_unlock(&tree->lock);
 	kfree(tree);
 	zswap_trees[type] = NULL;
+
+	mutex_unlock(&zswap_cold_lock);
 }
 
 static void zswap_frontswap_init(unsigned type)
@@ -1236,6 +1561,7 @@ static void zswap_frontswap_init(unsigned type)
 	}
 
 	tree->rbroot = RB_ROOT;
+	INIT_LIST_HEAD(&tree->cold_lru);
 	spin_lock_init(&tree->lock);
 	zswap_trees[type] = tree;
 }
@@ -1285,6 +1611,18 @@ static int __init zswap_debugfs_init(void)
 				zswap_debugfs_root, &zswap_stored_pages);
 	debugfs_create_atomic_t("same_filled_pages", 0444,
 				zswap_debugfs_root, &zswap_same_filled_pages);
+	debugfs_create_atomic_t("cold_stored_pages", 0444,
+				zswap_debugfs_root, &zswap_cold_stored_pages);
+	debugfs_create_u64("cold_recompressed_pages", 0444,
+			   zswap_debugfs_root, &zswap_cold_recompressed_pages);
+	debugfs_create_u64("cold_saved_bytes", 0444,
+			   zswap_debugfs_root, &zswap_cold_saved_bytes);
+	debugfs_create_u64("cold_reject_compress_poor", 0444,
+			   zswap_debugfs_root, &zswap_cold_reject_compress_poor);
+	debugfs_create_u64("cold_reject_alloc_fail", 0444,
+			   zswap_debugfs_root, &zswap_cold_reject_alloc_fail);
+	debugfs_create_u64("cold_reject_busy", 0444,
+			   zswap_debugfs_root, &zswap_cold_reject_busy);
 
 	return 0;
 }
@@ -1305,6 +1643,35 @@ static void __exit zswap_debugfs_exit(void) { }
 /*********************************
 * module init and exit
 **********************************/
+static __init void zswap_cold_init(void)
+{
+	struct zswap_pool *pool;
+
+	if (!strcmp(zswap_cold_compressor, ZSWAP_PARAM_UNSET))
+		return;
+
+	if (!zswap_has_pool || !crypto_has_comp(zswap_cold_compressor, 0, 0))
+		goto disable;
+
+	pool = zswap_pool_create(zswap_zpool_type, zswap_cold_compressor);
+	if (!pool)
+		goto disable;
+	pool->cold = true;
+
+	pr_info("cold tier using pool %s/%s\n", pool->tfm_name,
+		zpool_get_type(pool->zpool));
+	list_add_tail(&pool->list, &zswap_pools);
+	zswap_cold_pool = pool;
+	zswap_cold_schedule();
+	return;
+
+disable:
+	pr_err("cold compressor %s not available, cold tier disabled\n",
+	       zswap_cold_compressor);
+	param_free_charp(&zswap_cold_compressor);
+	zswap_cold_compressor = ZSWAP_PARAM_UNSET;
+}
+
 static int __init init_zswap(void)
 {
 	struct zswap_pool *pool;
@@ -1324,6 +1691,13 @@ static int __init init_zswap(void)
 		goto dstmem_fail;
 	}
 
+	zswap_cold_src = kmalloc(PAGE_SIZE, GFP_KERNEL);
+	zswap_cold_dst = kmalloc(PAGE_SIZE * 2, GFP_KERNEL);
+	if (!zswap_cold_src || !zswap_cold_dst) {
+		pr_err("cold tier buffer alloc failed\n");
+		goto cold_fail;
+	}
+
 	ret = cpuhp_setup_state_multi(CPUHP_MM_ZSWP_POOL_PREPARE,
 				      "mm/zswap_pool:prepare",
 				      zswap_cpu_comp_prepare,
@@ -1342,12 +1716,17 @@ static int __init init_zswap(void)
 		zswap_enabled = false;
 	}
 
+	zswap_cold_init();
+
 	frontswap_register_ops(&zswap_frontswap_ops);
 	if (zswap_debugfs_init())
 		pr_warn("debugfs initialization failed\n");
 	return 0;
 
 hp_fail:
+cold_fail:
+	kfree(zswap_cold_dst);
+	kfree(zswap_cold_src);
 	cpuhp_remove_state(CPUHP_MM_ZSWP_MEM_PREPARE);
 dstmem_fail:
 	zswap_entry_cache_destroy();
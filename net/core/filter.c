@@ -4013,6 +4013,12 @@ BPF_CALL_5(bpf_setsockopt, struct bpf_sock_ops_kern *, bpf_sock,
 					tp->snd_ssthresh = val;
 				}
 				break;
+			case TCP_TSQ_LIMIT:
+				if (val < 0)
+					ret = -EINVAL;
+				else
+					tp->tsq_limit = val;
+				break;
 			default:
 				ret = -EINVAL;
 			}
@@ -2173,6 +2173,7 @@ static int devinet_conf_proc(struct ctl_table *ctl, int write,
 			inet_netconf_notify_devconf(net, RTM_NEWNETCONF,
 						    NETCONFA_IGNORE_ROUTES_WITH_LINKDOWN,
 						    ifindex, cnf);
+			rt_cache_flush(net);
 		}
 	}
 
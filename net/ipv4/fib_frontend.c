@@ -55,11 +55,11 @@ static int __net_init fib4_rules_init(struct net *net)
 {
 	struct fib_table *local_table, *main_table;
 
-	main_table  = fib_trie_table(RT_TABLE_MAIN, NULL);
+	main_table  = fib_trie_table(net, RT_TABLE_MAIN, NULL);
 	if (!main_table)
 		return -ENOMEM;
 
-	local_table = fib_trie_table(RT_TABLE_LOCAL, main_table);
+	local_table = fib_trie_table(net, RT_TABLE_LOCAL, main_table);
 	if (!local_table)
 		goto fail;
 
@@ -94,7 +94,7 @@ struct fib_table *fib_new_table(struct net *net, u32 id)
 	if (id == RT_TABLE_LOCAL && !net->ipv4.fib_has_custom_rules)
 		alias = fib_new_table(net, RT_TABLE_MAIN);
 
-	tb = fib_trie_table(id, alias);
+	tb = fib_trie_table(net, id, alias);
 	if (!tb)
 		return NULL;
 
@@ -169,7 +169,7 @@ int fib_unmerge(struct net *net)
 	if (!old)
 		return 0;
 
-	new = fib_trie_unmerge(old);
+	new = fib_trie_unmerge(net, old);
 	if (!new)
 		return -ENOMEM;
 
@@ -70,6 +70,7 @@
 #include <linux/skbuff.h>
 #include <linux/netlink.h>
 #include <linux/init.h>
+#include <linux/jhash.h>
 #include <linux/list.h>
 #include <linux/slab.h>
 #include <linux/export.h>
@@ -162,7 +163,44 @@ struct trie_use_stats {
 	unsigned int semantic_match_miss;
 	unsigned int null_node_hit;
 	unsigned int resize_node_skipped;
+#ifdef CONFIG_IP_FIB_TRIE_CACHE
+	unsigned int cache_hits;
+#endif
+};
+#endif
+
+#ifdef CONFIG_IP_FIB_TRIE_CACHE
+#define FIB_CACHE_BITS	7
+#define FIB_CACHE_SIZE	(1U << FIB_CACHE_BITS)
+
+#define FIB_CACHE_VALID			0x01
+#define FIB_CACHE_IGNORE_LINKSTATE	0x02
+#define FIB_CACHE_SKIP_NH_OIF		0x04
+
+/* Result of a lookup for one exact set of flow keys; fi is NULL when the
+ * lookup failed and err is all there is to return.
+ */
+struct fib_cache_entry {
+	unsigned int		gen;
+	__be32			daddr;
+	int			oif;
+	u8			tos;
+	u8			scope;
+	u8			flags;
+	u8			nh_sel;
+	int			err;
+	__be32			prefix;
+	unsigned char		prefixlen;
+	unsigned char		type;
+	struct fib_info		*fi;
+	struct hlist_head	*fa_head;
+};
+
+struct fib_cache {
+	struct fib_cache_entry ent[FIB_CACHE_SIZE];
 };
+
+static u32 fib_cache_rnd __read_mostly;
 #endif
 
 struct trie_stat {
@@ -180,6 +218,10 @@ struct trie {
 #ifdef CONFIG_IP_FIB_TRIE_STATS
 	struct trie_use_stats __percpu *stats;
 #endif
+#ifdef CONFIG_IP_FIB_TRIE_CACHE
+	struct net *net;
+	struct fib_cache __percpu *cache;
+#endif
 };
 
 static struct key_vector *resize(struct trie *t, struct key_vector *tn);
@@ -1312,6 +1354,169 @@ static inline t_key prefix_mismatch(t_key key, struct key_vector *n)
 	return (key ^ prefix) & (prefix | -prefix);
 }
 
+#ifdef CONFIG_IP_FIB_TRIE_CACHE
+/* fib_seq moves on every route change, rt_genid when devices or addresses
+ * change the state of nexthops without touching the routes themselves.
+ */
+static inline unsigned int fib_cache_gen(struct net *net)
+{
+	return READ_ONCE(net->ipv4.fib_seq) + rt_genid_ipv4(net);
+}
+
+/* Returns the cache slot for the flow, valid if it holds a usable result
+ * or reset to the flow keys for fib_cache_store() otherwise.
+ */
+static struct fib_cache_entry *fib_cache_find(struct trie *t,
+					      const struct flowi4 *flp,
+					      int fib_flags)
+{
+	struct fib_cache_entry *ce;
+	unsigned int gen;
+	u8 flags = FIB_CACHE_VALID;
+	u32 hash;
+
+	/* Only users with BHs disabled may touch the per-CPU entries so that
+	 * none of them can be interrupted halfway through an update.
+	 */
+	if (!in_softirq() || in_irq())
+		return NULL;
+
+	if (fib_flags & FIB_LOOKUP_IGNORE_LINKSTATE)
+		flags |= FIB_CACHE_IGNORE_LINKSTATE;
+	if (flp->flowi4_flags & FLOWI_FLAG_SKIP_NH_OIF)
+		flags |= FIB_CACHE_SKIP_NH_OIF;
+
+	gen = fib_cache_gen(t->net);
+	hash = jhash_3words((__force u32)flp->daddr, flp->flowi4_oif,
+			    flp->flowi4_tos | flp->flowi4_scope << 8 |
+			    flags << 16, fib_cache_rnd);
+	ce = &this_cpu_ptr(t->cache)->ent[hash & (FIB_CACHE_SIZE - 1)];
+
+	if (ce->gen == gen && ce->flags == flags &&
+	    ce->daddr == flp->daddr && ce->oif == flp->flowi4_oif &&
+	    ce->tos == flp->flowi4_tos && ce->scope == flp->flowi4_scope)
+		return ce;
+
+	ce->gen = gen;
+	ce->daddr = flp->daddr;
+	ce->oif = flp->flowi4_oif;
+	ce->tos = flp->flowi4_tos;
+	ce->scope = flp->flowi4_scope;
+	ce->flags = flags & ~FIB_CACHE_VALID;
+
+	return ce;
+}
+
+static inline bool fib_cache_valid(const struct fib_cache_entry *ce)
+{
+	return ce && (ce->flags & FIB_CACHE_VALID);
+}
+
+static void fib_cache_store(struct fib_cache_entry *ce, int err,
+			    struct key_vector *n, struct fib_alias *fa,
+			    int nhsel)
+{
+	if (!ce)
+		return;
+
+	ce->err = err;
+	ce->fi = NULL;
+	if (fa) {
+		ce->prefix = htonl(n->key);
+		ce->prefixlen = KEYLENGTH - fa->fa_slen;
+		ce->nh_sel = nhsel;
+		ce->type = fa->fa_type;
+		ce->fi = fa->fa_info;
+		ce->fa_head = &n->leaf;
+	}
+	ce->flags |= FIB_CACHE_VALID;
+}
+
+static int fib_cache_result(struct fib_table *tb,
+			    const struct fib_cache_entry *ce,
+			    const struct flowi4 *flp,
+			    struct fib_result *res, int fib_flags)
+{
+	struct fib_info *fi = ce->fi;
+#ifdef CONFIG_IP_FIB_TRIE_STATS
+	struct trie *t = (struct trie *)tb->tb_data;
+
+	this_cpu_inc(t->stats->cache_hits);
+#endif
+
+	if (!fi) {
+		trace_fib_table_lookup(tb->tb_id, flp, NULL, ce->err);
+		return ce->err;
+	}
+
+	if (!(fib_flags & FIB_LOOKUP_NOREF))
+		refcount_inc(&fi->fib_clntref);
+
+	res->prefix = ce->prefix;
+	res->prefixlen = ce->prefixlen;
+	res->nh_sel = ce->nh_sel;
+	res->type = ce->type;
+	res->scope = fi->fib_scope;
+	res->fi = fi;
+	res->table = tb;
+	res->fa_head = ce->fa_head;
+	trace_fib_table_lookup(tb->tb_id, flp, &fi->fib_nh[ce->nh_sel],
+			       ce->err);
+
+	return ce->err;
+}
+
+static int fib_cache_alloc(struct net *net, struct trie *t)
+{
+	net_get_random_once(&fib_cache_rnd, sizeof(fib_cache_rnd));
+
+	t->net = net;
+	t->cache = alloc_percpu(struct fib_cache);
+
+	return t->cache ? 0 : -ENOMEM;
+}
+
+static void fib_cache_free(struct trie *t)
+{
+	free_percpu(t->cache);
+}
+#else
+static inline struct fib_cache_entry *fib_cache_find(struct trie *t,
+						     const struct flowi4 *flp,
+						     int fib_flags)
+{
+	return NULL;
+}
+
+static inline bool fib_cache_valid(const struct fib_cache_entry *ce)
+{
+	return false;
+}
+
+static inline void fib_cache_store(struct fib_cache_entry *ce, int err,
+				   struct key_vector *n,
+				   struct fib_alias *fa, int nhsel)
+{
+}
+
+static inline int fib_cache_result(struct fib_table *tb,
+				   const struct fib_cache_entry *ce,
+				   const struct flowi4 *flp,
+				   struct fib_result *res, int fib_flags)
+{
+	return -EAGAIN;
+}
+
+static inline int fib_cache_alloc(struct net *net, struct trie *t)
+{
+	return 0;
+}
+
+static inline void fib_cache_free(struct trie *t)
+{
+}
+#endif /* CONFIG_IP_FIB_TRIE_CACHE */
+
 /* should be called with rcu_read_lock */
 int fib_table_lookup(struct fib_table *tb, const struct flowi4 *flp,
 		     struct fib_result *res, int fib_flags)
@@ -1321,6 +1526,7 @@ int fib_table_lookup(struct fib_table *tb, const struct flowi4 *flp,
 	struct trie_use_stats __percpu *stats = t->stats;
 #endif
 	const t_key key = ntohl(flp->daddr);
+	struct fib_cache_entry *ce;
 	struct key_vector *n, *pn;
 	struct fib_alias *fa;
 	unsigned long index;
@@ -1339,6 +1545,10 @@ int fib_table_lookup(struct fib_table *tb, const struct flowi4 *flp,
 	this_cpu_inc(stats->gets);
 #endif
 
+	ce = fib_cache_find(t, flp, fib_flags);
+	if (fib_cache_valid(ce))
+		return fib_cache_result(tb, ce, flp, res, fib_flags);
+
 	/* Step 1: Travel to the longest prefix match in the trie */
 	for (;;) {
 		index = get_cindex(key, n);
@@ -1417,6 +1627,8 @@ int fib_table_lookup(struct fib_table *tb, const struct flowi4 *flp,
 				 * further nodes to parse.
 				 */
 				if (IS_TRIE(pn)) {
+					fib_cache_store(ce, -EAGAIN, NULL,
+							NULL, 0);
 					trace_fib_table_lookup(tb->tb_id, flp,
 							       NULL, -EAGAIN);
 					return -EAGAIN;
@@ -1462,6 +1674,7 @@ int fib_table_lookup(struct fib_table *tb, const struct flowi4 *flp,
 #ifdef CONFIG_IP_FIB_TRIE_STATS
 			this_cpu_inc(stats->semantic_match_passed);
 #endif
+			fib_cache_store(ce, err, NULL, NULL, 0);
 			trace_fib_table_lookup(tb->tb_id, flp, NULL, err);
 			return err;
 		}
@@ -1498,6 +1711,7 @@ int fib_table_lookup(struct fib_table *tb, const struct flowi4 *flp,
 #ifdef CONFIG_IP_FIB_TRIE_STATS
 			this_cpu_inc(stats->semantic_match_passed);
 #endif
+			fib_cache_store(ce, err, n, fa, nhsel);
 			trace_fib_table_lookup(tb->tb_id, flp, nh, err);
 
 			return err;
@@ -1725,10 +1939,11 @@ static void fib_trie_free(struct fib_table *tb)
 #ifdef CONFIG_IP_FIB_TRIE_STATS
 	free_percpu(t->stats);
 #endif
+	fib_cache_free(t);
 	kfree(tb);
 }
 
-struct fib_table *fib_trie_unmerge(struct fib_table *oldtb)
+struct fib_table *fib_trie_unmerge(struct net *net, struct fib_table *oldtb)
 {
 	struct trie *ot = (struct trie *)oldtb->tb_data;
 	struct key_vector *l, *tp = ot->kv;
@@ -1740,7 +1955,7 @@ struct fib_table *fib_trie_unmerge(struct fib_table *oldtb)
 	if (oldtb->tb_data == oldtb->__data)
 		return oldtb;
 
-	local_tb = fib_trie_table(RT_TABLE_LOCAL, NULL);
+	local_tb = fib_trie_table(net, RT_TABLE_LOCAL, NULL);
 	if (!local_tb)
 		return NULL;
 
@@ -1988,12 +2203,14 @@ void fib_notify(struct net *net, struct notifier_block *nb)
 static void __trie_free_rcu(struct rcu_head *head)
 {
 	struct fib_table *tb = container_of(head, struct fib_table, rcu);
-#ifdef CONFIG_IP_FIB_TRIE_STATS
 	struct trie *t = (struct trie *)tb->tb_data;
 
-	if (tb->tb_data == tb->__data)
+	if (tb->tb_data == tb->__data) {
+#ifdef CONFIG_IP_FIB_TRIE_STATS
 		free_percpu(t->stats);
 #endif /* CONFIG_IP_FIB_TRIE_STATS */
+		fib_cache_free(t);
+	}
 	kfree(tb);
 }
 
@@ -2092,7 +2309,8 @@ void __init fib_trie_init(void)
 					   0, SLAB_PANIC, NULL);
 }
 
-struct fib_table *fib_trie_table(u32 id, struct fib_table *alias)
+struct fib_table *fib_trie_table(struct net *net, u32 id,
+				 struct fib_table *alias)
 {
 	struct fib_table *tb;
 	struct trie *t;
@@ -2119,9 +2337,16 @@ struct fib_table *fib_trie_table(u32 id, struct fib_table *alias)
 	t->stats = alloc_percpu(struct trie_use_stats);
 	if (!t->stats) {
 		kfree(tb);
-		tb = NULL;
+		return NULL;
 	}
 #endif
+	if (fib_cache_alloc(net, t)) {
+#ifdef CONFIG_IP_FIB_TRIE_STATS
+		free_percpu(t->stats);
+#endif
+		kfree(tb);
+		return NULL;
+	}
 
 	return tb;
 }
@@ -2294,6 +2519,9 @@ static void trie_show_usage(struct seq_file *seq,
 		s.semantic_match_miss += pcpu->semantic_match_miss;
 		s.null_node_hit += pcpu->null_node_hit;
 		s.resize_node_skipped += pcpu->resize_node_skipped;
+#ifdef CONFIG_IP_FIB_TRIE_CACHE
+		s.cache_hits += pcpu->cache_hits;
+#endif
 	}
 
 	seq_printf(seq, "\nCounters:\n---------\n");
@@ -2303,7 +2531,11 @@ static void trie_show_usage(struct seq_file *seq,
 		   s.semantic_match_passed);
 	seq_printf(seq, "semantic match miss = %u\n", s.semantic_match_miss);
 	seq_printf(seq, "null node hit= %u\n", s.null_node_hit);
-	seq_printf(seq, "skipped node resize = %u\n\n", s.resize_node_skipped);
+	seq_printf(seq, "skipped node resize = %u\n", s.resize_node_skipped);
+#ifdef CONFIG_IP_FIB_TRIE_CACHE
+	seq_printf(seq, "cache hits = %u\n", s.cache_hits);
+#endif
+	seq_putc(seq, '\n');
 }
 #endif /*  CONFIG_IP_FIB_TRIE_STATS */
 
@@ -1246,6 +1246,15 @@ static struct ctl_table ipv4_net_table[] = {
 		.proc_handler	= proc_dointvec_minmax,
 		.extra1		= &one
 	},
+	{
+		.procname	= "udp_gro_connected",
+		.data		= &init_net.ipv4.sysctl_udp_gro_connected,
+		.maxlen		= sizeof(init_net.ipv4.sysctl_udp_gro_connected),
+		.mode		= 0644,
+		.proc_handler	= proc_dointvec_minmax,
+		.extra1		= &zero,
+		.extra2		= &one
+	},
 	{ }
 };
 
@@ -3044,6 +3044,12 @@ static int do_tcp_setsockopt(struct sock *sk, int level,
 		else
 			tp->recvmsg_inq = val;
 		break;
+	case TCP_TSQ_LIMIT:
+		if (val < 0)
+			err = -EINVAL;
+		else
+			tp->tsq_limit = val;
+		break;
 	default:
 		err = -ENOPROTOOPT;
 		break;
@@ -3508,6 +3514,9 @@ static int do_tcp_getsockopt(struct sock *sk, int level,
 	case TCP_INQ:
 		val = tp->recvmsg_inq;
 		break;
+	case TCP_TSQ_LIMIT:
+		val = tp->tsq_limit;
+		break;
 	case TCP_SAVE_SYN:
 		val = tp->save_syn;
 		break;
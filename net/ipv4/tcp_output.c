@@ -2199,6 +2199,12 @@ static bool tcp_small_queue_check(struct sock *sk, const struct sk_buff *skb,
 		      sock_net(sk)->ipv4.sysctl_tcp_limit_output_bytes);
 	limit <<= factor;
 
+	/* A hard cap, so that bulk flows sharing a slow link with time
+	 * sensitive traffic do not build up queues in qdisc/device.
+	 */
+	if (tcp_sk(sk)->tsq_limit)
+		limit = min(limit, tcp_sk(sk)->tsq_limit);
+
 	if (refcount_read(&sk->sk_wmem_alloc) > limit) {
 		/* Always send skb if rtx queue is empty.
 		 * No need to wait for TX completion to call us back,
@@ -116,6 +116,7 @@
 #include <linux/workqueue.h>
 #include <net/sock.h>
 #include <net/af_vsock.h>
+#include <net/busy_poll.h>
 
 static int __vsock_bind(struct sock *sk, struct sockaddr_vm *addr);
 static void vsock_sk_destruct(struct sock *sk);
@@ -1671,6 +1672,27 @@ static int vsock_stream_sendmsg(struct socket *sock, struct msghdr *msg,
 }
 
 
+/* Spin for up to sk_ll_usec waiting for data instead of going to sleep,
+ * letting the transport poll its queues if it can.
+ */
+static void vsock_stream_busy_loop(struct sock *sk, bool nonblock)
+{
+	struct vsock_sock *vsk = vsock_sk(sk);
+	unsigned long start_time = busy_loop_current_time();
+
+	release_sock(sk);
+	do {
+		if (transport->busy_poll)
+			transport->busy_poll(vsk);
+		if (vsock_stream_has_data(vsk) || READ_ONCE(sk->sk_err) ||
+		    nonblock)
+			break;
+		cpu_relax();
+	} while (!need_resched() && !signal_pending(current) &&
+		 !sk_busy_loop_timeout(sk, start_time));
+	lock_sock(sk);
+}
+
 static int
 vsock_stream_recvmsg(struct socket *sock, struct msghdr *msg, size_t len,
 		     int flags)
@@ -1745,6 +1767,8 @@ vsock_stream_recvmsg(struct socket *sock, struct msghdr *msg, size_t len,
 	if (err < 0)
 		goto out;
 
+	if (sk_can_busy_loop(sk) && !vsock_stream_has_data(vsk))
+		vsock_stream_busy_loop(sk, timeout == 0);
 
 	while (1) {
 		s64 ready;
@@ -21,6 +21,7 @@
 #include <net/sock.h>
 #include <linux/mutex.h>
 #include <net/af_vsock.h>
+#include <net/busy_poll.h>
 
 static struct workqueue_struct *virtio_vsock_workqueue;
 static struct virtio_vsock *the_virtio_vsock;
@@ -211,7 +212,13 @@ virtio_transport_send_pkt(struct virtio_vsock_pkt *pkt)
 	list_add_tail(&pkt->list, &vsock->send_pkt_list);
 	spin_unlock_bh(&vsock->send_pkt_list_lock);
 
-	queue_work(virtio_vsock_workqueue, &vsock->send_pkt_work);
+	/* Busy polling sockets care about latency more than about batching,
+	 * skip the round trip through the workqueue to kick the device.
+	 */
+	if (pkt->vsk && sk_can_busy_loop(sk_vsock(pkt->vsk)))
+		virtio_transport_send_pkt_work(&vsock->send_pkt_work);
+	else
+		queue_work(virtio_vsock_workqueue, &vsock->send_pkt_work);
 	return len;
 }
 
@@ -333,6 +340,41 @@ static bool virtio_transport_more_replies(struct virtio_vsock *vsock)
 	return val < virtqueue_get_vring_size(vq);
 }
 
+/* Hand all used rx buffers to the sockets.  Returns false if rx had to stop
+ * until the device processes already pending replies.
+ *
+ * rx_lock must be held.
+ */
+static bool virtio_transport_rx_dequeue(struct virtio_vsock *vsock)
+{
+	struct virtqueue *vq = vsock->vqs[VSOCK_VQ_RX];
+
+	for (;;) {
+		struct virtio_vsock_pkt *pkt;
+		unsigned int len;
+
+		if (!virtio_transport_more_replies(vsock))
+			return false;
+
+		pkt = virtqueue_get_buf(vq, &len);
+		if (!pkt)
+			return true;
+
+		vsock->rx_buf_nr--;
+
+		/* Drop short/long packets */
+		if (unlikely(len < sizeof(pkt->hdr) ||
+			     len > sizeof(pkt->hdr) + pkt->len)) {
+			virtio_transport_free_pkt(pkt);
+			continue;
+		}
+
+		pkt->len = len - sizeof(pkt->hdr);
+		virtio_transport_deliver_tap_pkt(pkt);
+		virtio_transport_recv_pkt(pkt);
+	}
+}
+
 static void virtio_transport_rx_work(struct work_struct *work)
 {
 	struct virtio_vsock *vsock =
@@ -345,35 +387,12 @@ static void virtio_transport_rx_work(struct work_struct *work)
 
 	do {
 		virtqueue_disable_cb(vq);
-		for (;;) {
-			struct virtio_vsock_pkt *pkt;
-			unsigned int len;
-
-			if (!virtio_transport_more_replies(vsock)) {
-				/* Stop rx until the device processes already
-				 * pending replies.  Leave rx virtqueue
-				 * callbacks disabled.
-				 */
-				goto out;
-			}
-
-			pkt = virtqueue_get_buf(vq, &len);
-			if (!pkt) {
-				break;
-			}
-
-			vsock->rx_buf_nr--;
-
-			/* Drop short/long packets */
-			if (unlikely(len < sizeof(pkt->hdr) ||
-				     len > sizeof(pkt->hdr) + pkt->len)) {
-				virtio_transport_free_pkt(pkt);
-				continue;
-			}
-
-			pkt->len = len - sizeof(pkt->hdr);
-			virtio_transport_deliver_tap_pkt(pkt);
-			virtio_transport_recv_pkt(pkt);
+		if (!virtio_transport_rx_dequeue(vsock)) {
+			/* Stop rx until the device processes already
+			 * pending replies.  Leave rx virtqueue
+			 * callbacks disabled.
+			 */
+			goto out;
 		}
 	} while (!virtqueue_enable_cb(vq));
 
@@ -383,6 +402,22 @@ static void virtio_transport_rx_work(struct work_struct *work)
 	mutex_unlock(&vsock->rx_lock);
 }
 
+/* Reap the rx virtqueue from the context of a busy polling socket.  If the
+ * rx worker already holds the queue there is nothing left to do here.
+ */
+static void virtio_transport_busy_poll(struct vsock_sock *vsk)
+{
+	struct virtio_vsock *vsock = virtio_vsock_get();
+
+	if (!vsock || !mutex_trylock(&vsock->rx_lock))
+		return;
+
+	virtio_transport_rx_dequeue(vsock);
+	if (vsock->rx_buf_nr < vsock->rx_buf_max_nr / 2)
+		virtio_vsock_rx_fill(vsock);
+	mutex_unlock(&vsock->rx_lock);
+}
+
 /* event_lock must be held */
 static int virtio_vsock_event_fill_one(struct virtio_vsock *vsock,
 				       struct virtio_vsock_event *event)
@@ -538,6 +573,8 @@ static struct virtio_transport virtio_transport = {
 		.get_buffer_size          = virtio_transport_get_buffer_size,
 		.get_min_buffer_size      = virtio_transport_get_min_buffer_size,
 		.get_max_buffer_size      = virtio_transport_get_max_buffer_size,
+
+		.busy_poll                = virtio_transport_busy_poll,
 	},
 
 	.send_pkt = virtio_transport_send_pkt,
@@ -393,7 +393,26 @@ static ssize_t snd_compr_read(struct file *f, char __user *buf,
 
 static int snd_compr_mmap(struct file *f, struct vm_area_struct *vma)
 {
-	return -ENXIO;
+	struct snd_compr_file *data = f->private_data;
+	struct snd_compr_stream *stream;
+	int retval;
+
+	if (snd_BUG_ON(!data))
+		return -EFAULT;
+
+	stream = &data->stream;
+	if (!stream->ops->mmap)
+		return -ENXIO;
+
+	mutex_lock(&stream->device->lock);
+	/* the buffer only exists once params are set */
+	if (stream->runtime->state == SNDRV_PCM_STATE_OPEN)
+		retval = -EBADFD;
+	else
+		retval = stream->ops->mmap(stream, vma);
+	mutex_unlock(&stream->device->lock);
+
+	return retval;
 }
 
 static __poll_t snd_compr_get_poll(struct snd_compr_stream *stream)
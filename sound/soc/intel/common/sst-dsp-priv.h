@@ -130,6 +130,12 @@ struct sst_trace_window {
 	u32		flags;
        /* dsp fw log level*/
 	u32 log_priority;
+	/*
+	 * fw log flush timers in ms, the fw notifies when either expires.
+	 * 0 selects the driver default.
+	 */
+	u32 log_aging_period;
+	u32 log_fifo_full_period;
 };
 
 /*
@@ -81,7 +81,9 @@ static int tx_wait_done(struct sst_generic_ipc *ipc,
 		if (msg->rx_size) {
 			if (rx_bytes != NULL)
 				*rx_bytes = msg->rx_size;
-			memcpy(rx_data, msg->rx_data, msg->rx_size);
+			/* skip the copy if the reply was read into rx_data */
+			if (!msg->rx_direct)
+				memcpy(rx_data, msg->rx_data, msg->rx_size);
 		}
 		ret = msg->errno;
 	}
@@ -91,6 +93,50 @@ static int tx_wait_done(struct sst_generic_ipc *ipc,
 	return ret;
 }
 
+/* locks held by caller */
+static void ipc_tx_message_queue(struct sst_generic_ipc *ipc,
+	struct ipc_message *msg, u64 header, void *tx_data, size_t tx_bytes,
+	void *rx_data, size_t *rx_bytes, int wait)
+{
+	msg->header = header;
+	msg->tx_size = tx_bytes;
+
+	if (!rx_bytes) {
+		msg->rx_size = 0;
+		msg->rx_buf = NULL;
+		msg->rx_buf_size = 0;
+	} else {
+		msg->rx_size = *rx_bytes;
+		msg->rx_buf = rx_data;
+		msg->rx_buf_size = *rx_bytes;
+	}
+
+	msg->wait = wait;
+	msg->errno = 0;
+	msg->pending = false;
+	msg->complete = false;
+	msg->rx_direct = false;
+
+	if ((tx_bytes) && (ipc->ops.tx_data_copy != NULL))
+		ipc->ops.tx_data_copy(msg, tx_data, tx_bytes);
+
+	list_add_tail(&msg->list, &ipc->tx_list);
+}
+
+/* called with the dsp spinlock held, drops it */
+static void ipc_tx_kick_unlock(struct sst_generic_ipc *ipc,
+	unsigned long flags)
+{
+	if ((ipc->ops.is_dsp_busy && ipc->ops.is_dsp_busy(ipc->dsp)) ||
+			(ipc->ops.direct_tx_msg == NULL)) {
+		schedule_work(&ipc->kwork);
+		spin_unlock_irqrestore(&ipc->dsp->spinlock, flags);
+	} else {
+		spin_unlock_irqrestore(&ipc->dsp->spinlock, flags);
+		ipc->ops.direct_tx_msg(ipc);
+	}
+}
+
 static int ipc_tx_message(struct sst_generic_ipc *ipc, u64 header,
 	void *tx_data, size_t tx_bytes, void *rx_data,
 	size_t *rx_bytes, int wait)
@@ -110,32 +156,9 @@ static int ipc_tx_message(struct sst_generic_ipc *ipc, u64 header,
 		return -EBUSY;
 	}
 
-	msg->header = header;
-	msg->tx_size = tx_bytes;
-
-	if (!rx_bytes)
-		msg->rx_size = 0;
-	else
-		msg->rx_size = *rx_bytes;
-
-	msg->wait = wait;
-	msg->errno = 0;
-	msg->pending = false;
-	msg->complete = false;
-
-	if ((tx_bytes) && (ipc->ops.tx_data_copy != NULL))
-		ipc->ops.tx_data_copy(msg, tx_data, tx_bytes);
-
-	list_add_tail(&msg->list, &ipc->tx_list);
-
-	if ((ipc->ops.is_dsp_busy && ipc->ops.is_dsp_busy(ipc->dsp)) ||
-                        (ipc->ops.direct_tx_msg == NULL)) {
-                schedule_work(&ipc->kwork);
-                spin_unlock_irqrestore(&ipc->dsp->spinlock, flags);
-        } else {
-                spin_unlock_irqrestore(&ipc->dsp->spinlock, flags);
-                ipc->ops.direct_tx_msg(ipc);
-        }
+	ipc_tx_message_queue(ipc, msg, header, tx_data, tx_bytes,
+		rx_data, rx_bytes, wait);
+	ipc_tx_kick_unlock(ipc, flags);
 
 	if (wait)
 		return tx_wait_done(ipc, msg, rx_data,
@@ -251,6 +274,80 @@ int sst_ipc_tx_message_nopm(struct sst_generic_ipc *ipc, u64 header,
 }
 EXPORT_SYMBOL_GPL(sst_ipc_tx_message_nopm);
 
+/**
+ * sst_ipc_tx_message_batch - send several messages and wait for all replies
+ * @ipc: generic IPC
+ * @batch: messages to send, in order; ->ret receives each reply status
+ * @count: number of messages, at most IPC_BATCH_MAX
+ *
+ * All messages are queued in one go, so that the platform can send the
+ * next one as soon as the DSP takes the previous one instead of after the
+ * caller has been woken up for each reply. Messages are still sent and
+ * completed in order. If one fails, the messages queued behind it are
+ * still sent.
+ *
+ * Returns 0 if all messages succeeded, otherwise the first error.
+ */
+int sst_ipc_tx_message_batch(struct sst_generic_ipc *ipc,
+	struct sst_ipc_batch_msg *batch, unsigned int count)
+{
+	struct ipc_message *msgs[IPC_BATCH_MAX];
+	unsigned long flags;
+	unsigned int i, queued = 0;
+	int ret = 0;
+
+	if (count > IPC_BATCH_MAX)
+		return -EINVAL;
+
+	if (ipc->dsp->is_recovery) {
+		dev_dbg(ipc->dev, "Recovery in progress..\n");
+		return 0;
+	}
+
+	if (ipc->ops.check_dsp_lp_on)
+		if (ipc->ops.check_dsp_lp_on(ipc->dsp, true))
+			return -EIO;
+
+	while (queued < count) {
+		unsigned int start = queued;
+
+		spin_lock_irqsave(&ipc->dsp->spinlock, flags);
+		for (; queued < count; queued++) {
+			msgs[queued] = msg_get_empty(ipc);
+			if (!msgs[queued])
+				break;
+
+			ipc_tx_message_queue(ipc, msgs[queued],
+				batch[queued].header, batch[queued].tx_data,
+				batch[queued].tx_bytes, NULL, NULL, 1);
+		}
+
+		if (queued == start) {
+			spin_unlock_irqrestore(&ipc->dsp->spinlock, flags);
+			ret = -EBUSY;
+			break;
+		}
+		ipc_tx_kick_unlock(ipc, flags);
+
+		for (i = start; i < queued; i++) {
+			batch[i].ret = tx_wait_done(ipc, msgs[i], NULL, NULL);
+			if (batch[i].ret < 0 && !ret)
+				ret = batch[i].ret;
+		}
+
+		/* don't start on messages that depend on a failed one */
+		if (ret < 0)
+			break;
+	}
+
+	if (ipc->ops.check_dsp_lp_on)
+		if (ipc->ops.check_dsp_lp_on(ipc->dsp, false))
+			return -EIO;
+
+	return ret;
+}
+EXPORT_SYMBOL_GPL(sst_ipc_tx_message_batch);
+
 struct ipc_message *sst_ipc_reply_find_msg(struct sst_generic_ipc *ipc,
 	u64 header)
 {
@@ -26,6 +26,9 @@
 
 #define IPC_MAX_MAILBOX_BYTES	256
 
+/* max messages in flight for one sst_ipc_tx_message_batch() call */
+#define IPC_BATCH_MAX		4
+
 struct ipc_message {
 	struct list_head list;
 	u64 header;
@@ -35,6 +38,10 @@ struct ipc_message {
 	size_t tx_size;
 	char *rx_data;
 	size_t rx_size;
+	/* caller's buffer, platforms may read the reply straight into it */
+	void *rx_buf;
+	size_t rx_buf_size;
+	bool rx_direct;
 
 	wait_queue_head_t waitq;
 	bool pending;
@@ -45,6 +52,14 @@ struct ipc_message {
 
 struct sst_generic_ipc;
 
+/* one entry of a sst_ipc_tx_message_batch() call */
+struct sst_ipc_batch_msg {
+	u64 header;
+	void *tx_data;
+	size_t tx_bytes;
+	int ret;
+};
+
 struct sst_plat_ipc_ops {
 	void (*tx_msg)(struct sst_generic_ipc *, struct ipc_message *);
 	void (*direct_tx_msg)(struct sst_generic_ipc *);
@@ -85,6 +100,9 @@ int sst_ipc_tx_message_nowait(struct sst_generic_ipc *ipc, u64 header,
 int sst_ipc_tx_message_nopm(struct sst_generic_ipc *ipc, u64 header,
 	void *tx_data, size_t tx_bytes, void *rx_data, size_t rx_bytes);
 
+int sst_ipc_tx_message_batch(struct sst_generic_ipc *ipc,
+	struct sst_ipc_batch_msg *batch, unsigned int count);
+
 struct ipc_message *sst_ipc_reply_find_msg(struct sst_generic_ipc *ipc,
 	u64 header);
 
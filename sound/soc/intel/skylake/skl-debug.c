@@ -14,6 +14,7 @@
  */
 
 #include <linux/pci.h>
+#include <linux/slab.h>
 #include <linux/debugfs.h>
 #include <uapi/sound/skl-tplg-interface.h>
 #include <linux/pm_runtime.h>
@@ -824,6 +825,85 @@ static const struct file_operations core_power_fops = {
 	.llseek = default_llseek,
 };
 
+static ssize_t boot_time_read(struct file *file, char __user *user_buf,
+			      size_t count, loff_t *ppos)
+{
+	struct skl_debug *d = file->private_data;
+	struct skl_boot_time *bt = &d->skl->skl_sst->boot_time;
+	char buf[192];
+	int len;
+
+	len = scnprintf(buf, sizeof(buf),
+			"rom_init_us: %lld\nfw_xfer_us: %lld\n"
+			"fw_ready_us: %lld\nlib_load_us: %lld\ntotal_us: %lld\n",
+			bt->rom_init, bt->fw_xfer, bt->fw_ready, bt->lib_load,
+			bt->rom_init + bt->fw_xfer + bt->fw_ready +
+			bt->lib_load);
+
+	return simple_read_from_buffer(user_buf, count, ppos, buf, len);
+}
+
+static const struct file_operations boot_time_fops = {
+	.open = simple_open,
+	.read = boot_time_read,
+	.llseek = default_llseek,
+};
+
+static s64 skl_latency_since_prepare(struct skl_stream_latency *lat,
+				     ktime_t stamp)
+{
+	if (!stamp)
+		return -1;
+
+	return ktime_us_delta(stamp, lat->prepare);
+}
+
+static ssize_t latency_read(struct file *file, char __user *user_buf,
+			    size_t count, loff_t *ppos)
+{
+	struct skl_debug *d = file->private_data;
+	struct skl *skl = d->skl;
+	struct skl_stream_latency *lat;
+	ssize_t ret;
+	char *buf;
+	int i, len = 0;
+
+	if (!skl->latency)
+		return -ENODEV;
+
+	buf = kzalloc(PAGE_SIZE, GFP_KERNEL);
+	if (!buf)
+		return -ENOMEM;
+
+	/* Stamps are in us since host DMA prepare, -1 if not reached */
+	for (i = 0; i < skl->hbus.num_streams; i++) {
+		lat = &skl->latency[i];
+		if (!lat->prepare)
+			continue;
+
+		len += scnprintf(buf + len, PAGE_SIZE - len,
+			"stream %d: host_start %lld pipe_run %lld link_start %lld delay_us %lld min %lld max %lld samples %u\n",
+			i, skl_latency_since_prepare(lat, lat->host_start),
+			skl_latency_since_prepare(lat, lat->pipe_run),
+			skl_latency_since_prepare(lat, lat->link_start),
+			lat->delay_us,
+			lat->samples ? lat->delay_min_us : 0,
+			lat->samples ? lat->delay_max_us : 0,
+			lat->samples);
+	}
+
+	ret = simple_read_from_buffer(user_buf, count, ppos, buf, len);
+	kfree(buf);
+
+	return ret;
+}
+
+static const struct file_operations latency_fops = {
+	.open = simple_open,
+	.read = latency_read,
+	.llseek = default_llseek,
+};
+
 void skl_dbg_event(struct skl_sst *ctx, int type)
 {
 	int retval;
@@ -930,6 +1010,32 @@ struct skl_debug *skl_debugfs_init(struct skl *skl)
 	goto err;
 	}
 
+	if (!debugfs_create_file("boot_time", 0444, d->fs, d,
+				 &boot_time_fops)) {
+		dev_err(d->dev, "boot time debugfs init failed\n");
+		goto err;
+	}
+
+	if (!debugfs_create_file("latency", 0444, d->fs, d,
+				 &latency_fops)) {
+		dev_err(d->dev, "latency debugfs init failed\n");
+		goto err;
+	}
+
+	if (!debugfs_create_u32("fw_log_aging_period", 0644, d->fs,
+			&skl->skl_sst->dsp->trace_wind.log_aging_period) ||
+	    !debugfs_create_u32("fw_log_fifo_full_period", 0644, d->fs,
+			&skl->skl_sst->dsp->trace_wind.log_fifo_full_period)) {
+		dev_err(d->dev, "fw log period debugfs init failed\n");
+		goto err;
+	}
+
+	if (!debugfs_create_u32("warm_pipe_mem", 0644, d->fs,
+				&skl->warm_mem_budget)) {
+		dev_err(d->dev, "warm pipe debugfs init failed\n");
+		goto err;
+	}
+
 	/* now create the NHLT dir */
 	d->nhlt =  debugfs_create_dir("nhlt", d->fs);
 	if (IS_ERR(d->nhlt) || !d->nhlt) {
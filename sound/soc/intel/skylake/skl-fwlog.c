@@ -131,24 +131,27 @@ int skl_dsp_get_buff_users(struct sst_dsp *sst, int core)
 void skl_dsp_write_log(struct sst_dsp *sst, void __iomem *src, int core,
 				int count)
 {
-	int i;
-	u32 *data = (u32 *)src;
+	unsigned int words = count / sizeof(u32), copied;
 	struct sst_dbg_rbuffer *buff = sst->trace_wind.dbg_buffers[core];
+	struct snd_compr_runtime *runtime = buff->stream->runtime;
 
-	if (buff->stream->runtime->state == SNDRV_PCM_STATE_XRUN)
+	if (runtime->state == SNDRV_PCM_STATE_XRUN)
 		return;
 
-	for (i = 0; i < count; i += 4) {
-		if (!kfifo_put(&buff->fifo_dsp, *data)) {
-			dev_err(sst->dev, "fw log buffer overrun on dsp %d\n",
-					core);
-			buff->stream->runtime->state = SNDRV_PCM_STATE_XRUN;
-			break;
-		}
-		data++;
+	copied = kfifo_in(&buff->fifo_dsp, (u32 *)src, words);
+	if (copied < words) {
+		dev_err(sst->dev, "fw log buffer overrun on dsp %d\n", core);
+		runtime->state = SNDRV_PCM_STATE_XRUN;
 	}
-	buff->total_avail += count;
-	wake_up(&buff->stream->runtime->sleep);
+	buff->total_avail += copied * sizeof(u32);
+
+	/*
+	 * poll only reports the stream readable once a fragment is
+	 * available, don't wake the reader up for less
+	 */
+	if (runtime->state == SNDRV_PCM_STATE_XRUN ||
+	    kfifo_len(&buff->fifo_dsp) * sizeof(u32) >= runtime->fragment_size)
+		wake_up(&runtime->sleep);
 }
 
 int skl_dsp_copy_log_user(struct sst_dsp *sst, int core,
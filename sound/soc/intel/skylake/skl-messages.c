@@ -34,6 +34,7 @@
 #include <linux/sdw/sdw_cnl.h>
 #include <linux/sdw_bus.h>
 #include <asm/set_memory.h>
+#include <trace/events/skl.h>
 
 #define ASRC_MODE_UPLINK	2
 #define ASRC_MODE_DOWNLINK	1
@@ -86,8 +87,11 @@ int skl_dsp_enable_logging(struct sst_generic_ipc *ipc, int core, int enable)
 	struct skl_ipc_large_config_msg msg = {0};
 	int ret = 0;
 
-	log_msg.aging_timer_period = FW_LOGGING_AGING_TIMER_PERIOD;
-	log_msg.fifo_full_timer_period = FW_LOG_FIFO_FULL_TIMER_PERIOD;
+	log_msg.aging_timer_period = ipc->dsp->trace_wind.log_aging_period ?:
+					FW_LOGGING_AGING_TIMER_PERIOD;
+	log_msg.fifo_full_timer_period =
+				ipc->dsp->trace_wind.log_fifo_full_period ?:
+					FW_LOG_FIFO_FULL_TIMER_PERIOD;
 
 	log_msg.core_mask = (1 << core);
 	log_msg.logs_core[core].enable = enable;
@@ -2602,6 +2606,7 @@ static int skl_set_pipe_state(struct skl_sst *ctx, struct skl_pipe *pipe,
 	enum skl_ipc_pipeline_state state)
 {
 	dev_dbg(ctx->dev, "%s: pipe_state = %d\n", __func__, state);
+	trace_skl_pipe_state(pipe->ppl_id, state);
 
 	return skl_ipc_set_pipeline_state(&ctx->ipc, pipe->ppl_id, state);
 }
@@ -33,6 +33,9 @@
 #include "skl-fwlog.h"
 #include "skl-probe.h"
 
+#define CREATE_TRACE_POINTS
+#include <trace/events/skl.h>
+
 #define HDA_MONO 1
 #define HDA_STEREO 2
 #define HDA_QUAD 4
@@ -176,6 +179,189 @@ static void skl_set_suspend_active(struct snd_pcm_substream *substream,
 		skl->supend_active--;
 }
 
+/* HDA controller wall clock runs at 24MHz */
+#define SKL_WALLCLK_HZ		24000000
+
+static struct skl_stream_latency *skl_get_stream_latency(struct hdac_bus *bus,
+						struct hdac_stream *hstr)
+{
+	struct skl *skl = bus_to_skl(bus);
+
+	if (!skl->latency)
+		return NULL;
+
+	return &skl->latency[hstr->index];
+}
+
+static void skl_latency_prepare(struct hdac_bus *bus, struct hdac_stream *hstr,
+				struct snd_pcm_runtime *runtime)
+{
+	struct skl_stream_latency *lat = skl_get_stream_latency(bus, hstr);
+
+	trace_skl_host_dma_prepare(hstr->index, hstr->direction,
+				snd_hdac_chip_readl(bus, WALLCLK));
+	if (!lat)
+		return;
+
+	/* DMA positions start over from 0 after the stream is set up */
+	memset(lat, 0, sizeof(*lat));
+	lat->prepare = ktime_get();
+	lat->rate = runtime->rate;
+	lat->buffer_size = runtime->buffer_size;
+	lat->delay_min_us = S64_MAX;
+	lat->delay_max_us = S64_MIN;
+}
+
+/* Called right after the host DMA is started */
+static void skl_latency_host_start(struct hdac_bus *bus,
+				struct hdac_stream *hstr, int cmd)
+{
+	struct skl_stream_latency *lat = skl_get_stream_latency(bus, hstr);
+
+	trace_skl_host_dma_start(hstr->index, hstr->direction,
+				snd_hdac_chip_readl(bus, WALLCLK));
+	if (lat && cmd == SNDRV_PCM_TRIGGER_START)
+		lat->host_start = ktime_get();
+}
+
+static void skl_latency_pipe_run(struct hdac_bus *bus,
+				struct hdac_stream *hstr, int cmd)
+{
+	struct skl_stream_latency *lat = skl_get_stream_latency(bus, hstr);
+
+	trace_skl_pipe_run(hstr->index, hstr->direction,
+				snd_hdac_chip_readl(bus, WALLCLK));
+	if (lat && cmd == SNDRV_PCM_TRIGGER_START)
+		lat->pipe_run = ktime_get();
+}
+
+/* Linear link position, the total of bytes moved since the link reset */
+static u64 skl_link_llp(struct hdac_ext_stream *link)
+{
+	u32 lo, hi;
+
+	do {
+		hi = readl(link->pplc_addr + AZX_REG_PPLCLLPU);
+		lo = readl(link->pplc_addr + AZX_REG_PPLCLLPL);
+	} while (hi != readl(link->pplc_addr + AZX_REG_PPLCLLPU));
+
+	return ((u64)hi << 32) | lo;
+}
+
+/* Link DMA of the BE the host stream feeds (or is fed by) starts/stops */
+static void skl_latency_link_trigger(struct hdac_bus *bus,
+				struct hdac_ext_stream *stream,
+				struct hdac_ext_stream *link,
+				struct snd_pcm_hw_params *params, int cmd,
+				bool start)
+{
+	struct skl_stream_latency *lat;
+	struct hdac_stream *hstr;
+	u32 wallclk;
+
+	/* Hostless BEs have no host stream to account against */
+	if (!stream)
+		return;
+
+	hstr = hdac_stream(stream);
+	lat = skl_get_stream_latency(bus, hstr);
+	wallclk = snd_hdac_chip_readl(bus, WALLCLK);
+
+	if (start)
+		trace_skl_link_dma_start(hstr->index, hstr->direction,
+					wallclk);
+	if (!lat)
+		return;
+
+	if (start) {
+		if (cmd == SNDRV_PCM_TRIGGER_START) {
+			lat->link_start = ktime_get();
+			lat->link = link;
+			lat->link_frame_bytes = params_channels(params) *
+					params_physical_width(params) / 8;
+			lat->link_rate = params_rate(params);
+		}
+		lat->last_wallclk = wallclk;
+		lat->link_llp = skl_link_llp(link);
+		lat->link_running = true;
+	} else if (lat->link_running) {
+		lat->link_ticks += (u32)(wallclk - lat->last_wallclk);
+		lat->link_bytes += skl_link_llp(link) - lat->link_llp;
+		lat->link_running = false;
+	}
+}
+
+/*
+ * Frames in the DSP path between the host and link DMAs, from their
+ * positions: what the host DMA fetched and the link has not played yet,
+ * or what the link captured and the host DMA has not written yet.
+ */
+static snd_pcm_sframes_t skl_latency_link_delay(struct hdac_stream *hstr,
+				struct skl_stream_latency *lat)
+{
+	u64 link_bytes = lat->link_bytes;
+	s64 link_frames, delay;
+
+	if (!lat->link || !lat->link_frame_bytes || !lat->link_rate)
+		return 0;
+
+	if (lat->link_running)
+		link_bytes += skl_link_llp(lat->link) - lat->link_llp;
+
+	/* In host stream frames, the DSP may convert the rate */
+	link_frames = div_u64(div_u64(link_bytes, lat->link_frame_bytes) *
+			      lat->rate, lat->link_rate);
+
+	delay = (s64)lat->host_frames - link_frames;
+	if (hstr->direction == SNDRV_PCM_STREAM_CAPTURE)
+		delay = -delay;
+
+	return clamp_t(s64, delay, 0, lat->buffer_size);
+}
+
+/*
+ * Sample the host DMA position, in frames, against the wall clock and
+ * update the DSP path delay. Returns the delay of the DSP path from the
+ * link position, in frames.
+ */
+static snd_pcm_sframes_t skl_latency_sample(struct hdac_bus *bus,
+				struct hdac_stream *hstr, unsigned int pos)
+{
+	struct skl_stream_latency *lat = skl_get_stream_latency(bus, hstr);
+	snd_pcm_sframes_t link_delay;
+	u64 link_frames;
+	s64 delay;
+	u32 wallclk;
+
+	if (!lat || !lat->rate || !lat->buffer_size)
+		return 0;
+
+	wallclk = snd_hdac_chip_readl(bus, WALLCLK);
+	lat->host_frames += (pos + lat->buffer_size - lat->last_pos) %
+				lat->buffer_size;
+	lat->last_pos = pos;
+	link_delay = skl_latency_link_delay(hstr, lat);
+	if (!lat->link_running)
+		return link_delay;
+
+	lat->link_ticks += (u32)(wallclk - lat->last_wallclk);
+	lat->last_wallclk = wallclk;
+	link_frames = div_u64(lat->link_ticks * lat->rate, SKL_WALLCLK_HZ);
+
+	delay = (s64)lat->host_frames - (s64)link_frames;
+	if (hstr->direction == SNDRV_PCM_STREAM_CAPTURE)
+		delay = -delay;
+
+	lat->delay_us = div_s64(delay * USEC_PER_SEC, lat->rate);
+	lat->delay_min_us = min(lat->delay_min_us, lat->delay_us);
+	lat->delay_max_us = max(lat->delay_max_us, lat->delay_us);
+	lat->samples++;
+
+	trace_skl_pcm_position(hstr->index, pos, wallclk, lat->delay_us);
+
+	return link_delay;
+}
+
 int skl_pcm_host_dma_prepare(struct device *dev, struct skl_pipe_params *params)
 {
 	struct hdac_bus *bus = dev_get_drvdata(dev);
@@ -215,6 +401,7 @@ int skl_pcm_host_dma_prepare(struct device *dev, struct skl_pipe_params *params)
 		snd_hdac_ext_stream_spbcap_enable(bus, 1, hstream->index);
 
 	hdac_stream(stream)->prepared = 1;
+	skl_latency_prepare(bus, hstream, runtime);
 
 	return 0;
 }
@@ -578,6 +765,7 @@ static int skl_pcm_trigger(struct snd_pcm_substream *substream, int cmd,
 		ret = skl_decoupled_trigger(substream, cmd);
 		if (ret < 0)
 			return ret;
+		skl_latency_host_start(bus, hdac_stream(stream), cmd);
 		/*
 		 * Period elapsed interrupts with multiple streams are not
 		 * consistent on FPGA. However, it works without any issues on
@@ -597,7 +785,10 @@ static int skl_pcm_trigger(struct snd_pcm_substream *substream, int cmd,
 #else
 		monitor->interval = SKL_MAX_TIME_INTERVAL;
 #endif
-		return skl_run_pipe(ctx, mconfig->pipe);
+		ret = skl_run_pipe(ctx, mconfig->pipe);
+		if (ret < 0)
+			return ret;
+		skl_latency_pipe_run(bus, hdac_stream(stream), cmd);
 		break;
 
 	case SNDRV_PCM_TRIGGER_PAUSE_PUSH:
@@ -720,6 +911,9 @@ static int skl_link_pcm_trigger(struct snd_pcm_substream *substream,
 				snd_soc_dai_get_dma_data(dai, substream);
 	struct hdac_bus *bus = get_bus_ctx(substream);
 	struct hdac_ext_stream *stream = get_hdac_ext_stream(substream);
+	struct snd_soc_pcm_runtime *rtd = snd_pcm_substream_chip(substream);
+	struct snd_pcm_hw_params *params =
+				&rtd->dpcm[substream->stream].hw_params;
 
 	dev_dbg(dai->dev, "In %s cmd=%d\n", __func__, cmd);
 	switch (cmd) {
@@ -727,12 +921,16 @@ static int skl_link_pcm_trigger(struct snd_pcm_substream *substream,
 	case SNDRV_PCM_TRIGGER_START:
 	case SNDRV_PCM_TRIGGER_PAUSE_RELEASE:
 		snd_hdac_ext_link_stream_start(link_dev);
+		skl_latency_link_trigger(bus, stream, link_dev, params, cmd,
+					 true);
 		break;
 
 	case SNDRV_PCM_TRIGGER_PAUSE_PUSH:
 	case SNDRV_PCM_TRIGGER_SUSPEND:
 	case SNDRV_PCM_TRIGGER_STOP:
 		snd_hdac_ext_link_stream_clear(link_dev);
+		skl_latency_link_trigger(bus, stream, link_dev, params, cmd,
+					 false);
 		if (cmd == SNDRV_PCM_TRIGGER_SUSPEND)
 			snd_hdac_ext_stream_decouple(bus, stream, false);
 		break;
@@ -946,6 +1144,19 @@ static int skl_trace_compr_copy(struct snd_compr_stream *stream,
 		return skl_probe_compr_copy(stream, dest, count, cpu_dai);
 }
 
+static int skl_trace_compr_mmap(struct snd_compr_stream *stream,
+				struct vm_area_struct *vma)
+{
+	struct snd_soc_pcm_runtime *rtd = stream->private_data;
+	int core = skl_get_compr_core(stream);
+
+	/* fw logs still go through copy */
+	if (skl_is_logging_core(core))
+		return -ENXIO;
+
+	return skl_probe_compr_mmap(stream, vma, rtd->cpu_dai);
+}
+
 static int skl_trace_compr_free(struct snd_compr_stream *stream,
 						struct snd_soc_dai *cpu_dai)
 {
@@ -968,6 +1179,7 @@ static int skl_trace_compr_free(struct snd_compr_stream *stream,
 
 static struct snd_compr_ops skl_platform_compr_ops = {
 	.copy = skl_trace_compr_copy,
+	.mmap = skl_trace_compr_mmap,
 };
 
 static struct snd_soc_cdai_ops skl_probe_compr_ops = {
@@ -1637,6 +1849,9 @@ static snd_pcm_uframes_t skl_platform_pcm_pointer
 	 * read is required to flush DMA position value.
 	 * 3. Read the DMA Position-in-Buffer. This value now will be equal to
 	 * or greater than period boundary.
+	 *
+	 * Without period wakeups there is no interrupt to wait after: the
+	 * position is polled from a timer, skip the wait there.
 	 */
 
 	if (substream->stream == SNDRV_PCM_STREAM_PLAYBACK) {
@@ -1644,7 +1859,8 @@ static snd_pcm_uframes_t skl_platform_pcm_pointer
 				(AZX_REG_VS_SDXDPIB_XINTERVAL *
 				hdac_stream(hstream)->index));
 	} else {
-		udelay(20);
+		if (!substream->runtime->no_period_wakeup)
+			udelay(20);
 		readl(bus->remap_addr +
 				AZX_REG_VS_SDXDPIB_XBASE +
 				(AZX_REG_VS_SDXDPIB_XINTERVAL *
@@ -1655,6 +1871,11 @@ static snd_pcm_uframes_t skl_platform_pcm_pointer
 	if (pos >= hdac_stream(hstream)->bufsize)
 		pos = 0;
 
+	/* Timer based schedulers rely on the DSP path delay being reported */
+	substream->runtime->delay = skl_latency_sample(bus,
+			hdac_stream(hstream),
+			bytes_to_frames(substream->runtime, pos));
+
 	return bytes_to_frames(substream->runtime, pos);
 }
 
@@ -2007,6 +2228,7 @@ int skl_platform_register(struct device *dev)
 
 	INIT_LIST_HEAD(&skl->ppl_list);
 	INIT_LIST_HEAD(&skl->bind_list);
+	INIT_LIST_HEAD(&skl->warm_pipes);
 
 	skl->dais = kmemdup(skl_platform_dai, sizeof(skl_platform_dai),
 			    GFP_KERNEL);
@@ -2015,6 +2237,11 @@ int skl_platform_register(struct device *dev)
 	if (!skl->grp_cnt.vbus_id)
 		return -ENOMEM;
 
+	skl->latency = devm_kcalloc(dev, bus->num_streams,
+				sizeof(*skl->latency), GFP_KERNEL);
+	if (!skl->latency)
+		return -ENOMEM;
+
 	skl_nhlt_get_ep_cnt(skl, NHLT_LINK_SSP);
 
 	total_dais = num_dais + skl->grp_cnt.cnt;
@@ -393,6 +393,55 @@ int skl_probe_compr_copy(struct snd_compr_stream *stream, char __user *buf,
 
 }
 
+/*
+ * Map the extractor ring read-only into userspace. All connected probe
+ * points share this ring: the FW packs the samples of each point into
+ * packets carrying the probe point id and a timestamp, so readers demux
+ * the points straight from the mapping, using the tstamp ioctl for the
+ * write position instead of copying every period out.
+ */
+int skl_probe_compr_mmap(struct snd_compr_stream *stream,
+		struct vm_area_struct *vma, struct snd_soc_dai *dai)
+{
+	struct snd_compr_runtime *runtime = stream->runtime;
+	unsigned long size = vma->vm_end - vma->vm_start;
+	unsigned long offset;
+	struct page *page;
+	int ret;
+
+	/* injection still goes through copy */
+	if (stream->direction != SND_COMPRESS_CAPTURE)
+		return -ENXIO;
+
+	if (!runtime->dma_buffer_p || vma->vm_pgoff ||
+	    size > PAGE_ALIGN(runtime->dma_bytes))
+		return -EINVAL;
+
+	if (vma->vm_flags & VM_WRITE)
+		return -EPERM;
+
+	vma->vm_flags &= ~VM_MAYWRITE;
+	vma->vm_flags |= VM_DONTEXPAND | VM_DONTDUMP;
+	/* the ring is marked uncached for the DMA, keep the alias coherent */
+	vma->vm_page_prot = pgprot_noncached(vma->vm_page_prot);
+
+	for (offset = 0; offset < size; offset += PAGE_SIZE) {
+		page = snd_sgbuf_get_page(runtime->dma_buffer_p, offset);
+		if (!page)
+			return -EINVAL;
+
+		ret = remap_pfn_range(vma, vma->vm_start + offset,
+				      page_to_pfn(page), PAGE_SIZE,
+				      vma->vm_page_prot);
+		if (ret < 0) {
+			dev_err(dai->dev, "probe ring mmap failed %d\n", ret);
+			return ret;
+		}
+	}
+
+	return 0;
+}
+
 int skl_probe_compr_trigger(struct snd_compr_stream *substream, int cmd,
 							struct snd_soc_dai *dai)
 {
@@ -33,5 +33,7 @@ int skl_probe_compr_ack(struct snd_compr_stream *substream, size_t bytes,
 					struct snd_soc_dai *dai);
 int skl_probe_compr_copy(struct snd_compr_stream *stream, char __user *buf,
 					size_t count, struct snd_soc_dai *dai);
+int skl_probe_compr_mmap(struct snd_compr_stream *stream,
+			struct vm_area_struct *vma, struct snd_soc_dai *dai);
 int skl_probe_compr_trigger(struct snd_compr_stream *substream, int cmd,
 					struct snd_soc_dai *dai);
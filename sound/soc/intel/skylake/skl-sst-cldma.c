@@ -90,15 +90,16 @@ static void skl_cldma_setup_bdle(struct sst_dsp *ctx,
 	ctx->cl_dev.frags = 0;
 	while (size > 0) {
 		phys_addr_t addr = virt_to_phys(dmab_data->area +
-				(ctx->cl_dev.frags * ctx->cl_dev.bufsize));
+				(ctx->cl_dev.frags * ctx->cl_dev.frag_size));
 
 		bdl[0] = cpu_to_le32(lower_32_bits(addr));
 		bdl[1] = cpu_to_le32(upper_32_bits(addr));
 
-		bdl[2] = cpu_to_le32(ctx->cl_dev.bufsize);
+		bdl[2] = cpu_to_le32(ctx->cl_dev.frag_size);
 
-		size -= ctx->cl_dev.bufsize;
-		bdl[3] = (size || !with_ioc) ? 0 : cpu_to_le32(0x01);
+		/* interrupt on every fragment so that it can be refilled */
+		size -= ctx->cl_dev.frag_size;
+		bdl[3] = with_ioc ? cpu_to_le32(0x01) : 0;
 
 		bdl += 4;
 		ctx->cl_dev.frags++;
@@ -164,12 +165,23 @@ static void skl_cldma_cleanup(struct sst_dsp  *ctx)
 	ctx->dsp_ops.free_dma_buf(ctx->dev, &ctx->cl_dev.dmab_bdl);
 }
 
+/* true when at least one fragment of the ring may be overwritten */
+static bool skl_cldma_frag_free(struct skl_cl_dev *cl)
+{
+	return cl->frags_queued - READ_ONCE(cl->frags_done) < cl->frags;
+}
+
+/*
+ * Wait until the DMA has drained a fragment of the ring, or for the
+ * DMA error interrupt
+ */
 int skl_cldma_wait_interruptible(struct sst_dsp *ctx)
 {
 	int ret = 0;
 
 	if (!wait_event_timeout(ctx->cl_dev.wait_queue,
-				ctx->cl_dev.wait_condition,
+				skl_cldma_frag_free(&ctx->cl_dev) ||
+				ctx->cl_dev.wake_status == SKL_CL_DMA_ERR,
 				msecs_to_jiffies(SKL_WAIT_TIMEOUT))) {
 		dev_err(ctx->dev, "%s: Wait timeout\n", __func__);
 		ret = -EIO;
@@ -177,7 +189,7 @@ int skl_cldma_wait_interruptible(struct sst_dsp *ctx)
 	}
 
 	dev_dbg(ctx->dev, "%s: Event wake\n", __func__);
-	if (ctx->cl_dev.wake_status != SKL_CL_DMA_BUF_COMPLETE) {
+	if (ctx->cl_dev.wake_status == SKL_CL_DMA_ERR) {
 		dev_err(ctx->dev, "%s: DMA Error\n", __func__);
 		ret = -EIO;
 	}
@@ -190,6 +202,10 @@ int skl_cldma_wait_interruptible(struct sst_dsp *ctx)
 static void skl_cldma_stop(struct sst_dsp *ctx)
 {
 	skl_cldma_stream_run(ctx, false);
+
+	/* nothing is in flight anymore */
+	ctx->cl_dev.frags_queued = 0;
+	WRITE_ONCE(ctx->cl_dev.frags_done, 0);
 }
 
 static void skl_cldma_fill_buffer(struct sst_dsp *ctx, unsigned int size,
@@ -223,8 +239,6 @@ static void skl_cldma_fill_buffer(struct sst_dsp *ctx, unsigned int size,
 	else
 		ctx->cl_dev.dma_buffer_offset = ctx->cl_dev.curr_spib_pos;
 
-	ctx->cl_dev.wait_condition = false;
-
 	if (intr_enable)
 		skl_cldma_int_enable(ctx);
 
@@ -237,24 +251,28 @@ static void skl_cldma_fill_buffer(struct sst_dsp *ctx, unsigned int size,
  * The CL dma doesn't have any way to update the transfer status until a BDL
  * buffer is fully transferred
  *
- * So Copying is divided in two parts.
- * 1. Interrupt on buffer done where the size to be transferred is more than
- *    ring buffer size.
- * 2. Polling on fw register to identify if data left to transferred doesn't
- *    fill the ring buffer. Caller takes care of polling the required status
- *    register to identify the transfer status.
- * 3. if wait flag is set, waits for DBL interrupt to copy the next chunk till
- *    bytes_left is 0.
- *    if wait flag is not set, doesn't wait for BDL interrupt. after ccopying
- *    the first chunk return the no of bytes_left to be copied.
+ * The ring is split in SKL_CL_DMA_NR_FRAGS buffer descriptors, each with
+ * IOC set, so one can be refilled while the DMA drains the other. Copying
+ * is done in chunks ending on a fragment boundary:
+ * 1. While more than a fragment is left, the chunk is queued with the
+ *    interrupt enabled and the next fragment is filled as soon as one is
+ *    free.
+ * 2. The last chunk is queued with the interrupt disabled. Caller takes care
+ *    of polling the required status register to identify the transfer
+ *    status.
+ * 3. if wait flag is set, waits for BDL interrupts to copy the next chunks
+ *    till bytes_left is 0.
+ *    if wait flag is not set, doesn't wait for BDL interrupt. after filling
+ *    all free fragments return the no of bytes_left to be copied.
  */
 static int
 skl_cldma_copy_to_buf(struct sst_dsp *ctx, const void *bin,
 			u32 total_size, bool wait)
 {
+	struct skl_cl_dev *cl = &ctx->cl_dev;
 	int ret = 0;
 	bool start = true;
-	unsigned int excess_bytes;
+	unsigned int wr_pos;
 	u32 size;
 	unsigned int bytes_left = total_size;
 	const void *curr_pos = bin;
@@ -265,47 +283,40 @@ skl_cldma_copy_to_buf(struct sst_dsp *ctx, const void *bin,
 	dev_dbg(ctx->dev, "%s: Total binary size: %u\n", __func__, bytes_left);
 
 	while (bytes_left) {
-		if (bytes_left > ctx->cl_dev.bufsize) {
-
-			/*
-			 * dma transfers only till the write pointer as
-			 * updated in spib
-			 */
-			if (ctx->cl_dev.curr_spib_pos == 0)
-				ctx->cl_dev.curr_spib_pos = ctx->cl_dev.bufsize;
+		if (!skl_cldma_frag_free(cl)) {
+			if (!wait)
+				return bytes_left;
+
+			ret = skl_cldma_wait_interruptible(ctx);
+			if (ret < 0) {
+				skl_cldma_stop(ctx);
+				return ret;
+			}
+		}
 
-			size = ctx->cl_dev.bufsize;
+		/*
+		 * dma transfers only till the write pointer as updated in
+		 * spib, a chunk never crosses a fragment boundary so that
+		 * each IOC frees exactly one chunk
+		 */
+		wr_pos = cl->curr_spib_pos % cl->bufsize;
+		size = cl->frag_size - (wr_pos % cl->frag_size);
+
+		if (bytes_left > size) {
+			cl->curr_spib_pos = wr_pos + size;
+			cl->frags_queued++;
 			skl_cldma_fill_buffer(ctx, size, curr_pos, true, start);
-
-			if (wait) {
-				start = false;
-				ret = skl_cldma_wait_interruptible(ctx);
-				if (ret < 0) {
-					skl_cldma_stop(ctx);
-					return ret;
-				}
-			}
 		} else {
 			skl_cldma_int_disable(ctx);
 
-			if ((ctx->cl_dev.curr_spib_pos + bytes_left)
-							<= ctx->cl_dev.bufsize) {
-				ctx->cl_dev.curr_spib_pos += bytes_left;
-			} else {
-				excess_bytes = bytes_left -
-					(ctx->cl_dev.bufsize -
-					ctx->cl_dev.curr_spib_pos);
-				ctx->cl_dev.curr_spib_pos = excess_bytes;
-			}
-
 			size = bytes_left;
+			cl->curr_spib_pos = wr_pos + size;
 			skl_cldma_fill_buffer(ctx, size,
 					curr_pos, false, start);
 		}
+		start = false;
 		bytes_left -= size;
 		curr_pos = curr_pos + size;
-		if (!wait)
-			return bytes_left;
 	}
 
 	return bytes_left;
@@ -318,12 +329,17 @@ void skl_cldma_process_intr(struct sst_dsp *ctx)
 	cl_dma_intr_status =
 		sst_dsp_shim_read_unlocked(ctx, SKL_ADSP_REG_CL_SD_STS);
 
-	if (!(cl_dma_intr_status & SKL_CL_DMA_SD_INT_COMPLETE))
+	if (!(cl_dma_intr_status & SKL_CL_DMA_SD_INT_COMPLETE)) {
 		ctx->cl_dev.wake_status = SKL_CL_DMA_ERR;
-	else
+	} else {
 		ctx->cl_dev.wake_status = SKL_CL_DMA_BUF_COMPLETE;
+		WRITE_ONCE(ctx->cl_dev.frags_done, ctx->cl_dev.frags_done + 1);
+
+		/* the other fragment is still in flight, keep listening */
+		if (ctx->cl_dev.frags_done < ctx->cl_dev.frags_queued)
+			skl_cldma_int_enable(ctx);
+	}
 
-	ctx->cl_dev.wait_condition = true;
 	wake_up(&ctx->cl_dev.wait_queue);
 }
 
@@ -333,6 +349,7 @@ int skl_cldma_prepare(struct sst_dsp *ctx)
 	__le32 *bdl;
 
 	ctx->cl_dev.bufsize = SKL_MAX_BUFFER_SIZE;
+	ctx->cl_dev.frag_size = SKL_MAX_BUFFER_SIZE / SKL_CL_DMA_NR_FRAGS;
 
 	/* Allocate cl ops */
 	ctx->cl_dev.ops.cl_setup_bdle = skl_cldma_setup_bdle;
@@ -369,6 +386,8 @@ int skl_cldma_prepare(struct sst_dsp *ctx)
 
 	ctx->cl_dev.curr_spib_pos = 0;
 	ctx->cl_dev.dma_buffer_offset = 0;
+	ctx->cl_dev.frags_queued = 0;
+	ctx->cl_dev.frags_done = 0;
 	init_waitqueue_head(&ctx->cl_dev.wait_queue);
 
 	return ret;
@@ -190,7 +190,9 @@
 
 /* SST IPC SKL defines */
 #define SKL_WAIT_TIMEOUT		500	/* 500 msec */
-#define SKL_MAX_BUFFER_SIZE		(32 * PAGE_SIZE)
+#define SKL_MAX_BUFFER_SIZE		(64 * PAGE_SIZE)
+/* the ring is split in halves, one is filled while the other is in flight */
+#define SKL_CL_DMA_NR_FRAGS		2
 
 enum skl_cl_dma_wake_states {
 	SKL_CL_DMA_STATUS_NONE = 0,
@@ -223,13 +225,15 @@ struct skl_cl_dev_ops {
  * @dmab_data: buffer pointer
  * @dmab_bdl: buffer descriptor list
  * @bufsize: ring buffer size
+ * @frag_size: size of each buffer descriptor, bufsize / SKL_CL_DMA_NR_FRAGS
  * @frags: Last valid buffer descriptor index in the BDL
+ * @frags_queued: fragments handed to the DMA with IOC set
+ * @frags_done: IOC interrupts received for the queued fragments
  * @curr_spib_pos: Current position in ring buffer
  * @dma_buffer_offset: dma buffer offset
  * @ops: operations supported on CL dma
  * @wait_queue: wait queue to wake for wake event
  * @wake_status: DMA wake status
- * @wait_condition: condition to wait on wait queue
  * @cl_dma_lock: for synchronized access to cldma
  */
 struct skl_cl_dev {
@@ -237,7 +241,10 @@ struct skl_cl_dev {
 	struct snd_dma_buffer dmab_bdl;
 
 	unsigned int bufsize;
+	unsigned int frag_size;
 	unsigned int frags;
+	unsigned int frags_queued;
+	unsigned int frags_done;
 
 	unsigned int curr_spib_pos;
 	unsigned int dma_buffer_offset;
@@ -245,7 +252,6 @@ struct skl_cl_dev {
 
 	wait_queue_head_t wait_queue;
 	int wake_status;
-	bool wait_condition;
 };
 
 #endif /* SKL_SST_CLDMA_H_ */
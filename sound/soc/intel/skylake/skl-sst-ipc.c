@@ -631,6 +631,7 @@ int skl_ipc_process_notification(struct sst_generic_ipc *ipc,
 			break;
 
 		case IPC_GLB_NOTIFY_FW_READY:
+			skl->boot_complete_time = ktime_get();
 			skl->boot_complete = true;
 			wake_up(&skl->boot_wait);
 			break;
@@ -722,7 +723,18 @@ void skl_ipc_process_reply(struct sst_generic_ipc *ipc,
 				IPC_MOD_LARGE_CONFIG_GET)
 			msg->rx_size = header.extension &
 				IPC_DATA_OFFSET_SZ_MASK;
-		sst_dsp_inbox_read(ipc->dsp, msg->rx_data, msg->rx_size);
+		/*
+		 * The waiter can't time out and drop the message while we hold
+		 * the lock, so read straight into its buffer when it fits.
+		 */
+		if (msg->rx_buf && msg->rx_size <= msg->rx_buf_size) {
+			sst_dsp_inbox_read(ipc->dsp, msg->rx_buf,
+					   msg->rx_size);
+			msg->rx_direct = true;
+		} else {
+			sst_dsp_inbox_read(ipc->dsp, msg->rx_data,
+					   msg->rx_size);
+		}
 		switch (IPC_GLB_NOTIFY_MSG_TYPE(header.primary)) {
 		case IPC_GLB_LOAD_MULTIPLE_MODS:
 		case IPC_GLB_LOAD_LIBRARY:
@@ -822,7 +834,10 @@ irqreturn_t skl_dsp_irq_thread_handler(int irq, void *context)
 	skl_ipc_int_enable(dsp);
 
 	/* continue to send any remaining messages... */
-	schedule_work(&ipc->kwork);
+	if (ipc->ops.direct_tx_msg)
+		ipc->ops.direct_tx_msg(ipc);
+	else
+		schedule_work(&ipc->kwork);
 
 	return IRQ_HANDLED;
 }
@@ -1198,6 +1213,8 @@ int skl_ipc_set_large_config(struct sst_generic_ipc *ipc,
 {
 	struct skl_ipc_header header = {0};
 	u64 *ipc_header = (u64 *)(&header);
+	struct sst_ipc_batch_msg batch[IPC_BATCH_MAX];
+	unsigned int count = 0;
 	int ret = 0;
 	size_t sz_remaining, tx_size, data_offset;
 
@@ -1224,13 +1241,20 @@ int skl_ipc_set_large_config(struct sst_generic_ipc *ipc,
 			header.primary, header.extension);
 		dev_dbg(ipc->dev, "transmitting offset: %#x, size: %#x\n",
 			(unsigned)data_offset, (unsigned)tx_size);
-		ret = sst_ipc_tx_message_wait(ipc, *ipc_header,
-					  ((char *)param) + data_offset,
-					  tx_size, NULL, NULL);
-		if (ret < 0) {
-			dev_err(ipc->dev,
-				"ipc: set large config fail, err: %d\n", ret);
-			return ret;
+
+		/* chunks are queued back to back, a window at a time */
+		batch[count].header = *ipc_header;
+		batch[count].tx_data = ((char *)param) + data_offset;
+		batch[count].tx_bytes = tx_size;
+		if (++count == IPC_BATCH_MAX || tx_size == sz_remaining) {
+			ret = sst_ipc_tx_message_batch(ipc, batch, count);
+			if (ret < 0) {
+				dev_err(ipc->dev,
+					"ipc: set large config fail, err: %d\n",
+					ret);
+				return ret;
+			}
+			count = 0;
 		}
 		sz_remaining -= tx_size;
 		data_offset = msg->param_data_size - sz_remaining;
@@ -17,6 +17,7 @@
 #define __SKL_IPC_H
 
 #include <linux/irqreturn.h>
+#include <linux/ktime.h>
 #include <sound/memalloc.h>
 #include "../common/sst-ipc.h"
 #include "skl-sst-dsp.h"
@@ -244,6 +245,21 @@ struct skl_notify_kctrl_info {
 	struct snd_kcontrol *notify_kctl;
 };
 
+/**
+ * struct skl_boot_time - breakdown of the last DSP boot, in usecs
+ *
+ * @rom_init: core power up until the ROM accepts the base FW
+ * @fw_xfer: base FW transfer over the code loader DMA
+ * @fw_ready: end of the transfer until the FW ready notification
+ * @lib_load: transfer of all the libraries
+ */
+struct skl_boot_time {
+	s64 rom_init;
+	s64 fw_xfer;
+	s64 fw_ready;
+	s64 lib_load;
+};
+
 struct skl_sst {
 	struct device *dev;
 	struct sst_dsp *dsp;
@@ -251,6 +267,8 @@ struct skl_sst {
 	/* boot */
 	wait_queue_head_t boot_wait;
 	bool boot_complete;
+	/* when the FW Ready notification arrived */
+	ktime_t boot_complete_time;
 
 	/* module load */
 	wait_queue_head_t mod_load_wait;
@@ -281,6 +299,9 @@ struct skl_sst {
 	struct skl_lib_info  lib_info[SKL_MAX_LIB];
 	int lib_count;
 
+	/* last boot time breakdown, shown in debugfs */
+	struct skl_boot_time boot_time;
+
 	/* Callback to update D0i3C register */
 	void (*update_d0i3c)(struct device *dev, bool enable);
 
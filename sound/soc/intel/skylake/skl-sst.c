@@ -20,6 +20,7 @@
 #include <linux/delay.h>
 #include <linux/device.h>
 #include <linux/err.h>
+#include <linux/ktime.h>
 #include <linux/uuid.h>
 #include "../common/sst-dsp.h"
 #include "../common/sst-dsp-priv.h"
@@ -71,11 +72,31 @@ static int skl_transfer_firmware(struct sst_dsp *ctx,
 
 #define SKL_ADSP_FW_BIN_HDR_OFFSET 0x284
 
+/*
+ * Fetch the library binaries which are not cached yet while the base FW
+ * boots, so that they are ready to go once it reports ready. Failures are
+ * reported when the library is actually loaded.
+ */
+static void skl_prefetch_libs(struct skl_sst *skl)
+{
+	struct skl_lib_info *linfo;
+	int i;
+
+	/* library indices start from 1 to N. 0 represents base FW */
+	for (i = 1; i < skl->lib_count; i++) {
+		linfo = &skl->lib_info[i];
+		if (!linfo->fw && request_firmware(&linfo->fw, linfo->name,
+						   skl->dev) < 0)
+			linfo->fw = NULL;
+	}
+}
+
 static int skl_load_base_firmware(struct sst_dsp *ctx)
 {
 	int ret = 0, i;
 	struct skl_sst *skl = ctx->thread_context;
 	struct firmware stripped_fw;
+	ktime_t start, rom_done, xfer_done;
 	u32 reg;
 
 	skl->boot_complete = false;
@@ -106,6 +127,7 @@ static int skl_load_base_firmware(struct sst_dsp *ctx)
 
 	skl_dsp_strip_extended_manifest(&stripped_fw);
 
+	start = ktime_get();
 	ret = skl_dsp_boot(ctx);
 	if (ret < 0) {
 		dev_err(ctx->dev, "Boot dsp core failed ret: %d\n", ret);
@@ -138,12 +160,16 @@ static int skl_load_base_firmware(struct sst_dsp *ctx)
 		ret = -EIO;
 		goto transfer_firmware_failed;
 	}
+	rom_done = ktime_get();
 
 	ret = skl_transfer_firmware(ctx, stripped_fw.data, stripped_fw.size);
 	if (ret < 0) {
 		dev_err(ctx->dev, "Transfer firmware failed%d\n", ret);
 		goto transfer_firmware_failed;
 	} else {
+		xfer_done = ktime_get();
+		skl_prefetch_libs(skl);
+
 		ret = wait_event_timeout(skl->boot_wait, skl->boot_complete,
 					msecs_to_jiffies(SKL_IPC_BOOT_MSECS));
 		if (ret == 0) {
@@ -152,6 +178,12 @@ static int skl_load_base_firmware(struct sst_dsp *ctx)
 			goto transfer_firmware_failed;
 		}
 
+		skl->boot_time.rom_init = ktime_us_delta(rom_done, start);
+		skl->boot_time.fw_xfer = ktime_us_delta(xfer_done, rom_done);
+		/* library prefetch may well outlast the FW boot */
+		skl->boot_time.fw_ready =
+			ktime_us_delta(skl->boot_complete_time, xfer_done);
+
 		ret = skl_get_firmware_configuration(ctx);
 		if (ret < 0) {
 			dev_err(ctx->dev, "FW version query failed\n");
@@ -405,6 +437,7 @@ skl_load_library(struct sst_dsp *ctx, struct skl_lib_info *linfo, int lib_count)
 {
 	struct skl_sst *skl = ctx->thread_context;
 	struct firmware stripped_fw;
+	ktime_t start = ktime_get();
 	int ret, i;
 
 	/* library indices start from 1 to N. 0 represents base FW */
@@ -419,6 +452,8 @@ skl_load_library(struct sst_dsp *ctx, struct skl_lib_info *linfo, int lib_count)
 			goto load_library_failed;
 	}
 
+	skl->boot_time.lib_load = ktime_us_delta(ktime_get(), start);
+
 	return 0;
 
 load_library_failed:
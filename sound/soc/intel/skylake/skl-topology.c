@@ -831,8 +831,8 @@ int skl_probe_point_set_config(struct snd_soc_dapm_widget *w,
 	struct skl_module_cfg *mconfig = w->priv;
 	const struct snd_kcontrol_new *k;
 	struct skl_probe_config *pconfig = &ctx->probe_config;
-	struct probe_pt_param prb_pt_param[8] = {{0}};
-	int store_prb_pt_index[8] = {0};
+	struct probe_pt_param prb_pt_param[NO_OF_EXTRACTOR] = {{0}};
+	int store_prb_pt_index[NO_OF_EXTRACTOR] = {0};
 
 	if (direction == SND_COMPRESS_PLAYBACK) {
 
@@ -1240,6 +1240,187 @@ skl_tplg_get_pipe_config(struct skl *skl, struct skl_module_cfg *mconfig)
 	return -EINVAL;
 }
 
+/*
+ * Tear down a pipe whose mcps have already been released:
+ *   - Free the mem used
+ *   - Unbind the modules within the pipeline
+ *   - Delete the pipeline (modules are not required to be explicitly
+ *     deleted, pipeline delete is enough here
+ */
+static int skl_tplg_delete_pipe(struct skl *skl, struct skl_module_cfg *mconfig)
+{
+	struct skl_pipe_module *w_module;
+	struct skl_module_cfg *src_module = NULL, *dst_module;
+	struct skl_sst *ctx = skl->skl_sst;
+	struct skl_pipe *s_pipe = mconfig->pipe;
+	struct skl_module_deferred_bind *modules, *tmp;
+
+	skl_tplg_free_pipe_mem(skl, mconfig);
+
+	list_for_each_entry(w_module, &s_pipe->w_list, node) {
+		if (list_empty(&skl->bind_list))
+			break;
+
+		src_module = w_module->w->priv;
+
+		list_for_each_entry_safe(modules, tmp, &skl->bind_list, node) {
+			/*
+			 * When the destination module is deleted, Unbind the
+			 * modules from deferred bind list.
+			 */
+			if (modules->dst == src_module) {
+				skl_unbind_modules(ctx, modules->src,
+						modules->dst);
+			}
+
+			/*
+			 * When the source module is deleted, remove this entry
+			 * from the deferred bind list.
+			 */
+			if (modules->src == src_module) {
+				list_del(&modules->node);
+				modules->src = NULL;
+				modules->dst = NULL;
+				kfree(modules);
+			}
+		}
+	}
+
+	src_module = NULL;
+	list_for_each_entry(w_module, &s_pipe->w_list, node) {
+		dst_module = w_module->w->priv;
+
+		if (src_module == NULL) {
+			src_module = dst_module;
+			continue;
+		}
+
+		skl_unbind_modules(ctx, src_module, dst_module);
+		src_module = dst_module;
+	}
+
+	skl_delete_pipe(ctx, mconfig->pipe);
+
+	list_for_each_entry(w_module, &s_pipe->w_list, node) {
+		src_module = w_module->w->priv;
+		src_module->m_state = SKL_MODULE_UNINIT;
+	}
+
+	return skl_tplg_unload_pipe_modules(ctx, s_pipe);
+}
+
+/*
+ * Warm pipes are pipelines left created (in reset) in the DSP after the
+ * stream using them stopped, so that reopening the stream with the same
+ * parameters skips the create/init/bind IPCs. They keep their memory
+ * pages but not their mcps.
+ */
+static void skl_tplg_evict_warm_pipe(struct skl *skl, struct skl_pipe *pipe)
+{
+	list_del_init(&pipe->warm_node);
+	pipe->warm = false;
+	skl->warm_mem -= pipe->memory_pages;
+
+	skl_tplg_delete_pipe(skl, pipe->warm_mcfg);
+}
+
+/* Evict least recently used warm pipes until @pages more pages fit */
+static void skl_tplg_evict_warm_pipes(struct skl *skl, u32 pages)
+{
+	struct skl_pipe *pipe;
+
+	while (!list_empty(&skl->warm_pipes) &&
+	       skl->resource.mem + pages > skl->resource.max_mem) {
+		pipe = list_first_entry(&skl->warm_pipes, struct skl_pipe,
+					warm_node);
+		skl_tplg_evict_warm_pipe(skl, pipe);
+	}
+}
+
+static bool skl_tplg_warm_params_match(struct skl_pipe *pipe)
+{
+	struct skl_pipe_params *old = &pipe->warm_params;
+	struct skl_pipe_params *new = pipe->p_params;
+
+	if (!new)
+		return false;
+
+	return old->host_dma_id == new->host_dma_id &&
+	       old->link_dma_id == new->link_dma_id &&
+	       old->ch == new->ch &&
+	       old->s_freq == new->s_freq &&
+	       old->s_fmt == new->s_fmt &&
+	       old->linktype == new->linktype &&
+	       old->format == new->format &&
+	       old->link_index == new->link_index &&
+	       old->host_bps == new->host_bps &&
+	       old->link_bps == new->link_bps;
+}
+
+/*
+ * Try to park a pipe which is being powered down on the warm list.
+ * Returns true if the pipe was kept, in which case its mcps have been
+ * released and its modules stay loaded, initialized and bound.
+ */
+static bool skl_tplg_park_warm_pipe(struct skl *skl,
+				    struct skl_module_cfg *mconfig)
+{
+	struct skl_pipe *pipe = mconfig->pipe;
+	struct skl_sst *ctx = skl->skl_sst;
+
+	if (!pipe->p_params || pipe->memory_pages > skl->warm_mem_budget)
+		return false;
+
+	while (!list_empty(&skl->warm_pipes) &&
+	       skl->warm_mem + pipe->memory_pages > skl->warm_mem_budget)
+		skl_tplg_evict_warm_pipe(skl,
+				list_first_entry(&skl->warm_pipes,
+						 struct skl_pipe, warm_node));
+
+	if (skl_reset_pipe(ctx, pipe) < 0)
+		return false;
+
+	pipe->warm_params = *pipe->p_params;
+	pipe->warm_mcfg = mconfig;
+	pipe->warm = true;
+	list_add_tail(&pipe->warm_node, &skl->warm_pipes);
+	skl->warm_mem += pipe->memory_pages;
+
+	return true;
+}
+
+/*
+ * Reclaim a warm pipe for a new stream. Returns true if the pipe was
+ * reused as is, false if it was evicted and must be created again.
+ */
+static bool skl_tplg_reuse_warm_pipe(struct skl *skl,
+				     struct skl_module_cfg *mconfig)
+{
+	struct skl_pipe *pipe = mconfig->pipe;
+	struct skl_pipe_module *w_module;
+	struct skl_module_cfg *module;
+
+	if (skl_tplg_warm_params_match(pipe) &&
+	    skl_is_pipe_mcps_avail(skl, mconfig)) {
+		list_del_init(&pipe->warm_node);
+		pipe->warm = false;
+		skl->warm_mem -= pipe->memory_pages;
+
+		/* same accounting as the create and init path */
+		skl_tplg_alloc_pipe_mcps(skl, mconfig);
+		list_for_each_entry(w_module, &pipe->w_list, node) {
+			module = w_module->w->priv;
+			skl_tplg_alloc_pipe_mcps(skl, module);
+		}
+
+		return true;
+	}
+
+	skl_tplg_evict_warm_pipe(skl, pipe);
+
+	return false;
+}
+
 /*
  * Mixer module represents a pipeline. So in the Pre-PMU event of mixer we
  * need create the pipeline. So we do following:
@@ -1259,6 +1440,11 @@ static int skl_tplg_mixer_dapm_pre_pmu_event(struct snd_soc_dapm_widget *w,
 	struct skl_sst *ctx = skl->skl_sst;
 	struct skl_module_deferred_bind *modules;
 
+	if (s_pipe->warm) {
+		if (skl_tplg_reuse_warm_pipe(skl, mconfig))
+			goto deferred_bind;
+	}
+
 	if (mconfig->pipe->state >= SKL_PIPE_CREATED)
 		return 0;
 
@@ -1278,6 +1464,8 @@ static int skl_tplg_mixer_dapm_pre_pmu_event(struct snd_soc_dapm_widget *w,
 	if (!skl_is_pipe_mcps_avail(skl, mconfig))
 		return -EBUSY;
 
+	skl_tplg_evict_warm_pipes(skl, mconfig->pipe->memory_pages);
+
 	if (!skl_is_pipe_mem_avail(skl, mconfig))
 		return -ENOMEM;
 
@@ -1313,6 +1501,7 @@ static int skl_tplg_mixer_dapm_pre_pmu_event(struct snd_soc_dapm_widget *w,
 		src_module = dst_module;
 	}
 
+deferred_bind:
 	/*
 	 * When the destination module is initialized, check for these modules
 	 * in deferred bind list. If found, bind them.
@@ -1841,6 +2030,7 @@ static int skl_tplg_mixer_dapm_pre_pmd_event(struct snd_soc_dapm_widget *w,
 /*
  * in the Post-PMD event of mixer we need to do following:
  *   - Free the mcps used
+ *   - Keep the pipe warm if it fits in the warm pipe budget, otherwise:
  *   - Free the mem used
  *   - Unbind the modules within the pipeline
  *   - Delete the pipeline (modules are not required to be explicitly
@@ -1851,68 +2041,44 @@ static int skl_tplg_mixer_dapm_post_pmd_event(struct snd_soc_dapm_widget *w,
 {
 	struct skl_module_cfg *mconfig = w->priv;
 	struct skl_pipe_module *w_module;
-	struct skl_module_cfg *src_module = NULL, *dst_module;
+	struct skl_module_cfg *dst_module;
 	struct skl_sst *ctx = skl->skl_sst;
 	struct skl_pipe *s_pipe = mconfig->pipe;
-	struct skl_module_deferred_bind *modules, *tmp;
+	struct skl_module_deferred_bind *modules;
 
 	if (s_pipe->state == SKL_PIPE_INVALID)
 		return -EINVAL;
 
 	skl_tplg_free_pipe_mcps(skl, mconfig);
-	skl_tplg_free_pipe_mem(skl, mconfig);
-
-	list_for_each_entry(w_module, &s_pipe->w_list, node) {
-		if (list_empty(&skl->bind_list))
-			break;
-
-		src_module = w_module->w->priv;
-
-		list_for_each_entry_safe(modules, tmp, &skl->bind_list, node) {
-			/*
-			 * When the destination module is deleted, Unbind the
-			 * modules from deferred bind list.
-			 */
-			if (modules->dst == src_module) {
-				skl_unbind_modules(ctx, modules->src,
-						modules->dst);
-			}
-
-			/*
-			 * When the source module is deleted, remove this entry
-			 * from the deferred bind list.
-			 */
-			if (modules->src == src_module) {
-				list_del(&modules->node);
-				modules->src = NULL;
-				modules->dst = NULL;
-				kfree(modules);
-			}
-		}
-	}
 
 	list_for_each_entry(w_module, &s_pipe->w_list, node) {
 		dst_module = w_module->w->priv;
 
 		if (mconfig->m_state >= SKL_MODULE_INIT_DONE)
 			skl_tplg_free_pipe_mcps(skl, dst_module);
-		if (src_module == NULL) {
-			src_module = dst_module;
-			continue;
-		}
-
-		skl_unbind_modules(ctx, src_module, dst_module);
-		src_module = dst_module;
 	}
 
-	skl_delete_pipe(ctx, mconfig->pipe);
+	if (skl_tplg_park_warm_pipe(skl, mconfig)) {
+		/*
+		 * Deferred binds into this pipe are redone when it is
+		 * reused, drop them now like a delete would.
+		 */
+		list_for_each_entry(w_module, &s_pipe->w_list, node) {
+			if (list_empty(&skl->bind_list))
+				break;
 
-	list_for_each_entry(w_module, &s_pipe->w_list, node) {
-		src_module = w_module->w->priv;
-		src_module->m_state = SKL_MODULE_UNINIT;
+			dst_module = w_module->w->priv;
+			list_for_each_entry(modules, &skl->bind_list, node) {
+				if (modules->dst == dst_module)
+					skl_unbind_modules(ctx, modules->src,
+							modules->dst);
+			}
+		}
+
+		return 0;
 	}
 
-	return skl_tplg_unload_pipe_modules(ctx, s_pipe);
+	return skl_tplg_delete_pipe(skl, mconfig);
 }
 
 /*
@@ -4359,6 +4525,17 @@ void skl_cleanup_resources(struct skl *skl)
 	skl->resource.mem = 0;
 	skl->resource.mcps = 0;
 
+	/* the DSP is going down, warm pipes are lost with it */
+	while (!list_empty(&skl->warm_pipes)) {
+		struct skl_pipe *pipe;
+
+		pipe = list_first_entry(&skl->warm_pipes, struct skl_pipe,
+					warm_node);
+		list_del_init(&pipe->warm_node);
+		pipe->warm = false;
+	}
+	skl->warm_mem = 0;
+
 	list_for_each_entry(w, &card->widgets, list) {
 		if (is_skl_dsp_widget_type(w, ctx->dev) && w->priv != NULL)
 			skl_clear_pin_config(soc_component, w);
@@ -352,6 +352,11 @@ struct skl_pipe {
 	struct list_head w_list;
 	bool passthru;
 	u32 pipe_config_idx;
+	/* set while the pipe sits on skl->warm_pipes */
+	bool warm;
+	struct list_head warm_node;
+	struct skl_pipe_params warm_params;
+	struct skl_module_cfg *warm_mcfg;
 };
 
 enum skl_module_state {
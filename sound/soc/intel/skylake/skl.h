@@ -134,6 +134,40 @@ struct skl_monitor {
 	u32 *intervals;
 };
 
+/*
+ * Latency of one host DMA stream. The ktime stamps cover the way from
+ * host DMA prepare to link DMA start. Once running, the position of the
+ * host DMA is sampled against the controller wall clock: delay is what
+ * the host DMA moved ahead of (playback) or behind (capture) the frames
+ * the link moved since it started, i.e. what sits in the DSP path.
+ */
+struct skl_stream_latency {
+	ktime_t prepare;
+	ktime_t host_start;
+	ktime_t pipe_run;
+	ktime_t link_start;
+
+	unsigned int rate;
+	unsigned int buffer_size;	/* frames */
+	unsigned int last_pos;		/* frames */
+	u32 last_wallclk;
+	u64 host_frames;
+	u64 link_ticks;			/* wall clock ticks the link ran */
+	bool link_running;
+
+	/* Link DMA linear position, for the delay of the DSP path */
+	struct hdac_ext_stream *link;
+	u64 link_llp;			/* LLP when the link last started */
+	u64 link_bytes;			/* bytes the link moved until then */
+	unsigned int link_frame_bytes;
+	unsigned int link_rate;
+
+	s64 delay_us;
+	s64 delay_min_us;
+	s64 delay_max_us;
+	u32 samples;
+};
+
 struct skl {
 	struct hdac_bus hbus;
 	struct pci_dev *pci;
@@ -154,6 +188,18 @@ struct skl {
 	struct list_head ppl_list;
 	struct list_head bind_list;
 
+	/*
+	 * Pipelines kept created in the DSP after their last user went
+	 * away, least recently used first. warm_mem is the number of pages
+	 * they hold, which may not exceed warm_mem_budget.
+	 */
+	struct list_head warm_pipes;
+	u32 warm_mem;
+	u32 warm_mem_budget;
+
+	/* indexed by host DMA stream index */
+	struct skl_stream_latency *latency;
+
 	const char *fw_name;
 	char tplg_name[64];
 	unsigned short pci_id;
@@ -0,0 +1,253 @@
+// SPDX-License-Identifier: GPL-2.0
+#define _GNU_SOURCE
+#include <fcntl.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#include <linux/types.h>
+
+#define MB (1UL << 20)
+#define KB (1UL << 10)
+#define PAGE_SIZE sysconf(_SC_PAGESIZE)
+
+#define MM_BENCH_FAULT		_IOWR('b', 1, struct mm_benchmark)
+#define MM_BENCH_DMABUF_MAP	_IOWR('b', 2, struct mm_benchmark)
+
+#define MM_BENCH_WRITE		0x1
+
+struct mm_benchmark {
+	__u64 delta_nsec;
+	__u64 delta_cycles;
+	__u64 addr;
+	__u64 size;
+	__u64 stride;
+	__u32 nr_iter;
+	__u32 flags;
+	__s32 fd;
+	__u32 cpu;
+};
+
+#define ION_IOC_ALLOC		_IOWR('I', 0, struct ion_allocation_data)
+
+struct ion_allocation_data {
+	__u64 len;
+	__u32 heap_id_mask;
+	__u32 flags;
+	__u32 fd;
+	__u32 unused;
+};
+
+static unsigned long size = 128 * MB, stride;
+static int repeats = 1, nr_iter = 1, do_write, thp = -1, nr_threads = 1;
+static unsigned int ion_heap_mask;
+static const char *file;
+static pthread_barrier_t barrier;
+
+static inline __u64 now_nsec(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void *map_range(int id)
+{
+	int flags = MAP_PRIVATE | MAP_ANONYMOUS, fd = -1;
+	unsigned long off;
+	char path[256];
+	void *p;
+
+	if (file) {
+		snprintf(path, sizeof(path), "%s.%d", file, id);
+		fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0600);
+		if (fd == -1 || ftruncate(fd, size))
+			perror("open"), exit(1);
+		unlink(path);
+		flags = MAP_SHARED;
+	}
+
+	p = mmap(NULL, size, PROT_READ | PROT_WRITE, flags, fd, 0);
+	if (p == MAP_FAILED)
+		perror("mmap"), exit(1);
+
+	if (thp == 1)
+		madvise(p, size, MADV_HUGEPAGE);
+	else if (thp == 0)
+		madvise(p, size, MADV_NOHUGEPAGE);
+
+	/* Populate the page cache, the benchmark then times minor faults */
+	if (file)
+		for (off = 0; off < size; off += PAGE_SIZE)
+			((char *)p)[off] = 0;
+
+	return p;
+}
+
+static void bench_fault(int fd, int id)
+{
+	struct mm_benchmark bench = {};
+	int i;
+
+	bench.addr = (unsigned long)map_range(id);
+	bench.stride = stride ?: PAGE_SIZE;
+	bench.nr_iter = nr_iter;
+	bench.flags = do_write ? MM_BENCH_WRITE : 0;
+
+	for (i = 0; i < repeats; i++) {
+		unsigned long long nr_faults;
+
+		bench.size = size;
+		pthread_barrier_wait(&barrier);
+		if (ioctl(fd, MM_BENCH_FAULT, &bench))
+			perror("ioctl"), exit(1);
+
+		nr_faults = bench.size / bench.stride * nr_iter ?: 1;
+		printf("fault cpu %u: %llu ns %llu cycles per fault",
+		       bench.cpu, bench.delta_nsec / nr_faults,
+		       bench.delta_cycles / nr_faults);
+		if (bench.size != size)
+			printf(", truncated (size: %lld)", bench.size);
+		printf("\n");
+	}
+}
+
+/* ION allocation and free times are taken here, CPU mapping in the kernel */
+static void bench_dmabuf(int fd, int id)
+{
+	struct mm_benchmark bench = {};
+	int ion_fd, i;
+
+	ion_fd = open("/dev/ion", O_RDONLY);
+	if (ion_fd == -1)
+		perror("open /dev/ion"), exit(1);
+
+	bench.nr_iter = nr_iter;
+	bench.flags = do_write ? MM_BENCH_WRITE : 0;
+
+	for (i = 0; i < repeats; i++) {
+		struct ion_allocation_data alloc = {
+			.len = size,
+			.heap_id_mask = ion_heap_mask,
+		};
+		__u64 t0, t1, t2;
+
+		pthread_barrier_wait(&barrier);
+		t0 = now_nsec();
+		if (ioctl(ion_fd, ION_IOC_ALLOC, &alloc))
+			perror("ION_IOC_ALLOC"), exit(1);
+		t1 = now_nsec();
+
+		bench.fd = alloc.fd;
+		if (ioctl(fd, MM_BENCH_DMABUF_MAP, &bench))
+			perror("ioctl"), exit(1);
+
+		t2 = now_nsec();
+		close(alloc.fd);
+
+		printf("dmabuf cpu %u: alloc %llu ns map %llu ns %llu cycles free %llu ns\n",
+		       bench.cpu, t1 - t0, bench.delta_nsec / nr_iter,
+		       bench.delta_cycles / nr_iter, now_nsec() - t2);
+	}
+
+	close(ion_fd);
+}
+
+static void *thread_fn(void *arg)
+{
+	long id = (long)arg;
+	cpu_set_t cpus;
+	int fd;
+
+	CPU_ZERO(&cpus);
+	CPU_SET(id, &cpus);
+	if (nr_threads > 1 && sched_setaffinity(0, sizeof(cpus), &cpus))
+		perror("sched_setaffinity"), exit(1);
+
+	fd = open("/sys/kernel/debug/mm_benchmark", O_RDWR);
+	if (fd == -1)
+		perror("open"), exit(1);
+
+	if (ion_heap_mask)
+		bench_dmabuf(fd, id);
+	else
+		bench_fault(fd, id);
+
+	close(fd);
+	return NULL;
+}
+
+int main(int argc, char **argv)
+{
+	pthread_t *threads;
+	long i;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "m:r:i:s:f:j:I:wtT")) != -1) {
+		switch (opt) {
+		case 'm':
+			size = atoi(optarg) * MB;
+			break;
+		case 'r':
+			repeats = atoi(optarg);
+			break;
+		case 'i':
+			nr_iter = atoi(optarg);
+			break;
+		case 's':
+			stride = atoi(optarg) * KB;
+			break;
+		case 'f':
+			file = optarg;
+			break;
+		case 'j':
+			nr_threads = atoi(optarg);
+			break;
+		case 'I':
+			ion_heap_mask = strtoul(optarg, NULL, 0);
+			break;
+		case 'w':
+			do_write = 1;
+			break;
+		case 't':
+			thp = 1;
+			break;
+		case 'T':
+			thp = 0;
+			break;
+		default:
+			fprintf(stderr,
+				"usage: %s [-m MB] [-r repeats] [-i iterations] [-s stride KB]\n"
+				"          [-f file] [-j threads] [-I ion heap mask] [-w] [-t|-T]\n",
+				argv[0]);
+			return -1;
+		}
+	}
+
+	if (nr_threads < 1 || nr_iter < 1)
+		return -1;
+
+	/* One thread per CPU, starting each run together */
+	pthread_barrier_init(&barrier, NULL, nr_threads);
+	threads = calloc(nr_threads, sizeof(*threads));
+	if (!threads)
+		perror("calloc"), exit(1);
+
+	for (i = 0; i < nr_threads; i++)
+		if (pthread_create(&threads[i], NULL, thread_fn, (void *)i))
+			perror("pthread_create"), exit(1);
+
+	for (i = 0; i < nr_threads; i++)
+		pthread_join(threads[i], NULL);
+
+	return 0;
+}